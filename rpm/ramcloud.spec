@@ -14,6 +14,7 @@ BuildRoot:	%{_tmppath}/%{name}-%{version}-%{release}-root-%(%{__id_u} -n)
 BuildRequires: boost-devel
 BuildRequires: gcc-c++ >= 4.4.6
 BuildRequires: gtest-devel
+BuildRequires: lz4-devel
 BuildRequires: make
 BuildRequires: openssl-devel
 BuildRequires: pcre-devel
@@ -64,6 +64,31 @@ class Test:
         self.name = name
         self.function = function
 
+# Workloads that the load-generating clients in the tests listed in
+# generator_tests can run (see WorkloadGenerator in ClusterPerf.cc).
+generator_workloads = ['YCSB-A', 'YCSB-B', 'YCSB-C', 'WRITE-ONLY']
+generator_tests = ['readDistWorkload', 'writeDistWorkload',
+        'workloadThroughput']
+
+# Workloads that the ycsb test can run.
+ycsb_workloads = ['YCSB-A', 'YCSB-B', 'YCSB-C', 'YCSB-D', 'YCSB-E', 'YCSB-F']
+
+def unsupported_workload(name, workload):
+    """
+    Return an error message if the test with the given name doesn't support
+    the given --workload, or None if it does (or doesn't use --workload).
+    """
+    if name in generator_tests:
+        supported = generator_workloads
+    elif name == 'ycsb':
+        supported = ycsb_workloads
+    else:
+        return None
+    if workload in supported:
+        return None
+    return ("test %s doesn't support workload %s (choose from %s)" %
+            (name, workload, ", ".join(supported)))
+
 def flatten_args(args):
     """
     Given a dictionary of arguments, produce a string suitable for inclusion
@@ -219,6 +244,24 @@ def run_test(
         client_args['--numIndexes'] = options.numIndexes
     if options.numVClients != None:
         client_args['--numVClients'] = options.numVClients
+    if options.rate != None:
+        client_args['--rate'] = options.rate
+    if options.openLoopOp != None:
+        client_args['--openLoopOp'] = options.openLoopOp
+    if options.maxOutstanding != None:
+        client_args['--maxOutstanding'] = options.maxOutstanding
+    if options.arrivalTrace != None:
+        client_args['--arrivalTrace'] = options.arrivalTrace
+    if options.recordCount != None:
+        client_args['--recordCount'] = options.recordCount
+    if options.fieldCount != None:
+        client_args['--fieldCount'] = options.fieldCount
+    if options.fieldLength != None:
+        client_args['--fieldLength'] = options.fieldLength
+    if options.requestDistribution != None:
+        client_args['--requestDistribution'] = options.requestDistribution
+    if options.threads != None:
+        client_args['--threads'] = options.threads
     test.function(test.name, options, cluster_args, client_args)
 
 #-------------------------------------------------------------------
@@ -540,6 +583,19 @@ def readRandom(name, options, cluster_args, client_args):
             (obj_path, flatten_args(client_args), name), **cluster_args)
     print(get_client_log(), end='')
 
+def readHotKey(name, options, cluster_args, client_args):
+    cluster_args['backup_disks_per_server'] = 0
+    cluster_args['replicas'] = 0
+    if 'master_args' not in cluster_args:
+        cluster_args['master_args'] = '--hotKeyReplicas 2'
+    if 'num_clients' not in cluster_args:
+        cluster_args['num_clients'] = 16
+    if options.num_servers == None:
+        cluster_args['num_servers'] = 3
+    cluster.run(client='%s/ClusterPerf %s %s' %
+            (obj_path, flatten_args(client_args), name), **cluster_args)
+    print(get_client_log(), end='')
+
 # This method is also used for multiReadThroughput and
 # linearizableWriteThroughput
 def readThroughput(name, options, cluster_args, client_args):
@@ -642,9 +698,11 @@ graph_tests = [
     Test("multiRead_oneObjectPerMaster", multiOp),
     Test("multiReadThroughput", readThroughput),
     Test("multiWrite_oneMaster", multiOp),
+    Test("openLoop", default),
     Test("readDist", readDist),
     Test("readDistRandom", readDistRandom),
     Test("readDistWorkload", workloadDist),
+    Test("readHotKey", readHotKey),
     Test("readInterference", default),
     Test("readLoaded", readLoaded),
     Test("readRandom", readRandom),
@@ -663,6 +721,7 @@ graph_tests = [
     Test("writeInterference", default),
     Test("writeThroughput", readThroughput),
     Test("workloadThroughput", readThroughput),
+    Test("ycsb", default),
 ]
 
 if __name__ == '__main__':
@@ -727,8 +786,10 @@ if __name__ == '__main__':
             help='Number of times to execute operating before '
             'starting measurements')
     parser.add_option('--workload', default='YCSB-A',
-            choices=['YCSB-A', 'YCSB-B', 'YCSB-C', 'WRITE-ONLY'],
-            help='Name of workload to run on extra clients to generate load')
+            choices=generator_workloads + ['YCSB-D', 'YCSB-E', 'YCSB-F'],
+            help='Name of workload to run on extra clients to generate load '
+            '(%s) or, for the ycsb test, the YCSB workload to run (%s)' %
+            (', '.join(generator_workloads), ', '.join(ycsb_workloads)))
     parser.add_option('--targetOps', type=int,
             help='Operations per second that each load generating client '
             'will try to achieve')
@@ -742,6 +803,30 @@ if __name__ == '__main__':
             metavar='N', dest='numVClients',
             help='Number of virtual clients each client instance should '
                  'simulate')
+    parser.add_option('--rate', type=float,
+            help='Average operations per second to issue in open-loop tests')
+    parser.add_option('--openLoopOp',
+            choices=['read', 'write', 'multiRead', 'transaction'],
+            help='Operation to issue in open-loop tests')
+    parser.add_option('--maxOutstanding', type=int,
+            help='Maximum number of requests outstanding at once in '
+            'open-loop tests')
+    parser.add_option('--arrivalTrace',
+            help='File of request inter-arrival times (microseconds, one '
+            'per line) to replay in open-loop tests')
+    parser.add_option('--recordCount', type=int,
+            help='Number of records to load for the ycsb test')
+    parser.add_option('--fieldCount', type=int,
+            help='Number of fields in each record for the ycsb test')
+    parser.add_option('--fieldLength', type=int,
+            help='Size of each field (in bytes) for the ycsb test')
+    parser.add_option('--requestDistribution',
+            choices=['uniform', 'zipfian', 'latest'],
+            help='Distribution for choosing keys in the ycsb test '
+            '(default depends on the workload)')
+    parser.add_option('--threads', type=int,
+            help='Number of threads issuing requests in each client for '
+            'the ycsb test')
     parser.add_option('--rcdf', action='store_true', default=False,
             dest='rcdf',
             help='Output reverse CDF data instead.')
@@ -755,6 +840,11 @@ if __name__ == '__main__':
             for test in simple_tests:
                 run_test(test, options)
             for test in graph_tests:
+                error = unsupported_workload(test.name, options.workload)
+                if error != None:
+                    print("Skipping %s: %s" % (test.name, error),
+                            file=sys.stderr)
+                    continue
                 run_test(test, options)
         else:
             if len(args) == 0:
@@ -773,6 +863,10 @@ if __name__ == '__main__':
                         "indexMultiple",
                         "transaction_oneMaster"
                 ]
+            for name in args:
+                error = unsupported_workload(name, options.workload)
+                if error != None:
+                    parser.error(error)
             for name in args:
                 for test in simple_tests:
                     if test.name == name:
@@ -51,31 +51,48 @@ callees = {
     "CREATE_TABLE":          ["TAKE_TABLET_OWNERSHIP"],
     "DROP_INDEX":            ["DROP_TABLET_OWNERSHIP"],
     "DROP_TABLE":            ["TAKE_TABLET_OWNERSHIP"],
-    "FILL_WITH_TEST_DATA":   ["BACKUP_WRITE"],
+    "DROP_TABLET_OWNERSHIP": ["DROP_HOT_OBJECT"],
+    "FILL_WITH_TEST_DATA":   ["BACKUP_WRITE", "PULL_TABLET_DATA"],
     "GET_HEAD_OF_LOG":       ["BACKUP_WRITE"],
     "HINT_SERVER_CRASHED":   ["PING"],
-    "INCREMENT":             ["BACKUP_WRITE"],
-    "INSERT_INDEX_ENTRY":    ["BACKUP_WRITE"],
-    "MIGRATE_TABLET":        ["RECEIVE_MIGRATION_DATA",
+    "INCREMENT":             ["BACKUP_WRITE", "DROP_HOT_OBJECT",
+                              "PULL_TABLET_DATA"],
+    "INSERT_INDEX_ENTRY":    ["BACKUP_WRITE", "PULL_TABLET_DATA"],
+    "LOOKUP_INDEX_KEYS":     ["PULL_TABLET_DATA"],
+    "MIGRATE_TABLET":        ["DROP_HOT_OBJECT", "RECEIVE_MIGRATION_DATA",
                               "REASSIGN_TABLET_OWNERSHIP"],
-    "MULTI_OP":              ["BACKUP_WRITE", "INSERT_INDEX_ENTRY",
+    "MULTI_OP":              ["BACKUP_WRITE", "DROP_HOT_OBJECT",
+                              "INSERT_INDEX_ENTRY", "PULL_TABLET_DATA",
                               "REMOVE_INDEX_ENTRY"],
-    "READ":                  ["BACKUP_WRITE"],
-    "READ_HASHES":           ["BACKUP_WRITE"],
-    "READ_KEYS_AND_VALUE":   ["BACKUP_WRITE"],
+    "PULL_TABLET_DATA":      ["BACKUP_WRITE"],
+    "READ":                  ["BACKUP_WRITE", "PULL_TABLET_DATA"],
+    "READ_HASHES":           ["BACKUP_WRITE", "PULL_TABLET_DATA"],
+    "READ_KEYS_AND_VALUE":   ["BACKUP_WRITE", "PULL_TABLET_DATA"],
+    "REASSIGN_TABLET_OWNERSHIP":
+                             ["DROP_TABLET_OWNERSHIP",
+                              "TAKE_TABLET_OWNERSHIP"],
     "RECEIVE_MIGRATION_DATA":["BACKUP_WRITE"],
-    "RECOVER":               ["BACKUP_GETRECOVERYDATA", "BACKUP_WRITE"],
-    "REMOVE":                ["BACKUP_WRITE", "REMOVE_INDEX_ENTRY"],
-    "REMOVE_INDEX_ENTRY":    ["BACKUP_WRITE"],
+    "RECOVER":               ["BACKUP_GETRECOVERYDATA", "BACKUP_WRITE",
+                              "PULL_TABLET_DATA"],
+    "RECOVERY_MASTER_FINISHED":
+                             ["DROP_TABLET_OWNERSHIP",
+                              "TAKE_TABLET_OWNERSHIP"],
+    "REMOVE":                ["BACKUP_WRITE", "DROP_HOT_OBJECT",
+                              "PULL_TABLET_DATA", "REMOVE_INDEX_ENTRY"],
+    "REMOVE_INDEX_ENTRY":    ["BACKUP_WRITE", "PULL_TABLET_DATA"],
     "SERVER_CONTROL_ALL":    ["SERVER_CONTROL"],
     "SPLIT_AND_MIGRATE_INDEXLET":
                              ["RECEIVE_MIGRATION_DATA"],
     "TAKE_TABLET_OWNERSHIP": ["BACKUP_WRITE"],
-    "TX_DECISION":           ["BACKUP_WRITE"],
+    "TX_DECISION":           ["BACKUP_WRITE", "DROP_HOT_OBJECT",
+                              "PULL_TABLET_DATA"],
     "TX_HINT_FAILED":        ["BACKUP_WRITE"],
-    "TX_PREPARE":            ["BACKUP_WRITE"],
+    "TX_PREPARE":            ["BACKUP_WRITE", "DROP_HOT_OBJECT",
+                              "PULL_TABLET_DATA"],
     "TX_REQUEST_ABORT":      ["BACKUP_WRITE"],
-    "WRITE":                 ["BACKUP_WRITE", "INSERT_INDEX_ENTRY",
+    "UPDATE_SERVER_LIST":    ["FORWARD_SERVER_LIST"],
+    "WRITE":                 ["BACKUP_WRITE", "DROP_HOT_OBJECT",
+                              "INSERT_INDEX_ENTRY", "PULL_TABLET_DATA",
                               "REMOVE_INDEX_ENTRY"],
 }
 
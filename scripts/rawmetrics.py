@@ -163,9 +163,25 @@ coordinator.metric('recoveryTicks', 'elapsed time during recoveries')
 coordinator.metric('recoveryBuildReplicaMapTicks',
                    'time contacting backups and finding replicas for crashed '
                    'master')
+coordinator.metric('recoveryPartitionTicks',
+    'time partitioning the crashed master\'s tablets and telling backups '
+    'about the partitions')
 coordinator.metric('recoveryStartTicks', 'time in Recovery::start')
 coordinator.metric('recoveryCompleteTicks',
     'time sending recovery complete RPCs to backups')
+coordinator.metric('recoveryPartitionMinBytes',
+    'estimated size of the smallest partition in the last recovery')
+coordinator.metric('recoveryPartitionMaxBytes',
+    'estimated size of the largest partition in the last recovery')
+coordinator.metric('recoveryMasterFastestTicks',
+    'time for the fastest recovery master in the last recovery to finish')
+coordinator.metric('recoveryMasterSlowestTicks',
+    'time for the slowest recovery master in the last recovery to finish')
+coordinator.metric('serverListUpdateRpcCount',
+    'UPDATE_SERVER_LIST RPCs sent by the coordinator')
+coordinator.metric('serverListForwardedCount',
+    'server list updates delivered by servers forwarding them rather than '
+    'by the coordinator')
 
 master = Group('Master', 'metrics for masters')
 master.metric('recoveryCount',
@@ -494,6 +494,9 @@ def makeReport(data):
     coordSection.ms('Starting recovery on backups',
         coord.coordinator.recoveryBuildReplicaMapTicks / coord.clockFrequency,
         total=recoveryTime)
+    coordSection.ms('  Partitioning tablets',
+        coord.coordinator.recoveryPartitionTicks / coord.clockFrequency,
+        total=recoveryTime)
     coordSection.ms('Starting recovery on masters',
         coord.coordinator.recoveryStartTicks / coord.clockFrequency,
         total=recoveryTime)
@@ -517,6 +520,18 @@ def makeReport(data):
     coordSection.ms('Receiving in transport',
         coord.transport.receive.ticks / coord.clockFrequency,
         total=recoveryTime)
+    coordSection.ms('Fastest recovery master',
+        coord.coordinator.recoveryMasterFastestTicks / coord.clockFrequency,
+        total=recoveryTime)
+    coordSection.ms('Slowest recovery master',
+        coord.coordinator.recoveryMasterSlowestTicks / coord.clockFrequency,
+        total=recoveryTime)
+    coordSection.line('Smallest partition (estimated)',
+        coord.coordinator.recoveryPartitionMinBytes / 1024.0 / 1024.0,
+        'MB')
+    coordSection.line('Largest partition (estimated)',
+        coord.coordinator.recoveryPartitionMaxBytes / 1024.0 / 1024.0,
+        'MB')
 
     masterSection = report.add(Section('Recovery Master Time'))
 
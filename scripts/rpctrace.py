@@ -0,0 +1,223 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2016 Stanford University
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""
+This program merges time traces from several RAMCloud processes (clients,
+masters, backups, the coordinator) into per-RPC timelines for the RPCs
+that were selected for tracing (see the --rpcTraceInterval option and
+src/RpcTrace.h). Each input file holds the time trace for one process:
+either the output of a GET_TIME_TRACE server control, or a log file
+containing a trace printed by LOG_TIME_TRACE.
+
+The processes' clocks are not synchronized, so the program estimates the
+offset between each pair of processes from the traced RPCs that passed
+between them (in the same way as NTP: the request and the reply are
+assumed to take equal time on the wire). The output is a JSON file in
+Chrome's trace event format; load it in chrome://tracing or Perfetto.
+"""
+
+from __future__ import division, print_function
+from optparse import OptionParser
+import json
+import os
+import re
+import sys
+
+# Matches one line of time trace output (raw, or embedded in a log message).
+traceLine = re.compile('([0-9.]+) ns \(\+ *-?[0-9.]+ ns\): rpc ([0-9]+): (.*)')
+
+# Each entry describes a span to display for each RPC: name for the span,
+# event that starts it, event that ends it. Events are matched by prefix.
+phases = [
+    ['client', 'client sent', 'client received response'],
+    ['server', 'server received', 'reply sent'],
+    ['worker', 'worker started', 'worker finished'],
+    ['replication sync', 'replication sync started',
+            'replication sync finished'],
+]
+
+def readTrace(name):
+    """
+    Read the traced-RPC events from one file. Returns a list of processes,
+    each of which is a dictionary with the following elements:
+        name:     Name for the process (derived from the file name).
+        events:   List of [time, traceId, event], where time is in ns
+                  (relative to an arbitrary origin) and event is the text
+                  of the event without the "rpc <id>: " prefix.
+    A file may contain several traces printed at different times (each
+    with its own time origin); each of them is returned as a separate
+    process.
+    """
+    base = os.path.basename(name)
+    processes = []
+    events = None
+    lastTime = None
+    for line in open(name):
+        match = traceLine.search(line)
+        if not match:
+            continue
+        time = float(match.group(1))
+        if (events is None) or (time < lastTime):
+            # Start of a new trace.
+            events = []
+            processes.append({'name': base, 'events': events})
+            if len(processes) > 1:
+                processes[-1]['name'] = '%s#%d' % (base, len(processes))
+        lastTime = time
+        events.append([time, int(match.group(2)), match.group(3)])
+    return processes
+
+def findEvent(events, traceId, prefix, after=None, exact=False):
+    """
+    Return the time of the first event for a given RPC whose text starts
+    with prefix (or, if exact is True, is exactly prefix) and, if after
+    isn't None, which occurred no earlier than after. Returns None if
+    there is no such event.
+    """
+    for time, id, event in events:
+        if (id == traceId) and ((event == prefix) or
+                (not exact and event.startswith(prefix))):
+            if (after is None) or (time >= after):
+                return time
+    return None
+
+def estimateOffsets(processes, reference):
+    """
+    Compute, for each process, the amount to subtract from its times in
+    order to express them in the time base of the reference process.
+    Returns a dictionary mapping from process name to offset (ns); processes
+    whose offset couldn't be determined (because they exchanged no traced
+    RPCs with processes whose offset is known) are omitted.
+    """
+
+    # Maps from (client name, server name) to a list of estimates of the
+    # server's clock minus the client's clock.
+    estimates = {}
+    for client in processes:
+        for time, id, event in client['events']:
+            if not event.startswith('client sent'):
+                continue
+            opcode = event[len('client sent'):]
+            response = findEvent(client['events'], id,
+                    'client received response', time)
+            if response is None:
+                continue
+            for server in processes:
+                if server is client:
+                    continue
+                received = findEvent(server['events'], id,
+                        'server received' + opcode, exact=True)
+                if received is None:
+                    continue
+                replied = findEvent(server['events'], id, 'reply sent',
+                        received)
+                if replied is None:
+                    continue
+                key = (client['name'], server['name'])
+                estimates.setdefault(key, []).append(
+                        ((received - time) + (replied - response))/2)
+
+    # Take the median estimate for each pair, in both directions.
+    links = {}
+    for (client, server), values in estimates.items():
+        values.sort()
+        median = values[len(values)//2]
+        links.setdefault(client, []).append([server, median])
+        links.setdefault(server, []).append([client, -median])
+
+    # Breadth-first search outward from the reference process.
+    offsets = {reference: 0.0}
+    queue = [reference]
+    while queue:
+        name = queue.pop(0)
+        for other, offset in links.get(name, []):
+            if other not in offsets:
+                offsets[other] = offsets[name] + offset
+                queue.append(other)
+    return offsets
+
+def chromeTrace(processes, offsets):
+    """
+    Generate a list of events in Chrome trace format: one row for each
+    traced RPC within each process, with a span for each phase of the
+    RPC and an instant event for each individual time trace record.
+    """
+    output = []
+    pid = 0
+    for process in processes:
+        if process['name'] not in offsets:
+            continue
+        pid += 1
+        offset = offsets[process['name']]
+        events = process['events']
+        output.append({'ph': 'M', 'name': 'process_name', 'pid': pid,
+                'args': {'name': process['name']}})
+        for time, id, event in events:
+            output.append({'ph': 'i', 'name': event, 'pid': pid, 'tid': id,
+                    's': 't', 'ts': (time - offset)/1000})
+            for name, start, end in phases:
+                if not event.startswith(start):
+                    continue
+                finish = findEvent(events, id, end, time)
+                if finish is None:
+                    continue
+                output.append({'ph': 'X', 'name': name, 'pid': pid,
+                        'tid': id, 'ts': (time - offset)/1000,
+                        'dur': (finish - time)/1000,
+                        'args': {'event': event}})
+    return output
+
+# Parse command line options
+parser = OptionParser(description=
+        'Merge the time traces from several RAMCloud processes into '
+        'per-RPC timelines for traced RPCs, in Chrome trace format.',
+        usage='%prog [options] file file ...',
+        conflict_handler='resolve')
+parser.add_option('-o', '--output', type='string', dest='output',
+        default='rpctrace.json',
+        help='write the merged trace to OUTPUT (default: rpctrace.json)')
+parser.add_option('-r', '--reference', type='string', dest='reference',
+        help='express all times in the clock of the process whose file is '
+        'REFERENCE (default: the first file)')
+
+(options, files) = parser.parse_args()
+if len(files) == 0:
+    print("No trace files given")
+    sys.exit(1)
+processes = []
+for name in files:
+    processes.extend(readTrace(name))
+if len(processes) == 0:
+    print("No traced RPCs found")
+    sys.exit(1)
+
+reference = processes[0]['name']
+if options.reference:
+    reference = os.path.basename(options.reference)
+offsets = estimateOffsets(processes, reference)
+for process in processes:
+    if process['name'] not in offsets:
+        print("Couldn't align clock for %s (no traced RPCs to or from other "
+                "processes); omitting it" % (process['name']))
+    elif process['name'] != reference:
+        print("%s: clock offset %.1f us" % (process['name'],
+                offsets[process['name']]/1000))
+
+f = open(options.output, 'w')
+json.dump({'traceEvents': chromeTrace(processes, offsets),
+        'displayTimeUnit': 'ns'}, f)
+f.close()
+print("Wrote %s" % (options.output))
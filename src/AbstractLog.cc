@@ -197,6 +197,7 @@ AbstractLog::free(Reference reference)
                                            &lengthWithMetadata);
     segment->trackDeadEntry(type, lengthWithMetadata);
     if (type == LOG_ENTRY_TYPE_OBJ ||
+        type == LOG_ENTRY_TYPE_OBJCOMP ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
         type == LOG_ENTRY_TYPE_TXPLIST)
@@ -224,7 +225,10 @@ AbstractLog::getMetrics(ProtoBuf::LogMetrics& m)
 }
 
 /**
- * Populate the given perfStats instance with various memory metrics.
+ * Populate the given perfStats instance with various memory metrics. The
+ * values come from counters that are read without acquiring any locks, so
+ * this method never delays appends (but the values may be slightly out of
+ * date with respect to each other).
  * \param[out] stats
  *      The instance of perfStats to be updated for memory stats.
  */
@@ -327,6 +331,31 @@ AbstractLog::segmentExists(uint64_t segmentId)
     return segmentManager->doesIdExist(segmentId);
 }
 
+/**
+ * This method is invoked when the cleaner relocates a live entry by writing
+ * a smaller replacement (e.g., a compressed copy of an object). It keeps the
+ * log's count of live bytes in sync, since that count is otherwise only
+ * updated when entries are appended to the head or freed.
+ *
+ * \param oldReference
+ *      Reference to the entry being relocated.
+ * \param newLengthWithMetadata
+ *      Number of bytes, including segment metadata, occupied by the
+ *      replacement (see LogEntryRelocator::getTotalBytesAppended).
+ */
+void
+AbstractLog::trackShrunkenEntry(Reference oldReference,
+                                uint32_t newLengthWithMetadata)
+{
+    uint32_t oldLengthWithMetadata;
+    oldReference.getEntry(&segmentManager->getAllocator(),
+                          NULL,
+                          &oldLengthWithMetadata);
+    assert(newLengthWithMetadata <= oldLengthWithMetadata);
+    SpinLock::Guard lock(appendLock);
+    totalLiveBytes -= oldLengthWithMetadata - newLengthWithMetadata;
+}
+
 /******************************************************************************
  * PRIVATE METHODS
  ******************************************************************************/
@@ -412,6 +441,7 @@ AbstractLog::append(const SpinLock::Guard& lock,
     // when trying to reclaim memory.
     head->trackNewEntry(type, lengthWithMetadata);
     if (type == LOG_ENTRY_TYPE_OBJ ||
+        type == LOG_ENTRY_TYPE_OBJCOMP ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
         type == LOG_ENTRY_TYPE_TXPLIST)
@@ -500,6 +530,7 @@ AbstractLog::append(const SpinLock::Guard& lock,
     // when trying to reclaim memory.
     head->trackNewEntry(type, lengthWithMetadata);
     if (type == LOG_ENTRY_TYPE_OBJ ||
+        type == LOG_ENTRY_TYPE_OBJCOMP ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
         type == LOG_ENTRY_TYPE_TXPLIST)
@@ -117,6 +117,8 @@ class AbstractLog {
     uint64_t getSegmentId(Reference reference);
     bool hasSpaceFor(uint64_t objectSize);
     bool segmentExists(uint64_t segmentId);
+    void trackShrunkenEntry(Reference oldReference,
+                            uint32_t newLengthWithMetadata);
 
     /*
      * The following overloaded append() methods are for convenience. Fast path
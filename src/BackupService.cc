@@ -59,6 +59,7 @@ BackupService::BackupService(Context* context,
     , oldReplicas(0)
 {
     context->services[WireFormat::BACKUP_SERVICE] = this;
+    context->metricsRegistry->addCollector(this);
     if (config->backup.inMemory) {
         storage.reset(new InMemoryStorage(config->segmentSize,
                                           config->backup.numSegmentFrames,
@@ -116,6 +117,7 @@ BackupService::BackupService(Context* context,
 
 BackupService::~BackupService()
 {
+    context->metricsRegistry->removeCollector(this);
     context->services[WireFormat::BACKUP_SERVICE] = NULL;
     // Stop the garbage collector.
     taskQueue.halt();
@@ -172,6 +174,22 @@ BackupService::benchmark()
     }
 }
 
+/**
+ * Adds the number of replicas stored on this backup, and the number of
+ * master recoveries it is taking part in, to a metrics snapshot (see
+ * MetricsRegistry::Collector::collect).
+ */
+void
+BackupService::collect(MetricsRegistry::Snapshot* snapshot)
+{
+    Lock _(mutex);
+    snapshot->emplace_back("ramcloud_backup_replicas",
+            MetricsRegistry::GAUGE, "", static_cast<double>(frames.size()));
+    snapshot->emplace_back("ramcloud_backup_recoveries",
+            MetricsRegistry::GAUGE, "",
+            static_cast<double>(recoveries.size()));
+}
+
 // See Server::dispatch.
 void
 BackupService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
@@ -25,6 +25,7 @@
 #include "BackupStorage.h"
 #include "CoordinatorClient.h"
 #include "MasterClient.h"
+#include "MetricsRegistry.h"
 #include "Service.h"
 #include "ServerConfig.h"
 #include "TaskQueue.h"
@@ -37,11 +38,13 @@ namespace RAMCloud {
  * masters crash.
  */
 class BackupService : public Service
-                    , ServerTracker<void>::Callback {
+                    , ServerTracker<void>::Callback
+                    , public MetricsRegistry::Collector {
   PUBLIC:
     BackupService(Context* context, const ServerConfig* config);
     virtual ~BackupService();
     void benchmark();
+    void collect(MetricsRegistry::Snapshot* snapshot);
     void dispatch(WireFormat::Opcode opcode, Rpc* rpc);
     ServerId getFormerServerId() const;
     ServerId getServerId() const;
@@ -0,0 +1,316 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <unordered_map>
+
+#include "Common.h"
+#include "BatchingExternalStorage.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a BatchingExternalStorage object.
+ *
+ * \param storage
+ *      All operations are eventually passed to this object. The caller
+ *      retains ownership; it must not be deleted before this object.
+ * \param flushWindowMicros
+ *      How long a thread that starts a flush waits for other writes to
+ *      join its batch (microseconds).
+ */
+BatchingExternalStorage::BatchingExternalStorage(ExternalStorage* storage,
+        uint32_t flushWindowMicros)
+    : mutex()
+    , storage(storage)
+    , flushWindowMicros(flushWindowMicros)
+    , pending()
+    , flushing(false)
+    , flushDone()
+    , failure()
+{}
+
+/**
+ * Destructor for BatchingExternalStorage objects.
+ */
+BatchingExternalStorage::~BatchingExternalStorage()
+{}
+
+// See documentation for ExternalStorage::becomeLeader.
+void
+BatchingExternalStorage::becomeLeader(const char* name,
+        const string& leaderInfo)
+{
+    storage->becomeLeader(name, leaderInfo);
+}
+
+// See documentation for ExternalStorage::get.
+bool
+BatchingExternalStorage::get(const char* name, Buffer* value)
+{
+    return storage->get(name, value);
+}
+
+// See documentation for ExternalStorage::getChildren.
+void
+BatchingExternalStorage::getChildren(const char* name,
+        vector<Object>* children)
+{
+    storage->getChildren(name, children);
+}
+
+// See documentation for ExternalStorage::getLeaderInfo.
+bool
+BatchingExternalStorage::getLeaderInfo(const char* name, Buffer* value)
+{
+    return storage->getLeaderInfo(name, value);
+}
+
+// See documentation for ExternalStorage::getWorkspace.
+const char*
+BatchingExternalStorage::getWorkspace()
+{
+    return storage->getWorkspace();
+}
+
+// See documentation for ExternalStorage::remove. Any writes issued before
+// this call are committed before the object is removed.
+void
+BatchingExternalStorage::remove(const char* name)
+{
+    Lock lock(mutex);
+    startFlush(lock);
+    while (!pending.empty()) {
+        commitPending(lock);
+    }
+    if (failure) {
+        finishFlush(lock);
+        std::rethrow_exception(failure);
+    }
+    lock.unlock();
+    try {
+        storage->remove(name);
+    } catch (...) {
+        lock.lock();
+        finishFlush(lock);
+        throw;
+    }
+    lock.lock();
+    finishFlush(lock);
+}
+
+// See documentation for ExternalStorage::set.
+void
+BatchingExternalStorage::set(Hint flavor, const char* name,
+        const char* value, int valueLength)
+{
+    Lock lock(mutex);
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    vector<Write> writes;
+    writes.emplace_back(flavor, name, value, valueLength);
+    waitForBatch(lock, addWrites(lock, &writes));
+}
+
+// See documentation for ExternalStorage::setMulti. All of the writes are
+// committed in the same batch.
+void
+BatchingExternalStorage::setMulti(vector<Write>* writes)
+{
+    Lock lock(mutex);
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    if (writes->empty()) {
+        return;
+    }
+    waitForBatch(lock, addWrites(lock, writes));
+}
+
+// See documentation for ExternalStorage::setWorkspace.
+void
+BatchingExternalStorage::setWorkspace(const char* pathPrefix)
+{
+    ExternalStorage::setWorkspace(pathPrefix);
+    storage->setWorkspace(pathPrefix);
+}
+
+/**
+ * Add writes to the newest pending batch, or start a new batch if they
+ * would make the newest one exceed MAX_BATCH_WRITES or MAX_BATCH_BYTES.
+ *
+ * \param lock
+ *      Ensures that caller has acquired mutex; not actually used here.
+ * \param writes
+ *      Writes to add; they are moved out of the vector.
+ * \return
+ *      The batch that the writes will be committed in.
+ */
+std::shared_ptr<BatchingExternalStorage::Batch>
+BatchingExternalStorage::addWrites(Lock& lock, vector<Write>* writes)
+{
+    size_t bytes = 0;
+    foreach (Write& write, *writes) {
+        bytes += write.name.size() + write.value.size();
+    }
+    if (pending.empty() || (!pending.back()->writes.empty() &&
+            (pending.back()->writes.size() + writes->size()
+                    > MAX_BATCH_WRITES ||
+            pending.back()->bytes + bytes > MAX_BATCH_BYTES))) {
+        pending.push_back(std::make_shared<Batch>());
+    }
+    std::shared_ptr<Batch> batch = pending.back();
+    foreach (Write& write, *writes) {
+        batch->writes.push_back(std::move(write));
+    }
+    batch->bytes += bytes;
+    return batch;
+}
+
+/**
+ * Pass the oldest pending batch to the underlying storage in a single
+ * setMulti call, and record the outcome in the batch. The caller must have
+ * set #flushing.
+ *
+ * \param lock
+ *      Ensures that caller has acquired mutex. The mutex is released
+ *      while the underlying storage is being accessed, but it is held
+ *      again when this method returns.
+ */
+void
+BatchingExternalStorage::commitPending(Lock& lock)
+{
+    if (pending.empty()) {
+        return;
+    }
+    std::shared_ptr<Batch> batch = pending.front();
+    pending.pop_front();
+    vector<Write>& writes = batch->writes;
+
+    // If an object was written more than once, only the last value
+    // matters; drop the earlier writes.
+    std::unordered_map<string, size_t> lastWrite;
+    for (size_t i = 0; i < writes.size(); i++) {
+        lastWrite[writes[i].name] = i;
+    }
+    if (lastWrite.size() < writes.size()) {
+        vector<Write> coalesced;
+        for (size_t i = 0; i < writes.size(); i++) {
+            if (lastWrite[writes[i].name] == i) {
+                coalesced.push_back(std::move(writes[i]));
+            }
+        }
+        writes.swap(coalesced);
+    }
+
+    std::exception_ptr error;
+    bool lostLeadership = false;
+    lock.unlock();
+    try {
+        storage->setMulti(&writes);
+    } catch (LostLeadershipException&) {
+        error = std::current_exception();
+        lostLeadership = true;
+    } catch (...) {
+        error = std::current_exception();
+    }
+    lock.lock();
+    if (lostLeadership) {
+        // No later write can succeed either.
+        failure = error;
+    }
+    batch->failure = error;
+    batch->committed = true;
+}
+
+/**
+ * Called when a thread has finished accessing the underlying storage;
+ * lets another thread start a flush.
+ *
+ * \param lock
+ *      Ensures that caller has acquired mutex; not actually used here.
+ */
+void
+BatchingExternalStorage::finishFlush(Lock& lock)
+{
+    flushing = false;
+    flushDone.notify_all();
+}
+
+/**
+ * Wait until no other thread is accessing the underlying storage, then
+ * claim exclusive access to it.
+ *
+ * \param lock
+ *      Ensures that caller has acquired mutex; released while waiting.
+ */
+void
+BatchingExternalStorage::startFlush(Lock& lock)
+{
+    while (flushing) {
+        flushDone.wait(lock);
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    flushing = true;
+}
+
+/**
+ * Return once a particular batch has been committed. If no other thread
+ * is flushing, the calling thread commits the oldest pending batch itself
+ * (repeatedly, until its own batch has been committed); otherwise it waits
+ * for the thread that is flushing.
+ *
+ * \param lock
+ *      Ensures that caller has acquired mutex; released while waiting.
+ * \param batch
+ *      The batch to wait for.
+ *
+ * \throws LostLeadershipException
+ *      The batch could not be committed.
+ * \throws ...
+ *      Any other exception thrown by the underlying storage while
+ *      committing the batch.
+ */
+void
+BatchingExternalStorage::waitForBatch(Lock& lock,
+        const std::shared_ptr<Batch>& batch)
+{
+    while (!batch->committed) {
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+        if (flushing) {
+            flushDone.wait(lock);
+            continue;
+        }
+        flushing = true;
+        // Only the newest batch can still grow, so there is no point
+        // waiting if older ones are queued up.
+        if (flushWindowMicros > 0 && pending.size() == 1) {
+            lock.unlock();
+            usleep(flushWindowMicros);
+            lock.lock();
+        }
+        commitPending(lock);
+        finishFlush(lock);
+    }
+    if (batch->failure) {
+        std::rethrow_exception(batch->failure);
+    }
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,154 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_BATCHINGEXTERNALSTORAGE_H
+#define RAMCLOUD_BATCHINGEXTERNALSTORAGE_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include "ExternalStorage.h"
+
+namespace RAMCloud {
+
+/**
+ * This class sits in front of another ExternalStorage object and combines
+ * writes issued concurrently by different threads into a single setMulti
+ * call on the underlying storage system ("group commit"). The coordinator
+ * handles many requests in parallel (e.g., enlistments of new servers),
+ * each of which writes an object to external storage; without batching
+ * each of those writes costs a separate round trip to the storage servers.
+ *
+ * Semantics are the same as for the underlying storage: "set" does not
+ * return until the object is durable, so callers such as
+ * CoordinatorUpdateManager that rely on one write being durable before the
+ * next one is issued see no difference. Writes issued concurrently may be
+ * committed together, in which case they are applied in the order they
+ * were issued. Each batch is limited to MAX_BATCH_WRITES writes and
+ * MAX_BATCH_BYTES bytes (storage systems limit the size of a single
+ * request); the writes from one call to setMulti are never divided among
+ * batches, so a larger setMulti becomes a batch by itself. Removes are not
+ * batched, but they are ordered with respect to writes issued before them.
+ * Reads go straight to the underlying storage. This class is thread-safe.
+ *
+ * Only writes from threads that don't hold a common lock can be combined.
+ * For example, CoordinatorServerList writes each entry while holding its
+ * monitor lock, so two enlistments are never batched with each other,
+ * though either may be batched with a TableManager or
+ * CoordinatorUpdateManager write. Code that writes several objects at
+ * once should use setMulti instead.
+ */
+class BatchingExternalStorage : public ExternalStorage {
+  PUBLIC:
+    BatchingExternalStorage(ExternalStorage* storage,
+            uint32_t flushWindowMicros);
+    virtual ~BatchingExternalStorage();
+    virtual void becomeLeader(const char* name, const string& leaderInfo);
+    virtual bool get(const char* name, Buffer* value);
+    virtual void getChildren(const char* name, vector<Object>* children);
+    virtual bool getLeaderInfo(const char* name, Buffer* value);
+    virtual const char* getWorkspace();
+    virtual void remove(const char* name);
+    virtual void set(Hint flavor, const char* name, const char* value,
+            int valueLength = -1);
+    virtual void setMulti(vector<Write>* writes);
+    virtual void setWorkspace(const char* pathPrefix);
+
+    /// A new batch is started rather than let a batch grow beyond this
+    /// many writes.
+    static const size_t MAX_BATCH_WRITES = 100;
+
+    /// A new batch is started rather than let the names and values in a
+    /// batch grow beyond this many bytes. This is well below ZooKeeper's
+    /// default limit of 1MB per request.
+    static const size_t MAX_BATCH_BYTES = 256*1024;
+
+  PRIVATE:
+    /**
+     * A group of writes that will be committed with a single setMulti call
+     * on the underlying storage.
+     */
+    struct Batch {
+        Batch()
+            : writes()
+            , bytes(0)
+            , committed(false)
+            , failure()
+        {}
+
+        /// Writes in the order they were issued.
+        vector<Write> writes;
+
+        /// Total size of the names and values in writes.
+        size_t bytes;
+
+        /// True means the batch has been passed to the underlying storage
+        /// (successfully or not).
+        bool committed;
+
+        /// If the underlying storage threw an exception while committing
+        /// this batch, it is saved here and rethrown to each thread whose
+        /// write was in the batch.
+        std::exception_ptr failure;
+    };
+
+    /// Monitor-style lock: protects all of the variables below.
+    std::mutex mutex;
+    typedef std::unique_lock<std::mutex> Lock;
+
+    /// The storage system that actually holds the data. Not owned by
+    /// this object.
+    ExternalStorage* storage;
+
+    /// When a thread starts a flush, it waits this long (in microseconds)
+    /// before collecting the pending writes, so that writes issued at
+    /// about the same time end up in the same batch. 0 means flush
+    /// immediately; writes will still be batched if they arrive while
+    /// another flush is in progress.
+    uint32_t flushWindowMicros;
+
+    /// Batches holding writes that have been issued but not yet passed to
+    /// the underlying storage, oldest first. New writes are added to the
+    /// last batch, if it has room.
+    std::deque<std::shared_ptr<Batch>> pending;
+
+    /// True means that some thread is currently accessing the underlying
+    /// storage to commit a batch or remove an object; no other thread may
+    /// start a flush until it finishes.
+    bool flushing;
+
+    /// Notified whenever flushing changes from true to false.
+    std::condition_variable flushDone;
+
+    /// If a commit fails because we lost leadership, this holds the
+    /// exception; it is rethrown to every thread whose write was not
+    /// committed, now or in the future. Other failures only affect the
+    /// batch being committed.
+    std::exception_ptr failure;
+
+    std::shared_ptr<Batch> addWrites(Lock& lock, vector<Write>* writes);
+    void commitPending(Lock& lock);
+    void finishFlush(Lock& lock);
+    void startFlush(Lock& lock);
+    void waitForBatch(Lock& lock, const std::shared_ptr<Batch>& batch);
+
+    DISALLOW_COPY_AND_ASSIGN(BatchingExternalStorage);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_BATCHINGEXTERNALSTORAGE_H
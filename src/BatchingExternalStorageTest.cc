@@ -0,0 +1,221 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <thread>
+
+#include "TestUtil.h"
+#include "BatchingExternalStorage.h"
+#include "MockExternalStorage.h"
+
+namespace RAMCloud {
+
+class BatchingExternalStorageTest : public ::testing::Test {
+  public:
+    MockExternalStorage mock;
+    BatchingExternalStorage storage;
+
+    BatchingExternalStorageTest()
+        : mock(true)
+        , storage(&mock, 0)
+    {}
+
+    /**
+     * Wait until a given number of writes are waiting to be committed.
+     */
+    bool
+    waitForPending(size_t count)
+    {
+        for (int i = 0; i < 1000; i++) {
+            {
+                BatchingExternalStorage::Lock lock(storage.mutex);
+                size_t writes = 0;
+                for (auto& batch : storage.pending)
+                    writes += batch->writes.size();
+                if (writes >= count)
+                    return true;
+            }
+            usleep(1000);
+        }
+        return false;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(BatchingExternalStorageTest);
+};
+
+static void
+setThread(BatchingExternalStorage* storage, const char* name)
+{
+    storage->set(ExternalStorage::UPDATE, name, "value");
+}
+
+TEST_F(BatchingExternalStorageTest, set_noConcurrency) {
+    storage.set(ExternalStorage::CREATE, "a", "1");
+    storage.set(ExternalStorage::UPDATE, "b", "2");
+    EXPECT_EQ("setMulti(CREATE a); setMulti(UPDATE b)", mock.log);
+    EXPECT_EQ(2U, mock.roundTrips);
+    EXPECT_EQ("2", mock.setData);
+    EXPECT_TRUE(storage.pending.empty());
+}
+
+TEST_F(BatchingExternalStorageTest, set_concurrentWritesBatched) {
+    // Pretend that another thread is in the middle of a flush, so that
+    // the following writes pile up.
+    {
+        BatchingExternalStorage::Lock lock(storage.mutex);
+        storage.flushing = true;
+    }
+    std::thread thread1(setThread, &storage, "a");
+    ASSERT_TRUE(waitForPending(1));
+    std::thread thread2(setThread, &storage, "b");
+    ASSERT_TRUE(waitForPending(2));
+    std::thread thread3(setThread, &storage, "c");
+    ASSERT_TRUE(waitForPending(3));
+    {
+        BatchingExternalStorage::Lock lock(storage.mutex);
+        storage.finishFlush(lock);
+    }
+    thread1.join();
+    thread2.join();
+    thread3.join();
+    EXPECT_EQ("setMulti(UPDATE a, UPDATE b, UPDATE c)", mock.log);
+    EXPECT_EQ(1U, mock.roundTrips);
+}
+
+TEST_F(BatchingExternalStorageTest, setMulti) {
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::CREATE, "a", "1");
+    writes.emplace_back(ExternalStorage::UPDATE, "b", "2");
+    storage.setMulti(&writes);
+    EXPECT_EQ("setMulti(CREATE a, UPDATE b)", mock.log);
+    EXPECT_EQ(1U, mock.roundTrips);
+}
+
+TEST_F(BatchingExternalStorageTest, set_failureOnlyAffectsBatch) {
+    mock.setMultiErrors.push(std::make_exception_ptr(
+            FatalError(HERE, "oops")));
+    EXPECT_THROW(storage.set(ExternalStorage::UPDATE, "a", "1"),
+            FatalError);
+    storage.set(ExternalStorage::UPDATE, "b", "2");
+    EXPECT_EQ("setMulti(UPDATE a); setMulti(UPDATE b)", mock.log);
+    EXPECT_EQ("2", mock.setData);
+}
+
+TEST_F(BatchingExternalStorageTest, set_lostLeadershipIsSticky) {
+    mock.setMultiErrors.push(std::make_exception_ptr(
+            ExternalStorage::LostLeadershipException(HERE)));
+    EXPECT_THROW(storage.set(ExternalStorage::UPDATE, "a", "1"),
+            ExternalStorage::LostLeadershipException);
+    EXPECT_THROW(storage.set(ExternalStorage::UPDATE, "b", "2"),
+            ExternalStorage::LostLeadershipException);
+    EXPECT_EQ("setMulti(UPDATE a)", mock.log);
+}
+
+TEST_F(BatchingExternalStorageTest, addWrites_limits) {
+    BatchingExternalStorage::Lock lock(storage.mutex);
+    vector<ExternalStorage::Write> writes;
+    for (size_t i = 0; i < BatchingExternalStorage::MAX_BATCH_WRITES; i++) {
+        writes.emplace_back(ExternalStorage::UPDATE, "a", "1");
+        storage.addWrites(lock, &writes);
+        writes.clear();
+    }
+    EXPECT_EQ(1U, storage.pending.size());
+
+    // Too many writes.
+    writes.emplace_back(ExternalStorage::UPDATE, "b", "2");
+    storage.addWrites(lock, &writes);
+    EXPECT_EQ(2U, storage.pending.size());
+    EXPECT_EQ(2U, storage.pending.back()->bytes);
+
+    // Too many bytes.
+    string big(BatchingExternalStorage::MAX_BATCH_BYTES, 'x');
+    writes.clear();
+    writes.emplace_back(ExternalStorage::UPDATE, "c", big.c_str());
+    storage.addWrites(lock, &writes);
+    EXPECT_EQ(3U, storage.pending.size());
+    EXPECT_EQ(1U, storage.pending.back()->writes.size());
+
+    // A batch always accepts its first writes, however large.
+    writes.clear();
+    writes.emplace_back(ExternalStorage::UPDATE, "d", "4");
+    storage.addWrites(lock, &writes);
+    EXPECT_EQ(4U, storage.pending.size());
+}
+
+TEST_F(BatchingExternalStorageTest, remove_commitsEarlierWrites) {
+    {
+        BatchingExternalStorage::Lock lock(storage.mutex);
+        vector<ExternalStorage::Write> writes;
+        writes.emplace_back(ExternalStorage::UPDATE, "a", "1");
+        storage.addWrites(lock, &writes);
+        writes.clear();
+        writes.emplace_back(ExternalStorage::UPDATE, "b", "2");
+        storage.pending.push_back(
+                std::make_shared<BatchingExternalStorage::Batch>());
+        storage.addWrites(lock, &writes);
+    }
+    storage.remove("a");
+    EXPECT_EQ("setMulti(UPDATE a); setMulti(UPDATE b); remove(a)",
+            mock.log);
+    EXPECT_FALSE(storage.flushing);
+}
+
+TEST_F(BatchingExternalStorageTest, commitPending_coalesce) {
+    BatchingExternalStorage::Lock lock(storage.mutex);
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::CREATE, "a", "1");
+    writes.emplace_back(ExternalStorage::UPDATE, "b", "2");
+    writes.emplace_back(ExternalStorage::UPDATE, "a", "3");
+    auto batch = storage.addWrites(lock, &writes);
+    storage.commitPending(lock);
+    EXPECT_EQ("setMulti(UPDATE b, UPDATE a)", mock.log);
+    EXPECT_EQ("3", mock.setData);
+    EXPECT_TRUE(batch->committed);
+    EXPECT_TRUE(storage.pending.empty());
+}
+
+TEST_F(BatchingExternalStorageTest, commitPending_oldestBatchOnly) {
+    BatchingExternalStorage::Lock lock(storage.mutex);
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::UPDATE, "a", "1");
+    auto first = storage.addWrites(lock, &writes);
+    writes.clear();
+    storage.pending.push_back(
+            std::make_shared<BatchingExternalStorage::Batch>());
+    writes.emplace_back(ExternalStorage::UPDATE, "b", "2");
+    auto second = storage.addWrites(lock, &writes);
+    storage.commitPending(lock);
+    EXPECT_EQ("setMulti(UPDATE a)", mock.log);
+    EXPECT_TRUE(first->committed);
+    EXPECT_FALSE(second->committed);
+    EXPECT_EQ(1U, storage.pending.size());
+}
+
+TEST_F(BatchingExternalStorageTest, commitPending_nothingPending) {
+    BatchingExternalStorage::Lock lock(storage.mutex);
+    storage.commitPending(lock);
+    EXPECT_EQ("", mock.log);
+}
+
+TEST_F(BatchingExternalStorageTest, waitForBatch_failure) {
+    storage.failure = std::make_exception_ptr(
+            ExternalStorage::LostLeadershipException(HERE));
+    EXPECT_THROW(storage.set(ExternalStorage::UPDATE, "a", "1"),
+            ExternalStorage::LostLeadershipException);
+    EXPECT_THROW(storage.remove("a"),
+            ExternalStorage::LostLeadershipException);
+    EXPECT_EQ("", mock.log);
+}
+
+}  // namespace RAMCloud
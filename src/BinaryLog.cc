@@ -0,0 +1,1046 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <time.h>
+#include <algorithm>
+
+#include "Common.h"
+#include "BinaryLog.h"
+#include "Cycles.h"
+#include "ThreadId.h"
+
+namespace RAMCloud {
+
+std::atomic<bool> BinaryLog::enabled(false);
+std::mutex BinaryLog::mutex;
+vector<BinaryLog::CallSite*> BinaryLog::sites;
+vector<string> BinaryLog::siteTypes;
+vector<BinaryLog::StagingBuffer*> BinaryLog::buffers;
+__thread BinaryLog::StagingBuffer* BinaryLog::threadBuffer = NULL;
+pthread_key_t BinaryLog::threadKey;
+bool BinaryLog::threadKeyCreated = false;
+std::thread* BinaryLog::writerThread = NULL;
+BinaryLog::Writer* BinaryLog::writer = NULL;
+int BinaryLog::fd = -1;
+std::atomic<bool> BinaryLog::writerExit(false);
+std::atomic<uint64_t> BinaryLog::writerPasses(0);
+
+namespace {
+
+/// Size of each thread's staging buffer, in bytes.
+const uint32_t STAGING_BUFFER_SIZE = 1 << 18;
+
+/// How long the writer thread sleeps when it finds nothing to write.
+const uint32_t POLL_MICROS = 1000;
+
+/// The writer thread issues a write once it has this many bytes of output.
+const size_t WRITE_THRESHOLD = 1 << 16;
+
+/// Friendly names for each #LogLevel value (must match Logger.cc).
+const char* levelNames[] = {"(none)", "ERROR", "WARNING", "NOTICE", "DEBUG"};
+static_assert(unsafeArrayLength(levelNames) == NUM_LOG_LEVELS,
+              "levelNames size does not match NUM_LOG_LEVELS");
+
+/**
+ * A log file consists of this header followed by a series of entries,
+ * each starting with one of the type characters below. Integers in
+ * entries are stored as varints (7 bits per byte, least significant
+ * first); signed integers are zigzag-encoded first. The entries are:
+ *
+ * SITE_ENTRY: id, line, module, then file, function, format, and the
+ *      argument types, each as a length followed by the characters.
+ * RECORD_ENTRY: site id, level, thread id, change in timestamp since the
+ *      previous record (signed), then the arguments: strings as a length
+ *      and characters, doubles as 8 raw bytes, signed integers
+ *      zigzag-encoded, and everything else unchanged.
+ * LOST_ENTRY: thread id, number of messages discarded because the
+ *      thread's staging buffer was full.
+ */
+struct FileHeader {
+    char magic[8];                // Always MAGIC.
+    double cyclesPerSecond;       // Cycles::perSecond() for the writer.
+    uint64_t baseTsc;             // Cycles::rdtsc when the log was opened;
+                                  // the first record's timestamp is
+                                  // relative to this.
+    uint64_t baseSeconds;         // Wall-clock time corresponding to
+    uint64_t baseNanoseconds;     // baseTsc.
+} __attribute__((packed));
+
+const char MAGIC[8] = {'R', 'C', 'B', 'L', 'O', 'G', '0', '1'};
+const char SITE_ENTRY = 'S';
+const char RECORD_ENTRY = 'R';
+const char LOST_ENTRY = 'L';
+
+void
+appendVarint(string* output, uint64_t value)
+{
+    while (value >= 0x80) {
+        output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    output->push_back(static_cast<char>(value));
+}
+
+void
+appendSigned(string* output, int64_t value)
+{
+    appendVarint(output, (static_cast<uint64_t>(value) << 1)
+            ^ static_cast<uint64_t>(value >> 63));
+}
+
+void
+appendString(string* output, const char* s, size_t length)
+{
+    appendVarint(output, length);
+    output->append(s, length);
+}
+
+/**
+ * Write all of a block of data to a file, ignoring errors (there is
+ * nowhere to report them).
+ */
+void
+writeAll(int fd, const char* data, size_t length)
+{
+    while (length > 0) {
+        ssize_t count = write(fd, data, length);
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += count;
+        length -= count;
+    }
+}
+
+/**
+ * Used by decompress to parse a log file; all methods return false if
+ * the input is exhausted.
+ */
+struct Reader {
+    explicit Reader(const string& input)
+        : input(input)
+        , position(0)
+    {}
+
+    bool
+    raw(void* dest, size_t length)
+    {
+        if (input.size() - position < length) {
+            return false;
+        }
+        memcpy(dest, input.data() + position, length);
+        position += length;
+        return true;
+    }
+
+    bool
+    varint(uint64_t* value)
+    {
+        *value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position >= input.size()) {
+                return false;
+            }
+            uint8_t byte = static_cast<uint8_t>(input[position]);
+            position++;
+            *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool
+    signedVarint(int64_t* value)
+    {
+        uint64_t zigzag;
+        if (!varint(&zigzag)) {
+            return false;
+        }
+        *value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(
+                zigzag & 1);
+        return true;
+    }
+
+    bool
+    str(string* value)
+    {
+        uint64_t length;
+        if (!varint(&length) || input.size() - position < length) {
+            return false;
+        }
+        value->assign(input, position, length);
+        position += length;
+        return true;
+    }
+
+    const string& input;
+    size_t position;
+};
+
+/// Information about a call site, as read from the log by decompress.
+struct Site {
+    string file;
+    string function;
+    string format;
+    string types;
+    uint64_t line;
+};
+
+/// The value of one argument to a log message, as read by decompress.
+struct Arg {
+    char type;                     // See BinaryLog::typeCode.
+    uint64_t bits;                 // Value for all types except 's'.
+    string s;                      // Value for 's'.
+};
+
+/**
+ * Append a formatted value to a string (printf-style).
+ */
+void
+appendFormatted(string* output, const char* format, ...)
+{
+    char buffer[2000];
+    va_list ap;
+    va_start(ap, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, ap);
+    va_end(ap);
+    if (length < 0) {
+        return;
+    }
+    if (static_cast<size_t>(length) >= sizeof(buffer)) {
+        length = sizeof(buffer) - 1;
+    }
+    output->append(buffer, length);
+}
+
+/**
+ * Regenerate the text of a log message from its format string and
+ * arguments. Each printf conversion is formatted separately, using the
+ * stored type of its argument.
+ *
+ * \param formatString
+ *      The format string from the message's call site.
+ * \param args
+ *      Arguments for the message.
+ * \param output
+ *      The message is appended here.
+ */
+void
+formatMessage(const string& formatString, const vector<Arg>& args,
+        string* output)
+{
+    size_t nextArg = 0;
+    const char* p = formatString.c_str();
+    while (*p != 0) {
+        if (*p != '%') {
+            output->push_back(*p);
+            p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            output->push_back('%');
+            p += 2;
+            continue;
+        }
+
+        // Collect the flags, width, and precision, substituting values
+        // for any "*"s.
+        string spec("%");
+        p++;
+        while (*p != 0 && strchr("-+ #0", *p) != NULL) {
+            spec.push_back(*p);
+            p++;
+        }
+        for (int part = 0; part < 2; part++) {
+            if (part == 1) {
+                if (*p != '.') {
+                    break;
+                }
+                spec.push_back('.');
+                p++;
+            }
+            if (*p == '*') {
+                if (nextArg < args.size()) {
+                    spec += format("%d", static_cast<int>(args[nextArg].bits));
+                    nextArg++;
+                }
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') {
+                spec.push_back(*p);
+                p++;
+            }
+        }
+
+        // Length modifiers are dropped; "long" arguments were stored as
+        // 64 bits, and shorter ones are truncated to 32 bits.
+        bool isLong = false;
+        while (*p != 0 && strchr("hlLqjzt", *p) != NULL) {
+            if (*p != 'h') {
+                isLong = true;
+            }
+            p++;
+        }
+        char conversion = *p;
+        if (conversion == 0) {
+            break;
+        }
+        p++;
+        if (nextArg >= args.size()) {
+            output->append("<missing>");
+            continue;
+        }
+        const Arg& arg = args[nextArg];
+        nextArg++;
+        if (arg.type == 's') {
+            spec.push_back('s');
+            appendFormatted(output, spec.c_str(), arg.s.c_str());
+            continue;
+        }
+        switch (conversion) {
+            case 'd':
+            case 'i': {
+                int64_t value = static_cast<int64_t>(arg.bits);
+                if (!isLong) {
+                    value = static_cast<int32_t>(value);
+                }
+                spec += "lld";
+                appendFormatted(output, spec.c_str(),
+                        static_cast<long long>(value)); // NOLINT
+                break;
+            }
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X': {
+                uint64_t value = arg.bits;
+                if (!isLong) {
+                    value = static_cast<uint32_t>(value);
+                }
+                spec += "ll";
+                spec.push_back(conversion);
+                appendFormatted(output, spec.c_str(),
+                        static_cast<unsigned long long>(value)); // NOLINT
+                break;
+            }
+            case 'c':
+                spec.push_back('c');
+                appendFormatted(output, spec.c_str(),
+                        static_cast<int>(arg.bits));
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double value;
+                memcpy(&value, &arg.bits, sizeof(value));
+                spec.push_back(conversion);
+                appendFormatted(output, spec.c_str(), value);
+                break;
+            }
+            case 'p':
+                spec.push_back('p');
+                appendFormatted(output, spec.c_str(),
+                        reinterpret_cast<void*>(arg.bits));
+                break;
+            default:
+                appendFormatted(output, "<bad conversion '%c'>", conversion);
+                break;
+        }
+    }
+}
+
+} // anonymous namespace
+
+/**
+ * Each thread that logs messages has one of these buffers. Records are
+ * added by the owning thread and removed by the writer thread, so no
+ * locking is needed. The buffer is circular; a record never wraps around
+ * the end of the buffer. If a record won't fit at the end, the owning
+ * thread skips to the beginning, leaving a padding record (or, if there
+ * isn't even room for a header, nothing) behind.
+ */
+class BinaryLog::StagingBuffer {
+  public:
+    explicit StagingBuffer(uint32_t threadId)
+        : produced(0)
+        , consumed(0)
+        , lost(0)
+        , lostReported(0)
+        , exited(false)
+        , threadId(threadId)
+        , data()
+    {}
+
+    /// Total number of bytes (including padding) ever added to the buffer.
+    /// Written only by the owning thread.
+    std::atomic<uint64_t> produced;
+
+    /// Total number of bytes ever removed from the buffer. Written only by
+    /// the writer thread.
+    std::atomic<uint64_t> consumed;
+
+    /// Number of messages discarded because the buffer was full. Written
+    /// only by the owning thread.
+    std::atomic<uint64_t> lost;
+
+    /// Value of lost when it was last written to the log. Used only by
+    /// the writer thread.
+    uint64_t lostReported;
+
+    /// True means the owning thread has exited, so nothing more will be
+    /// added to the buffer; it can be freed once it has been drained.
+    std::atomic<bool> exited;
+
+    /// ThreadId of the owning thread.
+    uint32_t threadId;
+
+    /// Storage for records.
+    char data[STAGING_BUFFER_SIZE];
+
+  private:
+    DISALLOW_COPY_AND_ASSIGN(StagingBuffer);
+};
+
+/**
+ * Drains the staging buffers, compresses the records, and writes them to
+ * the log file. The writer thread invokes drain repeatedly; once it has
+ * exited, close invokes drain one last time.
+ */
+class BinaryLog::Writer {
+  public:
+    explicit Writer(uint64_t baseTsc)
+        : output()
+        , currentBuffers()
+        , types()
+        , lastTimestamp(baseTsc)
+    {}
+
+    bool drain();
+
+  private:
+    void refreshSites();
+
+    /// Compressed entries that haven't been written to the file yet.
+    string output;
+
+    /// Copy of BinaryLog::buffers made at the start of each pass.
+    vector<StagingBuffer*> currentBuffers;
+
+    /// Argument types for each call site whose SITE_ENTRY has been
+    /// written; entry i describes the site with id i+1.
+    vector<string> types;
+
+    /// Timestamp of the most recent record written; each record's
+    /// timestamp is written relative to the previous one.
+    uint64_t lastTimestamp;
+
+    DISALLOW_COPY_AND_ASSIGN(Writer);
+};
+
+/**
+ * Start logging to a binary log file. Once this method returns,
+ * RAMCLOUD_LOG messages go to this file rather than the text log.
+ *
+ * \param path
+ *      Name of the file to log to. If it already exists it is truncated.
+ *
+ * \throw Exception
+ *      The file couldn't be opened, or a binary log is already open.
+ */
+void
+BinaryLog::open(const char* path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (writerThread != NULL) {
+        throw Exception(HERE, "binary log is already open");
+    }
+    int newFd = ::open(path, O_CREAT | O_WRONLY | O_TRUNC, 0666);
+    if (newFd < 0) {
+        throw Exception(HERE,
+                        format("couldn't open binary log file '%s'", path),
+                        errno);
+    }
+
+    FileHeader header;
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.cyclesPerSecond = Cycles::perSecond();
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t baseTsc = Cycles::rdtsc();
+    header.baseTsc = baseTsc;
+    header.baseSeconds = now.tv_sec;
+    header.baseNanoseconds = now.tv_nsec;
+    writeAll(newFd, reinterpret_cast<char*>(&header), sizeof(header));
+
+    fd = newFd;
+    writerExit = false;
+    writer = new Writer(baseTsc);
+    writerThread = new std::thread(writerMain, writer);
+    enabled = true;
+}
+
+/**
+ * Stop binary logging: future messages go to the text log. All messages
+ * logged before this method is called are written to the binary log
+ * file before it returns. This method does nothing if the binary log
+ * isn't open (or is already being closed).
+ */
+void
+BinaryLog::close()
+{
+    std::thread* thread;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (writerThread == NULL || writerExit) {
+            return;
+        }
+        enabled = false;
+        thread = writerThread;
+        writerExit = true;
+    }
+    thread->join();
+    delete thread;
+
+    // Threads that were in the middle of logging a message when enabled
+    // was cleared may have finished after the writer thread's last pass,
+    // so drain all of the buffers once more.
+    writer->drain();
+    delete writer;
+    writer = NULL;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (vector<StagingBuffer*>::iterator it = buffers.begin();
+            it != buffers.end(); ) {
+        if ((*it)->exited) {
+            delete *it;
+            it = buffers.erase(it);
+        } else {
+            it++;
+        }
+    }
+    writerThread = NULL;
+    ::close(fd);
+    fd = -1;
+}
+
+/**
+ * Regenerate the text form of a binary log.
+ *
+ * \param input
+ *      Contents of a file created by BinaryLog.
+ * \param output
+ *      The messages are appended here, in the same format as the text log.
+ * \return
+ *      True means the entire log was decoded; false means that the log
+ *      was truncated or corrupted (in which case output contains the
+ *      messages decoded before the problem was found).
+ */
+bool
+BinaryLog::decompress(const string& input, string* output)
+{
+    Reader reader(input);
+    FileHeader header;
+    if (!reader.raw(&header, sizeof(header))
+            || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    std::unordered_map<uint64_t, Site> sites;
+    uint64_t timestamp = header.baseTsc;
+    uint64_t seconds = header.baseSeconds;
+    uint64_t nanoseconds = header.baseNanoseconds;
+    while (reader.position < input.size()) {
+        char type;
+        reader.raw(&type, 1);
+        if (type == SITE_ENTRY) {
+            uint64_t id, module;
+            Site site;
+            if (!reader.varint(&id) || !reader.varint(&site.line)
+                    || !reader.varint(&module) || !reader.str(&site.file)
+                    || !reader.str(&site.function)
+                    || !reader.str(&site.format) || !reader.str(&site.types)) {
+                return false;
+            }
+            sites[id] = site;
+        } else if (type == RECORD_ENTRY) {
+            uint64_t id, level, threadId;
+            int64_t delta;
+            if (!reader.varint(&id) || !reader.varint(&level)
+                    || !reader.varint(&threadId)
+                    || !reader.signedVarint(&delta)) {
+                return false;
+            }
+            auto it = sites.find(id);
+            if (it == sites.end() || level >= NUM_LOG_LEVELS) {
+                return false;
+            }
+            const Site& site = it->second;
+            vector<Arg> args(site.types.size());
+            for (size_t i = 0; i < site.types.size(); i++) {
+                Arg& arg = args[i];
+                arg.type = site.types[i];
+                bool ok;
+                if (arg.type == 's') {
+                    ok = reader.str(&arg.s);
+                } else if (arg.type == 'd') {
+                    ok = reader.raw(&arg.bits, sizeof(arg.bits));
+                } else if (arg.type == 'i') {
+                    int64_t value;
+                    ok = reader.signedVarint(&value);
+                    arg.bits = static_cast<uint64_t>(value);
+                } else {
+                    ok = reader.varint(&arg.bits);
+                }
+                if (!ok) {
+                    return false;
+                }
+            }
+
+            // Convert the timestamp to wall-clock time.
+            timestamp += delta;
+            int64_t offset = static_cast<int64_t>(1e09 * static_cast<double>(
+                    static_cast<int64_t>(timestamp - header.baseTsc))
+                    / header.cyclesPerSecond);
+            int64_t total = static_cast<int64_t>(header.baseNanoseconds)
+                    + offset;
+            seconds = header.baseSeconds + total / 1000000000;
+            nanoseconds = total % 1000000000;
+            if (total < 0 && nanoseconds != 0) {
+                seconds--;
+                nanoseconds += 1000000000;
+            }
+
+            const char* file = site.file.c_str();
+            const char* lastSlash = strrchr(file, '/');
+            if (lastSlash != NULL) {
+                file = lastSlash + 1;
+            }
+            appendFormatted(output, "%010lu.%09lu %s:%lu in %s %s[%lu]: ",
+                    seconds, nanoseconds, file, site.line,
+                    site.function.c_str(), levelNames[level], threadId);
+            formatMessage(site.format, args, output);
+        } else if (type == LOST_ENTRY) {
+            uint64_t threadId, count;
+            if (!reader.varint(&threadId) || !reader.varint(&count)) {
+                return false;
+            }
+            appendFormatted(output, "%010lu.%09lu BinaryLog: %lu messages "
+                    "from thread %lu were discarded because its staging "
+                    "buffer was full\n", seconds, nanoseconds, count,
+                    threadId);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Wait until all of the messages logged so far have been written to the
+ * binary log file. Returns immediately if the binary log isn't open.
+ */
+void
+BinaryLog::sync()
+{
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (writerThread == NULL) {
+                return;
+            }
+            bool drained = true;
+            foreach (StagingBuffer* buffer, buffers) {
+                if (buffer->consumed.load() != buffer->produced.load()) {
+                    drained = false;
+                    break;
+                }
+            }
+            if (drained) {
+                break;
+            }
+        }
+        usleep(100);
+    }
+
+    // The writer thread may still be holding the last records in memory;
+    // once it finishes its current pass they will have been written.
+    uint64_t passes = writerPasses.load();
+    while (writerPasses.load() == passes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (writerThread == NULL) {
+                // close drained the buffers.
+                return;
+            }
+        }
+        usleep(100);
+    }
+}
+
+/**
+ * Called by log once it has copied all of the arguments for a record:
+ * makes the record available to the writer thread.
+ *
+ * \param length
+ *      Total length of the record (the same value passed to reserve).
+ */
+void
+BinaryLog::commit(uint32_t length)
+{
+    StagingBuffer* buffer = threadBuffer;
+    buffer->produced.store(buffer->produced.load(std::memory_order_relaxed)
+            + length, std::memory_order_release);
+}
+
+/**
+ * Scan a format string to find the "%.*s" conversions, whose string
+ * arguments must not be read past the precision given by the preceding
+ * argument (such strings often aren't null-terminated).
+ *
+ * \param format
+ *      The printf-style format string for a call site.
+ * \return
+ *      A bit mask in which bit i is set if argument i is a string whose
+ *      precision is argument i-1 (see CallSite::boundedStrings).
+ */
+uint64_t
+BinaryLog::findBoundedStrings(const char* format)
+{
+    uint64_t bounded = 0;
+    uint32_t nextArg = 0;
+    const char* p = format;
+    while (*p != 0) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        p++;
+        while (*p != 0 && strchr("-+ #0", *p) != NULL) {
+            p++;
+        }
+        bool starPrecision = false;
+        for (int part = 0; part < 2; part++) {
+            if (part == 1) {
+                if (*p != '.') {
+                    break;
+                }
+                p++;
+            }
+            if (*p == '*') {
+                starPrecision = (part == 1);
+                nextArg++;
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        while (*p != 0 && strchr("hlLqjzt", *p) != NULL) {
+            p++;
+        }
+        if (*p == 0) {
+            break;
+        }
+        if (*p == 's' && starPrecision && nextArg < 64) {
+            bounded |= 1UL << nextArg;
+        }
+        nextArg++;
+        p++;
+    }
+    return bounded;
+}
+
+/**
+ * Called by log the first time a call site is used: assigns an identifier
+ * for the site.
+ *
+ * \param site
+ *      The call site.
+ * \param types
+ *      The types of the call site's arguments (see typeCode).
+ * \return
+ *      The identifier for the site.
+ */
+uint32_t
+BinaryLog::registerSite(CallSite* site, const char* types)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t id = site->id.load();
+    if (id != 0) {
+        // Another thread registered the site while we were waiting.
+        return id;
+    }
+    site->boundedStrings = findBoundedStrings(site->format);
+    sites.push_back(site);
+    siteTypes.push_back(types);
+    id = downCast<uint32_t>(sites.size());
+    site->id.store(id, std::memory_order_release);
+    return id;
+}
+
+/**
+ * Called by log to allocate space for a record in the current thread's
+ * staging buffer.
+ *
+ * \param id
+ *      Identifier for the record's call site.
+ * \param level
+ *      LogLevel for the record.
+ * \param length
+ *      Total bytes needed for the record, including its header.
+ * \return
+ *      Pointer to the space for the record's arguments (its header has
+ *      already been filled in), or NULL if the buffer is full, in which
+ *      case the message is discarded.
+ */
+char*
+BinaryLog::reserve(uint32_t id, int level, uint32_t length)
+{
+    StagingBuffer* buffer = threadBuffer;
+    if (expect_false(buffer == NULL)) {
+        buffer = new StagingBuffer(ThreadId::get());
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!threadKeyCreated) {
+            pthread_key_create(&threadKey, threadExited);
+            threadKeyCreated = true;
+        }
+        pthread_setspecific(threadKey, buffer);
+        buffers.push_back(buffer);
+        threadBuffer = buffer;
+    }
+
+    uint64_t head = buffer->produced.load(std::memory_order_relaxed);
+    uint32_t offset = downCast<uint32_t>(head % STAGING_BUFFER_SIZE);
+    uint32_t padding = 0;
+    if (offset + length > STAGING_BUFFER_SIZE) {
+        padding = STAGING_BUFFER_SIZE - offset;
+    }
+    if ((length > STAGING_BUFFER_SIZE/2) || (head + padding + length
+            - buffer->consumed.load(std::memory_order_acquire)
+            > STAGING_BUFFER_SIZE)) {
+        buffer->lost.store(buffer->lost.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        return NULL;
+    }
+    if (padding > 0) {
+        if (padding >= sizeof(RecordHeader)) {
+            RecordHeader* pad = reinterpret_cast<RecordHeader*>(
+                    &buffer->data[offset]);
+            pad->id = 0;
+            pad->length = padding;
+        }
+        buffer->produced.store(head + padding, std::memory_order_release);
+        offset = 0;
+    }
+
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(
+            &buffer->data[offset]);
+    header->id = id;
+    header->length = length;
+    header->timestamp = Cycles::rdtsc();
+    header->level = level;
+    return reinterpret_cast<char*>(header + 1);
+}
+
+/**
+ * Invoked when a thread that has a staging buffer exits. If the binary log
+ * is open, the buffer is marked so that the writer frees it once it has
+ * been drained; otherwise it is freed now (anything left in it was logged
+ * after the log was closed).
+ *
+ * \param buffer
+ *      The thread's StagingBuffer.
+ */
+void
+BinaryLog::threadExited(void* buffer)
+{
+    StagingBuffer* stagingBuffer = static_cast<StagingBuffer*>(buffer);
+
+    // If this thread logs again (e.g., from another thread-specific
+    // destructor), it will get a new buffer.
+    threadBuffer = NULL;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (writerThread != NULL) {
+        stagingBuffer->exited = true;
+        return;
+    }
+    buffers.erase(std::find(buffers.begin(), buffers.end(), stagingBuffer));
+    delete stagingBuffer;
+}
+
+/**
+ * The main program for the writer thread: repeatedly drains all of the
+ * staging buffers until told to exit.
+ *
+ * \param writer
+ *      Keeps track of what has been written so far.
+ */
+void
+BinaryLog::writerMain(Writer* writer)
+{
+    while (true) {
+        bool exiting = writerExit.load();
+        if (!writer->drain()) {
+            if (exiting) {
+                break;
+            }
+            usleep(POLL_MICROS);
+        }
+    }
+}
+
+/**
+ * Copy information for newly registered call sites from the shared
+ * variables and add it to the output.
+ */
+void
+BinaryLog::Writer::refreshSites()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = types.size(); i < sites.size(); i++) {
+        CallSite* site = sites[i];
+        output.push_back(SITE_ENTRY);
+        appendVarint(&output, i + 1);
+        appendVarint(&output, site->line);
+        appendVarint(&output, site->module);
+        appendString(&output, site->file, strlen(site->file));
+        appendString(&output, site->function, strlen(site->function));
+        appendString(&output, site->format, strlen(site->format));
+        appendString(&output, siteTypes[i].data(), siteTypes[i].size());
+        types.push_back(siteTypes[i]);
+    }
+}
+
+/**
+ * Make one pass over all of the staging buffers: compress the records in
+ * them and write the results to the log file. Buffers whose threads have
+ * exited are freed once they have been drained.
+ *
+ * \return
+ *      True means at least one record was found.
+ */
+bool
+BinaryLog::Writer::drain()
+{
+    bool foundRecords = false;
+    vector<StagingBuffer*> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentBuffers = buffers;
+    }
+    refreshSites();
+    foreach (StagingBuffer* buffer, currentBuffers) {
+        uint64_t tail = buffer->consumed.load(std::memory_order_relaxed);
+        uint64_t head = buffer->produced.load(std::memory_order_acquire);
+        while (tail < head) {
+            uint32_t offset = downCast<uint32_t>(tail % STAGING_BUFFER_SIZE);
+            if (STAGING_BUFFER_SIZE - offset < sizeof(RecordHeader)) {
+                tail += STAGING_BUFFER_SIZE - offset;
+                continue;
+            }
+            const RecordHeader* header =
+                    reinterpret_cast<const RecordHeader*>(
+                    &buffer->data[offset]);
+            tail += header->length;
+            if (header->id == 0) {
+                continue;
+            }
+            foundRecords = true;
+            if (header->id > types.size()) {
+                refreshSites();
+            }
+            output.push_back(RECORD_ENTRY);
+            appendVarint(&output, header->id);
+            appendVarint(&output, header->level);
+            appendVarint(&output, buffer->threadId);
+            appendSigned(&output, static_cast<int64_t>(
+                    header->timestamp - lastTimestamp));
+            lastTimestamp = header->timestamp;
+
+            const char* p = reinterpret_cast<const char*>(header + 1);
+            foreach (char type, types[header->id - 1]) {
+                if (type == 's') {
+                    uint32_t length;
+                    memcpy(&length, p, sizeof(length));
+                    appendString(&output, p + sizeof(length), length);
+                    p += sizeof(length) + length;
+                    continue;
+                }
+                uint64_t bits;
+                memcpy(&bits, p, sizeof(bits));
+                p += sizeof(bits);
+                if (type == 'd') {
+                    output.append(reinterpret_cast<char*>(&bits),
+                            sizeof(bits));
+                } else if (type == 'i') {
+                    appendSigned(&output, static_cast<int64_t>(bits));
+                } else {
+                    appendVarint(&output, bits);
+                }
+            }
+            if (output.size() >= WRITE_THRESHOLD) {
+                writeAll(fd, output.data(), output.size());
+                output.clear();
+            }
+        }
+        buffer->consumed.store(tail, std::memory_order_release);
+
+        uint64_t lost = buffer->lost.load(std::memory_order_relaxed);
+        if (lost != buffer->lostReported) {
+            output.push_back(LOST_ENTRY);
+            appendVarint(&output, buffer->threadId);
+            appendVarint(&output, lost - buffer->lostReported);
+            buffer->lostReported = lost;
+        }
+
+        // Once its thread has exited, nothing more is added to a buffer.
+        if (buffer->exited && tail == buffer->produced.load()) {
+            finished.push_back(buffer);
+        }
+    }
+    if (!output.empty()) {
+        writeAll(fd, output.data(), output.size());
+        output.clear();
+    }
+    if (!finished.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        foreach (StagingBuffer* buffer, finished) {
+            buffers.erase(std::find(buffers.begin(), buffers.end(),
+                    buffer));
+            delete buffer;
+        }
+    }
+    writerPasses++;
+    return foundRecords;
+}
+
+} // namespace RAMCloud
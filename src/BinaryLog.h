@@ -0,0 +1,358 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_BINARYLOG_H
+#define RAMCLOUD_BINARYLOG_H
+
+#include <pthread.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "Minimal.h"
+
+namespace RAMCloud {
+
+/**
+ * This class implements an optional binary logging mode for RAMCLOUD_LOG,
+ * in the style of NanoLog. When binary logging is enabled, a log call does
+ * not format its message: it copies the arguments (but not the format
+ * string) into a staging buffer owned by the calling thread, which takes a
+ * few tens of nanoseconds. The static information about each call site
+ * (file, line, function, and format string) is recorded once, the first
+ * time the call site is used. A background thread drains the staging
+ * buffers, compresses the records, and writes them to a log file; the
+ * logDecompressor program turns that file back into text in the same
+ * format produced by Logger.
+ *
+ * Binary logging is meant for hot paths where the cost of formatting
+ * messages would perturb measurements. If a thread generates messages
+ * faster than the background thread can write them, its staging buffer
+ * fills and messages are dropped (the number dropped is recorded in the
+ * log), rather than stalling the thread. A thread's staging buffer is
+ * freed once the thread has exited and the buffer has been drained.
+ */
+class BinaryLog {
+  PUBLIC:
+    /**
+     * Static information about one RAMCLOUD_LOG call site. RAMCLOUD_LOG
+     * allocates one of these as a static variable at each call site, so
+     * this information only needs to be written to the log once.
+     */
+    struct CallSite {
+        const char* file;         // __FILE__ at the call site.
+        int line;                 // __LINE__ at the call site.
+        const char* function;     // __func__ at the call site.
+        const char* format;       // printf-style format for the message.
+        int module;               // LogModule for the message.
+        std::atomic<uint32_t> id; // Identifies this call site in the log.
+                                  // 0 means the site hasn't been used yet.
+        uint64_t boundedStrings;  // Bit i is set if argument i is a string
+                                  // whose precision is given by argument
+                                  // i-1 ("%.*s"). Set when id is assigned.
+    };
+
+    /**
+     * Add a message to the binary log.
+     *
+     * \param site
+     *      Describes the RAMCLOUD_LOG invocation that generated the message.
+     * \param level
+     *      The LogLevel of the message.
+     * \param args
+     *      Arguments for the format string in \a site. Strings are copied
+     *      (up to MAX_STRING_LENGTH bytes, or fewer if the format gives a
+     *      "*" precision); all other arguments must be numbers, enums, or
+     *      pointers.
+     */
+    template<typename... Args>
+    static inline void
+    log(CallSite* site, int level, Args... args)
+    {
+        uint32_t id = site->id.load(std::memory_order_acquire);
+        if (expect_false(id == 0)) {
+            const char types[] = {typeCode<Args>()..., 0};
+            id = registerSite(site, types);
+        }
+        uint64_t bounded = site->boundedStrings;
+        uint32_t length = sizeof32(RecordHeader)
+                + argsLength(bounded, MAX_STRING_LENGTH, args...);
+        char* p = reserve(id, level, length);
+        if (p == NULL) {
+            return;
+        }
+        encodeArgs(p, bounded, MAX_STRING_LENGTH, args...);
+        commit(length);
+    }
+
+    static void close();
+    static bool decompress(const string& input, string* output);
+    static void open(const char* path);
+    static void sync();
+
+    /// True means RAMCLOUD_LOG messages go to the binary log rather than
+    /// the text log. Set by open and cleared by close; read by every
+    /// RAMCLOUD_LOG invocation, in any thread.
+    static std::atomic<bool> enabled;
+
+    /// Longer string arguments are truncated to this many bytes.
+    static const uint32_t MAX_STRING_LENGTH = 1000;
+
+  PRIVATE:
+    /**
+     * The header for each record in a staging buffer. It is followed by
+     * the record's arguments, in order: numbers take 8 bytes each, and
+     * strings take a 4-byte length followed by the characters.
+     */
+    struct RecordHeader {
+        uint32_t id;              // Call site that generated the record; 0
+                                  // means this is padding to be skipped.
+        uint32_t length;          // Total bytes in the record, including
+                                  // this header.
+        uint64_t timestamp;       // Cycles::rdtsc when the record was made.
+        uint32_t level;           // LogLevel for the message.
+    } __attribute__((packed));
+
+    /**
+     * Return a character describing how an argument type is stored in the
+     * log: 's' for strings, 'd' for floating point, 'p' for pointers, and
+     * 'i' or 'u' for signed or unsigned integers.
+     */
+    template<typename T>
+    static constexpr char
+    typeCode()
+    {
+        return (std::is_same<T, char*>::value
+                        || std::is_same<T, const char*>::value) ? 's'
+                : std::is_floating_point<T>::value ? 'd'
+                : std::is_pointer<T>::value ? 'p'
+                : (std::is_signed<T>::value || std::is_enum<T>::value) ? 'i'
+                : 'u';
+    }
+
+    /**
+     * Return the number of bytes occupied by a string argument. No more
+     * than \a limit bytes of \a s are examined, so \a s need not be
+     * null-terminated if the format gave it a precision.
+     */
+    static inline uint32_t
+    stringLength(const char* s, uint32_t limit)
+    {
+        if (s == NULL) {
+            s = "(null)";
+        }
+        return static_cast<uint32_t>(strnlen(s, limit));
+    }
+
+    /**
+     * Return the maximum number of bytes to copy from a string argument
+     * whose precision ("%.*s") is given by \a arg; negative precisions
+     * are ignored, as in printf.
+     */
+    template<typename T>
+    static inline uint32_t
+    precisionLimit(T arg, typename std::enable_if<
+            std::is_integral<T>::value>::type* = 0)
+    {
+        int64_t precision = static_cast<int64_t>(arg);
+        if (precision < 0 || precision > MAX_STRING_LENGTH) {
+            return MAX_STRING_LENGTH;
+        }
+        return static_cast<uint32_t>(precision);
+    }
+
+    template<typename T>
+    static inline uint32_t
+    precisionLimit(T arg, typename std::enable_if<
+            !std::is_integral<T>::value>::type* = 0)
+    {
+        return MAX_STRING_LENGTH;
+    }
+
+    static inline uint32_t
+    argLength(const char* s, uint32_t limit)
+    {
+        return sizeof32(uint32_t) + stringLength(s, limit);
+    }
+
+    static inline uint32_t
+    argLength(char* s, uint32_t limit)
+    {
+        return sizeof32(uint32_t) + stringLength(s, limit);
+    }
+
+    template<typename T>
+    static inline uint32_t
+    argLength(T arg, uint32_t limit)
+    {
+        return sizeof32(uint64_t);
+    }
+
+    /**
+     * Return the number of bytes needed to store a list of arguments in
+     * a staging buffer.
+     *
+     * \param bounded
+     *      CallSite::boundedStrings for the arguments, shifted so that the
+     *      low-order bit corresponds to the first argument.
+     * \param limit
+     *      Maximum bytes to copy for the first argument, if it's a string
+     *      bounded by the preceding argument.
+     */
+    static inline uint32_t
+    argsLength(uint64_t bounded, uint32_t limit)
+    {
+        return 0;
+    }
+
+    template<typename T, typename... Rest>
+    static inline uint32_t
+    argsLength(uint64_t bounded, uint32_t limit, T arg, Rest... rest)
+    {
+        return argLength(arg, (bounded & 1) ? limit : MAX_STRING_LENGTH)
+                + argsLength(bounded >> 1, precisionLimit(arg), rest...);
+    }
+
+    /**
+     * Return the 64-bit representation of a numeric argument, as stored in
+     * a staging buffer.
+     */
+    template<typename T>
+    static inline uint64_t
+    toBits(T value, typename std::enable_if<
+            std::is_floating_point<T>::value>::type* = 0)
+    {
+        double d = value;
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        return bits;
+    }
+
+    template<typename T>
+    static inline uint64_t
+    toBits(T value, typename std::enable_if<
+            std::is_pointer<T>::value>::type* = 0)
+    {
+        return reinterpret_cast<uintptr_t>(value);
+    }
+
+    template<typename T>
+    static inline uint64_t
+    toBits(T value, typename std::enable_if<
+            std::is_integral<T>::value || std::is_enum<T>::value>::type* = 0)
+    {
+        return static_cast<uint64_t>(static_cast<int64_t>(value));
+    }
+
+    static inline void
+    encodeArg(char*& p, const char* s, uint32_t limit)
+    {
+        uint32_t length = stringLength(s, limit);
+        memcpy(p, &length, sizeof(length));
+        memcpy(p + sizeof(length), (s == NULL) ? "(null)" : s, length);
+        p += sizeof(length) + length;
+    }
+
+    static inline void
+    encodeArg(char*& p, char* s, uint32_t limit)
+    {
+        encodeArg(p, static_cast<const char*>(s), limit);
+    }
+
+    template<typename T>
+    static inline void
+    encodeArg(char*& p, T value, uint32_t limit)
+    {
+        uint64_t bits = toBits(value);
+        memcpy(p, &bits, sizeof(bits));
+        p += sizeof(bits);
+    }
+
+    /**
+     * Copy a list of arguments into a staging buffer. The \a bounded and
+     * \a limit arguments are the same as for argsLength.
+     */
+    static inline void
+    encodeArgs(char* p, uint64_t bounded, uint32_t limit)
+    {
+    }
+
+    template<typename T, typename... Rest>
+    static inline void
+    encodeArgs(char* p, uint64_t bounded, uint32_t limit, T arg,
+            Rest... rest)
+    {
+        encodeArg(p, arg, (bounded & 1) ? limit : MAX_STRING_LENGTH);
+        encodeArgs(p, bounded >> 1, precisionLimit(arg), rest...);
+    }
+
+    class StagingBuffer;
+    class Writer;
+    static void commit(uint32_t length);
+    static uint64_t findBoundedStrings(const char* format);
+    static uint32_t registerSite(CallSite* site, const char* types);
+    static char* reserve(uint32_t id, int level, uint32_t length);
+    static void threadExited(void* buffer);
+    static void writerMain(Writer* writer);
+
+    /// Protects all of the variables below except threadBuffer, writer,
+    /// and writerPasses.
+    static std::mutex mutex;
+
+    /// Every call site that has been used; entry i has id i+1.
+    static vector<CallSite*> sites;
+
+    /// Entry i describes the argument types for sites[i] (see typeCode).
+    static vector<string> siteTypes;
+
+    /// Staging buffers for all threads that have logged, except those that
+    /// have exited and whose buffers have been drained (see threadExited).
+    static vector<StagingBuffer*> buffers;
+
+    /// The staging buffer for the current thread (NULL means the thread
+    /// hasn't logged anything yet).
+    static __thread StagingBuffer* threadBuffer;
+
+    /// Associated with each thread's staging buffer, so that threadExited
+    /// is invoked when the thread exits.
+    static pthread_key_t threadKey;
+
+    /// True means threadKey has been created.
+    static bool threadKeyCreated;
+
+    /// The thread that drains staging buffers and writes the log file;
+    /// NULL means the binary log isn't open. It remains set until close
+    /// has finished draining the buffers.
+    static std::thread* writerThread;
+
+    /// State used to drain the staging buffers; used by the writer thread,
+    /// then by close for a final pass. NULL if the binary log isn't open.
+    static Writer* writer;
+
+    /// File descriptor for the log file, or -1 if it isn't open.
+    static int fd;
+
+    /// Set to tell the writer thread to drain all buffers and exit.
+    static std::atomic<bool> writerExit;
+
+    /// Number of times the writer thread has finished a pass over all of
+    /// the staging buffers and written the results; used by sync.
+    static std::atomic<uint64_t> writerPasses;
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_BINARYLOG_H
@@ -0,0 +1,236 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <thread>
+
+#include "TestUtil.h"
+
+#include "BinaryLog.h"
+
+namespace RAMCloud {
+
+class BinaryLogTest : public ::testing::Test {
+  public:
+    char fileName[100];
+
+    BinaryLogTest()
+        : fileName()
+    {
+        strncpy(fileName, "/tmp/ramcloud-binarylog-test-delete-this-XXXXXX",
+                sizeof(fileName));
+        int fd = mkstemp(fileName);
+        ::close(fd);
+        BinaryLog::open(fileName);
+    }
+
+    ~BinaryLogTest()
+    {
+        BinaryLog::close();
+        unlink(fileName);
+    }
+
+    // Return the number of staging buffers.
+    size_t
+    numBuffers()
+    {
+        std::lock_guard<std::mutex> lock(BinaryLog::mutex);
+        return BinaryLog::buffers.size();
+    }
+
+    // Close the binary log and return its text form.
+    string
+    readLog()
+    {
+        BinaryLog::close();
+        string output;
+        EXPECT_TRUE(BinaryLog::decompress(TestUtil::readFile(fileName),
+                &output));
+        return output;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(BinaryLogTest);
+};
+
+TEST_F(BinaryLogTest, log_basics) {
+    static BinaryLog::CallSite site = {"src/Foo.cc", 42, "bar",
+            "value %d, name %s\n", 0, {0}, 0};
+    BinaryLog::log(&site, NOTICE, 5, "abc");
+    BinaryLog::log(&site, ERROR, -6, "xyz");
+    EXPECT_NE(0u, site.id.load());
+    EXPECT_TRUE(TestUtil::matchesPosixRegex(
+            "^[0-9]{10}\\.[0-9]{9} Foo.cc:42 in bar NOTICE\\[[0-9]+\\]: "
+            "value 5, name abc\n"
+            "[0-9]{10}\\.[0-9]{9} Foo.cc:42 in bar ERROR\\[[0-9]+\\]: "
+            "value -6, name xyz\n$", readLog()));
+}
+
+TEST_F(BinaryLogTest, log_conversions) {
+    static BinaryLog::CallSite site = {"Foo.cc", 1, "bar",
+            "%5d|%-4s|%lu|%x|%.2f|%p|%*d|%%|%c|%u\n", 0, {0}, 0};
+    BinaryLog::log(&site, NOTICE, -7, "ab", 123456789012UL, 255, 3.14159,
+            reinterpret_cast<void*>(0x1234), 4, 9, 'z', -1);
+    string output = readLog();
+    EXPECT_EQ("   -7|ab  |123456789012|ff|3.14|0x1234|   9|%|z|4294967295\n",
+            output.substr(output.find(": ") + 2));
+}
+
+TEST_F(BinaryLogTest, log_strings) {
+    static BinaryLog::CallSite site = {"Foo.cc", 1, "bar", "%s %s\n", 0,
+            {0}, 0};
+    string longString(BinaryLog::MAX_STRING_LENGTH + 50, 'x');
+    char* nullString = NULL;
+    BinaryLog::log(&site, NOTICE, nullString, longString.c_str());
+    string output = readLog();
+    EXPECT_EQ("(null) " + string(BinaryLog::MAX_STRING_LENGTH, 'x') + "\n",
+            output.substr(output.find(": ") + 2));
+}
+
+TEST_F(BinaryLogTest, log_stringPrecision) {
+    static BinaryLog::CallSite site = {"Foo.cc", 1, "bar",
+            "%.*s|%.*s|%s\n", 0, {0}, 0};
+    char buffer[] = {'a', 'b', 'c', 'X', 0};
+    BinaryLog::log(&site, NOTICE, 3, buffer, -1, "def", "ghi");
+    string output = readLog();
+    EXPECT_EQ("abc|def|ghi\n", output.substr(output.find(": ") + 2));
+
+    // Only the bytes within the precision are examined or copied.
+    uint64_t bounded = site.boundedStrings;
+    EXPECT_EQ(8u + 4u + 3u, BinaryLog::argsLength(bounded,
+            BinaryLog::MAX_STRING_LENGTH, 3, buffer));
+    EXPECT_EQ(8u + 4u + 4u, BinaryLog::argsLength(bounded,
+            BinaryLog::MAX_STRING_LENGTH, -1, buffer));
+    EXPECT_EQ(8u + 4u + 4u, BinaryLog::argsLength(0,
+            BinaryLog::MAX_STRING_LENGTH, 3, buffer));
+}
+
+TEST_F(BinaryLogTest, findBoundedStrings) {
+    EXPECT_EQ(0UL, BinaryLog::findBoundedStrings("%s %d %.5s %*s"));
+    EXPECT_EQ(2UL, BinaryLog::findBoundedStrings("%.*s"));
+    EXPECT_EQ(0x108UL, BinaryLog::findBoundedStrings(
+            "%% %d %-*.*s %*.*lu %.*s"));
+}
+
+TEST_F(BinaryLogTest, logMacro) {
+    RAMCLOUD_LOG(WARNING, "macro message %d", 99);
+    EXPECT_TRUE(TestUtil::matchesPosixRegex(
+            "BinaryLogTest.cc:[0-9]+ in TestBody WARNING\\[[0-9]+\\]: "
+            "macro message 99\n$", readLog()));
+}
+
+TEST_F(BinaryLogTest, sync) {
+    static BinaryLog::CallSite site = {"Foo.cc", 1, "bar", "sync %d\n", 0,
+            {0}, 0};
+    BinaryLog::log(&site, NOTICE, 1);
+    BinaryLog::sync();
+    string output;
+    EXPECT_TRUE(BinaryLog::decompress(TestUtil::readFile(fileName),
+            &output));
+    EXPECT_NE(string::npos, output.find("sync 1\n"));
+}
+
+static BinaryLog::CallSite threadSite = {"Foo.cc", 1, "bar", "thread %d\n",
+        0, {0}, 0};
+
+static void
+logThread(int value, std::atomic<bool>* release)
+{
+    BinaryLog::log(&threadSite, NOTICE, value);
+    while (release != NULL && !*release) {
+        usleep(100);
+    }
+}
+
+TEST_F(BinaryLogTest, threadExited_open) {
+    size_t initialBuffers = numBuffers();
+    std::thread thread(logThread, 7, static_cast<std::atomic<bool>*>(NULL));
+    thread.join();
+
+    // The writer frees the buffer once it has been drained.
+    for (int i = 0; i < 1000 && numBuffers() != initialBuffers; i++) {
+        usleep(1000);
+    }
+    EXPECT_EQ(initialBuffers, numBuffers());
+    EXPECT_NE(string::npos, readLog().find("thread 7\n"));
+}
+
+TEST_F(BinaryLogTest, threadExited_closed) {
+    size_t initialBuffers = numBuffers();
+    std::atomic<bool> release(false);
+    std::thread thread(logThread, 8, &release);
+    for (int i = 0; i < 1000 && numBuffers() == initialBuffers; i++) {
+        usleep(1000);
+    }
+    EXPECT_EQ(initialBuffers + 1, numBuffers());
+    EXPECT_NE(string::npos, readLog().find("thread 8\n"));
+
+    // Once the log is closed, the buffer is freed when its thread exits.
+    EXPECT_EQ(initialBuffers + 1, numBuffers());
+    release = true;
+    thread.join();
+    EXPECT_EQ(initialBuffers, numBuffers());
+}
+
+TEST_F(BinaryLogTest, close_drainsBuffers) {
+    // Simulate a message that was committed after the writer thread's
+    // last pass.
+    BinaryLog::writerExit = true;
+    BinaryLog::writerThread->join();
+    BinaryLog::writerExit = false;
+    delete BinaryLog::writerThread;
+    BinaryLog::writerThread = new std::thread([] {});
+    static BinaryLog::CallSite site = {"Foo.cc", 1, "bar", "late %d\n", 0,
+            {0}, 0};
+    BinaryLog::log(&site, NOTICE, 3);
+    EXPECT_NE(string::npos, readLog().find("late 3\n"));
+}
+
+TEST_F(BinaryLogTest, registerSite) {
+    static BinaryLog::CallSite site1 = {"Foo.cc", 1, "bar", "a\n", 0,
+            {0}, 0};
+    static BinaryLog::CallSite site2 = {"Foo.cc", 2, "bar", "b\n", 0,
+            {0}, 0};
+    uint32_t id = BinaryLog::registerSite(&site1, "");
+    EXPECT_EQ(id, site1.id.load());
+    EXPECT_EQ(id, BinaryLog::registerSite(&site1, ""));
+    EXPECT_EQ(id + 1, BinaryLog::registerSite(&site2, "is"));
+    EXPECT_EQ("is", BinaryLog::siteTypes[id]);
+}
+
+TEST_F(BinaryLogTest, decompress_badInput) {
+    static BinaryLog::CallSite site = {"Foo.cc", 1, "bar", "x %d\n", 0,
+            {0}, 0};
+    BinaryLog::log(&site, NOTICE, 1000);
+    BinaryLog::close();
+    string input = TestUtil::readFile(fileName);
+    string output;
+
+    EXPECT_FALSE(BinaryLog::decompress(input.substr(0, input.size() - 1),
+            &output));
+    EXPECT_FALSE(BinaryLog::decompress("not a binary log", &output));
+    input[0] = 'X';
+    EXPECT_FALSE(BinaryLog::decompress(input, &output));
+}
+
+TEST_F(BinaryLogTest, typeCode) {
+    EXPECT_EQ('s', BinaryLog::typeCode<const char*>());
+    EXPECT_EQ('s', BinaryLog::typeCode<char*>());
+    EXPECT_EQ('d', BinaryLog::typeCode<float>());
+    EXPECT_EQ('p', BinaryLog::typeCode<void*>());
+    EXPECT_EQ('i', BinaryLog::typeCode<int>());
+    EXPECT_EQ('i', BinaryLog::typeCode<LogLevel>());
+    EXPECT_EQ('u', BinaryLog::typeCode<uint64_t>());
+}
+
+}  // namespace RAMCloud
@@ -224,6 +224,9 @@ CleanableSegmentManager::update(const SpinLock::Guard& guard)
         const LogEntryType objType = LOG_ENTRY_TYPE_OBJ;
         liveObjectBytes += segment.entryLengths[objType] -
                            segment.deadEntryLengths[objType];
+        const LogEntryType compType = LOG_ENTRY_TYPE_OBJCOMP;
+        liveObjectBytes += segment.entryLengths[compType] -
+                           segment.deadEntryLengths[compType];
 
         const LogEntryType tombType = LOG_ENTRY_TYPE_OBJTOMB;
         undeadTombstoneBytes += segment.entryLengths[tombType] -
@@ -246,6 +249,8 @@ CleanableSegmentManager::update(const SpinLock::Guard& guard)
 
         liveObjectBytes += segment->entryLengths[LOG_ENTRY_TYPE_OBJ] -
                            segment->deadEntryLengths[LOG_ENTRY_TYPE_OBJ];
+        liveObjectBytes += segment->entryLengths[LOG_ENTRY_TYPE_OBJCOMP] -
+                           segment->deadEntryLengths[LOG_ENTRY_TYPE_OBJCOMP];
         undeadTombstoneBytes += segment->entryLengths[LOG_ENTRY_TYPE_OBJTOMB];
     }
 
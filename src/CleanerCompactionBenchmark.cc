@@ -74,7 +74,8 @@ class CleanerCompactionBenchmark {
                                           &masterTableMetadata,
                                           &unackedRpcResults,
                                           &transactionManager,
-                                          &txRecoveryManager);
+                                          &txRecoveryManager,
+                                          NULL);
         unackedRpcResults.resetFreer(objectManager);
     }
 
@@ -42,7 +42,12 @@
 #include <boost/program_options.hpp>
 #include <boost/version.hpp>
 #include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <unordered_set>
 namespace po = boost::program_options;
 
@@ -54,6 +59,8 @@ namespace po = boost::program_options;
 #include "Cycles.h"
 #include "PerfStats.h"
 #include "IndexLookup.h"
+#include "LatencyHistogram.h"
+#include "MultiRead.h"
 #include "RamCloud.h"
 #include "Util.h"
 #include "TimeTrace.h"
@@ -123,6 +130,46 @@ static int targetOps;
 // the server span of a transaction.
 static int txSpan;
 
+// Value of the "--rate" command-line option: used by open-loop tests to
+// specify the average number of operations per second to issue.
+static double openLoopRate;
+
+// Value of the "--openLoopOp" command-line option: used by open-loop tests
+// to specify the operation to issue (read, write, multiRead, transaction).
+static string openLoopOp;     // NOLINT
+
+// Value of the "--maxOutstanding" command-line option: used by open-loop
+// tests to limit the number of requests that may be outstanding at once.
+static int maxOutstanding;
+
+// Value of the "--arrivalTrace" command-line option: used by open-loop
+// tests to replay request arrival times from a file instead of generating
+// them randomly. Empty means the option wasn't specified.
+static string arrivalTrace;   // NOLINT
+
+// Value of the "--recordCount" command-line option: used by the ycsb test
+// to specify the number of records to load before running the workload.
+static int recordCount;
+
+// Values of the "--fieldCount" and "--fieldLength" command-line options:
+// used by the ycsb test to specify the number of fields in each record
+// and the size of each field, in bytes.
+static int fieldCount;
+static int fieldLength;
+
+// Value of the "--requestDistribution" command-line option: used by the
+// ycsb test to override the workload's distribution for choosing keys
+// (uniform, zipfian, or latest). Empty means use the workload's default.
+static string requestDistribution;    // NOLINT
+
+// Value of the "--threads" command-line option: used by the ycsb test to
+// specify the number of threads issuing requests in each client.
+static int numThreads;
+
+// Service locator for the cluster coordinator; used by tests that open
+// additional RamCloud connections.
+static string coordinatorLocator;     // NOLINT
+
 // Identifier for table that is used for test-specific data.
 uint64_t dataTable = -1;
 
@@ -533,6 +580,364 @@ struct VirtualClient {
     DISALLOW_COPY_AND_ASSIGN(VirtualClient);
 };
 
+/**
+ * Generates the times at which an open-loop test issues its requests.
+ * By default requests form a Poisson process with a given average rate
+ * (the intervals between requests are exponentially distributed). If a
+ * trace file is given, the intervals are read from it instead (one per
+ * line, in microseconds) and replayed in order, wrapping around at the end.
+ */
+class ArrivalSchedule {
+  public:
+    /**
+     * Constructor for ArrivalSchedule objects.
+     *
+     * \param rate
+     *      Average number of requests per second; ignored if traceFile
+     *      is non-empty.
+     * \param traceFile
+     *      Name of a file containing inter-arrival times, or an empty
+     *      string to generate Poisson arrivals.
+     */
+    ArrivalSchedule(double rate, const string& traceFile)
+        : cyclesPerRequest(Cycles::perSecond()/rate)
+        , trace()
+        , nextTraceEntry(0)
+    {
+        if (traceFile.empty()) {
+            return;
+        }
+        std::ifstream input(traceFile.c_str());
+        if (!input) {
+            RAMCLOUD_DIE("couldn't open arrival trace '%s'",
+                    traceFile.c_str());
+        }
+        double micros;
+        while (input >> micros) {
+            trace.push_back(Cycles::fromSeconds(micros*1e-06));
+        }
+        if (trace.empty()) {
+            RAMCLOUD_DIE("arrival trace '%s' is empty", traceFile.c_str());
+        }
+    }
+
+    /**
+     * Return the time between one request and the next, in Cycles::rdtsc
+     * ticks.
+     */
+    uint64_t
+    nextInterval()
+    {
+        if (!trace.empty()) {
+            uint64_t result = trace[nextTraceEntry];
+            nextTraceEntry = (nextTraceEntry + 1) % trace.size();
+            return result;
+        }
+
+        // Uniform random number in (0, 1], so the log is always finite.
+        double u = static_cast<double>((generateRandom() >> 11) + 1) /
+                static_cast<double>(1UL << 53);
+        return static_cast<uint64_t>(-log(u)*cyclesPerRequest);
+    }
+
+  private:
+    /// Average time between Poisson arrivals, in rdtsc ticks.
+    double cyclesPerRequest;
+
+    /// Inter-arrival times from the trace file, in rdtsc ticks; empty
+    /// means generate Poisson arrivals.
+    std::vector<uint64_t> trace;
+
+    /// Index in trace of the next interval to return.
+    size_t nextTraceEntry;
+
+    DISALLOW_COPY_AND_ASSIGN(ArrivalSchedule);
+};
+
+/**
+ * Holds the state of one outstanding request in an open-loop test. Each
+ * object is reused for many requests over the course of the test; at most
+ * one of the Tubs is full at any given time.
+ */
+struct OpenLoopRequest {
+    /// Maximum number of objects accessed by one multiRead or transaction.
+    static const int MAX_OBJECTS = 100;
+
+    /// Length of all keys used in open-loop tests.
+    static const uint16_t KEY_LENGTH = 30;
+
+    OpenLoopRequest()
+        : active(false)
+        , measured(false)
+        , intendedStart(0)
+        , read()
+        , write()
+        , multiRead()
+        , transaction()
+        , value()
+        , keys()
+        , objects()
+        , objectPtrs()
+        , values()
+    {}
+
+    /// True means a request is currently outstanding in this slot.
+    bool active;
+
+    /// True means this request's latency should be recorded (false during
+    /// warmup).
+    bool measured;
+
+    /// Cycles::rdtsc time when the request was scheduled to start. Latency
+    /// is measured from this time, not from when the request was actually
+    /// sent, so delays in issuing requests are not hidden.
+    uint64_t intendedStart;
+
+    /// Exactly one of the following is full while the request is active.
+    Tub<ReadRpc> read;
+    Tub<WriteRpc> write;
+    Tub<MultiRead> multiRead;
+    Tub<Transaction> transaction;
+
+    /// Holds the result of a read.
+    Buffer value;
+
+    /// Keys for the objects accessed by the request.
+    char keys[MAX_OBJECTS][KEY_LENGTH];
+
+    /// Used for multiReads: describes each object to read, and holds the
+    /// values returned.
+    MultiReadObject objects[MAX_OBJECTS];
+    MultiReadObject* objectPtrs[MAX_OBJECTS];
+    Tub<ObjectBuffer> values[MAX_OBJECTS];
+
+    DISALLOW_COPY_AND_ASSIGN(OpenLoopRequest);
+};
+
+/**
+ * Describes one of the YCSB core workloads: the fraction of operations of
+ * each type, and the distribution used to choose keys unless overridden
+ * with --requestDistribution. The values are the same as in the workload
+ * files distributed with YCSB.
+ */
+struct YcsbWorkload {
+    const char* name;
+    double readProportion;
+    double updateProportion;
+    double insertProportion;
+    double scanProportion;
+    double readModifyWriteProportion;
+    const char* requestDistribution;
+};
+
+static const YcsbWorkload ycsbWorkloads[] = {
+    {"YCSB-A", 0.50, 0.50, 0.00, 0.00, 0.00, "zipfian"},
+    {"YCSB-B", 0.95, 0.05, 0.00, 0.00, 0.00, "zipfian"},
+    {"YCSB-C", 1.00, 0.00, 0.00, 0.00, 0.00, "zipfian"},
+    {"YCSB-D", 0.95, 0.00, 0.05, 0.00, 0.00, "latest"},
+    {"YCSB-E", 0.00, 0.00, 0.05, 0.95, 0.00, "zipfian"},
+    {"YCSB-F", 0.50, 0.00, 0.00, 0.00, 0.50, "zipfian"},
+};
+
+/// The kinds of operations issued by the ycsb test.
+enum YcsbOp {
+    YCSB_READ,
+    YCSB_UPDATE,
+    YCSB_INSERT,
+    YCSB_SCAN,
+    YCSB_READ_MODIFY_WRITE,
+    YCSB_NUM_OPS
+};
+
+/// Names for each YcsbOp, as printed by YCSB.
+static const char* ycsbOpNames[] = {
+    "READ", "UPDATE", "INSERT", "SCAN", "READ-MODIFY-WRITE"
+};
+
+/**
+ * Statistics gathered by the ycsb test, for one thread or combined across
+ * threads and clients. This is a POD so that slaves can return it to the
+ * master through the control table.
+ */
+struct YcsbStats {
+    /// Latency of each kind of operation, in Cycles::rdtsc ticks.
+    LatencyHistogram latency[YCSB_NUM_OPS];
+
+    /// Sum of all latencies for each kind of operation (rdtsc ticks).
+    uint64_t totalCycles[YCSB_NUM_OPS];
+
+    /// Largest latency for each kind of operation (rdtsc ticks).
+    uint64_t maxCycles[YCSB_NUM_OPS];
+
+    /// Number of reads (including reads in scans and read-modify-writes)
+    /// that found no object.
+    uint64_t notFound;
+
+    /// Operations per second achieved.
+    double throughput;
+
+    /**
+     * Merge the statistics from another thread or client into this object.
+     */
+    void
+    add(const YcsbStats& other)
+    {
+        for (int i = 0; i < YCSB_NUM_OPS; i++) {
+            latency[i].add(other.latency[i]);
+            totalCycles[i] += other.totalCycles[i];
+            maxCycles[i] = std::max(maxCycles[i], other.maxCycles[i]);
+        }
+        notFound += other.notFound;
+        throughput += other.throughput;
+    }
+
+    /**
+     * Record the latency of one operation.
+     */
+    void
+    record(YcsbOp op, uint64_t cycles)
+    {
+        latency[op].record(cycles);
+        totalCycles[op] += cycles;
+        maxCycles[op] = std::max(maxCycles[op], cycles);
+    }
+};
+
+/**
+ * Chooses records for the ycsb test using one of YCSB's request
+ * distributions: "uniform", "zipfian" (popular records are scattered
+ * through the key space, as with YCSB's scrambled zipfian generator), or
+ * "latest" (the most recently inserted records are the most popular).
+ */
+class YcsbKeyChooser {
+  public:
+    /**
+     * Constructor for YcsbKeyChooser objects.
+     *
+     * \param distribution
+     *      Name of the request distribution.
+     * \param recordCount
+     *      Number of records loaded before the test starts; determines the
+     *      shape of the zipfian distribution.
+     */
+    YcsbKeyChooser(const string& distribution, uint64_t recordCount)
+        : uniform(distribution == "uniform")
+        , latest(distribution == "latest")
+        , zipfian()
+    {
+        if (!uniform) {
+            zipfian.construct(recordCount);
+        }
+    }
+
+    /**
+     * Return the index of the next record to access.
+     *
+     * \param numRecords
+     *      Number of records that currently exist; the result is less than
+     *      this.
+     */
+    uint64_t
+    next(uint64_t numRecords)
+    {
+        if (uniform) {
+            return generateRandom() % numRecords;
+        }
+        uint64_t rank = zipfian->nextNumber();
+        if (latest) {
+            return numRecords - 1 - (rank % numRecords);
+        }
+
+        // Scatter popular records with a 64-bit FNV-1a hash of the rank.
+        uint64_t hash = 0xcbf29ce484222325UL;
+        for (int i = 0; i < 8; i++) {
+            hash = (hash ^ ((rank >> (8*i)) & 0xff)) * 0x100000001b3UL;
+        }
+        return hash % numRecords;
+    }
+
+  private:
+    bool uniform;
+    bool latest;
+    Tub<ZipfianGenerator> zipfian;
+
+    DISALLOW_COPY_AND_ASSIGN(YcsbKeyChooser);
+};
+
+/**
+ * Allocates the records inserted by the ycsb test and keeps track of which
+ * of them can safely be read, in the same way as YCSB's
+ * AcknowledgedCounterGenerator: inserts complete out of order, so a record
+ * only becomes visible once it and all of the records allocated before it
+ * have been inserted. This class is thread-safe.
+ */
+class YcsbInsertCounter {
+  public:
+    YcsbInsertCounter()
+        : mutex()
+        , started(0)
+        , acknowledged(0)
+        , finished()
+    {}
+
+    /**
+     * Allocate the next record to insert; returns its index among the
+     * records inserted by this client.
+     */
+    uint64_t
+    start()
+    {
+        std::lock_guard<std::mutex> _(mutex);
+        return started++;
+    }
+
+    /**
+     * Called when an insert started with #start has completed.
+     *
+     * \param insert
+     *      Value returned by the call to #start for the insert.
+     */
+    void
+    finish(uint64_t insert)
+    {
+        std::lock_guard<std::mutex> _(mutex);
+        finished.insert(insert);
+        uint64_t next = acknowledged.load();
+        while (!finished.empty() && (*finished.begin() == next)) {
+            finished.erase(finished.begin());
+            next++;
+        }
+        acknowledged.store(next);
+    }
+
+    /**
+     * Return the number of inserts that have completed with no gaps: all
+     * inserts with indexes less than this have completed.
+     */
+    uint64_t
+    getAcknowledged()
+    {
+        return acknowledged.load();
+    }
+
+  private:
+    /// Protects started and finished.
+    std::mutex mutex;
+
+    /// Number of inserts that have been started.
+    uint64_t started;
+
+    /// See getAcknowledged. Atomic so that it can be read without
+    /// acquiring the mutex.
+    std::atomic<uint64_t> acknowledged;
+
+    /// Inserts that have completed but are not yet counted in
+    /// #acknowledged, because an earlier insert is still in progress.
+    std::set<uint64_t> finished;
+
+    DISALLOW_COPY_AND_ASSIGN(YcsbInsertCounter);
+};
+
 /**
  * Given an integer value, generate a key of a given length
  * that corresponds to that value.
@@ -4916,6 +5321,233 @@ netBandwidth()
             "slowest client");
 }
 
+// This benchmark measures latency under an open-loop load: requests are
+// issued on a fixed schedule (Poisson arrivals at --rate, or the intervals
+// in --arrivalTrace) regardless of how quickly earlier requests complete,
+// with up to --maxOutstanding requests in flight. Each request's latency
+// is measured from the time it was scheduled to start, so if the cluster
+// (or this client) falls behind, the delay shows up in the results rather
+// than silently lowering the offered load ("coordinated omission"). The
+// operation is selected with --openLoopOp; multiRead and transaction
+// operations access --numObjects random objects (transactions only write,
+// since transactional reads block). The latency distribution is printed in
+// the same format as HdrHistogram's percentile output.
+void
+openLoop()
+{
+    if (clientIndex != 0)
+        return;
+
+    enum OpType { READ, WRITE, MULTI_READ, TRANSACTION };
+    OpType opType;
+    if (openLoopOp == "read") {
+        opType = READ;
+    } else if (openLoopOp == "write") {
+        opType = WRITE;
+    } else if (openLoopOp == "multiRead") {
+        opType = MULTI_READ;
+    } else if (openLoopOp == "transaction") {
+        opType = TRANSACTION;
+    } else {
+        RAMCLOUD_LOG(ERROR, "unknown open-loop operation '%s'",
+                openLoopOp.c_str());
+        return;
+    }
+    int size = objectSize;
+    if (size < 0)
+        size = 100;
+    uint16_t keyLength = OpenLoopRequest::KEY_LENGTH;
+    const int numKeys = 100000;
+    int objectsPerOp = std::min(std::max(numObjects, 1),
+            OpenLoopRequest::MAX_OBJECTS);
+    if ((opType == READ) || (opType == WRITE)) {
+        objectsPerOp = 1;
+    }
+    int slots = std::max(maxOutstanding, 1);
+
+    fillTable(dataTable, numKeys, keyLength, size);
+    std::vector<char> writeValue(size, 'x');
+    ArrivalSchedule schedule(openLoopRate, arrivalTrace);
+    std::unique_ptr<OpenLoopRequest[]> requests(new OpenLoopRequest[slots]);
+    LatencyHistogram histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    uint64_t maxLatency = 0;
+
+    // A request counts as late if it couldn't be sent within this long
+    // of its scheduled time (typically because all slots were busy).
+    uint64_t lateThreshold = Cycles::fromMicroseconds(10);
+    int lateStarts = 0;
+
+    int total = warmupCount + count;
+    int issued = 0;
+    int completed = 0;
+    uint64_t nextStart = Cycles::rdtsc();
+    uint64_t measureStart = 0;
+    uint64_t measureEnd = 0;
+    while (completed < total) {
+        cluster->poll();
+        uint64_t now = Cycles::rdtsc();
+
+        // Issue any requests whose time has come, as long as there are
+        // free slots.
+        for (int i = 0; (i < slots) && (issued < total)
+                && (nextStart <= now); i++) {
+            OpenLoopRequest& request = requests[i];
+            if (request.active) {
+                continue;
+            }
+            request.active = true;
+            request.measured = (issued >= warmupCount);
+            request.intendedStart = nextStart;
+            if (request.measured) {
+                if (issued == warmupCount) {
+                    measureStart = nextStart;
+                }
+                if ((now - nextStart) > lateThreshold) {
+                    lateStarts++;
+                }
+            }
+            for (int j = 0; j < objectsPerOp; j++) {
+                makeKey(downCast<int>(generateRandom() % numKeys),
+                        keyLength, request.keys[j]);
+            }
+            switch (opType) {
+                case READ:
+                    request.read.construct(cluster, dataTable,
+                            request.keys[0], keyLength, &request.value);
+                    break;
+                case WRITE:
+                    request.write.construct(cluster, dataTable,
+                            request.keys[0], keyLength, writeValue.data(),
+                            size);
+                    break;
+                case MULTI_READ:
+                    for (int j = 0; j < objectsPerOp; j++) {
+                        request.values[j].destroy();
+                        request.objects[j] = MultiReadObject(dataTable,
+                                request.keys[j], keyLength,
+                                &request.values[j]);
+                        request.objectPtrs[j] = &request.objects[j];
+                    }
+                    request.multiRead.construct(cluster, request.objectPtrs,
+                            objectsPerOp);
+                    break;
+                case TRANSACTION:
+                    request.transaction.construct(cluster);
+                    for (int j = 0; j < objectsPerOp; j++) {
+                        request.transaction->write(dataTable,
+                                request.keys[j], keyLength,
+                                writeValue.data(), size);
+                    }
+                    request.transaction->isCommitReady();
+                    break;
+            }
+            issued++;
+            nextStart += schedule.nextInterval();
+        }
+
+        // Collect any requests that have completed.
+        for (int i = 0; i < slots; i++) {
+            OpenLoopRequest& request = requests[i];
+            if (!request.active) {
+                continue;
+            }
+            switch (opType) {
+                case READ:
+                    if (!request.read->isReady())
+                        continue;
+                    request.read->wait();
+                    request.read.destroy();
+                    break;
+                case WRITE:
+                    if (!request.write->isReady())
+                        continue;
+                    request.write->wait();
+                    request.write.destroy();
+                    break;
+                case MULTI_READ:
+                    if (!request.multiRead->isReady())
+                        continue;
+                    request.multiRead->wait();
+                    request.multiRead.destroy();
+                    break;
+                case TRANSACTION:
+                    if (!request.transaction->isCommitReady())
+                        continue;
+                    request.transaction->commit();
+                    request.transaction.destroy();
+                    break;
+            }
+            uint64_t finish = Cycles::rdtsc();
+            request.active = false;
+            completed++;
+            if (request.measured) {
+                uint64_t latency = finish - request.intendedStart;
+                histogram.record(latency);
+                maxLatency = std::max(maxLatency, latency);
+                measureEnd = finish;
+            }
+        }
+    }
+
+    double elapsed = Cycles::toSeconds(measureEnd - measureStart);
+    double achievedRate = (elapsed > 0) ? count/elapsed : 0;
+    printf("# Open-loop %s latency: %d-byte objects, %d object(s)/op,\n",
+            openLoopOp.c_str(), size, objectsPerOp);
+    if (arrivalTrace.empty()) {
+        printf("# Poisson arrivals at %.0f ops/sec, ", openLoopRate);
+    } else {
+        printf("# arrivals from %s, ", arrivalTrace.c_str());
+    }
+    printf("at most %d outstanding requests.\n", slots);
+    printf("# Latency is measured from each request's scheduled start "
+            "time.\n");
+    printTime("openLoop", Cycles::toSeconds(histogram.getPercentile(50)),
+            "median latency");
+    printTime("openLoop.9", Cycles::toSeconds(histogram.getPercentile(90)),
+            "90% latency");
+    printTime("openLoop.99", Cycles::toSeconds(histogram.getPercentile(99)),
+            "99% latency");
+    printTime("openLoop.999",
+            Cycles::toSeconds(histogram.getPercentile(99.9)),
+            "99.9% latency");
+    printTime("openLoop.9999",
+            Cycles::toSeconds(histogram.getPercentile(99.99)),
+            "99.99% latency");
+    printTime("openLoop.max", Cycles::toSeconds(maxLatency),
+            "maximum latency");
+    printRate("openLoop.rate", achievedRate, "achieved operations/sec");
+    printPercent("openLoop.late", 100.0*lateStarts/count,
+            "requests started > 10us late");
+
+    // Print the full distribution in HdrHistogram's percentile format
+    // (values in microseconds), so it can be plotted with the usual tools.
+    printf("#\n");
+    printf("%12s %14s %10s %14s\n", "Value", "Percentile", "TotalCount",
+            "1/(1-Percentile)");
+    uint64_t totalCount = histogram.totalCount();
+    uint64_t cumulative = 0;
+    for (int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++) {
+        if (histogram.counts[i] == 0) {
+            continue;
+        }
+        cumulative += histogram.counts[i];
+        double fraction = static_cast<double>(cumulative)
+                / static_cast<double>(totalCount);
+        uint64_t upper = (i < LatencyHistogram::NUM_BUCKETS - 1)
+                ? LatencyHistogram::lowerBound(i + 1) : maxLatency;
+        double micros = Cycles::toSeconds(upper)*1e06;
+        if (cumulative < totalCount) {
+            printf("%12.3f %14.12f %10lu %14.2f\n", micros, fraction,
+                    cumulative, 1.0/(1.0 - fraction));
+        } else {
+            printf("%12.3f %14.12f %10lu\n", micros, fraction, cumulative);
+        }
+    }
+    printf("#[Max     = %12.3f, Total count    = %12lu]\n",
+            Cycles::toSeconds(maxLatency)*1e06, totalCount);
+}
+
 // Each client reads a single object from each master.  Good for
 // testing that each host in the cluster can send/receive RPCs
 // from every other host.
@@ -5155,6 +5787,88 @@ readDistWorkload()
     doWorkload(READ_TYPE);
 }
 
+/**
+ * This method contains the core of the "readHotKey" test; it is shared by
+ * the master and slaves. It reads a single object repeatedly for a short
+ * time, then reports the client's throughput.
+ */
+void
+readHotKeyCommon()
+{
+    double ms = 100;
+    uint64_t startTime = Cycles::rdtsc();
+    uint64_t endTime = startTime + Cycles::fromSeconds(ms/1e03);
+    uint64_t readEnd;
+    int count = 0;
+    while (true) {
+        Buffer value;
+        cluster->read(dataTable, "hot", 3, &value);
+        readEnd = Cycles::rdtsc();
+        count++;
+        if (readEnd > endTime)
+            break;
+    }
+    double thruput = count/Cycles::toSeconds(readEnd - startTime);
+    sendMetrics(thruput);
+    if (clientIndex != 0) {
+        RAMCLOUD_LOG(NOTICE, "readHotKey throughput: %.1f reads/sec.",
+                thruput);
+    }
+}
+
+// In this test all of the clients read the same object over and over, in
+// order to measure how well the cluster copes with a single hot key. Run it
+// with the masters' --hotKeyReplicas option set to see how much spreading
+// the object's reads across masters helps.
+void
+readHotKey()
+{
+    if (clientIndex > 0) {
+        // This is a slave: execute commands coming from the master.
+        while (true) {
+            char command[20];
+            getCommand(command, sizeof(command));
+            if (strcmp(command, "run") == 0) {
+                setSlaveState("running");
+                readHotKeyCommon();
+                setSlaveState("idle");
+            } else if (strcmp(command, "done") == 0) {
+                setSlaveState("done");
+                return;
+            } else {
+                RAMCLOUD_LOG(ERROR, "unknown command %s", command);
+                return;
+            }
+        }
+    }
+
+    int size = objectSize;
+    if (size < 0)
+        size = 100;
+    char* value = new char[size];
+    memset(value, 'x', size);
+    cluster->write(dataTable, "hot", 3, value, size);
+    delete[] value;
+
+    printf("# RAMCloud read throughput when 1 or more clients all read\n");
+    printf("# the same %d-byte object\n", size);
+    printf("# Generated by 'clusterperf.py readHotKey'\n");
+    printf("#\n");
+    printf("# numClients  throughput(total kreads/sec)\n");
+    printf("#-----------------------------------------\n");
+    fflush(stdout);
+    for (int numActive = 1; numActive <= numClients; numActive++) {
+        sendCommand("run", "running", 1, numActive-1);
+        readHotKeyCommon();
+        sendCommand(NULL, "idle", 1, numActive-1);
+        ClientMetrics metrics;
+        getMetrics(metrics, numActive);
+        printf("%3d               %8.0f\n", numActive, sum(metrics[0])/1e03);
+        fflush(stdout);
+    }
+    sendCommand("done", "done", 1, numClients-1);
+}
+
 /**
  *  This method implements almost all of the functionality for both
  * readInterference and writeInterference.
@@ -6187,6 +6901,394 @@ workloadThroughput()
     }
 }
 
+// Length of the keys used by the ycsb test.
+static const uint16_t YCSB_KEY_LENGTH = 23;
+
+// Largest number of records read by a single scan in the ycsb test (the
+// value used by YCSB's workload E).
+static const int YCSB_MAX_SCAN_LENGTH = 100;
+
+/**
+ * Generate the key for a record in the ycsb test.
+ *
+ * \param record
+ *      Identifier of the record.
+ * \param key
+ *      The key is written here (null-terminated); must hold at least
+ *      YCSB_KEY_LENGTH+1 bytes.
+ */
+void
+ycsbKey(uint64_t record, char* key)
+{
+    snprintf(key, YCSB_KEY_LENGTH + 1, "user%019lu", record);
+}
+
+/**
+ * Map from the index of a record, as seen by this client, to its identifier.
+ * The first recordCount records are loaded before the test starts; after
+ * that, each client inserts records with identifiers interleaved with those
+ * of the other clients, so that clients never insert the same record.
+ *
+ * \param index
+ *      Records loaded before the test are numbered 0..recordCount-1, and
+ *      the records inserted by this client follow them.
+ */
+uint64_t
+ycsbRecordId(uint64_t index)
+{
+    uint64_t loaded = static_cast<uint64_t>(recordCount);
+    if (index < loaded) {
+        return index;
+    }
+    return loaded + static_cast<uint64_t>(clientIndex)
+            + static_cast<uint64_t>(numClients)*(index - loaded);
+}
+
+/**
+ * Load the initial records for the ycsb test into the data table.
+ */
+void
+ycsbLoad()
+{
+    const int batchSize = 500;
+    uint32_t recordSize = downCast<uint32_t>(fieldCount*fieldLength);
+    std::vector<char> keys(batchSize*(YCSB_KEY_LENGTH + 1));
+    std::vector<char> values(batchSize*recordSize);
+    Tub<MultiWriteObject> objects[batchSize];
+    MultiWriteObject* requests[batchSize];
+
+    uint64_t start = Cycles::rdtsc();
+    uint32_t batchCount = 0;
+    for (int i = 0; i < recordCount; i++) {
+        char* key = &keys[batchCount*(YCSB_KEY_LENGTH + 1)];
+        char* value = &values[batchCount*recordSize];
+        ycsbKey(i, key);
+        Util::genRandomString(value, recordSize);
+        objects[batchCount].construct(dataTable, key, YCSB_KEY_LENGTH,
+                value, recordSize);
+        requests[batchCount] = objects[batchCount].get();
+        batchCount++;
+        if ((batchCount == batchSize) || (i == recordCount - 1)) {
+            cluster->multiWrite(requests, batchCount);
+            batchCount = 0;
+        }
+    }
+    RAMCLOUD_LOG(NOTICE, "Loaded %d ycsb records in %.1f seconds",
+            recordCount, Cycles::toSeconds(Cycles::rdtsc() - start));
+}
+
+/**
+ * Read one record for the ycsb test.
+ *
+ * \param ramcloud
+ *      Cluster connection to use for the read.
+ * \param key
+ *      Key for the record (YCSB_KEY_LENGTH bytes).
+ * \param value
+ *      The record's value is returned here.
+ * \param stats
+ *      If the record doesn't exist, the notFound count is incremented here.
+ */
+void
+ycsbRead(RamCloud* ramcloud, const char* key, Buffer* value,
+        YcsbStats* stats)
+{
+    try {
+        ramcloud->read(dataTable, key, YCSB_KEY_LENGTH, value);
+    } catch (ObjectDoesntExistException& e) {
+        stats->notFound++;
+    }
+}
+
+/**
+ * The body of one thread in the ycsb test: issue a series of operations
+ * drawn from a YCSB workload, one at a time, and record their latencies.
+ *
+ * \param workload
+ *      Describes the mix of operations to issue.
+ * \param distribution
+ *      Request distribution for choosing records.
+ * \param opsPerSecond
+ *      Rate at which this thread should issue operations; 0 means issue
+ *      them as fast as possible. When throttled, latency is measured from
+ *      the time each operation was scheduled to start.
+ * \param inserts
+ *      Shared by all of the threads in this client; allocates new records,
+ *      and keeps records from being chosen for other operations until they
+ *      (and all the records inserted before them) exist.
+ * \param stats
+ *      Statistics for this thread are accumulated here.
+ */
+void
+ycsbThread(const YcsbWorkload* workload, string distribution,
+        double opsPerSecond, YcsbInsertCounter* inserts, YcsbStats* stats)
+try
+{
+    RamCloud ramcloud(coordinatorLocator.c_str());
+    uint32_t recordSize = downCast<uint32_t>(fieldCount*fieldLength);
+    std::vector<char> value(recordSize);
+    char key[YCSB_KEY_LENGTH + 1];
+    Buffer buffer;
+    YcsbKeyChooser chooser(distribution, recordCount);
+
+    // Used for scans.
+    char scanKeys[YCSB_MAX_SCAN_LENGTH][YCSB_KEY_LENGTH + 1];
+    MultiReadObject scanObjects[YCSB_MAX_SCAN_LENGTH];
+    MultiReadObject* scanRequests[YCSB_MAX_SCAN_LENGTH];
+    Tub<ObjectBuffer> scanValues[YCSB_MAX_SCAN_LENGTH];
+
+    // Cumulative probabilities for choosing the type of each operation,
+    // indexed by YcsbOp.
+    double thresholds[YCSB_NUM_OPS];
+    thresholds[YCSB_READ] = workload->readProportion;
+    thresholds[YCSB_UPDATE] = thresholds[YCSB_READ]
+            + workload->updateProportion;
+    thresholds[YCSB_INSERT] = thresholds[YCSB_UPDATE]
+            + workload->insertProportion;
+    thresholds[YCSB_SCAN] = thresholds[YCSB_INSERT]
+            + workload->scanProportion;
+    thresholds[YCSB_READ_MODIFY_WRITE] = 1.0;
+
+    uint64_t cyclesPerOp = 0;
+    if (opsPerSecond > 0) {
+        cyclesPerOp = Cycles::fromSeconds(1.0/opsPerSecond);
+    }
+    uint64_t nextStart = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        uint64_t start;
+        if (cyclesPerOp != 0) {
+            while (Cycles::rdtsc() < nextStart) {
+                /* Wait for this operation's scheduled time. */
+            }
+            start = nextStart;
+            nextStart += cyclesPerOp;
+        } else {
+            start = Cycles::rdtsc();
+        }
+
+        double choice = static_cast<double>(generateRandom() % 1000000)/1e06;
+        int op = 0;
+        while ((op < YCSB_READ_MODIFY_WRITE) && (choice >= thresholds[op])) {
+            op++;
+        }
+        uint64_t existing = static_cast<uint64_t>(recordCount)
+                + inserts->getAcknowledged();
+        switch (op) {
+            case YCSB_READ:
+                ycsbKey(ycsbRecordId(chooser.next(existing)), key);
+                ycsbRead(&ramcloud, key, &buffer, stats);
+                break;
+            case YCSB_UPDATE:
+                ycsbKey(ycsbRecordId(chooser.next(existing)), key);
+                Util::genRandomString(value.data(), recordSize);
+                ramcloud.write(dataTable, key, YCSB_KEY_LENGTH, value.data(),
+                        recordSize);
+                break;
+            case YCSB_INSERT: {
+                uint64_t insert = inserts->start();
+                ycsbKey(ycsbRecordId(static_cast<uint64_t>(recordCount)
+                        + insert), key);
+                Util::genRandomString(value.data(), recordSize);
+                ramcloud.write(dataTable, key, YCSB_KEY_LENGTH, value.data(),
+                        recordSize);
+                inserts->finish(insert);
+                break;
+            }
+            case YCSB_SCAN: {
+                uint64_t first = chooser.next(existing);
+                uint64_t length = std::min(existing - first, 1 +
+                        generateRandom() % YCSB_MAX_SCAN_LENGTH);
+                for (uint64_t j = 0; j < length; j++) {
+                    ycsbKey(ycsbRecordId(first + j), scanKeys[j]);
+                    scanValues[j].destroy();
+                    scanObjects[j] = MultiReadObject(dataTable, scanKeys[j],
+                            YCSB_KEY_LENGTH, &scanValues[j]);
+                    scanRequests[j] = &scanObjects[j];
+                }
+                ramcloud.multiRead(scanRequests,
+                        downCast<uint32_t>(length));
+                for (uint64_t j = 0; j < length; j++) {
+                    if (scanObjects[j].status != STATUS_OK) {
+                        stats->notFound++;
+                    }
+                }
+                break;
+            }
+            case YCSB_READ_MODIFY_WRITE: {
+                // YCSB reports the read and the write separately, as well
+                // as the combined operation.
+                ycsbKey(ycsbRecordId(chooser.next(existing)), key);
+                ycsbRead(&ramcloud, key, &buffer, stats);
+                uint64_t readDone = Cycles::rdtsc();
+                stats->record(YCSB_READ, readDone - start);
+                Util::genRandomString(value.data(), recordSize);
+                ramcloud.write(dataTable, key, YCSB_KEY_LENGTH, value.data(),
+                        recordSize);
+                stats->record(YCSB_UPDATE, Cycles::rdtsc() - readDone);
+                break;
+            }
+        }
+        stats->record(static_cast<YcsbOp>(op), Cycles::rdtsc() - start);
+    }
+}
+catch (std::exception& e) {
+    RAMCLOUD_LOG(ERROR, "ycsb thread failed: %s", e.what());
+}
+
+/**
+ * Run the ycsb workload in this client, using --threads threads, and
+ * return statistics for all of them.
+ *
+ * \param workload
+ *      Describes the mix of operations to issue.
+ * \param distribution
+ *      Request distribution for choosing records.
+ * \param[out] result
+ *      Combined statistics for all of the threads are returned here.
+ */
+void
+ycsbRun(const YcsbWorkload* workload, const string& distribution,
+        YcsbStats* result)
+{
+    int threads = std::max(numThreads, 1);
+    std::unique_ptr<YcsbStats[]> stats(new YcsbStats[threads]);
+    memset(stats.get(), 0, threads*sizeof(YcsbStats));
+    YcsbInsertCounter inserts;
+    double opsPerSecond = static_cast<double>(targetOps)/threads;
+
+    uint64_t start = Cycles::rdtsc();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(ycsbThread, workload, distribution,
+                opsPerSecond, &inserts, &stats[i]);
+    }
+    foreach (std::thread& worker, workers) {
+        worker.join();
+    }
+    double elapsed = Cycles::toSeconds(Cycles::rdtsc() - start);
+
+    memset(result, 0, sizeof(*result));
+    for (int i = 0; i < threads; i++) {
+        result->add(stats[i]);
+    }
+    result->throughput = static_cast<double>(threads)*count/elapsed;
+}
+
+// This benchmark is a native implementation of the YCSB core workloads
+// (YCSB-A through YCSB-F, selected with --workload), for measuring them
+// without the overheads of the Java client in misc/ycsb. Client 0 loads
+// --recordCount records, each with --fieldCount fields of --fieldLength
+// bytes; then each client runs --threads closed-loop threads (each with
+// its own connection to the cluster), each issuing --count operations.
+// If --targetOps is given, each client is throttled to that rate. Each
+// record is stored as a single object, so updates rewrite the whole
+// record, and scans (workload E) read a run of consecutive records with
+// a multiRead. Results are printed in the same format as YCSB.
+void
+ycsb()
+{
+    const YcsbWorkload* ycsbWorkload = NULL;
+    foreach (const YcsbWorkload& candidate, ycsbWorkloads) {
+        if (workload == candidate.name) {
+            ycsbWorkload = &candidate;
+        }
+    }
+    if (ycsbWorkload == NULL) {
+        RAMCLOUD_LOG(ERROR, "unknown ycsb workload '%s'", workload.c_str());
+        return;
+    }
+    string distribution = requestDistribution;
+    if (distribution.empty()) {
+        distribution = ycsbWorkload->requestDistribution;
+    }
+    if ((distribution != "uniform") && (distribution != "zipfian")
+            && (distribution != "latest")) {
+        RAMCLOUD_LOG(ERROR, "unknown request distribution '%s'",
+                distribution.c_str());
+        return;
+    }
+
+    if (clientIndex > 0) {
+        // This is a slave: execute commands coming from the master.
+        while (true) {
+            char command[20];
+            getCommand(command, sizeof(command));
+            if (strcmp(command, "run") == 0) {
+                setSlaveState("running");
+                YcsbStats stats;
+                ycsbRun(ycsbWorkload, distribution, &stats);
+                string key = keyVal(clientIndex, "ycsbStats");
+                cluster->write(controlTable, key.c_str(),
+                        downCast<uint16_t>(key.length()), &stats,
+                        sizeof32(stats));
+                setSlaveState("idle");
+            } else if (strcmp(command, "done") == 0) {
+                setSlaveState("done");
+                return;
+            } else {
+                RAMCLOUD_LOG(ERROR, "unknown command %s", command);
+                return;
+            }
+        }
+    }
+
+    // This is the master: load the records, then run the workload on all
+    // of the clients and combine their results.
+    ycsbLoad();
+    for (int client = 1; client < numClients; client++) {
+        string key = keyVal(client, "ycsbStats");
+        cluster->remove(controlTable, key.c_str(),
+                downCast<uint16_t>(key.length()));
+    }
+    sendCommand("run", "running", 1, numClients-1);
+    YcsbStats total;
+    ycsbRun(ycsbWorkload, distribution, &total);
+    for (int client = 1; client < numClients; client++) {
+        Buffer statsBuffer;
+        string key = keyVal(client, "ycsbStats");
+        waitForObject(controlTable, key.c_str(),
+                downCast<uint16_t>(key.length()), NULL, statsBuffer);
+        YcsbStats stats;
+        statsBuffer.copy(0, sizeof32(stats), &stats);
+        total.add(stats);
+    }
+    sendCommand("done", "done", 1, numClients-1);
+
+    printf("# RAMCloud native %s: %d records with %d %d-byte fields,\n",
+            workload.c_str(), recordCount, fieldCount, fieldLength);
+    printf("# %s request distribution, %d client(s) with %d thread(s), "
+            "%d operations/thread.\n", distribution.c_str(), numClients,
+            std::max(numThreads, 1), count);
+    printf("# Generated by 'clusterperf.py ycsb'\n");
+    printf("#\n");
+    printf("[OVERALL], Throughput(ops/sec), %.1f\n", total.throughput);
+    for (int op = 0; op < YCSB_NUM_OPS; op++) {
+        const LatencyHistogram& latency = total.latency[op];
+        uint64_t operations = latency.totalCount();
+        if (operations == 0) {
+            continue;
+        }
+        const char* name = ycsbOpNames[op];
+        printf("[%s], Operations, %lu\n", name, operations);
+        printf("[%s], AverageLatency(us), %.2f\n", name,
+                Cycles::toSeconds(total.totalCycles[op])*1e06/
+                static_cast<double>(operations));
+        printf("[%s], 50thPercentileLatency(us), %.2f\n", name,
+                Cycles::toSeconds(latency.getPercentile(50))*1e06);
+        printf("[%s], 95thPercentileLatency(us), %.2f\n", name,
+                Cycles::toSeconds(latency.getPercentile(95))*1e06);
+        printf("[%s], 99thPercentileLatency(us), %.2f\n", name,
+                Cycles::toSeconds(latency.getPercentile(99))*1e06);
+        printf("[%s], 99.9thPercentileLatency(us), %.2f\n", name,
+                Cycles::toSeconds(latency.getPercentile(99.9))*1e06);
+        printf("[%s], MaxLatency(us), %.2f\n", name,
+                Cycles::toSeconds(total.maxCycles[op])*1e06);
+    }
+    if (total.notFound != 0) {
+        printf("[OVERALL], Return=NOT_FOUND, %lu\n", total.notFound);
+    }
+}
+
 // The following struct and table define each performance test in terms of
 // a string name and a function that implements the test.
 struct TestInfo {
@@ -6217,10 +7319,12 @@ TestInfo tests[] = {
     {"multiRead_generalRandom", multiRead_generalRandom},
     {"multiReadThroughput", multiReadThroughput},
     {"netBandwidth", netBandwidth},
+    {"openLoop", openLoop},
     {"readAllToAll", readAllToAll},
     {"readDist", readDist},
     {"readDistRandom", readDistRandom},
     {"readDistWorkload", readDistWorkload},
+    {"readHotKey", readHotKey},
     {"readInterference", readInterference},
     {"readLoaded", readLoaded},
     {"readNotFound", readNotFound},
@@ -6234,6 +7338,7 @@ TestInfo tests[] = {
     {"writeInterference", writeInterference},
     {"writeThroughput", writeThroughput},
     {"workloadThroughput", workloadThroughput},
+    {"ycsb", ycsb},
 };
 
 int
@@ -6242,7 +7347,7 @@ try
 {
     // Parse command-line options.
     vector<string> testNames;
-    string coordinatorLocator, logFile;
+    string logFile;
     string logLevel("NOTICE");
     po::options_description desc(
             "Usage: ClusterPerf [options] testName testName ...\n\n"
@@ -6279,13 +7384,38 @@ try
                 "Number of times to invoke operation before beginning "
                 "measurements")
         ("workload", po::value<string>(&workload)->default_value("YCSB-A"),
-                "Workload of additional load generating clients"
-                "(YCSB-A, YCSB-B, YCSB-C)")
+                "Workload of additional load generating clients "
+                "(YCSB-A, YCSB-B, YCSB-C), or workload for the ycsb test "
+                "(YCSB-A through YCSB-F)")
         ("targetOps", po::value<int>(&targetOps)->default_value(0),
                 "Operations per second that each load generating client"
                 "will try to achieve (0 means run as fast as possible)")
         ("txSpan", po::value<int>(&txSpan)->default_value(1),
                 "Number of servers that each transaction should span")
+        ("rate", po::value<double>(&openLoopRate)->default_value(10000),
+                "Average operations per second to issue in open-loop tests")
+        ("openLoopOp", po::value<string>(&openLoopOp)->default_value("read"),
+                "Operation to issue in open-loop tests "
+                "(read, write, multiRead, transaction)")
+        ("maxOutstanding", po::value<int>(&maxOutstanding)->default_value(64),
+                "Maximum number of requests outstanding at once in "
+                "open-loop tests")
+        ("arrivalTrace", po::value<string>(&arrivalTrace),
+                "File of request inter-arrival times (microseconds, one per "
+                "line) to replay in open-loop tests, instead of Poisson "
+                "arrivals")
+        ("recordCount", po::value<int>(&recordCount)->default_value(1000000),
+                "Number of records to load for the ycsb test")
+        ("fieldCount", po::value<int>(&fieldCount)->default_value(10),
+                "Number of fields in each record for the ycsb test")
+        ("fieldLength", po::value<int>(&fieldLength)->default_value(100),
+                "Size of each field (in bytes) for the ycsb test")
+        ("requestDistribution", po::value<string>(&requestDistribution),
+                "Distribution for choosing keys in the ycsb test (uniform, "
+                "zipfian, latest); default depends on the workload")
+        ("threads", po::value<int>(&numThreads)->default_value(1),
+                "Number of threads issuing requests in each client for "
+                "the ycsb test")
         ("numIndexlet", po::value<int>(&numIndexlet)->default_value(1),
                 "number of Indexlets")
         ("numIndexes", po::value<int>(&numIndexes)->default_value(1),
@@ -0,0 +1,125 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lz4.h>
+
+#include "Common.h"
+#include "CompressedObject.h"
+#include "Object.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Create a compressed copy of an object.
+ *
+ * \param objectBuffer
+ *      Buffer containing a serialized object (e.g., a LOG_ENTRY_TYPE_OBJ
+ *      entry in the log).
+ * \param[out] out
+ *      If the object is worth compressing, the serialized compressed object
+ *      is appended to this buffer. It is always smaller than the original.
+ * \return
+ *      True means the compressed object was appended to \a out. False means
+ *      the value is too short or doesn't compress well enough to be worth
+ *      decompressing on every read; \a out is unchanged.
+ */
+bool
+CompressedObject::compress(Buffer& objectBuffer, Buffer* out)
+{
+    Object object(objectBuffer);
+    uint32_t valueOffset;
+    if (!object.getValueOffset(&valueOffset))
+        return false;
+    uint32_t valueLength = object.getValueLength();
+    if (valueLength < MIN_VALUE_LENGTH)
+        return false;
+
+    const char* keysAndValue =
+            static_cast<const char*>(object.getKeysAndValue());
+    int bound = LZ4_compressBound(downCast<int>(valueLength));
+    Buffer keysAndValueBuffer;
+    keysAndValueBuffer.appendCopy(keysAndValue, valueOffset);
+    keysAndValueBuffer.emplaceAppend<uint32_t>(valueLength);
+    char* block = static_cast<char*>(keysAndValueBuffer.alloc(bound));
+    int blockLength = LZ4_compress_default(keysAndValue + valueOffset,
+            block, downCast<int>(valueLength), bound);
+
+    // Require a savings of at least 1/8th: otherwise the memory saved
+    // doesn't pay for the extra work on reads.
+    uint32_t newValueLength = sizeof32(uint32_t) + blockLength;
+    if (blockLength <= 0 || newValueLength > valueLength - valueLength / 8)
+        return false;
+    keysAndValueBuffer.truncate(valueOffset + newValueLength);
+
+    Object compressed(object.getTableId(), object.getVersion(),
+            object.getTimestamp(), keysAndValueBuffer);
+    compressed.setCompact(object.isCompact());
+    compressed.setExpiryTime(object.getExpiryTime());
+    compressed.assembleForLog(*out);
+    return true;
+}
+
+/**
+ * Recreate the original object from a compressed one.
+ *
+ * \param compressedBuffer
+ *      Buffer containing a compressed object (e.g., a LOG_ENTRY_TYPE_OBJCOMP
+ *      entry in the log), as created by #compress.
+ * \param[out] out
+ *      The serialized object is appended to this buffer, in contiguous
+ *      storage owned by the buffer. It has the same keys, value, table id,
+ *      version, timestamp, and expiry time as the object that was
+ *      compressed.
+ */
+void
+CompressedObject::decompress(Buffer& compressedBuffer, Buffer* out)
+{
+    Object compressed(compressedBuffer);
+    uint32_t valueOffset;
+    uint32_t blockLength = compressed.getValueLength();
+    if (!compressed.getValueOffset(&valueOffset) ||
+            blockLength < sizeof32(uint32_t)) {
+        DIE("Corrupt compressed object in table %lu",
+                compressed.getTableId());
+    }
+    blockLength -= sizeof32(uint32_t);
+
+    const char* keysAndValue =
+            static_cast<const char*>(compressed.getKeysAndValue());
+    uint32_t valueLength;
+    memcpy(&valueLength, keysAndValue + valueOffset, sizeof(valueLength));
+
+    Buffer keysAndValueBuffer;
+    char* dst = static_cast<char*>(
+            keysAndValueBuffer.alloc(valueOffset + valueLength));
+    memcpy(dst, keysAndValue, valueOffset);
+    int decompressedLength = LZ4_decompress_safe(
+            keysAndValue + valueOffset + sizeof(uint32_t), dst + valueOffset,
+            downCast<int>(blockLength), downCast<int>(valueLength));
+    if (decompressedLength != downCast<int>(valueLength)) {
+        DIE("Corrupt compressed object in table %lu: expected %u bytes, "
+                "decompressed %d", compressed.getTableId(), valueLength,
+                decompressedLength);
+    }
+
+    Object object(compressed.getTableId(), compressed.getVersion(),
+            compressed.getTimestamp(), keysAndValueBuffer);
+    object.setCompact(compressed.isCompact());
+    object.setExpiryTime(compressed.getExpiryTime());
+    object.assembleForLog(out->alloc(object.getSerializedLength()));
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,61 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_COMPRESSEDOBJECT_H
+#define RAMCLOUD_COMPRESSEDOBJECT_H
+
+#include "Buffer.h"
+
+namespace RAMCloud {
+
+/**
+ * This class converts objects to and from the format used for
+ * LOG_ENTRY_TYPE_OBJCOMP log entries. The log cleaner compresses objects
+ * that haven't been written for a while when it relocates them (see
+ * ObjectManager::relocateObject), and ObjectManager decompresses them
+ * whenever their values are needed, so clients never see the difference.
+ *
+ * A compressed object is an ordinary serialized Object (see Object.h) in
+ * which the value has been replaced with the following:
+ *
+ * +---------------------+---------------------------------------+
+ * | Uncompressed Length | LZ4 Block ...                         |
+ * | 4 bytes             |                                       |
+ * +---------------------+---------------------------------------+
+ *
+ * The keys, table id, version, timestamp, and expiry time are unchanged,
+ * so code that only needs those (hashing, liveness checks, creating
+ * tombstones, sorting entries during recovery) can parse the entry with the
+ * Object class. Only code that needs the value must decompress it first.
+ *
+ * This class contains only static methods.
+ */
+class CompressedObject {
+  public:
+    static bool compress(Buffer& objectBuffer, Buffer* out);
+    static void decompress(Buffer& compressedBuffer, Buffer* out);
+
+    /// Values shorter than this are never compressed: LZ4 rarely finds
+    /// anything to gain in them, and the cost of decompressing on every
+    /// read would be wasted.
+    static const uint32_t MIN_VALUE_LENGTH = 64;
+
+  PRIVATE:
+    CompressedObject();
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_COMPRESSEDOBJECT_H
@@ -0,0 +1,134 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "CompressedObject.h"
+#include "Object.h"
+
+namespace RAMCloud {
+
+class CompressedObjectTest : public ::testing::Test {
+  public:
+    Buffer objectBuffer;
+
+    CompressedObjectTest()
+        : objectBuffer()
+    {
+    }
+
+    /**
+     * Serialize an object into #objectBuffer.
+     */
+    void
+    makeObject(const string& value, bool compact = false,
+            uint32_t expiryTime = 0)
+    {
+        Key key(12, "key", 3);
+        Buffer keysAndValue;
+        Object object(key, value.c_str(), downCast<uint32_t>(value.length()),
+                57, 1000, keysAndValue);
+        object.setCompact(compact);
+        object.setExpiryTime(expiryTime);
+        objectBuffer.reset();
+        object.assembleForLog(objectBuffer);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(CompressedObjectTest);
+};
+
+TEST_F(CompressedObjectTest, compress_valueTooShort) {
+    makeObject(string(CompressedObject::MIN_VALUE_LENGTH - 1, 'a'));
+    Buffer compressed;
+    EXPECT_FALSE(CompressedObject::compress(objectBuffer, &compressed));
+    EXPECT_EQ(0U, compressed.size());
+}
+
+TEST_F(CompressedObjectTest, compress_notWorthIt) {
+    string value;
+    for (int i = 0; i < 500; i++) {
+        value += static_cast<char>(generateRandom());
+    }
+    makeObject(value);
+    Buffer compressed;
+    EXPECT_FALSE(CompressedObject::compress(objectBuffer, &compressed));
+    EXPECT_EQ(0U, compressed.size());
+}
+
+TEST_F(CompressedObjectTest, compress_metadataUnchanged) {
+    makeObject(string(1000, 'a'));
+    Buffer compressed;
+    EXPECT_TRUE(CompressedObject::compress(objectBuffer, &compressed));
+    EXPECT_LT(compressed.size(), objectBuffer.size() / 10);
+
+    Object object(compressed);
+    EXPECT_TRUE(object.checkIntegrity());
+    EXPECT_EQ(12U, object.getTableId());
+    EXPECT_EQ(57U, object.getVersion());
+    EXPECT_EQ(1000U, object.getTimestamp());
+    EXPECT_EQ("key", string(static_cast<const char*>(object.getKey()),
+            object.getKeyLength()));
+}
+
+TEST_F(CompressedObjectTest, decompress) {
+    string value;
+    for (int i = 0; i < 100; i++) {
+        value += format("line %d of some compressible text\n", i % 10);
+    }
+    makeObject(value);
+    Buffer compressed;
+    EXPECT_TRUE(CompressedObject::compress(objectBuffer, &compressed));
+
+    Buffer decompressed;
+    decompressed.appendCopy("xx", 2);
+    CompressedObject::decompress(compressed, &decompressed);
+    decompressed.truncateFront(2);
+    EXPECT_EQ(objectBuffer.size(), decompressed.size());
+    EXPECT_EQ(0, memcmp(objectBuffer.getRange(0, objectBuffer.size()),
+            decompressed.getRange(0, decompressed.size()),
+            objectBuffer.size()));
+}
+
+TEST_F(CompressedObjectTest, decompress_compactHeader) {
+    makeObject(string(1000, 'b'), true);
+    Buffer compressed;
+    EXPECT_TRUE(CompressedObject::compress(objectBuffer, &compressed));
+    EXPECT_TRUE(Object(compressed).isCompact());
+
+    Buffer decompressed;
+    CompressedObject::decompress(compressed, &decompressed);
+    Object object(decompressed);
+    EXPECT_TRUE(object.isCompact());
+    EXPECT_TRUE(object.checkIntegrity());
+    EXPECT_EQ(objectBuffer.size(), decompressed.size());
+    EXPECT_EQ(string(1000, 'b'), string(static_cast<const char*>(
+            object.getValue()), object.getValueLength()));
+}
+
+TEST_F(CompressedObjectTest, decompress_expiryTime) {
+    makeObject(string(1000, 'c'), false, 2000);
+    Buffer compressed;
+    EXPECT_TRUE(CompressedObject::compress(objectBuffer, &compressed));
+    EXPECT_EQ(2000U, Object(compressed).getExpiryTime());
+
+    Buffer decompressed;
+    CompressedObject::decompress(compressed, &decompressed);
+    Object object(decompressed);
+    EXPECT_EQ(2000U, object.getExpiryTime());
+    EXPECT_TRUE(object.checkIntegrity());
+    EXPECT_EQ(objectBuffer.size(), decompressed.size());
+}
+
+}  // namespace RAMCloud
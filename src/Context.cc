@@ -21,6 +21,7 @@
 #include "CoordinatorSession.h"
 #include "Dispatch.h"
 #include "DispatchExec.h"
+#include "MetricsRegistry.h"
 #include "ObjectFinder.h"
 #include "PortAlarm.h"
 #include "ShortMacros.h"
@@ -76,6 +77,7 @@ Context::Context(bool hasDedicatedDispatchThread)
     , coordinatorSession(NULL)
     , cacheTrace(NULL)
     , objectFinder(NULL)
+    , metricsRegistry(NULL)
     , workerManager(NULL)
     , externalStorage(NULL)
     , serverList(NULL)
@@ -90,6 +92,7 @@ Context::Context(bool hasDedicatedDispatchThread)
 #endif
         cacheTrace = new CacheTrace();
         objectFinder = new ObjectFinder(this);
+        metricsRegistry = new MetricsRegistry();
         dispatch = new Dispatch(hasDedicatedDispatchThread);
 #if TESTING
         mockContextMember2 = new MockContextMember(2);
@@ -141,6 +144,9 @@ Context::destroy()
     delete objectFinder;
     objectFinder = NULL;
 
+    delete metricsRegistry;
+    metricsRegistry = NULL;
+
     delete coordinatorSession;
     coordinatorSession = NULL;
 
@@ -35,6 +35,7 @@ class ExternalStorage;
 class Logger;
 class MasterRecoveryManager;
 class MasterService;
+class MetricsRegistry;
 class MockContextMember;
 class ObjectFinder;
 class PortAlarmTimer;
@@ -91,6 +92,9 @@ class Context {
     CacheTrace* cacheTrace;
     ObjectFinder* objectFinder; // On Client and Master, this locator tells
                                 // which master is the owner of an object.
+    MetricsRegistry* metricsRegistry; // Collects the metrics returned by
+                                      // GET_METRICS_SNAPSHOT; services that
+                                      // have metrics register here.
 
     // Variables below this point are used only in servers.  They are
     // always NULL on clients.
@@ -405,14 +405,23 @@ CoordinatorClient::getTableConfig(Context* context,
  *      Overall information about this RAMCloud server or client.
  * \param tableId
  *      The id of a table whose tablet configuration is to be fetched.
- */
-GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId)
+ * \param knownEpoch
+ *      Epoch returned by an earlier call to wait() for this table, if the
+ *      caller still has that configuration, or 0.
+ * \param knownVersion
+ *      Version returned along with \a knownEpoch, or 0. If both are
+ *      nonzero, the coordinator may return only the changes since then.
+ */
+GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId,
+        uint64_t knownEpoch, uint64_t knownVersion)
     : CoordinatorRpcWrapper(context,
             sizeof(WireFormat::GetTableConfig::Response))
 {
     WireFormat::GetTableConfig::Request* reqHdr(
             allocHeader<WireFormat::GetTableConfig>());
     reqHdr->tableId = tableId;
+    reqHdr->knownEpoch = knownEpoch;
+    reqHdr->knownVersion = knownVersion;
     send();
 }
 
@@ -424,10 +433,21 @@ GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId)
  *      Will be filled in with the location of every tablet and index
  *      in the table given by tableId argument passed to the constructor.
  *      If the table does not exist, then the result will contain no tablets
- *      and indexes.
+ *      and indexes. If the return value is true, it only describes the
+ *      changes since the version passed to the constructor; see
+ *      TableManager::serializeTableConfigChanges.
+ * \param[out] epoch
+ *      If non-NULL, the epoch of the configuration is returned here (0 if
+ *      the table doesn't exist).
+ * \param[out] version
+ *      If non-NULL, the version of the configuration is returned here.
+ * \return
+ *      True means \a tableConfig only contains the changes since the
+ *      known version; false means it describes the entire table.
  */
-void
-GetTableConfigRpc::wait(ProtoBuf::TableConfig* tableConfig)
+bool
+GetTableConfigRpc::wait(ProtoBuf::TableConfig* tableConfig, uint64_t* epoch,
+        uint64_t* version)
 {
     waitInternal(context->dispatch);
     const WireFormat::GetTableConfig::Response* respHdr(
@@ -436,6 +456,11 @@ GetTableConfigRpc::wait(ProtoBuf::TableConfig* tableConfig)
         ClientException::throwException(HERE, respHdr->common.status);
     ProtoBuf::parseFromResponse(response, sizeof(*respHdr),
                                 respHdr->tableConfigLength, tableConfig);
+    if (epoch != NULL)
+        *epoch = respHdr->configEpoch;
+    if (version != NULL)
+        *version = respHdr->configVersion;
+    return respHdr->delta != 0;
 }
 
 /**
@@ -502,14 +527,22 @@ HintServerCrashedRpc::HintServerCrashedRpc(Context* context,
  *      tablet during recovery.
  * \param[in] ctimeSegmentOffset
  *      Offset within the head segment prior to migration. See ctimeSegmentId.
+ * \param[in] pullSource
+ *      If valid, the tablet's objects have not been transferred: the new
+ *      owner takes the tablet over at once and pulls them from this master.
+ *      If invalid and \a newOwnerId already owns the tablet, it has
+ *      finished pulling, and the coordinator tells the old owner to drop
+ *      its copy.
  */
 void
 CoordinatorClient::reassignTabletOwnership(Context* context, uint64_t tableId,
         uint64_t firstKeyHash, uint64_t lastKeyHash, ServerId newOwnerId,
-        uint64_t ctimeSegmentId, uint32_t ctimeSegmentOffset)
+        uint64_t ctimeSegmentId, uint32_t ctimeSegmentOffset,
+        ServerId pullSource)
 {
     ReassignTabletOwnershipRpc rpc(context, tableId, firstKeyHash,
-            lastKeyHash, newOwnerId, ctimeSegmentId, ctimeSegmentOffset);
+            lastKeyHash, newOwnerId, ctimeSegmentId, ctimeSegmentOffset,
+            pullSource);
     rpc.wait();
 }
 
@@ -537,11 +570,17 @@ CoordinatorClient::reassignTabletOwnership(Context* context, uint64_t tableId,
  *      tablet during recovery.
  * \param[in] ctimeSegmentOffset
  *      Offset within the head segment prior to migration. See ctimeSegmentId.
+ * \param[in] pullSource
+ *      If valid, the tablet's objects have not been transferred: the new
+ *      owner takes the tablet over at once and pulls them from this master.
+ *      If invalid and \a newOwnerId already owns the tablet, it has
+ *      finished pulling, and the coordinator tells the old owner to drop
+ *      its copy.
  */
 ReassignTabletOwnershipRpc::ReassignTabletOwnershipRpc(Context* context,
         uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
         ServerId newOwnerId, uint64_t ctimeSegmentId,
-        uint32_t ctimeSegmentOffset)
+        uint32_t ctimeSegmentOffset, ServerId pullSource)
     : CoordinatorRpcWrapper(context,
             sizeof(WireFormat::ReassignTabletOwnership::Response))
 {
@@ -553,6 +592,7 @@ ReassignTabletOwnershipRpc::ReassignTabletOwnershipRpc(Context* context,
     reqHdr->newOwnerId = newOwnerId.getId();
     reqHdr->ctimeSegmentId = ctimeSegmentId;
     reqHdr->ctimeSegmentOffset = ctimeSegmentOffset;
+    reqHdr->pullSourceId = pullSource.getId();
     send();
 }
 
@@ -57,7 +57,8 @@ class CoordinatorClient {
     static void hintServerCrashed(Context* context, ServerId serverId);
     static void reassignTabletOwnership(Context* context, uint64_t tableId,
             uint64_t firstKey, uint64_t lastKey, ServerId newOwnerId,
-            uint64_t ctimeSegmentId, uint32_t ctimeSegmentOffset);
+            uint64_t ctimeSegmentId, uint32_t ctimeSegmentOffset,
+            ServerId pullSource = ServerId());
     static bool recoveryMasterFinished(Context* context, uint64_t recoveryId,
             ServerId recoveryMasterId,
             const ProtoBuf::RecoveryPartition* recoveryPartition,
@@ -152,9 +153,11 @@ class GetServerListRpc : public CoordinatorRpcWrapper {
  */
 class GetTableConfigRpc : public CoordinatorRpcWrapper {
     public:
-    explicit GetTableConfigRpc(Context* context, uint64_t tableId);
+    GetTableConfigRpc(Context* context, uint64_t tableId,
+            uint64_t knownEpoch = 0, uint64_t knownVersion = 0);
     ~GetTableConfigRpc() {}
-    void wait(ProtoBuf::TableConfig* tableConfig);
+    bool wait(ProtoBuf::TableConfig* tableConfig, uint64_t* epoch = NULL,
+            uint64_t* version = NULL);
 
     PRIVATE:
     DISALLOW_COPY_AND_ASSIGN(GetTableConfigRpc);
@@ -183,7 +186,8 @@ class ReassignTabletOwnershipRpc : public CoordinatorRpcWrapper {
     public:
     ReassignTabletOwnershipRpc(Context* context, uint64_t tableId,
             uint64_t firstKey, uint64_t lastKey, ServerId newOwnerMasterId,
-            uint64_t ctimeSegmentId, uint32_t ctimeSegmentOffset);
+            uint64_t ctimeSegmentId, uint32_t ctimeSegmentOffset,
+            ServerId pullSource = ServerId());
     ~ReassignTabletOwnershipRpc() {}
     /// \copydoc RpcWrapper::docForWait
     void wait() {simpleWait(context);}
@@ -15,6 +15,7 @@
 
 #include "Common.h"
 #include "ShortMacros.h"
+#include "BatchingExternalStorage.h"
 #include "CoordinatorService.h"
 #include "ExternalStorage.h"
 #include "MemoryMonitor.h"
@@ -52,6 +53,7 @@ main(int argc, char *argv[])
     string localLocator("???");
     uint32_t deadServerTimeout;
     uint32_t maxCores;
+    uint32_t storageFlushMicros;
     bool reset;
     bool neverKill;
     Context context(true);
@@ -79,6 +81,15 @@ main(int argc, char *argv[])
              ProgramOptions::bool_switch(&neverKill),
              "If specified, the coordinator will never attempt to kill any "
              "master or remove it from the server list.")
+            ("storageFlushMicros",
+             ProgramOptions::value<uint32_t>(&storageFlushMicros)->
+                default_value(0),
+             "Number of microseconds to wait for other writes to external "
+             "storage to accumulate before committing a batch of them. "
+             "With 0, writes are only combined if they are issued while "
+             "another commit is in progress. Most coordinator writes are "
+             "made while holding the lock of the module making them, so "
+             "waiting rarely collects more writes and only adds latency.")
             ("reset",
              ProgramOptions::bool_switch(&reset),
              "If specified, the coordinator will not attempt to recover "
@@ -124,6 +135,10 @@ main(int argc, char *argv[])
             // means we won't do any recovery when we start up, and we won't
             // save any information to allow recovery if we crash).
             context.externalStorage = new MockExternalStorage(false);
+        } else {
+            // Combine concurrent writes into fewer round trips.
+            context.externalStorage = new BatchingExternalStorage(
+                    context.externalStorage, storageFlushMicros);
         }
         string workspace("/ramcloud/");
 
@@ -24,6 +24,8 @@
 #include "CoordinatorService.h"
 #include "Cycles.h"
 #include "MasterRecoveryManager.h"
+#include "RawMetrics.h"
+#include "ServerList.h"
 #include "ServerTracker.h"
 #include "ShortMacros.h"
 #include "TransportManager.h"
@@ -60,6 +62,7 @@ CoordinatorServerList::CoordinatorServerList(Context* context)
     , numUpdatingServers(0)
     , replicationGroupSize(3)
     , maxReplicationId(0)
+    , updateTreeFanout(32)
 {
     context->coordinatorServerList = this;
 }
@@ -249,6 +252,10 @@ CoordinatorServerList::recover(uint64_t lastCompletedUpdate)
     vector<ExternalStorage::Object> objects;
     context->externalStorage->getChildren("servers", &objects);
 
+    // Entries that must be rewritten on external storage; they are written
+    // together at the end, rather than one round trip per entry.
+    vector<ExternalStorage::Write> writes;
+
     // Each iteration through the following loop processes information
     // for one entry in the server list.
     foreach (ExternalStorage::Object& object, objects) {
@@ -363,9 +370,11 @@ CoordinatorServerList::recover(uint64_t lastCompletedUpdate)
             // of the new sequence numbers for updates (otherwise, another
             // coordinator crash before the updates are completed could
             // cause the updates never to be finished).
-            entry->sync(context->externalStorage);
+            entry->addWrite(&writes);
         }
     }
+    if (!writes.empty())
+        context->externalStorage->setMulti(&writes);
 
     // Repair inconsistencies in the replication groups.
     repairReplicationGroups(lock);
@@ -1156,8 +1165,10 @@ CoordinatorServerList::checkUpdates()
             rpc->wait();
             workSuccess(rpc->id, rpc->getResponseHeader<
                     WireFormat::UpdateServerList>()->currentVersion);
+            forwardingFinished(rpc, true);
         } catch (const ServerNotUpException& e) {
             workFailed(rpc->id);
+            forwardingFinished(rpc, false);
         }
         (*it)->destroy();
         spareRpcs.push_back(*it);
@@ -1171,6 +1182,7 @@ CoordinatorServerList::checkUpdates()
     }
     Tub<UpdateServerListRpc>* rpcTub = spareRpcs.back();
     if (getWork(rpcTub)) {
+        metrics->coordinator.serverListUpdateRpcCount++;
         (*rpcTub)->send();
         activeRpcs.push_back(rpcTub);
         spareRpcs.pop_back();
@@ -1272,6 +1284,8 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
                             break;
                         }
                     }
+                    if (updateTreeFanout > 0 && !server->forwardingFailed)
+                        addForwardedServers(lock, server, rpc->get());
                 }
 
                 numUpdatingServers++;
@@ -1309,6 +1323,98 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
     return false;
 }
 
+/**
+ * Called by getWork() after it has created an RPC with incremental updates
+ * for a server: finds up to updateTreeFanout other servers that need
+ * exactly the same updates and asks the RPC's target to forward the updates
+ * to them. Nothing happens unless at least MIN_SERVERS_FOR_TREE servers
+ * (including the target) need the updates.
+ *
+ * \param lock
+ *      Explicitly needs CoordinatorServerList lock.
+ * \param root
+ *      The server to which \a rpc will be sent; its updateVersion has
+ *      already been set to the version the RPC brings it to.
+ * \param rpc
+ *      The RPC, which hasn't been sent yet.
+ */
+void
+CoordinatorServerList::addForwardedServers(const Lock& lock, Entry* root,
+        UpdateServerListRpc* rpc)
+{
+    vector<Entry*> servers;
+    uint32_t numMatching = 0;
+    for (size_t i = 0; i < serverList.size(); i++) {
+        Entry* server = serverList[i].entry.get();
+        if (server == NULL || server == root ||
+                server->status != ServerStatus::UP ||
+                !server->services.has(WireFormat::MEMBERSHIP_SERVICE) ||
+                server->forwardingFailed ||
+                server->verifiedVersion != root->verifiedVersion ||
+                server->updateVersion != server->verifiedVersion) {
+            continue;
+        }
+        numMatching++;
+        if (servers.size() < updateTreeFanout)
+            servers.push_back(server);
+        if (servers.size() >= updateTreeFanout &&
+                numMatching + 1 >= MIN_SERVERS_FOR_TREE)
+            break;
+    }
+    if (numMatching + 1 < MIN_SERVERS_FOR_TREE)
+        return;
+
+    vector<ServerId> ids;
+    foreach (Entry* server, servers) {
+        server->updateVersion = root->updateVersion;
+        ids.push_back(server->serverId);
+        numUpdatingServers++;
+    }
+    rpc->setForwardList(ids);
+}
+
+/**
+ * Called when an UPDATE_SERVER_LIST RPC completes to account for the
+ * servers its target was asked to forward the updates to (if any); see
+ * addForwardedServers(). Each of them is treated as if the coordinator
+ * had updated it directly, with the outcome reported by the RPC's target.
+ * Servers that weren't updated are marked so that they will be updated
+ * directly from now on.
+ *
+ * \param rpc
+ *      The completed RPC.
+ * \param delivered
+ *      True means the RPC succeeded, so its response describes the
+ *      forwarded servers; false means it failed, so none of them can be
+ *      assumed to have received the updates.
+ */
+void
+CoordinatorServerList::forwardingFinished(UpdateServerListRpc* rpc,
+        bool delivered)
+{
+    typedef WireFormat::UpdateServerList::Response::Forwarded Forwarded;
+    uint32_t offset = sizeof32(WireFormat::UpdateServerList::Response);
+    foreach (ServerId id, rpc->forwardedServers) {
+        const Forwarded* result = NULL;
+        if (delivered) {
+            result = rpc->response->getOffset<Forwarded>(offset);
+            offset += sizeof32(Forwarded);
+        }
+        if (result != NULL && result->serverId == id.getId() &&
+                result->currentVersion != 0) {
+            metrics->coordinator.serverListForwardedCount++;
+            workSuccess(id, result->currentVersion);
+        } else {
+            workFailed(id);
+            Lock lock(mutex);
+            Entry* server = getEntry(id);
+            if (server != NULL)
+                server->forwardingFailed = true;
+        }
+    }
+    rpc->forwardedServers.clear();
+}
+
 /**
  * Signals the success of updater to complete an update RPC. This
  * will update internal metadata to allow the target server to be
@@ -1370,6 +1476,7 @@ CoordinatorServerList::workSuccess(ServerId id, uint64_t currentVersion) {
             server->verifiedVersion = server->updateVersion;
         } else {
             server->verifiedVersion = server->updateVersion = currentVersion;
+            server->forwardingFailed = false;
             if (currentVersion < maxConfirmedVersion) {
                 DIE("Server list for server %s is so far out of date that we "
                         "can't fix it (its version: %lu, maxConfirmedVersion: "
@@ -1445,13 +1552,10 @@ CoordinatorServerList::UpdateServerListRpc::UpdateServerListRpc(
             const ProtoBuf::ServerList* list)
     : ServerIdRpcWrapper(context, serverId,
             sizeof(WireFormat::UpdateServerList::Response))
+    , forwardedServers()
 {
     allocHeader<WireFormat::UpdateServerList>(serverId);
-
-    auto* part = request.emplaceAppend<
-            WireFormat::UpdateServerList::Request::Part>();
-
-    part->serverListLength = serializeToRequest(&request, list);
+    appendServerList(list);
 }
 
 /**
@@ -1474,12 +1578,22 @@ CoordinatorServerList::UpdateServerListRpc::appendServerList(
                                         const ProtoBuf::ServerList* list)
 {
     assert(this->getState() == NOT_STARTED);
+    assert(forwardedServers.empty());
     uint32_t sizeBefore = request.size();
 
     auto* part = request.emplaceAppend<
             WireFormat::UpdateServerList::Request::Part>();
 
-    part->serverListLength = serializeToRequest(&request, list);
+    // Single-server incremental updates (all of them, in practice) use
+    // the compact encoding.
+    if (list->type() == ProtoBuf::ServerList::UPDATE &&
+            list->server_size() == 1) {
+        part->format = WireFormat::UpdateServerList::Request::DELTA;
+        part->serverListLength = ServerList::appendDelta(*list, &request);
+    } else {
+        part->format = WireFormat::UpdateServerList::Request::PROTOBUF;
+        part->serverListLength = serializeToRequest(&request, list);
+    }
 
     uint32_t sizeAfter = request.size();
     if (sizeAfter > Transport::MAX_RPC_LEN) {
@@ -1490,6 +1604,28 @@ CoordinatorServerList::UpdateServerListRpc::appendServerList(
     return true;
 }
 
+/**
+ * Ask the target of this RPC to forward the updates in it to other
+ * servers. Must be called after the last appendServerList() and before
+ * send().
+ *
+ * \param servers
+ *      Servers that need the same updates as the target.
+ */
+void
+CoordinatorServerList::UpdateServerListRpc::setForwardList(
+        const vector<ServerId>& servers)
+{
+    assert(this->getState() == NOT_STARTED);
+    auto* reqHdr = request.getStart<WireFormat::UpdateServerList::Request>();
+    reqHdr->forwardCount = downCast<uint32_t>(servers.size());
+    foreach (ServerId id, servers) {
+        uint64_t rawId = id.getId();
+        request.appendCopy(&rawId);
+    }
+    forwardedServers = servers;
+}
+
 
 //////////////////////////////////////////////////////////////////////
 // CoordinatorServerList::Entry Methods
@@ -1504,6 +1640,7 @@ CoordinatorServerList::Entry::Entry()
     , verifiedVersion(UNINITIALIZED_VERSION)
     , updateVersion(UNINITIALIZED_VERSION)
     , pendingUpdates()
+    , forwardingFailed(false)
 {
 }
 
@@ -1532,6 +1669,7 @@ CoordinatorServerList::Entry::Entry(ServerId serverId,
     , verifiedVersion(UNINITIALIZED_VERSION)
     , updateVersion(UNINITIALIZED_VERSION)
     , pendingUpdates()
+    , forwardingFailed(false)
 {
 }
 
@@ -1563,6 +1701,23 @@ CoordinatorServerList::Entry::serialize(ProtoBuf::ServerList_Entry* dest) const
  */
 void
 CoordinatorServerList::Entry::sync(ExternalStorage* externalStorage)
+{
+    vector<ExternalStorage::Write> writes;
+    addWrite(&writes);
+    externalStorage->set(writes[0].flavor, writes[0].name.c_str(),
+            writes[0].value.c_str(), downCast<int>(writes[0].value.length()));
+}
+
+/**
+ * Describe the persistent copy of this entry in the form needed for
+ * ExternalStorage::setMulti, so that several entries can be written to
+ * external storage at once; otherwise the same as sync.
+ *
+ * \param[out] writes
+ *      A write for this entry is appended here.
+ */
+void
+CoordinatorServerList::Entry::addWrite(vector<ExternalStorage::Write>* writes)
 {
     ProtoBuf::ServerListEntry externalInfo;
     externalInfo.set_services(services.serialize());
@@ -1588,7 +1743,7 @@ CoordinatorServerList::Entry::sync(ExternalStorage* externalStorage)
 
     string str;
     externalInfo.SerializeToString(&str);
-    externalStorage->set(ExternalStorage::UPDATE, objectName, str.c_str(),
+    writes->emplace_back(ExternalStorage::UPDATE, objectName, str.c_str(),
             downCast<int>(str.length()));
 }
 } // namespace RAMCloud
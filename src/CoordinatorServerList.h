@@ -51,6 +51,14 @@ namespace RAMCloud {
  * The updates are done asynchronously from the CoordinatorServerList call
  * thread. sync() can be called to force a synchronization point.
  *
+ * In large clusters most servers need exactly the same updates, so rather
+ * than sending each of them its own RPC the updater sends one RPC to a
+ * server along with a list of other such servers, and that server forwards
+ * the updates to them (see MembershipService). The results for every
+ * server in the list come back in the response; servers the updates didn't
+ * reach are brought up to date individually, like any other server that
+ * falls behind.
+ *
  * CoordinatorServerList is thread-safe and supports ServerTrackers.
  *
  * This class publicly extends AbstractServerList to provide a common
@@ -68,6 +76,11 @@ class CoordinatorServerList : public AbstractServerList{
     /// batching, small enough that we never overflow the RPC size limit).
     static const int MAX_UPDATES_PER_RPC = 100;
 
+    /// Server list updates are only forwarded from server to server (see
+    /// #updateTreeFanout) when at least this many servers need the same
+    /// updates; below this it's cheaper to send them directly.
+    static const uint32_t MIN_SERVERS_FOR_TREE = 16;
+
     /**
      * This class represents one entry in the CoordinatorServerList. Each
      * entry describes a specific server in the system and contains the
@@ -87,6 +100,7 @@ class CoordinatorServerList : public AbstractServerList{
         Entry& operator=(const Entry& other) = default;
         void serialize(ProtoBuf::ServerList_Entry* dest) const;
         void sync(ExternalStorage* externalStorage);
+        void addWrite(vector<ExternalStorage::Write>* writes);
 
         bool isMaster() const {
             return (status == ServerStatus::UP) &&
@@ -158,6 +172,14 @@ class CoordinatorServerList : public AbstractServerList{
          * completed if we crash partway through.
          */
         std::deque<ProtoBuf::ServerListEntry_Update> pendingUpdates;
+
+        /**
+         * True means an update forwarded to this server by another server
+         * didn't reach it (see addForwardedServers), so the coordinator
+         * sends it updates directly until one succeeds. This keeps a
+         * crashed or unresponsive server from delaying updates for others.
+         */
+        bool forwardingFailed;
     };
 
     explicit CoordinatorServerList(Context* context);
@@ -221,6 +243,12 @@ class CoordinatorServerList : public AbstractServerList{
 
       PRIVATE:
         bool appendServerList(const ProtoBuf::ServerList* list);
+        void setForwardList(const vector<ServerId>& servers);
+
+        /// Servers to which the target was asked to forward this update;
+        /// they're accounted for when the RPC completes.
+        vector<ServerId> forwardedServers;
+
         DISALLOW_COPY_AND_ASSIGN(UpdateServerListRpc);
     };
 
@@ -334,6 +362,9 @@ class CoordinatorServerList : public AbstractServerList{
     void pruneUpdates(const Lock& lock);
 
     bool getWork(Tub<UpdateServerListRpc>* rpc);
+    void addForwardedServers(const Lock& lock, Entry* root,
+                             UpdateServerListRpc* rpc);
+    void forwardingFinished(UpdateServerListRpc* rpc, bool delivered);
     void workSuccess(ServerId id, uint64_t currentVersion);
     void workFailed(ServerId id);
     void waitForWork();
@@ -429,6 +460,15 @@ class CoordinatorServerList : public AbstractServerList{
      * Note: id 0 is never used.
      */
     uint64_t maxReplicationId;
+
+    /**
+     * When the same updates are sent to many servers, the coordinator asks
+     * each recipient to forward them to at most this many others. 0 means
+     * updates are never forwarded: the coordinator sends them to every
+     * server itself.
+     */
+    uint32_t updateTreeFanout;
+
     DISALLOW_COPY_AND_ASSIGN(CoordinatorServerList);
 };
 } // namespace RAMCloud
@@ -23,6 +23,7 @@
 #include "MockCluster.h"
 #include "MockTransport.h"
 #include "RamCloud.h"
+#include "ServerList.h"
 #include "ServerTracker.h"
 #include "ShortMacros.h"
 #include "TransportManager.h"
@@ -228,6 +229,8 @@ class CoordinatorServerListTest : public ::testing::Test {
         result.append(format("opcode: %s", WireFormat::opcodeSymbol(
                 request->common.opcode)));
         uint32_t offset = sizeof32(*request);
+        uint32_t forwardOffset = totalLength - request->forwardCount * 8;
+        totalLength = forwardOffset;
         while (offset <totalLength) {
             const WireFormat::UpdateServerList::Request::Part* part =
                     buffer->getOffset<
@@ -245,12 +248,27 @@ class CoordinatorServerListTest : public ::testing::Test {
                         totalLength - offset, offset, part->serverListLength));
             }
             ProtoBuf::ServerList pb;
-            ProtoBuf::parseFromRequest(buffer, offset,
-                    part->serverListLength, &pb);
-            result.append(format(", protobuf: %s",
-                    pb.ShortDebugString().c_str()));
+            if (part->format ==
+                    WireFormat::UpdateServerList::Request::DELTA) {
+                ServerList::parseDelta(buffer, offset,
+                        part->serverListLength, &pb);
+                result.append(format(", delta: %s",
+                        pb.ShortDebugString().c_str()));
+            } else {
+                ProtoBuf::parseFromRequest(buffer, offset,
+                        part->serverListLength, &pb);
+                result.append(format(", protobuf: %s",
+                        pb.ShortDebugString().c_str()));
+            }
             offset += part->serverListLength;
         }
+        if (request->forwardCount > 0) {
+            result.append(", forward:");
+            for (uint32_t i = 0; i < request->forwardCount; i++) {
+                result.append(" " + ServerId(*buffer->getOffset<uint64_t>(
+                        forwardOffset + 8 * i)).toString());
+            }
+        }
         return result;
     }
 
@@ -616,7 +634,8 @@ TEST_F(CoordinatorServerListTest, recover_incompleteUpdates) {
             "update { status: 1 version: 5 sequence_number: 101 } "
             "update { status: 2 version: 6 sequence_number: 102 }",
             info.ShortDebugString());
-    EXPECT_TRUE(TestUtil::contains(storage->log, "set(UPDATE, servers/2)"));
+    EXPECT_TRUE(TestUtil::contains(storage->log,
+            "setMulti(UPDATE servers/2)"));
 
     // Check proper recording in the update list.
     EXPECT_EQ(2lu, sl->updates.size());
@@ -1308,7 +1327,7 @@ TEST_F(CoordinatorServerListTest, sync) {
     transport->setInput("0 1 0");
 
     sl->sync();
-    EXPECT_EQ("sendRequest: 0x40023 1 0 11 273 0 /0 /x18/0",
+    EXPECT_EQ("sendRequest: 0x40023 0 1 0 11 273 0 /0 /x18/0",
             transport->outputLog);
     transport->clearOutput();
 
@@ -1516,16 +1535,16 @@ TEST_F(CoordinatorServerListTest, getWork_incrementalUpdates) {
     sl->recoveryCompleted(id2);
     EXPECT_TRUE(sl->getWork(&rpc));
     EXPECT_EQ("opcode: UPDATE_SERVER_LIST, "
-            "protobuf: server { services: 1 server_id: 2 "
-            "service_locator: \"mock:host=server2\" "
+            "delta: server { services: 1 server_id: 2 "
+            "service_locator: \"\" "
             "expected_read_mbytes_per_sec: 0 status: 1 replication_id: 0 } "
             "version_number: 5 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 3 "
-            "service_locator: \"mock:host=server3\" "
+            "delta: server { services: 1 server_id: 3 "
+            "service_locator: \"\" "
             "expected_read_mbytes_per_sec: 0 status: 1 replication_id: 0 } "
             "version_number: 6 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 2 "
-            "service_locator: \"mock:host=server2\" "
+            "delta: server { services: 1 server_id: 2 "
+            "service_locator: \"\" "
             "expected_read_mbytes_per_sec: 0 status: 2 replication_id: 0 } "
             "version_number: 7 type: UPDATE",
             parseUpdateRequest(&rpc->request));
@@ -1549,11 +1568,11 @@ TEST_F(CoordinatorServerListTest, getWork_skipEntriesAlreadySeen) {
     // See whether getWork skips the entries already "seen".
     EXPECT_TRUE(sl->getWork(&rpc));
     EXPECT_EQ("opcode: UPDATE_SERVER_LIST, "
-            "protobuf: server { services: 1 server_id: 3 "
+            "delta: server { services: 1 server_id: 3 "
             "service_locator: \"mock:host=server3\" "
             "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
             "version_number: 3 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 4 "
+            "delta: server { services: 1 server_id: 4 "
             "service_locator: \"mock:host=server4\" "
             "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
             "version_number: 4 type: UPDATE",
@@ -1561,6 +1580,95 @@ TEST_F(CoordinatorServerListTest, getWork_skipEntriesAlreadySeen) {
     EXPECT_EQ(4lu, e->updateVersion);
 }
 
+TEST_F(CoordinatorServerListTest, getWork_forwardsToTree) {
+    vector<ServerId> ids;
+    for (int i = 1; i <= 18; i++) {
+        ids.push_back(sl->enlistServer({WireFormat::MEMBERSHIP_SERVICE}, 0,
+                0, format("mock:host=server%d", i).c_str()));
+    }
+
+    // Pretend that every server is up to date, then generate one update.
+    foreach (ServerId id, ids) {
+        CoordinatorServerList::Entry* e = sl->getEntry(id);
+        e->updateVersion = e->verifiedVersion = sl->version;
+    }
+    sl->serverCrashed(ids[17]);
+
+    // One RPC covers all 17 remaining servers.
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ("opcode: UPDATE_SERVER_LIST, "
+            "delta: server { services: 16 server_id: 18 "
+            "service_locator: \"\" "
+            "expected_read_mbytes_per_sec: 0 status: 1 replication_id: 0 } "
+            "version_number: 19 type: UPDATE, forward: "
+            "2.0 3.0 4.0 5.0 6.0 7.0 8.0 9.0 10.0 11.0 12.0 13.0 14.0 "
+            "15.0 16.0 17.0",
+            parseUpdateRequest(&rpc->request));
+    EXPECT_EQ(17lu, sl->numUpdatingServers);
+    EXPECT_EQ(19lu, sl->getEntry(ids[16])->updateVersion);
+    EXPECT_FALSE(sl->getWork(&rpc));
+
+    // Each RPC is forwarded to at most updateTreeFanout servers, and
+    // servers that a forwarded update failed to reach are left out.
+    foreach (ServerId id, ids) {
+        CoordinatorServerList::Entry* e = sl->getEntry(id);
+        e->updateVersion = e->verifiedVersion;
+    }
+    sl->numUpdatingServers = 0;
+    sl->updateTreeFanout = 10;
+    sl->getEntry(ids[3])->forwardingFailed = true;
+    EXPECT_TRUE(sl->getWork(&rpc));
+    string request = parseUpdateRequest(&rpc->request);
+    EXPECT_EQ("2.0 3.0 5.0 6.0 7.0 8.0 9.0 10.0 11.0 12.0",
+            request.substr(request.find("forward: ") + 9));
+
+    // With forwarding disabled, each server gets its own RPC.
+    sl->updateTreeFanout = 0;
+    foreach (ServerId id, ids) {
+        CoordinatorServerList::Entry* e = sl->getEntry(id);
+        e->updateVersion = e->verifiedVersion;
+    }
+    sl->numUpdatingServers = 0;
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(0u, rpc->request.getStart<
+            WireFormat::UpdateServerList::Request>()->forwardCount);
+}
+
+TEST_F(CoordinatorServerListTest, forwardingFinished) {
+    typedef WireFormat::UpdateServerList::Response::Forwarded Forwarded;
+    ServerId id1 = sl->enlistServer({WireFormat::MEMBERSHIP_SERVICE}, 0, 0,
+            "mock:host=server1");
+    ServerId id2 = sl->enlistServer({WireFormat::MEMBERSHIP_SERVICE}, 0, 0,
+            "mock:host=server2");
+    ServerId id3 = sl->enlistServer({WireFormat::MEMBERSHIP_SERVICE}, 0, 0,
+            "mock:host=server3");
+    ProtoBuf::ServerList list = sl->updates.back().incremental;
+    rpc.construct(&context, id1, &list);
+    rpc->setForwardList({id2, id3});
+    sl->getEntry(id2)->updateVersion = 3;
+    sl->getEntry(id3)->updateVersion = 3;
+    sl->numUpdatingServers = 2;
+
+    // id2 received the update; id3 didn't.
+    rpc->response->emplaceAppend<WireFormat::UpdateServerList::Response>();
+    Forwarded results[] = {{id2.getId(), 3}, {id3.getId(), 0}};
+    rpc->response->appendCopy(results, sizeof32(results));
+    sl->forwardingFinished(rpc.get(), true);
+    EXPECT_EQ(3lu, sl->getEntry(id2)->verifiedVersion);
+    EXPECT_EQ(0lu, sl->getEntry(id3)->verifiedVersion);
+    EXPECT_EQ(0lu, sl->getEntry(id3)->updateVersion);
+    EXPECT_FALSE(sl->getEntry(id2)->forwardingFailed);
+    EXPECT_TRUE(sl->getEntry(id3)->forwardingFailed);
+    EXPECT_EQ(0lu, sl->numUpdatingServers);
+    EXPECT_EQ(0u, rpc->forwardedServers.size());
+
+    // A direct update clears forwardingFailed.
+    sl->getEntry(id3)->updateVersion = 3;
+    sl->numUpdatingServers = 1;
+    sl->workSuccess(id3, 3);
+    EXPECT_FALSE(sl->getEntry(id3)->forwardingFailed);
+}
+
 TEST_F(CoordinatorServerListTest, getWork_updateStatsAndPrune) {
     // Create two servers.
     ServerId id1 = sl->enlistServer(
@@ -1763,11 +1871,11 @@ TEST_F(CoordinatorServerListTest, appendServerList) {
     CoordinatorServerList::UpdateServerListRpc rpc(&context, {}, &list1);
     rpc.appendServerList(&list2);
     EXPECT_EQ("opcode: UPDATE_SERVER_LIST, "
-            "protobuf: server { services: 16 server_id: 1 "
+            "delta: server { services: 16 server_id: 1 "
             "service_locator: \"mock:host=server1\" "
             "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
             "version_number: 1 type: UPDATE, "
-            "protobuf: server { services: 16 server_id: 2 "
+            "delta: server { services: 16 server_id: 2 "
             "service_locator: \"mock:host=server2\" "
             "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
             "version_number: 2 type: UPDATE",
@@ -54,6 +54,7 @@ CoordinatorService::CoordinatorService(Context* context,
     , leaseAuthority(context)
     , runtimeOptions()
     , recoveryManager(context, tableManager, &runtimeOptions)
+    , tabletBalancer(context, &tableManager, &runtimeOptions)
     , activeVerifications()
     , mutex("CoordinatorService::mutex")
     , forceServerDownForTesting(false)
@@ -64,6 +65,7 @@ CoordinatorService::CoordinatorService(Context* context,
 {
     context->services[WireFormat::COORDINATOR_SERVICE] = this;
     context->recoveryManager = &recoveryManager;
+    context->metricsRegistry->addCollector(this);
 
     // Invoke the rest of initialization in a separate thread (except during
     // unit tests). This is needed because some of the recovery operations
@@ -81,7 +83,9 @@ CoordinatorService::CoordinatorService(Context* context,
 
 CoordinatorService::~CoordinatorService()
 {
+    context->metricsRegistry->removeCollector(this);
     context->services[WireFormat::COORDINATOR_SERVICE] = NULL;
+    tabletBalancer.halt();
     recoveryManager.halt();
 }
 
@@ -124,6 +128,7 @@ CoordinatorService::init(CoordinatorService* service,
             // it will need accurate information about which tables are stored
             // on a crashed server).
             service->recoveryManager.start();
+            service->tabletBalancer.start();
         }
 
 
@@ -241,6 +246,23 @@ CoordinatorService::dispatch(WireFormat::Opcode opcode,
     }
 }
 
+/**
+ * Adds the number of masters and backups in the cluster to a metrics
+ * snapshot (see MetricsRegistry::Collector::collect).
+ */
+void
+CoordinatorService::collect(MetricsRegistry::Snapshot* snapshot)
+{
+    snapshot->emplace_back("ramcloud_cluster_servers",
+            MetricsRegistry::GAUGE,
+            MetricsRegistry::label("service", string("master")),
+            serverList.masterCount());
+    snapshot->emplace_back("ramcloud_cluster_servers",
+            MetricsRegistry::GAUGE,
+            MetricsRegistry::label("service", string("backup")),
+            serverList.backupCount());
+}
+
 /**
  * Get a reference to the runtimeOptions in the Coordinator
  */
@@ -477,7 +499,13 @@ CoordinatorService::getTableConfig(
         Rpc* rpc)
 {
     ProtoBuf::TableConfig tableConfig;
-    tableManager.serializeTableConfig(&tableConfig, reqHdr->tableId);
+    uint64_t epoch = reqHdr->knownEpoch;
+    uint64_t version = reqHdr->knownVersion;
+    bool delta = tableManager.serializeTableConfigChanges(&tableConfig,
+            reqHdr->tableId, &epoch, &version);
+    respHdr->configEpoch = epoch;
+    respHdr->configVersion = version;
+    respHdr->delta = delta;
     respHdr->tableConfigLength = serializeToResponse(rpc->replyPayload,
                                                      &tableConfig);
 }
@@ -564,7 +592,8 @@ CoordinatorService::reassignTabletOwnership(
     try {
         tableManager.reassignTabletOwnership(
                 newOwner, tableId, startKeyHash, endKeyHash,
-                reqHdr->ctimeSegmentId, reqHdr->ctimeSegmentOffset);
+                reqHdr->ctimeSegmentId, reqHdr->ctimeSegmentOffset,
+                ServerId(reqHdr->pullSourceId));
     } catch (const TableManager::NoSuchTable& e) {
         LOG(WARNING, "Could not reassign tablet [0x%lx,0x%lx] in tableId %lu: "
             "table not found",
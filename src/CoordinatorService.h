@@ -28,12 +28,14 @@
 #include "CoordinatorServerList.h"
 #include "CoordinatorUpdateManager.h"
 #include "MasterRecoveryManager.h"
+#include "MetricsRegistry.h"
 #include "PingClient.h"
 #include "RawMetrics.h"
 #include "Recovery.h"
 #include "RuntimeOptions.h"
 #include "Service.h"
 #include "TableManager.h"
+#include "TabletBalancer.h"
 #include "TransportManager.h"
 #include "ServerConfig.h"
 
@@ -42,13 +44,15 @@ namespace RAMCloud {
 /**
  * Serves RPCs for the cluster coordinator.
  */
-class CoordinatorService : public Service {
+class CoordinatorService : public Service
+                         , public MetricsRegistry::Collector {
   public:
     explicit CoordinatorService(Context* context,
                                 uint32_t deadServerTimeout,
                                 bool unitTesting = false,
                                 bool neverKill = false);
     ~CoordinatorService();
+    void collect(MetricsRegistry::Snapshot* snapshot);
     void dispatch(WireFormat::Opcode opcode,
             Rpc* rpc);
     RuntimeOptions *getRuntimeOptionsFromCoordinator();
@@ -200,6 +204,11 @@ class CoordinatorService : public Service {
      */
     MasterRecoveryManager recoveryManager;
 
+    /**
+     * Splits and migrates hot tablets to spread load across masters.
+     */
+    TabletBalancer tabletBalancer;
+
     /**
      * Keeps track of the servers that we are currently checking to see if
      * they have failed,so we don't start multiple simultaneous checks
@@ -230,6 +230,30 @@ TEST_F(CoordinatorServiceTest, getTableConfig_indexInfo) {
     EXPECT_EQ("", tableConfigProtoBuf.ShortDebugString());
 }
 
+TEST_F(CoordinatorServiceTest, getTableConfig_delta) {
+    ramcloud->createTable("foo");
+    ProtoBuf::TableConfig tableConfig;
+    uint64_t epoch, version;
+    GetTableConfigRpc rpc(&context, 1);
+    EXPECT_FALSE(rpc.wait(&tableConfig, &epoch, &version));
+    EXPECT_EQ(1, tableConfig.tablet_size());
+
+    ramcloud->splitTablet("foo", 0x1000);
+    GetTableConfigRpc rpc2(&context, 1, epoch, version);
+    tableConfig.Clear();
+    EXPECT_TRUE(rpc2.wait(&tableConfig, &epoch, &version));
+    EXPECT_EQ("tablet { table_id: 1 start_key_hash: 0 end_key_hash: 4095 "
+              "state: NORMAL server_id: 1 "
+              "service_locator: \"mock:host=master\" "
+              "ctime_log_head_id: 0 ctime_log_head_offset: 0 } "
+              "tablet { table_id: 1 start_key_hash: 4096 "
+              "end_key_hash: 18446744073709551615 "
+              "state: NORMAL server_id: 1 "
+              "service_locator: \"mock:host=master\" "
+              "ctime_log_head_id: 0 ctime_log_head_offset: 0 }",
+              tableConfig.ShortDebugString());
+}
+
 TEST_F(CoordinatorServiceTest, getTableConfig_invalid) {
     ramcloud->createTable("bar");
     ProtoBuf::TableConfig tableConfig;
@@ -13,8 +13,10 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include "CompressedObject.h"
 #include "Enumeration.h"
 #include "Object.h"
+#include "WallTime.h"
 
 namespace RAMCloud {
 
@@ -64,7 +66,11 @@ enumerateBucket(uint64_t reference, void* cookie)
     Buffer buffer;
     type = args.log->getEntry(Log::Reference(reference), buffer);
 
-    if (type != LOG_ENTRY_TYPE_OBJ)
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJCOMP)
+        return;
+
+    // Expired objects are treated as if they had been deleted.
+    if (Object(buffer).isExpired(WallTime::secondsTimestamp()))
         return;
 
     // Filter objects by table and tablet hash range.
@@ -132,11 +138,17 @@ appendObjectsToBuffer(Log& log,
                       uint32_t maxBytes, bool keysOnly)
 {
     for (uint32_t index = 0; index < references.size(); index++) {
-        Buffer objectBuffer;
-        log.getEntry(references[index], objectBuffer);
+        Buffer entryBuffer;
+        Buffer decompressedBuffer;
+        Buffer* objectBuffer = &entryBuffer;
+        if (log.getEntry(references[index], entryBuffer) ==
+                LOG_ENTRY_TYPE_OBJCOMP) {
+            CompressedObject::decompress(entryBuffer, &decompressedBuffer);
+            objectBuffer = &decompressedBuffer;
+        }
 
-        Object object(objectBuffer);
-        uint32_t length = objectBuffer.size();
+        Object object(*objectBuffer);
+        uint32_t length = objectBuffer->size();
         if (keysOnly) {
             uint32_t dataLength = object.getValueLength();
             length -= dataLength;
@@ -147,7 +159,7 @@ appendObjectsToBuffer(Log& log,
         }
 
         buffer->emplaceAppend<uint32_t>(length);
-        buffer->append(&objectBuffer, 0, length);
+        buffer->append(objectBuffer, 0, length);
     }
 
     return -1;
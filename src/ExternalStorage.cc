@@ -81,6 +81,33 @@ ExternalStorage::getWorkspace()
     return workspace.c_str();
 }
 
+/**
+ * Set the values of several objects in a single atomic operation: either
+ * all of the writes are made durable, or none of them are. Each write has
+ * the same effect as a call to "set". Writes are applied in order, so if
+ * the same object appears more than once, the last value wins. Storage
+ * systems limit the size of a single operation, so implementations may
+ * divide a large set of writes into several atomic pieces.
+ *
+ * The default implementation simply invokes "set" for each write, so it is
+ * neither atomic nor faster than individual calls; storage systems that
+ * can commit several objects in one round trip should override it.
+ *
+ * \param writes
+ *      Objects to write. The contents of the vector may be modified by
+ *      this method (e.g., to correct hints).
+ *
+ * \throws LostLeadershipException
+ */
+void
+ExternalStorage::setMulti(vector<Write>* writes)
+{
+    foreach (Write& write, *writes) {
+        set(write.flavor, write.name.c_str(), write.value.data(),
+                downCast<int>(write.value.size()));
+    }
+}
+
 // See header file for documentation.
 void
 ExternalStorage::setWorkspace(const char* pathPrefix)
@@ -134,6 +134,30 @@ class ExternalStorage {
         UPDATE                     // An existing object is being overwritten.
     };
 
+    /**
+     * Describes one object to be written by setMulti. The arguments to
+     * the constructor have the same meaning as those of "set"; the name
+     * and value are copied.
+     */
+    struct Write {
+        Write(Hint flavor, const char* name, const char* value,
+                int valueLength = -1)
+            : flavor(flavor)
+            , name(name)
+            , value(value, (valueLength < 0) ? strlen(value)
+                    : static_cast<size_t>(valueLength))
+        {}
+
+        /// Hint::CREATE or Hint::UPDATE, as for "set".
+        Hint flavor;
+
+        /// Name of the object (relative or absolute).
+        string name;
+
+        /// New value for the object.
+        string value;
+    };
+
     ExternalStorage();
     virtual ~ExternalStorage() {}
 
@@ -281,6 +305,8 @@ class ExternalStorage {
     virtual void set(Hint flavor, const char* name, const char* value,
             int valueLength = -1) = 0;
 
+    virtual void setMulti(vector<Write>* writes);
+
     /**
      * Specify the current workspace for the application. This is
      * equivalent to a working directory: if a node name specified to
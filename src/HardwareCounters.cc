@@ -0,0 +1,131 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "HardwareCounters.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+bool HardwareCounters::enabled = false;
+__thread HardwareCounters::Group* HardwareCounters::threadGroup = NULL;
+
+/**
+ * Open the counters for the current thread. Invoked by read the first
+ * time a thread reads the counters.
+ *
+ * \return
+ *      The counters for the thread (also stored in threadGroup); if they
+ *      couldn't be opened, the group is marked unusable.
+ */
+HardwareCounters::Group*
+HardwareCounters::openGroup()
+{
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[NUM_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+
+    Group* group = new Group;
+    group->usable = true;
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        group->fds[i] = -1;
+        group->pages[i] = NULL;
+    }
+    long pageSize = sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        int fd = downCast<int>(syscall(__NR_perf_event_open, &attr, 0, -1,
+                group->fds[0], 0));
+        if (fd < 0) {
+            // Only complain once per process: every worker thread will
+            // fail the same way.
+            static bool warned = false;
+            if (!warned) {
+                warned = true;
+                LOG(WARNING, "Couldn't open hardware performance counters: "
+                        "%s (see /proc/sys/kernel/perf_event_paranoid)",
+                        strerror(errno));
+            }
+            for (int j = 0; j < i; j++) {
+                if (group->pages[j] != NULL) {
+                    munmap(group->pages[j], pageSize);
+                    group->pages[j] = NULL;
+                }
+                close(group->fds[j]);
+                group->fds[j] = -1;
+            }
+            group->usable = false;
+            break;
+        }
+        group->fds[i] = fd;
+        void* page = mmap(NULL, pageSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (page != MAP_FAILED) {
+            group->pages[i] = static_cast<perf_event_mmap_page*>(page);
+        }
+    }
+    threadGroup = group;
+    return group;
+}
+
+/**
+ * Read the counters with system calls rather than rdpmc. Used by read
+ * when rdpmc isn't available.
+ *
+ * \param group
+ *      The counters for the current thread.
+ * \param[out] reading
+ *      The current values of the counters are stored here.
+ * \return
+ *      True means success; false means the counters couldn't be read.
+ */
+bool
+HardwareCounters::readSlow(Group* group, Reading* reading)
+{
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        if (::read(group->fds[i], &reading->values[i],
+                sizeof(reading->values[i])) != sizeof(reading->values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Turn counter collection on or off for all threads.
+ *
+ * \param enable
+ *      True means that read will return counter values from now on;
+ *      false means that it will return false.
+ */
+void
+HardwareCounters::setEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+} // namespace RAMCloud
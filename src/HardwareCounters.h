@@ -0,0 +1,171 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_HARDWARECOUNTERS_H
+#define RAMCLOUD_HARDWARECOUNTERS_H
+
+#include <linux/perf_event.h>
+
+#include "Common.h"
+#include "Util.h"
+
+namespace RAMCloud {
+
+/**
+ * This class provides cheap access to a few hardware performance counters
+ * (instructions retired, last-level cache misses, and branch mispredicts)
+ * for the current thread. The counters are opened with perf_event_open the
+ * first time a thread reads them, as a group so that they are all counted
+ * over the same intervals; after that they are read from user space with
+ * rdpmc, which takes a few tens of cycles per counter. If the kernel
+ * doesn't allow rdpmc, the counters are read with system calls instead,
+ * which is much slower.
+ *
+ * Counting is off unless enabled with setEnabled; when it is off, read
+ * costs a single test of a static variable. The counters only count
+ * user-level events.
+ */
+class HardwareCounters {
+  PUBLIC:
+    /// The events that are counted; each one is an index into
+    /// Reading::values.
+    enum Event {
+        INSTRUCTIONS = 0,
+        LLC_MISSES = 1,
+        BRANCH_MISSES = 2,
+        NUM_EVENTS = 3
+    };
+
+    /// The values of all of the counters at one point in time. Only the
+    /// differences between two readings by the same thread are meaningful.
+    struct Reading {
+        uint64_t values[NUM_EVENTS];
+
+        /**
+         * Replace each value with the difference between it and the
+         * corresponding value in an earlier reading.
+         */
+        void
+        subtract(const Reading& earlier)
+        {
+            for (int i = 0; i < NUM_EVENTS; i++) {
+                values[i] -= earlier.values[i];
+            }
+        }
+    };
+
+    /**
+     * Read all of the counters for the current thread.
+     *
+     * \param[out] reading
+     *      The current values of the counters are stored here.
+     * \return
+     *      True means \a reading is valid; false means counting is
+     *      disabled, or the counters couldn't be opened for this thread.
+     */
+    static inline bool
+    read(Reading* reading)
+    {
+        if (!enabled) {
+            return false;
+        }
+        Group* group = threadGroup;
+        if (expect_false(group == NULL)) {
+            group = openGroup();
+        }
+        if (!group->usable) {
+            return false;
+        }
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            if (!readPage(group->pages[i], &reading->values[i])) {
+                return readSlow(group, reading);
+            }
+        }
+        return true;
+    }
+
+    static void setEnabled(bool enable);
+
+    /// True means that counters are being read; see setEnabled.
+    static bool enabled;
+
+  PRIVATE:
+    /**
+     * The counters for one thread. Groups are never freed, since the
+     * counters stay attached to a thread until it exits.
+     */
+    struct Group {
+        /// False means the counters couldn't be opened, so this thread
+        /// can't collect counts.
+        bool usable;
+
+        /// File descriptors from perf_event_open for each counter (-1
+        /// means not open).
+        int fds[NUM_EVENTS];
+
+        /// Metadata page mapped from each counter's file descriptor,
+        /// which tells how to read the counter with rdpmc; NULL means the
+        /// page couldn't be mapped.
+        perf_event_mmap_page* pages[NUM_EVENTS];
+    };
+
+    /**
+     * Read one counter using rdpmc, following the protocol described in
+     * linux/perf_event.h.
+     *
+     * \param page
+     *      The counter's metadata page (may be NULL).
+     * \param[out] value
+     *      The counter's value is stored here.
+     * \return
+     *      False means the counter can't be read from user space at the
+     *      moment (e.g., it isn't scheduled on the PMU, or the kernel
+     *      doesn't allow rdpmc).
+     */
+    static inline bool
+    readPage(volatile perf_event_mmap_page* page, uint64_t* value)
+    {
+        if (page == NULL) {
+            return false;
+        }
+        uint32_t seq;
+        do {
+            seq = page->lock;
+            __asm__ __volatile__("" ::: "memory");
+            uint32_t index = page->index;
+            if (!page->cap_user_rdpmc || (index == 0)) {
+                return false;
+            }
+            int shift = 64 - page->pmc_width;
+            int64_t count = static_cast<int64_t>(
+                    Util::readPmc(static_cast<int>(index - 1)) << shift)
+                    >> shift;
+            *value = page->offset + count;
+            __asm__ __volatile__("" ::: "memory");
+        } while (page->lock != seq);
+        return true;
+    }
+
+    static Group* openGroup();
+    static bool readSlow(Group* group, Reading* reading);
+
+    /// Counters for the current thread; NULL means the thread hasn't read
+    /// the counters yet.
+    static __thread Group* threadGroup;
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_HARDWARECOUNTERS_H
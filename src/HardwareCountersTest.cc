@@ -0,0 +1,106 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "HardwareCounters.h"
+
+namespace RAMCloud {
+
+class HardwareCountersTest : public ::testing::Test {
+  public:
+    HardwareCounters::Group group;
+    perf_event_mmap_page page;
+
+    HardwareCountersTest()
+        : group()
+        , page()
+    {
+        memset(&page, 0, sizeof(page));
+        page.index = 3;
+        page.cap_user_rdpmc = 1;
+        page.pmc_width = 48;
+        page.offset = 1000;
+        group.usable = true;
+        for (int i = 0; i < HardwareCounters::NUM_EVENTS; i++) {
+            group.fds[i] = -1;
+            group.pages[i] = &page;
+        }
+        HardwareCounters::setEnabled(true);
+        HardwareCounters::threadGroup = &group;
+    }
+
+    ~HardwareCountersTest()
+    {
+        HardwareCounters::setEnabled(false);
+        HardwareCounters::threadGroup = NULL;
+        Util::mockPmcValue = 0;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(HardwareCountersTest);
+};
+
+TEST_F(HardwareCountersTest, read_disabled) {
+    HardwareCounters::setEnabled(false);
+    HardwareCounters::Reading reading;
+    EXPECT_FALSE(HardwareCounters::read(&reading));
+}
+
+TEST_F(HardwareCountersTest, read_unusable) {
+    group.usable = false;
+    HardwareCounters::Reading reading;
+    EXPECT_FALSE(HardwareCounters::read(&reading));
+}
+
+TEST_F(HardwareCountersTest, read_rdpmc) {
+    Util::mockPmcValue = 234;
+    HardwareCounters::Reading reading;
+    EXPECT_TRUE(HardwareCounters::read(&reading));
+    EXPECT_EQ(1234u, reading.values[HardwareCounters::INSTRUCTIONS]);
+    EXPECT_EQ(1234u, reading.values[HardwareCounters::BRANCH_MISSES]);
+}
+
+TEST_F(HardwareCountersTest, read_slowPathFails) {
+    // rdpmc isn't allowed, and the file descriptors are bogus.
+    page.cap_user_rdpmc = 0;
+    HardwareCounters::Reading reading;
+    EXPECT_FALSE(HardwareCounters::read(&reading));
+}
+
+TEST_F(HardwareCountersTest, readPage_signExtend) {
+    // The counter is only 48 bits wide; its value is -1.
+    Util::mockPmcValue = 0xffffffffffffUL;
+    uint64_t value;
+    EXPECT_TRUE(HardwareCounters::readPage(&page, &value));
+    EXPECT_EQ(999u, value);
+}
+
+TEST_F(HardwareCountersTest, readPage_notAvailable) {
+    uint64_t value;
+    EXPECT_FALSE(HardwareCounters::readPage(NULL, &value));
+    page.index = 0;
+    EXPECT_FALSE(HardwareCounters::readPage(&page, &value));
+}
+
+TEST_F(HardwareCountersTest, subtract) {
+    HardwareCounters::Reading before = {{10, 20, 30}};
+    HardwareCounters::Reading after = {{15, 27, 30}};
+    after.subtract(before);
+    EXPECT_EQ(5u, after.values[0]);
+    EXPECT_EQ(7u, after.values[1]);
+    EXPECT_EQ(0u, after.values[2]);
+}
+
+}  // namespace RAMCloud
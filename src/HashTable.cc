@@ -15,6 +15,7 @@
 
 #include "Common.h"
 #include "HashTable.h"
+#include "Numa.h"
 
 namespace RAMCloud {
 
@@ -485,6 +486,18 @@ HashTable::getNumBuckets() const
     return numBuckets;
 }
 
+/**
+ * Spread the table's memory evenly across all of the machine's NUMA nodes,
+ * so that threads on every node see the same average access latency
+ * (rather than all of the memory being on the node of the thread that
+ * created the table).
+ */
+void
+HashTable::interleaveAcrossNumaNodes()
+{
+    Numa::interleaveMemory(buckets.get(), buckets.length);
+}
+
 /**
  * Find the bucket index corresponding to a particular key.
  * This also calculates the secondary hash bits used to disambiguate entries
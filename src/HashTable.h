@@ -207,6 +207,7 @@ class HashTable {
     ~HashTable();
     void lookup(KeyHash keyHash, Candidates& candidates);
     void insert(KeyHash keyHash, uint64_t reference);
+    void interleaveAcrossNumaNodes();
     uint64_t forEachInBucket(void (*callback)(uint64_t, void *),
                              void *cookie,
                              uint64_t bucket);
@@ -0,0 +1,720 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "AbstractServerList.h"
+#include "ClientException.h"
+#include "Cycles.h"
+#include "HotKeyReplicas.h"
+#include "MasterClient.h"
+#include "ObjectManager.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a HotKeyReplicas. The owner side of the mechanism does nothing
+ * until start() is invoked.
+ *
+ * \param context
+ *      Overall information about this server.
+ * \param config
+ *      The server's configuration; config->master.hotKeyReplicas determines
+ *      how many copies to make of each hot object (0 means none).
+ * \param serverId
+ *      This server's id; it will be filled in once the server enlists.
+ * \param objectManager
+ *      Used to read the current contents of hot objects.
+ * \param tracker
+ *      Samples the reads of this master's objects; hot objects are chosen
+ *      from the keys it reports with takeHotReads.
+ */
+HotKeyReplicas::HotKeyReplicas(Context* context, const ServerConfig* config,
+        ServerId* serverId, ObjectManager* objectManager,
+        HotKeyTracker* tracker)
+    : context(context)
+    , numReplicas(std::min(config->master.hotKeyReplicas,
+            uint32_t(MAX_REPLICAS)))
+    , serverId(serverId)
+    , objectManager(objectManager)
+    , tracker(tracker)
+    , mutex("HotKeyReplicas::mutex")
+    , hotObjects()
+    , anyHotObjects(false)
+    , lastPushId(0)
+    , pushInProgress(0)
+    , copies()
+    , anyCopies(false)
+    , pusher(this)
+{
+}
+
+HotKeyReplicas::~HotKeyReplicas()
+{
+    pusher.stop();
+}
+
+/**
+ * Begin looking for hot objects and pushing copies of them (if enabled by
+ * the server's configuration).
+ */
+void
+HotKeyReplicas::start()
+{
+    if (numReplicas == 0)
+        return;
+    if (tracker->getSampleInterval() == 0) {
+        LOG(WARNING, "Hot key replication is disabled because "
+                "hotKeySampleInterval is 0");
+        return;
+    }
+    pusher.start(Cycles::rdtsc() +
+            Cycles::fromMicroseconds(PUSH_INTERVAL_MS * 1000));
+}
+
+/**
+ * Stop pushing copies of hot objects. Existing copies expire when their
+ * leases run out, and will still be invalidated if their objects change.
+ */
+void
+HotKeyReplicas::stop()
+{
+    pusher.stop();
+}
+
+/**
+ * If copies of an object are available on other masters, append their
+ * service locators to a read response so that the client can spread future
+ * reads of the object across them.
+ *
+ * \param key
+ *      Key of the object that was read.
+ * \param response
+ *      Read response, which already holds the object's value; the replica
+ *      information is appended here (see WireFormat::Read::Response).
+ * \param[out] numLocators
+ *      Number of service locators appended to \a response.
+ * \param[out] locatorsLength
+ *      Total number of bytes appended to \a response.
+ */
+void
+HotKeyReplicas::appendReplicas(Key& key, Buffer* response,
+        uint8_t* numLocators, uint16_t* locatorsLength)
+{
+    *numLocators = 0;
+    *locatorsLength = 0;
+    if (!anyHotObjects)
+        return;
+
+    ObjectId id(key.getTableId(),
+            string(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    SpinLock::Guard _(mutex);
+    HotObjectMap::iterator it = hotObjects.find(id);
+    if (it == hotObjects.end() || !it->second.advertised)
+        return;
+
+    // Stop sending clients to copies whose leases are about to run out
+    // without having been renewed.
+    HotObject& object = it->second;
+    if (Cycles::toNanoseconds(Cycles::rdtsc() - object.lastPush) >
+            LEASE_MS * 1000000UL / 2)
+        return;
+
+    uint32_t initialLength = response->size();
+    foreach (const string& locator, object.locators) {
+        uint16_t length = downCast<uint16_t>(locator.length());
+        response->emplaceAppend<uint16_t>(length);
+        response->appendCopy(locator.c_str(), length);
+    }
+    *numLocators = downCast<uint8_t>(object.locators.size());
+    *locatorsLength = downCast<uint16_t>(response->size() - initialLength);
+}
+
+/**
+ * This method must be invoked before an object owned by this master is
+ * modified, with the object's hash table bucket lock held. If there are
+ * copies of the object on other masters, it stops them from being advertised
+ * to clients or pushed again, and records them in \a invalidation, which
+ * drops them when it is destroyed.
+ *
+ * \param key
+ *      Key of the object about to be modified.
+ * \param invalidation
+ *      Filled in with the copies to drop. The caller must destroy it after
+ *      releasing the bucket lock and before acknowledging the modification.
+ */
+void
+HotKeyReplicas::invalidate(Key& key, Invalidation* invalidation)
+{
+    if (!anyHotObjects)
+        return;
+
+    ObjectId id(key.getTableId(),
+            string(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    SpinLock::Guard _(mutex);
+    HotObjectMap::iterator it = hotObjects.find(id);
+    if (it == hotObjects.end())
+        return;
+    HotObject& object = it->second;
+    object.invalidations++;
+    object.advertised = false;
+    invalidation->hotKeyReplicas = this;
+    invalidation->id = id;
+    invalidation->replicas = object.replicas;
+    invalidation->pushId = lastPushId;
+}
+
+/**
+ * This method is invoked, with the object's hash table bucket lock held,
+ * before this master reads an object it owns on behalf of a client. It
+ * indicates whether the object was modified and the copies of its old value
+ * may not all have been dropped yet, in which case the object must not be
+ * returned: a client could see the new value here and then the old value
+ * on a replica.
+ *
+ * \param key
+ *      Key of the object about to be read.
+ * \return
+ *      True means the read must be retried later.
+ */
+bool
+HotKeyReplicas::isInvalidating(Key& key)
+{
+    if (!anyHotObjects)
+        return false;
+
+    ObjectId id(key.getTableId(),
+            string(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    SpinLock::Guard _(mutex);
+    HotObjectMap::iterator it = hotObjects.find(id);
+    return it != hotObjects.end() && it->second.invalidations != 0;
+}
+
+/**
+ * This method is invoked when this master gives up ownership of a tablet.
+ * It drops all copies of the tablet's objects, since the new owner won't
+ * know to invalidate them. The tablet must not accept any more writes.
+ *
+ * \param tableId
+ *      Identifier for the table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ */
+void
+HotKeyReplicas::dropTablet(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash)
+{
+    if (!anyHotObjects)
+        return;
+
+    vector<std::pair<ObjectId, vector<ServerId>>> dropped;
+    uint64_t pushId;
+    {
+        SpinLock::Guard _(mutex);
+        for (HotObjectMap::iterator it = hotObjects.begin();
+                it != hotObjects.end(); ) {
+            Key key(it->first.first, it->first.second.c_str(),
+                    downCast<KeyLength>(it->first.second.length()));
+            if (key.getTableId() != tableId ||
+                    key.getHash() < firstKeyHash ||
+                    key.getHash() > lastKeyHash) {
+                it++;
+                continue;
+            }
+            dropped.push_back(std::make_pair(it->first,
+                    it->second.replicas));
+            it = hotObjects.erase(it);
+        }
+        anyHotObjects = !hotObjects.empty();
+        pushId = lastPushId;
+    }
+
+    bool allDropped = true;
+    for (size_t i = 0; i < dropped.size(); i++) {
+        if (!dropCopies(dropped[i].first, dropped[i].second, pushId))
+            allDropped = false;
+    }
+    if (!allDropped)
+        waitForLeases(pushId);
+}
+
+/**
+ * Decide which objects were hot during the window that just ended, and push
+ * fresh copies of them to their replicas. Normally invoked by the Pusher.
+ *
+ * \return
+ *      The number of objects whose copies were successfully pushed.
+ */
+uint32_t
+HotKeyReplicas::pushHotKeys()
+{
+    if (numReplicas == 0)
+        return 0;
+
+    vector<ObjectId> hot;
+    {
+        vector<SpaceSaving<ObjectId>::Item> top;
+        uint64_t total = tracker->takeHotReads(&top);
+        SpinLock::Guard _(mutex);
+
+        for (HotObjectMap::iterator it = hotObjects.begin();
+                it != hotObjects.end(); it++) {
+            it->second.hot = false;
+        }
+        foreach (const SpaceSaving<ObjectId>::Item& item, top) {
+            HotObjectMap::iterator it = hotObjects.find(item.key);
+            size_t numCopies = 0;
+            if (it != hotObjects.end() && it->second.advertised)
+                numCopies = it->second.replicas.size();
+            if (isHot(item.count, total, numCopies))
+                hotObjects[item.key].hot = true;
+        }
+
+        // Objects that have cooled off are no longer renewed; forget them
+        // once any copies they might have are sure to have expired.
+        uint64_t now = Cycles::rdtsc();
+        for (HotObjectMap::iterator it = hotObjects.begin();
+                it != hotObjects.end(); ) {
+            if (it->second.hot) {
+                hot.push_back(it->first);
+            } else if (it->second.invalidations == 0 &&
+                    Cycles::toNanoseconds(now - it->second.lastPush) >
+                    2 * LEASE_MS * 1000000UL) {
+                it = hotObjects.erase(it);
+                continue;
+            }
+            it++;
+        }
+        anyHotObjects = !hotObjects.empty();
+    }
+
+    uint32_t pushed = 0;
+    foreach (const ObjectId& id, hot) {
+        if (pushObject(id))
+            pushed++;
+    }
+    return pushed;
+}
+
+/**
+ * This method is invoked when another master pushes a copy of one of its
+ * hot objects here; it stores the copy so that #readCopy can serve it.
+ *
+ * \param key
+ *      Key of the object.
+ * \param pushId
+ *      The owner's identifier for this push.
+ * \param version
+ *      Version of the object.
+ * \param leaseMs
+ *      How long the copy may be served, in milliseconds.
+ * \param value
+ *      Buffer containing the object's value.
+ * \param valueOffset
+ *      Offset of the value within \a value.
+ * \param valueLength
+ *      Length of the value in bytes.
+ * \return
+ *      STATUS_OK if the copy was stored, or STATUS_STALE_RPC if the object
+ *      has been modified since the owner read it for this push.
+ */
+Status
+HotKeyReplicas::storeCopy(Key& key, uint64_t pushId, uint64_t version,
+        uint32_t leaseMs, Buffer* value, uint32_t valueOffset,
+        uint32_t valueLength)
+{
+    ObjectId id(key.getTableId(),
+            string(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    uint64_t now = Cycles::rdtsc();
+    SpinLock::Guard _(mutex);
+
+    // There should only ever be a handful of copies, so just clean out the
+    // expired ones every time a new one arrives.
+    for (CopyMap::iterator it = copies.begin(); it != copies.end(); ) {
+        if (it->second.expiration < now)
+            it = copies.erase(it);
+        else
+            it++;
+    }
+
+    Copy& copy = copies[id];
+    anyCopies = true;
+    if (pushId <= copy.pushId)
+        return STATUS_STALE_RPC;
+    copy.value.resize(valueLength);
+    value->copy(valueOffset, valueLength, &copy.value[0]);
+    copy.version = version;
+    copy.pushId = pushId;
+    copy.valid = true;
+    copy.expiration = now + Cycles::fromMicroseconds(leaseMs * 1000UL);
+    return STATUS_OK;
+}
+
+/**
+ * This method is invoked when the owner of an object modifies it; it
+ * discards any copy of the object held here.
+ *
+ * \param key
+ *      Key of the object.
+ * \param pushId
+ *      The highest pushId the owner had assigned when it invalidated the
+ *      object: pushes with this id or lower carry the old contents.
+ */
+void
+HotKeyReplicas::dropCopy(Key& key, uint64_t pushId)
+{
+    ObjectId id(key.getTableId(),
+            string(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    SpinLock::Guard _(mutex);
+    Copy& copy = copies[id];
+    anyCopies = true;
+
+    // A copy from a later push already reflects the modification.
+    if (copy.pushId > pushId)
+        return;
+
+    // Remember the pushId for a while, in case a stale push is still on its
+    // way here.
+    copy.value.clear();
+    copy.pushId = pushId;
+    copy.valid = false;
+    copy.expiration = Cycles::rdtsc() +
+            Cycles::fromMicroseconds(2 * LEASE_MS * 1000UL);
+}
+
+/**
+ * This method is invoked by MasterService when a read arrives for an object
+ * this master doesn't own; if we hold a current copy of the object, it is
+ * returned.
+ *
+ * \param key
+ *      Key of the object.
+ * \param[out] value
+ *      The object's value is appended here.
+ * \param[out] version
+ *      The object's version is returned here.
+ * \return
+ *      STATUS_OK if the copy was returned, or STATUS_UNKNOWN_TABLET if we
+ *      don't have one (the client should then go to the owner).
+ */
+Status
+HotKeyReplicas::readCopy(Key& key, Buffer* value, uint64_t* version)
+{
+    if (!anyCopies)
+        return STATUS_UNKNOWN_TABLET;
+
+    ObjectId id(key.getTableId(),
+            string(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    SpinLock::Guard _(mutex);
+    CopyMap::iterator it = copies.find(id);
+    if (it == copies.end() || !it->second.valid ||
+            it->second.expiration < Cycles::rdtsc())
+        return STATUS_UNKNOWN_TABLET;
+    value->appendCopy(it->second.value.c_str(),
+            downCast<uint32_t>(it->second.value.length()));
+    *version = it->second.version;
+    return STATUS_OK;
+}
+
+/**
+ * Pick the masters that will hold copies of a hot object.
+ *
+ * \param object
+ *      Its replicas and locators are filled in with up to #numReplicas
+ *      randomly chosen masters other than this one.
+ */
+void
+HotKeyReplicas::chooseReplicas(HotObject* object)
+{
+    vector<ServerId> masters;
+    ServerId id;
+    while (true) {
+        bool end;
+        id = context->serverList->nextServer(id,
+                ServiceMask({WireFormat::MASTER_SERVICE}), &end);
+        if (end || !id.isValid())
+            break;
+        if (id != *serverId)
+            masters.push_back(id);
+    }
+
+    while (!masters.empty() && object->replicas.size() < numReplicas) {
+        size_t i = generateRandom() % masters.size();
+        try {
+            object->locators.push_back(
+                    context->serverList->getLocator(masters[i]));
+            object->replicas.push_back(masters[i]);
+        } catch (const ServerListException& e) {
+            // The server disappeared in the meantime; skip it.
+        }
+        masters.erase(masters.begin() + i);
+    }
+}
+
+/**
+ * Tell the masters holding copies of an object to discard them, and wait
+ * until they have.
+ *
+ * \param id
+ *      The object.
+ * \param replicas
+ *      Masters that may hold copies of the object.
+ * \param pushId
+ *      Pushes of the object with this pushId or lower are stale.
+ * \return
+ *      True means every copy is known to be gone; false means some replica
+ *      couldn't confirm the drop, so the caller must wait for its copy to
+ *      expire (see waitForLeases).
+ */
+bool
+HotKeyReplicas::dropCopies(const ObjectId& id,
+        const vector<ServerId>& replicas, uint64_t pushId)
+{
+    KeyLength keyLength = downCast<KeyLength>(id.second.length());
+    Tub<DropHotObjectRpc> rpcs[MAX_REPLICAS];
+    for (size_t i = 0; i < replicas.size(); i++) {
+        rpcs[i].construct(context, replicas[i], id.first, id.second.c_str(),
+                keyLength, pushId);
+    }
+    bool allDropped = true;
+    for (size_t i = 0; i < replicas.size(); i++) {
+        try {
+            rpcs[i]->wait();
+        } catch (const ServerNotUpException& e) {
+            // The replica crashed, and its copy is gone with it.
+        } catch (const ClientException& e) {
+            LOG(WARNING, "Couldn't drop copy of hot object in table %lu "
+                    "from server %s (%s); waiting for its lease to expire",
+                    id.first, replicas[i].toString().c_str(),
+                    e.toString());
+            allDropped = false;
+        }
+    }
+    return allDropped;
+}
+
+/**
+ * This method is invoked when an Invalidation is destroyed; it drops the
+ * copies the Invalidation recorded, and forgets the object once no other
+ * modification of it is in progress.
+ *
+ * \param invalidation
+ *      Filled in by #invalidate.
+ */
+void
+HotKeyReplicas::finishInvalidation(Invalidation* invalidation)
+{
+    if (!dropCopies(invalidation->id, invalidation->replicas,
+            invalidation->pushId))
+        waitForLeases(invalidation->pushId);
+
+    SpinLock::Guard _(mutex);
+    HotObjectMap::iterator it = hotObjects.find(invalidation->id);
+    if (it == hotObjects.end() || it->second.invalidations == 0) {
+        // dropTablet already forgot the object.
+        return;
+    }
+    if (--it->second.invalidations == 0) {
+        hotObjects.erase(it);
+        anyHotObjects = !hotObjects.empty();
+    }
+}
+
+/**
+ * Decide whether an object's reads during the last window make it hot.
+ *
+ * \param count
+ *      Number of sampled reads of the object.
+ * \param total
+ *      Number of sampled reads of all objects.
+ * \param numCopies
+ *      Number of replicas currently serving the object. The owner only sees
+ *      its share of the object's reads, so they are scaled back up.
+ */
+bool
+HotKeyReplicas::isHot(uint64_t count, uint64_t total, size_t numCopies)
+{
+    uint64_t scaledCount = count * (numCopies + 1);
+    uint64_t scaledTotal = total + count * numCopies;
+    return scaledCount >= MIN_HOT_SAMPLES &&
+            scaledCount * 100 >= scaledTotal * HOT_PERCENT;
+}
+
+/**
+ * Push the current contents of a hot object to all of its replicas.
+ *
+ * \param id
+ *      The object.
+ * \return
+ *      True means all of the replicas now hold current copies.
+ */
+bool
+HotKeyReplicas::pushObject(const ObjectId& id)
+{
+    vector<ServerId> replicas;
+    uint64_t pushId;
+    {
+        SpinLock::Guard _(mutex);
+        HotObjectMap::iterator it = hotObjects.find(id);
+        if (it == hotObjects.end() || it->second.invalidations != 0)
+            return false;
+        if (it->second.replicas.empty())
+            chooseReplicas(&it->second);
+        if (it->second.replicas.empty()) {
+            // No other masters to push to.
+            hotObjects.erase(it);
+            anyHotObjects = !hotObjects.empty();
+            return false;
+        }
+        replicas = it->second.replicas;
+        pushId = ++lastPushId;
+        it->second.pushId = pushId;
+        pushInProgress = pushId;
+    }
+
+    // The object must be read after assigning the pushId: if it is modified
+    // after we read it, the invalidation will carry a pushId at least as
+    // high as ours, so the replicas will reject or discard this push.
+    KeyLength keyLength = downCast<KeyLength>(id.second.length());
+    Key key(id.first, id.second.c_str(), keyLength);
+    Buffer value;
+    uint64_t version;
+    Status status;
+    try {
+        status = objectManager->readObject(key, &value, NULL, &version,
+                true);
+    } catch (const RetryException& e) {
+        // The object is being modified; the invalidation will take care
+        // of its copies.
+        SpinLock::Guard _(mutex);
+        pushInProgress = 0;
+        return false;
+    }
+    if (status != STATUS_OK) {
+        // Either the object was removed (which invalidated its copies) or
+        // the tablet is no longer ours (which dropped them).
+        SpinLock::Guard _(mutex);
+        pushInProgress = 0;
+        HotObjectMap::iterator it = hotObjects.find(id);
+        if (it != hotObjects.end() && it->second.pushId == pushId &&
+                it->second.invalidations == 0) {
+            hotObjects.erase(it);
+            anyHotObjects = !hotObjects.empty();
+        }
+        return false;
+    }
+
+    Tub<PushHotObjectRpc> rpcs[MAX_REPLICAS];
+    uint32_t leaseMs = LEASE_MS;
+    for (size_t i = 0; i < replicas.size(); i++) {
+        rpcs[i].construct(context, replicas[i], id.first, id.second.c_str(),
+                keyLength, pushId, version, leaseMs, &value);
+    }
+    vector<ServerId> crashed;
+    bool allPushed = true;
+    for (size_t i = 0; i < replicas.size(); i++) {
+        try {
+            rpcs[i]->wait();
+        } catch (const ServerNotUpException& e) {
+            crashed.push_back(replicas[i]);
+            allPushed = false;
+        } catch (const ClientException& e) {
+            allPushed = false;
+        }
+    }
+
+    SpinLock::Guard _(mutex);
+    pushInProgress = 0;
+    HotObjectMap::iterator it = hotObjects.find(id);
+    if (it == hotObjects.end() || it->second.pushId != pushId ||
+            it->second.invalidations != 0) {
+        // The object was modified while the push was in progress.
+        return false;
+    }
+    HotObject& object = it->second;
+    foreach (ServerId replica, crashed) {
+        for (size_t i = 0; i < object.replicas.size(); i++) {
+            if (object.replicas[i] == replica) {
+                object.replicas.erase(object.replicas.begin() + i);
+                object.locators.erase(object.locators.begin() + i);
+                break;
+            }
+        }
+    }
+    object.advertised = allPushed;
+    object.lastPush = Cycles::rdtsc();
+    if (!allPushed) {
+        LOG(NOTICE, "Couldn't push hot object in table %lu (key hash 0x%lx) "
+                "to all of its replicas", id.first, key.getHash());
+    }
+    return allPushed;
+}
+
+/**
+ * This method is invoked when a replica couldn't confirm that it dropped a
+ * stale copy of an object; it returns once that copy must have expired.
+ * Leases are counted on the replica from when it received the push, so it
+ * is enough to wait until any push that might carry the old value has
+ * completed, then wait for the length of a lease.
+ *
+ * \param pushId
+ *      Pushes with this pushId or lower may carry the old value.
+ */
+void
+HotKeyReplicas::waitForLeases(uint64_t pushId)
+{
+    while (true) {
+        {
+            SpinLock::Guard _(mutex);
+            if (pushInProgress == 0 || pushInProgress > pushId)
+                break;
+        }
+        usleep(100);
+    }
+    usleep(LEASE_MS * 1000);
+}
+
+/**
+ * Construct a Pusher; it won't do anything until start() is invoked.
+ *
+ * \param hotKeyReplicas
+ *      The object on whose behalf this timer pushes copies.
+ */
+HotKeyReplicas::Pusher::Pusher(HotKeyReplicas* hotKeyReplicas)
+    : WorkerTimer(hotKeyReplicas->context->dispatch)
+    , hotKeyReplicas(hotKeyReplicas)
+{
+}
+
+/**
+ * This method is invoked by the WorkerTimer mechanism at the end of each
+ * sampling window.
+ */
+void
+HotKeyReplicas::Pusher::handleTimerEvent()
+{
+    hotKeyReplicas->pushHotKeys();
+    start(Cycles::rdtsc() +
+            Cycles::fromMicroseconds(PUSH_INTERVAL_MS * 1000));
+}
+
+} // namespace RAMCloud
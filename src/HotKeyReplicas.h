@@ -0,0 +1,313 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_HOTKEYREPLICAS_H
+#define RAMCLOUD_HOTKEYREPLICAS_H
+
+#include <atomic>
+#include <map>
+
+#include "Common.h"
+#include "Buffer.h"
+#include "HotKeyTracker.h"
+#include "Key.h"
+#include "ServerConfig.h"
+#include "ServerId.h"
+#include "SpaceSaving.h"
+#include "SpinLock.h"
+#include "WorkerTimer.h"
+
+namespace RAMCloud {
+
+class ObjectManager;
+
+/**
+ * Spreads reads of individual very hot objects across several masters.
+ * Splitting and migrating tablets (see TabletBalancer) cannot help when the
+ * load is concentrated on a single key, so instead the owning master pushes
+ * read-only copies of the object to a few other masters, and tells clients
+ * about them in its read responses; clients then send subsequent reads of
+ * that object to the owner or any of the copies (see ReadRpc).
+ *
+ * Each master plays two roles:
+ * - As the owner of an object, it relies on the master's HotKeyTracker to
+ *   sample reads. Every PUSH_INTERVAL_MS the Pusher takes the most-read keys
+ *   from the tracker, and pushes a copy of each object that received a
+ *   sufficient fraction of the reads to
+ *   config.master.hotKeyReplicas other masters. Copies carry a lease, which
+ *   the Pusher renews for as long as the object stays hot.
+ * - As a replica, it stores pushed copies and serves reads from them (with
+ *   default RejectRules only) until their leases expire.
+ *
+ * Copies are invalidated whenever the owner modifies the object:
+ * ObjectManager calls #invalidate while holding the object's hash table
+ * bucket lock, which stops the copies from being advertised or pushed again,
+ * and the copies are dropped once the lock has been released (see
+ * Invalidation), before the modification is acknowledged. Every push and
+ * drop carries a pushId from the owner so that a push that was already in
+ * flight when the object changed is rejected. Until the drops complete,
+ * clients that already know about the copies may still read the old value
+ * from them, so the owner doesn't serve the object either (see
+ * #isInvalidating): reads of it are retried until the drops complete, and
+ * no read can see the new value before every copy of the old one is gone.
+ * If a replica can't confirm a drop, the modification isn't acknowledged
+ * until the copy's lease has expired.
+ *
+ * When the owner gives up a tablet, it drops the copies of the tablet's
+ * objects (see #dropTablet), since the new owner couldn't invalidate them.
+ * If the owner crashes, the lease bounds how long a replica may serve stale
+ * data.
+ *
+ * The whole mechanism is disabled unless config.master.hotKeyReplicas and
+ * config.master.hotKeySampleInterval are both nonzero. Apart from the
+ * HotKeyTracker's sampling, its cost on the read path is a check of
+ * #anyHotObjects.
+ */
+class HotKeyReplicas {
+  PUBLIC:
+    class Invalidation;
+
+    HotKeyReplicas(Context* context, const ServerConfig* config,
+            ServerId* serverId, ObjectManager* objectManager,
+            HotKeyTracker* tracker);
+    ~HotKeyReplicas();
+    void start();
+    void stop();
+
+    void appendReplicas(Key& key, Buffer* response, uint8_t* numLocators,
+            uint16_t* locatorsLength);
+    void invalidate(Key& key, Invalidation* invalidation);
+    bool isInvalidating(Key& key);
+    void dropTablet(uint64_t tableId, uint64_t firstKeyHash,
+            uint64_t lastKeyHash);
+    uint32_t pushHotKeys();
+
+    Status readCopy(Key& key, Buffer* value, uint64_t* version);
+    Status storeCopy(Key& key, uint64_t pushId, uint64_t version,
+            uint32_t leaseMs, Buffer* value, uint32_t valueOffset,
+            uint32_t valueLength);
+    void dropCopy(Key& key, uint64_t pushId);
+
+    /// Most replicas a single object may have; values of
+    /// config.master.hotKeyReplicas above this are clamped.
+    static const uint32_t MAX_REPLICAS = 8;
+
+    /// How often the Pusher looks for hot keys and renews leases. This is
+    /// also the length of the window over which reads are counted.
+    static const uint32_t PUSH_INTERVAL_MS = 100;
+
+    /// How long a replica may serve a pushed copy without a renewal.
+    static const uint32_t LEASE_MS = 500;
+
+    /// An object is hot if it received at least this percentage of the
+    /// sampled reads (see HotKeyTracker::takeHotReads) in a window...
+    static const uint32_t HOT_PERCENT = 10;
+
+    /// ... and at least this many of them.
+    static const uint32_t MIN_HOT_SAMPLES = 16;
+
+  PRIVATE:
+    /// Identifies an object: table id and primary key.
+    typedef HotKeyTracker::ObjectId ObjectId;
+
+    /**
+     * Owner-side state for an object whose copies may exist on replicas.
+     */
+    struct HotObject {
+        HotObject()
+            : replicas()
+            , locators()
+            , pushId(0)
+            , advertised(false)
+            , hot(true)
+            , lastPush(0)
+            , invalidations(0)
+        {}
+
+        /// Masters that were sent copies of this object; all of them must be
+        /// invalidated if it changes.
+        vector<ServerId> replicas;
+
+        /// Service locators for #replicas (same order); reads of the object
+        /// pass these on to clients.
+        vector<string> locators;
+
+        /// The pushId of the most recent push of this object.
+        uint64_t pushId;
+
+        /// True means every replica accepted the most recent push, so reads
+        /// should tell clients about them.
+        bool advertised;
+
+        /// True means the object was hot in the most recent window, so its
+        /// copies should be renewed.
+        bool hot;
+
+        /// Cycles::rdtsc() time when the most recent push completed. Copies
+        /// on replicas expire no later than LEASE_MS after this.
+        uint64_t lastPush;
+
+        /// Number of modifications of the object whose copies are still
+        /// being dropped. The object isn't pushed while this is nonzero,
+        /// and it is forgotten once the last of them completes.
+        uint32_t invalidations;
+    };
+
+    /**
+     * Replica-side state for an object pushed here by its owner.
+     */
+    struct Copy {
+        Copy()
+            : value()
+            , version(0)
+            , pushId(0)
+            , valid(false)
+            , expiration(0)
+        {}
+
+        /// The object's value.
+        string value;
+
+        /// The object's version.
+        uint64_t version;
+
+        /// The highest pushId seen for this object; pushes at or below it
+        /// are stale.
+        uint64_t pushId;
+
+        /// False means the copy was dropped: this entry only remembers
+        /// #pushId.
+        bool valid;
+
+        /// Cycles::rdtsc() time when the lease on the copy (or, if !valid,
+        /// the memory of #pushId) expires.
+        uint64_t expiration;
+    };
+
+    /**
+     * Runs on a worker thread every PUSH_INTERVAL_MS to push copies of hot
+     * objects.
+     */
+    class Pusher : public WorkerTimer {
+      public:
+        explicit Pusher(HotKeyReplicas* hotKeyReplicas);
+        void handleTimerEvent();
+
+      PRIVATE:
+        /// The object that owns this timer.
+        HotKeyReplicas* hotKeyReplicas;
+
+        DISALLOW_COPY_AND_ASSIGN(Pusher);
+    };
+
+    void chooseReplicas(HotObject* object);
+    bool dropCopies(const ObjectId& id, const vector<ServerId>& replicas,
+            uint64_t pushId);
+    void finishInvalidation(Invalidation* invalidation);
+    bool isHot(uint64_t count, uint64_t total, size_t numCopies);
+    bool pushObject(const ObjectId& id);
+    void waitForLeases(uint64_t pushId);
+
+    /// Shared information about the server.
+    Context* context;
+
+    /// Number of replicas to create for each hot object; 0 disables the
+    /// owner side of this mechanism.
+    const uint32_t numReplicas;
+
+    /// Id of this server; used to avoid choosing ourselves as a replica.
+    ServerId* serverId;
+
+    /// Source of the objects pushed to replicas.
+    ObjectManager* objectManager;
+
+    /// Samples the reads of this master's objects; the Pusher takes the
+    /// most-read keys from it.
+    HotKeyTracker* tracker;
+
+    /// Monitor-style lock protecting all of the fields below.
+    SpinLock mutex;
+
+    /// Objects with copies on other masters (or about to have them).
+    typedef std::map<ObjectId, HotObject> HotObjectMap;
+    HotObjectMap hotObjects;
+
+    /// Mirrors !hotObjects.empty() so that reads and writes can skip
+    /// taking #mutex in the common case.
+    std::atomic<bool> anyHotObjects;
+
+    /// The pushId most recently assigned.
+    uint64_t lastPushId;
+
+    /// The pushId of the push whose RPCs may still be outstanding, or 0 if
+    /// none (pushes are issued one at a time by the Pusher).
+    uint64_t pushInProgress;
+
+    /// Copies of other masters' hot objects held on this master.
+    typedef std::map<ObjectId, Copy> CopyMap;
+    CopyMap copies;
+
+    /// Mirrors !copies.empty().
+    std::atomic<bool> anyCopies;
+
+    /// Pushes copies of hot objects periodically.
+    Pusher pusher;
+
+    DISALLOW_COPY_AND_ASSIGN(HotKeyReplicas);
+};
+
+/**
+ * Remembers the copies that HotKeyReplicas::invalidate found for an object
+ * until they have been dropped. ObjectManager declares one of these before
+ * it takes the object's hash table bucket lock; the destructor, which runs
+ * after the lock has been released, sends the drops and waits for them, so
+ * other operations on the bucket aren't held up by RPCs to other masters.
+ */
+class HotKeyReplicas::Invalidation {
+  public:
+    Invalidation()
+        : hotKeyReplicas(NULL)
+        , id()
+        , replicas()
+        , pushId(0)
+    {}
+
+    ~Invalidation()
+    {
+        if (hotKeyReplicas != NULL)
+            hotKeyReplicas->finishInvalidation(this);
+    }
+
+  PRIVATE:
+    /// The HotKeyReplicas that found copies to drop, or NULL if there are
+    /// none.
+    HotKeyReplicas* hotKeyReplicas;
+
+    /// The object that was modified.
+    ObjectId id;
+
+    /// Masters holding copies of the object.
+    vector<ServerId> replicas;
+
+    /// Pushes of the object with this pushId or lower carry the old value.
+    uint64_t pushId;
+
+    friend class HotKeyReplicas;
+    DISALLOW_COPY_AND_ASSIGN(Invalidation);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_HOTKEYREPLICAS_H
@@ -0,0 +1,247 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "HotKeyReplicas.h"
+#include "MockCluster.h"
+#include "ObjectFinder.h"
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+class HotKeyReplicasTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    Server* owner;
+    Server* replica1;
+    Server* replica2;
+    uint64_t tableId;
+
+    HotKeyReplicasTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , owner()
+        , replica1()
+        , replica2()
+        , tableId()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::PING_SERVICE,
+                           WireFormat::MEMBERSHIP_SERVICE};
+        config.master.numReplicas = 0;
+        config.master.hotKeyReplicas = 2;
+        config.master.hotKeySampleInterval = 1;
+        config.localLocator = "mock:host=master1";
+        owner = cluster.addServer(config);
+        config.localLocator = "mock:host=master2";
+        replica1 = cluster.addServer(config);
+        config.localLocator = "mock:host=master3";
+        replica2 = cluster.addServer(config);
+
+        // Keep the Pusher out of the way; tests push explicitly.
+        Server* servers[] = {owner, replica1, replica2};
+        foreach (Server* server, servers) {
+            server->master->hotKeyReplicas.stop();
+        }
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = cluster.coordinator->tableManager.createTable("table", 1,
+                owner->serverId);
+        ramcloud->write(tableId, "hot", 3, "value1");
+    }
+
+    /**
+     * Read the hot object enough times to make it hot, then have its owner
+     * push copies of it.
+     */
+    uint32_t
+    makeHot()
+    {
+        for (int i = 0; i < 20; i++) {
+            Buffer value;
+            ramcloud->read(tableId, "hot", 3, &value);
+        }
+        return owner->master->hotKeyReplicas.pushHotKeys();
+    }
+
+    /**
+     * Return the value of the copy of the hot object held by a replica, or
+     * "(none)" if there isn't one.
+     */
+    string
+    readCopy(Server* server)
+    {
+        Key key(tableId, "hot", 3);
+        Buffer value;
+        uint64_t version;
+        if (server->master->hotKeyReplicas.readCopy(key, &value, &version)
+                != STATUS_OK)
+            return "(none)";
+        return string(static_cast<const char*>(
+                value.getRange(0, value.size())), value.size());
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(HotKeyReplicasTest);
+};
+
+TEST_F(HotKeyReplicasTest, pushHotKeys_notHot) {
+    Buffer value;
+    ramcloud->read(tableId, "hot", 3, &value);
+    EXPECT_EQ(0U, owner->master->hotKeyReplicas.pushHotKeys());
+    EXPECT_EQ("(none)", readCopy(replica1));
+}
+
+TEST_F(HotKeyReplicasTest, pushHotKeys_pushesCopies) {
+    EXPECT_EQ(1U, makeHot());
+    EXPECT_EQ("value1", readCopy(replica1));
+    EXPECT_EQ("value1", readCopy(replica2));
+    EXPECT_EQ("(none)", readCopy(owner));
+}
+
+TEST_F(HotKeyReplicasTest, read_clientLearnsReplicas) {
+    makeHot();
+    Buffer value;
+    ramcloud->read(tableId, "hot", 3, &value);
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(1U, context.objectFinder->hotReplicaMap.size());
+
+    // Subsequent reads may be served by any of the three masters, but they
+    // all return the same value.
+    for (int i = 0; i < 10; i++) {
+        ramcloud->read(tableId, "hot", 3, &value);
+        EXPECT_EQ("value1", TestUtil::toString(&value));
+    }
+}
+
+TEST_F(HotKeyReplicasTest, invalidate_onWrite) {
+    makeHot();
+    Buffer value;
+    ramcloud->read(tableId, "hot", 3, &value);
+    ramcloud->write(tableId, "hot", 3, "value2");
+    EXPECT_EQ("(none)", readCopy(replica1));
+    EXPECT_EQ("(none)", readCopy(replica2));
+    for (int i = 0; i < 10; i++) {
+        ramcloud->read(tableId, "hot", 3, &value);
+        EXPECT_EQ("value2", TestUtil::toString(&value));
+    }
+}
+
+TEST_F(HotKeyReplicasTest, invalidate_onRemove) {
+    makeHot();
+    ramcloud->remove(tableId, "hot", 3);
+    EXPECT_EQ("(none)", readCopy(replica1));
+    Buffer value;
+    EXPECT_THROW(ramcloud->read(tableId, "hot", 3, &value),
+            ObjectDoesntExistException);
+}
+
+TEST_F(HotKeyReplicasTest, invalidate_dropsCopiesWhenFinished) {
+    makeHot();
+    HotKeyReplicas& hkr = owner->master->hotKeyReplicas;
+    Key key(tableId, "hot", 3);
+    HotKeyReplicas::ObjectId id(tableId, "hot");
+    {
+        HotKeyReplicas::Invalidation invalidation;
+        hkr.invalidate(key, &invalidation);
+
+        // Nothing is sent until the Invalidation is destroyed, but the
+        // copies are no longer advertised or pushed, and the owner won't
+        // serve the object.
+        EXPECT_EQ("value1", readCopy(replica1));
+        EXPECT_FALSE(hkr.hotObjects[id].advertised);
+        EXPECT_FALSE(hkr.pushObject(id));
+        EXPECT_EQ(0UL, hkr.pushInProgress);
+        EXPECT_TRUE(hkr.isInvalidating(key));
+        Buffer value;
+        EXPECT_THROW(owner->master->objectManager.readObject(key, &value,
+                NULL, NULL), RetryException);
+    }
+    EXPECT_EQ("(none)", readCopy(replica1));
+    EXPECT_EQ("(none)", readCopy(replica2));
+    EXPECT_EQ(0U, hkr.hotObjects.size());
+    EXPECT_FALSE(hkr.anyHotObjects);
+    EXPECT_FALSE(hkr.isInvalidating(key));
+}
+
+TEST_F(HotKeyReplicasTest, dropTablet) {
+    makeHot();
+    HotKeyReplicas& hkr = owner->master->hotKeyReplicas;
+    Key key(tableId, "hot", 3);
+    hkr.dropTablet(tableId + 1, 0, ~0UL);
+    hkr.dropTablet(tableId, key.getHash() + 1, ~0UL);
+    EXPECT_EQ("value1", readCopy(replica1));
+    EXPECT_EQ(1U, hkr.hotObjects.size());
+
+    hkr.dropTablet(tableId, 0, ~0UL);
+    EXPECT_EQ("(none)", readCopy(replica1));
+    EXPECT_EQ("(none)", readCopy(replica2));
+    EXPECT_EQ(0U, hkr.hotObjects.size());
+}
+
+TEST_F(HotKeyReplicasTest, storeCopy_stalePushAfterDrop) {
+    HotKeyReplicas& replica = replica1->master->hotKeyReplicas;
+    Key key(tableId, "hot", 3);
+    Buffer value;
+    value.appendExternal("old", 3);
+    replica.dropCopy(key, 5);
+    EXPECT_EQ(STATUS_STALE_RPC,
+            replica.storeCopy(key, 5, 1, 500, &value, 0, 3));
+    EXPECT_EQ("(none)", readCopy(replica1));
+    EXPECT_EQ(STATUS_OK, replica.storeCopy(key, 6, 2, 500, &value, 0, 3));
+    EXPECT_EQ("old", readCopy(replica1));
+}
+
+TEST_F(HotKeyReplicasTest, dropCopy_keepsNewerCopy) {
+    HotKeyReplicas& replica = replica1->master->hotKeyReplicas;
+    Key key(tableId, "hot", 3);
+    Buffer value;
+    value.appendExternal("new", 3);
+    EXPECT_EQ(STATUS_OK, replica.storeCopy(key, 7, 3, 500, &value, 0, 3));
+    replica.dropCopy(key, 6);
+    EXPECT_EQ("new", readCopy(replica1));
+    replica.dropCopy(key, 7);
+    EXPECT_EQ("(none)", readCopy(replica1));
+}
+
+TEST_F(HotKeyReplicasTest, readCopy_expired) {
+    HotKeyReplicas& replica = replica1->master->hotKeyReplicas;
+    Key key(tableId, "hot", 3);
+    Buffer value;
+    value.appendExternal("abc", 3);
+    EXPECT_EQ(STATUS_OK, replica.storeCopy(key, 1, 1, 0, &value, 0, 3));
+    Cycles::mockTscValue = Cycles::rdtsc() + Cycles::fromSeconds(1);
+    EXPECT_EQ("(none)", readCopy(replica1));
+    Cycles::mockTscValue = 0;
+}
+
+TEST_F(HotKeyReplicasTest, isHot) {
+    HotKeyReplicas& hkr = owner->master->hotKeyReplicas;
+    EXPECT_FALSE(hkr.isHot(10, 20, 0));
+    EXPECT_TRUE(hkr.isHot(16, 160, 0));
+    EXPECT_FALSE(hkr.isHot(16, 161, 0));
+
+    // With two copies, the owner only sees a third of the object's reads.
+    EXPECT_TRUE(hkr.isHot(6, 100, 2));
+}
+
+}  // namespace RAMCloud
@@ -0,0 +1,396 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <set>
+
+#include "Cycles.h"
+#include "HotKeyTracker.h"
+
+namespace RAMCloud {
+
+/**
+ * Counts the accesses reported by each worker thread since that thread
+ * last sampled one into a HotKeyTracker.
+ */
+static __thread uint32_t accessesSinceSample = 0;
+
+/**
+ * Construct a HotKeyTracker.
+ *
+ * \param tabletManager
+ *      Used to find the tablet that contains each sampled key.
+ * \param sampleInterval
+ *      Record one out of every this many accesses; 0 means don't record
+ *      anything.
+ */
+HotKeyTracker::HotKeyTracker(TabletManager* tabletManager,
+        uint32_t sampleInterval)
+    : tabletManager(tabletManager)
+    , sampleInterval(sampleInterval)
+    , mutex("HotKeyTracker::mutex")
+    , windowStart(Cycles::rdtsc())
+    , keyOps(KEY_CAPACITY)
+    , keyBytes(KEY_CAPACITY)
+    , tabletOps(TABLET_CAPACITY)
+    , tabletBytes(TABLET_CAPACITY)
+    , readOps(READ_CAPACITY)
+    , tablets()
+    , tabletsVersion(0)
+{}
+
+/**
+ * This method is invoked by MasterService for each object read; it samples
+ * the access into the sketches. In the common case it just increments a
+ * thread-local counter.
+ *
+ * \param key
+ *      Key of the object that was read.
+ * \param bytes
+ *      Number of bytes of object data read.
+ */
+void
+HotKeyTracker::recordAccess(Key& key, uint32_t bytes)
+{
+    if (sample())
+        record(key, bytes, false);
+}
+
+/**
+ * This method is invoked by MasterService for each object written; it
+ * samples the access into the sketches.
+ *
+ * \param object
+ *      The object that was written.
+ */
+void
+HotKeyTracker::recordAccess(Object& object)
+{
+    if (!sample())
+        return;
+    KeyLength keyLength;
+    const void* keyString = object.getKey(0, &keyLength);
+    Key key(object.getTableId(), keyString, keyLength);
+    record(key, object.getValueLength(), false);
+}
+
+/**
+ * This method is invoked by MasterService for each single-object read,
+ * whose client can be told about replicas of the object. It behaves like
+ * recordAccess, except that a sampled read also counts toward the hot
+ * keys returned by takeHotReads.
+ *
+ * \param key
+ *      Key of the object that was read.
+ * \param bytes
+ *      Number of bytes of object data read.
+ */
+void
+HotKeyTracker::recordRead(Key& key, uint32_t bytes)
+{
+    if (sample())
+        record(key, bytes, true);
+}
+
+/**
+ * Decide whether the current access should be recorded in the sketches.
+ */
+bool
+HotKeyTracker::sample()
+{
+    if (sampleInterval == 0)
+        return false;
+    if (++accessesSinceSample < sampleInterval)
+        return false;
+    accessesSinceSample = 0;
+    return true;
+}
+
+/**
+ * Record a sampled access in the sketches.
+ *
+ * \param key
+ *      Key of the object that was accessed.
+ * \param bytes
+ *      Number of bytes of object data read or written.
+ * \param replicable
+ *      True means the access was a read passed to recordRead.
+ */
+void
+HotKeyTracker::record(Key& key, uint32_t bytes, bool replicable)
+{
+    ObjectId id(key.getTableId(),
+            string(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    uint64_t version = tabletManager->getVersion();
+    TabletId tabletId;
+    {
+        SpinLock::Guard _(mutex);
+        if (findCachedTablet(key.getTableId(), key.getHash(), version,
+                &tabletId)) {
+            count(id, &tabletId, bytes, replicable);
+            return;
+        }
+    }
+
+    // The tablet isn't cached; look it up without holding our own lock.
+    TabletManager::Tablet tablet;
+    bool haveTablet = tabletManager->getTablet(key, &tablet);
+    SpinLock::Guard _(mutex);
+    if (!haveTablet) {
+        count(id, NULL, bytes, replicable);
+        return;
+    }
+    tabletId = TabletId(tablet.tableId, tablet.startKeyHash);
+    if (version == tabletsVersion)
+        tablets[tabletId] = tablet.endKeyHash;
+    count(id, &tabletId, bytes, replicable);
+}
+
+/**
+ * Look for the tablet containing a key hash in #tablets. The caller must
+ * hold #mutex.
+ *
+ * \param tableId
+ *      Table containing the key.
+ * \param keyHash
+ *      Hash of the key.
+ * \param version
+ *      The value of TabletManager::getVersion before the call; if it is
+ *      newer than #tabletsVersion, the cache is discarded.
+ * \param[out] tabletId
+ *      Filled in with the tablet containing the key, if it was found.
+ *
+ * \return
+ *      True means the tablet was found in the cache.
+ */
+bool
+HotKeyTracker::findCachedTablet(uint64_t tableId, uint64_t keyHash,
+        uint64_t version, TabletId* tabletId)
+{
+    if (version != tabletsVersion) {
+        // A thread that read the version before the latest change may
+        // arrive here late; it must not bring back the old version.
+        if (version > tabletsVersion) {
+            tablets.clear();
+            tabletsVersion = version;
+        }
+        return false;
+    }
+    TabletCache::iterator it = tablets.upper_bound(TabletId(tableId, keyHash));
+    if (it == tablets.begin())
+        return false;
+    it--;
+    if (it->first.first != tableId || keyHash > it->second)
+        return false;
+    *tabletId = it->first;
+    return true;
+}
+
+/**
+ * Add one sampled access to the sketches. The caller must hold #mutex.
+ *
+ * \param id
+ *      The object that was accessed.
+ * \param tabletId
+ *      The tablet containing the object, or NULL if it is unknown.
+ * \param bytes
+ *      Number of bytes of object data read or written.
+ * \param replicable
+ *      True means the access was a read passed to recordRead.
+ */
+void
+HotKeyTracker::count(const ObjectId& id, const TabletId* tabletId,
+        uint32_t bytes, bool replicable)
+{
+    // Each sample stands for sampleInterval accesses.
+    uint64_t weight = sampleInterval;
+    keyOps.add(id, weight);
+    keyBytes.add(id, weight * bytes);
+    if (tabletId != NULL) {
+        tabletOps.add(*tabletId, weight);
+        tabletBytes.add(*tabletId, weight * bytes);
+    }
+    if (replicable)
+        readOps.add(id);
+}
+
+/**
+ * Append a description of the hottest keys and tablets to a buffer, in
+ * the format returned by the GET_HOT_KEYS server control, then start a
+ * new measurement window.
+ *
+ * \param buffer
+ *      The information is appended here: a Header, followed by KeyEntry
+ *      records (each followed by its key) sorted by table id and then by
+ *      decreasing operation count, followed by TabletEntry records sorted
+ *      by decreasing operation count.
+ * \param limit
+ *      For each table, include at most this many of the keys with the
+ *      most operations, and at most this many of the keys with the most
+ *      bytes.
+ *
+ * \return
+ *      The number of bytes appended to \a buffer.
+ */
+uint32_t
+HotKeyTracker::appendHotKeys(Buffer* buffer, uint32_t limit)
+{
+    SpinLock::Guard _(mutex);
+    uint32_t initialSize = buffer->size();
+    uint64_t now = Cycles::rdtsc();
+    Header* header = buffer->emplaceAppend<Header>();
+    header->sampleInterval = sampleInterval;
+    header->windowMicros = Cycles::toMicroseconds(now - windowStart);
+    header->totalOps = keyOps.getTotal();
+    header->totalBytes = keyBytes.getTotal();
+    header->numKeys = 0;
+    header->numTablets = 0;
+
+    // Choose, for each table, the top keys by operations and by bytes.
+    std::set<ObjectId> chosen;
+    vector<SpaceSaving<ObjectId>::Item> items;
+    SpaceSaving<ObjectId>* sketches[] = {&keyOps, &keyBytes};
+    foreach (SpaceSaving<ObjectId>* sketch, sketches) {
+        std::map<uint64_t, uint32_t> perTable;
+        items.clear();
+        sketch->getTop(&items);
+        foreach (SpaceSaving<ObjectId>::Item& item, items) {
+            if (perTable[item.key.first]++ < limit)
+                chosen.insert(item.key);
+        }
+    }
+    vector<ObjectId> keys(chosen.begin(), chosen.end());
+    std::sort(keys.begin(), keys.end(),
+            [this](const ObjectId& a, const ObjectId& b) {
+                if (a.first != b.first)
+                    return a.first < b.first;
+                return keyOps.estimate(a) > keyOps.estimate(b);
+            });
+    foreach (ObjectId& id, keys) {
+        KeyEntry* entry = buffer->emplaceAppend<KeyEntry>();
+        entry->tableId = id.first;
+        entry->ops = keyOps.estimate(id);
+        entry->bytes = keyBytes.estimate(id);
+        entry->keyLength = downCast<uint16_t>(id.second.size());
+        buffer->appendCopy(id.second.data(), entry->keyLength);
+        header->numKeys++;
+    }
+
+    // Tablets are few enough that all of the counted ones are returned.
+    std::set<TabletId> tablets;
+    vector<SpaceSaving<TabletId>::Item> tabletItems;
+    tabletOps.getTop(&tabletItems);
+    tabletBytes.getTop(&tabletItems);
+    foreach (SpaceSaving<TabletId>::Item& item, tabletItems) {
+        tablets.insert(item.key);
+    }
+    vector<TabletId> sortedTablets(tablets.begin(), tablets.end());
+    std::sort(sortedTablets.begin(), sortedTablets.end(),
+            [this](const TabletId& a, const TabletId& b) {
+                return tabletOps.estimate(a) > tabletOps.estimate(b);
+            });
+    foreach (TabletId& id, sortedTablets) {
+        TabletEntry* entry = buffer->emplaceAppend<TabletEntry>();
+        entry->tableId = id.first;
+        entry->startKeyHash = id.second;
+        entry->ops = tabletOps.estimate(id);
+        entry->bytes = tabletBytes.estimate(id);
+        header->numTablets++;
+    }
+
+    keyOps.reset();
+    keyBytes.reset();
+    tabletOps.reset();
+    tabletBytes.reset();
+    windowStart = now;
+    return buffer->size() - initialSize;
+}
+
+/**
+ * Return the keys that were read most often since the last call to this
+ * method, then start a new window for them. HotKeyReplicas uses this to
+ * decide which objects to replicate; it doesn't affect GET_HOT_KEYS.
+ *
+ * \param[out] top
+ *      The most-read keys are appended here, in decreasing order of count.
+ *      Counts are numbers of samples, not scaled by the sampling interval.
+ *
+ * \return
+ *      The total number of reads sampled during the window.
+ */
+uint64_t
+HotKeyTracker::takeHotReads(vector<SpaceSaving<ObjectId>::Item>* top)
+{
+    SpinLock::Guard _(mutex);
+    readOps.getTop(top);
+    uint64_t total = readOps.getTotal();
+    readOps.reset();
+    return total;
+}
+
+/**
+ * Decode the output of a GET_HOT_KEYS server control.
+ *
+ * \param buffer
+ *      Buffer containing the output.
+ * \param offset
+ *      Offset within \a buffer of the first byte of the output.
+ * \param length
+ *      Number of bytes of output (the outputLength field from the
+ *      server control response).
+ * \param[out] report
+ *      Filled in with the decoded information.
+ *
+ * \return
+ *      True means success. False means the output was malformed or empty
+ *      (servers that aren't running a MasterService return no output);
+ *      in this case the contents of \a report are undefined.
+ */
+bool
+HotKeyTracker::parseHotKeys(Buffer* buffer, uint32_t offset,
+        uint32_t length, Report* report)
+{
+    uint32_t end = offset + length;
+    const Header* header = buffer->getOffset<Header>(offset);
+    if ((header == NULL) || (length < sizeof32(Header)))
+        return false;
+    report->header = *header;
+    report->keys.clear();
+    report->tablets.clear();
+    offset += sizeof32(Header);
+
+    for (uint32_t i = 0; i < header->numKeys; i++) {
+        const KeyEntry* entry = buffer->getOffset<KeyEntry>(offset);
+        if ((entry == NULL) ||
+                (offset + sizeof32(KeyEntry) + entry->keyLength > end))
+            return false;
+        offset += sizeof32(KeyEntry);
+        const char* key = static_cast<const char*>(
+                buffer->getRange(offset, entry->keyLength));
+        report->keys.emplace_back(entry->tableId,
+                string(key, entry->keyLength), entry->ops, entry->bytes);
+        offset += entry->keyLength;
+    }
+    for (uint32_t i = 0; i < header->numTablets; i++) {
+        const TabletEntry* entry = buffer->getOffset<TabletEntry>(offset);
+        if ((entry == NULL) || (offset + sizeof32(TabletEntry) > end))
+            return false;
+        report->tablets.push_back(*entry);
+        offset += sizeof32(TabletEntry);
+    }
+    return true;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,199 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_HOTKEYTRACKER_H
+#define RAMCLOUD_HOTKEYTRACKER_H
+
+#include <map>
+
+#include "Common.h"
+#include "Buffer.h"
+#include "Key.h"
+#include "Object.h"
+#include "SpaceSaving.h"
+#include "SpinLock.h"
+#include "TabletManager.h"
+
+namespace RAMCloud {
+
+/**
+ * Keeps track of which keys and tablets on a master are receiving the most
+ * operations and bytes, so that operators and tools can find out what is
+ * hot right now (e.g., to decide which tablets to split or move, or which
+ * objects to cache). MasterService reports each read and write; one out of
+ * every sampleInterval of them is recorded in SpaceSaving sketches, so
+ * memory use is fixed no matter how many keys or tables the master holds.
+ *
+ * The information is retrieved with the GET_HOT_KEYS server control (see
+ * appendHotKeys); each retrieval also starts a new measurement window.
+ * All counts are estimates, scaled up by the sampling interval.
+ *
+ * Sampled single-object reads (see recordRead) are also counted in a
+ * separate sketch with its own window, which HotKeyReplicas consumes (see
+ * takeHotReads) to decide which objects to replicate; this way reads are
+ * only sampled once.
+ */
+class HotKeyTracker {
+  PUBLIC:
+    /// Identifies an object: table id and primary key.
+    typedef std::pair<uint64_t, string> ObjectId;
+
+    /**
+     * The output of GET_HOT_KEYS starts with this header. It is followed
+     * by numKeys KeyEntry records (each immediately followed by its key)
+     * and then numTablets TabletEntry records.
+     */
+    struct Header {
+        uint32_t sampleInterval;   // One out of every this many operations
+                                   // was sampled.
+        uint64_t windowMicros;     // Length of the measurement window.
+        uint64_t totalOps;         // Estimated operations during the window.
+        uint64_t totalBytes;       // Estimated bytes read and written
+                                   // during the window.
+        uint32_t numKeys;          // Number of KeyEntry records that follow.
+        uint32_t numTablets;       // Number of TabletEntry records that
+                                   // follow the keys.
+    } __attribute__((packed));
+
+    /// Describes one hot key in the output of GET_HOT_KEYS.
+    struct KeyEntry {
+        uint64_t tableId;          // Table containing the key.
+        uint64_t ops;              // Estimated reads plus writes.
+        uint64_t bytes;            // Estimated bytes read and written.
+        uint16_t keyLength;        // Length of the key, which follows
+                                   // immediately after this record.
+    } __attribute__((packed));
+
+    /// Describes one hot tablet in the output of GET_HOT_KEYS.
+    struct TabletEntry {
+        uint64_t tableId;          // Table containing the tablet.
+        uint64_t startKeyHash;     // First key hash in the tablet.
+        uint64_t ops;              // Estimated reads plus writes.
+        uint64_t bytes;            // Estimated bytes read and written.
+    } __attribute__((packed));
+
+    /// A decoded KeyEntry; see parseHotKeys.
+    struct HotKey {
+        HotKey(uint64_t tableId, const string& key, uint64_t ops,
+                uint64_t bytes)
+            : tableId(tableId)
+            , key(key)
+            , ops(ops)
+            , bytes(bytes)
+        {}
+        uint64_t tableId;
+        string key;
+        uint64_t ops;
+        uint64_t bytes;
+    };
+
+    /// Contents of a GET_HOT_KEYS response, decoded by parseHotKeys.
+    struct Report {
+        Report()
+            : header()
+            , keys()
+            , tablets()
+        {}
+        Header header;
+        vector<HotKey> keys;
+        vector<TabletEntry> tablets;
+    };
+
+    HotKeyTracker(TabletManager* tabletManager, uint32_t sampleInterval);
+    void recordAccess(Key& key, uint32_t bytes);
+    void recordAccess(Object& object);
+    void recordRead(Key& key, uint32_t bytes);
+    uint32_t appendHotKeys(Buffer* buffer, uint32_t limit);
+    uint64_t takeHotReads(vector<SpaceSaving<ObjectId>::Item>* top);
+    static bool parseHotKeys(Buffer* buffer, uint32_t offset,
+            uint32_t length, Report* report);
+
+    /// Number of distinct keys counted by each sketch.
+    static const uint32_t KEY_CAPACITY = 64;
+
+    /// Number of distinct tablets counted by each sketch.
+    static const uint32_t TABLET_CAPACITY = 32;
+
+    /// Number of distinct keys counted by the sketch of reads returned by
+    /// takeHotReads.
+    static const uint32_t READ_CAPACITY = 32;
+
+    /**
+     * Return the sampling interval; 0 means the tracker is disabled.
+     */
+    uint32_t
+    getSampleInterval()
+    {
+        return sampleInterval;
+    }
+
+  PRIVATE:
+    /// Identifies a tablet: table id and first key hash.
+    typedef std::pair<uint64_t, uint64_t> TabletId;
+
+    /// Maps the TabletId of each tablet to its last key hash.
+    typedef std::map<TabletId, uint64_t> TabletCache;
+
+    bool sample();
+    void record(Key& key, uint32_t bytes, bool replicable);
+    bool findCachedTablet(uint64_t tableId, uint64_t keyHash,
+            uint64_t version, TabletId* tabletId);
+    void count(const ObjectId& id, const TabletId* tabletId,
+            uint32_t bytes, bool replicable);
+
+    /// Used to find the tablet containing each sampled key.
+    TabletManager* tabletManager;
+
+    /// Only one out of this many accesses is recorded; 0 disables the
+    /// tracker.
+    const uint32_t sampleInterval;
+
+    /// Monitor-style lock protecting all of the fields below.
+    SpinLock mutex;
+
+    /// Cycles::rdtsc() time when the current window started.
+    uint64_t windowStart;
+
+    /// Counts sampled operations per key in the current window.
+    SpaceSaving<ObjectId> keyOps;
+
+    /// Counts sampled bytes per key in the current window.
+    SpaceSaving<ObjectId> keyBytes;
+
+    /// Counts sampled operations per tablet in the current window.
+    SpaceSaving<TabletId> tabletOps;
+
+    /// Counts sampled bytes per tablet in the current window.
+    SpaceSaving<TabletId> tabletBytes;
+
+    /// Counts sampled reads passed to recordRead per key (one per sample,
+    /// not scaled by sampleInterval) since the last call to takeHotReads.
+    SpaceSaving<ObjectId> readOps;
+
+    /// Key hash ranges of the tablets that sampled keys belonged to, so
+    /// that most samples don't need to look up their tablet in
+    /// #tabletManager (which takes its lock).
+    TabletCache tablets;
+
+    /// The TabletManager::getVersion value when #tablets was last cleared;
+    /// the cache is discarded whenever the version changes.
+    uint64_t tabletsVersion;
+
+    DISALLOW_COPY_AND_ASSIGN(HotKeyTracker);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_HOTKEYTRACKER_H
@@ -0,0 +1,202 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "HotKeyTracker.h"
+
+namespace RAMCloud {
+
+class HotKeyTrackerTest : public ::testing::Test {
+  public:
+    TabletManager tabletManager;
+    HotKeyTracker tracker;
+
+    HotKeyTrackerTest()
+        : tabletManager()
+        , tracker(&tabletManager, 1)
+    {
+        tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+        tabletManager.addTablet(2, 0, 1000, TabletManager::NORMAL);
+        tabletManager.addTablet(2, 1001, ~0UL, TabletManager::NORMAL);
+    }
+
+    void
+    access(uint64_t tableId, const char* key, uint32_t bytes,
+            uint32_t count = 1)
+    {
+        Key k(tableId, key, downCast<uint16_t>(strlen(key)));
+        for (uint32_t i = 0; i < count; i++) {
+            tracker.recordAccess(k, bytes);
+        }
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(HotKeyTrackerTest);
+};
+
+TEST_F(HotKeyTrackerTest, recordAccess_disabled) {
+    HotKeyTracker disabled(&tabletManager, 0);
+    Key key(1, "a", 1);
+    disabled.recordAccess(key, 100);
+    EXPECT_EQ(0U, disabled.keyOps.getTotal());
+    EXPECT_EQ(0U, disabled.tabletOps.getTotal());
+}
+
+TEST_F(HotKeyTrackerTest, recordAccess_object) {
+    Key key(1, "obj", 3);
+    Buffer buffer;
+    Object object(key, "hello", 5, 0, 0, buffer);
+    tracker.recordAccess(object);
+    HotKeyTracker::ObjectId id(1, "obj");
+    EXPECT_EQ(1U, tracker.keyOps.estimate(id));
+    EXPECT_EQ(5U, tracker.keyBytes.estimate(id));
+}
+
+TEST_F(HotKeyTrackerTest, record_unknownTablet) {
+    access(3, "x", 10);
+    EXPECT_EQ(1U, tracker.keyOps.getTotal());
+    EXPECT_EQ(0U, tracker.tabletOps.getTotal());
+}
+
+TEST_F(HotKeyTrackerTest, record_weightedBySampleInterval) {
+    HotKeyTracker sampled(&tabletManager, 4);
+    Key key(1, "a", 1);
+    for (int i = 0; i < 8; i++) {
+        sampled.recordAccess(key, 10);
+    }
+    HotKeyTracker::ObjectId id(1, "a");
+    EXPECT_EQ(8U, sampled.keyOps.estimate(id));
+    EXPECT_EQ(80U, sampled.keyBytes.estimate(id));
+}
+
+TEST_F(HotKeyTrackerTest, record_tabletCache) {
+    access(2, "a", 10);
+    Key key(2, "a", 1);
+    HotKeyTracker::TabletId tablet(2, 1001);
+    ASSERT_EQ(1U, tracker.tablets.size());
+    EXPECT_EQ(tablet, tracker.tablets.begin()->first);
+    EXPECT_EQ(1U, tracker.tabletOps.estimate(tablet));
+
+    // Cached tablets are used without consulting the TabletManager.
+    tracker.tablets[HotKeyTracker::TabletId(3, 0)] = ~0UL;
+    access(3, "x", 10);
+    EXPECT_EQ(1U, tracker.tabletOps.estimate(
+            HotKeyTracker::TabletId(3, 0)));
+
+    // Splitting a tablet discards the cache.
+    ASSERT_TRUE(tabletManager.splitTablet(2, key.getHash()));
+    access(2, "a", 10);
+    HotKeyTracker::TabletId newTablet(2, key.getHash());
+    ASSERT_EQ(1U, tracker.tablets.size());
+    EXPECT_EQ(newTablet, tracker.tablets.begin()->first);
+    EXPECT_EQ(1U, tracker.tabletOps.estimate(newTablet));
+    EXPECT_EQ(1U, tracker.tabletOps.estimate(tablet));
+}
+
+TEST_F(HotKeyTrackerTest, findCachedTablet) {
+    HotKeyTracker::TabletId tablet;
+    uint64_t version = tabletManager.getVersion();
+    EXPECT_FALSE(tracker.findCachedTablet(2, 5, version, &tablet));
+    tracker.tablets[HotKeyTracker::TabletId(2, 1001)] = 2000;
+    EXPECT_FALSE(tracker.findCachedTablet(2, 5, version, &tablet));
+    EXPECT_FALSE(tracker.findCachedTablet(2, 2001, version, &tablet));
+    EXPECT_FALSE(tracker.findCachedTablet(1, 1500, version, &tablet));
+    EXPECT_TRUE(tracker.findCachedTablet(2, 1001, version, &tablet));
+    EXPECT_TRUE(tracker.findCachedTablet(2, 2000, version, &tablet));
+    EXPECT_EQ(HotKeyTracker::TabletId(2, 1001), tablet);
+
+    // An older version misses without discarding the cache; a newer one
+    // discards it.
+    EXPECT_FALSE(tracker.findCachedTablet(2, 1500, version - 1, &tablet));
+    EXPECT_EQ(1U, tracker.tablets.size());
+    EXPECT_FALSE(tracker.findCachedTablet(2, 1500, version + 1, &tablet));
+    EXPECT_EQ(0U, tracker.tablets.size());
+    EXPECT_EQ(version + 1, tracker.tabletsVersion);
+}
+
+TEST_F(HotKeyTrackerTest, takeHotReads) {
+    Key key(1, "a", 1);
+    tracker.recordRead(key, 10);
+    tracker.recordRead(key, 10);
+    access(1, "b", 10);
+    vector<SpaceSaving<HotKeyTracker::ObjectId>::Item> top;
+    EXPECT_EQ(2U, tracker.takeHotReads(&top));
+    ASSERT_EQ(1U, top.size());
+    EXPECT_EQ("a", top[0].key.second);
+    EXPECT_EQ(2U, top[0].count);
+    EXPECT_EQ(3U, tracker.keyOps.getTotal());
+
+    top.clear();
+    EXPECT_EQ(0U, tracker.takeHotReads(&top));
+    EXPECT_EQ(0U, top.size());
+}
+
+TEST_F(HotKeyTrackerTest, appendHotKeys_andParse) {
+    access(1, "a", 10, 3);
+    access(1, "b", 100);
+    access(1, "c", 1);
+    access(2, "d", 5, 2);
+
+    Buffer buffer;
+    buffer.appendCopy("xyz", 3);
+    uint32_t length = tracker.appendHotKeys(&buffer, 1);
+    EXPECT_EQ(buffer.size() - 3, length);
+
+    HotKeyTracker::Report report;
+    ASSERT_TRUE(HotKeyTracker::parseHotKeys(&buffer, 3, length, &report));
+    EXPECT_EQ(1U, report.header.sampleInterval);
+    EXPECT_EQ(7U, report.header.totalOps);
+    EXPECT_EQ(141U, report.header.totalBytes);
+
+    // For table 1, "a" has the most operations and "b" the most bytes.
+    ASSERT_EQ(3U, report.keys.size());
+    EXPECT_EQ(1U, report.keys[0].tableId);
+    EXPECT_EQ("a", report.keys[0].key);
+    EXPECT_EQ(3U, report.keys[0].ops);
+    EXPECT_EQ(30U, report.keys[0].bytes);
+    EXPECT_EQ("b", report.keys[1].key);
+    EXPECT_EQ(100U, report.keys[1].bytes);
+    EXPECT_EQ(2U, report.keys[2].tableId);
+    EXPECT_EQ("d", report.keys[2].key);
+
+    ASSERT_EQ(2U, report.tablets.size());
+    EXPECT_EQ(1U, report.tablets[0].tableId);
+    EXPECT_EQ(5U, report.tablets[0].ops);
+    EXPECT_EQ(131U, report.tablets[0].bytes);
+    EXPECT_EQ(2U, report.tablets[1].tableId);
+    EXPECT_EQ(2U, report.tablets[1].ops);
+
+    // The window was reset.
+    buffer.reset();
+    length = tracker.appendHotKeys(&buffer, 1);
+    ASSERT_TRUE(HotKeyTracker::parseHotKeys(&buffer, 0, length, &report));
+    EXPECT_EQ(0U, report.header.totalOps);
+    EXPECT_EQ(0U, report.keys.size());
+    EXPECT_EQ(0U, report.tablets.size());
+}
+
+TEST_F(HotKeyTrackerTest, parseHotKeys_malformed) {
+    HotKeyTracker::Report report;
+    Buffer buffer;
+    EXPECT_FALSE(HotKeyTracker::parseHotKeys(&buffer, 0, 0, &report));
+
+    access(1, "a", 10);
+    uint32_t length = tracker.appendHotKeys(&buffer, 10);
+    EXPECT_FALSE(HotKeyTracker::parseHotKeys(&buffer, 0, length - 1,
+            &report));
+    EXPECT_TRUE(HotKeyTracker::parseHotKeys(&buffer, 0, length, &report));
+}
+
+}  // namespace RAMCloud
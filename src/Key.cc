@@ -43,7 +43,7 @@ Key::Key(LogEntryType type, Buffer& buffer)
       keyLength(0),
       hash()
 {
-    if (type == LOG_ENTRY_TYPE_OBJ) {
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJCOMP) {
         Object object(buffer);
         tableId = object.getTableId();
         keyLength = object.getKeyLength();
@@ -0,0 +1,165 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_LATENCYHISTOGRAM_H
+#define RAMCLOUD_LATENCYHISTOGRAM_H
+
+#include "Minimal.h"
+
+namespace RAMCloud {
+
+/**
+ * A log-linear histogram of time intervals, in the style of HdrHistogram.
+ * Intervals are measured in Cycles::rdtsc ticks. Each power-of-two range
+ * of values is divided into 2^SUB_BUCKET_BITS buckets of equal width, so
+ * the relative error of any value reconstructed from the histogram is
+ * bounded (about 12% with the default settings), independent of its
+ * magnitude.
+ *
+ * Recording a value takes a few instructions and no synchronization, so
+ * each histogram must be updated by a single thread; other threads may
+ * read it concurrently (and may see slightly stale counts). The class is
+ * a POD so that histograms can be zeroed with memset and shipped over
+ * the network as raw bytes.
+ */
+struct LatencyHistogram {
+    /// Values are divided by 2^UNIT_SHIFT before bucketing: with 2-3 GHz
+    /// clocks, the smallest bucket is about 100 ns wide.
+    static const int UNIT_SHIFT = 8;
+
+    /// Each power of two is divided into 2^SUB_BUCKET_BITS buckets.
+    static const int SUB_BUCKET_BITS = 2;
+
+    /// Total number of buckets. The last bucket also holds all values too
+    /// large for the other buckets (more than about a second).
+    static const int NUM_BUCKETS = 96;
+
+    /// Number of values recorded in each bucket.
+    uint64_t counts[NUM_BUCKETS];
+
+    /**
+     * Return the index of the bucket that holds a given value.
+     */
+    static int
+    bucket(uint64_t cycles)
+    {
+        uint64_t value = cycles >> UNIT_SHIFT;
+        if (value < (1U << SUB_BUCKET_BITS)) {
+            return static_cast<int>(value);
+        }
+        int msb = 63 - __builtin_clzll(value);
+        int sub = static_cast<int>(value >> (msb - SUB_BUCKET_BITS))
+                & ((1 << SUB_BUCKET_BITS) - 1);
+        int index = ((msb - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + sub;
+        return (index < NUM_BUCKETS) ? index : NUM_BUCKETS - 1;
+    }
+
+    /**
+     * Return the smallest value (in cycles) that falls in a given bucket.
+     */
+    static uint64_t
+    lowerBound(int index)
+    {
+        if (index < (1 << SUB_BUCKET_BITS)) {
+            return static_cast<uint64_t>(index) << UNIT_SHIFT;
+        }
+        int msb = (index >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+        uint64_t sub = static_cast<uint64_t>(index)
+                & ((1 << SUB_BUCKET_BITS) - 1);
+        uint64_t value = (1UL << msb) + (sub << (msb - SUB_BUCKET_BITS));
+        return value << UNIT_SHIFT;
+    }
+
+    /**
+     * Count one occurrence of a given time interval.
+     */
+    void
+    record(uint64_t cycles)
+    {
+        counts[bucket(cycles)]++;
+    }
+
+    /**
+     * Add all of the counts from another histogram into this one.
+     */
+    void
+    add(const LatencyHistogram& other)
+    {
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            counts[i] += other.counts[i];
+        }
+    }
+
+    /**
+     * Subtract the counts in an earlier reading of the same histogram
+     * from this one, leaving the values recorded between the two.
+     */
+    void
+    subtract(const LatencyHistogram& earlier)
+    {
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            counts[i] -= earlier.counts[i];
+        }
+    }
+
+    /**
+     * Return the total number of values recorded in the histogram.
+     */
+    uint64_t
+    totalCount() const
+    {
+        uint64_t total = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            total += counts[i];
+        }
+        return total;
+    }
+
+    /**
+     * Return an estimate of a given percentile of the recorded values.
+     *
+     * \param percentile
+     *      Desired percentile, between 0 and 100 (e.g., 99 means the value
+     *      that 99% of all recorded values are less than or equal to).
+     * \return
+     *      The midpoint (in cycles) of the bucket containing the desired
+     *      value, or 0 if the histogram is empty.
+     */
+    uint64_t
+    getPercentile(double percentile) const
+    {
+        uint64_t total = totalCount();
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(
+                percentile * static_cast<double>(total) / 100.0 + 0.5);
+        if (target == 0) {
+            target = 1;
+        }
+        uint64_t sum = 0;
+        for (int i = 0; i < NUM_BUCKETS - 1; i++) {
+            sum += counts[i];
+            if (sum >= target) {
+                return (lowerBound(i) + lowerBound(i + 1)) / 2;
+            }
+        }
+        return lowerBound(NUM_BUCKETS - 1);
+    }
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_LATENCYHISTOGRAM_H
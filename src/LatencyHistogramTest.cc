@@ -0,0 +1,91 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "LatencyHistogram.h"
+
+namespace RAMCloud {
+
+class LatencyHistogramTest : public ::testing::Test {
+  public:
+    LatencyHistogram histogram;
+
+    LatencyHistogramTest()
+        : histogram()
+    {
+        memset(&histogram, 0, sizeof(histogram));
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(LatencyHistogramTest);
+};
+
+TEST_F(LatencyHistogramTest, bucket) {
+    EXPECT_EQ(0, LatencyHistogram::bucket(0));
+    EXPECT_EQ(0, LatencyHistogram::bucket(255));
+    EXPECT_EQ(3, LatencyHistogram::bucket(1023));
+    EXPECT_EQ(4, LatencyHistogram::bucket(1024));
+    EXPECT_EQ(7, LatencyHistogram::bucket(2047));
+    EXPECT_EQ(8, LatencyHistogram::bucket(2048));
+    EXPECT_EQ(8, LatencyHistogram::bucket(2559));
+    EXPECT_EQ(9, LatencyHistogram::bucket(2560));
+    EXPECT_EQ(LatencyHistogram::NUM_BUCKETS - 1,
+            LatencyHistogram::bucket(~0UL));
+}
+
+TEST_F(LatencyHistogramTest, lowerBound) {
+    // Every bucket's lower bound must map back to that bucket, and the
+    // value just below it to the previous bucket.
+    for (int i = 1; i < LatencyHistogram::NUM_BUCKETS; i++) {
+        uint64_t bound = LatencyHistogram::lowerBound(i);
+        EXPECT_EQ(i, LatencyHistogram::bucket(bound)) << "bucket " << i;
+        EXPECT_EQ(i - 1, LatencyHistogram::bucket(bound - 1))
+                << "bucket " << i;
+    }
+}
+
+TEST_F(LatencyHistogramTest, addAndSubtract) {
+    LatencyHistogram other;
+    memset(&other, 0, sizeof(other));
+    histogram.record(5000);
+    other.record(5000);
+    other.record(100);
+    histogram.add(other);
+    EXPECT_EQ(3u, histogram.totalCount());
+    EXPECT_EQ(2u, histogram.counts[LatencyHistogram::bucket(5000)]);
+    histogram.subtract(other);
+    EXPECT_EQ(1u, histogram.totalCount());
+    EXPECT_EQ(0u, histogram.counts[0]);
+}
+
+TEST_F(LatencyHistogramTest, getPercentile) {
+    EXPECT_EQ(0u, histogram.getPercentile(50));
+    for (int i = 0; i < 99; i++) {
+        histogram.record(2048);
+    }
+    histogram.record(1000000);
+    EXPECT_EQ((2048u + 2560u) / 2, histogram.getPercentile(50));
+    EXPECT_EQ((2048u + 2560u) / 2, histogram.getPercentile(99));
+    uint64_t p100 = histogram.getPercentile(100);
+    EXPECT_LT(1000000 * 0.85, static_cast<double>(p100));
+    EXPECT_GT(1000000 * 1.15, static_cast<double>(p100));
+
+    // Values beyond the range of the histogram.
+    histogram.record(~0UL);
+    EXPECT_EQ(LatencyHistogram::lowerBound(LatencyHistogram::NUM_BUCKETS - 1),
+            histogram.getPercentile(100));
+}
+
+}  // namespace RAMCloud
@@ -19,6 +19,7 @@
 #include "Log.h"
 #include "LogCleaner.h"
 #include "PerfStats.h"
+#include "RpcTrace.h"
 #include "ServerConfig.h"
 #include "ShortMacros.h"
 
@@ -202,8 +203,10 @@ Log::sync()
         // while we sync.
         lock.destroy();
 
+        RpcTrace::record("rpc %u: replication sync started");
         originalHead->replicatedSegment->sync(appendedLength, &certificate);
         originalHead->syncedLength = appendedLength;
+        RpcTrace::record("rpc %u: replication sync finished");
         TEST_LOG("log synced");
     } else {
         TEST_LOG("sync not needed: already fully replicated");
@@ -259,8 +262,10 @@ Log::syncTo(Log::Reference reference)
         // threads while we sync.
         lock.destroy();
 
+        RpcTrace::record("rpc %u: replication sync started");
         head->replicatedSegment->sync(appendedLength, &certificate);
         head->syncedLength = appendedLength;
+        RpcTrace::record("rpc %u: replication sync finished");
         TEST_LOG("log synced");
         return;
     }
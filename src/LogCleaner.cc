@@ -331,6 +331,7 @@ LogCleaner::doMemoryCleaning()
 
     localMetrics.totalBytesInCompactedSegments +=
         segment->getSegletsAllocated() * segletSize;
+    uint32_t liveScannedEntryCounts[TOTAL_LOG_ENTRY_TYPES] = { 0 };
     uint32_t liveScannedEntryTotalLengths[TOTAL_LOG_ENTRY_TYPES] = { 0 };
 
     // Take two passes, writing out the tombstones first. This makes the
@@ -349,12 +350,15 @@ LogCleaner::doMemoryCleaning()
             it.appendToBuffer(buffer);
             Log::Reference reference = segment->getReference(it.getOffset());
             uint32_t bytesAppended = 0;
+            LogEntryType newType;
             RelocStatus s = relocateEntry(type,
                                           buffer,
                                           reference,
                                           survivor,
+                                          false,
                                           &localMetrics,
-                                          &bytesAppended);
+                                          &bytesAppended,
+                                          &newType);
             if (expect_false(s == RELOCATION_FAILED))
                 throw FatalError(HERE, "Entry didn't fit into survivor!");
 
@@ -365,7 +369,8 @@ LogCleaner::doMemoryCleaning()
                 localMetrics.totalLiveEntriesScanned[type]++;
                 localMetrics.totalLiveScannedEntryLengths[type] +=
                     buffer.size();
-                liveScannedEntryTotalLengths[type] += bytesAppended;
+                liveScannedEntryCounts[newType]++;
+                liveScannedEntryTotalLengths[newType] += bytesAppended;
             }
         }
     }
@@ -375,7 +380,7 @@ LogCleaner::doMemoryCleaning()
     // it avoids the expense of atomically updating those fields.
     for (size_t i = 0; i < TOTAL_LOG_ENTRY_TYPES; i++) {
         survivor->trackNewEntries(static_cast<LogEntryType>(i),
-                    downCast<uint32_t>(localMetrics.totalLiveEntriesScanned[i]),
+                    liveScannedEntryCounts[i],
                     liveScannedEntryTotalLengths[i]);
     }
 
@@ -637,12 +642,15 @@ LogCleaner::relocateLiveEntries(EntryVector& entries,
             &segmentManager.getAllocator(), &buffer);
         Log::Reference reference = entry.reference;
         uint32_t bytesAppended = 0;
+        LogEntryType newType;
         RelocStatus s = relocateEntry(type,
                                       buffer,
                                       reference,
                                       survivor,
+                                      true,
                                       localMetrics,
-                                      &bytesAppended);
+                                      &bytesAppended,
+                                      &newType);
 
         if (expect_false(s == RELOCATION_FAILED)) {
             if (survivor != NULL) {
@@ -672,8 +680,10 @@ LogCleaner::relocateLiveEntries(EntryVector& entries,
                               buffer,
                               reference,
                               survivor,
+                              true,
                               localMetrics,
-                              &bytesAppended);
+                              &bytesAppended,
+                              &newType);
             if (s == RELOCATION_FAILED)
                 throw FatalError(HERE, "Entry didn't fit into empty survivor!");
         }
@@ -684,8 +694,8 @@ LogCleaner::relocateLiveEntries(EntryVector& entries,
             localMetrics->totalLiveEntriesScanned[type]++;
             localMetrics->totalLiveScannedEntryLengths[type] +=
                 buffer.size();
-            currentLiveEntries[type]++;
-            currentLiveEntryLengths[type] += bytesAppended;
+            currentLiveEntries[newType]++;
+            currentLiveEntryLengths[newType] += bytesAppended;
         }
 
         totalEntryBytesAppended += bytesAppended;
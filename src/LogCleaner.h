@@ -283,6 +283,9 @@ class LogCleaner {
      *      be NULL, in which case the method will return false if relocation
      *      is attempted, or true if the entry was no longer needed and no
      *      relocation was tried.
+     * \param diskCleaning
+     *      True if the entry's segment is being cleaned on disk, false if it
+     *      is being compacted in memory. See LogEntryRelocator::diskCleaning.
      * \param metrics
      *      The appropriate metrics to update with relocation performance
      *      statistics. This should be a thread-local instance of
@@ -295,6 +298,10 @@ class LogCleaner {
      * \param outBytesAppended
      *      The total number of bytes appended during relocation (including any
      *      metadata) is returned in this counter. Must not be NULL.
+     * \param outNewType
+     *      If the entry was relocated, the type of the new entry is returned
+     *      here. This may differ from \a type (e.g., if the entry was
+     *      compressed). Must not be NULL.
      * \return
      *      Returns true if the operation succeeded (the entry was successfully
      *      relocated or was not needed and no relocation was performed).
@@ -308,11 +315,14 @@ class LogCleaner {
                   Buffer& buffer,
                   Log::Reference reference,
                   LogSegment* survivor,
+                  bool diskCleaning,
                   T* metrics,
-                  uint32_t* outBytesAppended)
+                  uint32_t* outBytesAppended,
+                  LogEntryType* outNewType)
     {
-        LogEntryRelocator relocator(survivor, buffer.size());
+        LogEntryRelocator relocator(survivor, buffer.size(), diskCleaning);
         *outBytesAppended = 0;
+        *outNewType = type;
 
         {
             metrics->totalRelocationCallbacks++;
@@ -325,6 +335,7 @@ class LogCleaner {
 
         if (relocator.relocated()) {
             *outBytesAppended = relocator.getTotalBytesAppended();
+            *outNewType = relocator.getNewType();
             metrics->totalRelocationAppends++;
             metrics->relocationAppendTicks += relocator.getAppendTicks();
             return RELOCATED;
@@ -0,0 +1,60 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * This program converts log files written by BinaryLog back into text, in
+ * the same format as the regular text log. Each file named on the command
+ * line is decompressed to standard output.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Common.h"
+#include "BinaryLog.h"
+
+using namespace RAMCloud;
+
+int
+main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s binaryLogFile ...\n", argv[0]);
+        return 1;
+    }
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "couldn't open %s: %s\n", argv[i],
+                    strerror(errno));
+            status = 1;
+            continue;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        string output;
+        bool complete = BinaryLog::decompress(contents.str(), &output);
+        std::cout << output;
+        if (!complete) {
+            fprintf(stderr, "%s is truncated or isn't a binary log file\n",
+                    argv[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -31,12 +31,18 @@ namespace RAMCloud {
  *      expects (it should always write an entry that is at most as large as
  *      the one being relocated; typically it is exactly the entry being
  *      relocated).
+ * \param diskCleaning
+ *      True if the entry is being relocated by disk cleaning, false if by
+ *      in-memory compaction. See #diskCleaning.
  */
 LogEntryRelocator::LogEntryRelocator(LogSegment* segment,
-                                     uint32_t maximumLength)
+                                     uint32_t maximumLength,
+                                     bool diskCleaning)
     : segment(segment),
       maximumLength(maximumLength),
       reference(),
+      newType(LOG_ENTRY_TYPE_INVALID),
+      diskCleaning(diskCleaning),
       outOfSpace(false),
       didAppend(false),
       appendTicks(0),
@@ -84,6 +90,7 @@ LogEntryRelocator::append(LogEntryType type, Buffer& buffer)
     }
 
     totalBytesAppended = segment->getAppendedLength() - priorLength;
+    newType = type;
 
     didAppend = true;
     return true;
@@ -101,6 +108,17 @@ LogEntryRelocator::getNewReference()
     return reference;
 }
 
+/**
+ * If an append operation succeeded, return the type of the new entry.
+ */
+LogEntryType
+LogEntryRelocator::getNewType()
+{
+    if (!didAppend)
+        throw FatalError(HERE, "No append operation succeeded.");
+    return newType;
+}
+
 /**
  * Return the number of cpu ticks spent appending to a survivor segment during
  * relocation.
@@ -122,6 +140,17 @@ LogEntryRelocator::failed()
     return outOfSpace;
 }
 
+/**
+ * Returns true if the entry is being relocated by disk cleaning rather than
+ * in-memory compaction. Only then may a live entry be dropped without
+ * leaving a trace on backups; see #diskCleaning.
+ */
+bool
+LogEntryRelocator::isDiskCleaning()
+{
+    return diskCleaning;
+}
+
 /**
  * Returns true if the entry was relocated successfully.
  */
@@ -50,11 +50,14 @@ namespace RAMCloud {
  */
 class LogEntryRelocator {
   public:
-    LogEntryRelocator(LogSegment* segment, uint32_t maximumLength);
+    LogEntryRelocator(LogSegment* segment, uint32_t maximumLength,
+                      bool diskCleaning = false);
     bool append(LogEntryType type, Buffer& buffer);
     Log::Reference getNewReference();
+    LogEntryType getNewType();
     uint64_t getAppendTicks();
     bool failed();
+    bool isDiskCleaning();
     bool relocated();
     uint32_t getTotalBytesAppended();
     uint32_t getTimestamp();
@@ -70,6 +73,18 @@ class LogEntryRelocator {
     /// If an append was done this reference points to it.
     Log::Reference reference;
 
+    /// If an append was done this is the type of the new entry. It usually
+    /// matches the type of the entry being relocated, but need not (for
+    /// example, cold objects are compressed when they are relocated).
+    LogEntryType newType;
+
+    /// True means the entry's segment is being cleaned on disk: once the
+    /// cleaner finishes, its replicas on backups are freed, so an entry that
+    /// isn't relocated is gone for good. False means in-memory compaction,
+    /// after which the segment's replicas (and the entry) still exist on
+    /// backups and would be replayed if the master crashed.
+    bool diskCleaning;
+
     /// Set to true if the append operation fails. Used to notify the log
     /// cleaner that it must allocate a new survivor segment and try again.
     bool outOfSpace;
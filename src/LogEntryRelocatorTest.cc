@@ -57,11 +57,19 @@ TEST_F(LogEntryRelocatorTest, constructor) {
     LogEntryRelocator r(NULL, 50);
     EXPECT_EQ(static_cast<LogSegment*>(NULL), r.segment);
     EXPECT_EQ(50U, r.maximumLength);
+    EXPECT_FALSE(r.diskCleaning);
     EXPECT_FALSE(r.outOfSpace);
     EXPECT_FALSE(r.didAppend);
     EXPECT_EQ(0U, r.appendTicks);
 }
 
+TEST_F(LogEntryRelocatorTest, isDiskCleaning) {
+    LogEntryRelocator r(NULL, 50, true);
+    EXPECT_TRUE(r.isDiskCleaning());
+    LogEntryRelocator r2(NULL, 50, false);
+    EXPECT_FALSE(r2.isDiskCleaning());
+}
+
 TEST_F(LogEntryRelocatorTest, append_nullSegment) {
     LogEntryRelocator r(NULL, 50);
     Buffer buffer;
@@ -61,6 +61,9 @@ enum LogEntryType {
     /// See ParticipantList
     LOG_ENTRY_TYPE_TXPLIST,
 
+    /// See CompressedObject.h::CompressedObject
+    LOG_ENTRY_TYPE_OBJCOMP,
+
     /// Not a type, but rather the total number of types we have defined.
     /// This is currently restricted by the lower 6 bits in a uint8_t field
     /// in Segment.h's Segment::EntryHeader. RAMCloud will probably collapse
@@ -106,6 +106,9 @@ Logger::Logger(LogLevel level)
  */
 Logger::~Logger()
 {
+    // Finish writing the binary log, if it is open.
+    BinaryLog::close();
+
     // Exit the print thread.
     {
         Lock lock(mutex);
@@ -804,7 +807,8 @@ Logger::reset()
 }
 
 /**
- * Wait for all buffered log messages to be printed. This method is intended
+ * Wait for all buffered log messages to be printed (including those in the
+ * binary log, if it is open). This method is intended
  * only for tests and a few special situations such as application exit. It
  * should *not* be used in the normal course of logging messages, since it
  * can result in long delays that could potentially cause the server to be
@@ -813,11 +817,14 @@ Logger::reset()
 void
 Logger::sync()
 {
-    Lock lock(mutex);
-    while (nextToInsert != nextToPrint) {
-        Unlock<SpinLock> unlock(mutex);
-        usleep(100);
+    {
+        Lock lock(mutex);
+        while (nextToInsert != nextToPrint) {
+            Unlock<SpinLock> unlock(mutex);
+            usleep(100);
+        }
     }
+    BinaryLog::sync();
 }
 
 /**
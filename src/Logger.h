@@ -21,6 +21,7 @@
 #include <time.h>
 #include <unordered_map>
 
+#include "BinaryLog.h"
 #include "CodeLocation.h"
 #include "SpinLock.h"
 #include "Tub.h"
@@ -353,7 +354,9 @@ class Logger {
  * Log a message for the system administrator with (CLOG) or without (LOG)
  * collapsing frequent messages.
  * The #RAMCLOUD_CURRENT_LOG_MODULE macro should be set to the LogModule to
- * which the message pertains.
+ * which the message pertains. If the binary log is open (see BinaryLog),
+ * the message goes there instead of the text log; messages are not
+ * collapsed in the binary log.
  * \param[in] level
  *      The level of importance of the message (LogLevel).
  * \param[in] format
@@ -362,20 +365,26 @@ class Logger {
  * \param[in] ...
  *      The arguments to the format string.
  */
-#define RAMCLOUD_LOG(level, format, ...) do { \
-    RAMCloud::Logger& _logger = Logger::get(); \
-    if (_logger.isLogging(RAMCLOUD_CURRENT_LOG_MODULE, level)) { \
-        _logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, level, HERE, \
-                           format "\n", ##__VA_ARGS__); \
-    } \
-    RAMCLOUD_TEST_LOG(format, ##__VA_ARGS__); \
-} while (0)
+#define RAMCLOUD_LOG(level, format, ...) \
+    RAMCLOUD_LOG_INTERNAL(false, level, format, ##__VA_ARGS__)
+
+#define RAMCLOUD_CLOG(level, format, ...) \
+    RAMCLOUD_LOG_INTERNAL(true, level, format, ##__VA_ARGS__)
 
-#define RAMCLOUD_CLOG(level, format, ...) do { \
+/// Shared implementation of RAMCLOUD_LOG and RAMCLOUD_CLOG.
+#define RAMCLOUD_LOG_INTERNAL(collapse, level, format, ...) do { \
     RAMCloud::Logger& _logger = Logger::get(); \
     if (_logger.isLogging(RAMCLOUD_CURRENT_LOG_MODULE, level)) { \
-        _logger.logMessage(true, RAMCLOUD_CURRENT_LOG_MODULE, level, HERE, \
-                           format "\n", ##__VA_ARGS__); \
+        if (RAMCloud::BinaryLog::enabled.load( \
+                std::memory_order_relaxed)) { \
+            static RAMCloud::BinaryLog::CallSite _site = {__FILE__, \
+                    __LINE__, __func__, format "\n", \
+                    RAMCLOUD_CURRENT_LOG_MODULE, {0}, 0}; \
+            RAMCloud::BinaryLog::log(&_site, level, ##__VA_ARGS__); \
+        } else { \
+            _logger.logMessage(collapse, RAMCLOUD_CURRENT_LOG_MODULE, level, \
+                               HERE, format "\n", ##__VA_ARGS__); \
+        } \
     } \
     RAMCLOUD_TEST_LOG(format, ##__VA_ARGS__); \
 } while (0)
@@ -0,0 +1,836 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <atomic>
+#include <thread>
+
+#include "TestUtil.h"
+
+#include "ClientLeaseAgent.h"
+#include "Cycles.h"
+#include "Dispatch.h"
+#include "Key.h"
+#include "Logger.h"
+#include "MockCluster.h"
+#include "Object.h"
+#include "OptionParser.h"
+#include "PerfStats.h"
+#include "RamCloud.h"
+#include "Seglet.h"
+#include "WorkerManager.h"
+
+namespace RAMCloud {
+
+/**
+ * Measures the throughput of a single master inside one process, without
+ * any network transport, so that changes to the master's hot paths (hash
+ * table, log, object manager, transactions) can be evaluated on a single
+ * machine. The master is a real MasterService with its own WorkerManager,
+ * replicating to backups that keep their replicas in memory (MockCluster).
+ * Load-generator threads format requests exactly as the client library
+ * would and hand them to the master's dispatch thread, which passes them
+ * to the WorkerManager just as a transport would; each load thread has one
+ * request outstanding at a time.
+ *
+ * For each kind of operation the benchmark prints the throughput, the
+ * throughput per worker core, and a breakdown of where the time for each
+ * request went, both from timestamps on each request and from the master's
+ * PerfStats.
+ *
+ * The "cache" operation uses the table as a cache (see
+ * ServerConfig::Master::cacheTables): it reads skewed keys and writes
+ * back any that are missing, as an application would after recomputing
+ * them, and reports the hit rate. Running it with --cache and several
+ * values of --logMegs gives the hit rate as a function of memory.
+ */
+class MasterBenchmark {
+  public:
+    /// The kinds of operations the benchmark can issue.
+    enum OpType { READ, WRITE, MULTI_READ, MULTI_WRITE, INCREMENT, TX, CACHE,
+                  NUM_OP_TYPES };
+
+    /**
+     * A request injected directly into the master's WorkerManager. The
+     * master "sends" the reply by marking the request complete; the load
+     * thread that issued it is spinning, waiting for that to happen.
+     */
+    class BenchmarkRpc : public Transport::ServerRpc {
+      public:
+        BenchmarkRpc()
+            : completed(false)
+            , injectTime(0)
+            , dispatchTime(0)
+            , replyTime(0)
+        {}
+
+        void
+        sendReply()
+        {
+            replyTime = Cycles::rdtsc();
+            completed.store(true);
+        }
+
+        string
+        getClientServiceLocator()
+        {
+            return "benchmark:";
+        }
+
+        /// Set by the dispatch thread once the reply is ready.
+        std::atomic<bool> completed;
+
+        /// Cycles::rdtsc times when the load thread handed the request to
+        /// the dispatch thread, when the dispatch thread passed it to the
+        /// WorkerManager, and when the reply was sent.
+        uint64_t injectTime;
+        uint64_t dispatchTime;
+        uint64_t replyTime;
+
+        DISALLOW_COPY_AND_ASSIGN(BenchmarkRpc);
+    };
+
+    /**
+     * Runs in the master's dispatch thread and passes requests from the
+     * load threads to the WorkerManager, playing the role of a transport.
+     */
+    class RpcInjector : public Dispatch::Poller {
+      public:
+        explicit RpcInjector(Context* context)
+            : Dispatch::Poller(context->dispatch, "RpcInjector")
+            , context(context)
+            , mutex("MasterBenchmark::RpcInjector")
+            , pending()
+            , ready()
+        {}
+
+        /**
+         * Queue a request for the master; may be invoked in any thread.
+         */
+        void
+        inject(BenchmarkRpc* rpc)
+        {
+            rpc->completed.store(false);
+            rpc->injectTime = Cycles::rdtsc();
+            SpinLock::Guard _(mutex);
+            pending.push_back(rpc);
+        }
+
+        int
+        poll()
+        {
+            {
+                SpinLock::Guard _(mutex);
+                if (pending.empty()) {
+                    return 0;
+                }
+                ready.swap(pending);
+            }
+            foreach (BenchmarkRpc* rpc, ready) {
+                rpc->dispatchTime = Cycles::rdtsc();
+                context->workerManager->handleRpc(rpc);
+            }
+            ready.clear();
+            return 1;
+        }
+
+      PRIVATE:
+        /// The master's context.
+        Context* context;
+
+        /// Protects pending.
+        SpinLock mutex;
+
+        /// Requests waiting to be passed to the WorkerManager.
+        vector<BenchmarkRpc*> pending;
+
+        /// Used only by poll (kept here to avoid reallocation).
+        vector<BenchmarkRpc*> ready;
+
+        DISALLOW_COPY_AND_ASSIGN(RpcInjector);
+    };
+
+    /**
+     * Statistics gathered by one load thread.
+     */
+    struct ThreadStats {
+        ThreadStats()
+            : ops(0)
+            , failures(0)
+            , misses(0)
+            , queueCycles(0)
+            , serviceCycles(0)
+            , completionCycles(0)
+        {}
+
+        /// Number of requests completed.
+        uint64_t ops;
+
+        /// Number of requests that didn't succeed (error status, or
+        /// transaction not committed).
+        uint64_t failures;
+
+        /// Number of CACHE reads that didn't find their object (each of
+        /// these was followed by a write, which is also counted in #ops).
+        uint64_t misses;
+
+        /// Total time between a load thread injecting requests and the
+        /// dispatch thread passing them to the WorkerManager.
+        uint64_t queueCycles;
+
+        /// Total time between the WorkerManager receiving requests and
+        /// their replies being sent.
+        uint64_t serviceCycles;
+
+        /// Total time between replies being sent and the load thread
+        /// noticing them.
+        uint64_t completionCycles;
+    };
+
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    Server* master;
+    Context* masterContext;
+    Tub<RpcInjector> injector;
+    uint64_t tableId;
+    uint64_t numObjects;
+    uint32_t objectSize;
+
+    /// Number of counter objects used for INCREMENT operations; their keys
+    /// follow the keys of the regular objects.
+    static const uint64_t NUM_COUNTERS = 1000;
+
+    /// Set to tell the load threads to stop issuing requests.
+    std::atomic<bool> stop;
+
+    MasterBenchmark(uint32_t numReplicas, uint32_t maxCores,
+            uint64_t logMegs, bool cache, bool numaAware)
+        : context()
+        , cluster(&context)
+        , ramcloud()
+        , master(NULL)
+        , masterContext(NULL)
+        , injector()
+        , tableId()
+        , numObjects(0)
+        , objectSize(0)
+        , stop(false)
+    {
+        Logger::get().setLogLevels(WARNING);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.segmentSize = Segment::DEFAULT_SEGMENT_SIZE;
+        config.segletSize = Seglet::DEFAULT_SEGLET_SIZE;
+        config.maxObjectDataSize = config.segmentSize / 8;
+        config.master.numReplicas = numReplicas;
+        config.master.disableLogCleaner = false;
+        config.master.numaAware = numaAware;
+        if (cache) {
+            // The benchmark table is the first one created in the cluster.
+            config.master.cacheTables = "1";
+        }
+        config.backup.numSegmentFrames = downCast<uint32_t>(
+                2 * logMegs * 1024 * 1024 / config.segmentSize + 16);
+        config.maxCores = maxCores + 1;
+
+        // Backups first, so that the master can replicate as soon as it
+        // enlists.
+        config.services = {WireFormat::BACKUP_SERVICE,
+                           WireFormat::PING_SERVICE,
+                           WireFormat::MEMBERSHIP_SERVICE};
+        for (uint32_t i = 0; i < numReplicas; i++) {
+            config.localLocator = format("mock:host=backup%u", i);
+            cluster.addServer(config);
+        }
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::PING_SERVICE,
+                           WireFormat::MEMBERSHIP_SERVICE};
+        config.setLogAndHashTableSize(format("%lu", logMegs), "10%");
+        config.localLocator = "mock:host=master";
+        master = cluster.addServer(config);
+        masterContext = cluster.contexts.back();
+        cluster.syncCoordinatorServerList();
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = cluster.coordinator->tableManager.createTable("benchmark",
+                1, master->serverId);
+        if (cache && tableId != 1) {
+            DIE("Expected benchmark table to have id 1, but it is %lu",
+                    tableId);
+        }
+        injector.construct(masterContext);
+    }
+
+    /**
+     * Create the objects that requests will access. This uses the normal
+     * client library, so the requests execute synchronously in this thread.
+     *
+     * \param count
+     *      Number of objects to create; keys are 0..count-1 as 8-byte
+     *      integers.
+     * \param size
+     *      Size of each object's value, in bytes.
+     */
+    void
+    fill(uint64_t count, uint32_t size)
+    {
+        numObjects = count;
+        objectSize = size;
+        char value[size];
+        memset(value, 'x', size);
+        uint64_t start = Cycles::rdtsc();
+        for (uint64_t i = 0; i < numObjects; i++) {
+            ramcloud->write(tableId, &i, sizeof(i), value, size);
+        }
+        int64_t zero = 0;
+        for (uint64_t i = numObjects; i < numObjects + NUM_COUNTERS; i++) {
+            ramcloud->write(tableId, &i, sizeof(i), &zero, sizeof(zero));
+        }
+        printf("Wrote %lu %u-byte objects in %.1f s\n", numObjects, size,
+               Cycles::toSeconds(Cycles::rdtsc() - start));
+    }
+
+    /**
+     * Issue one kind of operation from several load threads for a given
+     * time, then print the results.
+     *
+     * \param type
+     *      Kind of operation to issue.
+     * \param numThreads
+     *      Number of load-generator threads.
+     * \param seconds
+     *      How long to issue requests.
+     * \param batchSize
+     *      Number of objects accessed by each multi-object operation or
+     *      transaction.
+     */
+    void
+    run(OpType type, int numThreads, double seconds, uint32_t batchSize)
+    {
+        // Each thread gets its own lease, so that linearizable requests
+        // from different threads never share RPC ids.
+        std::vector<WireFormat::ClientLease> leases;
+        for (int i = 0; i < numThreads; i++) {
+            ClientLeaseAgent agent(ramcloud.get());
+            leases.push_back(agent.getLease());
+        }
+
+        std::vector<ThreadStats> stats(numThreads);
+        std::atomic<int> running(numThreads);
+        stop.store(false);
+        PerfStats before, after;
+        PerfStats::collectStats(&before);
+
+        // This thread acts as the master's dispatch thread for the duration
+        // of the run.
+        Dispatch* dispatch = masterContext->dispatch;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < numThreads; i++) {
+            threads.emplace_back(&MasterBenchmark::loadThread, this, type,
+                    leases[i], batchSize, &stats[i], &running);
+        }
+        uint64_t start = Cycles::rdtsc();
+        uint64_t stopTime = start + Cycles::fromSeconds(seconds);
+        while (running.load() > 0) {
+            dispatch->poll();
+            if (!stop.load() && (Cycles::rdtsc() >= stopTime)) {
+                stop.store(true);
+            }
+        }
+        uint64_t elapsed = Cycles::rdtsc() - start;
+        foreach (std::thread& thread, threads) {
+            thread.join();
+        }
+        PerfStats::collectStats(&after);
+
+        ThreadStats total;
+        foreach (ThreadStats& s, stats) {
+            total.ops += s.ops;
+            total.failures += s.failures;
+            total.misses += s.misses;
+            total.queueCycles += s.queueCycles;
+            total.serviceCycles += s.serviceCycles;
+            total.completionCycles += s.completionCycles;
+        }
+        printResults(type, total, elapsed, &before, &after, batchSize);
+    }
+
+    /**
+     * Return a human-readable name for an operation type.
+     */
+    static const char*
+    opName(OpType type)
+    {
+        static const char* names[] = {"read", "write", "multiRead",
+                "multiWrite", "increment", "tx", "cache"};
+        return names[type];
+    }
+
+  PRIVATE:
+    /**
+     * Fill in the common part of a request header.
+     */
+    template<typename Op>
+    static typename Op::Request*
+    allocHeader(Buffer* request)
+    {
+        typename Op::Request* reqHdr =
+                request->emplaceAppend<typename Op::Request>();
+        memset(reqHdr, 0, sizeof(*reqHdr));
+        reqHdr->common.opcode = Op::opcode;
+        reqHdr->common.service = Op::service;
+        return reqHdr;
+    }
+
+    /**
+     * Return the key of a randomly chosen object (or counter, if
+     * \a counter is true).
+     */
+    uint64_t
+    randomKey(bool counter = false)
+    {
+        if (counter) {
+            return numObjects + generateRandom() % NUM_COUNTERS;
+        }
+        return generateRandom() % numObjects;
+    }
+
+    /**
+     * Return the key of a randomly chosen object, with a skewed
+     * distribution: 90% of the keys are chosen from the first 10% of the
+     * objects.
+     */
+    uint64_t
+    hotspotKey()
+    {
+        uint64_t hotObjects = std::max(numObjects / 10, 1UL);
+        if (generateRandom() % 10 != 0) {
+            return generateRandom() % hotObjects;
+        }
+        return generateRandom() % numObjects;
+    }
+
+    /**
+     * Format a write request for a single object in a Buffer, as the
+     * client library would.
+     *
+     * \param key
+     *      Key of the object to write (must remain valid until the request
+     *      has been processed).
+     * \param lease
+     *      Lease to use for the request.
+     * \param nextRpcId
+     *      Next RPC id to use (with this lease); incremented.
+     * \param value
+     *      Value for the object (objectSize bytes).
+     * \param request
+     *      The request is appended here.
+     */
+    void
+    formatWrite(uint64_t* key, WireFormat::ClientLease lease,
+            uint64_t* nextRpcId, const char* value, Buffer* request)
+    {
+        WireFormat::Write::Request* reqHdr =
+                allocHeader<WireFormat::Write>(request);
+        Key objectKey(tableId, key, sizeof(*key));
+        uint32_t length = 0;
+        Object::appendKeysAndValueToBuffer(objectKey, value, objectSize,
+                request, false, &length);
+        reqHdr->tableId = tableId;
+        reqHdr->length = length;
+        reqHdr->lease = lease;
+        reqHdr->rpcId = *nextRpcId;
+        reqHdr->ackId = *nextRpcId - 1;
+        (*nextRpcId)++;
+    }
+
+    /**
+     * Format a request of a given type in a Buffer, as the client library
+     * would.
+     *
+     * \param type
+     *      Kind of operation.
+     * \param lease
+     *      Lease to use for linearizable requests.
+     * \param nextRpcId
+     *      Next RPC id to use for linearizable requests (with this lease);
+     *      updated to reflect the ids consumed by this request.
+     * \param batchSize
+     *      Number of objects for multi-object operations and transactions.
+     * \param value
+     *      Value for written objects (objectSize bytes).
+     * \param keys
+     *      Storage for the keys referenced by the request (must hold at
+     *      least batchSize entries and remain valid until the request has
+     *      been processed).
+     * \param request
+     *      The request is appended here.
+     */
+    void
+    formatRequest(OpType type, WireFormat::ClientLease lease,
+            uint64_t* nextRpcId, uint32_t batchSize, const char* value,
+            uint64_t* keys, Buffer* request)
+    {
+        uint16_t keyLength = sizeof(keys[0]);
+        RejectRules rejectRules;
+        memset(&rejectRules, 0, sizeof(rejectRules));
+        switch (type) {
+            case READ:
+            case CACHE: {
+                WireFormat::Read::Request* reqHdr =
+                        allocHeader<WireFormat::Read>(request);
+                keys[0] = (type == CACHE) ? hotspotKey() : randomKey();
+                reqHdr->tableId = tableId;
+                reqHdr->keyLength = keyLength;
+                request->appendExternal(&keys[0], keyLength);
+                break;
+            }
+            case WRITE: {
+                keys[0] = randomKey();
+                formatWrite(&keys[0], lease, nextRpcId, value, request);
+                break;
+            }
+            case MULTI_READ:
+            case MULTI_WRITE: {
+                WireFormat::MultiOp::Request* reqHdr =
+                        allocHeader<WireFormat::MultiOp>(request);
+                reqHdr->count = batchSize;
+                reqHdr->type = (type == MULTI_READ)
+                        ? WireFormat::MultiOp::READ
+                        : WireFormat::MultiOp::WRITE;
+                for (uint32_t i = 0; i < batchSize; i++) {
+                    keys[i] = randomKey();
+                    if (type == MULTI_READ) {
+                        request->emplaceAppend<
+                                WireFormat::MultiOp::Request::ReadPart>(
+                                tableId, keyLength, rejectRules);
+                        request->appendExternal(&keys[i], keyLength);
+                    } else {
+                        Key key(tableId, &keys[i], keyLength);
+                        WireFormat::MultiOp::Request::WritePart* part =
+                                request->emplaceAppend<
+                                WireFormat::MultiOp::Request::WritePart>(
+                                tableId, 0, rejectRules);
+                        uint32_t length = 0;
+                        Object::appendKeysAndValueToBuffer(key, value,
+                                objectSize, request, false, &length);
+                        part->length = length;
+                    }
+                }
+                break;
+            }
+            case INCREMENT: {
+                WireFormat::Increment::Request* reqHdr =
+                        allocHeader<WireFormat::Increment>(request);
+                keys[0] = randomKey(true);
+                reqHdr->tableId = tableId;
+                reqHdr->lease = lease;
+                reqHdr->rpcId = *nextRpcId;
+                reqHdr->ackId = *nextRpcId - 1;
+                reqHdr->keyLength = keyLength;
+                reqHdr->incrementInt64 = 1;
+                (*nextRpcId)++;
+                request->appendExternal(&keys[0], keyLength);
+                break;
+            }
+            case TX: {
+                // A write-only transaction whose objects are all on this
+                // master, so it commits in a single prepare RPC (the same
+                // optimization the client library uses).
+                WireFormat::TxPrepare::Request* reqHdr =
+                        allocHeader<WireFormat::TxPrepare>(request);
+                uint64_t txId = *nextRpcId;
+                reqHdr->lease = lease;
+                reqHdr->clientTxId = txId;
+                reqHdr->ackId = txId - 1;
+                reqHdr->participantCount = batchSize;
+                reqHdr->opCount = batchSize;
+                for (uint32_t i = 0; i < batchSize; i++) {
+                    keys[i] = randomKey();
+                    request->emplaceAppend<WireFormat::TxParticipant>(
+                            tableId, Key::getHash(tableId, &keys[i],
+                            keyLength), txId + 1 + i);
+                }
+                for (uint32_t i = 0; i < batchSize; i++) {
+                    Key key(tableId, &keys[i], keyLength);
+                    WireFormat::TxPrepare::Request::WriteOp* op =
+                            request->emplaceAppend<
+                            WireFormat::TxPrepare::Request::WriteOp>(
+                            tableId, txId + 1 + i, 0, rejectRules);
+                    uint32_t length = 0;
+                    Object::appendKeysAndValueToBuffer(key, value,
+                            objectSize, request, false, &length);
+                    op->length = length;
+                }
+                *nextRpcId += batchSize + 1;
+                break;
+            }
+            default:
+                DIE("unknown operation type %d", type);
+        }
+    }
+
+    /**
+     * Top-level method for load-generator threads: issue requests one at a
+     * time until told to stop.
+     *
+     * \param type
+     *      Kind of operation to issue.
+     * \param lease
+     *      Lease for this thread's linearizable requests.
+     * \param batchSize
+     *      Number of objects for multi-object operations and transactions.
+     * \param stats
+     *      Statistics for this thread are recorded here.
+     * \param running
+     *      Decremented when this thread has finished.
+     */
+    void
+    loadThread(OpType type, WireFormat::ClientLease lease,
+            uint32_t batchSize, ThreadStats* stats, std::atomic<int>* running)
+    {
+        BenchmarkRpc rpc;
+        std::vector<char> value(objectSize, 'y');
+        std::vector<uint64_t> keys(batchSize);
+        uint64_t nextRpcId = 1;
+
+        while (!stop.load()) {
+            rpc.requestPayload.reset();
+            rpc.replyPayload.reset();
+            formatRequest(type, lease, &nextRpcId, batchSize, value.data(),
+                    keys.data(), &rpc.requestPayload);
+            injector->inject(&rpc);
+            while (!rpc.completed.load()) {
+                /* Wait for the master to finish the request. */
+            }
+            uint64_t done = Cycles::rdtsc();
+
+            stats->ops++;
+            stats->queueCycles += rpc.dispatchTime - rpc.injectTime;
+            stats->serviceCycles += rpc.replyTime - rpc.dispatchTime;
+            stats->completionCycles += done - rpc.replyTime;
+            const WireFormat::ResponseCommon* response =
+                    rpc.replyPayload.getStart<WireFormat::ResponseCommon>();
+            if ((type == CACHE) && (response != NULL) &&
+                    (response->status == STATUS_OBJECT_DOESNT_EXIST)) {
+                // Cache miss: "recompute" the object and write it back.
+                stats->misses++;
+                rpc.requestPayload.reset();
+                rpc.replyPayload.reset();
+                formatWrite(&keys[0], lease, &nextRpcId, value.data(),
+                        &rpc.requestPayload);
+                injector->inject(&rpc);
+                while (!rpc.completed.load()) {
+                    /* Wait for the master to finish the request. */
+                }
+                done = Cycles::rdtsc();
+                stats->ops++;
+                stats->queueCycles += rpc.dispatchTime - rpc.injectTime;
+                stats->serviceCycles += rpc.replyTime - rpc.dispatchTime;
+                stats->completionCycles += done - rpc.replyTime;
+                response = rpc.replyPayload.getStart<
+                        WireFormat::ResponseCommon>();
+            }
+            if ((response == NULL) || (response->status != STATUS_OK)) {
+                stats->failures++;
+            } else if (type == TX) {
+                const WireFormat::TxPrepare::Response* txResponse =
+                        rpc.replyPayload.getStart<
+                        WireFormat::TxPrepare::Response>();
+                if ((txResponse == NULL) || (txResponse->vote !=
+                        WireFormat::TxPrepare::COMMITTED)) {
+                    stats->failures++;
+                }
+            }
+        }
+        running->fetch_sub(1);
+    }
+
+    /**
+     * Print the results of one run.
+     */
+    void
+    printResults(OpType type, const ThreadStats& total, uint64_t elapsed,
+            const PerfStats* before, const PerfStats* after,
+            uint32_t batchSize)
+    {
+        double seconds = Cycles::toSeconds(elapsed);
+        double ops = static_cast<double>(std::max(total.ops, 1UL));
+        double workerCores = static_cast<double>(after->workerActiveCycles
+                - before->workerActiveCycles) / static_cast<double>(elapsed);
+        double dispatchCores = static_cast<double>(
+                after->dispatchActiveCycles - before->dispatchActiveCycles)
+                / static_cast<double>(elapsed);
+        double throughput = static_cast<double>(total.ops) / seconds;
+
+        printf("\n%s", opName(type));
+        if ((type == MULTI_READ) || (type == MULTI_WRITE) || (type == TX)) {
+            printf(" (%u objects per request)", batchSize);
+        }
+        printf(": %lu requests in %.2f s, %lu failed\n", total.ops, seconds,
+                total.failures);
+        printf("  Throughput:              %10.0f requests/s\n", throughput);
+        if (type == CACHE) {
+            uint64_t reads = total.ops - total.misses;
+            printf("  Hit rate:                %10.1f%% (%lu misses)\n",
+                    100.0 * static_cast<double>(reads - total.misses)
+                    / static_cast<double>(std::max(reads, 1UL)),
+                    total.misses);
+        }
+        printf("  Per worker core:         %10.0f requests/s "
+                "(%.2f worker cores busy)\n",
+                (workerCores > 0) ? throughput / workerCores : 0.0,
+                workerCores);
+        printf("  Dispatch utilization:    %10.2f\n", dispatchCores);
+        printf("  Time per request:\n");
+        printf("    Handoff to dispatch:   %10.1f ns\n",
+                toNs(total.queueCycles) / ops);
+        printf("    Worker + reply:        %10.1f ns\n",
+                toNs(total.serviceCycles) / ops);
+        printf("    Reply to client:       %10.1f ns\n",
+                toNs(total.completionCycles) / ops);
+        printf("  Master cycles per request:\n");
+        printf("    Dispatch thread:       %10.1f ns\n",
+                toNs(after->dispatchActiveCycles
+                - before->dispatchActiveCycles) / ops);
+        printf("    Worker threads:        %10.1f ns\n",
+                toNs(after->workerActiveCycles
+                - before->workerActiveCycles) / ops);
+        printf("    Log sync:              %10.1f ns\n",
+                toNs(after->logSyncCycles - before->logSyncCycles) / ops);
+        printf("  Log bytes per request:   %10.1f\n",
+                static_cast<double>(after->logBytesAppended
+                - before->logBytesAppended) / ops);
+        printf("  Replication RPCs/request:%10.3f\n",
+                static_cast<double>(after->replicationRpcs
+                - before->replicationRpcs) / ops);
+        uint64_t localReads = after->numaLocalReads - before->numaLocalReads;
+        uint64_t remoteReads = after->numaRemoteReads
+                - before->numaRemoteReads;
+        if (localReads + remoteReads > 0) {
+            printf("  NUMA reads:              %10lu local, %lu remote "
+                    "(%.1f%% remote)\n", localReads, remoteReads,
+                    100.0 * static_cast<double>(remoteReads)
+                    / static_cast<double>(localReads + remoteReads));
+        }
+    }
+
+    static double
+    toNs(uint64_t cycles)
+    {
+        return static_cast<double>(Cycles::toNanoseconds(cycles));
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(MasterBenchmark);
+};
+
+}  // namespace RAMCloud
+
+int
+main(int argc, char** argv)
+{
+    using namespace RAMCloud;
+
+    string ops;
+    int numThreads;
+    uint32_t maxCores, numReplicas, objectSize, batchSize;
+    uint64_t numObjects, logMegs;
+    double seconds;
+    bool cache, numaAware;
+
+    OptionsDescription benchmarkOptions("MasterBenchmark");
+    benchmarkOptions.add_options()
+        ("ops",
+         ProgramOptions::value<string>(&ops)->default_value(
+                "read,write,multiRead,multiWrite,increment,tx"),
+         "Comma-separated list of operations to measure (read, write, "
+         "multiRead, multiWrite, increment, tx, cache)")
+        ("threads,t",
+         ProgramOptions::value<int>(&numThreads)->default_value(4),
+         "Number of load-generator threads")
+        ("workers,w",
+         ProgramOptions::value<uint32_t>(&maxCores)->default_value(3),
+         "Number of worker threads the master may use")
+        ("replicas,r",
+         ProgramOptions::value<uint32_t>(&numReplicas)->default_value(1),
+         "Number of backup replicas of each segment (backups keep "
+         "replicas in memory)")
+        ("objects,n",
+         ProgramOptions::value<uint64_t>(&numObjects)->default_value(100000),
+         "Number of objects in the table")
+        ("objectSize,s",
+         ProgramOptions::value<uint32_t>(&objectSize)->default_value(100),
+         "Size of each object's value in bytes")
+        ("batch,b",
+         ProgramOptions::value<uint32_t>(&batchSize)->default_value(10),
+         "Number of objects per multiRead, multiWrite, or transaction")
+        ("logMegs",
+         ProgramOptions::value<uint64_t>(&logMegs)->default_value(1024),
+         "Size of the master's log in megabytes")
+        ("seconds",
+         ProgramOptions::value<double>(&seconds)->default_value(2.0),
+         "How long to measure each operation")
+        ("cache",
+         ProgramOptions::bool_switch(&cache),
+         "Make the table a cache table, whose objects the master evicts "
+         "when memory runs short (use with the cache operation)")
+        ("numaAware",
+         ProgramOptions::bool_switch(&numaAware),
+         "Divide the master's log memory among NUMA nodes and count local "
+         "and remote reads (compare runs with and without this option, "
+         "e.g. under numactl)");
+
+    OptionParser optionParser(benchmarkOptions, argc, argv);
+
+    if ((numThreads < 1) || (maxCores < 1) || (numObjects == 0) ||
+            (batchSize == 0)) {
+        fprintf(stderr, "Threads, workers, objects and batch size must all "
+                "be positive\n");
+        return 1;
+    }
+    if (objectSize == 0 || objectSize > Segment::DEFAULT_SEGMENT_SIZE / 8) {
+        fprintf(stderr, "Object size must be between 1 and %u bytes\n",
+                Segment::DEFAULT_SEGMENT_SIZE / 8);
+        return 1;
+    }
+
+    std::vector<MasterBenchmark::OpType> types;
+    std::stringstream opList(ops);
+    string op;
+    while (std::getline(opList, op, ',')) {
+        bool found = false;
+        for (int i = 0; i < MasterBenchmark::NUM_OP_TYPES; i++) {
+            MasterBenchmark::OpType type =
+                    static_cast<MasterBenchmark::OpType>(i);
+            if (op == MasterBenchmark::opName(type)) {
+                types.push_back(type);
+                found = true;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "Unknown operation '%s'\n", op.c_str());
+            return 1;
+        }
+    }
+
+    MasterBenchmark benchmark(numReplicas, maxCores, logMegs, cache,
+            numaAware);
+    benchmark.fill(numObjects, objectSize);
+    foreach (MasterBenchmark::OpType type, types) {
+        benchmark.run(type, numThreads, seconds, batchSize);
+    }
+    return 0;
+}
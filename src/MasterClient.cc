@@ -27,6 +27,72 @@ namespace RAMCloud {
 // Default RejectRules to use if none are provided by the caller.
 RejectRules defaultRejectRules;
 
+/**
+ * Instruct a master to discard its read-only copy of an object (see
+ * HotKeyReplicas). This is invoked by the object's owner when it modifies
+ * the object, before it acknowledges the modification.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master holding the copy.
+ * \param tableId
+ *      Identifier for the table containing the object.
+ * \param key
+ *      Primary key for the object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param pushId
+ *      The highest pushId the owner has assigned so far; the master will
+ *      ignore any push of this object with this pushId or a lower one.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+MasterClient::dropHotObject(Context* context, ServerId serverId,
+        uint64_t tableId, const void* key, uint16_t keyLength,
+        uint64_t pushId)
+{
+    DropHotObjectRpc rpc(context, serverId, tableId, key, keyLength, pushId);
+    rpc.wait();
+}
+
+/**
+ * Constructor for DropHotObjectRpc: initiates an RPC in the same way as
+ * #MasterClient::dropHotObject, but returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master holding the copy.
+ * \param tableId
+ *      Identifier for the table containing the object.
+ * \param key
+ *      Primary key for the object. The caller must ensure that the storage
+ *      for this key is unchanged through the life of the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param pushId
+ *      The highest pushId the owner has assigned so far.
+ */
+DropHotObjectRpc::DropHotObjectRpc(Context* context, ServerId serverId,
+        uint64_t tableId, const void* key, uint16_t keyLength,
+        uint64_t pushId)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::DropHotObject::Response))
+{
+    WireFormat::DropHotObject::Request* reqHdr(
+            allocHeader<WireFormat::DropHotObject>(serverId));
+    reqHdr->tableId = tableId;
+    reqHdr->keyLength = keyLength;
+    reqHdr->pushId = pushId;
+    request.append(key, keyLength);
+    send();
+}
+
 /**
  * Instruct the master that it must no longer serve requests for the indexlet
  * specified. The server may reclaim all memory previously allocated to that
@@ -226,6 +292,68 @@ GetHeadOfLogRpc::wait()
     return { respHdr->headSegmentId, respHdr->headSegmentOffset };
 }
 
+/**
+ * Fetch the per-tablet access statistics a master has gathered for the
+ * tablets it owns. This is used by the coordinator to find hot tablets.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the target master.
+ * \param[out] serverStats
+ *      Filled in with the master's statistics.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+MasterClient::getTabletStatistics(Context* context, ServerId serverId,
+        ProtoBuf::ServerStatistics* serverStats)
+{
+    GetTabletStatisticsRpc rpc(context, serverId);
+    rpc.wait(serverStats);
+}
+
+/**
+ * Constructor for GetTabletStatisticsRpc: initiates an RPC in the same way
+ * as #MasterClient::getTabletStatistics, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the target master.
+ */
+GetTabletStatisticsRpc::GetTabletStatisticsRpc(Context* context,
+        ServerId serverId)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::GetServerStatistics::Response))
+{
+    allocHeader<WireFormat::GetServerStatistics>();
+    send();
+}
+
+/**
+ * Wait for a getTabletStatistics RPC to complete.
+ *
+ * \param[out] serverStats
+ *      Filled in with the master's statistics.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+GetTabletStatisticsRpc::wait(ProtoBuf::ServerStatistics* serverStats)
+{
+    waitAndCheckErrors();
+    const WireFormat::GetServerStatistics::Response* respHdr(
+            getResponseHeader<WireFormat::GetServerStatistics>());
+    ProtoBuf::parseFromResponse(response, sizeof(*respHdr),
+            respHdr->serverStatsLength, serverStats);
+}
+
 /**
  * This RPC is sent to an index server to request that it insert an index
  * entry in an indexlet it holds.
@@ -522,6 +650,267 @@ PrepForMigrationRpc::PrepForMigrationRpc(Context* context, ServerId serverId,
     send();
 }
 
+/**
+ * Fetch a batch of a tablet's objects from a master that handed the tablet
+ * over to this server but still holds its objects (see
+ * WireFormat::MigrateTablet::Request::pull). The source's hash table is
+ * divided into \a numPartitions slices; each call returns the objects found
+ * in the next few buckets of one slice, so the new owner can pull a tablet
+ * with one outstanding request per slice.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that holds the tablet's objects.
+ * \param tableId
+ *      Identifier for the table.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet range to be pulled.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet range to be pulled.
+ * \param partition
+ *      Which slice of the master's hash table to scan; must be less
+ *      than \a numPartitions.
+ * \param numPartitions
+ *      Number of slices the pull is divided into.
+ * \param[in,out] cursor
+ *      Position within the slice at which to resume: 0 for the first call
+ *      on a slice. Updated to the value to pass on the next call.
+ * \param[out] response
+ *      Filled in with a Segment containing the pulled objects. Any previous
+ *      contents are discarded.
+ * \param[out] certificate
+ *      Filled in with the certificate needed to iterate the segment in
+ *      \a response.
+ *
+ * \return
+ *      True if the slice has been completely pulled; false if this method
+ *      should be called again with the updated \a cursor.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ * \throw UnknownTabletException
+ *      The master does not hold the given tablet for a puller.
+ */
+bool
+MasterClient::pullTabletData(Context* context, ServerId serverId,
+        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+        uint32_t partition, uint32_t numPartitions, uint64_t* cursor,
+        Buffer* response, SegmentCertificate* certificate)
+{
+    PullTabletDataRpc rpc(context, serverId, tableId, firstKeyHash,
+            lastKeyHash, partition, numPartitions, *cursor, response);
+    return rpc.wait(cursor, certificate);
+}
+
+/**
+ * Constructor for PullTabletDataRpc: initiates an RPC in the same way as
+ * #MasterClient::pullTabletData, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that holds the tablet's objects.
+ * \param tableId
+ *      Identifier for the table.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet range to be pulled.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet range to be pulled.
+ * \param partition
+ *      Which slice of the master's hash table to scan; must be less
+ *      than \a numPartitions.
+ * \param numPartitions
+ *      Number of slices the pull is divided into.
+ * \param cursor
+ *      Position within the slice at which to resume: 0 for the first call
+ *      on a slice, otherwise the cursor returned by the previous call.
+ * \param[out] response
+ *      Filled in with a Segment containing the pulled objects. Any previous
+ *      contents are discarded.
+ */
+PullTabletDataRpc::PullTabletDataRpc(Context* context, ServerId serverId,
+        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+        uint32_t partition, uint32_t numPartitions, uint64_t cursor,
+        Buffer* response)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::PullTabletData::Response), response)
+{
+    WireFormat::PullTabletData::Request* reqHdr(
+            allocHeader<WireFormat::PullTabletData>(serverId));
+    reqHdr->tableId = tableId;
+    reqHdr->firstKeyHash = firstKeyHash;
+    reqHdr->lastKeyHash = lastKeyHash;
+    reqHdr->partition = partition;
+    reqHdr->numPartitions = numPartitions;
+    reqHdr->cursor = cursor;
+    reqHdr->priority = 0;
+    reqHdr->keyHash = 0;
+    send();
+}
+
+/**
+ * Constructor for PullTabletDataRpc that issues a priority pull: instead
+ * of scanning a slice of the hash table, the master returns just the
+ * tablet's objects with key hash \a keyHash. This lets a new owner fetch
+ * a key it was asked for ahead of the bulk transfer.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that holds the tablet's objects.
+ * \param tableId
+ *      Identifier for the table.
+ * \param keyHash
+ *      Key hash of the object(s) to pull.
+ * \param[out] response
+ *      Filled in with a Segment containing the pulled objects. Any previous
+ *      contents are discarded.
+ */
+PullTabletDataRpc::PullTabletDataRpc(Context* context, ServerId serverId,
+        uint64_t tableId, uint64_t keyHash, Buffer* response)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::PullTabletData::Response), response)
+{
+    WireFormat::PullTabletData::Request* reqHdr(
+            allocHeader<WireFormat::PullTabletData>(serverId));
+    reqHdr->tableId = tableId;
+    reqHdr->firstKeyHash = keyHash;
+    reqHdr->lastKeyHash = keyHash;
+    reqHdr->partition = 0;
+    reqHdr->numPartitions = 1;
+    reqHdr->cursor = 0;
+    reqHdr->priority = 1;
+    reqHdr->keyHash = keyHash;
+    send();
+}
+
+/**
+ * Wait for a pullTabletData RPC to complete, and throw exceptions for
+ * any errors.
+ *
+ * \param[out] cursor
+ *      If non-NULL, filled in with the value to pass as the cursor on the
+ *      next pull of the same slice.
+ * \param[out] certificate
+ *      Filled in with the certificate needed to iterate the segment left
+ *      in the response buffer given to the constructor.
+ *
+ * \return
+ *      True if the slice has been completely pulled (always true for a
+ *      priority pull).
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ * \throw UnknownTabletException
+ *      The master does not hold the given tablet for a puller.
+ */
+bool
+PullTabletDataRpc::wait(uint64_t* cursor, SegmentCertificate* certificate)
+{
+    waitAndCheckErrors();
+    const WireFormat::PullTabletData::Response* respHdr(
+            getResponseHeader<WireFormat::PullTabletData>());
+    if (cursor != NULL)
+        *cursor = respHdr->cursor;
+    *certificate = respHdr->certificate;
+    bool done = respHdr->done;
+
+    // respHdr off limits.
+    response->truncateFront(sizeof(WireFormat::PullTabletData::Response));
+    return done;
+}
+
+/**
+ * Send a read-only copy of a hot object to another master, which will serve
+ * reads of the object from the copy until the lease expires (see
+ * HotKeyReplicas).
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that should hold the copy.
+ * \param tableId
+ *      Identifier for the table containing the object.
+ * \param key
+ *      Primary key for the object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param pushId
+ *      Identifies this push; must be higher than the pushId of any earlier
+ *      push or drop of the object by this owner.
+ * \param version
+ *      Version of the object being pushed.
+ * \param leaseMs
+ *      How long the copy may be served, in milliseconds.
+ * \param value
+ *      The object's value; the entire contents are sent.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ * \throw StaleRpcException
+ *      The master has already seen a drop of the object with a pushId at
+ *      least as high as this one, so the copy is out of date.
+ */
+void
+MasterClient::pushHotObject(Context* context, ServerId serverId,
+        uint64_t tableId, const void* key, uint16_t keyLength,
+        uint64_t pushId, uint64_t version, uint32_t leaseMs, Buffer* value)
+{
+    PushHotObjectRpc rpc(context, serverId, tableId, key, keyLength, pushId,
+            version, leaseMs, value);
+    rpc.wait();
+}
+
+/**
+ * Constructor for PushHotObjectRpc: initiates an RPC in the same way as
+ * #MasterClient::pushHotObject, but returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that should hold the copy.
+ * \param tableId
+ *      Identifier for the table containing the object.
+ * \param key
+ *      Primary key for the object. The caller must ensure that the storage
+ *      for this key is unchanged through the life of the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param pushId
+ *      Identifies this push.
+ * \param version
+ *      Version of the object being pushed.
+ * \param leaseMs
+ *      How long the copy may be served, in milliseconds.
+ * \param value
+ *      The object's value. The caller must ensure that the contents of this
+ *      Buffer are unchanged through the life of the RPC.
+ */
+PushHotObjectRpc::PushHotObjectRpc(Context* context, ServerId serverId,
+        uint64_t tableId, const void* key, uint16_t keyLength,
+        uint64_t pushId, uint64_t version, uint32_t leaseMs, Buffer* value)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::PushHotObject::Response))
+{
+    WireFormat::PushHotObject::Request* reqHdr(
+            allocHeader<WireFormat::PushHotObject>(serverId));
+    reqHdr->tableId = tableId;
+    reqHdr->keyLength = keyLength;
+    reqHdr->pushId = pushId;
+    reqHdr->version = version;
+    reqHdr->leaseMs = leaseMs;
+    reqHdr->length = value->size();
+    request.append(key, keyLength);
+    request.appendExternal(value);
+    send();
+}
+
 /**
  * Request that a master add some migrated data to its storage.
  * The receiving master will not service requests on the data,
@@ -760,6 +1149,85 @@ RemoveIndexEntryRpc::handleIndexDoesntExist()
     response->emplaceAppend<WireFormat::ResponseCommon>()->status = STATUS_OK;
 }
 
+/**
+ * Ask the master that owns a tablet to migrate it to another master. This
+ * is the same as RamCloud::migrateTablet, except that the request goes to
+ * a specific master rather than to whichever master the client's tablet map
+ * says owns the tablet; it is used by the coordinator to rebalance load.
+ * The RPC does not return until the migration has completed.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that currently owns the tablet.
+ * \param tableId
+ *      Identifier for the table.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet to be migrated. Must match an
+ *      existing tablet on \a serverId exactly.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet to be migrated.
+ * \param newOwner
+ *      Master that will take over the tablet.
+ * \param pull
+ *      If true, ownership passes to \a newOwner as soon as the tablet's
+ *      writes have drained, and \a newOwner then pulls the tablet's
+ *      objects; the RPC returns after the handover, not after the data
+ *      has moved. Otherwise the objects are pushed to \a newOwner first.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ * \throw UnknownTabletException
+ *      \a serverId does not own the given tablet.
+ */
+void
+MasterClient::requestMigration(Context* context, ServerId serverId,
+        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+        ServerId newOwner, bool pull)
+{
+    RequestMigrationRpc rpc(context, serverId, tableId, firstKeyHash,
+            lastKeyHash, newOwner, pull);
+    rpc.wait();
+}
+
+/**
+ * Constructor for RequestMigrationRpc: initiates an RPC in the same way as
+ * #MasterClient::requestMigration, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that currently owns the tablet.
+ * \param tableId
+ *      Identifier for the table.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet to be migrated.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet to be migrated.
+ * \param newOwner
+ *      Master that will take over the tablet.
+ * \param pull
+ *      If true, hand the tablet over before moving its objects; see
+ *      MasterClient::requestMigration.
+ */
+RequestMigrationRpc::RequestMigrationRpc(Context* context, ServerId serverId,
+        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+        ServerId newOwner, bool pull)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::MigrateTablet::Response))
+{
+    WireFormat::MigrateTablet::Request* reqHdr(
+            allocHeader<WireFormat::MigrateTablet>());
+    reqHdr->tableId = tableId;
+    reqHdr->firstKeyHash = firstKeyHash;
+    reqHdr->lastKeyHash = lastKeyHash;
+    reqHdr->newOwnerMasterId = newOwner.getId();
+    reqHdr->pull = pull;
+    send();
+}
+
 /**
  * Request that a master (with id currentOwnerId) split a given indexlet at
  * splitKey and migrate the second indexlet resulting from this split to server
@@ -916,13 +1384,18 @@ SplitMasterTabletRpc::SplitMasterTabletRpc(Context* context,
  * \param lastKeyHash
  *      Largest value in the 64-bit key hash space for this table that belongs
  *      to the tablet.
+ * \param pullSource
+ *      If valid, the tablet's objects have not been moved to the target
+ *      yet: it must serve the tablet at once and pull the objects from
+ *      this master.
  */
 void
 MasterClient::takeTabletOwnership(Context* context, ServerId serverId,
-        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash)
+        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+        ServerId pullSource)
 {
     TakeTabletOwnershipRpc rpc(context, serverId, tableId, firstKeyHash,
-            lastKeyHash);
+            lastKeyHash, pullSource);
     rpc.wait();
 }
 
@@ -943,10 +1416,13 @@ MasterClient::takeTabletOwnership(Context* context, ServerId serverId,
  * \param lastKeyHash
  *      Largest value in the 64-bit key hash space for this table that belongs
  *      to the tablet.
+ * \param pullSource
+ *      If valid, the master from which the target must pull the tablet's
+ *      objects.
  */
 TakeTabletOwnershipRpc::TakeTabletOwnershipRpc(
         Context* context, ServerId serverId, uint64_t tableId,
-        uint64_t firstKeyHash, uint64_t lastKeyHash)
+        uint64_t firstKeyHash, uint64_t lastKeyHash, ServerId pullSource)
     : ServerIdRpcWrapper(context, serverId,
             sizeof(WireFormat::TakeTabletOwnership::Response))
 {
@@ -955,6 +1431,7 @@ TakeTabletOwnershipRpc::TakeTabletOwnershipRpc(
     reqHdr->tableId = tableId;
     reqHdr->firstKeyHash = firstKeyHash;
     reqHdr->lastKeyHash = lastKeyHash;
+    reqHdr->pullSourceId = pullSource.getId();
     send();
 }
 
@@ -43,6 +43,9 @@ class Segment;
  */
 class MasterClient {
   public:
+    static void dropHotObject(Context* context, ServerId serverId,
+            uint64_t tableId, const void* key, uint16_t keyLength,
+            uint64_t pushId);
     static void dropIndexletOwnership(Context* context, ServerId id,
             uint64_t tableId, uint8_t indexId, const void *firstKey,
             uint16_t firstKeyLength, const void *firstNotOwnedKey,
@@ -50,6 +53,8 @@ class MasterClient {
     static void dropTabletOwnership(Context* context, ServerId serverId,
             uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash);
     static LogPosition getHeadOfLog(Context* context, ServerId serverId);
+    static void getTabletStatistics(Context* context, ServerId serverId,
+            ProtoBuf::ServerStatistics* serverStats);
     static void insertIndexEntry(MasterService* master,
             uint64_t tableId, uint8_t indexId,
             const void* indexKey, KeyLength indexKeyLength,
@@ -62,6 +67,14 @@ class MasterClient {
             const void* firstNotOwnedKey, uint16_t firstNotOwnedKeyLength);
     static void prepForMigration(Context* context, ServerId serverId,
             uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash);
+    static bool pullTabletData(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            uint32_t partition, uint32_t numPartitions, uint64_t* cursor,
+            Buffer* response, SegmentCertificate* certificate);
+    static void pushHotObject(Context* context, ServerId serverId,
+            uint64_t tableId, const void* key, uint16_t keyLength,
+            uint64_t pushId, uint64_t version, uint32_t leaseMs,
+            Buffer* value);
     static void recover(Context* context, ServerId serverId,
             uint64_t recoveryId, ServerId crashedServerId,
             uint64_t partitionId,
@@ -77,6 +90,9 @@ class MasterClient {
             uint64_t tableId, uint8_t indexId,
             const void* indexKey, KeyLength indexKeyLength,
             uint64_t primaryKeyHash);
+    static void requestMigration(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            ServerId newOwner, bool pull = false);
     static void splitAndMigrateIndexlet(Context* context,
             ServerId currentOwnerId, ServerId newOwnerId,
             uint64_t tableId, uint8_t indexId,
@@ -85,7 +101,8 @@ class MasterClient {
     static void splitMasterTablet(Context* context, ServerId serverId,
             uint64_t tableId, uint64_t splitKeyHash);
     static void takeTabletOwnership(Context* context, ServerId id,
-            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash);
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            ServerId pullSource = ServerId());
     static void takeIndexletOwnership(Context* context, ServerId id,
             uint64_t tableId, uint8_t indexId, uint64_t backingTableId,
             const void *firstKey, uint16_t firstKeyLength,
@@ -98,6 +115,23 @@ class MasterClient {
     MasterClient();
 };
 
+/**
+ * Encapsulates the state of a MasterClient::dropHotObject
+ * request, allowing it to execute asynchronously.
+ */
+class DropHotObjectRpc : public ServerIdRpcWrapper {
+  public:
+    DropHotObjectRpc(Context* context, ServerId serverId,
+            uint64_t tableId, const void* key, uint16_t keyLength,
+            uint64_t pushId);
+    ~DropHotObjectRpc() {}
+    /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
+    void wait() {waitAndCheckErrors();}
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(DropHotObjectRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::dropIndexletOwnership
  * request, allowing it to execute asynchronously.
@@ -146,6 +180,20 @@ class GetHeadOfLogRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(GetHeadOfLogRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::getTabletStatistics
+ * request, allowing it to execute asynchronously.
+ */
+class GetTabletStatisticsRpc : public ServerIdRpcWrapper {
+  public:
+    GetTabletStatisticsRpc(Context* context, ServerId serverId);
+    ~GetTabletStatisticsRpc() {}
+    void wait(ProtoBuf::ServerStatistics* serverStats);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(GetTabletStatisticsRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::insertIndexEntry
  * request, allowing it to execute asynchronously.
@@ -214,6 +262,43 @@ class PrepForMigrationRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(PrepForMigrationRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::pullTabletData
+ * request, allowing it to execute asynchronously.
+ */
+class PullTabletDataRpc : public ServerIdRpcWrapper {
+  public:
+    PullTabletDataRpc(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            uint32_t partition, uint32_t numPartitions, uint64_t cursor,
+            Buffer* response);
+    PullTabletDataRpc(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t keyHash, Buffer* response);
+    ~PullTabletDataRpc() {}
+    bool wait(uint64_t* cursor, SegmentCertificate* certificate);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(PullTabletDataRpc);
+};
+
+/**
+ * Encapsulates the state of a MasterClient::pushHotObject
+ * request, allowing it to execute asynchronously.
+ */
+class PushHotObjectRpc : public ServerIdRpcWrapper {
+  public:
+    PushHotObjectRpc(Context* context, ServerId serverId,
+            uint64_t tableId, const void* key, uint16_t keyLength,
+            uint64_t pushId, uint64_t version, uint32_t leaseMs,
+            Buffer* value);
+    ~PushHotObjectRpc() {}
+    /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
+    void wait() {waitAndCheckErrors();}
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(PushHotObjectRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::receiveMigrationData
  * request, allowing it to execute asynchronously.
@@ -269,6 +354,23 @@ class RemoveIndexEntryRpc : public IndexRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(RemoveIndexEntryRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::requestMigration
+ * request, allowing it to execute asynchronously.
+ */
+class RequestMigrationRpc : public ServerIdRpcWrapper {
+  public:
+    RequestMigrationRpc(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            ServerId newOwner, bool pull = false);
+    ~RequestMigrationRpc() {}
+    /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
+    void wait() {waitAndCheckErrors();}
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(RequestMigrationRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::splitAndMigrateIndexlet
  * request, allowing it to execute asynchronously.
@@ -311,7 +413,8 @@ class SplitMasterTabletRpc : public ServerIdRpcWrapper {
 class TakeTabletOwnershipRpc : public ServerIdRpcWrapper {
   public:
     TakeTabletOwnershipRpc(Context* context, ServerId id,
-            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash);
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            ServerId pullSource = ServerId());
     ~TakeTabletOwnershipRpc() {}
     /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
     void wait() {waitAndCheckErrors();}
@@ -71,9 +71,12 @@ class MaybeStartRecoveryTask : public Task {
                     "another recovery is active for the same ServerId",
                     recovery->crashedServerId.toString().c_str());
             } else {
-                if (mgr.runtimeOptions)
+                if (mgr.runtimeOptions) {
                     recovery->testingFailRecoveryMasters =
                         mgr.runtimeOptions->popFailRecoveryMasters();
+                    recovery->phases =
+                        mgr.runtimeOptions->getRecoveryPhases();
+                }
                 recovery->schedule();
                 mgr.activeRecoveries[recovery->getRecoveryId()] = recovery;
                 mgr.waitingRecoveries.pop();
@@ -233,6 +236,18 @@ class RecoveryMasterFinishedTask : public Task {
                         ServerId(tablet.server_id()).toString().c_str(),
                         tablet.table_id(), tablet.start_key_hash(),
                         tablet.end_key_hash());
+                    if (tablet.state() ==
+                            ProtoBuf::Tablets::Tablet::PULL_SOURCE) {
+                        // The crashed master was serving this tablet to
+                        // a puller; the recovery master takes its place.
+                        mgr.tableManager.pullSourceRecovered(
+                            tablet.table_id(),
+                            tablet.start_key_hash(), tablet.end_key_hash(),
+                            ServerId(tablet.server_id()),
+                            {tablet.ctime_log_head_id(),
+                                    tablet.ctime_log_head_offset()});
+                        continue;
+                    }
                     mgr.tableManager.tabletRecovered(
                         tablet.table_id(),
                         tablet.start_key_hash(), tablet.end_key_hash(),
@@ -18,6 +18,7 @@
 
 #include "Buffer.h"
 #include "ClientException.h"
+#include "CompressedObject.h"
 #include "Cycles.h"
 #include "Dispatch.h"
 #include "Enumeration.h"
@@ -85,10 +86,16 @@ MasterService::MasterService(Context* context, const ServerConfig* config)
                     &masterTableMetadata,
                     &unackedRpcResults,
                     &transactionManager,
-                    &txRecoveryManager)
+                    &txRecoveryManager,
+                    &hotKeyReplicas,
+                    &tabletPuller)
     , tabletManager()
     , txRecoveryManager(context)
     , indexletManager(context, &objectManager)
+    , hotKeyReplicas(context, config, &serverId, &objectManager,
+            &hotKeyTracker)
+    , hotKeyTracker(&tabletManager, config->master.hotKeySampleInterval)
+    , tabletPuller(context, &serverId, &objectManager)
     , clusterClock()
     , clientLeaseValidator(context, &clusterClock)
     , unackedRpcResults(context, &objectManager, &clientLeaseValidator)
@@ -101,13 +108,72 @@ MasterService::MasterService(Context* context, const ServerConfig* config)
     , migrationMonitor(this)
 {
     context->services[WireFormat::MASTER_SERVICE] = this;
+    context->metricsRegistry->addCollector(this);
 }
 
 MasterService::~MasterService()
 {
+    context->metricsRegistry->removeCollector(this);
     context->services[WireFormat::MASTER_SERVICE] = NULL;
 }
 
+/**
+ * Adds this master's log usage and per-table statistics to a metrics
+ * snapshot (see MetricsRegistry::Collector::collect). The log and tablet
+ * information comes from counters that are read without acquiring the
+ * locks used by reads and writes.
+ */
+void
+MasterService::collect(MetricsRegistry::Snapshot* snapshot)
+{
+    PerfStats stats;
+    objectManager.getLog()->getMemoryStats(&stats);
+    snapshot->emplace_back("ramcloud_log_size_bytes", MetricsRegistry::GAUGE,
+            "", static_cast<double>(stats.logSizeBytes));
+    snapshot->emplace_back("ramcloud_log_used_bytes", MetricsRegistry::GAUGE,
+            "", static_cast<double>(stats.logUsedBytes));
+    snapshot->emplace_back("ramcloud_log_live_bytes", MetricsRegistry::GAUGE,
+            "", static_cast<double>(stats.logLiveBytes));
+    snapshot->emplace_back("ramcloud_log_appendable_bytes",
+            MetricsRegistry::GAUGE, "",
+            static_cast<double>(stats.logAppendableBytes));
+    snapshot->emplace_back("ramcloud_tablets", MetricsRegistry::GAUGE, "",
+            static_cast<double>(tabletManager.getNumTablets()));
+
+    // The per-table counters are read without acquiring their locks; each
+    // counter is a single word, so the worst case is a slightly stale
+    // value. Walking the table list does lock it against writes that add
+    // tables, so only the counters are copied while the scanner is open.
+    struct TableCounts {
+        uint64_t tableId;
+        uint64_t byteCount;
+        uint64_t recordCount;
+    };
+    vector<TableCounts> tables;
+    {
+        MasterTableMetadata::scanner scanner =
+                masterTableMetadata.getScanner();
+        while (scanner.hasNext()) {
+            MasterTableMetadata::Entry* entry = scanner.next();
+            if (entry->stats.keyHashCount == 0) {
+                // This master no longer owns any part of the table.
+                continue;
+            }
+            tables.push_back({entry->tableId, entry->stats.byteCount,
+                    entry->stats.recordCount});
+        }
+    }
+    foreach (const TableCounts& counts, tables) {
+        string table = MetricsRegistry::label("table", counts.tableId);
+        snapshot->emplace_back("ramcloud_table_bytes",
+                MetricsRegistry::GAUGE, table,
+                static_cast<double>(counts.byteCount));
+        snapshot->emplace_back("ramcloud_table_records",
+                MetricsRegistry::GAUGE, table,
+                static_cast<double>(counts.recordCount));
+    }
+}
+
 // See Server::dispatch.
 void
 MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
@@ -132,6 +198,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::DropTabletOwnership, MasterService,
                         &MasterService::dropTabletOwnership>(rpc);
             break;
+        case WireFormat::DropHotObject::opcode:
+            callHandler<WireFormat::DropHotObject, MasterService,
+                        &MasterService::dropHotObject>(rpc);
+            break;
         case WireFormat::DropIndexletOwnership::opcode:
             callHandler<WireFormat::DropIndexletOwnership, MasterService,
                         &MasterService::dropIndexletOwnership>(rpc);
@@ -192,6 +262,14 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::PrepForMigration, MasterService,
                         &MasterService::prepForMigration>(rpc);
             break;
+        case WireFormat::PushHotObject::opcode:
+            callHandler<WireFormat::PushHotObject, MasterService,
+                        &MasterService::pushHotObject>(rpc);
+            break;
+        case WireFormat::PullTabletData::opcode:
+            callHandler<WireFormat::PullTabletData, MasterService,
+                        &MasterService::pullTabletData>(rpc);
+            break;
         case WireFormat::Read::opcode:
             callHandler<WireFormat::Read, MasterService,
                         &MasterService::read>(rpc);
@@ -303,13 +381,40 @@ volatile int MasterService::pauseIncrement = 0;
 volatile int MasterService::continueIncrement = 0;
 #endif
 
+/**
+ * Top-level server method to handle the DROP_HOT_OBJECT request, which the
+ * owner of an object sends when it modifies the object or gives up its
+ * tablet, to discard the read-only copy of the object on this master (see
+ * HotKeyReplicas).
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::dropHotObject(
+        const WireFormat::DropHotObject::Request* reqHdr,
+        WireFormat::DropHotObject::Response* respHdr,
+        Rpc* rpc)
+{
+    const void* stringKey = rpc->requestPayload->getRange(sizeof32(*reqHdr),
+            reqHdr->keyLength);
+    if (stringKey == NULL) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+
+    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
+    hotKeyReplicas.dropCopy(key, reqHdr->pushId);
+}
+
 /**
  * Top-level server method to handle the DROP_TABLET_OWNERSHIP request.
  *
  * This RPC is issued by the coordinator when a table is dropped and all
- * tablets are being destroyed. This is not currently used in migration,
- * since the source master knows that it no longer owns the tablet when
- * the coordinator has responded to its REASSIGN_TABLET_OWNERSHIP rpc.
+ * tablets are being destroyed, and when the new owner of a tablet migrated
+ * in pull mode has finished pulling it, to tell the old owner that it can
+ * discard its PULL_SOURCE copy. Other migrations don't use it, since the
+ * source master knows that it no longer owns the tablet when the
+ * coordinator has responded to its REASSIGN_TABLET_OWNERSHIP rpc.
  *
  * \copydetails Service::ping
  */
@@ -319,12 +424,18 @@ MasterService::dropTabletOwnership(
         WireFormat::DropTabletOwnership::Response* respHdr,
         Rpc* rpc)
 {
+    // Do this first, so that no pulled objects show up after the orphans
+    // have been removed below.
+    tabletPuller.drop(reqHdr->tableId, reqHdr->firstKeyHash,
+            reqHdr->lastKeyHash);
     bool removed = tabletManager.deleteTablet(reqHdr->tableId,
                    reqHdr->firstKeyHash, reqHdr->lastKeyHash);
     if (removed) {
         TableStats::deleteKeyHashRange(&masterTableMetadata, reqHdr->tableId,
                 reqHdr->firstKeyHash, reqHdr->lastKeyHash);
     }
+    hotKeyReplicas.dropTablet(reqHdr->tableId, reqHdr->firstKeyHash,
+            reqHdr->lastKeyHash);
 
     // Ensure that the ObjectManager never returns objects from this deleted
     // tablet again.
@@ -385,7 +496,7 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
     TabletManager::Tablet tablet;
     bool found = tabletManager.getTablet(reqHdr->tableId,
             reqHdr->tabletFirstHash, &tablet);
-    if (!found) {
+    if (!found || tablet.state == TabletManager::PULL_SOURCE) {
         // JIRA Issue: RAM-662:
         // The code has never handled non-NORMAL table states. Does this matter
         // at all?
@@ -393,6 +504,14 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
         return;
     }
 
+    // Enumeration walks the hash table directly, so it would miss objects
+    // that haven't been pulled from the tablet's old owner yet.
+    if (tabletPuller.isPulling(tablet.tableId, tablet.startKeyHash,
+            tablet.endKeyHash)) {
+        throw RetryException(HERE, 1000000, 2000000,
+                "tablet is still being pulled from its old owner");
+    }
+
     // In some cases, actualTabletStartHash may differ from
     // reqHdr->tabletFirstHash, e.g. when a tablet is merged in between
     // RPCs made to enumerate that tablet. If that happens, we must
@@ -796,6 +915,8 @@ MasterService::initOnceEnlisted()
     objectManager.initOnceEnlisted();
 
     unackedRpcResults.startCleaner();
+    hotKeyReplicas.start();
+    tabletPuller.start();
 
     initCalled = true;
 }
@@ -857,6 +978,110 @@ MasterService::lookupIndexKeys(
     indexletManager.lookupIndexKeys(reqHdr, respHdr, rpc);
 }
 
+/**
+ * Construct a MigrationPipeline.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param receiver
+ *      ServerId of the master that is receiving the migration data. If this
+ *      is invalid, filled segments are simply discarded.
+ * \param tableId
+ *      ID of the table from which objects are being migrated.
+ * \param firstKeyHash
+ *      Lowest key hash that will be migrated.
+ * \param maxInFlight
+ *      Maximum number of RECEIVE_MIGRATION_DATA RPCs that may be outstanding
+ *      while the next transfer segment is being filled. 0 means that each
+ *      segment is sent synchronously.
+ */
+MasterService::MigrationPipeline::MigrationPipeline(Context* context,
+        ServerId receiver, uint64_t tableId, uint64_t firstKeyHash,
+        uint32_t maxInFlight)
+    : context(context)
+    , receiver(receiver)
+    , tableId(tableId)
+    , firstKeyHash(firstKeyHash)
+    , numSlots(maxInFlight + 1)
+    , transfers(new Transfer[maxInFlight + 1])
+    , filling(0)
+{
+}
+
+/**
+ * Destroying a pipeline cancels any RPCs still outstanding; callers that
+ * want all data to reach the receiver must call finish() first.
+ */
+MasterService::MigrationPipeline::~MigrationPipeline()
+{
+}
+
+/**
+ * Return the transfer segment that log entries should currently be appended
+ * to. The Tub is empty until the caller constructs a segment in it.
+ */
+Tub<Segment>&
+MasterService::MigrationPipeline::current()
+{
+    return transfers[filling].segment;
+}
+
+/**
+ * Close the current transfer segment and start sending it to the receiver.
+ * If this leaves no free slot in the ring, wait for the oldest outstanding
+ * RPC to complete. On return current() is an empty Tub ready for reuse.
+ *
+ * \throw ClientException
+ *      The receiver rejected one of the outstanding segments.
+ */
+void
+MasterService::MigrationPipeline::send()
+{
+    Transfer& transfer = transfers[filling];
+    transfer.segment->close();
+    if (expect_true(receiver != ServerId{})) {
+        transfer.rpc.construct(context, receiver, transfer.segment.get(),
+                tableId, firstKeyHash, false, 0, uint8_t(0),
+                static_cast<const void*>(NULL), uint16_t(0));
+    }
+    filling = (filling + 1) % numSlots;
+    reap(filling);
+}
+
+/**
+ * Send the current transfer segment, if there is one, and wait for every
+ * outstanding RPC to complete.
+ *
+ * \throw ClientException
+ *      The receiver rejected one of the outstanding segments.
+ */
+void
+MasterService::MigrationPipeline::finish()
+{
+    if (current())
+        send();
+    for (uint32_t i = 0; i < numSlots; i++)
+        reap(i);
+}
+
+/**
+ * Wait for the RPC (if any) in a given slot to complete, then free its
+ * transfer segment.
+ *
+ * \param slot
+ *      Index in #transfers of the slot to reap.
+ */
+void
+MasterService::MigrationPipeline::reap(uint32_t slot)
+{
+    Transfer& transfer = transfers[slot];
+    if (transfer.rpc) {
+        transfer.rpc->wait();
+        transfer.rpc.destroy();
+    }
+    transfer.segment.destroy();
+}
+
 /**
  * Helper function to avoid code duplication in migrateTablet which copies a log
  * entry to a segment for migration if it is a live log entry.
@@ -869,8 +1094,9 @@ MasterService::lookupIndexKeys(
  *
  * \param it
  *      The iterator that points at the object we are attempting to migrate.
- * \param[out] transferSeg
- *      Segment object that we append objects to, and possibly send when it gets
+ * \param pipeline
+ *      Holds the transfer segment that we append objects to; the segment is
+ *      handed back to the pipeline to be sent to the receiver when it gets
  *      full.
  * \param[out] entryTotals
  *      Array indexed by type of the total number of log entries copied into
@@ -886,10 +1112,6 @@ MasterService::lookupIndexKeys(
  *      Lowest key hash that will be migrated.
  * \param lastKeyHash
  *      Highest key hash that will be migrated.
- * \param receiver
- *      ServerId of the master that is receiving the migration data. Each time
- *      a transfer segment fills, this server will be sent an RPC containing
- *      the data.
  * \return
  *      Returns STATUS_OK on success (either the entry is ignored or
  *      successfully added to the segment) or another status failure (an entry
@@ -898,16 +1120,16 @@ MasterService::lookupIndexKeys(
 Status
 MasterService::migrateSingleLogEntry(
         SegmentIterator& it,
-        Tub<Segment>& transferSeg,
+        MigrationPipeline& pipeline,
         uint64_t entryTotals[],
         uint64_t& totalBytes,
         uint64_t tableId,
         uint64_t firstKeyHash,
-        uint64_t lastKeyHash,
-        ServerId receiver)
+        uint64_t lastKeyHash)
 {
     LogEntryType type = it.getType();
     if (type != LOG_ENTRY_TYPE_OBJ &&
+        type != LOG_ENTRY_TYPE_OBJCOMP &&
         type != LOG_ENTRY_TYPE_OBJTOMB &&
         type != LOG_ENTRY_TYPE_RPCRESULT &&
         type != LOG_ENTRY_TYPE_PREP &&
@@ -926,7 +1148,8 @@ MasterService::migrateSingleLogEntry(
     uint64_t entryTableId = 0;
     KeyHash entryKeyHash = 0;
 
-    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJTOMB) {
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJCOMP ||
+            type == LOG_ENTRY_TYPE_OBJTOMB) {
         Key key(type, buffer);
         entryTableId = key.getTableId();
         entryKeyHash = key.getHash();
@@ -977,7 +1200,7 @@ MasterService::migrateSingleLogEntry(
     }
 
 
-    if (type == LOG_ENTRY_TYPE_OBJ) {
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJCOMP) {
         // Note: there used to be code here to ignore objects that aren't
         // pointed to by the hash table, under the assumption that they are
         // dead. However, this doesn't work in the presence of concurrent
@@ -1002,23 +1225,20 @@ MasterService::migrateSingleLogEntry(
     entryTotals[type]++;
     totalBytes += buffer.size();
 
-    if (!transferSeg)
-        transferSeg.construct();
+    Tub<Segment>* transferSeg = &pipeline.current();
+    if (!*transferSeg)
+        transferSeg->construct();
 
     // If we can't fit it, send the current buffer and retry.
-    if (!transferSeg->append(type, buffer)) {
-        transferSeg->close();
+    if (!(*transferSeg)->append(type, buffer)) {
         LOG(DEBUG, "Sending migration segment");
-        if (expect_true(receiver != ServerId{})) {
-            MasterClient::receiveMigrationData(context, receiver,
-                    transferSeg.get(), tableId, firstKeyHash);
-        }
+        pipeline.send();
 
-        transferSeg.destroy();
-        transferSeg.construct();
+        transferSeg = &pipeline.current();
+        transferSeg->construct();
 
         // If it doesn't fit this time, we're in trouble.
-        if (!transferSeg->append(type, buffer)) {
+        if (!(*transferSeg)->append(type, buffer)) {
             LOG(ERROR, "Tablet migration failed: could not fit object "
                     "into empty segment (obj bytes %u)",
                     buffer.size());
@@ -1035,7 +1255,10 @@ MasterService::migrateSingleLogEntry(
  * Top-level server method to handle the MIGRATE_TABLET request.
  *
  * This is used to manually initiate the migration of a tablet (or piece of a
- * tablet) that this master owns to another master.
+ * tablet) that this master owns to another master. Normally the tablet's
+ * objects are copied to the new owner before ownership changes hands; if
+ * the request asks for pull mode, ownership changes hands first (see
+ * handOffTablet).
  *
  * \copydetails Service::ping
  */
@@ -1056,8 +1279,10 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
     // Find the tablet we're trying to move. We only support migration
     // when the tablet to be migrated consists of a range within a single,
     // contiguous tablet of ours.
-    bool found = tabletManager.getTablet(tableId, firstKeyHash, lastKeyHash, 0);
-    if (!found) {
+    TabletManager::Tablet tablet;
+    bool found = tabletManager.getTablet(tableId, firstKeyHash, lastKeyHash,
+            &tablet);
+    if (!found || tablet.state == TabletManager::PULL_SOURCE) {
         LOG(WARNING, "Migration request for tablet this master does not own: "
             "tablet [0x%lx,0x%lx] in tableId %lu", firstKeyHash, lastKeyHash,
             tableId);
@@ -1071,6 +1296,20 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
         return;
     }
 
+    // Not all of the tablet's objects are here yet.
+    if (tabletPuller.isPulling(tableId, firstKeyHash, lastKeyHash)) {
+        LOG(NOTICE, "Can't migrate tablet [0x%lx,0x%lx] in tableId %lu "
+                "while it is still being pulled", firstKeyHash, lastKeyHash,
+                tableId);
+        respHdr->common.status = STATUS_RETRY;
+        return;
+    }
+
+    if (reqHdr->pull) {
+        handOffTablet(tableId, firstKeyHash, lastKeyHash, receiver);
+        return;
+    }
+
     // The last two arguments to prepForMigration() are to hint at how much data
     // would be migrated to the new master, giving it the ability to reject if
     // it didn't have sufficient resources. But at the time of writing this code
@@ -1087,8 +1326,10 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
         context->serverList->toString(receiver).c_str());
 
     // We'll send over objects in Segment containers for better network
-    // efficiency and convenience.
-    Tub<Segment> transferSeg;
+    // efficiency and convenience. Several of them may be in flight at once
+    // so that the receiver's replay overlaps with our scan of the log.
+    MigrationPipeline pipeline(context, receiver, tableId, firstKeyHash,
+            config->master.migrationMaxInFlight);
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
@@ -1100,9 +1341,8 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
         while (true) {
             Status error = migrateSingleLogEntry(
                     *it.getCurrentSegmentIterator(),
-                    transferSeg, entryTotals, totalBytes,
-                    tableId, firstKeyHash, lastKeyHash,
-                    receiver);
+                    pipeline, entryTotals, totalBytes,
+                    tableId, firstKeyHash, lastKeyHash);
             if (error) return;
             if (it.onHead())
                 break;
@@ -1126,19 +1366,19 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
             break;
         Status error = migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                pipeline, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) return;
     }
 
-    if (transferSeg) {
-        transferSeg->close();
+    if (pipeline.current())
         LOG(DEBUG, "Sending last migration segment");
-        MasterClient::receiveMigrationData(context, receiver,
-                transferSeg.get(), tableId, firstKeyHash);
-        transferSeg.destroy();
-    }
+    pipeline.finish();
+
+    // The new owner won't know about any copies of the tablet's hot objects
+    // that we pushed to other masters, so drop them while writes are still
+    // blocked.
+    hotKeyReplicas.dropTablet(tableId, firstKeyHash, lastKeyHash);
 
     // Now that all data has been transferred, we can reassign ownership of
     // the tablet. If this succeeds, we are free to drop the tablet. The
@@ -1151,7 +1391,9 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
     LOG(NOTICE, "Migration succeeded for tablet [0x%lx,0x%lx] in "
             "tableId %lu; sent %lu objects and %lu tombstones to %s, "
             "%lu bytes in total",
-            firstKeyHash, lastKeyHash, tableId, entryTotals[LOG_ENTRY_TYPE_OBJ],
+            firstKeyHash, lastKeyHash, tableId,
+            entryTotals[LOG_ENTRY_TYPE_OBJ] +
+                    entryTotals[LOG_ENTRY_TYPE_OBJCOMP],
             entryTotals[LOG_ENTRY_TYPE_OBJTOMB],
             context->serverList->toString(receiver).c_str(),
             totalBytes);
@@ -1169,6 +1411,113 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
     objectManager.removeOrphanedObjects();
 }
 
+/**
+ * Helper for migrateTablet that migrates a tablet in pull mode: ownership
+ * is transferred to the new owner right away, and the new owner pulls the
+ * tablet's objects from here afterwards (see TabletPuller), fetching the
+ * ones it needs to serve requests first. Meanwhile this master keeps its
+ * copy of the tablet in the PULL_SOURCE state, in which it serves only
+ * PULL_TABLET_DATA requests, until the coordinator tells it to drop the copy.
+ *
+ * The only entries copied to the new owner before the handoff are the ones
+ * it can't find through the hash table: the results of linearizable RPCs
+ * that haven't been acknowledged and transaction operations that have been
+ * prepared but not decided.
+ *
+ * \param tableId
+ *      Table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ * \param receiver
+ *      The tablet's new owner.
+ */
+void
+MasterService::handOffTablet(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash, ServerId receiver)
+{
+    MasterClient::prepForMigration(context, receiver, tableId,
+            firstKeyHash, lastKeyHash);
+    LogPosition newOwnerLogHead = MasterClient::getHeadOfLog(
+            context, receiver);
+
+    LOG(NOTICE, "Handing tablet [0x%lx,0x%lx] in tableId %lu over to %s",
+        firstKeyHash, lastKeyHash, tableId,
+        context->serverList->toString(receiver).c_str());
+
+    // Block new writes and let current writes finish; from here on, the
+    // tablet doesn't change here.
+    tabletManager.changeState(tableId, firstKeyHash, lastKeyHash,
+            TabletManager::NORMAL, TabletManager::LOCKED_FOR_MIGRATION);
+    uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
+    uint64_t totalBytes = 0;
+    try {
+        LogProtector::wait(context, Transport::ServerRpc::APPEND_ACTIVITY);
+
+        vector<uint64_t> references;
+        unackedRpcResults.collectResults(&references);
+        transactionManager.collectPreparedOps(&references);
+
+        // Copy the entries into segments, so that migrateSingleLogEntry
+        // can pick out the ones belonging to the tablet.
+        MigrationPipeline pipeline(context, receiver, tableId, firstKeyHash,
+                config->master.migrationMaxInFlight);
+        Tub<Segment> entries;
+        size_t i = 0;
+        while (i < references.size()) {
+            entries.construct();
+            size_t batchStart = i;
+            for (; i < references.size(); i++) {
+                Buffer buffer;
+                LogEntryType type = objectManager.getLog()->getEntry(
+                        Log::Reference(references[i]), buffer);
+                if (!entries->append(type, buffer))
+                    break;
+            }
+            if (i == batchStart) {
+                LOG(ERROR, "Tablet handoff failed: could not fit log entry "
+                        "into empty segment");
+                ClientException::throwException(HERE, STATUS_INTERNAL_ERROR);
+            }
+            for (SegmentIterator it(*entries); !it.isDone(); it.next()) {
+                Status error = migrateSingleLogEntry(it, pipeline,
+                        entryTotals, totalBytes, tableId, firstKeyHash,
+                        lastKeyHash);
+                if (error)
+                    ClientException::throwException(HERE, error);
+            }
+        }
+        pipeline.finish();
+
+        // The new owner won't know about any copies of the tablet's hot
+        // objects that we pushed to other masters.
+        hotKeyReplicas.dropTablet(tableId, firstKeyHash, lastKeyHash);
+    } catch (...) {
+        tabletManager.changeState(tableId, firstKeyHash, lastKeyHash,
+                TabletManager::LOCKED_FOR_MIGRATION, TabletManager::NORMAL);
+        throw;
+    }
+
+    // From here on, failures leave the tablet with us in the PULL_SOURCE
+    // state: once the coordinator has been asked to reassign it, we can't
+    // tell whether it has.
+    tabletManager.changeState(tableId, firstKeyHash, lastKeyHash,
+            TabletManager::LOCKED_FOR_MIGRATION, TabletManager::PULL_SOURCE);
+    CoordinatorClient::reassignTabletOwnership(context,
+            tableId, firstKeyHash, lastKeyHash, receiver,
+            newOwnerLogHead.getSegmentId(), newOwnerLogHead.getSegmentOffset(),
+            serverId);
+
+    LOG(NOTICE, "Handed tablet [0x%lx,0x%lx] in tableId %lu over to %s; "
+            "sent %lu RPC results and %lu prepared operations, %lu bytes "
+            "in total",
+            firstKeyHash, lastKeyHash, tableId,
+            context->serverList->toString(receiver).c_str(),
+            entryTotals[LOG_ENTRY_TYPE_RPCRESULT],
+            entryTotals[LOG_ENTRY_TYPE_PREP], totalBytes);
+}
+
 /**
  * Multiplexor for the MultiOp opcode.
  */
@@ -1356,6 +1705,7 @@ MasterService::multiRead(const WireFormat::MultiOp::Request* reqHdr,
             continue;
 
         currentResp->length = rpc->replyPayload->size() - initialLength;
+        hotKeyTracker.recordAccess(key, currentResp->length);
     }
 }
 
@@ -1514,6 +1864,8 @@ MasterService::multiWrite(const WireFormat::MultiOp::Request* reqHdr,
         catch (RetryException& e) {
             currentResp->status = STATUS_RETRY;
         }
+        if (currentResp->status == STATUS_OK)
+            hotKeyTracker.recordAccess(object);
         reqOffset += currentReq->length;
     }
 
@@ -1642,6 +1994,115 @@ MasterService::prepForMigration(
     }
 }
 
+/**
+ * Top-level server method to handle the PULL_TABLET_DATA request.
+ *
+ * This is the source side of a pull-mode tablet migration (see
+ * TabletPuller): the new owner of a tablet that this master holds in the
+ * PULL_SOURCE state asks for the tablet's live objects, one slice of the hash
+ * table at a time, and may have several slices in flight at once. A priority
+ * pull fetches only the objects with a particular key hash, so that the new
+ * owner can serve a request for a key it has not pulled yet without waiting
+ * for the bulk transfer to reach it.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::pullTabletData(
+        const WireFormat::PullTabletData::Request* reqHdr,
+        WireFormat::PullTabletData::Response* respHdr,
+        Rpc* rpc)
+{
+    TabletManager::Tablet tablet;
+    if (!tabletManager.getTablet(reqHdr->tableId, reqHdr->firstKeyHash,
+            &tablet) || tablet.state != TabletManager::PULL_SOURCE ||
+            reqHdr->lastKeyHash > tablet.endKeyHash) {
+        respHdr->common.status = STATUS_UNKNOWN_TABLET;
+        return;
+    }
+    if (!reqHdr->priority && (reqHdr->numPartitions == 0 ||
+            reqHdr->partition >= reqHdr->numPartitions)) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+
+    uint64_t numBuckets = objectManager.getObjectMap()->getNumBuckets();
+    uint64_t firstKeyHash = reqHdr->firstKeyHash;
+    uint64_t lastKeyHash = reqHdr->lastKeyHash;
+    uint64_t partitionStart, partitionEnd;
+    if (reqHdr->priority) {
+        uint64_t secondaryHash;
+        partitionStart = HashTable::findBucketIndex(numBuckets,
+                reqHdr->keyHash, &secondaryHash);
+        partitionEnd = partitionStart + 1;
+        firstKeyHash = lastKeyHash = reqHdr->keyHash;
+    } else {
+        partitionStart = numBuckets * reqHdr->partition /
+                reqHdr->numPartitions;
+        partitionEnd = numBuckets * (reqHdr->partition + 1) /
+                reqHdr->numPartitions;
+    }
+    uint64_t firstBucket = std::min(partitionStart + reqHdr->cursor,
+            partitionEnd);
+
+    // Everything handed to the new owner must be durable here first;
+    // otherwise a crash of this master could resurrect a state that the new
+    // owner has already served reads from.
+    objectManager.syncChanges();
+
+    Segment segment;
+    uint64_t nextBucket = objectManager.pullTabletData(reqHdr->tableId,
+            firstKeyHash, lastKeyHash, firstBucket, partitionEnd, &segment);
+    if (nextBucket == firstBucket && firstBucket < partitionEnd) {
+        // A single bucket's objects didn't fit in an empty segment; the
+        // new owner could never make progress.
+        LOG(ERROR, "Hash table bucket %lu has too much data for tableId %lu "
+                "to fit in a single migration segment", firstBucket,
+                reqHdr->tableId);
+        respHdr->common.status = STATUS_INTERNAL_ERROR;
+        return;
+    }
+    segment.close();
+
+    respHdr->cursor = nextBucket - partitionStart;
+    respHdr->done = (nextBucket >= partitionEnd);
+    respHdr->segmentBytes = segment.getAppendedLength(&respHdr->certificate);
+
+    // The segment is freed when this method returns, which is before the
+    // response is transmitted, so its contents must be copied.
+    segment.copyOut(0, rpc->replyPayload->alloc(respHdr->segmentBytes),
+            respHdr->segmentBytes);
+}
+
+/**
+ * Top-level server method to handle the PUSH_HOT_OBJECT request, which
+ * stores a read-only copy of another master's hot object on this master
+ * (see HotKeyReplicas).
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::pushHotObject(
+        const WireFormat::PushHotObject::Request* reqHdr,
+        WireFormat::PushHotObject::Response* respHdr,
+        Rpc* rpc)
+{
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    const void* stringKey = rpc->requestPayload->getRange(reqOffset,
+            reqHdr->keyLength);
+    reqOffset += reqHdr->keyLength;
+    if (stringKey == NULL ||
+            rpc->requestPayload->size() - reqOffset != reqHdr->length) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+
+    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
+    respHdr->common.status = hotKeyReplicas.storeCopy(key, reqHdr->pushId,
+            reqHdr->version, reqHdr->leaseMs, rpc->requestPayload, reqOffset,
+            reqHdr->length);
+}
+
 /**
  * Top-level server method to handle the READ request.
  *
@@ -1685,10 +2146,25 @@ MasterService::read(const WireFormat::Read::Request* reqHdr,
     respHdr->common.status = objectManager.readObject(
             key, rpc->replyPayload, &rejectRules, &respHdr->version, valueOnly);
 
+    if (respHdr->common.status == STATUS_UNKNOWN_TABLET &&
+            !rejectRules.doesntExist && !rejectRules.exists &&
+            !rejectRules.versionLeGiven && !rejectRules.versionNeGiven) {
+        // We don't own the object, but its owner may have pushed a copy
+        // here because it is hot.
+        respHdr->common.status = hotKeyReplicas.readCopy(key,
+                rpc->replyPayload, &respHdr->version);
+        if (respHdr->common.status == STATUS_OK)
+            respHdr->length = rpc->replyPayload->size() - initialLength;
+        return;
+    }
+
     if (respHdr->common.status != STATUS_OK)
         return;
 
     respHdr->length = rpc->replyPayload->size() - initialLength;
+    hotKeyTracker.recordRead(key, respHdr->length);
+    hotKeyReplicas.appendReplicas(key, rpc->replyPayload,
+            &respHdr->numHotReplicas, &respHdr->hotReplicasLength);
 }
 
 /**
@@ -2082,13 +2558,23 @@ MasterService::migrateSingleIndexObject(
         WireFormat::SplitAndMigrateIndexlet::Response* respHdr)
 {
     LogEntryType type = it.getType();
-    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJTOMB) {
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJCOMP &&
+            type != LOG_ENTRY_TYPE_OBJTOMB) {
         // We aren't interested in any other types.
         return 0;
     }
 
+    // Index nodes are rewritten below, so compressed ones are simply
+    // decompressed and handled like any other object.
     Buffer logEntryBuffer;
-    it.appendToBuffer(logEntryBuffer);
+    if (type == LOG_ENTRY_TYPE_OBJCOMP) {
+        Buffer compressedBuffer;
+        it.appendToBuffer(compressedBuffer);
+        CompressedObject::decompress(compressedBuffer, &logEntryBuffer);
+        type = LOG_ENTRY_TYPE_OBJ;
+    } else {
+        it.appendToBuffer(logEntryBuffer);
+    }
     Key indexNodeKey(type, logEntryBuffer);
 
     // Skip if not applicable.
@@ -2352,7 +2838,10 @@ MasterService::splitMasterTablet(
  * tablet. This can occur due to both tablet creation and to complete
  * migration. As far as the coordinator is concerned, the master
  * receiving this rpc owns the tablet specified and all requests for it
- * will be directed here from now on.
+ * will be directed here from now on. If the request names a pull source,
+ * the tablet's objects are still there, and must be pulled (see
+ * TabletPuller); the request is repeated with a different pull source if
+ * that one crashes.
  *
  * \copydetails Service::ping
  */
@@ -2382,6 +2871,27 @@ MasterService::takeTabletOwnership(
         logEverSynced = true;
     }
 
+    ServerId pullSource(reqHdr->pullSourceId);
+    if (pullSource.isValid()) {
+        TabletManager::Tablet tablet;
+        if (tabletManager.getTablet(reqHdr->tableId, reqHdr->firstKeyHash,
+                reqHdr->lastKeyHash, &tablet) &&
+                tablet.state == TabletManager::NORMAL &&
+                !tabletPuller.isPulling(reqHdr->tableId,
+                reqHdr->firstKeyHash, reqHdr->lastKeyHash)) {
+            LOG(NOTICE, "Told to pull tablet [0x%lx,0x%lx] in tableId %lu "
+                    "from %s, but already pulled it. Returning success.",
+                    reqHdr->firstKeyHash, reqHdr->lastKeyHash,
+                    reqHdr->tableId, pullSource.toString().c_str());
+            return;
+        }
+
+        // Requests for the tablet must pull their objects from the moment
+        // it is served here.
+        tabletPuller.beginPull(reqHdr->tableId, reqHdr->firstKeyHash,
+                reqHdr->lastKeyHash, pullSource);
+    }
+
     bool added = tabletManager.addTablet(reqHdr->tableId,
             reqHdr->firstKeyHash, reqHdr->lastKeyHash,
             TabletManager::NORMAL);
@@ -2404,6 +2914,11 @@ MasterService::takeTabletOwnership(
             }
         }
 
+        // The old owner of a pulled tablet has sent over its prepared
+        // transaction operations, which must lock their objects here.
+        if (pullSource.isValid())
+            transactionManager.regrabLocksAfterRecovery(&objectManager);
+
         // It's possible we already have the tablet in the RECOVERING state.
         // Try to update it to the NORMAL state to take ownership.
         bool changed = tabletManager.changeState(
@@ -2417,6 +2932,8 @@ MasterService::takeTabletOwnership(
             LOG(WARNING, "Could not take ownership of tablet [0x%lx,0x%lx] in "
                     "tableId %lu: overlaps with one or more different ranges.",
                     reqHdr->firstKeyHash, reqHdr->lastKeyHash, reqHdr->tableId);
+            tabletPuller.drop(reqHdr->tableId, reqHdr->firstKeyHash,
+                    reqHdr->lastKeyHash);
 
             // This error is uncaught in the caller function at the coordinator.
             // It will cause the coordinator to crash as something is wrong.
@@ -3105,6 +3622,14 @@ MasterService::write(const WireFormat::Write::Request* reqHdr,
     // This is also used to get key information to update indexes as needed.
     Object object(reqHdr->tableId, 0, 0, *(rpc->requestPayload),
             sizeof32(*reqHdr));
+    if (reqHdr->ttl != 0) {
+        // Saturate rather than wrap: a wrapped expiry time would make the
+        // object expire immediately (or never, if it wrapped to 0).
+        uint64_t expiryTime = static_cast<uint64_t>(
+                WallTime::secondsTimestamp()) + reqHdr->ttl;
+        object.setExpiryTime(downCast<uint32_t>(
+                std::min(expiryTime, static_cast<uint64_t>(~0U))));
+    }
 
     // Insert new index entries, if any, before writing object.
     requestInsertIndexEntries(object);
@@ -3133,6 +3658,7 @@ MasterService::write(const WireFormat::Write::Request* reqHdr,
 
     if (respHdr->common.status == STATUS_OK) {
         objectManager.syncChanges();
+        hotKeyTracker.recordAccess(object);
         rh.recordCompletion(rpcResultPtr); // Complete only if RpcResult is
                                            // written.
                                            // Otherwise, RPC state should reset
@@ -3800,6 +4326,18 @@ MasterService::recover(const WireFormat::Recover::Request* reqHdr,
         }
         recover(recoveryId, crashedServerId, partitionId, replicas,
                 nextNodeIdMap);
+
+        // If the crashed master was still pulling a tablet, what it hadn't
+        // pulled yet is still at the pull source.
+        foreach (const ProtoBuf::Tablets::Tablet& tablet,
+                recoveryPartition.tablet()) {
+            if (tablet.has_pull_source_id() &&
+                    tablet.state() != ProtoBuf::Tablets::Tablet::PULL_SOURCE) {
+                tabletPuller.pullAll(tablet.table_id(),
+                        tablet.start_key_hash(), tablet.end_key_hash(),
+                        ServerId(tablet.pull_source_id()));
+            }
+        }
         // Install indexlets we are recovering
         foreach (const ProtoBuf::Indexlet& newIndexlet,
                  recoveryPartition.indexlet()) {
@@ -3869,13 +4407,17 @@ MasterService::recover(const WireFormat::Recover::Request* reqHdr,
         transactionManager.regrabLocksAfterRecovery(&objectManager);
 
         // Ok - we're expected to be serving now. Mark recovered tablets
-        // as normal so we can handle clients.
+        // as normal so we can handle clients. Copies kept for a master
+        // pulling the tablet are served to that master only.
         foreach (const ProtoBuf::Tablets::Tablet& tablet,
                 recoveryPartition.tablet()) {
+            TabletManager::TabletState state = TabletManager::NORMAL;
+            if (tablet.state() == ProtoBuf::Tablets::Tablet::PULL_SOURCE)
+                state = TabletManager::PULL_SOURCE;
             bool changed = tabletManager.changeState(
                     tablet.table_id(),
                     tablet.start_key_hash(), tablet.end_key_hash(),
-                    TabletManager::RECOVERING, TabletManager::NORMAL);
+                    TabletManager::RECOVERING, state);
             if (!changed) {
                 throw FatalError(HERE, format("Could not change recovering "
                         "tablet's state to NORMAL (%lu range [%lu,%lu])",
@@ -24,7 +24,11 @@
 #include "LogCleaner.h"
 #include "LogIterator.h"
 #include "HashTable.h"
+#include "HotKeyReplicas.h"
+#include "HotKeyTracker.h"
+#include "MasterClient.h"
 #include "MasterTableMetadata.h"
+#include "MetricsRegistry.h"
 #include "Object.h"
 #include "ObjectFinder.h"
 #include "ObjectManager.h"
@@ -39,6 +43,7 @@
 #include "SideLog.h"
 #include "SpinLock.h"
 #include "TabletManager.h"
+#include "TabletPuller.h"
 #include "TransactionManager.h"
 #include "TxRecoveryManager.h"
 #include "IndexletManager.h"
@@ -57,11 +62,13 @@ class RecoveryTask;
  * respond to client RPC requests to manipulate objects stored on the
  * server.
  */
-class MasterService : public Service {
+class MasterService : public Service
+                    , public MetricsRegistry::Collector {
   public:
     MasterService(Context* context, const ServerConfig* config);
     virtual ~MasterService();
 
+    void collect(MetricsRegistry::Snapshot* snapshot);
     void dispatch(WireFormat::Opcode opcode, Rpc* rpc);
 
     /*
@@ -84,6 +91,73 @@ class MasterService : public Service {
         DISALLOW_COPY_AND_ASSIGN(Disabler);
     };
 
+    /**
+     * Used by migrateTablet to keep several RECEIVE_MIGRATION_DATA RPCs
+     * outstanding at once, rather than waiting for each transfer segment to
+     * be replayed by the receiver before filling the next one. The pipeline
+     * owns a small ring of transfer segments: one is being filled from the
+     * log while the others are in flight. Since the receiver services each
+     * incoming RPC in its own worker thread with its own SideLog, this also
+     * lets it replay several transfer segments concurrently.
+     */
+    class MigrationPipeline {
+      public:
+        MigrationPipeline(Context* context, ServerId receiver,
+                uint64_t tableId, uint64_t firstKeyHash,
+                uint32_t maxInFlight);
+        ~MigrationPipeline();
+        Tub<Segment>& current();
+        void finish();
+        void send();
+
+      PRIVATE:
+        void reap(uint32_t slot);
+
+        /**
+         * One slot in the ring: a transfer segment and the RPC, if any,
+         * that is currently sending it to the receiver.
+         */
+        struct Transfer {
+            Transfer()
+                : segment()
+                , rpc()
+            {}
+
+            /// Segment holding migrated log entries. Must outlive #rpc,
+            /// which refers to the segment's memory rather than copying it.
+            Tub<Segment> segment;
+
+            /// Outstanding RECEIVE_MIGRATION_DATA for #segment, if any.
+            Tub<ReceiveMigrationDataRpc> rpc;
+        };
+
+        /// Shared RAMCloud information.
+        Context* context;
+
+        /// Master receiving the migrated data. If invalid, segments are
+        /// discarded instead of being sent (used by MigrateTabletBenchmark).
+        ServerId receiver;
+
+        /// Table being migrated.
+        uint64_t tableId;
+
+        /// First key hash of the range being migrated; used by the receiver
+        /// to locate the tablet.
+        uint64_t firstKeyHash;
+
+        /// Number of slots in #transfers: the maximum number of RPCs in
+        /// flight plus one for the segment being filled.
+        uint32_t numSlots;
+
+        /// Ring of transfer segments and their RPCs.
+        std::unique_ptr<Transfer[]> transfers;
+
+        /// Index in #transfers of the segment currently being filled.
+        uint32_t filling;
+
+        DISALLOW_COPY_AND_ASSIGN(MigrationPipeline);
+    };
+
     /// Shared RAMCloud information.
     Context* context;
 
@@ -112,6 +186,24 @@ class MasterService : public Service {
      */
     IndexletManager indexletManager;
 
+    /**
+     * Pushes copies of this master's hottest objects to other masters, and
+     * holds the copies other masters push here.
+     */
+    HotKeyReplicas hotKeyReplicas;
+
+    /**
+     * Samples reads and writes to find the hottest keys and tablets on this
+     * master (see the GET_HOT_KEYS server control).
+     */
+    HotKeyTracker hotKeyTracker;
+
+    /**
+     * Pulls the objects of tablets that were migrated to this master in
+     * pull mode from their old owners.
+     */
+    TabletPuller tabletPuller;
+
     /**
      * Keeps track of the logically most recent cluster-time that this master
      * service either directly or indirectly received from the coordinator.
@@ -148,6 +240,9 @@ class MasterService : public Service {
 #endif
 
   PRIVATE:
+    void dropHotObject(const WireFormat::DropHotObject::Request* reqHdr,
+                WireFormat::DropHotObject::Response* respHdr,
+                Rpc* rpc);
     void dropTabletOwnership(
                 const WireFormat::DropTabletOwnership::Request* reqHdr,
                 WireFormat::DropTabletOwnership::Response* respHdr,
@@ -169,6 +264,8 @@ class MasterService : public Service {
                 const WireFormat::GetServerStatistics::Request* reqHdr,
                 WireFormat::GetServerStatistics::Response* respHdr,
                 Rpc* rpc);
+    void handOffTablet(uint64_t tableId, uint64_t firstKeyHash,
+                uint64_t lastKeyHash, ServerId receiver);
     void fillWithTestData(const WireFormat::FillWithTestData::Request* reqHdr,
                 WireFormat::FillWithTestData::Response* respHdr,
                 Rpc* rpc);
@@ -210,13 +307,12 @@ class MasterService : public Service {
                 WireFormat::SplitAndMigrateIndexlet::Response* respHdr);
   public: // For MigrateTabletBenchmark.
     Status migrateSingleLogEntry(SegmentIterator& it,
-                Tub<Segment>& transferSeg,
+                MigrationPipeline& pipeline,
                 uint64_t entryTotals[],
                 uint64_t& totalBytes,
                 uint64_t tableId,
                 uint64_t firstKeyHash,
-                uint64_t lastKeyHash,
-                ServerId receiver);
+                uint64_t lastKeyHash);
   PRIVATE:
     void migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
                 WireFormat::MigrateTablet::Response* respHdr,
@@ -243,6 +339,12 @@ class MasterService : public Service {
     void prepForMigration(const WireFormat::PrepForMigration::Request* reqHdr,
                 WireFormat::PrepForMigration::Response* respHdr,
                 Rpc* rpc);
+    void pullTabletData(const WireFormat::PullTabletData::Request* reqHdr,
+                WireFormat::PullTabletData::Response* respHdr,
+                Rpc* rpc);
+    void pushHotObject(const WireFormat::PushHotObject::Request* reqHdr,
+                WireFormat::PushHotObject::Response* respHdr,
+                Rpc* rpc);
     void read(const WireFormat::Read::Request* reqHdr,
                 WireFormat::Read::Response* respHdr,
                 Rpc* rpc);
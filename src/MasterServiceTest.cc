@@ -36,6 +36,7 @@
 #include "ShortMacros.h"
 #include "StringUtil.h"
 #include "Tablets.pb.h"
+#include "WallTime.h"
 
 namespace RAMCloud {
 
@@ -139,6 +140,9 @@ class MasterServiceTest : public ::testing::Test {
                 new MasterServiceRefresher);
 
         service->tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+
+        // Tests pull tablets explicitly.
+        service->tabletPuller.halt();
     }
 
     // Adds integer value 1 to the given table and key.  This function is used
@@ -624,12 +628,18 @@ TEST_F(MasterServiceTest, getServerStatistics) {
     ramcloud->read(1, "key0", 4, &value);
     ramcloud->read(1, "key0", 4, &value);
 
+    uint64_t slice = Key(1, "key0", 4).getHash() /
+            (~0UL / TabletManager::Tablet::NUM_LOAD_SLICES + 1);
+    string load;
+    for (uint64_t i = 0; i < TabletManager::Tablet::NUM_LOAD_SLICES; i++)
+        load += format(" key_hash_load: %d", i == slice ? 4 : 0);
+
     ProtoBuf::ServerStatistics serverStats;
     ramcloud->getServerStatistics("mock:host=master", serverStats);
     EXPECT_TRUE(StringUtil::startsWith(serverStats.ShortDebugString(),
             "tabletentry { table_id: 1 start_key_hash: 0 "
-            "end_key_hash: 18446744073709551615 number_read_and_writes: 4 } "
-            "spin_lock_stats { locks { name:"));
+            "end_key_hash: 18446744073709551615 number_read_and_writes: 4" +
+            load + " } spin_lock_stats { locks { name:"));
 
     MasterClient::splitMasterTablet(&context, masterServer->serverId, 1,
             (~0UL/2));
@@ -859,23 +869,22 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_basic) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
-
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0xffffffffffffffff;
     ServerId receiver(1);
+    MasterService::MigrationPipeline pipeline(&context, receiver, tableId,
+            firstKeyHash, 0);
 
     Status error;
     for (; !it.isDone(); it.next()) {
         TestLog::reset();
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                pipeline, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -894,23 +903,22 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongTable) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
-
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 2;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0xffffffffffffffff;
     ServerId receiver(1);
+    MasterService::MigrationPipeline pipeline(&context, receiver, tableId,
+            firstKeyHash, 0);
 
     Status error;
     for (; !it.isDone(); it.next()) {
         TestLog::reset();
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                pipeline, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -930,23 +938,22 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongKeyHash) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
-
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
     ServerId receiver(1);
+    MasterService::MigrationPipeline pipeline(&context, receiver, tableId,
+            firstKeyHash, 0);
 
     Status error;
     for (; !it.isDone(); it.next()) {
         TestLog::reset();
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                pipeline, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -985,14 +992,14 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_rpcResult) {
         ASSERT_TRUE(segment.append(LOG_ENTRY_TYPE_RPCRESULT, buffer));
     }
 
-    Tub<Segment> transferSeg;
-
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
     ServerId receiver(1);
+    MasterService::MigrationPipeline pipeline(&context, receiver, tableId,
+            firstKeyHash, 0);
 
     TestLog::reset();
     Status error;
@@ -1000,9 +1007,8 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_rpcResult) {
     for (SegmentIterator it(segment); !it.isDone(); it.next()) {
         error = service->migrateSingleLogEntry(
                 it,
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                pipeline, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -1073,14 +1079,14 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_prepAndprepTomb) {
         ASSERT_TRUE(segment.append(LOG_ENTRY_TYPE_PREPTOMB, buffer));
     }
 
-    Tub<Segment> transferSeg;
-
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = keyToMigrate.getTableId();
     uint64_t firstKeyHash = keyToMigrate.getHash();
     uint64_t lastKeyHash = keyToMigrate.getHash();
     ServerId receiver(1);
+    MasterService::MigrationPipeline pipeline(&context, receiver, tableId,
+            firstKeyHash, 0);
 
     TestLog::reset();
     Status error;
@@ -1088,9 +1094,8 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_prepAndprepTomb) {
     for (SegmentIterator it(segment); !it.isDone(); it.next()) {
         error = service->migrateSingleLogEntry(
                 it,
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                pipeline, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -1133,23 +1138,22 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_decisionRecord) {
     }
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
-
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
     ServerId receiver(1);
+    MasterService::MigrationPipeline pipeline(&context, receiver, tableId,
+            firstKeyHash, 0);
 
     TestLog::reset();
     Status error;
     for (; !it.isDone(); it.next()) {
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                pipeline, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -1218,23 +1222,22 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_participantList) {
     }
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
-
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
     ServerId receiver(1);
+    MasterService::MigrationPipeline pipeline(&context, receiver, tableId,
+            firstKeyHash, 0);
 
     TestLog::reset();
     Status error;
     for (; !it.isDone(); it.next()) {
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                pipeline, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -1348,6 +1351,81 @@ TEST_F(MasterServiceTest, migrateTablet_movingData) {
     EXPECT_LT(ctimeCoord, master2HeadPositionAfter);
 }
 
+TEST_F(MasterServiceTest, migrateTablet_pull) {
+    ramcloud->createTable("migrationTable");
+    uint64_t tbl = ramcloud->getTableId("migrationTable");
+    ramcloud->write(tbl, "hi", 2, "abcdefg", 7);
+
+    ServerConfig master2Config = masterConfig;
+    master2Config.master.numReplicas = 0;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+    master2->master->tabletPuller.halt();
+
+    MasterClient::requestMigration(&context, masterServer->serverId, tbl,
+            0, ~0UL, master2->serverId, true);
+
+    // Ownership moves at once; the data stays behind.
+    TabletManager::Tablet tablet;
+    EXPECT_TRUE(service->tabletManager.getTablet(tbl, 0, ~0UL, &tablet));
+    EXPECT_EQ(TabletManager::PULL_SOURCE, tablet.state);
+    EXPECT_TRUE(master2->master->tabletManager.getTablet(tbl, 0, ~0UL,
+            &tablet));
+    EXPECT_EQ(TabletManager::NORMAL, tablet.state);
+    EXPECT_TRUE(master2->master->tabletPuller.isPulling(tbl, 0, ~0UL));
+    Tablet coordTablet = cluster.coordinator->tableManager.getTablet(tbl, 0);
+    EXPECT_EQ(master2->serverId, coordTablet.serverId);
+    EXPECT_EQ(masterServer->serverId, coordTablet.pullSource);
+
+    // The old owner no longer serves the tablet; the new one pulls the
+    // object when it is asked for.
+    Key key(tbl, "hi", 2);
+    Buffer value;
+    EXPECT_EQ(STATUS_UNKNOWN_TABLET,
+            service->objectManager.readObject(key, &value, NULL, NULL));
+    EXPECT_EQ(STATUS_OK, master2->master->objectManager.readObject(key,
+            &value, NULL, NULL, true));
+    EXPECT_EQ("abcdefg", TestUtil::toString(&value));
+}
+
+TEST_F(MasterServiceTest, migrationPipeline_manyInFlight) {
+    ServerConfig master2Config = masterConfig;
+    master2Config.master.numReplicas = 0;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+    MasterClient::prepForMigration(&context, master2->serverId,
+            5, 0, ~0UL);
+
+    MasterService::MigrationPipeline pipeline(&context, master2->serverId,
+            5, 0, 2);
+    for (int i = 0; i < 5; i++) {
+        string keyString = format("key%d", i);
+        Key key(5, keyString.c_str(), downCast<uint16_t>(keyString.size()));
+        Buffer dataBuffer;
+        Object o(key, "value", 5, 0, 0, dataBuffer);
+        Buffer bufferForLog;
+        o.assembleForLog(bufferForLog);
+
+        pipeline.current().construct();
+        EXPECT_TRUE(pipeline.current()->append(LOG_ENTRY_TYPE_OBJ,
+                bufferForLog));
+        pipeline.send();
+        EXPECT_FALSE(pipeline.current());
+    }
+    pipeline.finish();
+    EXPECT_FALSE(pipeline.current());
+
+    master2->master->tabletManager.changeState(5, 0, ~0UL,
+            TabletManager::RECOVERING, TabletManager::NORMAL);
+    for (int i = 0; i < 5; i++) {
+        string keyString = format("key%d", i);
+        Key key(5, keyString.c_str(), downCast<uint16_t>(keyString.size()));
+        ObjectBuffer value;
+        EXPECT_EQ(STATUS_OK,
+                master2->master->objectManager.readObject(key, &value, 0, 0));
+    }
+}
+
 TEST_F(MasterServiceTest, multiIncrement_basics) {
     uint64_t tableId1 = ramcloud->createTable("table1");
 
@@ -1882,6 +1960,66 @@ TEST_F(MasterServiceTest, readHashes) {
             o1.getValueLength()));
 }
 
+TEST_F(MasterServiceTest, pullTabletData) {
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    ramcloud->write(1, "1", 1, "ghijkl", 6);
+    ramcloud->write(1, "2", 1, "mnopqr", 6);
+
+    // Only tablets handed off to a new owner can be pulled.
+    uint64_t cursor = 0;
+    Buffer response;
+    SegmentCertificate certificate;
+    EXPECT_THROW(MasterClient::pullTabletData(&context,
+            masterServer->serverId, 1, 0, ~0UL, 0, 1, &cursor, &response,
+            &certificate), UnknownTabletException);
+    service->tabletManager.changeState(1, 0, ~0UL, TabletManager::NORMAL,
+            TabletManager::PULL_SOURCE);
+
+    // Pull the whole table in two partitions.
+    uint32_t objects = 0;
+    for (uint32_t partition = 0; partition < 2; partition++) {
+        cursor = 0;
+        bool done = false;
+        while (!done) {
+            response.reset();
+            done = MasterClient::pullTabletData(&context,
+                    masterServer->serverId, 1, 0, ~0UL, partition, 2,
+                    &cursor, &response, &certificate);
+            SegmentIterator it(response.getRange(0, response.size()),
+                    response.size(), certificate);
+            EXPECT_EQ(LOG_ENTRY_TYPE_SAFEVERSION, it.getType());
+            for (it.next(); !it.isDone(); it.next()) {
+                EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, it.getType());
+                objects++;
+            }
+        }
+    }
+    EXPECT_EQ(3U, objects);
+
+    // Priority pull of a single key.
+    Key key(1, "1", 1);
+    response.reset();
+    PullTabletDataRpc rpc(&context, masterServer->serverId, 1,
+            key.getHash(), &response);
+    EXPECT_TRUE(rpc.wait(NULL, &certificate));
+    SegmentIterator it(response.getRange(0, response.size()),
+            response.size(), certificate);
+    it.next();
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, it.getType());
+    Buffer buffer;
+    it.appendToBuffer(buffer);
+    Object object(buffer);
+    EXPECT_EQ("ghijkl", string(reinterpret_cast<const char*>(
+            object.getValue()), object.getValueLength()));
+    it.next();
+    EXPECT_TRUE(it.isDone());
+
+    // Unknown tablet.
+    EXPECT_THROW(MasterClient::pullTabletData(&context,
+            masterServer->serverId, 99, 0, ~0UL, 0, 1, &cursor, &response,
+            &certificate), UnknownTabletException);
+}
+
 TEST_F(MasterServiceTest, read_basics) {
     ramcloud->write(1, "0", 1, "abcdef", 6);
     Buffer value;
@@ -2727,6 +2865,39 @@ TEST_F(MasterServiceTest, takeTabletOwnership_migratingTablet) {
     EXPECT_TRUE(service->masterTableMetadata.find(2) == NULL);
 }
 
+TEST_F(MasterServiceTest, takeTabletOwnership_pullSource) {
+    TestLog::Enable _("takeTabletOwnership", "beginPull", NULL);
+
+    // Fake up a tablet in migration.
+    service->tabletManager.addTablet(2, 0, 5, TabletManager::RECOVERING);
+    MasterClient::takeTabletOwnership(&context, masterServer->serverId,
+            2, 0, 5, ServerId(9, 0));
+    EXPECT_EQ("beginPull: Pulling tablet [0x0,0x5] in tableId 2 from 9.0 | "
+            "takeTabletOwnership: Took ownership of existing tablet "
+            "[0x0,0x5] in tableId 2 in RECOVERING state", TestLog::get());
+    EXPECT_TRUE(service->tabletPuller.isPulling(2, 0, 5));
+
+    // The pull source crashed and was recovered elsewhere.
+    TestLog::reset();
+    MasterClient::takeTabletOwnership(&context, masterServer->serverId,
+            2, 0, 5, ServerId(10, 0));
+    EXPECT_EQ("beginPull: Pulling tablet [0x0,0x5] in tableId 2 from 10.0 "
+            "instead of 9.0 | "
+            "takeTabletOwnership: Told to take ownership of tablet "
+            "[0x0,0x5] in tableId 2, but already own [0x0,0x5]. Returning "
+            "success.", TestLog::get());
+
+    // The notification came after the pull finished.
+    service->tabletPuller.drop(2, 0, 5);
+    TestLog::reset();
+    MasterClient::takeTabletOwnership(&context, masterServer->serverId,
+            2, 0, 5, ServerId(11, 0));
+    EXPECT_EQ("takeTabletOwnership: Told to pull tablet [0x0,0x5] in "
+            "tableId 2 from 11.0, but already pulled it. Returning success.",
+            TestLog::get());
+    EXPECT_FALSE(service->tabletPuller.isPulling(2, 0, 5));
+}
+
 TEST_F(MasterServiceTest, txDecision_requestFormatError) {
     WireFormat::TxDecision::Request reqHdr;
     WireFormat::TxDecision::Response respHdr;
@@ -3926,6 +4097,30 @@ TEST_F(MasterServiceTest, write_basics) {
     EXPECT_EQ(3U, version);
 }
 
+TEST_F(MasterServiceTest, write_ttl) {
+    ObjectBuffer value;
+    WallTime::mockWallTimeValue = 1000;
+    ramcloud->write(1, "key0", 4, "item0", 5, NULL, NULL, false, 10);
+    ramcloud->write(1, "key1", 4, "item1", 5, NULL, NULL, false, ~0U);
+    WallTime::mockWallTimeValue = 1010;
+    EXPECT_THROW(ramcloud->readKeysAndValue(1, "key0", 4, &value),
+                 ObjectDoesntExistException);
+
+    // A huge TTL saturates instead of wrapping around to the past.
+    ramcloud->readKeysAndValue(1, "key1", 4, &value);
+    WallTime::mockWallTimeValue = 0;
+    EXPECT_EQ("item1", string(reinterpret_cast<const char*>(
+            value.getValue()), 5));
+    Key key(1, "key1", 4);
+    Buffer buffer;
+    LogEntryType type;
+    {
+        ObjectManager::HashTableBucketLock lock(service->objectManager, key);
+        EXPECT_TRUE(service->objectManager.lookup(lock, key, type, buffer));
+    }
+    EXPECT_EQ(~0U, Object(buffer).getExpiryTime());
+}
+
 TEST_F(MasterServiceTest, write_safeVersionNumberUpdate) {
     ObjectBuffer value;
     uint64_t version;
@@ -21,6 +21,7 @@
  */
 
 #include "Common.h"
+#include "Cycles.h"
 #include "MembershipService.h"
 #include "ProtoBuf.h"
 #include "ServerId.h"
@@ -56,6 +57,10 @@ void
 MembershipService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
 {
     switch (opcode) {
+    case WireFormat::ForwardServerList::opcode:
+        callHandler<WireFormat::ForwardServerList, MembershipService,
+            &MembershipService::forwardServerList>(rpc);
+        break;
     case WireFormat::GetServerConfig::opcode:
         callHandler<WireFormat::GetServerConfig, MembershipService,
             &MembershipService::getServerConfig>(rpc);
@@ -105,16 +110,68 @@ MembershipService::updateServerList(
     uint32_t reqOffset = sizeof32(*reqHdr);
     uint32_t reqLen = rpc->requestPayload->size();
 
+    // The servers to forward to (if any) are at the very end.
+    uint32_t numServers = reqHdr->forwardCount;
+    if (numServers > (reqLen - reqOffset) / sizeof32(uint64_t)) {
+        LOG(WARNING, "UpdateServerList request lists %u servers to forward "
+                "to, but is too short to hold them", numServers);
+        numServers = 0;
+    }
+    uint32_t updatesEnd = reqLen - numServers * sizeof32(uint64_t);
+
+    applyUpdates(rpc->requestPayload, reqOffset, updatesEnd,
+            &respHdr->currentVersion);
+    if (numServers > 0) {
+        forwardUpdates(rpc, reqOffset, updatesEnd - reqOffset, updatesEnd,
+                numServers);
+    }
+}
+
+/**
+ * Top-level service method to handle the FORWARD_SERVER_LIST request,
+ * which carries updates that the coordinator sent to another server in an
+ * UPDATE_SERVER_LIST request.
+ *
+ * \copydetails Service::ping
+ */
+void
+MembershipService::forwardServerList(
+    const WireFormat::ForwardServerList::Request* reqHdr,
+    WireFormat::ForwardServerList::Response* respHdr,
+    Rpc* rpc)
+{
+    applyUpdates(rpc->requestPayload, sizeof32(*reqHdr),
+            rpc->requestPayload->size(), &respHdr->currentVersion);
+}
+
+/**
+ * Apply the server list updates in an UPDATE_SERVER_LIST or
+ * FORWARD_SERVER_LIST request to the local ServerList.
+ *
+ * \param request
+ *      The request.
+ * \param offset
+ *      Offset in \a request of the first Part of the updates.
+ * \param end
+ *      Offset in \a request just after the last Part.
+ * \param[out] currentVersion
+ *      Set to the version of the local ServerList after applying each
+ *      update; unchanged if there are no valid updates.
+ */
+void
+MembershipService::applyUpdates(Buffer* request, uint32_t offset,
+        uint32_t end, uint64_t* currentVersion)
+{
     // Repeatedly apply the server lists in the RPC while we haven't reached
-    // the end of the RPC.
-    while (reqOffset < reqLen) {
+    // the end of the updates.
+    while (offset < end) {
         ProtoBuf::ServerList list;
-        auto* part = rpc->requestPayload->getOffset<
-                    WireFormat::UpdateServerList::Request::Part>(reqOffset);
-        reqOffset += sizeof32(*part);
+        auto* part = request->getOffset<
+                    WireFormat::UpdateServerList::Request::Part>(offset);
+        offset += sizeof32(*part);
 
         // Bounds check on rpc size.
-        if (part == NULL || reqOffset + part->serverListLength > reqLen) {
+        if (part == NULL || offset + part->serverListLength > end) {
             LOG(WARNING, "A partial UpdateServerList request is detected. "
                     "Perhaps limit the number of ProtoBufs the Coordinator"
                     "ServerList can batch into one rpc.");
@@ -123,11 +180,125 @@ MembershipService::updateServerList(
 
 
         // Check passed, parse server list and apply.
-        ProtoBuf::parseFromRequest(rpc->requestPayload, reqOffset,
-                                   part->serverListLength, &list);
-        reqOffset += part->serverListLength;
-        respHdr->currentVersion = serverList->applyServerList(list);
+        if (part->format == WireFormat::UpdateServerList::Request::DELTA) {
+            if (!ServerList::parseDelta(request, offset,
+                    part->serverListLength, &list)) {
+                LOG(WARNING, "Malformed server list delta in "
+                        "UpdateServerList request");
+                break;
+            }
+        } else {
+            ProtoBuf::parseFromRequest(request, offset,
+                                       part->serverListLength, &list);
+        }
+        offset += part->serverListLength;
+        *currentVersion = serverList->applyServerList(list);
+    }
+}
+
+/**
+ * Forward the updates in an UPDATE_SERVER_LIST request to the servers it
+ * lists, and append the outcome for each of them to the response (see
+ * WireFormat::UpdateServerList::Response::Forwarded). All of the forwarded
+ * RPCs are issued in parallel; servers that haven't responded within
+ * FORWARD_TIMEOUT_MS are reported as not updated, and the coordinator
+ * will update them directly.
+ *
+ * \param rpc
+ *      The UPDATE_SERVER_LIST request being handled.
+ * \param updatesOffset
+ *      Offset in the request of the first Part of the updates.
+ * \param updatesLength
+ *      Total bytes of updates (all of the Parts).
+ * \param serversOffset
+ *      Offset in the request of the list of servers to forward to.
+ * \param numServers
+ *      Number of servers in that list.
+ */
+void
+MembershipService::forwardUpdates(Rpc* rpc, uint32_t updatesOffset,
+        uint32_t updatesLength, uint32_t serversOffset, uint32_t numServers)
+{
+    typedef WireFormat::UpdateServerList::Response::Forwarded Forwarded;
+    vector<uint64_t> servers(numServers);
+    rpc->requestPayload->copy(serversOffset,
+            numServers * sizeof32(uint64_t), servers.data());
+
+    // Start all of the RPCs, then collect the results in order.
+    std::unique_ptr<Tub<ForwardRpc>[]> rpcs(new Tub<ForwardRpc>[numServers]);
+    for (uint32_t i = 0; i < numServers; i++) {
+        rpcs[i].construct(context, ServerId(servers[i]),
+                rpc->requestPayload, updatesOffset, updatesLength);
+    }
+    uint64_t abortTime = Cycles::rdtsc() +
+            Cycles::fromNanoseconds(FORWARD_TIMEOUT_MS * 1000000UL);
+
+    for (uint32_t i = 0; i < numServers; i++) {
+        Forwarded result = {servers[i], 0};
+        try {
+            result.currentVersion = rpcs[i]->wait(abortTime);
+        } catch (const ClientException& e) {
+            LOG(NOTICE, "Couldn't forward server list update to server %s: %s",
+                    ServerId(servers[i]).toString().c_str(), e.what());
+        }
+        rpc->replyPayload->appendCopy(&result);
+    }
+}
+
+/**
+ * Constructor for ForwardRpc: initiates a FORWARD_SERVER_LIST RPC, but
+ * doesn't wait for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param serverId
+ *      Identifies the server to which the updates should be forwarded.
+ * \param updates
+ *      Buffer containing the updates (a sequence of Parts).
+ * \param updatesOffset
+ *      Offset in \a updates of the first Part.
+ * \param updatesLength
+ *      Total bytes of updates.
+ */
+MembershipService::ForwardRpc::ForwardRpc(Context* context,
+        ServerId serverId, Buffer* updates, uint32_t updatesOffset,
+        uint32_t updatesLength)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::ForwardServerList::Response))
+{
+    allocHeader<WireFormat::ForwardServerList>(serverId);
+    request.append(updates, updatesOffset, updatesLength);
+    send();
+}
+
+/**
+ * Wait for a ForwardRpc to complete, but give up (and cancel the RPC) if
+ * it hasn't completed by a given time.
+ *
+ * \param abortTime
+ *      Give up if Cycles::rdtsc() passes this value.
+ * \return
+ *      The server list version of the target after applying the updates,
+ *      or 0 if the RPC didn't complete in time.
+ *
+ * \throw ServerNotUpException
+ *      The target server is no longer part of the cluster.
+ */
+uint64_t
+MembershipService::ForwardRpc::wait(uint64_t abortTime)
+{
+    if (!waitInternal(context->dispatch, abortTime)) {
+        cancel();
+        LOG(NOTICE, "Server %s didn't respond to forwarded server list "
+                "update within %u ms", id.toString().c_str(),
+                FORWARD_TIMEOUT_MS);
+        return 0;
     }
+    if (serverCrashed)
+        throw ServerNotUpException(HERE);
+    if (responseHeader->status != STATUS_OK)
+        ClientException::throwException(HERE, responseHeader->status);
+    return getResponseHeader<WireFormat::ForwardServerList>()->currentVersion;
 }
 
 } // namespace RAMCloud
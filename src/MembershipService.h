@@ -22,6 +22,7 @@
 #define RAMCLOUD_MEMBERSHIPSERVICE_H
 
 #include "ServerConfig.h"
+#include "ServerIdRpcWrapper.h"
 #include "ServerList.h"
 #include "Service.h"
 
@@ -43,6 +44,15 @@ namespace RAMCloud {
  * the coordinator resend the list if the lost update still has not been
  * received.
  *
+ * In large clusters the coordinator doesn't send every update to every
+ * server itself: it may ask the recipient of an update to forward it to a
+ * list of other servers, using FORWARD_SERVER_LIST. Those servers only
+ * apply the update (they never forward it further, so the RPC call graph
+ * stays acyclic), and the recipient reports the outcome for each of them
+ * back to the coordinator, which updates the rest itself. Forwarded RPCs
+ * are abandoned after FORWARD_TIMEOUT_MS, so a server that has crashed or
+ * is unresponsive can't hold up the update for the others.
+ *
  * Additional functionality includes retrieving the ServerId of the machine
  * running this service (see #ServerId for more information) and advertising
  * the server's configuration.
@@ -55,13 +65,41 @@ class MembershipService : public Service {
     ~MembershipService();
     void dispatch(WireFormat::Opcode opcode, Rpc* rpc);
 
+    /// How long to wait for the servers to which an update is forwarded
+    /// before reporting the ones that haven't responded as not updated.
+    static const uint32_t FORWARD_TIMEOUT_MS = 250;
+
   PRIVATE:
+    void applyUpdates(Buffer* request, uint32_t offset, uint32_t end,
+                      uint64_t* currentVersion);
+    void forwardServerList(
+                       const WireFormat::ForwardServerList::Request* reqHdr,
+                       WireFormat::ForwardServerList::Response* respHdr,
+                       Rpc* rpc);
     void getServerConfig(const WireFormat::GetServerConfig::Request* reqHdr,
                          WireFormat::GetServerConfig::Response* respHdr,
                          Rpc* rpc);
     void updateServerList(const WireFormat::UpdateServerList::Request* reqHdr,
                        WireFormat::UpdateServerList::Response* respHdr,
                        Rpc* rpc);
+    void forwardUpdates(Rpc* rpc, uint32_t updatesOffset,
+                        uint32_t updatesLength, uint32_t serversOffset,
+                        uint32_t numServers);
+
+    /**
+     * Passes the updates in an UPDATE_SERVER_LIST request on to another
+     * server; see forwardUpdates().
+     */
+    class ForwardRpc : public ServerIdRpcWrapper {
+      public:
+        ForwardRpc(Context* context, ServerId serverId, Buffer* updates,
+                   uint32_t updatesOffset, uint32_t updatesLength);
+        ~ForwardRpc() {}
+        uint64_t wait(uint64_t abortTime);
+
+      PRIVATE:
+        DISALLOW_COPY_AND_ASSIGN(ForwardRpc);
+    };
 
     /// Shared state.
     Context* context;
@@ -18,8 +18,10 @@
 #include "CoordinatorServerList.h"
 #include "CoordinatorService.h"
 #include "CoordinatorUpdateManager.h"
+#include "Cycles.h"
 #include "MembershipService.h"
 #include "MockExternalStorage.h"
+#include "MockTransport.h"
 #include "ServerId.h"
 #include "ServerList.h"
 #include "ServerList.pb.h"
@@ -137,4 +139,75 @@ TEST_F(MembershipServiceTest, updateServerList_multi) {
     EXPECT_EQ(3lu, respHdr->currentVersion);
 }
 
+TEST_F(MembershipServiceTest, updateServerList_forward) {
+    Lock lock(mutex); // Lock used to trick internal calls
+    Context context2;
+    context2.externalStorage = &storage;
+    ProtoBuf::ServerList fullList, update2;
+    CoordinatorService coordinatorService(&context2, 1000, true);
+    CoordinatorServerList* source(context2.coordinatorServerList);
+    source->haltUpdater();
+    source->enlistServer({WireFormat::MASTER_SERVICE,
+            WireFormat::PING_SERVICE}, 0, 100, "mock:host=55");
+    source->serialize(&fullList, {WireFormat::MASTER_SERVICE,
+            WireFormat::BACKUP_SERVICE});
+    ServerId id2 = source->enlistServer({WireFormat::MASTER_SERVICE,
+            WireFormat::PING_SERVICE}, 0, 100, "mock:host=56");
+    update2 = source->updates.back().incremental;
+
+    // Two more members, a and b, receive the update from this server; c
+    // isn't in this server's list, so it can't be updated.
+    Context contextA, contextB;
+    TransportManager::MockRegistrar registrarA(&contextA, transport);
+    TransportManager::MockRegistrar registrarB(&contextB, transport);
+    ServerList listA(&contextA), listB(&contextB);
+    MembershipService serviceA(&contextA, &listA, &serverConfig);
+    MembershipService serviceB(&contextB, &listB, &serverConfig);
+    transport.registerServer(&contextA, "mock:host=a");
+    transport.registerServer(&contextB, "mock:host=b");
+    ServerId idA(10, 0), idB(11, 0), idC(12, 0);
+    serverList.testingAdd({idA, "mock:host=a",
+            {WireFormat::MEMBERSHIP_SERVICE}, 100, ServerStatus::UP});
+    serverList.testingAdd({idB, "mock:host=b",
+            {WireFormat::MEMBERSHIP_SERVICE}, 100, ServerStatus::UP});
+
+    CoordinatorServerList::UpdateServerListRpc
+        rpc(&context, serverId, &fullList);
+    rpc.appendServerList(&update2);
+    rpc.setForwardList({idA, idB, idC});
+    rpc.send();
+    rpc.waitAndCheckErrors();
+    EXPECT_STREQ("mock:host=56", serverList.getLocator(id2).c_str());
+    EXPECT_STREQ("mock:host=56", listA.getLocator(id2).c_str());
+    EXPECT_STREQ("mock:host=56", listB.getLocator(id2).c_str());
+
+    typedef WireFormat::UpdateServerList::Response::Forwarded Forwarded;
+    uint32_t offset = sizeof32(WireFormat::UpdateServerList::Response);
+    ASSERT_EQ(offset + 3 * sizeof32(Forwarded), rpc.response->size());
+    const Forwarded* results = static_cast<const Forwarded*>(
+            rpc.response->getRange(offset, 3 * sizeof32(Forwarded)));
+    EXPECT_EQ(idA.getId(), results[0].serverId);
+    EXPECT_EQ(2lu, results[0].currentVersion);
+    EXPECT_EQ(idB.getId(), results[1].serverId);
+    EXPECT_EQ(2lu, results[1].currentVersion);
+    EXPECT_EQ(idC.getId(), results[2].serverId);
+    EXPECT_EQ(0lu, results[2].currentVersion);
+    EXPECT_EQ(string::npos, TestLog::get().find("Unexpected RPC"));
+}
+
+TEST_F(MembershipServiceTest, forwardRpc_timeout) {
+    ServerId idM(20, 0);
+    MockTransport mockTransport(&context);
+    context.transportManager->registerMock(&mockTransport, "mock2");
+    serverList.testingAdd({idM, "mock2:", {WireFormat::MEMBERSHIP_SERVICE},
+            100, ServerStatus::UP});
+    Buffer updates;
+    MembershipService::ForwardRpc rpc(&context, idM, &updates, 0, 0);
+    TestLog::reset();
+    EXPECT_EQ(0lu, rpc.wait(Cycles::rdtsc()));
+    EXPECT_EQ("wait: Server 20.0 didn't respond to forwarded server list "
+            "update within 250 ms", TestLog::get());
+    EXPECT_EQ(RpcWrapper::CANCELED, rpc.getState());
+}
+
 }  // namespace RAMCloud
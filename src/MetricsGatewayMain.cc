@@ -0,0 +1,291 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * This program exports the metrics of an entire RAMCloud cluster in
+ * OpenMetrics text format, so that standard monitoring systems (such as
+ * Prometheus) can scrape the cluster without custom tools. It serves HTTP
+ * on a local port; each request for /metrics returns the metrics of the
+ * coordinator and of every server in the cluster, as collected by their
+ * MetricsRegistry objects (see the GET_METRICS_SNAPSHOT server control).
+ * Each sample carries a "server" label: "coordinator" or the server's id.
+ * The cluster is polled at most once per --interval; requests in between
+ * get the previous results.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "Common.h"
+#include "ClientException.h"
+#include "Context.h"
+#include "Cycles.h"
+#include "FailSession.h"
+#include "MetricsRegistry.h"
+#include "OptionParser.h"
+#include "RamCloud.h"
+#include "ShortMacros.h"
+#include "TransportManager.h"
+
+using namespace RAMCloud;
+
+/**
+ * Invokes the GET_METRICS_SNAPSHOT server control on the coordinator.
+ * ServerControlRpc can't be used for this, because the coordinator has no
+ * ServerId; instead, the request is sent to the coordinator's service
+ * locator (the coordinator's PingService doesn't check the target of
+ * SERVER_ID requests).
+ */
+class CoordinatorMetricsRpc : public RpcWrapper {
+  public:
+    CoordinatorMetricsRpc(Context* context, const string& locator,
+            Buffer* output)
+        : RpcWrapper(sizeof(WireFormat::ServerControl::Response), output)
+        , context(context)
+    {
+        try {
+            session = context->transportManager->getSession(locator);
+        } catch (const TransportException& e) {
+            session = FailSession::get();
+        }
+        WireFormat::ServerControl::Request* reqHdr(
+                allocHeader<WireFormat::ServerControl>());
+        reqHdr->type = WireFormat::ServerControl::SERVER_ID;
+        reqHdr->controlOp = WireFormat::GET_METRICS_SNAPSHOT;
+        send();
+    }
+    ~CoordinatorMetricsRpc() {}
+
+    /**
+     * Wait for the RPC to complete.
+     *
+     * \return
+     *      True means the snapshot is in the output buffer, following a
+     *      WireFormat::ServerControl::Response header; false means the
+     *      RPC failed.
+     */
+    bool
+    wait()
+    {
+        waitInternal(context->dispatch, Cycles::rdtsc() +
+                Cycles::fromSeconds(5.0));
+        if (getState() != RpcState::FINISHED) {
+            return false;
+        }
+        return getResponseHeader<WireFormat::ServerControl>()->common.status
+                == STATUS_OK;
+    }
+
+  PRIVATE:
+    Context* context;
+    DISALLOW_COPY_AND_ASSIGN(CoordinatorMetricsRpc);
+};
+
+/**
+ * Collect metrics from the coordinator and all of the servers in a cluster.
+ *
+ * \param cluster
+ *      Connection to the cluster.
+ * \param coordinatorLocator
+ *      Service locator for the cluster's coordinator.
+ * \return
+ *      OpenMetrics text for the entire cluster.
+ */
+static string
+pollCluster(RamCloud* cluster, const string& coordinatorLocator)
+{
+    uint64_t start = Cycles::rdtsc();
+    std::vector<MetricsRegistry::ServerSnapshot> servers;
+
+    Buffer coordinatorOutput;
+    CoordinatorMetricsRpc rpc(cluster->clientContext, coordinatorLocator,
+            &coordinatorOutput);
+    if (rpc.wait()) {
+        uint32_t outputLength = coordinatorOutput.getStart<
+                WireFormat::ServerControl::Response>()->outputLength;
+        servers.emplace_back("coordinator", MetricsRegistry::Snapshot());
+        MetricsRegistry::parseSnapshot(&coordinatorOutput,
+                sizeof32(WireFormat::ServerControl::Response), outputLength,
+                &servers.back().second);
+    } else {
+        LOG(WARNING, "Couldn't retrieve metrics from coordinator at %s",
+                coordinatorLocator.c_str());
+    }
+
+    // The output of SERVER_CONTROL_ALL consists of a header followed by
+    // the responses of the individual servers.
+    Buffer output;
+    try {
+        cluster->serverControlAll(WireFormat::GET_METRICS_SNAPSHOT, NULL, 0,
+                &output);
+    } catch (const Exception& e) {
+        LOG(WARNING, "Couldn't retrieve metrics from servers: %s",
+                e.what());
+    }
+    uint32_t offset = sizeof32(WireFormat::ServerControlAll::Response);
+    while (offset < output.size()) {
+        const WireFormat::ServerControl::Response* respHdr =
+                output.getOffset<WireFormat::ServerControl::Response>(offset);
+        if (respHdr == NULL) {
+            break;
+        }
+        offset += sizeof32(*respHdr);
+        servers.emplace_back(ServerId(respHdr->serverId).toString(),
+                MetricsRegistry::Snapshot());
+        MetricsRegistry::parseSnapshot(&output, offset,
+                respHdr->outputLength, &servers.back().second);
+        offset += respHdr->outputLength;
+    }
+
+    // Add a few metrics describing the gateway itself.
+    servers.emplace_back("gateway", MetricsRegistry::Snapshot());
+    servers.back().second.emplace_back("ramcloud_gateway_servers",
+            MetricsRegistry::GAUGE, "",
+            static_cast<double>(servers.size() - 1));
+    servers.back().second.emplace_back("ramcloud_gateway_poll_seconds",
+            MetricsRegistry::GAUGE, "",
+            Cycles::toSeconds(Cycles::rdtsc() - start));
+    return MetricsRegistry::toOpenMetrics(servers);
+}
+
+/**
+ * Read an HTTP request from a client and send the appropriate response.
+ *
+ * \param fd
+ *      Socket connected to the client.
+ * \param metrics
+ *      The body to return for requests for /metrics.
+ */
+static void
+handleRequest(int fd, const string& metrics)
+{
+    // Only the request line matters, so there's no need to read the rest
+    // of the request.
+    char request[1000];
+    ssize_t length = recv(fd, request, sizeof(request) - 1, 0);
+    if (length <= 0) {
+        return;
+    }
+    request[length] = 0;
+
+    string response;
+    if ((strncmp(request, "GET /metrics ", 13) == 0) ||
+            (strncmp(request, "GET / ", 6) == 0)) {
+        response = format("HTTP/1.1 200 OK\r\n"
+                "Content-Type: application/openmetrics-text; "
+                "version=1.0.0; charset=utf-8\r\n"
+                "Content-Length: %lu\r\n"
+                "Connection: close\r\n\r\n", metrics.length());
+        response.append(metrics);
+    } else {
+        response = "HTTP/1.1 404 Not Found\r\n"
+                "Content-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+    size_t sent = 0;
+    while (sent < response.length()) {
+        ssize_t count = send(fd, response.c_str() + sent,
+                response.length() - sent, MSG_NOSIGNAL);
+        if (count <= 0) {
+            return;
+        }
+        sent += count;
+    }
+}
+
+int
+main(int argc, char *argv[])
+try
+{
+    Context context(true);
+
+    string address;
+    uint16_t port;
+    double interval;
+
+    OptionsDescription gatewayOptions("MetricsGateway");
+    gatewayOptions.add_options()
+        ("address",
+         ProgramOptions::value<string>(&address)->
+            default_value("127.0.0.1"),
+         "IP address on which to accept HTTP connections")
+        ("port",
+         ProgramOptions::value<uint16_t>(&port)->
+            default_value(9105),
+         "Port on which to accept HTTP connections")
+        ("interval",
+         ProgramOptions::value<double>(&interval)->
+            default_value(5.0),
+         "Minimum time between polls of the cluster, in seconds; requests "
+         "that arrive sooner get the previous results");
+
+    OptionParser optionParser(gatewayOptions, argc, argv);
+    string coordinatorLocator = optionParser.options.getCoordinatorLocator();
+    RamCloud cluster(&context, coordinatorLocator.c_str(),
+            optionParser.options.getClusterName().c_str());
+
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        DIE("couldn't create socket: %s", strerror(errno));
+    }
+    int optval = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &sin.sin_addr) != 1) {
+        DIE("bad IP address '%s'", address.c_str());
+    }
+    if ((bind(listenFd, reinterpret_cast<struct sockaddr*>(&sin),
+            sizeof(sin)) != 0) || (listen(listenFd, 16) != 0)) {
+        DIE("couldn't listen on %s:%u: %s", address.c_str(), port,
+                strerror(errno));
+    }
+    LOG(NOTICE, "Serving metrics for cluster at %s on http://%s:%u/metrics",
+            coordinatorLocator.c_str(), address.c_str(), port);
+
+    string metrics;
+    uint64_t lastPoll = 0;
+    while (true) {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR) {
+                LOG(WARNING, "accept failed: %s", strerror(errno));
+            }
+            continue;
+        }
+
+        // Don't let a client that never sends a request hang the gateway.
+        struct timeval timeout = {2, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if ((lastPoll == 0) || (Cycles::toSeconds(Cycles::rdtsc() - lastPoll)
+                >= interval)) {
+            metrics = pollCluster(&cluster, coordinatorLocator);
+            lastPoll = Cycles::rdtsc();
+        }
+        handleRequest(fd, metrics);
+        close(fd);
+    }
+    return 0;
+} catch (ClientException& e) {
+    fprintf(stderr, "RAMCloud Client exception: %s\n", e.str().c_str());
+    return 1;
+} catch (RAMCloud::Exception& e) {
+    fprintf(stderr, "RAMCloud exception: %s\n", e.str().c_str());
+    return 1;
+}
@@ -0,0 +1,426 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <thread>
+
+#include "Cycles.h"
+#include "MetricsRegistry.h"
+#include "PerfStats.h"
+
+namespace RAMCloud {
+
+/**
+ * Format a floating-point value with as few digits as possible while
+ * still converting back to exactly the same value.
+ */
+static string
+formatValue(double value)
+{
+    string result = format("%.15g", value);
+    if (strtod(result.c_str(), NULL) != value) {
+        result = format("%.17g", value);
+    }
+    return result;
+}
+
+/**
+ * Construct a MetricsRegistry with no collectors.
+ */
+MetricsRegistry::MetricsRegistry()
+    : mutex("MetricsRegistry")
+    , collectors()
+    , collectionsStarted(0)
+    , activeCollections()
+{}
+
+/**
+ * Destructor for MetricsRegistry.
+ */
+MetricsRegistry::~MetricsRegistry()
+{}
+
+/**
+ * Arrange for a collector to be invoked whenever a snapshot is taken.
+ *
+ * \param collector
+ *      Its collect method will be called by #collect until it is passed
+ *      to removeCollector. The caller retains ownership.
+ */
+void
+MetricsRegistry::addCollector(Collector* collector)
+{
+    SpinLock::Guard _(mutex);
+    collectors.push_back(collector);
+}
+
+/**
+ * Take a snapshot of all metrics and append it to a buffer in the format
+ * understood by parseSnapshot. Used to respond to the GET_METRICS_SNAPSHOT
+ * server control.
+ *
+ * \param buffer
+ *      The snapshot is appended here.
+ * \return
+ *      The number of bytes appended to \a buffer.
+ */
+uint32_t
+MetricsRegistry::appendSnapshot(Buffer* buffer)
+{
+    Snapshot snapshot;
+    collect(&snapshot);
+
+    // The wire format is text, one sample per line:
+    // <c|g> TAB <name> TAB <labels> TAB <value> NEWLINE
+    string text;
+    foreach (const Sample& sample, snapshot) {
+        text.append(format("%c\t%s\t%s\t%s\n",
+                (sample.type == COUNTER) ? 'c' : 'g', sample.name.c_str(),
+                sample.labels.c_str(), formatValue(sample.value).c_str()));
+    }
+    uint32_t length = downCast<uint32_t>(text.length());
+    buffer->appendCopy(text.c_str(), length);
+    return length;
+}
+
+/**
+ * Take a snapshot of all of the metrics known to this registry: the
+ * process-wide PerfStats information plus the metrics of all registered
+ * collectors.
+ *
+ * \param snapshot
+ *      Samples are appended here.
+ */
+void
+MetricsRegistry::collect(Snapshot* snapshot)
+{
+    collectPerfStats(snapshot);
+
+    // The collectors run on a copy of the list, without the lock held, so
+    // that a slow collector can't hold up other snapshots or threads adding
+    // and removing collectors. Instead, removeCollector (invoked when a
+    // service is destroyed) waits for this collection to finish if it
+    // might still invoke the removed collector.
+    std::vector<Collector*> currentCollectors;
+    uint64_t id;
+    {
+        SpinLock::Guard _(mutex);
+        currentCollectors = collectors;
+        id = ++collectionsStarted;
+        activeCollections.insert(id);
+    }
+    try {
+        foreach (Collector* collector, currentCollectors) {
+            collector->collect(snapshot);
+        }
+    } catch (...) {
+        SpinLock::Guard _(mutex);
+        activeCollections.erase(id);
+        throw;
+    }
+    SpinLock::Guard _(mutex);
+    activeCollections.erase(id);
+}
+
+/**
+ * Append samples for the information in PerfStats (which is shared by all
+ * of the threads in the process) to a snapshot.
+ *
+ * \param snapshot
+ *      Samples are appended here.
+ */
+void
+MetricsRegistry::collectPerfStats(Snapshot* snapshot)
+{
+    // Each entry describes one counter in PerfStats; counters measured in
+    // cycles are exported in seconds.
+    struct PerfStatsMetric {
+        const char* name;
+        uint64_t PerfStats::* field;
+        bool cycles;
+    };
+    static const PerfStatsMetric metrics[] = {
+        {"ramcloud_objects_read", &PerfStats::readCount, false},
+        {"ramcloud_object_bytes_read", &PerfStats::readObjectBytes, false},
+        {"ramcloud_numa_local_reads", &PerfStats::numaLocalReads, false},
+        {"ramcloud_numa_remote_reads", &PerfStats::numaRemoteReads, false},
+        {"ramcloud_objects_written", &PerfStats::writeCount, false},
+        {"ramcloud_object_bytes_written", &PerfStats::writeObjectBytes,
+                false},
+        {"ramcloud_dispatch_active_seconds",
+                &PerfStats::dispatchActiveCycles, true},
+        {"ramcloud_worker_active_seconds", &PerfStats::workerActiveCycles,
+                true},
+        {"ramcloud_log_bytes_appended", &PerfStats::logBytesAppended, false},
+        {"ramcloud_replication_rpcs", &PerfStats::replicationRpcs, false},
+        {"ramcloud_log_sync_seconds", &PerfStats::logSyncCycles, true},
+        {"ramcloud_compactor_input_bytes", &PerfStats::compactorInputBytes,
+                false},
+        {"ramcloud_compactor_survivor_bytes",
+                &PerfStats::compactorSurvivorBytes, false},
+        {"ramcloud_cleaner_input_memory_bytes",
+                &PerfStats::cleanerInputMemoryBytes, false},
+        {"ramcloud_cleaner_survivor_bytes", &PerfStats::cleanerSurvivorBytes,
+                false},
+        {"ramcloud_backup_read_bytes", &PerfStats::backupReadBytes, false},
+        {"ramcloud_backup_bytes_received", &PerfStats::backupBytesReceived,
+                false},
+        {"ramcloud_backup_write_bytes", &PerfStats::backupWriteBytes, false},
+        {"ramcloud_network_input_bytes", &PerfStats::networkInputBytes,
+                false},
+        {"ramcloud_network_output_bytes", &PerfStats::networkOutputBytes,
+                false},
+    };
+
+    PerfStats stats;
+    PerfStats::collectStats(&stats);
+    foreach (const PerfStatsMetric& metric, metrics) {
+        uint64_t value = stats.*metric.field;
+        snapshot->emplace_back(metric.name, COUNTER, "", metric.cycles
+                ? Cycles::toSeconds(value)
+                : static_cast<double>(value));
+    }
+
+    // Per-opcode information.
+    static const double quantiles[] = {0.5, 0.99, 0.999};
+    std::unique_ptr<PerfStats::RpcLatency> latency(
+            new PerfStats::RpcLatency);
+    PerfStats::collectRpcLatency(latency.get());
+    for (int i = 0; i < WireFormat::ILLEGAL_RPC_TYPE; i++) {
+        const PerfStats::OpLatency& op = latency->ops[i];
+        uint64_t count = op.service.totalCount();
+        if (count == 0) {
+            continue;
+        }
+        string opcode = label("opcode", WireFormat::opcodeSymbol(i));
+        snapshot->emplace_back("ramcloud_rpcs", COUNTER, opcode,
+                static_cast<double>(count));
+        foreach (double quantile, quantiles) {
+            string labels = opcode + "," +
+                    label("quantile", format("%g", quantile));
+            snapshot->emplace_back("ramcloud_rpc_queue_seconds", GAUGE,
+                    labels, Cycles::toSeconds(
+                    op.queue.getPercentile(100*quantile)));
+            snapshot->emplace_back("ramcloud_rpc_service_seconds", GAUGE,
+                    labels, Cycles::toSeconds(
+                    op.service.getPercentile(100*quantile)));
+        }
+        if (op.counters.rpcs > 0) {
+            snapshot->emplace_back("ramcloud_rpc_instructions", COUNTER,
+                    opcode, static_cast<double>(op.counters.instructions));
+            snapshot->emplace_back("ramcloud_rpc_llc_misses", COUNTER,
+                    opcode, static_cast<double>(op.counters.llcMisses));
+            snapshot->emplace_back("ramcloud_rpc_branch_misses", COUNTER,
+                    opcode, static_cast<double>(op.counters.branchMisses));
+        }
+    }
+}
+
+/**
+ * Format a single label for use in Sample::labels, escaping the value as
+ * required by OpenMetrics.
+ *
+ * \param name
+ *      Name of the label, such as "table".
+ * \param value
+ *      Value for the label.
+ * \return
+ *      A string of the form name="value".
+ */
+string
+MetricsRegistry::label(const char* name, const string& value)
+{
+    string result(name);
+    result.append("=\"");
+    foreach (char c, value) {
+        if (c == '\\') {
+            result.append("\\\\");
+        } else if (c == '"') {
+            result.append("\\\"");
+        } else if (c == '\n') {
+            result.append("\\n");
+        } else {
+            result.push_back(c);
+        }
+    }
+    result.push_back('"');
+    return result;
+}
+
+/**
+ * Format a single label with an integer value (such as a table id).
+ *
+ * \param name
+ *      Name of the label.
+ * \param value
+ *      Value for the label.
+ * \return
+ *      A string of the form name="value".
+ */
+string
+MetricsRegistry::label(const char* name, uint64_t value)
+{
+    return format("%s=\"%lu\"", name, value);
+}
+
+/**
+ * Decode a snapshot that was created by appendSnapshot (e.g. the output of
+ * a GET_METRICS_SNAPSHOT server control). Malformed lines are ignored.
+ *
+ * \param buffer
+ *      Contains the snapshot.
+ * \param offset
+ *      Offset in \a buffer of the first byte of the snapshot.
+ * \param length
+ *      Number of bytes in the snapshot.
+ * \param snapshot
+ *      The samples are appended here.
+ */
+void
+MetricsRegistry::parseSnapshot(Buffer* buffer, uint32_t offset,
+        uint32_t length, Snapshot* snapshot)
+{
+    const char* data = static_cast<const char*>(
+            buffer->getRange(offset, length));
+    if (data == NULL) {
+        return;
+    }
+    string text(data, length);
+    size_t start = 0;
+    while (start < text.length()) {
+        size_t end = text.find('\n', start);
+        if (end == string::npos) {
+            end = text.length();
+        }
+        string line = text.substr(start, end - start);
+        start = end + 1;
+
+        // Labels can contain tabs, so the value is found by searching
+        // backwards from the end of the line.
+        size_t nameStart = line.find('\t');
+        size_t labelsStart = line.find('\t', nameStart + 1);
+        size_t valueStart = line.rfind('\t');
+        if ((nameStart != 1) || (labelsStart == string::npos) ||
+                (valueStart <= labelsStart)) {
+            continue;
+        }
+        Type type = (line[0] == 'c') ? COUNTER : GAUGE;
+        snapshot->emplace_back(
+                line.substr(nameStart + 1, labelsStart - nameStart - 1),
+                type,
+                line.substr(labelsStart + 1, valueStart - labelsStart - 1),
+                strtod(line.c_str() + valueStart + 1, NULL));
+    }
+}
+
+/**
+ * Stop invoking a collector that was passed to addCollector. This method
+ * doesn't return until any snapshots that might still invoke the collector
+ * have finished with it.
+ *
+ * \param collector
+ *      Collector that is about to be destroyed.
+ */
+void
+MetricsRegistry::removeCollector(Collector* collector)
+{
+    uint64_t lastStarted;
+    {
+        SpinLock::Guard _(mutex);
+        for (size_t i = 0; i < collectors.size(); i++) {
+            if (collectors[i] == collector) {
+                collectors.erase(collectors.begin() + i);
+                break;
+            }
+        }
+        lastStarted = collectionsStarted;
+    }
+
+    // Collections that start from now on won't see the collector.
+    while (true) {
+        {
+            SpinLock::Guard _(mutex);
+            if (activeCollections.empty() ||
+                    *activeCollections.begin() > lastStarted)
+                return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * Generate OpenMetrics text exposition format for the metrics of a
+ * collection of servers. Samples are grouped into metric families (as
+ * required by the format), and each sample gets an additional "server"
+ * label identifying where it came from.
+ *
+ * \param servers
+ *      Each entry holds a label value for one server (such as its
+ *      ServerId) and a snapshot of that server's metrics.
+ * \return
+ *      The text to return from an OpenMetrics endpoint, including the
+ *      final "# EOF" line.
+ */
+string
+MetricsRegistry::toOpenMetrics(const std::vector<ServerSnapshot>& servers)
+{
+    // Maps from family name to the samples in that family, each paired
+    // with the label for its server.
+    typedef std::vector<std::pair<const string*, const Sample*>> Family;
+    std::map<string, Family> families;
+    foreach (const ServerSnapshot& server, servers) {
+        foreach (const Sample& sample, server.second) {
+            families[sample.name].emplace_back(&server.first, &sample);
+        }
+    }
+
+    string result;
+    for (std::map<string, Family>::iterator it = families.begin();
+            it != families.end(); it++) {
+        const string& name = it->first;
+        Type type = it->second[0].second->type;
+        result.append(format("# TYPE %s %s\n", name.c_str(),
+                (type == COUNTER) ? "counter" : "gauge"));
+        foreach (Family::value_type& entry, it->second) {
+            const Sample* sample = entry.second;
+            if (sample->type != type) {
+                continue;
+            }
+            string labels = label("server", *entry.first);
+            if (!sample->labels.empty()) {
+                labels.append(",");
+                labels.append(sample->labels);
+            }
+            string value;
+            if (std::isnan(sample->value)) {
+                value = "NaN";
+            } else if (std::isinf(sample->value)) {
+                value = (sample->value > 0) ? "+Inf" : "-Inf";
+            } else {
+                value = formatValue(sample->value);
+            }
+            result.append(format("%s%s{%s} %s\n", name.c_str(),
+                    (type == COUNTER) ? "_total" : "", labels.c_str(),
+                    value.c_str()));
+        }
+    }
+    result.append("# EOF\n");
+    return result;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,154 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_METRICSREGISTRY_H
+#define RAMCLOUD_METRICSREGISTRY_H
+
+#include <set>
+#include <vector>
+
+#include "Common.h"
+#include "Buffer.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * A MetricsRegistry gathers the statistics that a server keeps in various
+ * places (PerfStats counters, per-opcode RPC latency histograms, log and
+ * per-table statistics on masters, cluster membership on the coordinator,
+ * etc.) into a single flat list of named, labeled values, so they can be
+ * exported to standard monitoring systems without a custom scraper for each
+ * kind of statistic. There is one registry in each Context.
+ *
+ * The registry itself always reports the process-wide PerfStats and RPC
+ * latency information. Services with statistics of their own register a
+ * Collector, which is invoked only when a snapshot is requested; collectors
+ * read counters that are already maintained for other purposes (mostly
+ * per-thread counters), so exporting metrics adds no work to the paths that
+ * update them.
+ *
+ * Snapshots are retrieved with the GET_METRICS_SNAPSHOT server control and
+ * are turned into OpenMetrics text by toOpenMetrics (see the metricsGateway
+ * program).
+ */
+class MetricsRegistry {
+  PUBLIC:
+    /// The kinds of metrics (a subset of the OpenMetrics types).
+    enum Type {
+        COUNTER,                  // Only ever increases (until the server
+                                  // restarts).
+        GAUGE                     // Current value of something, which can
+                                  // go up or down.
+    };
+
+    /**
+     * One value in a snapshot.
+     */
+    struct Sample {
+        Sample(const string& name, Type type, const string& labels,
+                double value)
+            : name(name)
+            , type(type)
+            , labels(labels)
+            , value(value)
+        {}
+
+        /// Name of the metric family, such as "ramcloud_rpcs". For
+        /// counters, OpenMetrics output adds a "_total" suffix.
+        string name;
+
+        /// Kind of metric. All samples with the same name must have the
+        /// same type.
+        Type type;
+
+        /// Labels that distinguish this sample from others in the same
+        /// family, in OpenMetrics syntax without the braces (e.g.
+        /// opcode="READ",quantile="0.99"); empty means no labels. See
+        /// label().
+        string labels;
+
+        /// Current value of the metric.
+        double value;
+    };
+
+    /// A list of samples, in no particular order.
+    typedef std::vector<Sample> Snapshot;
+
+    /**
+     * Services that have metrics of their own implement this interface
+     * and pass themselves to addCollector.
+     */
+    class Collector {
+      public:
+        virtual ~Collector() {}
+
+        /**
+         * Append the current values of all of this collector's metrics
+         * to a snapshot. Invoked in whichever thread requested the
+         * snapshot, possibly concurrently with normal operation and with
+         * other snapshots, but without the registry's lock held. This
+         * method must not remove its own collector (removeCollector would
+         * wait for it forever), and it should read counters rather than
+         * take locks that normal operation depends on.
+         *
+         * \param snapshot
+         *      Samples get appended here.
+         */
+        virtual void collect(Snapshot* snapshot) = 0;
+    };
+
+    MetricsRegistry();
+    ~MetricsRegistry();
+    void addCollector(Collector* collector);
+    uint32_t appendSnapshot(Buffer* buffer);
+    void collect(Snapshot* snapshot);
+    static string label(const char* name, const string& value);
+    static string label(const char* name, uint64_t value);
+    static void parseSnapshot(Buffer* buffer, uint32_t offset,
+            uint32_t length, Snapshot* snapshot);
+    void removeCollector(Collector* collector);
+
+    /// Identifies the server that a snapshot came from (used as the value
+    /// of the "server" label in toOpenMetrics), and the snapshot itself.
+    typedef std::pair<string, Snapshot> ServerSnapshot;
+    static string toOpenMetrics(const std::vector<ServerSnapshot>& servers);
+
+  PRIVATE:
+    static void collectPerfStats(Snapshot* snapshot);
+
+    /// Protects all of the fields below.
+    SpinLock mutex;
+
+    /// All of the collectors that have been registered (and not yet
+    /// removed), in the order they were registered.
+    std::vector<Collector*> collectors;
+
+    /// Number of calls to #collect that have started; used to assign
+    /// identifiers to them.
+    uint64_t collectionsStarted;
+
+    /// Identifiers of the calls to #collect that are currently invoking
+    /// collectors; removeCollector waits for the ones that started before
+    /// it removed its collector.
+    std::set<uint64_t> activeCollections;
+
+    DISALLOW_COPY_AND_ASSIGN(MetricsRegistry);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_METRICSREGISTRY_H
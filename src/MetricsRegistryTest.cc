@@ -0,0 +1,257 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <atomic>
+#include <thread>
+
+#include "TestUtil.h"
+
+#include "MetricsRegistry.h"
+#include "PerfStats.h"
+
+namespace RAMCloud {
+
+class MetricsRegistryTest : public ::testing::Test {
+  public:
+    MetricsRegistry registry;
+
+    MetricsRegistryTest()
+        : registry()
+    {}
+
+    DISALLOW_COPY_AND_ASSIGN(MetricsRegistryTest);
+};
+
+// Collector that returns a fixed set of samples.
+class TestCollector : public MetricsRegistry::Collector {
+  public:
+    explicit TestCollector(const char* name)
+        : name(name)
+        , calls(0)
+    {}
+
+    void
+    collect(MetricsRegistry::Snapshot* snapshot)
+    {
+        calls++;
+        snapshot->emplace_back(name, MetricsRegistry::GAUGE,
+                MetricsRegistry::label("table", 7UL), 42);
+    }
+
+    const char* name;
+    int calls;
+
+    DISALLOW_COPY_AND_ASSIGN(TestCollector);
+};
+
+// Collector that registers another collector while it runs (which would
+// deadlock if the registry's lock were held).
+class AddingCollector : public MetricsRegistry::Collector {
+  public:
+    AddingCollector(MetricsRegistry* registry, TestCollector* other)
+        : registry(registry)
+        , other(other)
+        , activeCollections(0)
+    {}
+
+    void
+    collect(MetricsRegistry::Snapshot* snapshot)
+    {
+        registry->addCollector(other);
+        activeCollections = registry->activeCollections.size();
+    }
+
+    MetricsRegistry* registry;
+    TestCollector* other;
+    size_t activeCollections;
+
+    DISALLOW_COPY_AND_ASSIGN(AddingCollector);
+};
+
+// Returns the samples in a snapshot with a given name, one per line, in
+// the form "labels value".
+static string
+find(MetricsRegistry::Snapshot& snapshot, const char* name)
+{
+    string result;
+    foreach (MetricsRegistry::Sample& sample, snapshot) {
+        if (sample.name == name) {
+            result.append(format("%s%s %.0f", result.empty() ? "" : "\n",
+                    sample.labels.c_str(), sample.value));
+        }
+    }
+    return result;
+}
+
+TEST_F(MetricsRegistryTest, addCollector_removeCollector) {
+    TestCollector first("first"), second("second");
+    registry.addCollector(&first);
+    registry.addCollector(&second);
+    MetricsRegistry::Snapshot snapshot;
+    registry.collect(&snapshot);
+    EXPECT_EQ("table=\"7\" 42", find(snapshot, "first"));
+    EXPECT_EQ("table=\"7\" 42", find(snapshot, "second"));
+
+    registry.removeCollector(&first);
+    snapshot.clear();
+    registry.collect(&snapshot);
+    EXPECT_EQ("", find(snapshot, "first"));
+    EXPECT_EQ("table=\"7\" 42", find(snapshot, "second"));
+    EXPECT_EQ(1, first.calls);
+    EXPECT_EQ(2, second.calls);
+}
+
+TEST_F(MetricsRegistryTest, collect_collectorsRunWithoutLock) {
+    TestCollector other("other");
+    AddingCollector adding(&registry, &other);
+    registry.addCollector(&adding);
+    MetricsRegistry::Snapshot snapshot;
+    registry.collect(&snapshot);
+    EXPECT_EQ(1U, adding.activeCollections);
+    EXPECT_EQ(0U, registry.activeCollections.size());
+
+    // The collector added during the first snapshot is only invoked by
+    // later ones.
+    EXPECT_EQ(0, other.calls);
+    registry.removeCollector(&adding);
+    registry.collect(&snapshot);
+    EXPECT_EQ(1, other.calls);
+}
+
+static void
+removeThread(MetricsRegistry* registry, MetricsRegistry::Collector* collector,
+        std::atomic<bool>* done)
+{
+    registry->removeCollector(collector);
+    *done = true;
+}
+
+TEST_F(MetricsRegistryTest, removeCollector_waitsForCollections) {
+    TestCollector collector("collector");
+    registry.addCollector(&collector);
+
+    // Pretend that a collection started before the collector was removed
+    // is still running.
+    registry.collectionsStarted = 1;
+    registry.activeCollections.insert(1);
+    std::atomic<bool> done(false);
+    std::thread thread(removeThread, &registry, &collector, &done);
+    for (int i = 0; i < 1000; i++) {
+        {
+            SpinLock::Guard _(registry.mutex);
+            if (registry.collectors.empty())
+                break;
+        }
+        usleep(1000);
+    }
+    EXPECT_EQ(0U, registry.collectors.size());
+    usleep(1000);
+    EXPECT_FALSE(done);
+
+    // A collection that started after the removal doesn't matter.
+    {
+        SpinLock::Guard _(registry.mutex);
+        registry.activeCollections.erase(1);
+        registry.activeCollections.insert(2);
+    }
+    thread.join();
+    EXPECT_TRUE(done);
+}
+
+TEST_F(MetricsRegistryTest, collect_perfStats) {
+    PerfStats::threadStats.readCount += 5;
+    PerfStats::recordRpcLatency(WireFormat::READ, 100, 200);
+    MetricsRegistry::Snapshot snapshot;
+    registry.collect(&snapshot);
+    EXPECT_NE("", find(snapshot, "ramcloud_objects_read"));
+    EXPECT_NE(string::npos, find(snapshot, "ramcloud_rpcs").find(
+            "opcode=\"READ\""));
+    EXPECT_NE(string::npos, find(snapshot,
+            "ramcloud_rpc_service_seconds").find(
+            "opcode=\"READ\",quantile=\"0.99\""));
+}
+
+TEST_F(MetricsRegistryTest, label) {
+    EXPECT_EQ("server=\"mock:host=a\"",
+            MetricsRegistry::label("server", string("mock:host=a")));
+    EXPECT_EQ("x=\"a\\\\b\\\"c\\nd\"",
+            MetricsRegistry::label("x", string("a\\b\"c\nd")));
+    EXPECT_EQ("table=\"12\"", MetricsRegistry::label("table", 12UL));
+}
+
+TEST_F(MetricsRegistryTest, appendSnapshot_parseSnapshot) {
+    TestCollector collector("test");
+    registry.addCollector(&collector);
+    Buffer buffer;
+    buffer.appendCopy("abc", 3);
+    uint32_t length = registry.appendSnapshot(&buffer);
+    EXPECT_EQ(length + 3, buffer.size());
+
+    MetricsRegistry::Snapshot snapshot;
+    MetricsRegistry::parseSnapshot(&buffer, 3, length, &snapshot);
+    EXPECT_EQ("table=\"7\" 42", find(snapshot, "test"));
+    MetricsRegistry::Snapshot original;
+    registry.collect(&original);
+    EXPECT_EQ(original.size(), snapshot.size());
+    registry.removeCollector(&collector);
+}
+
+TEST_F(MetricsRegistryTest, parseSnapshot_badLines) {
+    Buffer buffer;
+    const char* text = "c\tgood\t\t3\n"
+            "bogus line\n"
+            "g\tnoLabels\t5\n"
+            "g\ttabs\ta=\"x\ty\"\t4";
+    buffer.appendCopy(text, downCast<uint32_t>(strlen(text)));
+    MetricsRegistry::Snapshot snapshot;
+    MetricsRegistry::parseSnapshot(&buffer, 0, buffer.size(), &snapshot);
+    ASSERT_EQ(2U, snapshot.size());
+    EXPECT_EQ("good", snapshot[0].name);
+    EXPECT_EQ(MetricsRegistry::COUNTER, snapshot[0].type);
+    EXPECT_EQ("", snapshot[0].labels);
+    EXPECT_EQ(3.0, snapshot[0].value);
+    EXPECT_EQ("tabs", snapshot[1].name);
+    EXPECT_EQ(MetricsRegistry::GAUGE, snapshot[1].type);
+    EXPECT_EQ("a=\"x\ty\"", snapshot[1].labels);
+    EXPECT_EQ(4.0, snapshot[1].value);
+}
+
+TEST_F(MetricsRegistryTest, toOpenMetrics) {
+    std::vector<MetricsRegistry::ServerSnapshot> servers(2);
+    servers[0].first = "coordinator";
+    servers[0].second.emplace_back("ramcloud_rpcs", MetricsRegistry::COUNTER,
+            "opcode=\"PING\"", 10);
+    servers[0].second.emplace_back("ramcloud_cluster_servers",
+            MetricsRegistry::GAUGE, "", 2);
+    servers[1].first = "1.0";
+    servers[1].second.emplace_back("ramcloud_rpcs", MetricsRegistry::COUNTER,
+            "opcode=\"READ\"", 1e06);
+    servers[1].second.emplace_back("ramcloud_rpc_service_seconds",
+            MetricsRegistry::GAUGE, "", 2.5e-06);
+    servers[1].second.emplace_back("ramcloud_cluster_servers",
+            MetricsRegistry::COUNTER, "", 7);
+    EXPECT_EQ("# TYPE ramcloud_cluster_servers gauge\n"
+            "ramcloud_cluster_servers{server=\"coordinator\"} 2\n"
+            "# TYPE ramcloud_rpc_service_seconds gauge\n"
+            "ramcloud_rpc_service_seconds{server=\"1.0\"} 2.5e-06\n"
+            "# TYPE ramcloud_rpcs counter\n"
+            "ramcloud_rpcs_total{server=\"coordinator\",opcode=\"PING\"} 10\n"
+            "ramcloud_rpcs_total{server=\"1.0\",opcode=\"READ\"} 1000000\n"
+            "# EOF\n",
+            MetricsRegistry::toOpenMetrics(servers));
+}
+
+}  // namespace RAMCloud
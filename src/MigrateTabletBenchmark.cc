@@ -117,7 +117,8 @@ class MigrateTabletBenchmark {
         metrics->temp.count8 =
         metrics->temp.count9 = 0;
 
-        Tub<Segment> transferSeg{};
+        MasterService::MigrationPipeline pipeline(&context, ServerId{},
+                0, 0lu, config.master.migrationMaxInFlight);
 
         uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
         uint64_t totalBytes = 0;
@@ -129,9 +130,8 @@ class MigrateTabletBenchmark {
             SegmentIterator it{*s};
             while (!it.isDone()) {
                 Status r = service->migrateSingleLogEntry(
-                                it, transferSeg, entryTotals, totalBytes,
-                                0, 0lu, ~0lu,
-                                ServerId{});
+                                it, pipeline, entryTotals, totalBytes,
+                                0, 0lu, ~0lu);
                 if (r != STATUS_OK) {
                     printf("Catastrophic failure\n");
                     exit(-1);
@@ -139,6 +139,7 @@ class MigrateTabletBenchmark {
                 it.next();
             }
         }
+        pipeline.finish();
         uint64_t ticks = Cycles::rdtsc() - before;
 
         uint64_t totalObjectBytes = numObjects * (dataLen + sizeof(nextKeyVal));
@@ -35,6 +35,8 @@ MockExternalStorage::MockExternalStorage(bool generateLog)
     , getChildrenNames()
     , getChildrenValues()
     , setData()
+    , setMultiErrors()
+    , roundTrips(0)
 {}
 
 /**
@@ -49,6 +51,7 @@ void
 MockExternalStorage::becomeLeader(const char* name, const string& leaderInfo)
 {
     Lock lock(mutex);
+    roundTrips++;
     if (generateLog) {
         logAppend(lock, format("becomeLeader(%s, %s)", name,
                 leaderInfo.c_str()));
@@ -60,6 +63,7 @@ bool
 MockExternalStorage::get(const char* name, Buffer* value)
 {
     Lock lock(mutex);
+    roundTrips++;
     if (generateLog) {
         logAppend(lock, format("get(%s)", name));
     }
@@ -78,6 +82,7 @@ void
 MockExternalStorage::getChildren(const char* name, vector<Object>* children)
 {
     Lock lock(mutex);
+    roundTrips++;
     if (generateLog) {
         logAppend(lock, format("getChildren(%s)", name));
     }
@@ -100,6 +105,7 @@ void
 MockExternalStorage::remove(const char* name)
 {
     Lock lock(mutex);
+    roundTrips++;
     if (generateLog) {
         logAppend(lock, format("remove(%s)", name));
     }
@@ -111,6 +117,7 @@ MockExternalStorage::set(Hint flavor, const char* name, const char* value,
         int valueLength)
 {
     Lock lock(mutex);
+    roundTrips++;
     if (generateLog) {
         logAppend(lock, format("set(%s, %s)",
                 (flavor == Hint::CREATE) ? "CREATE" : "UPDATE", name));
@@ -119,6 +126,34 @@ MockExternalStorage::set(Hint flavor, const char* name, const char* value,
             : downCast<size_t>(valueLength));
 }
 
+// See documentation for ExternalStorage::setMulti.
+void
+MockExternalStorage::setMulti(vector<Write>* writes)
+{
+    Lock lock(mutex);
+    roundTrips++;
+    if (generateLog) {
+        string names;
+        for (Write& write : *writes) {
+            if (names.length() != 0) {
+                names.append(", ");
+            }
+            names.append(format("%s %s",
+                    (write.flavor == Hint::CREATE) ? "CREATE" : "UPDATE",
+                    write.name.c_str()));
+        }
+        logAppend(lock, format("setMulti(%s)", names.c_str()));
+    }
+    if (!setMultiErrors.empty()) {
+        std::exception_ptr error = setMultiErrors.front();
+        setMultiErrors.pop();
+        std::rethrow_exception(error);
+    }
+    if (!writes->empty()) {
+        setData = writes->back().value;
+    }
+}
+
 /**
  * This method is invoked to add information to the internal log;
  * its main job is to insert separators between the information from
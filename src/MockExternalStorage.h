@@ -19,6 +19,7 @@
 #include <thread>
 #include <mutex>
 #include <string>
+#include <exception>
 #include <queue>
 #include "ExternalStorage.h"
 
@@ -40,6 +41,7 @@ class MockExternalStorage: public ExternalStorage {
     virtual void remove(const char* name);
     virtual void set(Hint flavor, const char* name, const char* value,
             int valueLength = -1);
+    virtual void setMulti(vector<Write>* writes);
 
     /**
      * This method treats the most recent value from a "set" call as a
@@ -87,9 +89,18 @@ class MockExternalStorage: public ExternalStorage {
     std::queue<std::string> getChildrenNames;
     std::queue<std::string> getChildrenValues;
 
-    /// Holds the data from the last call to "set".
+    /// Holds the data from the last call to "set" (or the last object
+    /// written by "setMulti").
     std::string setData;
 
+    /// If not empty, the next call to setMulti throws the first exception
+    /// in this queue (and removes it) instead of writing anything.
+    std::queue<std::exception_ptr> setMultiErrors;
+
+    /// Number of calls that would have required a round trip to a real
+    /// storage system (everything except getWorkspace and setWorkspace).
+    uint64_t roundTrips;
+
     void logAppend(Lock& lock, const std::string& record);
 
     DISALLOW_COPY_AND_ASSIGN(MockExternalStorage);
@@ -99,6 +99,16 @@ TEST_F(MockExternalStorageTest, set) {
     EXPECT_EQ("99", storage.setData);
 }
 
+TEST_F(MockExternalStorageTest, setMulti) {
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::CREATE, "/a/b/c", "xyzzy", 5);
+    writes.emplace_back(ExternalStorage::UPDATE, "/x1", "99");
+    storage.setMulti(&writes);
+    EXPECT_EQ("setMulti(CREATE /a/b/c, UPDATE /x1)", storage.log);
+    EXPECT_EQ("99", storage.setData);
+    EXPECT_EQ(1U, storage.roundTrips);
+}
+
 TEST_F(MockExternalStorageTest, logAppend) {
     MockExternalStorage::Lock lock(storage.mutex);
     storage.logAppend(lock, "x y z");
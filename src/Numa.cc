@@ -0,0 +1,225 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <fstream>
+#include <sstream>
+
+#include "Common.h"
+#include "Numa.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+#ifdef TESTING
+int Numa::mockNumNodes = 0;
+int Numa::mockCurrentNode = 0;
+#endif
+
+/// Memory nodes are identified by bits in a 64-bit mask, so larger node
+/// ids are ignored (no machine we run on comes close).
+static const int MAX_NODES = 64;
+
+/**
+ * Read the NUMA topology of the machine from sysfs. If there is no NUMA
+ * information, all CPUs are considered part of node 0.
+ */
+Numa::Topology::Topology()
+    : numNodes(1)
+    , cpuToNode()
+{
+    for (int node = 0; node < MAX_NODES; node++) {
+        std::ifstream file(format("/sys/devices/system/node/node%d/cpulist",
+                node));
+        string cpuList;
+        if (!file || !std::getline(file, cpuList))
+            continue;
+        numNodes = node + 1;
+        foreach (int cpu, parseCpuList(cpuList)) {
+            if (cpu >= downCast<int>(cpuToNode.size()))
+                cpuToNode.resize(cpu + 1, 0);
+            cpuToNode[cpu] = node;
+        }
+    }
+}
+
+/**
+ * Require that the pages in a region of memory be placed on a particular
+ * node, migrating any that have already been allocated elsewhere.
+ *
+ * \param start
+ *      First byte of the region; must be page-aligned.
+ * \param length
+ *      Number of bytes in the region.
+ * \param node
+ *      Node on which the memory should be placed.
+ * \return
+ *      True means the memory was bound to the node; false means the
+ *      kernel refused (e.g., because there is no such node or NUMA
+ *      support isn't compiled in), and an error has been logged.
+ */
+bool
+Numa::bindMemory(void* start, size_t length, int node)
+{
+    if (node < 0 || node >= MAX_NODES) {
+        LOG(WARNING, "Can't bind memory to NUMA node %d", node);
+        return false;
+    }
+    return setMemoryPolicy(start, length, MPOL_BIND, 1UL << node);
+}
+
+/**
+ * Return the node containing the CPU that the calling thread is running
+ * on. Unless the thread is pinned to CPUs of a single node, it may have
+ * moved by the time the caller uses the result, so this is only a hint.
+ */
+int
+Numa::getCurrentNode()
+{
+#ifdef TESTING
+    if (mockNumNodes)
+        return mockCurrentNode;
+#endif
+    return getNodeOfCpu(sched_getcpu());
+}
+
+/**
+ * Return the node containing a given CPU, or 0 if the CPU is unknown.
+ */
+int
+Numa::getNodeOfCpu(int cpu)
+{
+    Topology& topology = getTopology();
+    if (cpu < 0 || cpu >= downCast<int>(topology.cpuToNode.size()))
+        return 0;
+    return topology.cpuToNode[cpu];
+}
+
+/**
+ * Return the number of memory nodes on this machine (1 if it doesn't
+ * support NUMA).
+ */
+int
+Numa::getNumNodes()
+{
+#ifdef TESTING
+    if (mockNumNodes)
+        return mockNumNodes;
+#endif
+    return getTopology().numNodes;
+}
+
+/**
+ * Spread the pages in a region of memory evenly across all of the nodes,
+ * migrating any that have already been allocated. This is a good choice
+ * for structures such as the hash table, which are accessed uniformly by
+ * threads on all nodes.
+ *
+ * \param start
+ *      First byte of the region; must be page-aligned.
+ * \param length
+ *      Number of bytes in the region.
+ * \return
+ *      True means the memory policy was applied; false means the kernel
+ *      refused, and an error has been logged.
+ */
+bool
+Numa::interleaveMemory(void* start, size_t length)
+{
+    int numNodes = std::min(getNumNodes(), MAX_NODES);
+    uint64_t nodeMask = (numNodes == MAX_NODES) ? ~0UL
+                                                : (1UL << numNodes) - 1;
+    return setMemoryPolicy(start, length, MPOL_INTERLEAVE, nodeMask);
+}
+
+/**
+ * Parse a list of CPUs in the format used by sysfs (e.g. "0-3,8,10-11").
+ *
+ * \param cpuList
+ *      String to parse.
+ * \return
+ *      The CPUs in the list, in the order given. Malformed elements are
+ *      ignored.
+ */
+vector<int>
+Numa::parseCpuList(const string& cpuList)
+{
+    vector<int> cpus;
+    std::stringstream stream(cpuList);
+    string range;
+    while (std::getline(stream, range, ',')) {
+        int first, last;
+        int count = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (count < 1 || first < 0)
+            continue;
+        if (count == 1)
+            last = first;
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+/**
+ * Return the machine's topology, reading it from sysfs the first time
+ * this is invoked.
+ */
+Numa::Topology&
+Numa::getTopology()
+{
+    static Topology topology;
+    return topology;
+}
+
+/**
+ * Apply a memory policy to a region of memory with the mbind system call
+ * (invoked directly, so that we don't depend on libnuma). Pages that
+ * have already been allocated are migrated to conform to the policy.
+ *
+ * \param start
+ *      First byte of the region; must be page-aligned.
+ * \param length
+ *      Number of bytes in the region.
+ * \param mode
+ *      The memory policy, such as MPOL_BIND or MPOL_INTERLEAVE.
+ * \param nodeMask
+ *      Bit i is set if node i may hold pages of the region.
+ * \return
+ *      True means the policy was applied; false means the kernel refused,
+ *      and an error has been logged.
+ */
+bool
+Numa::setMemoryPolicy(void* start, size_t length, int mode,
+                      uint64_t nodeMask)
+{
+#ifdef TESTING
+    if (mockNumNodes)
+        return true;
+#endif
+    if (length == 0)
+        return true;
+    if (syscall(SYS_mbind, start, length, mode, &nodeMask, MAX_NODES + 1,
+            MPOL_MF_MOVE) != 0) {
+        LOG(WARNING, "Couldn't set NUMA policy %d (nodes 0x%lx) for %lu "
+                "bytes at %p: %s", mode, nodeMask, length, start,
+                strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+} // namespace RAMCloud
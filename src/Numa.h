@@ -0,0 +1,79 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_NUMA_H
+#define RAMCLOUD_NUMA_H
+
+#include "Common.h"
+
+namespace RAMCloud {
+
+/**
+ * This class provides information about the NUMA topology of the machine
+ * (which CPUs belong to which memory node) and controls which nodes back
+ * regions of memory. Masters use it to keep log memory and the hash table
+ * spread across the nodes of multi-socket machines, rather than placing
+ * everything on the node of whichever thread happened to touch the memory
+ * first (see ServerConfig::Master::numaAware).
+ *
+ * The topology is read from /sys/devices/system/node the first time it is
+ * needed. On machines without NUMA support, there is a single node 0 that
+ * contains all CPUs, and the memory placement methods do nothing.
+ *
+ * This class contains only static methods.
+ */
+class Numa {
+  public:
+    static bool bindMemory(void* start, size_t length, int node);
+    static int getCurrentNode();
+    static int getNodeOfCpu(int cpu);
+    static int getNumNodes();
+    static bool interleaveMemory(void* start, size_t length);
+    static vector<int> parseCpuList(const string& cpuList);
+
+#ifdef TESTING
+    /// If nonzero, getNumNodes returns this value, getCurrentNode returns
+    /// #mockCurrentNode, and memory placement methods do nothing. Used in
+    /// unit tests.
+    static int mockNumNodes;
+
+    /// See #mockNumNodes.
+    static int mockCurrentNode;
+#endif
+
+  PRIVATE:
+    /**
+     * The NUMA topology of this machine, as read from sysfs.
+     */
+    struct Topology {
+        Topology();
+
+        /// Number of memory nodes (one more than the largest node id).
+        int numNodes;
+
+        /// Element i gives the node containing CPU i.
+        vector<int> cpuToNode;
+    };
+
+    static Topology& getTopology();
+    static bool setMemoryPolicy(void* start, size_t length, int mode,
+                                uint64_t nodeMask);
+
+    Numa();
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_NUMA_H
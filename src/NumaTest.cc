@@ -0,0 +1,60 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "Numa.h"
+
+namespace RAMCloud {
+
+// Return a human-readable string listing the CPUs returned by parseCpuList.
+static string
+cpuList(const vector<int>& cpus)
+{
+    string result;
+    foreach (int cpu, cpus)
+        result += format("%s%d", result.empty() ? "" : " ", cpu);
+    return result;
+}
+
+TEST(NumaTest, parseCpuList) {
+    EXPECT_EQ("0 1 2 3 8 10 11",
+              cpuList(Numa::parseCpuList("0-3,8,10-11")));
+    EXPECT_EQ("5", cpuList(Numa::parseCpuList("5\n")));
+    EXPECT_EQ("", cpuList(Numa::parseCpuList("")));
+    EXPECT_EQ("2", cpuList(Numa::parseCpuList("bogus,2,-1")));
+}
+
+TEST(NumaTest, getNodeOfCpu) {
+    EXPECT_EQ(0, Numa::getNodeOfCpu(-1));
+    EXPECT_EQ(0, Numa::getNodeOfCpu(1 << 20));
+    EXPECT_LT(Numa::getNodeOfCpu(0), Numa::getNumNodes());
+}
+
+TEST(NumaTest, getNumNodes) {
+    EXPECT_LE(1, Numa::getNumNodes());
+    Numa::mockNumNodes = 4;
+    EXPECT_EQ(4, Numa::getNumNodes());
+    Numa::mockNumNodes = 0;
+}
+
+TEST(NumaTest, bindMemory_badNode) {
+    TestLog::Enable _;
+    char buffer[10];
+    EXPECT_FALSE(Numa::bindMemory(buffer, sizeof(buffer), 64));
+    EXPECT_EQ("bindMemory: Can't bind memory to NUMA node 64", TestLog::get());
+}
+
+} // namespace RAMCloud
@@ -20,6 +20,74 @@
 
 namespace RAMCloud {
 
+/**
+ * Return the number of bytes writeVarint uses to encode a value.
+ */
+static uint32_t
+varintLength(uint64_t value)
+{
+    uint32_t length = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        length++;
+    }
+    return length;
+}
+
+/**
+ * Encode a value in 7-bit groups, least significant group first; the top
+ * bit of each byte is set if more bytes follow.
+ *
+ * \param value
+ *      Value to encode.
+ * \param target
+ *      The encoded value is written here.
+ * \return
+ *      The number of bytes written (between 1 and 10).
+ */
+static uint32_t
+writeVarint(uint64_t value, uint8_t* target)
+{
+    uint32_t length = 0;
+    while (value >= 0x80) {
+        target[length++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    target[length++] = static_cast<uint8_t>(value);
+    return length;
+}
+
+/**
+ * Decode a value written by writeVarint.
+ *
+ * \param src
+ *      Memory containing the encoded value.
+ * \param length
+ *      Number of bytes available at src.
+ * \param[in,out] offset
+ *      Offset in src of the encoded value; updated to refer to the first
+ *      byte after it.
+ * \param[out] value
+ *      The decoded value.
+ * \return
+ *      False if the encoding runs past the end of src, true otherwise.
+ */
+static bool
+readVarint(const uint8_t* src, uint32_t length, uint32_t* offset,
+        uint64_t* value)
+{
+    *value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (*offset >= length)
+            return false;
+        uint8_t byte = src[(*offset)++];
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
 /**
  * Construct an Object in preparation for storing it in the log.
  * This form is used when the header information is available in
@@ -56,6 +124,8 @@ Object::Object(uint64_t tableId,
     : header(tableId,
              timestamp,
              version),
+      compact(false),
+      expiryTime(0),
       keysAndValueLength(),
       keysAndValue(),
       keysAndValueBuffer(&keysAndValueBuffer),
@@ -112,6 +182,8 @@ Object::Object(Key& key,
     : header(key.getTableId(),
              timestamp,
              version),
+      compact(false),
+      expiryTime(0),
       keysAndValueLength(),
       keysAndValue(),
       keysAndValueBuffer(),
@@ -161,22 +233,23 @@ Object::Object(Key& key,
  *      starting at offset.
  */
 Object::Object(Buffer& buffer, uint32_t offset, uint32_t length)
-    : header(*buffer.getOffset<Header>(offset)),
+    : header(0, 0, 0),
+      compact(false),
+      expiryTime(0),
       keysAndValueLength(),
       keysAndValue(),
       keysAndValueBuffer(&buffer),
-      keysAndValueOffset(offset + sizeof32(header)),
+      keysAndValueOffset(),
       keyOffsets(NULL)
 {
-    // If length is not specified, compute the length of keysAndValue
+    // If length is not specified, the object extends to the end of the
+    // buffer.
     if (length == 0)
-        keysAndValueLength = buffer.size() - offset -
-                             sizeof32(header);
-    else
-        keysAndValueLength = length - sizeof32(header);
+        length = buffer.size() - offset;
+    parseHeader(buffer, offset, length);
 
     void* retPtr;
-    if (buffer.peek(offset + sizeof32(header), &retPtr) >= keysAndValueLength)
+    if (buffer.peek(keysAndValueOffset, &retPtr) >= keysAndValueLength)
         keysAndValue = static_cast<char*>(retPtr);
 }
 
@@ -193,14 +266,18 @@ Object::Object(Buffer& buffer, uint32_t offset, uint32_t length)
  *      Total length of the object in bytes.
  */
 Object::Object(const void* buffer, uint32_t length)
-    : header(*reinterpret_cast<const Header*>(buffer)),
-      keysAndValueLength(length - sizeof32(header)),
-      keysAndValue(reinterpret_cast<const void*>(reinterpret_cast<
-                   const uint8_t*>(buffer) + sizeof32(header))),
+    : header(0, 0, 0),
+      compact(false),
+      expiryTime(0),
+      keysAndValueLength(),
+      keysAndValue(),
       keysAndValueBuffer(),
       keysAndValueOffset(0),
       keyOffsets(NULL)
 {
+    uint32_t headerLength = parseHeader(buffer, length);
+    keysAndValueLength = length - headerLength;
+    keysAndValue = static_cast<const uint8_t*>(buffer) + headerLength;
 }
 
 /**
@@ -214,7 +291,8 @@ void
 Object::assembleForLog(Buffer& buffer)
 {
     header.checksum = computeChecksum();
-    buffer.append(&header, sizeof32(header));
+    uint8_t serializedHeader[MAX_HEADER_LENGTH];
+    buffer.appendCopy(serializedHeader, serializeHeader(serializedHeader));
     appendKeysAndValueToBuffer(buffer);
 }
 
@@ -233,8 +311,8 @@ Object::assembleForLog(void* memBlock)
     uint8_t *dst = reinterpret_cast<uint8_t*>(memBlock);
     header.checksum = computeChecksum();
 
-    memcpy(dst, &header, sizeof32(header));
-    memcpy(dst + sizeof32(header), getKeysAndValue(), keysAndValueLength);
+    uint32_t headerLength = serializeHeader(dst);
+    memcpy(dst + headerLength, getKeysAndValue(), keysAndValueLength);
 }
 
 /**
@@ -703,13 +781,61 @@ Object::getTimestamp()
     return header.timestamp;
 }
 
+/**
+ * Obtain the time at which this object expires, in WallTime seconds, or 0
+ * if it never expires.
+ */
+uint32_t
+Object::getExpiryTime()
+{
+    return expiryTime;
+}
+
+/**
+ * Obtain the number of bytes the object header occupies in the log (this
+ * depends on the format and, for compact headers, on the version, table
+ * id and expiry time).
+ */
+uint32_t
+Object::getHeaderLength()
+{
+    if (!compact)
+        return sizeof32(header);
+    return sizeof32(header.checksum) + sizeof32(header.timestamp) +
+           varintLength(header.version) + varintLength(header.tableId) +
+           (expiryTime != 0 ? sizeof32(expiryTime) : 0);
+}
+
 /**
  * Obtain the total size of the object including the object header
  */
 uint32_t
 Object::getSerializedLength()
 {
-    return sizeof32(header) + keysAndValueLength;
+    return getHeaderLength() + keysAndValueLength;
+}
+
+/**
+ * Returns true if the object is stored with (or will be written with) a
+ * compact header; see the class documentation.
+ */
+bool
+Object::isCompact()
+{
+    return compact;
+}
+
+/**
+ * Returns true if the object has expired, meaning that it should be
+ * treated as if it had been deleted.
+ *
+ * \param now
+ *      The current time, as returned by WallTime::secondsTimestamp.
+ */
+bool
+Object::isExpired(uint32_t now)
+{
+    return expiryTime != 0 && expiryTime <= now;
 }
 
 /**
@@ -723,6 +849,39 @@ Object::checkIntegrity()
     return computeChecksum() == header.checksum;
 }
 
+/**
+ * Choose the format in which this object will be written to the log by
+ * assembleForLog. Either format can be read back by the constructors.
+ *
+ * \param compact
+ *      True means use the compact header, false means the full 24-byte
+ *      header. The compact header is only used if the object's timestamp
+ *      fits in it; otherwise this request is ignored. Objects with an
+ *      expiry time always use the compact header if they can.
+ */
+void
+Object::setCompact(bool compact)
+{
+    this->compact = (compact || expiryTime != 0) &&
+            (header.timestamp & (COMPACT_FLAG | EXPIRES_FLAG)) == 0;
+}
+
+/**
+ * Set the time at which this object expires. The object is switched to the
+ * compact header, which is the only one that can hold an expiry time (see
+ * the class documentation).
+ *
+ * \param expiryTime
+ *      WallTime (in seconds) at which the object should be treated as
+ *      deleted, or 0 if it should never expire.
+ */
+void
+Object::setExpiryTime(uint32_t expiryTime)
+{
+    this->expiryTime = expiryTime;
+    setCompact(compact);
+}
+
 /* Set the version for this object */
 void
 Object::setVersion(uint64_t version)
@@ -735,6 +894,8 @@ void
 Object::setTimestamp(uint32_t timestamp)
 {
     header.timestamp = timestamp;
+    if (timestamp & (COMPACT_FLAG | EXPIRES_FLAG))
+        compact = false;
 }
 
 /**
@@ -755,6 +916,11 @@ Object::applyChecksum(Crc32C *crc)
                downCast<uint32_t>(sizeof(header) -
                sizeof(header.checksum)));
 
+    // The expiry time isn't part of the header struct; objects without one
+    // keep the checksum they had before expiry times existed.
+    if (expiryTime != 0)
+        crc->update(&expiryTime, sizeof(expiryTime));
+
     // then compute the checksum on keysAndValue.
     if (keysAndValue) {
         crc->update(keysAndValue, keysAndValueLength);
@@ -781,6 +947,9 @@ Object::computeChecksum()
                downCast<uint32_t>(sizeof(header) -
                sizeof(header.checksum)));
 
+    if (expiryTime != 0)
+        crc.update(&expiryTime, sizeof(expiryTime));
+
     // then compute the checksum on keysAndValue.
     if (keysAndValue) {
         crc.update(keysAndValue, keysAndValueLength);
@@ -797,25 +966,123 @@ Object::computeChecksum()
  * its checksum.
  * \param object
  *      Pointer to the beginning of the object. This object contains the
- *      header and keysAndValue
+ *      header (in either format) and keysAndValue
  * \param totalLength
  *      Total length of the object in bytes, including the header, keys
  *      and value
  */
 uint32_t
-Object::computeChecksum(const Object::Header* object,
-                        uint32_t totalLength)
+Object::computeChecksum(const void* object, uint32_t totalLength)
 {
-    Crc32C crc;
-    crc.update(reinterpret_cast<const void *>(
-               reinterpret_cast<const uint8_t *>(
-               object) + sizeof(header.checksum)),
-               downCast<uint32_t>(sizeof(header) -
-               sizeof(header.checksum)));
+    Object parsed(object, totalLength);
+    return parsed.computeChecksum();
+}
 
-    uint32_t len = totalLength - sizeof32(Header);
-    crc.update(&object->keysAndData[0], len);
-    return crc.getResult();
+/**
+ * Fill in #header, #compact and #expiryTime from a serialized object header.
+ *
+ * \param serialized
+ *      First byte of the serialized object.
+ * \param length
+ *      Number of bytes available at serialized.
+ * \return
+ *      The number of bytes occupied by the header. If the header is
+ *      truncated, this is length (the checksum will then fail to match).
+ */
+uint32_t
+Object::parseHeader(const void* serialized, uint32_t length)
+{
+    const uint8_t* src = static_cast<const uint8_t*>(serialized);
+    uint32_t fixedLength = sizeof32(header.checksum) +
+                           sizeof32(header.timestamp);
+    if (length < fixedLength)
+        return length;
+
+    uint32_t timestamp;
+    memcpy(&timestamp, src + sizeof(header.checksum), sizeof(timestamp));
+    if ((timestamp & COMPACT_FLAG) == 0) {
+        if (length < sizeof32(header))
+            return length;
+        memcpy(&header, src, sizeof(header));
+        compact = false;
+        expiryTime = 0;
+        return sizeof32(header);
+    }
+
+    memcpy(&header, src, sizeof(header.checksum));
+    header.timestamp = timestamp & ~(COMPACT_FLAG | EXPIRES_FLAG);
+    compact = true;
+    uint32_t offset = fixedLength;
+    uint64_t version, tableId;
+    if (!readVarint(src, length, &offset, &version) ||
+            !readVarint(src, length, &offset, &tableId))
+        return length;
+    header.version = version;
+    header.tableId = tableId;
+    expiryTime = 0;
+    if (timestamp & EXPIRES_FLAG) {
+        if (length - offset < sizeof32(expiryTime))
+            return length;
+        memcpy(&expiryTime, src + offset, sizeof(expiryTime));
+        offset += sizeof32(expiryTime);
+    }
+    return offset;
+}
+
+/**
+ * Fill in #header, #compact, #keysAndValueOffset and #keysAndValueLength
+ * from an object stored in a Buffer.
+ *
+ * \param buffer
+ *      Buffer containing the serialized object.
+ * \param offset
+ *      Offset of the object's first byte in buffer.
+ * \param length
+ *      Total length of the object in bytes.
+ */
+void
+Object::parseHeader(Buffer& buffer, uint32_t offset, uint32_t length)
+{
+    // Both formats fit in MAX_HEADER_LENGTH bytes.
+    uint8_t serialized[MAX_HEADER_LENGTH];
+    uint32_t available = buffer.copy(offset,
+            std::min(length, MAX_HEADER_LENGTH), serialized);
+    uint32_t headerLength = parseHeader(serialized, available);
+    keysAndValueOffset = offset + headerLength;
+    keysAndValueLength = length - headerLength;
+}
+
+/**
+ * Write the header of this object, in the format selected by #compact.
+ *
+ * \param target
+ *      The header is written here; there must be room for at least
+ *      getHeaderLength() bytes.
+ * \return
+ *      The number of bytes written (see getHeaderLength).
+ */
+uint32_t
+Object::serializeHeader(void* target)
+{
+    uint8_t* dst = static_cast<uint8_t*>(target);
+    if (!compact) {
+        memcpy(dst, &header, sizeof(header));
+        return sizeof32(header);
+    }
+
+    uint32_t timestamp = header.timestamp | COMPACT_FLAG;
+    if (expiryTime != 0)
+        timestamp |= EXPIRES_FLAG;
+    memcpy(dst, &header, sizeof(header.checksum));
+    memcpy(dst + sizeof(header.checksum), &timestamp, sizeof(timestamp));
+    uint32_t offset = sizeof32(header.checksum) + sizeof32(timestamp);
+    offset += writeVarint(header.version, dst + offset);
+    offset += writeVarint(header.tableId, dst + offset);
+    if (expiryTime != 0) {
+        memcpy(dst + offset, &expiryTime, sizeof(expiryTime));
+        offset += sizeof32(expiryTime);
+    }
+    return offset;
 }
 
 /**
@@ -78,6 +78,31 @@ struct KeyOffsets
  *
  * If Key_i is not present, CumulativeKeyLength_i = CumulativeKeyLength_i-1.
  * Consequently, Length_i = 0
+ *
+ * For small objects the 24-byte header is a large fraction of the space an
+ * object occupies in the log, so objects may instead be written with a
+ * compact header (see setCompact):
+ *
+ * +----------+-----------------------+-------------+-------------+---------+
+ * | Checksum | Timestamp | COMPACT   | Version     | Table Id    | keysAnd |
+ * | 4 bytes  | 31 bits   | 1 bit     | 1-10 bytes  | 1-10 bytes  | Value   |
+ * +----------+-----------------------+-------------+-------------+---------+
+ *
+ * The version and table id are varints (7 bits per byte, least significant
+ * group first). The top bit of the timestamp word distinguishes the two
+ * formats: WallTime timestamps count seconds from 2011, so they stay below
+ * 2^31 for decades and never set that bit in a full header. Both formats
+ * are stored as LOG_ENTRY_TYPE_OBJ and every constructor that deserializes
+ * an object accepts either, so code that reads objects from the log (reads,
+ * cleaning, recovery, migration) doesn't need to know which one was used.
+ * The checksum covers the same fields in both formats.
+ *
+ * An object may also have an expiry time (see setExpiryTime), after which
+ * masters treat it as deleted. Only the compact header can hold one: the
+ * second-highest bit of its timestamp word (EXPIRES_FLAG) indicates that a
+ * 4-byte expiry time, in WallTime seconds, follows the table id. This
+ * limits compact timestamps to 30 bits, which lasts until 2045; objects
+ * with later timestamps fall back to the full header and never expire.
  */
 class Object {
   public:
@@ -123,9 +148,15 @@ class Object {
     uint32_t getKeysAndValueLength();
     uint64_t getVersion();
     uint32_t getTimestamp();
+    uint32_t getExpiryTime();
+    uint32_t getHeaderLength();
     uint32_t getSerializedLength();
+    bool isCompact();
+    bool isExpired(uint32_t now);
 
     bool checkIntegrity();
+    void setCompact(bool compact);
+    void setExpiryTime(uint32_t expiryTime);
     void setVersion(uint64_t version);
     void setTimestamp(uint32_t timestamp);
 
@@ -182,15 +213,41 @@ class Object {
         "Unexpected serialized Object size");
 
 
-    static uint32_t computeChecksum(const Object::Header* object,
+    /// Set in the timestamp word of a compact header; see the class
+    /// documentation.
+    static const uint32_t COMPACT_FLAG = 0x80000000;
+
+    /// Set in the timestamp word of a compact header that is followed by
+    /// an expiry time; see the class documentation.
+    static const uint32_t EXPIRES_FLAG = 0x40000000;
+
+    /// Largest number of bytes a header can occupy in either format: for
+    /// the compact one, checksum, timestamp, two 64-bit varints and an
+    /// expiry time.
+    static const uint32_t MAX_HEADER_LENGTH = 32;
+
+    static uint32_t computeChecksum(const void* object,
                                     uint32_t totalLength);
     uint32_t computeChecksum();
     void applyChecksum(Crc32C *crc);
+    uint32_t parseHeader(const void* serialized, uint32_t length);
+    void parseHeader(Buffer& buffer, uint32_t offset, uint32_t length);
+    uint32_t serializeHeader(void* target);
 
 
     /// Copy of the object header that is in, or will be written to, the log.
+    /// For objects in the compact format this holds the decoded fields
+    /// (without COMPACT_FLAG in the timestamp).
     Header header;
 
+    /// True means the object is stored in the log (or will be written to
+    /// it) with a compact header.
+    bool compact;
+
+    /// WallTime (in seconds) at which the object expires, or 0 if it never
+    /// does. Not part of Header, since only the compact format stores it.
+    uint32_t expiryTime;
+
     /// Length that includes the number of keys, the key lengths, the keys
     /// and the value. This isn't stored in Header since it can be computed
     /// as needed.
@@ -25,6 +25,12 @@ namespace RAMCloud {
  * The implementation of ObjectFinder::TableConfigFetcher that is used for
  * normal execution. This class is not thread-safe; requests to the class
  * must be serialized externally.
+ *
+ * The fetcher keeps a copy of the most recent configuration it received for
+ * each table. When it fetches a table again (typically because a tablet
+ * moved), it tells the coordinator which version it has, and the coordinator
+ * only sends the tablets that have changed since then; the fetcher merges
+ * them into its copy.
  */
 class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
   public:
@@ -32,6 +38,7 @@ class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
         : context(context)
         , getTableConfigRpc()
         , tableId()
+        , configs()
     {}
 
     /**
@@ -72,21 +79,25 @@ class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
                                     IndexletWithLocator>* tableIndexMap)
     {
         if (!getTableConfigRpc) {
-            tableId = requestedTableId;
-            getTableConfigRpc.construct(context, requestedTableId);
+            startRpc(requestedTableId);
         }
 
         if (!getTableConfigRpc->isReady()) {
             return false;
         }
 
-        ProtoBuf::TableConfig tableConfig;
+        ProtoBuf::TableConfig response;
+        uint64_t epoch, version;
+        bool delta;
         try {
-            getTableConfigRpc->wait(&tableConfig);
+            delta = getTableConfigRpc->wait(&response, &epoch, &version);
         } catch (TableDoesntExistException& e) {
+            configs.erase(*tableId);
             clear();
             throw e;
         }
+        const ProtoBuf::TableConfig& tableConfig =
+                update(*tableId, &response, delta, epoch, version);
 
         for (const ProtoBuf::TableConfig::Tablet& tablet :
                 tableConfig.tablet()) {
@@ -127,13 +138,105 @@ class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
         } else {
             // The RPC processed above isn't the one we want; initiate a new
             // RPC for the table we currently request.
-            tableId = requestedTableId;
-            getTableConfigRpc.construct(context, requestedTableId);
+            startRpc(requestedTableId);
             return false;
         }
     }
 
   private:
+    /**
+     * The most recent configuration received for a table.
+     */
+    struct CachedConfig {
+        CachedConfig()
+            : epoch(0)
+            , version(0)
+            , config()
+        {}
+
+        /// Epoch and version of #config, from the coordinator.
+        uint64_t epoch;
+        uint64_t version;
+
+        /// The complete configuration of the table.
+        ProtoBuf::TableConfig config;
+    };
+
+    /**
+     * Initiate an RPC to fetch a table's configuration, asking only for
+     * the changes since the version we already have, if any.
+     *
+     * \param requestedTableId
+     *      The id of the table whose configuration is to be fetched.
+     */
+    void
+    startRpc(uint64_t requestedTableId)
+    {
+        uint64_t epoch = 0, version = 0;
+        ConfigMap::iterator it = configs.find(requestedTableId);
+        if (it != configs.end()) {
+            epoch = it->second.epoch;
+            version = it->second.version;
+        }
+        tableId = requestedTableId;
+        getTableConfigRpc.construct(context, requestedTableId, epoch,
+                version);
+    }
+
+    /**
+     * Incorporate a response from the coordinator into our copy of a
+     * table's configuration.
+     *
+     * \param id
+     *      The table that \a response describes.
+     * \param response
+     *      Configuration returned by the coordinator; its contents may be
+     *      moved elsewhere.
+     * \param delta
+     *      True means \a response only contains the changes since the
+     *      version we already have.
+     * \param epoch
+     *      Epoch of the configuration in \a response.
+     * \param version
+     *      Version of the configuration in \a response.
+     * \return
+     *      The complete, up-to-date configuration of the table.
+     */
+    const ProtoBuf::TableConfig&
+    update(uint64_t id, ProtoBuf::TableConfig* response, bool delta,
+            uint64_t epoch, uint64_t version)
+    {
+        if (epoch == 0) {
+            // The table doesn't exist.
+            configs.erase(id);
+            return *response;
+        }
+
+        CachedConfig& cached = configs[id];
+        if (!delta) {
+            cached.config.Swap(response);
+        } else {
+            // Tablets are identified by their start key hashes.
+            std::map<uint64_t, ProtoBuf::TableConfig::Tablet> tablets;
+            for (const ProtoBuf::TableConfig::Tablet& tablet :
+                    cached.config.tablet()) {
+                tablets[tablet.start_key_hash()] = tablet;
+            }
+            for (uint64_t startKeyHash : response->removed_start_key_hash())
+                tablets.erase(startKeyHash);
+            for (const ProtoBuf::TableConfig::Tablet& tablet :
+                    response->tablet()) {
+                tablets[tablet.start_key_hash()] = tablet;
+            }
+            cached.config.clear_tablet();
+            for (auto& entry : tablets)
+                cached.config.add_tablet()->Swap(&entry.second);
+        }
+        cached.epoch = epoch;
+        cached.version = version;
+        return cached.config;
+    }
+
     Context* const context;
 
     /// The outstanding RPC currently cached by this table config fetcher.
@@ -144,6 +247,10 @@ class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
     /// outstanding RPC.
     Tub<uint64_t> tableId;
 
+    /// Our copy of each table's configuration, indexed by table id.
+    typedef std::unordered_map<uint64_t, CachedConfig> ConfigMap;
+    ConfigMap configs;
+
     DISALLOW_COPY_AND_ASSIGN(RealTableConfigFetcher);
 };
 
@@ -158,6 +265,8 @@ ObjectFinder::ObjectFinder(Context* context)
     , tableConfigFetcher(new RealTableConfigFetcher(context))
     , tableIndexMap()
     , tableMap()
+    , hotReplicaMap()
+    , anyHotReplicas(false)
 {
 }
 
@@ -205,6 +314,24 @@ ObjectFinder::flush(uint64_t tableId)
     flushImpl(guard, tableId);
 }
 
+/**
+ * Forget about any read-only copies of a hot object on other masters (see
+ * setHotReplicas). This method is invoked when a replica doesn't have a
+ * usable copy; later reads will go to the object's owner.
+ *
+ * \param tableId
+ *      The table containing the object.
+ * \param keyHash
+ *      Key hash of the object.
+ */
+void
+ObjectFinder::flushHotReplicas(uint64_t tableId, KeyHash keyHash)
+{
+    SpinLock::Guard _(mutex);
+    hotReplicaMap.erase(TabletKey{tableId, keyHash});
+    anyHotReplicas = !hotReplicaMap.empty();
+}
+
 /**
  * Delete the session connecting to the master that owns a particular
  * object, if such a session exists. This method is typically invoked after
@@ -284,6 +411,11 @@ ObjectFinder::flushImpl(const SpinLock::Guard& guard, uint64_t tableId)
     IndexletIter indexUpper = tableIndexMap.upper_bound(
             std::make_pair(tableId, std::numeric_limits<uint8_t>::max()));
     tableIndexMap.erase(indexLower, indexUpper);
+
+    HotReplicaIter hotLower = hotReplicaMap.lower_bound(start);
+    HotReplicaIter hotUpper = hotReplicaMap.upper_bound(end);
+    hotReplicaMap.erase(hotLower, hotUpper);
+    anyHotReplicas = !hotReplicaMap.empty();
 }
 
 /**
@@ -378,6 +510,46 @@ ObjectFinder::lookupTablet(uint64_t tableId, KeyHash keyHash)
     }
 }
 
+/**
+ * Choose where to send a read of a hot object: its owner, or one of the
+ * masters holding read-only copies of it (see setHotReplicas). The choice
+ * is random, so that the reads of all clients are spread evenly.
+ *
+ * \param tableId
+ *      The table containing the object.
+ * \param keyHash
+ *      Key hash of the object.
+ * \return
+ *      Session for communication with a master holding a copy of the
+ *      object. NULL means the read should go to the owner as usual (either
+ *      because the owner was chosen, or because no copies are known).
+ */
+Transport::SessionRef
+ObjectFinder::lookupHotReplica(uint64_t tableId, KeyHash keyHash)
+{
+    if (!anyHotReplicas)
+        return Transport::SessionRef();
+
+    string locator;
+    {
+        SpinLock::Guard _(mutex);
+        HotReplicaIter it = hotReplicaMap.find(TabletKey{tableId, keyHash});
+        if (it == hotReplicaMap.end())
+            return Transport::SessionRef();
+        HotReplicaSet& replicas = it->second;
+        if (Cycles::rdtsc() > replicas.expiration) {
+            hotReplicaMap.erase(it);
+            anyHotReplicas = !hotReplicaMap.empty();
+            return Transport::SessionRef();
+        }
+        size_t choice = generateRandom() % (replicas.locators.size() + 1);
+        if (choice == replicas.locators.size())
+            return Transport::SessionRef();
+        locator = replicas.locators[choice];
+    }
+    return context->transportManager->getSession(locator);
+}
+
 /**
  * Lookup the master for a particular indexlet in the local cache of
  * configuration information.
@@ -466,9 +638,36 @@ void ObjectFinder::reset()
     SpinLock::Guard _(mutex);
     tableMap.clear();
     tableIndexMap.clear();
+    hotReplicaMap.clear();
+    anyHotReplicas = false;
     tableConfigFetcher->clear();
 }
 
+/**
+ * Record that other masters hold read-only copies of a hot object, so that
+ * lookupHotReplica can spread reads of the object across them. This
+ * information comes from the object's owner, in read responses, and is
+ * used for HOT_REPLICA_HINT_MS.
+ *
+ * \param tableId
+ *      The table containing the object.
+ * \param keyHash
+ *      Key hash of the object.
+ * \param locators
+ *      Service locators of the masters holding copies.
+ */
+void
+ObjectFinder::setHotReplicas(uint64_t tableId, KeyHash keyHash,
+        const vector<string>& locators)
+{
+    SpinLock::Guard _(mutex);
+    HotReplicaSet& replicas = hotReplicaMap[TabletKey{tableId, keyHash}];
+    replicas.locators = locators;
+    replicas.expiration = Cycles::rdtsc() +
+            Cycles::fromMicroseconds(HOT_REPLICA_HINT_MS * 1000);
+    anyHotReplicas = true;
+}
+
 /**
  * Find information about the tablet containing a key in a given table.
  *
@@ -17,6 +17,7 @@
 #define RAMCLOUD_OBJECTFINDER_H
 
 #include <boost/function.hpp>
+#include <atomic>
 #include <map>
 
 #include "Common.h"
@@ -128,6 +129,7 @@ class ObjectFinder {
     string debugString() const;
 
     void flush(uint64_t tableId);
+    void flushHotReplicas(uint64_t tableId, KeyHash keyHash);
     void flushSession(uint64_t tableId, KeyHash keyHash);
     void flushSession(uint64_t tableId, uint8_t indexId,
                       const void* key, KeyLength keyLength);
@@ -135,10 +137,13 @@ class ObjectFinder {
     Transport::SessionRef lookup(uint64_t tableId, const void* key,
                                  KeyLength keyLength);
     Transport::SessionRef lookup(uint64_t tableId, KeyHash keyHash);
+    Transport::SessionRef lookupHotReplica(uint64_t tableId, KeyHash keyHash);
 
     TabletWithLocator* lookupTablet(uint64_t tableId, KeyHash keyHash);
 
     void reset();
+    void setHotReplicas(uint64_t tableId, KeyHash keyHash,
+                        const vector<string>& locators);
 
     Transport::SessionRef tryLookup(uint64_t tableId, const void* key,
                                     KeyLength keyLength);
@@ -150,7 +155,28 @@ class ObjectFinder {
     void waitForTabletDown(uint64_t tableId);
     void waitForAllTabletsNormal(uint64_t tableId, uint64_t timeoutNs = ~0lu);
 
+    /// How long to keep using the replicas named in a read response (see
+    /// setHotReplicas) without hearing about them again from the owner.
+    static const uint32_t HOT_REPLICA_HINT_MS = 100;
+
   PRIVATE:
+    /**
+     * Masters holding read-only copies of a hot object (see HotKeyReplicas).
+     */
+    struct HotReplicaSet {
+        HotReplicaSet()
+            : locators()
+            , expiration(0)
+        {}
+
+        /// Service locators of the masters holding copies.
+        vector<string> locators;
+
+        /// Cycles::rdtsc() time after which this information should no
+        /// longer be used.
+        uint64_t expiration;
+    };
+
     void flushImpl(const SpinLock::Guard& guard, uint64_t tableId);
 
     IndexletWithLocator* lookupIndexletInCache(const SpinLock::Guard& guard,
@@ -174,7 +200,7 @@ class ObjectFinder {
     Context* const context;
 
     /**
-     * Lock protecting tableMap and tableIndexMap.
+     * Lock protecting tableMap, tableIndexMap, and hotReplicaMap.
      */
     mutable SpinLock mutex;
 
@@ -205,6 +231,20 @@ class ObjectFinder {
     std::map<TabletKey, TabletWithLocator> tableMap;
     typedef std::map<TabletKey, TabletWithLocator>::iterator TabletIter;
 
+    /**
+     * Hot objects (identified by table and exact key hash) for which reads
+     * may be sent to other masters besides the owner; filled in from read
+     * responses.
+     */
+    std::map<TabletKey, HotReplicaSet> hotReplicaMap;
+    typedef std::map<TabletKey, HotReplicaSet>::iterator HotReplicaIter;
+
+    /**
+     * Mirrors !hotReplicaMap.empty(), so that lookupHotReplica needn't
+     * acquire the lock in the common case.
+     */
+    std::atomic<bool> anyHotReplicas;
+
     DISALLOW_COPY_AND_ASSIGN(ObjectFinder);
 };
 
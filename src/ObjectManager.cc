@@ -14,20 +14,25 @@
  */
 
 #include "Buffer.h"
+#include "CompressedObject.h"
 #include "Cycles.h"
 #include "Dispatch.h"
 #include "Enumeration.h"
 #include "EnumerationIterator.h"
 #include "IndexletManager.h"
 #include "LogEntryRelocator.h"
+#include "Numa.h"
 #include "ObjectManager.h"
 #include "Object.h"
 #include "PerfStats.h"
 #include "ShortMacros.h"
+#include "StringUtil.h"
 #include "RawMetrics.h"
+#include "RpcTrace.h"
 #include "Tub.h"
 #include "ProtoBuf.h"
 #include "Segment.h"
+#include "TabletPuller.h"
 #include "TimeTrace.h"
 #include "Transport.h"
 #include "UnackedRpcResults.h"
@@ -67,6 +72,14 @@ namespace RAMCloud {
  *      Pointer to the master's TxRecoveryManager instance.  This keeps track
  *      of ongoing transaction recoveries; these recoveries may need records
  *      stored in the log.
+ * \param hotKeyReplicas
+ *      Pointer to the master's HotKeyReplicas instance, which must be told
+ *      before any object is modified. NULL means there are no copies of
+ *      objects to invalidate.
+ * \param tabletPuller
+ *      Pointer to the master's TabletPuller instance, which must be asked
+ *      for the objects of a key before the key is looked up. NULL means no
+ *      tablets are ever pulled from other masters.
  */
 ObjectManager::ObjectManager(Context* context, ServerId* serverId,
                 const ServerConfig* config,
@@ -74,7 +87,9 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
                 MasterTableMetadata* masterTableMetadata,
                 UnackedRpcResults* unackedRpcResults,
                 TransactionManager* transactionManager,
-                TxRecoveryManager* txRecoveryManager)
+                TxRecoveryManager* txRecoveryManager,
+                HotKeyReplicas* hotKeyReplicas,
+                TabletPuller* tabletPuller)
     : context(context)
     , config(config)
     , tabletManager(tabletManager)
@@ -82,6 +97,8 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
     , unackedRpcResults(unackedRpcResults)
     , transactionManager(transactionManager)
     , txRecoveryManager(txRecoveryManager)
+    , hotKeyReplicas(hotKeyReplicas)
+    , tabletPuller(tabletPuller)
     , allocator(config)
     , replicaManager(context, serverId,
                      config->master.numReplicas,
@@ -91,6 +108,8 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
                      allocator, replicaManager, masterTableMetadata)
     , log(context, config, this, &segmentManager, &replicaManager)
     , objectMap(config->master.hashTableBytes / HashTable::bytesPerCacheLine())
+    , cacheTables()
+    , recentlyUsed()
     , anyWrites(false)
     , hashTableBucketLocks()
     , lockTable(1000, log)
@@ -100,6 +119,19 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
 {
     for (size_t i = 0; i < arrayLength(hashTableBucketLocks); i++)
         hashTableBucketLocks[i].setName("hashTableBucketLock");
+
+    foreach (const string& table,
+            StringUtil::split(config->master.cacheTables, ',')) {
+        bool error;
+        int64_t tableId = StringUtil::stringToInt(table.c_str(), &error);
+        if (error || tableId < 0)
+            DIE("Bad table id '%s' in cacheTables", table.c_str());
+        cacheTables.insert(tableId);
+    }
+    if (!cacheTables.empty())
+        recentlyUsed.resize(objectMap.getNumBuckets());
+    if (config->master.numaAware && allocator.getNumNumaNodes() > 1)
+        objectMap.interleaveAcrossNumaNodes();
 }
 
 /**
@@ -205,6 +237,7 @@ ObjectManager::readHashes(const uint64_t tableId, uint32_t reqNumHashes,
         // doing the work here directly, since the abstraction breaks down
         // as multiple objects having the same primary key hash may match
         // the index key range.
+        ensurePulled(tableId, pKHash);
         objectMap.prefetchBucket(pKHash);
         HashTableBucketLock lock(*this, pKHash); // unlocks self on destruct
 
@@ -228,13 +261,28 @@ ObjectManager::readHashes(const uint64_t tableId, uint32_t reqNumHashes,
             Log::Reference candidateRef(candidates.getReference());
             LogEntryType type = log.getEntry(candidateRef, candidateBuffer);
 
-            if (type != LOG_ENTRY_TYPE_OBJ)
+            Buffer decompressedBuffer;
+            Buffer* objectBuffer = &candidateBuffer;
+            if (type == LOG_ENTRY_TYPE_OBJCOMP) {
+                CompressedObject::decompress(candidateBuffer,
+                        &decompressedBuffer);
+                objectBuffer = &decompressedBuffer;
+            } else if (type != LOG_ENTRY_TYPE_OBJ) {
                 continue;
+            }
 
-            Object object(candidateBuffer);
+            Object object(*objectBuffer);
+            if (object.isExpired(WallTime::secondsTimestamp()))
+                continue;
 
             // Candidate may have only partially matching primary key hash.
             if (object.getPKHash() == pKHash) {
+                Key key(object.getTableId(), object.getKey(),
+                        object.getKeyLength());
+                if (hotKeyReplicas != NULL &&
+                        hotKeyReplicas->isInvalidating(key))
+                    throw RetryException(HERE, 100, 200,
+                            "Copies of hot object are being invalidated");
                 *numObjects += 1;
                 response->emplaceAppend<uint64_t>(object.getVersion());
                 response->emplaceAppend<uint32_t>(
@@ -276,15 +324,15 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
     if (expect_false(it->isDone()))
         return;
 
-    if (expect_true(it->getType() == LOG_ENTRY_TYPE_OBJ)) {
-        const Object::Header* obj =
-            it->getContiguous<Object::Header>(NULL, 0);
+    if (expect_true(it->getType() == LOG_ENTRY_TYPE_OBJ ||
+            it->getType() == LOG_ENTRY_TYPE_OBJCOMP)) {
+        const void* obj = it->getContiguous<void>(NULL, 0);
 
         Object prefetchObj(obj, it->getLength());
         KeyLength primaryKeyLen = 0;
         const void *primaryKey = prefetchObj.getKey(0, &primaryKeyLen);
 
-        Key key(obj->tableId, primaryKey, primaryKeyLen);
+        Key key(prefetchObj.getTableId(), primaryKey, primaryKeyLen);
         objectMap.prefetchBucket(key.getHash());
     } else if (it->getType() == LOG_ENTRY_TYPE_OBJTOMB) {
         const ObjectTombstone::Header* tomb =
@@ -295,6 +343,74 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
     }
 }
 
+/**
+ * Copy the objects of a tablet (or a key hash range of one) that are
+ * referenced from a range of hash table buckets into a segment. This is the
+ * source side of a pull-based migration (see TabletPuller): because it walks
+ * the hash table rather than the log, only live objects are copied, and
+ * disjoint bucket ranges can be pulled in parallel. Each bucket is copied in
+ * its entirety or not at all, so the caller can resume from the returned
+ * bucket without duplicating or missing objects.
+ *
+ * The segment starts with this master's safe version, so that the new owner
+ * never assigns a version number that was used here for an object that has
+ * since been deleted.
+ *
+ * \param tableId
+ *      Table whose objects should be copied.
+ * \param firstKeyHash
+ *      Lowest key hash of the objects to copy.
+ * \param lastKeyHash
+ *      Highest key hash of the objects to copy.
+ * \param firstBucket
+ *      Index of the first hash table bucket to scan.
+ * \param endBucket
+ *      Index just past the last hash table bucket to scan. Values beyond
+ *      the size of the hash table are clipped.
+ * \param[out] segment
+ *      Empty segment to append the copied entries to.
+ * \return
+ *      The index of the first bucket that was not copied because the segment
+ *      filled up, or endBucket (clipped) if the whole range was copied.
+ */
+uint64_t
+ObjectManager::pullTabletData(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash, uint64_t firstBucket, uint64_t endBucket,
+        Segment* segment)
+{
+    endBucket = std::min(endBucket, objectMap.getNumBuckets());
+
+    Buffer safeVersionBuffer;
+    ObjectSafeVersion safeVersion(segmentManager.allocateVersion());
+    safeVersion.assembleForLog(safeVersionBuffer);
+    segment->append(LOG_ENTRY_TYPE_SAFEVERSION, safeVersionBuffer);
+
+    uint64_t bucket;
+    for (bucket = firstBucket; bucket < endBucket; bucket++) {
+        HashTableBucketLock lock(*this, bucket);
+        PullParameters params(this, tableId, firstKeyHash, lastKeyHash);
+        objectMap.forEachInBucket(pullCandidate, &params, bucket);
+        if (params.references.empty())
+            continue;
+
+        size_t numEntries = params.references.size();
+        std::unique_ptr<Buffer[]> buffers(new Buffer[numEntries]);
+        vector<LogEntryType> types(numEntries);
+        vector<uint32_t> lengths(numEntries);
+        for (size_t i = 0; i < numEntries; i++) {
+            types[i] = log.getEntry(params.references[i], buffers[i]);
+            lengths[i] = buffers[i].size();
+        }
+        if (!segment->hasSpaceFor(&lengths[0],
+                downCast<uint32_t>(numEntries)))
+            break;
+        for (size_t i = 0; i < numEntries; i++)
+            segment->append(types[i], buffers[i]);
+    }
+
+    return bucket;
+}
+
 /**
  * Read an object previously written to this ObjectManager.
  *
@@ -316,12 +432,18 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
  *      Returns STATUS_OK if the lookup succeeded and the reject rules did not
  *      preclude this read. Other status values indicate different failures
  *      (object not found, tablet doesn't exist, reject rules applied, etc).
+ * \throw RetryException
+ *      The object was just modified, and stale copies of it on other masters
+ *      haven't all been dropped yet (see HotKeyReplicas::isInvalidating), or
+ *      it couldn't be pulled from its tablet's old owner yet (see
+ *      TabletPuller::ensurePulled).
  */
 Status
 ObjectManager::readObject(Key& key, Buffer* outBuffer,
                 RejectRules* rejectRules, uint64_t* outVersion,
                 bool valueOnly)
 {
+    ensurePulled(key.getTableId(), key.getHash());
     objectMap.prefetchBucket(key.getHash());
     HashTableBucketLock lock(*this, key);
 
@@ -329,12 +451,21 @@ ObjectManager::readObject(Key& key, Buffer* outBuffer,
     if (!tabletManager->checkAndIncrementReadCount(key))
         return STATUS_UNKNOWN_TABLET;
 
+    // Don't reveal a modification until stale copies of the object on
+    // other masters have been dropped.
+    if (hotKeyReplicas != NULL && hotKeyReplicas->isInvalidating(key))
+        throw RetryException(HERE, 100, 200,
+                "Copies of hot object are being invalidated");
+
     Buffer buffer;
     LogEntryType type;
     uint64_t version;
     Log::Reference reference;
-    bool found = lookup(lock, key, type, buffer, &version, &reference);
-    if (!found || type != LOG_ENTRY_TYPE_OBJ)
+    HashTable::Candidates candidates;
+    bool compressed = false;
+    bool found = lookup(lock, key, type, buffer, &version, &reference,
+            &candidates, &compressed);
+    if (!found || type != LOG_ENTRY_TYPE_OBJ || isExpiredObject(buffer))
         return STATUS_OBJECT_DOESNT_EXIST;
 
     if (outVersion != NULL)
@@ -349,6 +480,22 @@ ObjectManager::readObject(Key& key, Buffer* outBuffer,
     // Ensure the object being read is replicated durably.
     log.syncTo(reference);
 
+    // Use the log reference rather than the buffer: compressed objects have
+    // been decompressed into memory owned by the buffer.
+    if (allocator.getNumNumaNodes() > 1) {
+        const void* entry = reinterpret_cast<const void*>(
+                reference.toInteger());
+        if (allocator.getNumaNode(entry) == Numa::getCurrentNode()) {
+            ++PerfStats::threadStats.numaLocalReads;
+        } else {
+            ++PerfStats::threadStats.numaRemoteReads;
+        }
+    }
+
+    if (compressed)
+        promoteCompressedObject(key, buffer, reference, candidates);
+    markRecentlyUsed(key);
+
     Object object(buffer);
     if (valueOnly) {
         object.appendValueToBuffer(outBuffer);
@@ -402,6 +549,9 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
                 uint64_t* outVersion, Buffer* removedObjBuffer,
                 RpcResult* rpcResult, uint64_t* rpcResultPtr)
 {
+    ensurePulled(key.getTableId(), key.getHash());
+    // Declared before the lock so that copies are dropped after it is released.
+    HotKeyReplicas::Invalidation invalidation;
     HashTableBucketLock lock(*this, key);
 
     // If the tablet doesn't exist in the NORMAL state, we must plead ignorance.
@@ -420,6 +570,10 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
         return STATUS_RETRY;
     }
 
+    // Copies of the object on other masters are about to become stale.
+    if (hotKeyReplicas != NULL)
+        hotKeyReplicas->invalidate(key, &invalidation);
+
     LogEntryType type;
     Buffer buffer;
     Log::Reference reference;
@@ -431,13 +585,17 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
         return rejectOperation(rejectRules, VERSION_NONEXISTENT);
     }
 
+    // An expired object looks deleted to the client, but it is still
+    // removed (with a tombstone) so it can't be found again.
     Object object(buffer);
+    uint64_t visibleVersion = object.isExpired(WallTime::secondsTimestamp())
+            ? VERSION_NONEXISTENT : object.getVersion();
     if (outVersion != NULL)
-        *outVersion = object.getVersion();
+        *outVersion = visibleVersion;
 
     // Abort if we're trying to delete the wrong version.
     if (rejectRules != NULL) {
-        Status status = rejectOperation(rejectRules, object.getVersion());
+        Status status = rejectOperation(rejectRules, visibleVersion);
         if (status != STATUS_OK)
             return status;
     }
@@ -478,6 +636,7 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
 
     TableStats::increment(masterTableMetadata,
                           tablet.tableId,
+                          key.getHash(),
                           appends[0].buffer.size() + appends[1].buffer.size(),
                           rpcResult ? 2 : 1);
     segmentManager.raiseSafeVersion(object.getVersion() + 1);
@@ -625,24 +784,25 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
         recoverySegmentEntryCount++;
         recoverySegmentEntryBytes += it.getLength();
 
-        if (expect_true(type == LOG_ENTRY_TYPE_OBJ)) {
+        if (expect_true(type == LOG_ENTRY_TYPE_OBJ ||
+                type == LOG_ENTRY_TYPE_OBJCOMP)) {
             // The recovery segment is guaranteed to be contiguous, so we need
-            // not provide a copyout buffer.
+            // not provide a copyout buffer. Compressed objects are replayed
+            // as they are; their keys and metadata aren't compressed.
 
-            const Object::Header* recoveryObj =
-                it.getContiguous<Object::Header>(NULL, 0);
+            const void* recoveryObj = it.getContiguous<void>(NULL, 0);
 
             Object replayObj(recoveryObj, it.getLength());
             KeyLength primaryKeyLen = 0;
             const void *primaryKey = replayObj.getKey(0, &primaryKeyLen);
 
-            Key key(recoveryObj->tableId, primaryKey, primaryKeyLen);
+            Key key(replayObj.getTableId(), primaryKey, primaryKeyLen);
 
             // If table is an BTree table,i.e., tableId exists in
             // nextNodeIdMap, update nextNodeId of its table.
             if (nextNodeIdMap) {
                 std::unordered_map<uint64_t, uint64_t>::iterator iter
-                    = nextNodeIdMap->find(recoveryObj->tableId);
+                    = nextNodeIdMap->find(replayObj.getTableId());
                 if (iter != nextNodeIdMap->end()) {
                     const uint64_t *bTreeKey =
                         reinterpret_cast<const uint64_t*>(primaryKey);
@@ -654,16 +814,27 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
 
             bool checksumIsValid = ({
                 CycleCounter<uint64_t> c(&verifyChecksumTicks);
-                Object::computeChecksum(recoveryObj, it.getLength()) ==
-                    recoveryObj->checksum;
+                replayObj.checkIntegrity();
             });
             if (expect_false(!checksumIsValid)) {
                 LOG(WARNING, "bad object checksum! key: %s, version: %lu",
-                    key.toString().c_str(), recoveryObj->version);
+                    key.toString().c_str(), replayObj.getVersion());
                 // JIRA Issue: RAM-673:
                 // Should throw and try another segment replica.
             }
 
+            // Expired objects are discarded by the cleaner without
+            // tombstones, so recovery must discard them too. Any older
+            // version is covered by the tombstone written when it was
+            // overwritten. The safe version raised here reaches backups in
+            // the head segment written when the recovered data is committed
+            // to the log, before this master serves the tablet.
+            if (replayObj.isExpired(WallTime::secondsTimestamp())) {
+                segmentManager.raiseSafeVersion(replayObj.getVersion() + 1);
+                objectDiscardCount++;
+                continue;
+            }
+
             HashTableBucketLock lock(*this, key);
 
 
@@ -686,7 +857,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                 }
 
                 // Throw new object away if the hash table version is newer
-                if (recoveryObj->version <= currentVersion) {
+                if (replayObj.getVersion() <= currentVersion) {
                     objectDiscardCount++;
                     continue;
                 }
@@ -703,6 +874,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                     tombstoneAppendCount++;
                     TableStats::increment(masterTableMetadata,
                             key.getTableId(),
+                            key.getHash(),
                             tombstoneBuffer.size(),
                             1);
 
@@ -718,12 +890,13 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
             Log::Reference newObjReference;
             {
                 CycleCounter<uint64_t> _(&segmentAppendTicks);
-                sideLog->append(LOG_ENTRY_TYPE_OBJ,
+                sideLog->append(type,
                                 recoveryObj,
                                 it.getLength(),
                                 &newObjReference);
                 TableStats::increment(masterTableMetadata,
                                       key.getTableId(),
+                                      key.getHash(),
                                       it.getLength(),
                                       1);
             }
@@ -814,6 +987,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                     tombstoneAppendCount++;
                     TableStats::increment(masterTableMetadata,
                             key.getTableId(),
+                            key.getHash(),
                             tombstoneBuffer.size(),
                             1);
 
@@ -858,6 +1032,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
             tombstoneAppendCount++;
             TableStats::increment(masterTableMetadata,
                     key.getTableId(),
+                    key.getHash(),
                     buffer.size(),
                     1);
             replace(lock, key, newTombReference);
@@ -920,6 +1095,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                                     &newRpcResultReference);
                     TableStats::increment(masterTableMetadata,
                             rpcResult.getTableId(),
+                            rpcResult.getKeyHash(),
                             buffer.size(),
                             1);
                 }
@@ -993,6 +1169,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                                     &newReference);
                     TableStats::increment(masterTableMetadata,
                             key.getTableId(),
+                            key.getHash(),
                             buffer.size(),
                             1);
                 }
@@ -1035,6 +1212,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                                     &newReference);
                     TableStats::increment(masterTableMetadata,
                             opTomb.header.tableId,
+                            opTomb.header.keyHash,
                             buffer.size(),
                             1);
                 }
@@ -1066,6 +1244,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                 // TODO(cstlee) : What should we do if the append fails?
                 TableStats::increment(masterTableMetadata,
                                       record.getTableId(),
+                                      record.getKeyHash(),
                                       buffer.size(),
                                       1);
             }
@@ -1183,7 +1362,10 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     const void *keyString = newObject.getKey(0, &keyLength);
     Key key(newObject.getTableId(), keyString, keyLength);
 
+    ensurePulled(key.getTableId(), key.getHash());
     objectMap.prefetchBucket(key.getHash());
+    // Declared before the lock so that copies are dropped after it is released.
+    HotKeyReplicas::Invalidation invalidation;
     HashTableBucketLock lock(*this, key);
 
     // If the tablet doesn't exist in the NORMAL state, we must plead ignorance.
@@ -1204,10 +1386,17 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
         return STATUS_RETRY;
     }
 
+    // Copies of the object on other masters are about to become stale.
+    if (hotKeyReplicas != NULL)
+        hotKeyReplicas->invalidate(key, &invalidation);
+
     LogEntryType currentType = LOG_ENTRY_TYPE_INVALID;
     Buffer currentBuffer;
     Log::Reference currentReference;
     uint64_t currentVersion = VERSION_NONEXISTENT;
+    // Version of the current object as seen by clients: expired objects
+    // don't exist as far as they are concerned.
+    uint64_t visibleVersion = VERSION_NONEXISTENT;
 
     HashTable::Candidates currentHashTableEntry;
 
@@ -1219,6 +1408,8 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
         } else {
             Object currentObject(currentBuffer);
             currentVersion = currentObject.getVersion();
+            if (!currentObject.isExpired(WallTime::secondsTimestamp()))
+                visibleVersion = currentVersion;
             // Return a pointer to the buffer in log for the object being
             // overwritten.
             if (removedObjBuffer != NULL) {
@@ -1228,16 +1419,16 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     }
 
     if (rejectRules != NULL) {
-        Status status = rejectOperation(rejectRules, currentVersion);
+        Status status = rejectOperation(rejectRules, visibleVersion);
         if (status != STATUS_OK) {
             if (outVersion != NULL)
-                *outVersion = currentVersion;
+                *outVersion = visibleVersion;
             return status;
         }
     }
 
-    // Existing objects get a bump in version, new objects start from
-    // the next version allocated in the table.
+    // Existing objects (even expired ones) get a bump in version, new
+    // objects start from the next version allocated in the table.
     uint64_t newObjectVersion = (currentVersion == VERSION_NONEXISTENT) ?
             segmentManager.allocateVersion() : currentVersion + 1;
 
@@ -1267,6 +1458,7 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     // record should exist if and only if new object is written.
     Log::AppendVector appends[2 + (rpcResult ? 1 : 0)];
 
+    chooseObjectFormat(newObject);
     newObject.assembleForLog(appends[0].buffer);
     appends[0].type = LOG_ENTRY_TYPE_OBJ;
 
@@ -1295,6 +1487,7 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
         // that the cleaner makes space soon.
         throw RetryException(HERE, 1000, 2000, "Must wait for cleaner");
     }
+    RpcTrace::record("rpc %u: log append finished");
 
     if (tombstone) {
         currentHashTableEntry.setReference(appends[0].reference.toInteger());
@@ -1306,6 +1499,7 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     if (rpcResult && rpcResultPtr)
         *rpcResultPtr = appends[rpcResultIndex].reference.toInteger();
 
+    markRecentlyUsed(key);
     tabletManager->incrementWriteCount(key);
     ++PerfStats::threadStats.writeCount;
     uint32_t valueLength = newObject.getValueLength();
@@ -1339,6 +1533,7 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
 
         TableStats::increment(masterTableMetadata,
                               tablet.tableId,
+                              key.getHash(),
                               byteCount,
                               recordCount);
     }
@@ -1378,6 +1573,7 @@ ObjectManager::writePrepareFail(RpcResult* rpcResult, uint64_t* rpcResultPtr)
     *rpcResultPtr = av.reference.toInteger();
     TableStats::increment(masterTableMetadata,
             rpcResult->getTableId(),
+            rpcResult->getKeyHash(),
             av.buffer.size(),
             1);
 }
@@ -1410,6 +1606,7 @@ ObjectManager::writeRpcResultOnly(RpcResult* rpcResult, uint64_t* rpcResultPtr)
     *rpcResultPtr = av.reference.toInteger();
     TableStats::increment(masterTableMetadata,
             rpcResult->getTableId(),
+            rpcResult->getKeyHash(),
             av.buffer.size(),
             1);
 }
@@ -1470,6 +1667,7 @@ ObjectManager::prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
     const void *keyString = newOp.object.getKey(0, &keyLength);
     Key key(newOp.object.getTableId(), keyString, keyLength);
 
+    ensurePulled(key.getTableId(), key.getHash());
     objectMap.prefetchBucket(key.getHash());
     HashTableBucketLock lock(*this, key);
 
@@ -1583,6 +1781,7 @@ ObjectManager::prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
 
         TableStats::increment(masterTableMetadata,
                               tablet.tableId,
+                              key.getHash(),
                               byteCount,
                               recordCount);
     }
@@ -1638,6 +1837,7 @@ ObjectManager::prepareReadOnly(PreparedOp& newOp, RejectRules* rejectRules,
     const void *keyString = newOp.object.getKey(0, &keyLength);
     Key key(newOp.object.getTableId(), keyString, keyLength);
 
+    ensurePulled(key.getTableId(), key.getHash());
     objectMap.prefetchBucket(key.getHash());
     HashTableBucketLock lock(*this, key);
 
@@ -1758,6 +1958,7 @@ ObjectManager::writeTxDecisionRecord(TxDecisionRecord& record)
     TEST_LOG("tansactionDecisionRecord: %u bytes", recordBuffer.size());
     TableStats::increment(masterTableMetadata,
                           tablet.tableId,
+                          record.getKeyHash(),
                           recordBuffer.size(),
                           1);
 
@@ -1785,6 +1986,7 @@ ObjectManager::commitRead(PreparedOp& op, Log::Reference& refToPreparedOp)
     const void *keyString = op.object.getKey(0, &keyLength);
     Key key(op.object.getTableId(), keyString, keyLength);
 
+    ensurePulled(key.getTableId(), key.getHash());
     HashTableBucketLock lock(*this, key);
 
     // Skip if object is not prepared since it is already committed.
@@ -1825,6 +2027,7 @@ ObjectManager::commitRead(PreparedOp& op, Log::Reference& refToPreparedOp)
 
     TableStats::increment(masterTableMetadata,
             prepOpTombstone.header.tableId,
+            prepOpTombstone.header.keyHash,
             prepTombBuffer.size(),
             1);
     log.free(refToPreparedOp);
@@ -1856,6 +2059,9 @@ ObjectManager::commitRemove(PreparedOp& op,
     const void *keyString = op.object.getKey(0, &keyLength);
     Key key(op.object.getTableId(), keyString, keyLength);
 
+    ensurePulled(key.getTableId(), key.getHash());
+    // Declared before the lock so that copies are dropped after it is released.
+    HotKeyReplicas::Invalidation invalidation;
     HashTableBucketLock lock(*this, key);
 
     // Skip if object is not prepared since it is already committed.
@@ -1872,6 +2078,10 @@ ObjectManager::commitRemove(PreparedOp& op,
     if (tablet.state != TabletManager::NORMAL)
         return STATUS_UNKNOWN_TABLET;
 
+    // Copies of the object on other masters are about to become stale.
+    if (hotKeyReplicas != NULL)
+        hotKeyReplicas->invalidate(key, &invalidation);
+
     LogEntryType type;
     Buffer buffer;
     Log::Reference reference;
@@ -1885,7 +2095,7 @@ ObjectManager::commitRemove(PreparedOp& op,
 
     // Return a pointer to the buffer in log for the object being removed.
     if (removedObjBuffer != NULL) {
-        removedObjBuffer->appendExternal(&buffer);
+        removedObjBuffer->append(&buffer);
     }
 
     PreparedOpTombstone prepOpTombstone(op, log.getSegmentId(refToPreparedOp));
@@ -1926,6 +2136,7 @@ ObjectManager::commitRemove(PreparedOp& op,
 
         TableStats::increment(masterTableMetadata,
                               tombstone.getTableId(),
+                              key.getHash(),
                               byteCount,
                               recordCount);
     }
@@ -1963,7 +2174,10 @@ ObjectManager::commitWrite(PreparedOp& op,
     bool newKey = false;
     Key key(op.object.getTableId(), keyString, keyLength);
 
+    ensurePulled(key.getTableId(), key.getHash());
     objectMap.prefetchBucket(key.getHash());
+    // Declared before the lock so that copies are dropped after it is released.
+    HotKeyReplicas::Invalidation invalidation;
     HashTableBucketLock lock(*this, key);
 
     // Skip if object is not prepared since it is already committed.
@@ -1980,6 +2194,10 @@ ObjectManager::commitWrite(PreparedOp& op,
     if (tablet.state != TabletManager::NORMAL)
         return STATUS_UNKNOWN_TABLET;
 
+    // Copies of the object on other masters are about to become stale.
+    if (hotKeyReplicas != NULL)
+        hotKeyReplicas->invalidate(key, &invalidation);
+
     LogEntryType type;
     Buffer buffer;
     Log::Reference oldReference;
@@ -1995,7 +2213,7 @@ ObjectManager::commitWrite(PreparedOp& op,
         oldObject.construct(buffer);
         // Return a pointer to the buffer in log for the object being removed.
         if (removedObjBuffer != NULL) {
-            removedObjBuffer->appendExternal(&buffer);
+            removedObjBuffer->append(&buffer);
         }
     }
 
@@ -2017,6 +2235,7 @@ ObjectManager::commitWrite(PreparedOp& op,
     byteCount += appends[0].buffer.size();
     recordCount++;
 
+    chooseObjectFormat(op.object);
     op.object.assembleForLog(appends[1].buffer);
     appends[1].type = LOG_ENTRY_TYPE_OBJ;
     byteCount += appends[1].buffer.size();
@@ -2053,6 +2272,7 @@ ObjectManager::commitWrite(PreparedOp& op,
 
     TableStats::increment(masterTableMetadata,
                           prepOpTombstone.header.tableId,
+                          key.getHash(),
                           byteCount,
                           recordCount);
     ++PerfStats::threadStats.writeCount;
@@ -2168,6 +2388,7 @@ ObjectManager::flushEntriesToLog(Buffer *logBuffer, uint32_t& numEntries)
             tabletManager->incrementWriteCount(key);
             TableStats::increment(masterTableMetadata,
                                   tableId,
+                                  key.getHash(),
                                   entryLength, 1);
 
         } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
@@ -2200,6 +2421,7 @@ ObjectManager::flushEntriesToLog(Buffer *logBuffer, uint32_t& numEntries)
             tabletManager->incrementWriteCount(key);
             TableStats::increment(masterTableMetadata,
                                   tableId,
+                                  key.getHash(),
                                   entryLength, 1);
 
         }
@@ -2247,6 +2469,7 @@ ObjectManager::prepareForLog(Object& newObject, Buffer *logBuffer,
     const void *keyString = newObject.getKey(0, &keyLength);
     Key key(newObject.getTableId(), keyString, keyLength);
 
+    ensurePulled(key.getTableId(), key.getHash());
     objectMap.prefetchBucket(key.getHash());
     HashTableBucketLock lock(*this, key);
 
@@ -2297,6 +2520,7 @@ ObjectManager::prepareForLog(Object& newObject, Buffer *logBuffer,
                             WallTime::secondsTimestamp());
     }
 
+    chooseObjectFormat(newObject);
     Segment::appendLogHeader(LOG_ENTRY_TYPE_OBJ,
                              newObject.getSerializedLength(),
                              logBuffer);
@@ -2306,7 +2530,7 @@ ObjectManager::prepareForLog(Object& newObject, Buffer *logBuffer,
     uint32_t valueOffset = 0;
 
     newObject.getValueOffset(&valueOffset);
-    objectOffset = lengthBefore + sizeof32(Object::Header) + valueOffset;
+    objectOffset = lengthBefore + newObject.getHeaderLength() + valueOffset;
 
     void* target = logBuffer->alloc(newObject.getSerializedLength());
     newObject.assembleForLog(target);
@@ -2342,6 +2566,7 @@ ObjectManager::prepareForLog(Object& newObject, Buffer *logBuffer,
 Status
 ObjectManager::writeTombstone(Key& key, Buffer *logBuffer)
 {
+    ensurePulled(key.getTableId(), key.getHash());
     HashTableBucketLock lock(*this, key);
 
     // If the tablet doesn't exist in the NORMAL state, we must plead
@@ -2391,7 +2616,7 @@ ObjectManager::writeTombstone(Key& key, Buffer *logBuffer)
 uint32_t
 ObjectManager::getTimestamp(LogEntryType type, Buffer& buffer)
 {
-    if (type == LOG_ENTRY_TYPE_OBJ)
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJCOMP)
         return getObjectTimestamp(buffer);
     else if (type == LOG_ENTRY_TYPE_OBJTOMB)
         return getTombstoneTimestamp(buffer);
@@ -2425,8 +2650,8 @@ void
 ObjectManager::relocate(LogEntryType type, Buffer& oldBuffer,
                 Log::Reference oldReference, LogEntryRelocator& relocator)
 {
-    if (type == LOG_ENTRY_TYPE_OBJ)
-        relocateObject(oldBuffer, oldReference, relocator);
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJCOMP)
+        relocateObject(type, oldBuffer, oldReference, relocator);
     else if (type == LOG_ENTRY_TYPE_OBJTOMB)
         relocateTombstone(oldBuffer, oldReference, relocator);
     else if (type == LOG_ENTRY_TYPE_RPCRESULT)
@@ -2514,6 +2739,42 @@ ObjectManager::TombstoneProtector::~TombstoneProtector()
     }
 }
 
+/**
+ * Decide whether a new object should be written to the log with a compact
+ * header (see Object). Objects whose keys and value are no larger than
+ * config->master.compactObjectBytes use the compact header; the other
+ * objects, for which the savings would be insignificant, keep the full one.
+ *
+ * \param object
+ *      Object that is about to be written to the log. Its version and
+ *      timestamp must already be set.
+ */
+void
+ObjectManager::chooseObjectFormat(Object& object)
+{
+    object.setCompact(object.getKeysAndValueLength() <=
+            config->master.compactObjectBytes);
+}
+
+/**
+ * If a key belongs to a tablet that is being pulled from its old owner,
+ * make sure its objects have been pulled. Must be invoked before the key's
+ * HashTableBucketLock is taken.
+ *
+ * \param tableId
+ *      Table containing the key.
+ * \param keyHash
+ *      Hash of the key.
+ * \throw RetryException
+ *      The objects couldn't be pulled yet.
+ */
+void
+ObjectManager::ensurePulled(uint64_t tableId, KeyHash keyHash)
+{
+    if (tabletPuller != NULL)
+        tabletPuller->ensurePulled(tableId, keyHash);
+}
+
 /**
  * Produce a human-readable description of the contents of a segment.
  * Intended primarily for use in unit tests.
@@ -2532,13 +2793,15 @@ ObjectManager::dumpSegment(Segment* segment)
     SegmentIterator it(*segment);
     while (!it.isDone()) {
         LogEntryType type = it.getType();
-        if (type == LOG_ENTRY_TYPE_OBJ) {
+        if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJCOMP) {
             Buffer buffer;
             it.appendToBuffer(buffer);
             Object object(buffer);
-            result += format("%sobject at offset %u, length %u with tableId "
+            result += format("%s%sobject at offset %u, length %u with tableId "
                     "%lu, key '%.*s'",
-                    separator, it.getOffset(), it.getLength(),
+                    separator,
+                    (type == LOG_ENTRY_TYPE_OBJCOMP) ? "compressed " : "",
+                    it.getOffset(), it.getLength(),
                     object.getTableId(), object.getKeyLength(),
                     static_cast<const char*>(object.getKey()));
         } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
@@ -2665,6 +2928,132 @@ ObjectManager::getTxDecisionRecordTimestamp(Buffer& buffer)
     return record.getTimestamp();
 }
 
+/**
+ * Decide whether the log cleaner should compress an object as it relocates
+ * it: returns true if the object was last written at least
+ * ServerConfig::Master::compressColdObjectAge seconds ago.
+ *
+ * \param buffer
+ *      Buffer pointing to the object in the log.
+ */
+bool
+ObjectManager::isColdObject(Buffer& buffer)
+{
+    uint32_t age = config->master.compressColdObjectAge;
+    if (age == 0)
+        return false;
+    uint64_t lastWrite = getObjectTimestamp(buffer);
+    return lastWrite + age <= WallTime::secondsTimestamp();
+}
+
+/**
+ * Returns true if an object has passed its expiry time (see
+ * Object::setExpiryTime). Expired objects are treated as if they had been
+ * deleted: reads don't find them, and the log cleaner discards them
+ * without writing tombstones when it cleans their segments on disk.
+ *
+ * \param buffer
+ *      Buffer pointing to the object (compressed or not).
+ */
+bool
+ObjectManager::isExpiredObject(Buffer& buffer)
+{
+    Object object(buffer);
+    return object.isExpired(WallTime::secondsTimestamp());
+}
+
+/**
+ * Decide whether the log cleaner should evict a live object rather than
+ * relocate it. This happens only if the object belongs to one of the
+ * #cacheTables, it hasn't been read or written since the cleaner last
+ * relocated it (see #recentlyUsed), and memory utilization is at least
+ * ServerConfig::Master::cacheEvictionUtilization percent.
+ *
+ * Evicted objects are dropped without tombstones, so they may only be
+ * evicted when their segment is being cleaned on disk: that is the only case
+ * in which the safe version raised for them is guaranteed to reach backups
+ * before the object disappears from them (see relocateObject()).
+ *
+ * \param key
+ *      Key of the object. The caller must hold the lock for its hash table
+ *      bucket.
+ * \param relocator
+ *      Relocator that was passed to #relocateObject.
+ */
+bool
+ObjectManager::isEvictableObject(Key& key, LogEntryRelocator& relocator)
+{
+    if (!relocator.isDiskCleaning() ||
+            !contains(cacheTables, key.getTableId())) {
+        return false;
+    }
+    uint8_t mask;
+    uint8_t* bits = findRecentlyUsedBits(key, &mask);
+    if ((*bits & mask) != 0)
+        return false;
+    return segmentManager.getMemoryUtilization() >=
+            downCast<int>(config->master.cacheEvictionUtilization);
+}
+
+/**
+ * Record that an object in one of the #cacheTables has been read or
+ * written, so that the log cleaner won't evict it the next time it comes
+ * across the object. Does nothing for objects in other tables.
+ *
+ * \param key
+ *      Key of the object. The caller must hold the lock for its hash table
+ *      bucket.
+ */
+void
+ObjectManager::markRecentlyUsed(Key& key)
+{
+    if (recentlyUsed.empty() || !contains(cacheTables, key.getTableId()))
+        return;
+    uint8_t mask;
+    uint8_t* bits = findRecentlyUsedBits(key, &mask);
+    *bits = static_cast<uint8_t>(*bits | mask);
+}
+
+/**
+ * Clear the recency information for an object (see #markRecentlyUsed),
+ * making it a candidate for eviction the next time the log cleaner comes
+ * across it. Does nothing for objects that aren't in #cacheTables.
+ *
+ * \param key
+ *      Key of the object. The caller must hold the lock for its hash table
+ *      bucket.
+ */
+void
+ObjectManager::clearRecentlyUsed(Key& key)
+{
+    if (recentlyUsed.empty() || !contains(cacheTables, key.getTableId()))
+        return;
+    uint8_t mask;
+    uint8_t* bits = findRecentlyUsedBits(key, &mask);
+    *bits = static_cast<uint8_t>(*bits & ~mask);
+}
+
+/**
+ * Locate the bit in #recentlyUsed that holds recency information for a
+ * given key. Must not be invoked if #recentlyUsed is empty.
+ *
+ * \param key
+ *      Key whose bit is desired.
+ * \param[out] mask
+ *      The bit within the returned byte is returned here.
+ * \return
+ *      The byte containing the key's bit.
+ */
+uint8_t*
+ObjectManager::findRecentlyUsedBits(Key& key, uint8_t* mask)
+{
+    uint64_t secondaryHash;
+    uint64_t bucket = HashTable::findBucketIndex(objectMap.getNumBuckets(),
+            key.getHash(), &secondaryHash);
+    *mask = static_cast<uint8_t>(1 << (secondaryHash & 7));
+    return &recentlyUsed[bucket];
+}
+
 /**
  * Look up an object in the hash table, then extract the entry from the
  * log. Since tombstones are stored in the hash table during recovery,
@@ -2683,6 +3072,9 @@ ObjectManager::getTxDecisionRecordTimestamp(Buffer& buffer)
  *      pointed to by this buffer will be exactly the data in the log. The
  *      cleaner uses this fact to check whether an object in a segment is
  *      alive by comparing the pointer in the hash table (see #relocateObject).
+ *      The one exception is a compressed object: it is decompressed into
+ *      storage owned by this buffer and reported as LOG_ENTRY_TYPE_OBJ, so
+ *      callers never need to deal with compressed objects.
  * \param[out] outVersion
  *      The version of the object or tombstone, when one is found, stored in
  *      this optional parameter.
@@ -2696,6 +3088,10 @@ ObjectManager::getTxDecisionRecordTimestamp(Buffer& buffer)
  *      object is being updated. The caller may update the hash table's
  *      reference directly, rather than having to first perform another
  *      lookup after the new object is written to the log.
+ * \param[out] outCompressed
+ *      If this optional parameter is specified and the key being looked up
+ *      is found, it is set to true if the entry in the log is a compressed
+ *      object (which has been decompressed into \a buffer), false otherwise.
  * \return
  *      True if an entry is found matching the given key, otherwise false.
  */
@@ -2704,7 +3100,8 @@ ObjectManager::lookup(HashTableBucketLock& lock, Key& key,
                 LogEntryType& outType, Buffer& buffer,
                 uint64_t* outVersion,
                 Log::Reference* outReference,
-                HashTable::Candidates* outCandidates)
+                HashTable::Candidates* outCandidates,
+                bool* outCompressed)
 {
     HashTable::Candidates candidates;
     objectMap.lookup(key.getHash(), candidates);
@@ -2715,8 +3112,15 @@ ObjectManager::lookup(HashTableBucketLock& lock, Key& key,
 
         Key candidateKey(type, candidateBuffer);
         if (key == candidateKey) {
+            if (outCompressed != NULL)
+                *outCompressed = (type == LOG_ENTRY_TYPE_OBJCOMP);
+            if (type == LOG_ENTRY_TYPE_OBJCOMP) {
+                CompressedObject::decompress(candidateBuffer, &buffer);
+                type = LOG_ENTRY_TYPE_OBJ;
+            } else {
+                buffer.append(&candidateBuffer);
+            }
             outType = type;
-            buffer.append(&candidateBuffer);
             if (outVersion != NULL) {
                 if (type == LOG_ENTRY_TYPE_OBJ) {
                     Object o(candidateBuffer);
@@ -2739,6 +3143,88 @@ ObjectManager::lookup(HashTableBucketLock& lock, Key& key,
     return false;
 }
 
+/**
+ * Called by readObject after it has read a compressed object. Once every
+ * ServerConfig::Master::promoteCompressedReads reads, on average, the object
+ * is written back to the log uncompressed with a fresh timestamp, so that
+ * objects that become hot again stop paying for decompression on every read.
+ * If the object cools off again, the cleaner will compress it again.
+ *
+ * This method must be invoked with the object's hash table bucket lock held.
+ *
+ * \param key
+ *      Key of the object that was read.
+ * \param objectBuffer
+ *      The decompressed object, as returned by #lookup.
+ * \param reference
+ *      Log reference to the compressed object.
+ * \param candidates
+ *      Hash table entry referring to the compressed object, as returned by
+ *      #lookup.
+ */
+void
+ObjectManager::promoteCompressedObject(Key& key, Buffer& objectBuffer,
+                Log::Reference reference, HashTable::Candidates& candidates)
+{
+    uint32_t interval = config->master.promoteCompressedReads;
+    if (interval == 0 || generateRandom() % interval != 0)
+        return;
+
+    Object object(objectBuffer);
+    object.setTimestamp(WallTime::secondsTimestamp());
+    Buffer promotedBuffer;
+    object.assembleForLog(promotedBuffer);
+
+    // Promotion is only an optimization: if memory is tight, leave the
+    // object compressed rather than competing with writes for log space.
+    Log::Reference newReference;
+    if (!log.hasSpaceFor(promotedBuffer.size()) ||
+            !log.append(LOG_ENTRY_TYPE_OBJ, promotedBuffer, &newReference)) {
+        return;
+    }
+    candidates.setReference(newReference.toInteger());
+    log.free(reference);
+
+    // The compressed copy is accounted for when the cleaner discards it.
+    TableStats::increment(masterTableMetadata,
+                          key.getTableId(),
+                          key.getHash(),
+                          promotedBuffer.size(),
+                          1);
+    TEST_LOG("promoted compressed object: %u bytes", promotedBuffer.size());
+}
+
+/**
+ * Callback used by pullTabletData() to select the objects in a hash table
+ * bucket that belong to the range being pulled. It is invoked by
+ * HashTable::forEachInBucket with the bucket's HashTableBucketLock held.
+ * Tombstones are left behind: the new owner never replays an object twice,
+ * so it has nothing to guard against.
+ *
+ * \param reference
+ *      Log reference of a hash table entry.
+ * \param cookie
+ *      Pointer to the PullParameters for the pull.
+ */
+void
+ObjectManager::pullCandidate(uint64_t reference, void *cookie)
+{
+    PullParameters* params = reinterpret_cast<PullParameters*>(cookie);
+    Buffer buffer;
+    LogEntryType type = params->objectManager->log.getEntry(
+            Log::Reference(reference), buffer);
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJCOMP)
+        return;
+
+    Key key(type, buffer);
+    if (key.getTableId() != params->tableId)
+        return;
+    KeyHash keyHash = key.getHash();
+    if (keyHash < params->firstKeyHash || keyHash > params->lastKeyHash)
+        return;
+    params->references.push_back(Log::Reference(reference));
+}
+
 /**
  * Remove an object from the hash table, if it exists in it. Return whether or
  * not it was found and removed.
@@ -2795,7 +3281,7 @@ ObjectManager::removeIfOrphanedObject(uint64_t reference, void *cookie)
     Buffer buffer;
 
     type = objectManager->log.getEntry(Log::Reference(reference), buffer);
-    if (type != LOG_ENTRY_TYPE_OBJ)
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJCOMP)
         return;
 
     Key key(type, buffer);
@@ -2907,8 +3393,13 @@ ObjectManager::rejectOperation(const RejectRules* rejectRules, uint64_t version)
  *
  * This callback will decide if the object is still alive. If it is, it must
  * use the relocator to move it to a new location and atomically update the
- * hash table.
+ * hash table. Live objects that haven't been written for a while (see
+ * ServerConfig::Master::compressColdObjectAge) are compressed as they are
+ * moved.
  *
+ * \param type
+ *      Type of the entry being cleaned: either LOG_ENTRY_TYPE_OBJ or
+ *      LOG_ENTRY_TYPE_OBJCOMP.
  * \param oldBuffer
  *      Buffer pointing to the object's current location, which will soon be
  *      invalidated.
@@ -2925,10 +3416,10 @@ ObjectManager::rejectOperation(const RejectRules* rejectRules, uint64_t version)
  *      cleaner will note the failure, allocate more memory, and try again.
  */
 void
-ObjectManager::relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
-                LogEntryRelocator& relocator)
+ObjectManager::relocateObject(LogEntryType type, Buffer& oldBuffer,
+                Log::Reference oldReference, LogEntryRelocator& relocator)
 {
-    Key key(LOG_ENTRY_TYPE_OBJ, oldBuffer);
+    Key key(type, oldBuffer);
     HashTableBucketLock lock(*this, key);
 
     // Note that we do not query the TabletManager to see if this object
@@ -2953,11 +3444,58 @@ ObjectManager::relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
             continue;
         }
 
+        // Expired objects, and cache objects that haven't been used since
+        // the cleaner last passed over them, are dropped without tombstones.
+        // Recovery discards expired objects as well, and an evicted object
+        // that comes back after a crash is harmless, but neither version
+        // may be reused. So this only happens when cleaning on disk: the
+        // cleaned segments aren't freed until a new head segment's digest
+        // drops them, and that head also records the safe version raised
+        // here (see SegmentManager::cleaningComplete). In-memory compaction
+        // has no such barrier, and a compacted segment may be re-replicated
+        // to backups at any time.
+        if (relocator.isDiskCleaning()) {
+            bool expired = isExpiredObject(oldBuffer);
+            if (expired || isEvictableObject(key, relocator)) {
+                segmentManager.raiseSafeVersion(
+                        Object(oldBuffer).getVersion() + 1);
+                candidates.remove();
+                log.free(oldReference);
+                TEST_LOG("%s", expired ? "discarded expired object"
+                                       : "evicted cache object");
+                break;
+            }
+        }
+
         // Try to relocate this live object. If we fail, just return. The
-        // cleaner will allocate more memory and retry.
-        if (!relocator.append(LOG_ENTRY_TYPE_OBJ, oldBuffer))
+        // cleaner will allocate more memory and retry (compressing the
+        // object again, if it's cold).
+        Buffer compressedBuffer;
+        if (type == LOG_ENTRY_TYPE_OBJ && isColdObject(oldBuffer) &&
+                CompressedObject::compress(oldBuffer, &compressedBuffer)) {
+            if (!relocator.append(LOG_ENTRY_TYPE_OBJCOMP, compressedBuffer))
+                return;
+
+            // The table and the log now hold fewer live bytes.
+            log.trackShrunkenEntry(oldReference,
+                    relocator.getTotalBytesAppended());
+            TableStats::decrement(masterTableMetadata,
+                                  key.getTableId(),
+                                  key.getHash(),
+                                  oldBuffer.size() - compressedBuffer.size(),
+                                  0);
+            TEST_LOG("compressed object from %u to %u bytes",
+                    oldBuffer.size(), compressedBuffer.size());
+        } else if (!relocator.append(type, oldBuffer)) {
             return;
+        }
 
+        // The object gets a second chance: it will be evicted if it isn't
+        // used before the cleaner comes across it again. This must wait
+        // until the append has succeeded, since a failed relocation is
+        // retried.
+        if (relocator.isDiskCleaning())
+            clearRecentlyUsed(key);
         candidates.setReference(relocator.getNewReference().toInteger());
         return;
     }
@@ -2966,6 +3504,7 @@ ObjectManager::relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
     // the stats accordingly.
     TableStats::decrement(masterTableMetadata,
                           key.getTableId(),
+                          key.getHash(),
                           oldBuffer.size(),
                           1);
 }
@@ -3043,6 +3582,7 @@ ObjectManager::relocateRpcResult(Buffer& oldBuffer,
         // Rpc Record will be dropped/"cleaned" so stats should be updated.
         TableStats::decrement(masterTableMetadata,
                               rpcResult.getTableId(),
+                              rpcResult.getKeyHash(),
                               oldBuffer.size(),
                               1);
     }
@@ -3101,6 +3641,7 @@ ObjectManager::relocatePreparedOp(Buffer& oldBuffer,
         // PreparedOp will be dropped/"cleaned" so stats should be updated.
         TableStats::decrement(masterTableMetadata,
                               op.object.getTableId(),
+                              key.getHash(),
                               oldBuffer.size(),
                               1);
     }
@@ -3140,6 +3681,7 @@ ObjectManager::relocatePreparedOpTombstone(Buffer& oldBuffer,
         // Tombstone will be dropped/"cleaned" so stats should be updated.
         TableStats::decrement(masterTableMetadata,
                               opTomb.header.tableId,
+                              opTomb.header.keyHash,
                               oldBuffer.size(),
                               1);
     }
@@ -3195,7 +3737,12 @@ ObjectManager::relocateTombstone(Buffer& oldBuffer, Log::Reference oldReference,
         break;
     }
 
-    bool keepNewTomb = objectExists || hashReferenceExists;
+    // While a tablet is being pulled, its tombstones are all that keep a
+    // recovery master from resurrecting deleted objects from the old
+    // owner's copy (see TabletPuller::pullAll).
+    bool keepNewTomb = objectExists || hashReferenceExists ||
+            (tabletPuller != NULL &&
+            tabletPuller->isPulling(tomb.getTableId(), key.getHash()));
 
     if (keepNewTomb) {
         // Try to relocate it. If it fails, just return. The cleaner will
@@ -3208,6 +3755,7 @@ ObjectManager::relocateTombstone(Buffer& oldBuffer, Log::Reference oldReference,
         // Tombstone will be dropped/"cleaned" so stats should be updated.
         TableStats::decrement(masterTableMetadata,
                               tomb.getTableId(),
+                              key.getHash(),
                               oldBuffer.size(),
                               1);
     }
@@ -3249,6 +3797,7 @@ ObjectManager::relocateTxDecisionRecord(
         // Decision Record will be dropped/"cleaned" so stats should be updated.
         TableStats::decrement(masterTableMetadata,
                               record.getTableId(),
+                              record.getKeyHash(),
                               oldBuffer.size(),
                               1);
     }
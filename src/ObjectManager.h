@@ -16,11 +16,14 @@
 #ifndef RAMCLOUD_OBJECTMANAGER_H
 #define RAMCLOUD_OBJECTMANAGER_H
 
+#include <unordered_set>
+
 #include "Common.h"
 #include "Log.h"
 #include "SideLog.h"
 #include "LogEntryHandlers.h"
 #include "HashTable.h"
+#include "HotKeyReplicas.h"
 #include "IndexKey.h"
 #include "Object.h"
 #include "ParticipantList.h"
@@ -41,6 +44,8 @@
 
 namespace RAMCloud {
 
+class TabletPuller;
+
 /**
  * The ObjectManager class is responsible for storing objects in a master
  * server. It is essentially the union of the Log, HashTable, TabletMap,
@@ -64,7 +69,9 @@ class ObjectManager : public LogEntryHandlers,
                 MasterTableMetadata* masterTableMetadata,
                 UnackedRpcResults* unackedRpcResults,
                 TransactionManager* transactionManager,
-                TxRecoveryManager* txRecoveryManager);
+                TxRecoveryManager* txRecoveryManager,
+                HotKeyReplicas* hotKeyReplicas,
+                TabletPuller* tabletPuller = NULL);
     virtual ~ObjectManager();
     virtual void freeLogEntry(Log::Reference ref);
     void initOnceEnlisted();
@@ -74,6 +81,9 @@ class ObjectManager : public LogEntryHandlers,
                 uint32_t maxLength, Buffer* response, uint32_t* respNumHashes,
                 uint32_t* numObjects);
     void prefetchHashTableBucket(SegmentIterator* it);
+    uint64_t pullTabletData(uint64_t tableId, uint64_t firstKeyHash,
+                uint64_t lastKeyHash, uint64_t firstBucket,
+                uint64_t endBucket, Segment* segment);
     Status readObject(Key& key, Buffer* outBuffer,
                 RejectRules* rejectRules, uint64_t* outVersion,
                 bool valueOnly = false);
@@ -234,6 +244,35 @@ class ObjectManager : public LogEntryHandlers,
         DISALLOW_COPY_AND_ASSIGN(HashTableBucketLock);
     };
 
+    /**
+     * Passed to pullCandidate() to collect the hash table entries in one
+     * bucket that pullTabletData() should copy.
+     */
+    struct PullParameters {
+        PullParameters(ObjectManager* objectManager, uint64_t tableId,
+                uint64_t firstKeyHash, uint64_t lastKeyHash)
+            : objectManager(objectManager)
+            , tableId(tableId)
+            , firstKeyHash(firstKeyHash)
+            , lastKeyHash(lastKeyHash)
+            , references()
+        {}
+
+        /// ObjectManager owning the hash table being scanned.
+        ObjectManager* objectManager;
+
+        /// Only entries of this table are collected.
+        uint64_t tableId;
+
+        /// Only entries whose key hashes fall in [firstKeyHash, lastKeyHash]
+        /// are collected.
+        uint64_t firstKeyHash;
+        uint64_t lastKeyHash;
+
+        /// Log references of the objects collected so far.
+        vector<Log::Reference> references;
+    };
+
     /**
      * Struct used to pass parameters into the removeIfOrphanedObject and
      * removeIfTombstone methods through the generic HashTable::forEachInBucket
@@ -274,15 +313,26 @@ class ObjectManager : public LogEntryHandlers,
         DISALLOW_COPY_AND_ASSIGN(TombstoneRemover);
     };
 
+    void chooseObjectFormat(Object& object);
+    void clearRecentlyUsed(Key& key);
     static string dumpSegment(Segment* segment);
+    void ensurePulled(uint64_t tableId, KeyHash keyHash);
     uint32_t getObjectTimestamp(Buffer& buffer);
     uint32_t getTombstoneTimestamp(Buffer& buffer);
     uint32_t getTxDecisionRecordTimestamp(Buffer& buffer);
+    bool isColdObject(Buffer& buffer);
+    static bool isExpiredObject(Buffer& buffer);
+    bool isEvictableObject(Key& key, LogEntryRelocator& relocator);
     bool lookup(HashTableBucketLock& lock, Key& key,
                 LogEntryType& outType, Buffer& buffer,
                 uint64_t* outVersion = NULL,
                 Log::Reference* outReference = NULL,
-                HashTable::Candidates* outCandidates = NULL);
+                HashTable::Candidates* outCandidates = NULL,
+                bool* outCompressed = NULL);
+    void markRecentlyUsed(Key& key);
+    void promoteCompressedObject(Key& key, Buffer& objectBuffer,
+                Log::Reference reference, HashTable::Candidates& candidates);
+    static void pullCandidate(uint64_t reference, void *cookie);
     friend void recoveryCleanup(uint64_t maybeTomb, void *cookie);
     bool remove(HashTableBucketLock& lock, Key& key);
     static void removeIfOrphanedObject(uint64_t reference, void *cookie);
@@ -290,8 +340,8 @@ class ObjectManager : public LogEntryHandlers,
     void removeTombstones();
     Status rejectOperation(const RejectRules* rejectRules, uint64_t version)
                 __attribute__((warn_unused_result));
-    void relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
-                LogEntryRelocator& relocator);
+    void relocateObject(LogEntryType type, Buffer& oldBuffer,
+                Log::Reference oldReference, LogEntryRelocator& relocator);
     void relocatePreparedOp(Buffer& oldBuffer, Log::Reference oldReference,
                 LogEntryRelocator& relocator);
     void relocatePreparedOpTombstone(Buffer& oldBuffer,
@@ -302,6 +352,7 @@ class ObjectManager : public LogEntryHandlers,
     void relocateTxDecisionRecord(
             Buffer& oldBuffer, LogEntryRelocator& relocator);
     bool replace(HashTableBucketLock& lock, Key& key, Log::Reference reference);
+    uint8_t* findRecentlyUsedBits(Key& key, uint8_t* mask);
 
     /**
      * Shared RAMCloud information.
@@ -344,6 +395,18 @@ class ObjectManager : public LogEntryHandlers,
      */
     TxRecoveryManager* txRecoveryManager;
 
+    /**
+     * Copies of hot objects on other masters, which must be invalidated
+     * before the objects are modified. May be NULL.
+     */
+    HotKeyReplicas* hotKeyReplicas;
+
+    /**
+     * Pulls the objects of tablets migrated to this master from their old
+     * owners; must be consulted before any key is looked up. May be NULL.
+     */
+    TabletPuller* tabletPuller;
+
     /**
      * Allocator used by the SegmentManager to obtain main memory for log
      * segments.
@@ -378,6 +441,26 @@ class ObjectManager : public LogEntryHandlers,
      */
     HashTable objectMap;
 
+    /**
+     * Identifiers of the tables this master holds as caches (see
+     * ServerConfig::Master::cacheTables). Objects in these tables may be
+     * evicted by the log cleaner when memory runs short.
+     */
+    std::unordered_set<uint64_t> cacheTables;
+
+    /**
+     * Approximate recency information for objects in #cacheTables, used to
+     * choose objects to evict in the style of the CLOCK algorithm. There is
+     * one byte for each hash table bucket; a bit is set (selected by the
+     * key's secondary hash, so keys in the same bucket may share bits) when
+     * an object is read or written, and cleared when the log cleaner passes
+     * over the object. Objects whose bits are clear when the cleaner reaches
+     * them haven't been used for at least one cleaning pass and may be
+     * evicted. Each byte is protected by the lock for its bucket. Empty if
+     * this master has no cache tables.
+     */
+    std::vector<uint8_t> recentlyUsed;
+
     /**
      * Used to identify the first write request, so that we can initialize
      * connections to all backups at that time (this is a temporary kludge
@@ -72,7 +72,8 @@ class ObjectManagerBenchmark {
                                           &masterTableMetadata,
                                           &unackedRpcResults,
                                           &transactionManager,
-                                          &txRecoveryManager);
+                                          &txRecoveryManager,
+                                          NULL);
         unackedRpcResults.resetFreer(objectManager);
     }
 
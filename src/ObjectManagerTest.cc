@@ -16,6 +16,7 @@
 #include "TestUtil.h"
 #include "BackupStorage.h"
 #include "Buffer.h"
+#include "CompressedObject.h"
 #include "CoordinatorClient.h"
 #include "EnumerationIterator.h"
 #include "LogIterator.h"
@@ -25,11 +26,13 @@
 #include "MasterService.h"
 #include "MultiRead.h"
 #include "MultiWrite.h"
+#include "Numa.h"
 #include "RamCloud.h"
 #include "ReplicaManager.h"
 #include "SegmentManager.h"
 #include "ShortMacros.h"
 #include "StringUtil.h"
+#include "TabletPuller.h"
 #include "Tablets.pb.h"
 
 namespace RAMCloud {
@@ -65,7 +68,8 @@ class ObjectManagerTest : public ::testing::Test,
                         &masterTableMetadata,
                         &unackedRpcResults,
                         &transactionManager,
-                        &txRecoveryManager)
+                        &txRecoveryManager,
+                        NULL)
         , unackedRpcResults(&context, this, &clientLeaseValidator)
         , transactionManager(&context,
                              objectManager.getLog(),
@@ -321,6 +325,7 @@ class ObjectManagerTest : public ::testing::Test,
         }
         TableStats::increment(&masterTableMetadata,
                               key.getTableId(),
+                              key.getHash(),
                               buffer.size(),
                               1);
         return reference;
@@ -345,6 +350,7 @@ class ObjectManagerTest : public ::testing::Test,
         }
         TableStats::increment(&masterTableMetadata,
                               key.getTableId(),
+                              key.getHash(),
                               buffer.size(),
                               1);
         return reference;
@@ -418,6 +424,39 @@ class ObjectManagerTest : public ::testing::Test,
         return safeVerScanned;
     }
 
+    /**
+     * Compress an object in the log, just as the log cleaner would if the
+     * object were cold.
+     *
+     * \param key
+     *      Key of the object to compress.
+     * \return
+     *      Log reference to the compressed object.
+     */
+    Log::Reference
+    compressObject(Key& key)
+    {
+        LogEntryType type;
+        Buffer buffer;
+        Log::Reference reference;
+        {
+            ObjectManager::HashTableBucketLock lock(objectManager, key);
+            objectManager.lookup(lock, key, type, buffer, 0, &reference);
+        }
+
+        uint32_t age = masterConfig.master.compressColdObjectAge;
+        masterConfig.master.compressColdObjectAge = 1;
+        WallTime::mockWallTimeValue = Object(buffer).getTimestamp() + 1;
+        LogEntryRelocator relocator(
+            objectManager.segmentManager.getHeadSegment(), buffer.size());
+        objectManager.relocate(type, buffer, reference, relocator);
+        WallTime::mockWallTimeValue = 0;
+        masterConfig.master.compressColdObjectAge = age;
+
+        EXPECT_EQ(LOG_ENTRY_TYPE_OBJCOMP, relocator.getNewType());
+        return relocator.getNewReference();
+    }
+
     /**
      * Returns a stringafied format of metadata found for a particular table.
      *
@@ -561,6 +600,72 @@ TEST_F(ObjectManagerTest, readHashes) {
                                   o1.getValueLength()));
 }
 
+TEST_F(ObjectManagerTest, pullTabletData) {
+    tabletManager.addTablet(97, 0, ~0UL, TabletManager::NORMAL);
+    tabletManager.addTablet(98, 0, ~0UL, TabletManager::NORMAL);
+    Buffer value;
+    Key key1(97, "1", 1);
+    Key key2(97, "2", 1);
+    Key key3(97, "3", 1);
+    Key otherTable(98, "1", 1);
+    Object obj1(key1, "a", 1, 0, 0, value);
+    Object obj2(key2, "b", 1, 0, 0, value);
+    Object obj3(key3, "c", 1, 0, 0, value);
+    Object obj4(otherTable, "d", 1, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj1, NULL, NULL));
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj2, NULL, NULL));
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj3, NULL, NULL));
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj4, NULL, NULL));
+    EXPECT_EQ(STATUS_OK, objectManager.removeObject(key3, NULL, NULL));
+
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+
+    // Whole table: the removed object, its tombstone and the other table
+    // are skipped; the safe version comes first.
+    Segment segment;
+    EXPECT_EQ(numBuckets, objectManager.pullTabletData(97, 0, ~0UL,
+            0, ~0UL, &segment));
+    segment.close();
+    SegmentIterator it(segment);
+    EXPECT_EQ(LOG_ENTRY_TYPE_SAFEVERSION, it.getType());
+    Buffer safeVersionBuffer;
+    it.appendToBuffer(safeVersionBuffer);
+    ObjectSafeVersion safeVersion(safeVersionBuffer);
+    EXPECT_LT(3U, safeVersion.getSafeVersion());
+    std::set<string> keys;
+    for (it.next(); !it.isDone(); it.next()) {
+        EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, it.getType());
+        Buffer buffer;
+        it.appendToBuffer(buffer);
+        Object object(buffer);
+        EXPECT_EQ(97U, object.getTableId());
+        keys.insert(string(reinterpret_cast<const char*>(object.getKey()),
+                object.getKeyLength()));
+    }
+    EXPECT_EQ(2U, keys.size());
+    EXPECT_EQ(1U, keys.count("1"));
+    EXPECT_EQ(1U, keys.count("2"));
+
+    // Key hash range restricted to a single key.
+    Segment segment2;
+    EXPECT_EQ(numBuckets, objectManager.pullTabletData(97,
+            key2.getHash(), key2.getHash(), 0, numBuckets, &segment2));
+    segment2.close();
+    SegmentIterator it2(segment2);
+    it2.next();
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, it2.getType());
+    it2.next();
+    EXPECT_TRUE(it2.isDone());
+
+    // Empty bucket range.
+    Segment segment3;
+    EXPECT_EQ(5U, objectManager.pullTabletData(97, 0, ~0UL, 5, 5,
+            &segment3));
+    SegmentIterator it3(segment3);
+    it3.next();
+    EXPECT_TRUE(it3.isDone());
+}
+
 TEST_F(ObjectManagerTest, readObject) {
     Buffer buffer;
     Key key(1, "1", 1);
@@ -616,6 +721,119 @@ antiGetEntryFilter(string s)
     return s != "getEntry";
 }
 
+TEST_F(ObjectManagerTest, readObject_compressedObject) {
+    Key key(0, "key0", 4);
+    string contents(500, 'x');
+    Buffer value;
+    Object obj(key, contents.c_str(), 500, 0, 0, value);
+    objectManager.writeObject(obj, NULL, NULL);
+    Buffer compressed;
+    objectManager.log.getEntry(compressObject(key), compressed);
+
+    // Promotion is disabled: the object stays compressed.
+    TestLog::Enable _("promoteCompressedObject");
+    Buffer buffer;
+    uint64_t version;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, &version));
+    EXPECT_EQ(contents, TestUtil::toString(&buffer));
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ("", TestLog::get());
+
+    // Promote on every read.
+    masterConfig.master.promoteCompressedReads = 1;
+    buffer.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0));
+    EXPECT_EQ(contents, TestUtil::toString(&buffer));
+    EXPECT_EQ("promoteCompressedObject: promoted compressed object: 531 bytes",
+              TestLog::get());
+    EXPECT_EQ(format("found=true tableId=0 byteCount=%u recordCount=2",
+                     compressed.size() + 531), verifyMetadata(0));
+
+    LogEntryType type;
+    Buffer entry;
+    bool isCompressed = true;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_TRUE(objectManager.lookup(lock, key, type, entry, 0, 0, 0,
+                &isCompressed));
+    }
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, type);
+    EXPECT_FALSE(isCompressed);
+}
+
+TEST_F(ObjectManagerTest, readObject_expired) {
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object obj(key, "item0", 5, 0, 0, value);
+    obj.setExpiryTime(1010);
+    WallTime::mockWallTimeValue = 1000;
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+
+    Buffer buffer;
+    WallTime::mockWallTimeValue = 1009;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0));
+    EXPECT_EQ("item0", TestUtil::toString(&buffer));
+
+    buffer.reset();
+    WallTime::mockWallTimeValue = 1010;
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+              objectManager.readObject(key, &buffer, 0, 0));
+    EXPECT_EQ(0U, buffer.size());
+    WallTime::mockWallTimeValue = 0;
+}
+
+TEST_F(ObjectManagerTest, readObject_numaStats) {
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object obj(key, "item0", 5, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+    PerfStats::threadStats.numaLocalReads = 0;
+    PerfStats::threadStats.numaRemoteReads = 0;
+
+    // Not counted unless log memory is divided among nodes.
+    Buffer buffer;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0));
+    EXPECT_EQ(0U, PerfStats::threadStats.numaLocalReads);
+    EXPECT_EQ(0U, PerfStats::threadStats.numaRemoteReads);
+
+    // All of the log memory is in the first node's range.
+    objectManager.allocator.numNodes = 2;
+    Numa::mockNumNodes = 2;
+    Numa::mockCurrentNode = 0;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0));
+    Numa::mockCurrentNode = 1;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0));
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0));
+    Numa::mockNumNodes = 0;
+    Numa::mockCurrentNode = 0;
+    objectManager.allocator.numNodes = 1;
+    EXPECT_EQ(1U, PerfStats::threadStats.numaLocalReads);
+    EXPECT_EQ(2U, PerfStats::threadStats.numaRemoteReads);
+}
+
+TEST_F(ObjectManagerTest, readObject_numaStatsCompressedObject) {
+    Key key(0, "key0", 4);
+    string contents(500, 'x');
+    Buffer value;
+    Object obj(key, contents.c_str(), 500, 0, 0, value);
+    objectManager.writeObject(obj, NULL, NULL);
+    compressObject(key);
+    PerfStats::threadStats.numaLocalReads = 0;
+    PerfStats::threadStats.numaRemoteReads = 0;
+
+    objectManager.allocator.numNodes = 2;
+    Numa::mockNumNodes = 2;
+    Numa::mockCurrentNode = 1;
+    Buffer buffer;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0));
+    Numa::mockNumNodes = 0;
+    Numa::mockCurrentNode = 0;
+    objectManager.allocator.numNodes = 1;
+    EXPECT_EQ(contents, TestUtil::toString(&buffer));
+    EXPECT_EQ(0U, PerfStats::threadStats.numaLocalReads);
+    EXPECT_EQ(1U, PerfStats::threadStats.numaRemoteReads);
+}
+
 TEST_F(ObjectManagerTest, removeObject) {
     Key key(1, "1", 1);
     storeObject(key, "hi", 93);
@@ -805,6 +1023,74 @@ TEST_F(ObjectManagerTest, replaySegment_nextNodeIdMap) {
               , verifyMetadata(0));
 }
 
+TEST_F(ObjectManagerTest, replaySegment_compactObject) {
+    ObjectManager::TombstoneProtector p(&objectManager);
+    SideLog sl(&objectManager.log);
+
+    Key key(0, "compact", 7);
+    Buffer dataBuffer;
+    Object object(key, "small", 5, 7, 0, dataBuffer);
+    object.setCompact(true);
+    Buffer objectBuffer;
+    object.assembleForLog(objectBuffer);
+    EXPECT_EQ(25U, objectBuffer.size());
+
+    Segment segment;
+    EXPECT_TRUE(segment.append(LOG_ENTRY_TYPE_OBJ, objectBuffer));
+    segment.close();
+    SegmentCertificate certificate;
+    uint32_t length = segment.getAppendedLength(&certificate);
+    char seg[length];
+    Buffer segmentBuffer;
+    segment.appendToBuffer(segmentBuffer);
+    segmentBuffer.copy(0, length, seg);
+
+    SegmentIterator it(seg, length, certificate);
+    objectManager.replaySegment(&sl, it);
+    EXPECT_EQ("found=true tableId=0 byteCount=25 recordCount=1"
+              , verifyMetadata(0));
+
+    Buffer value;
+    uint64_t version;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &value, 0, &version));
+    EXPECT_EQ(7U, version);
+    EXPECT_EQ("small", TestUtil::toString(&value));
+}
+
+TEST_F(ObjectManagerTest, replaySegment_expiredObject) {
+    ObjectManager::TombstoneProtector p(&objectManager);
+    SideLog sl(&objectManager.log);
+
+    Key key(0, "expired", 7);
+    Buffer dataBuffer;
+    Object object(key, "small", 5, 7, 1000, dataBuffer);
+    object.setExpiryTime(1010);
+    Buffer objectBuffer;
+    object.assembleForLog(objectBuffer);
+
+    Segment segment;
+    EXPECT_TRUE(segment.append(LOG_ENTRY_TYPE_OBJ, objectBuffer));
+    segment.close();
+    SegmentCertificate certificate;
+    uint32_t length = segment.getAppendedLength(&certificate);
+    char seg[length];
+    Buffer segmentBuffer;
+    segment.appendToBuffer(segmentBuffer);
+    segmentBuffer.copy(0, length, seg);
+
+    objectManager.segmentManager.safeVersion = 1UL;
+    WallTime::mockWallTimeValue = 1010;
+    SegmentIterator it(seg, length, certificate);
+    objectManager.replaySegment(&sl, it);
+    WallTime::mockWallTimeValue = 0;
+    EXPECT_EQ("found=false tableId=0", verifyMetadata(0));
+    EXPECT_EQ(8UL, objectManager.segmentManager.safeVersion);
+
+    Buffer value;
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+              objectManager.readObject(key, &value, 0, 0));
+}
+
 TEST_F(ObjectManagerTest, replaySegment_tombstoneSynthesis) {
     ObjectManager::TombstoneProtector p(&objectManager);
     uint32_t segLen = 8192;
@@ -1675,6 +1961,62 @@ TEST_F(ObjectManagerTest, writeObject_returnRemovedObj) {
                                       oldValueLength));
 }
 
+TEST_F(ObjectManagerTest, writeObject_compactHeader) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Key key(1, "1", 1);
+    Buffer buffer;
+    Object obj(key, "value", 5, 0, 0, buffer);
+    masterConfig.master.compactObjectBytes = 8;
+
+    // Too big for a compact header.
+    TestLog::Enable _(writeObjectFilter);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+    EXPECT_EQ("writeObject: object: 33 bytes, version 1", TestLog::get());
+
+    // Small enough: the header shrinks from 24 to 10 bytes.
+    masterConfig.master.compactObjectBytes = 9;
+    TestLog::reset();
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+    EXPECT_EQ("writeObject: object: 19 bytes, version 2 | "
+              "writeObject: tombstone: 33 bytes, version 1", TestLog::get());
+
+    Buffer value;
+    uint64_t version;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &value, 0, &version));
+    EXPECT_EQ(2U, version);
+    EXPECT_EQ("value", TestUtil::toString(&value));
+}
+
+TEST_F(ObjectManagerTest, writeObject_expired) {
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object obj(key, "item0", 5, 0, 0, value);
+    obj.setExpiryTime(1010);
+    WallTime::mockWallTimeValue = 1000;
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.exists = 1;
+    Buffer value2;
+    Object obj2(key, "item1", 5, 0, 0, value2);
+    uint64_t version;
+    EXPECT_EQ(STATUS_OBJECT_EXISTS,
+              objectManager.writeObject(obj2, &rules, &version));
+    EXPECT_EQ(1U, version);
+
+    // Once the object expires, reject rules treat it as nonexistent, but
+    // the new object still gets a higher version.
+    WallTime::mockWallTimeValue = 1010;
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj2, &rules, &version));
+    EXPECT_EQ(2U, version);
+    WallTime::mockWallTimeValue = 0;
+
+    Buffer buffer;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0));
+    EXPECT_EQ("item1", TestUtil::toString(&buffer));
+}
+
 TEST_F(ObjectManagerTest, prepareOp) {
     using WireFormat::TxParticipant;
     using WireFormat::TxPrepare;
@@ -2599,6 +2941,262 @@ TEST_F(ObjectManagerTest, keyPointsAtReference) {
                 key, reference));
 }
 
+TEST_F(ObjectManagerTest, relocateObject_compressColdObject) {
+    Key key(0, "key0", 4);
+    string contents(500, 'x');
+    Buffer value;
+    Object obj(key, contents.c_str(), 500, 0, 0, value);
+    objectManager.writeObject(obj, NULL, NULL);
+    EXPECT_EQ("found=true tableId=0 byteCount=531 recordCount=1"
+              , verifyMetadata(0));
+
+    LogEntryType type;
+    Buffer buffer;
+    Log::Reference reference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+    uint32_t timestamp = Object(buffer).getTimestamp();
+    masterConfig.master.compressColdObjectAge = 10;
+
+    // Not cold yet: relocated as is.
+    WallTime::mockWallTimeValue = timestamp + 9;
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(type, buffer, reference, relocator);
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, relocator.getNewType());
+
+    // Cold: the new copy is compressed.
+    buffer.reset();
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+    WallTime::mockWallTimeValue = timestamp + 10;
+    TestLog::Enable _("relocateObject");
+    LogEntryRelocator relocator2(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(type, buffer, reference, relocator2);
+    WallTime::mockWallTimeValue = 0;
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJCOMP, relocator2.getNewType());
+
+    Buffer compressed;
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJCOMP, objectManager.log.getEntry(
+            relocator2.getNewReference(), compressed));
+    EXPECT_LT(compressed.size(), 100U);
+    EXPECT_EQ(format("relocateObject: compressed object from 531 to %u bytes",
+                     compressed.size()), TestLog::get());
+    EXPECT_EQ(format("found=true tableId=0 byteCount=%u recordCount=1",
+                     compressed.size()), verifyMetadata(0));
+
+    // Compressed objects are relocated as they are.
+    LogEntryRelocator relocator3(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_OBJCOMP, compressed,
+            relocator2.getNewReference(), relocator3);
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJCOMP, relocator3.getNewType());
+
+    // Reads see the original object.
+    value.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &value, 0, 0));
+    EXPECT_EQ(contents, TestUtil::toString(&value));
+}
+
+TEST_F(ObjectManagerTest, relocateObject_expiredObject) {
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object obj(key, "item0", 5, 0, 0, value);
+    obj.setExpiryTime(1010);
+    WallTime::mockWallTimeValue = 1000;
+    objectManager.writeObject(obj, NULL, NULL);
+    // The compact header with an expiry time takes 14 bytes.
+    EXPECT_EQ("found=true tableId=0 byteCount=26 recordCount=1"
+              , verifyMetadata(0));
+
+    LogEntryType type;
+    Buffer buffer;
+    Log::Reference reference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+
+    // Not expired yet: relocated as usual.
+    WallTime::mockWallTimeValue = 1009;
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(type, buffer, reference, relocator);
+    EXPECT_TRUE(relocator.didAppend);
+
+    buffer.reset();
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+
+    // Expired, but in-memory compaction can't drop it: nothing would
+    // make the raised safe version durable.
+    WallTime::mockWallTimeValue = 1010;
+    TestLog::Enable _("relocateObject");
+    LogEntryRelocator relocator2(
+        objectManager.segmentManager.getHeadSegment(), 1000, false);
+    objectManager.relocate(type, buffer, reference, relocator2);
+    EXPECT_TRUE(relocator2.didAppend);
+    EXPECT_EQ("", TestLog::get());
+
+    buffer.reset();
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+
+    // Disk cleaning drops it without a tombstone.
+    uint64_t version = Object(buffer).getVersion();
+    objectManager.segmentManager.safeVersion = version;
+    LogEntryRelocator relocator3(
+        objectManager.segmentManager.getHeadSegment(), 1000, true);
+    objectManager.relocate(type, buffer, reference, relocator3);
+    WallTime::mockWallTimeValue = 0;
+    EXPECT_FALSE(relocator3.didAppend);
+    EXPECT_EQ(version + 1, objectManager.segmentManager.safeVersion);
+    EXPECT_EQ("relocateObject: discarded expired object", TestLog::get());
+    EXPECT_EQ("found=true tableId=0 byteCount=0 recordCount=0"
+              , verifyMetadata(0));
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_FALSE(objectManager.lookup(lock, key, type, buffer));
+    }
+}
+
+TEST_F(ObjectManagerTest, relocateObject_evictCacheObject) {
+    objectManager.cacheTables.insert(0);
+    objectManager.recentlyUsed.resize(objectManager.objectMap.getNumBuckets());
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object obj(key, "item0", 5, 0, 0, value);
+    objectManager.writeObject(obj, NULL, NULL);
+
+    LogEntryType type;
+    Buffer buffer;
+    Log::Reference reference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+
+    // Just written: the object gets a second chance.
+    SegmentManager::mockMemoryUtilization = 99;
+    TestLog::Enable _("relocateObject");
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000, true);
+    objectManager.relocate(type, buffer, reference, relocator);
+    EXPECT_TRUE(relocator.didAppend);
+    buffer.reset();
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+
+    // In-memory compaction never evicts.
+    LogEntryRelocator relocator2(
+        objectManager.segmentManager.getHeadSegment(), 1000, false);
+    objectManager.relocate(type, buffer, reference, relocator2);
+    EXPECT_TRUE(relocator2.didAppend);
+    buffer.reset();
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+
+    // Nor does disk cleaning while there's plenty of memory.
+    SegmentManager::mockMemoryUtilization = 94;
+    LogEntryRelocator relocator3(
+        objectManager.segmentManager.getHeadSegment(), 1000, true);
+    objectManager.relocate(type, buffer, reference, relocator3);
+    EXPECT_TRUE(relocator3.didAppend);
+    buffer.reset();
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+    EXPECT_EQ("", TestLog::get());
+
+    // Unused since the last disk cleaning and memory is short: evicted.
+    SegmentManager::mockMemoryUtilization = 95;
+    uint64_t version = Object(buffer).getVersion();
+    objectManager.segmentManager.safeVersion = version;
+    LogEntryRelocator relocator4(
+        objectManager.segmentManager.getHeadSegment(), 1000, true);
+    objectManager.relocate(type, buffer, reference, relocator4);
+    SegmentManager::mockMemoryUtilization = 0;
+    EXPECT_FALSE(relocator4.didAppend);
+    EXPECT_EQ(version + 1, objectManager.segmentManager.safeVersion);
+    EXPECT_EQ("relocateObject: evicted cache object", TestLog::get());
+    EXPECT_EQ("found=true tableId=0 byteCount=0 recordCount=0"
+              , verifyMetadata(0));
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_FALSE(objectManager.lookup(lock, key, type, buffer));
+    }
+}
+
+TEST_F(ObjectManagerTest, relocateObject_readPreventsEviction) {
+    objectManager.cacheTables.insert(0);
+    objectManager.recentlyUsed.resize(objectManager.objectMap.getNumBuckets());
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object obj(key, "item0", 5, 0, 0, value);
+    objectManager.writeObject(obj, NULL, NULL);
+
+    LogEntryType type;
+    Buffer buffer;
+    Log::Reference reference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+    SegmentManager::mockMemoryUtilization = 99;
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000, true);
+    objectManager.relocate(type, buffer, reference, relocator);
+    EXPECT_TRUE(relocator.didAppend);
+
+    Buffer readBuffer;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &readBuffer, 0, 0));
+    buffer.reset();
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+    LogEntryRelocator relocator2(
+        objectManager.segmentManager.getHeadSegment(), 1000, true);
+    objectManager.relocate(type, buffer, reference, relocator2);
+    SegmentManager::mockMemoryUtilization = 0;
+    EXPECT_TRUE(relocator2.didAppend);
+}
+
+TEST_F(ObjectManagerTest, relocateObject_evictOnlyCacheTables) {
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object obj(key, "item0", 5, 0, 0, value);
+    objectManager.writeObject(obj, NULL, NULL);
+
+    LogEntryType type;
+    Buffer buffer;
+    Log::Reference reference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        objectManager.lookup(lock, key, type, buffer, 0, &reference);
+    }
+    SegmentManager::mockMemoryUtilization = 99;
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000, true);
+    objectManager.relocate(type, buffer, reference, relocator);
+    SegmentManager::mockMemoryUtilization = 0;
+    EXPECT_TRUE(relocator.didAppend);
+}
+
 TEST_F(ObjectManagerTest, relocatePreparedOp_relocate) {
     Key key(0, "key0", 4);
     Buffer oldBuffer;
@@ -2920,6 +3518,7 @@ TEST_F(ObjectManagerTest, relocateTombstone_basics) {
     // Update metadata manually due to manual log append.
     TableStats::increment(&masterTableMetadata,
                           tombstone.getTableId(),
+                          key.getHash(),
                           tombstoneBuffer.size(),
                           1);
     EXPECT_EQ("found=true tableId=0 byteCount=72 recordCount=2"
@@ -2933,6 +3532,7 @@ TEST_F(ObjectManagerTest, relocateTombstone_basics) {
     // Update metadata manually due to manual log append.
     TableStats::increment(&masterTableMetadata,
                           tombstone.getTableId(),
+                          key.getHash(),
                           tombstoneBuffer.size(),
                           1);
     EXPECT_EQ("found=true tableId=0 byteCount=108 recordCount=3"
@@ -2982,6 +3582,7 @@ TEST_F(ObjectManagerTest, relocateTombstone_cleanTombstone) {
     // Update metadata manually due to manual log append.
     TableStats::increment(&masterTableMetadata,
                           tombstone.getTableId(),
+                          key.getHash(),
                           tombstoneBuffer.size(),
                           1);
     EXPECT_EQ("found=true tableId=0 byteCount=36 recordCount=1"
@@ -3002,6 +3603,42 @@ TEST_F(ObjectManagerTest, relocateTombstone_cleanTombstone) {
     EXPECT_EQ("found=true tableId=0 byteCount=0 recordCount=0"
               , verifyMetadata(0));
 }
+
+TEST_F(ObjectManagerTest, relocateTombstone_keepWhilePulling) {
+    TabletPuller tabletPuller(&context, &serverId, &objectManager);
+    objectManager.tabletPuller = &tabletPuller;
+    tabletPuller.beginPull(0, 0, ~0UL, ServerId(9, 0));
+
+    // The tombstone's object is gone, but a recovery master may still
+    // need the tombstone to filter what it pulls from the old owner.
+    Key key(0, "key0", 4);
+    Buffer dataBuffer;
+    Object o(key, "hi", 2, 0, 0, dataBuffer);
+    ObjectTombstone tombstone(o, 0xBAD, 0);
+    Buffer tombstoneBuffer;
+    tombstone.assembleForLog(tombstoneBuffer);
+    Log::Reference reference;
+    EXPECT_TRUE(objectManager.log.append(
+        LOG_ENTRY_TYPE_OBJTOMB, tombstoneBuffer, &reference));
+    objectManager.log.sync();
+    Buffer bufferInLog;
+    objectManager.log.getEntry(reference, bufferInLog);
+
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_OBJTOMB, bufferInLog, reference,
+            relocator);
+    EXPECT_TRUE(relocator.didAppend);
+
+    tabletPuller.drop(0, 0, ~0UL);
+    LogEntryRelocator relocator2(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_OBJTOMB, bufferInLog, reference,
+            relocator2);
+    EXPECT_FALSE(relocator2.didAppend);
+    objectManager.tabletPuller = NULL;
+}
+
 TEST_F(ObjectManagerTest, tombstoneRelocationCallback_hashTableRefUpdate) {
     Key key(0, "1", 1);
     Buffer value;
@@ -3056,6 +3693,7 @@ TEST_F(ObjectManagerTest, relocateTxDecisionRecord_relocateRecord) {
     // Update metadata manually due to manual log append.
     TableStats::increment(&masterTableMetadata,
                           record.getTableId(),
+                          record.getKeyHash(),
                           recordBuffer.size(),
                           1);
     EXPECT_EQ("found=true tableId=1 byteCount=72 recordCount=1"
@@ -3090,6 +3728,7 @@ TEST_F(ObjectManagerTest, relocateTxDecisionRecord_cleanRecord) {
     // Update metadata manually due to manual log append.
     TableStats::increment(&masterTableMetadata,
                           record.getTableId(),
+                          record.getKeyHash(),
                           recordBuffer.size(),
                           1);
     EXPECT_EQ("found=true tableId=1 byteCount=72 recordCount=1"
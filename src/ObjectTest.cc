@@ -770,6 +770,155 @@ TEST_F(ObjectTest, getSerializedLength) {
     EXPECT_EQ(44U, objects[2]->getSerializedLength());
 }
 
+TEST_F(ObjectTest, getHeaderLength) {
+    Object& object = *objects[0];
+    EXPECT_EQ(24U, object.getHeaderLength());
+    object.setCompact(true);
+    // Checksum, timestamp, 1-byte version (75) and 1-byte table id (57).
+    EXPECT_EQ(10U, object.getHeaderLength());
+    EXPECT_EQ(30U, object.getSerializedLength());
+    object.setVersion(1UL << 14);
+    object.changeTableId(~0UL);
+    EXPECT_EQ(21U, object.getHeaderLength());
+}
+
+TEST_F(ObjectTest, setCompact) {
+    Object& object = *objects[0];
+    object.setCompact(true);
+    EXPECT_TRUE(object.isCompact());
+    object.setCompact(false);
+    EXPECT_FALSE(object.isCompact());
+
+    // Timestamps that collide with COMPACT_FLAG force the full header.
+    object.setCompact(true);
+    object.setTimestamp(Object::COMPACT_FLAG + 5);
+    EXPECT_FALSE(object.isCompact());
+    object.setCompact(true);
+    EXPECT_FALSE(object.isCompact());
+}
+
+TEST_F(ObjectTest, compactHeader_roundTrip) {
+    Object& object = *objects[0];
+    object.setCompact(true);
+    object.setVersion(300);
+    Buffer compactBuffer;
+    object.assembleForLog(compactBuffer);
+    EXPECT_EQ(object.getSerializedLength(), compactBuffer.size());
+    EXPECT_EQ(11U, object.getHeaderLength());
+
+    // Contiguous memory.
+    const void* contiguous = compactBuffer.getRange(0, compactBuffer.size());
+    Object fromPointer(contiguous, compactBuffer.size());
+    // Buffer with several chunks and a non-zero offset.
+    Buffer chunks;
+    chunks.appendExternal("junk", 4);
+    chunks.appendExternal(contiguous, 6);
+    chunks.appendExternal(static_cast<const char*>(contiguous) + 6,
+            compactBuffer.size() - 6);
+    Object fromBuffer(chunks, 4, compactBuffer.size());
+
+    Object* parsed[] = { &fromPointer, &fromBuffer };
+    for (uint32_t i = 0; i < arrayLength(parsed); i++) {
+        EXPECT_TRUE(parsed[i]->isCompact());
+        EXPECT_EQ(57U, parsed[i]->getTableId());
+        EXPECT_EQ(300U, parsed[i]->getVersion());
+        EXPECT_EQ(723U, parsed[i]->getTimestamp());
+        EXPECT_EQ(20U, parsed[i]->getKeysAndValueLength());
+        EXPECT_EQ(object.getSerializedLength(),
+                  parsed[i]->getSerializedLength());
+        EXPECT_EQ("ha", string(reinterpret_cast<const char*>(
+                parsed[i]->getKey(0)), 2));
+        EXPECT_EQ("YO!", string(reinterpret_cast<const char*>(
+                parsed[i]->getValue()), 3));
+        EXPECT_TRUE(parsed[i]->checkIntegrity());
+    }
+    EXPECT_EQ(object.header.checksum,
+              Object::computeChecksum(contiguous, compactBuffer.size()));
+
+    // Writing a parsed object again preserves the format.
+    Buffer copy;
+    fromBuffer.assembleForLog(copy);
+    EXPECT_EQ(0, memcmp(contiguous, copy.getRange(0, copy.size()),
+                        copy.size()));
+}
+
+TEST_F(ObjectTest, compactHeader_truncated) {
+    Object& object = *objects[0];
+    object.setCompact(true);
+    object.setVersion(1UL << 20);
+    Buffer compactBuffer;
+    object.assembleForLog(compactBuffer);
+
+    // The version varint is cut short: no keys or value are left, and the
+    // object fails its integrity check.
+    Object truncated(compactBuffer, 0, 9);
+    EXPECT_EQ(0U, truncated.getKeysAndValueLength());
+    EXPECT_FALSE(truncated.checkIntegrity());
+}
+
+TEST_F(ObjectTest, setExpiryTime) {
+    Object& object = *objects[0];
+    uint32_t checksum = object.computeChecksum();
+    EXPECT_FALSE(object.isCompact());
+    object.setExpiryTime(1000);
+    EXPECT_EQ(1000U, object.getExpiryTime());
+    EXPECT_TRUE(object.isCompact());
+    EXPECT_NE(checksum, object.computeChecksum());
+
+    // The expiry time keeps the compact header even if asked otherwise.
+    object.setCompact(false);
+    EXPECT_TRUE(object.isCompact());
+    // Checksum, timestamp, version, table id and expiry time.
+    EXPECT_EQ(14U, object.getHeaderLength());
+
+    object.setExpiryTime(0);
+    object.setCompact(false);
+    EXPECT_FALSE(object.isCompact());
+    EXPECT_EQ(checksum, object.computeChecksum());
+
+    // Timestamps that collide with EXPIRES_FLAG force the full header.
+    object.setTimestamp(Object::EXPIRES_FLAG + 5);
+    object.setExpiryTime(1000);
+    EXPECT_FALSE(object.isCompact());
+}
+
+TEST_F(ObjectTest, isExpired) {
+    Object& object = *objects[0];
+    EXPECT_FALSE(object.isExpired(~0U));
+    object.setExpiryTime(1000);
+    EXPECT_FALSE(object.isExpired(999));
+    EXPECT_TRUE(object.isExpired(1000));
+    EXPECT_TRUE(object.isExpired(1001));
+}
+
+TEST_F(ObjectTest, expiryTime_roundTrip) {
+    Object& object = *objects[0];
+    object.setExpiryTime(0x12345678);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    EXPECT_EQ(object.getSerializedLength(), buffer.size());
+
+    const void* contiguous = buffer.getRange(0, buffer.size());
+    Object fromPointer(contiguous, buffer.size());
+    Object fromBuffer(buffer);
+    Object* parsed[] = { &fromPointer, &fromBuffer };
+    for (uint32_t i = 0; i < arrayLength(parsed); i++) {
+        EXPECT_TRUE(parsed[i]->isCompact());
+        EXPECT_EQ(0x12345678U, parsed[i]->getExpiryTime());
+        EXPECT_EQ(723U, parsed[i]->getTimestamp());
+        EXPECT_EQ(75U, parsed[i]->getVersion());
+        EXPECT_EQ(57U, parsed[i]->getTableId());
+        EXPECT_EQ("YO!", string(reinterpret_cast<const char*>(
+                parsed[i]->getValue()), 3));
+        EXPECT_TRUE(parsed[i]->checkIntegrity());
+    }
+
+    // A truncated expiry time fails the integrity check.
+    Object truncated(buffer, 0, 12);
+    EXPECT_EQ(0U, truncated.getKeysAndValueLength());
+    EXPECT_FALSE(truncated.checkIntegrity());
+}
+
 TEST_F(ObjectTest, checkIntegrity) {
     for (uint32_t i = 0; i < arrayLength(objects); i++) {
         Object& object = *objects[i];
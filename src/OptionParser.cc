@@ -26,6 +26,7 @@
 #include "PcapFile.h"
 #include "ShortMacros.h"
 #include "PerfCounter.h"
+#include "RpcTrace.h"
 #include "StringUtil.h"
 
 namespace RAMCloud {
@@ -131,9 +132,11 @@ OptionParser::setup(int argc, char* argv[])
     try {
         string defaultLogLevel;
         string logFile;
+        string binaryLogFile;
         vector<string> logLevels;
         string configFile(".ramcloud");
         bool debugOnSegfault = false;
+        uint32_t rpcTraceInterval = 0;
 
         // Basic options supported on the command line of all apps
         OptionsDescription commonOptions("Common");
@@ -150,6 +153,11 @@ OptionParser::setup(int argc, char* argv[])
             ("logFile",
              po::value<string>(&logFile),
              "File to use for log messages")
+            ("binaryLogFile",
+             po::value<string>(&binaryLogFile),
+             "If specified, log messages are written to this file in a "
+             "compact binary form (use logDecompressor to read it); "
+             "backtraces still go to the text log")
             ("logLevel,l",
              po::value<string>(&defaultLogLevel)->
                 default_value("NOTICE"),
@@ -202,6 +210,13 @@ OptionParser::setup(int argc, char* argv[])
              "server connection for listening client requests is dead."
              "0 means use transport-specific default."
              "Negative number means disabling the timer.")
+            ("rpcTraceInterval",
+             ProgramOptions::value<uint32_t>(&rpcTraceInterval)->
+                default_value(0),
+             "Trace one out of every N RPCs issued by this process: the "
+             "RPC's progress through every server that handles it is "
+             "recorded in their time traces (see scripts/rpctrace.py). "
+             "0 means don't trace any RPCs.")
             ("debugOnSegfault",
              ProgramOptions::bool_switch(&debugOnSegfault),
              "Whether or not this application should drop to debugger"
@@ -268,6 +283,9 @@ OptionParser::setup(int argc, char* argv[])
             std::string logPath = logFile.substr(0, logFile.size() - s.size());
             Perf::setNameAndPath(serverName, logPath);
         }
+        if (binaryLogFile.size() != 0) {
+            BinaryLog::open(binaryLogFile.c_str());
+        }
         Logger::get().setLogLevels(defaultLogLevel);
         foreach (auto moduleLevel, logLevels) {
             auto pos = moduleLevel.find("=");
@@ -284,6 +302,7 @@ OptionParser::setup(int argc, char* argv[])
         if (options.pcapFilePath != "")
             pcapFile.construct(options.pcapFilePath.c_str(),
                                PcapFile::LinkType::ETHERNET);
+        RpcTrace::setSampleInterval(rpcTraceInterval);
         if (debugOnSegfault) {
             signal(SIGSEGV, invokeGDB);
             signal(SIGABRT, invokeGDB);
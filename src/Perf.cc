@@ -19,12 +19,29 @@
 // tests measure performance in a single stand-alone process, not in a cluster
 // with multiple servers.  Invoke the program like this:
 //
-//     Perf test1 test2 ...
+//     Perf [options] test1 test2 ...
 //
 // test1 and test2 are the names of individual performance measurements to
 // run.  If no test names are provided then all of the performance tests
 // are run.
 //
+// Each test is run several times (after some untimed warmup runs) and the
+// median time is printed, along with the 90th percentile and the standard
+// deviation when there is more than one repetition. Options:
+//
+//     --reps N         Number of timed repetitions of each test (default 5).
+//     --warmup N       Number of untimed runs before the timed ones
+//                      (default 1).
+//     --cpu N          Pin the benchmark to this core (default 3; -1 means
+//                      don't pin).
+//     --json FILE      Also write all of the results to FILE in JSON.
+//     --baseline FILE  Compare the results with a file written earlier
+//                      with --json, and exit with status 1 if any test got
+//                      significantly slower.
+//     --threshold P    A change is significant if the medians differ by
+//                      more than P percent (default 5) and by more than
+//                      twice the combined standard deviation.
+//
 // To add a new test:
 // * Write a function that implements the test.  Use existing test functions
 //   as a guideline, and be sure to generate output in the same form as
@@ -35,17 +52,24 @@
 #else
 #include <cstdatomic>
 #endif
+#include <algorithm>
+#include <cmath>
 #include <condition_variable>
+#include <fstream>
+#include <map>
 #include <mutex>
 #include <thread>
 #include <vector>
 
 #include "Common.h"
 #include "Atomic.h"
+#include "CompressedObject.h"
+#include "Crc32C.h"
 #include "Cycles.h"
 #include "CycleCounter.h"
 #include "Dispatch.h"
 #include "Fence.h"
+#include "Key.h"
 #include "LockTable.h"
 #include "Memory.h"
 #include "MurmurHash3.h"
@@ -548,6 +572,27 @@ double condPingPong()
     return CondPingPong().run();
 }
 
+// Measure the cost of computing a Crc32C checksum over cached data.
+template<int length>
+double crc32c()
+{
+    int count = 100000;
+    char buf[length];
+    memset(buf, 'x', length);
+    uint32_t total = 0;
+
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        Crc32C crc;
+        crc.update(buf, length);
+        total += crc.getResult();
+    }
+    uint64_t stop = Cycles::rdtsc();
+
+    discard(&total);
+    return Cycles::toSeconds(stop - start)/count;
+}
+
 // Measure the cost of the exchange method on a C++ atomic_int.
 double cppAtomicExchange()
 {
@@ -770,6 +815,25 @@ double hashTableLookup()
     return Cycles::toSeconds((stop - start) / numLookups);
 }
 
+// Measure the cost of hashing a 30-byte key, as done for every object
+// lookup in a master.
+double keyHash()
+{
+    int count = 1000000;
+    char key[30];
+    memset(key, 'k', sizeof(key));
+    uint64_t total = 0;
+
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        total += Key::getHash(i, key, sizeof(key));
+    }
+    uint64_t stop = Cycles::rdtsc();
+
+    discard(&total);
+    return Cycles::toSeconds(stop - start)/count;
+}
+
 // Measure the cost of an lfence instruction.
 double lfence()
 {
@@ -976,6 +1040,72 @@ double murmur3()
     return Cycles::toSeconds(stop - start)/count;
 }
 
+// Fill in a 1000-byte object whose value is made of words drawn from a
+// small vocabulary, so that it compresses roughly the way text does.
+static void
+makeCompressibleObject(Buffer* objectBuffer)
+{
+    static const char* words[] = {"ramcloud ", "log ", "segment ",
+            "object ", "cleaner ", "master ", "backup ", "replica "};
+    char value[1000];
+    uint32_t length = 0;
+    while (length < sizeof(value)) {
+        const char* word = words[generateRandom() % arrayLength(words)];
+        uint32_t wordLength = std::min(downCast<uint32_t>(strlen(word)),
+                downCast<uint32_t>(sizeof(value)) - length);
+        memcpy(value + length, word, wordLength);
+        length += wordLength;
+    }
+    Key key(1, "key", 3);
+    Buffer dataBuffer;
+    Object object(key, value, length, 1, 0, dataBuffer);
+    object.assembleForLog(*objectBuffer);
+}
+
+// Measure the cost of compressing a 1000-byte object with LZ4, as the log
+// cleaner does for cold objects.
+double objectCompress()
+{
+    int count = 10000;
+    Buffer objectBuffer;
+    makeCompressibleObject(&objectBuffer);
+    uint32_t totalBytes = 0;
+
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        Buffer compressedBuffer;
+        CompressedObject::compress(objectBuffer, &compressedBuffer);
+        totalBytes += compressedBuffer.size();
+    }
+    uint64_t stop = Cycles::rdtsc();
+
+    discard(&totalBytes);
+    return Cycles::toSeconds(stop - start)/count;
+}
+
+// Measure the cost of decompressing a 1000-byte object, which is added to
+// every read of a cold object.
+double objectDecompress()
+{
+    int count = 100000;
+    Buffer objectBuffer;
+    makeCompressibleObject(&objectBuffer);
+    Buffer compressedBuffer;
+    CompressedObject::compress(objectBuffer, &compressedBuffer);
+    uint32_t totalBytes = 0;
+
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        Buffer decompressedBuffer;
+        CompressedObject::decompress(compressedBuffer, &decompressedBuffer);
+        totalBytes += decompressedBuffer.size();
+    }
+    uint64_t stop = Cycles::rdtsc();
+
+    discard(&totalBytes);
+    return Cycles::toSeconds(stop - start)/count;
+}
+
 // Starting with a new ObjectPool, measure the cost of Object
 // allocations. The pool may optionally be primed first to
 // measure the best-case performance.
@@ -1527,7 +1657,7 @@ TestInfo tests[] = {
      "Atomic<int>::compareExchange"},
     {"atomicIntInc", atomicIntInc,
      "Atomic<int>::inc"},
-    {"atomicIntInc", cppAtomicIntInc,
+    {"cppAtomicIntInc", cppAtomicIntInc,
      "std::atomic<int>::fetch_add"},
     {"atomicIntLoad", atomicIntLoad,
      "Atomic<int>::load"},
@@ -1587,6 +1717,10 @@ TestInfo tests[] = {
      "Exchange method on a C++ atomic_int"},
     {"cppAtomicLoad", cppAtomicLoad,
      "Read a C++ atomic_int"},
+    {"crc32c", crc32c<100>,
+     "Crc32C checksum of 100 bytes of cached data"},
+    {"crc32c_1000", crc32c<1000>,
+     "Crc32C checksum of 1000 bytes of cached data"},
     {"cyclesToSeconds", perfCyclesToSeconds,
      "Convert a rdtsc result to (double) seconds"},
     {"cyclesToNanos", perfCyclesToNanoseconds,
@@ -1611,6 +1745,8 @@ TestInfo tests[] = {
      "Key lookup in a 1GB HashTable"},
     {"hashTableLookupPf", hashTableLookup<20>,
      "Key lookup in a 1GB HashTable with prefetching"},
+    {"keyHash", keyHash,
+     "Key::getHash on a 30-byte key"},
     {"lfence", lfence,
      "Lfence instruction"},
     {"lockInDispThrd", lockInDispThrd,
@@ -1641,8 +1777,12 @@ TestInfo tests[] = {
      "memcpy 10000 bytes with cold dst and src"},
     {"murmur3", murmur3<1>,
      "128-bit MurmurHash3 (64-bit optimised) on 1 byte of data"},
-    {"murmur3", murmur3<256>,
+    {"murmur3_256", murmur3<256>,
      "128-bit MurmurHash3 hash (64-bit optimised) on 256 bytes of data"},
+    {"objectCompress", objectCompress,
+     "Compress a 1000-byte object with LZ4 (log cleaner)"},
+    {"objectDecompress", objectDecompress,
+     "Decompress a 1000-byte object (read of a cold object)"},
     {"objectPoolAlloc", objectPoolAlloc<int, false>,
      "Cost of new allocations from an ObjectPool (no destroys)"},
     {"objectPoolRealloc", objectPoolAlloc<int, true>,
@@ -1691,52 +1831,308 @@ TestInfo tests[] = {
      "Push and pop a std::vector"},
 };
 
+// The following variables hold command-line options that control how each
+// test is run; see the comment at the top of this file.
+static int repetitions = 5;
+static int warmups = 1;
+static int cpu = 3;
+static double threshold = 5.0;
+static const char* jsonFile = NULL;
+static const char* baselineFile = NULL;
+
+// Summarizes all of the timed runs of one test (all times are in seconds
+// per iteration of the test).
+struct TestResult {
+    const TestInfo* info;         // The test that was run.
+    std::vector<double> samples;  // Result of each timed repetition, in
+                                  // the order they were run.
+    double median;
+    double p90;                   // 90th percentile.
+    double mean;
+    double stddev;
+    double min;
+};
+
+// Median and standard deviation for a test, as read from a baseline file.
+struct BaselineEntry {
+    double median;
+    double stddev;
+};
+
 /**
- * Runs a particular test and prints a one-line result message.
+ * Print a time in a compact form with appropriate units.
  *
- * \param info
- *      Describes the test to run.
+ * \param secs
+ *      Time to print, in seconds.
+ * \return
+ *      The number of characters printed.
  */
-void runTest(TestInfo& info)
+int printTime(double secs)
 {
-    double secs = info.func();
-    int width = printf("%-23s ", info.name);
     if (secs < 1.0e-06) {
-        width += printf("%8.2fns", 1e09*secs);
+        return printf("%8.2fns", 1e09*secs);
     } else if (secs < 1.0e-03) {
-        width += printf("%8.2fus", 1e06*secs);
+        return printf("%8.2fus", 1e06*secs);
     } else if (secs < 1.0) {
-        width += printf("%8.2fms", 1e03*secs);
-    } else {
-        width += printf("%8.2fs", secs);
+        return printf("%8.2fms", 1e03*secs);
     }
-    printf("%*s %s\n", 26-width, "", info.description);
+    return printf("%8.2fs", secs);
+}
+
+/**
+ * Fill in the summary statistics for a test from its samples.
+ *
+ * \param result
+ *      Holds the samples; the other fields are filled in.
+ */
+void summarize(TestResult* result)
+{
+    std::vector<double> sorted(result->samples);
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    result->min = sorted[0];
+    result->median = (n % 2) ? sorted[n/2]
+                             : (sorted[n/2 - 1] + sorted[n/2])/2;
+    result->p90 = sorted[static_cast<size_t>(
+            ceil(0.9*static_cast<double>(n))) - 1];
+    double sum = 0;
+    foreach (double sample, sorted) {
+        sum += sample;
+    }
+    result->mean = sum/static_cast<double>(n);
+    double squares = 0;
+    foreach (double sample, sorted) {
+        squares += (sample - result->mean)*(sample - result->mean);
+    }
+    result->stddev = (n > 1) ? sqrt(squares/static_cast<double>(n - 1)) : 0;
+}
+
+/**
+ * Runs a particular test (with warmups and repetitions) and prints a
+ * one-line result message.
+ *
+ * \param info
+ *      Describes the test to run.
+ * \param result
+ *      The measurements are returned here.
+ */
+void runTest(TestInfo& info, TestResult* result)
+{
+    result->info = &info;
+    for (int i = 0; i < warmups; i++) {
+        info.func();
+    }
+    for (int i = 0; i < repetitions; i++) {
+        result->samples.push_back(info.func());
+    }
+    summarize(result);
+
+    int width = printf("%-23s ", info.name);
+    width += printTime(result->median);
+    printf("%*s ", 26-width, "");
+    if (repetitions > 1) {
+        printf("p90 ");
+        printTime(result->p90);
+        printf(" sd %5.1f%%  ", (result->median > 0)
+                ? 100.0*result->stddev/result->median : 0.0);
+    }
+    printf("%s\n", info.description);
+}
+
+/**
+ * Write the results of all the tests that were run to a file in JSON
+ * format. Each test is on a line by itself, which is what readBaseline
+ * depends on.
+ *
+ * \param fileName
+ *      Name of the file to write.
+ * \param results
+ *      Results for all of the tests that were run.
+ */
+void writeJson(const char* fileName, std::vector<TestResult>& results)
+{
+    FILE* f = fopen(fileName, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Couldn't open %s: %s\n", fileName, strerror(errno));
+        exit(1);
+    }
+    fprintf(f, "{\n  \"repetitions\": %d,\n  \"warmups\": %d,\n"
+            "  \"cyclesPerSec\": %.0f,\n  \"tests\": [\n",
+            repetitions, warmups, Cycles::perSecond());
+    for (size_t i = 0; i < results.size(); i++) {
+        TestResult& r = results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"median\": %.6e, \"p90\": %.6e, "
+                "\"mean\": %.6e, \"stddev\": %.6e, \"min\": %.6e, "
+                "\"samples\": [", r.info->name, r.median, r.p90, r.mean,
+                r.stddev, r.min);
+        for (size_t j = 0; j < r.samples.size(); j++) {
+            fprintf(f, "%s%.6e", (j == 0) ? "" : ", ", r.samples[j]);
+        }
+        fprintf(f, "]}%s\n", (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+/**
+ * Read a file written by writeJson.
+ *
+ * \param fileName
+ *      Name of the file to read.
+ * \param baseline
+ *      The median and standard deviation for each test in the file are
+ *      stored here, keyed by test name.
+ */
+void readBaseline(const char* fileName,
+        std::map<string, BaselineEntry>* baseline)
+{
+    std::ifstream in(fileName);
+    if (!in) {
+        fprintf(stderr, "Couldn't open %s: %s\n", fileName, strerror(errno));
+        exit(1);
+    }
+    string line;
+    while (std::getline(in, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t median = line.find("\"median\": ");
+        size_t stddev = line.find("\"stddev\": ");
+        if ((name == string::npos) || (median == string::npos) ||
+                (stddev == string::npos)) {
+            continue;
+        }
+        name += strlen("\"name\": \"");
+        BaselineEntry entry;
+        entry.median = strtod(line.c_str() + median + strlen("\"median\": "),
+                NULL);
+        entry.stddev = strtod(line.c_str() + stddev + strlen("\"stddev\": "),
+                NULL);
+        (*baseline)[line.substr(name, line.find('"', name) - name)] = entry;
+    }
+}
+
+/**
+ * Compare the results of this run with a baseline and print the relative
+ * change for each test.
+ *
+ * \param fileName
+ *      Name of a file written by an earlier run with --json.
+ * \param results
+ *      Results for all of the tests that were run.
+ * \return
+ *      The number of tests that got significantly slower.
+ */
+int compareToBaseline(const char* fileName, std::vector<TestResult>& results)
+{
+    std::map<string, BaselineEntry> baseline;
+    readBaseline(fileName, &baseline);
+    int regressions = 0;
+    printf("\nComparison with %s (threshold %.1f%%):\n", fileName, threshold);
+    foreach (TestResult& r, results) {
+        std::map<string, BaselineEntry>::iterator it =
+                baseline.find(r.info->name);
+        if (it == baseline.end()) {
+            printf("%-23s %8s   not in baseline\n", r.info->name, "");
+            continue;
+        }
+        BaselineEntry& base = it->second;
+        double diff = r.median - base.median;
+        double change = (base.median > 0) ? 100.0*diff/base.median : 0.0;
+
+        // A change is only reported if it is large in relative terms and
+        // also well outside the run-to-run noise of both measurements.
+        double noise = 2*sqrt(base.stddev*base.stddev + r.stddev*r.stddev);
+        const char* verdict = "";
+        if ((fabs(change) > threshold) && (fabs(diff) > noise)) {
+            if (diff > 0) {
+                verdict = "SLOWER";
+                regressions++;
+            } else {
+                verdict = "faster";
+            }
+        }
+        printf("%-23s ", r.info->name);
+        printTime(base.median);
+        printf(" -> ");
+        printTime(r.median);
+        printf(" %+7.1f%%  %s\n", change, verdict);
+    }
+    printf("%d test(s) significantly slower\n", regressions);
+    return regressions;
 }
 
 int
 main(int argc, char *argv[])
 {
-    bindThreadToCpu(3);
-    if (argc == 1) {
+    std::vector<const char*> names;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            names.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Option %s requires a value\n", arg);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (strcmp(arg, "--reps") == 0) {
+            repetitions = atoi(value);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            warmups = atoi(value);
+        } else if (strcmp(arg, "--cpu") == 0) {
+            cpu = atoi(value);
+        } else if (strcmp(arg, "--json") == 0) {
+            jsonFile = value;
+        } else if (strcmp(arg, "--baseline") == 0) {
+            baselineFile = value;
+        } else if (strcmp(arg, "--threshold") == 0) {
+            threshold = atof(value);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return 1;
+        }
+    }
+    if ((repetitions < 1) || (warmups < 0)) {
+        fprintf(stderr, "--reps must be at least 1 and --warmup must not be "
+                "negative\n");
+        return 1;
+    }
+
+    if (cpu >= 0) {
+        bindThreadToCpu(cpu);
+    }
+    std::vector<TestResult> results;
+    if (names.empty()) {
         // No test names specified; run all tests.
         foreach (TestInfo& info, tests) {
-            runTest(info);
+            results.emplace_back();
+            runTest(info, &results.back());
         }
     } else {
         // Run only the tests that were specified on the command line.
-        for (int i = 1; i < argc; i++) {
+        foreach (const char* name, names) {
             bool foundTest = false;
             foreach (TestInfo& info, tests) {
-                if (strcmp(argv[i], info.name) == 0) {
+                if (strcmp(name, info.name) == 0) {
                     foundTest = true;
-                    runTest(info);
+                    results.emplace_back();
+                    runTest(info, &results.back());
                     break;
                 }
             }
             if (!foundTest) {
-                int width = printf("%-18s ??", argv[i]);
+                int width = printf("%-18s ??", name);
                 printf("%*s No such test\n", 26-width, "");
             }
         }
     }
+
+    if (jsonFile != NULL) {
+        writeJson(jsonFile, results);
+    }
+    if ((baselineFile != NULL) &&
+            (compareToBaseline(baselineFile, results) > 0)) {
+        return 1;
+    }
+    return 0;
 }
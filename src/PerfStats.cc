@@ -13,6 +13,10 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+#include <memory>
+#include <set>
+
 #include "Cycles.h"
 #include "Minimal.h"
 #include "PerfStats.h"
@@ -25,6 +29,8 @@ SpinLock PerfStats::mutex("PerfStats");
 std::vector<PerfStats*> PerfStats::registeredStats;
 int PerfStats::nextThreadId = 1;
 __thread PerfStats PerfStats::threadStats;
+__thread PerfStats::RpcLatency* PerfStats::threadLatency = NULL;
+std::vector<PerfStats::RpcLatency*> PerfStats::registeredLatency;
 
 /**
  * This method must be called to make a PerfStats structure "known" so that
@@ -83,6 +89,8 @@ PerfStats::collectStats(PerfStats* total)
         total->readCount += stats->readCount;
         total->readObjectBytes += stats->readObjectBytes;
         total->readKeyBytes += stats->readKeyBytes;
+        total->numaLocalReads += stats->numaLocalReads;
+        total->numaRemoteReads += stats->numaRemoteReads;
         total->writeCount += stats->writeCount;
         total->writeObjectBytes += stats->writeObjectBytes;
         total->writeKeyBytes += stats->writeKeyBytes;
@@ -123,6 +131,76 @@ PerfStats::collectStats(PerfStats* total)
     }
 }
 
+/**
+ * This method aggregates the RPC latency histograms and hardware counters
+ * from all of the threads that have recorded RPCs (see recordRpcLatency).
+ *
+ * \param[out] total
+ *      Filled in with the sum of all the per-thread histograms; any
+ *      existing contents are overwritten.
+ */
+void
+PerfStats::collectRpcLatency(RpcLatency* total)
+{
+    std::lock_guard<SpinLock> lock(mutex);
+    memset(total, 0, sizeof(*total));
+    foreach (RpcLatency* latency, registeredLatency) {
+        for (int i = 0; i < WireFormat::ILLEGAL_RPC_TYPE; i++) {
+            total->ops[i].queue.add(latency->ops[i].queue);
+            total->ops[i].service.add(latency->ops[i].service);
+            total->ops[i].counters.add(latency->ops[i].counters);
+        }
+    }
+}
+
+/**
+ * Collect the RPC latency histograms for this server and append them to
+ * a buffer, in the format used for GET_PERF_STATS responses: one
+ * LatencyRecord for each opcode that has been serviced at least once.
+ *
+ * \param buffer
+ *      The records are appended here.
+ *
+ * \return
+ *      The number of bytes appended to \a buffer.
+ */
+uint32_t
+PerfStats::appendRpcLatency(Buffer* buffer)
+{
+    std::unique_ptr<RpcLatency> total(new RpcLatency);
+    collectRpcLatency(total.get());
+    uint32_t length = 0;
+    for (int i = 0; i < WireFormat::ILLEGAL_RPC_TYPE; i++) {
+        if (total->ops[i].service.totalCount() == 0) {
+            continue;
+        }
+        LatencyRecord* record = buffer->emplaceAppend<LatencyRecord>();
+        record->opcode = i;
+        record->latency = total->ops[i];
+        length += sizeof32(LatencyRecord);
+    }
+    return length;
+}
+
+/**
+ * Allocate the RPC latency histograms for the current thread and make
+ * them known to collectRpcLatency. Invoked by recordRpcLatency the first
+ * time a thread records an RPC.
+ *
+ * \return
+ *      The new histograms (also stored in threadLatency).
+ */
+PerfStats::RpcLatency*
+PerfStats::registerLatency()
+{
+    RpcLatency* latency = new RpcLatency;
+    memset(latency, 0, sizeof(*latency));
+    std::lock_guard<SpinLock> lock(mutex);
+    registeredLatency.push_back(latency);
+    threadLatency = latency;
+    return latency;
+}
+
 /**
  * Given two collections of cluster PerfStats, computes the changes from
  * the first collection to the second and formats it for printing.
@@ -189,6 +267,9 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
     result.append(format("%-30s %s\n", "  Total MB/s (objects & keys)",
             formatMetricRate(&diff, "readBytesObjectsAndKeys",
             " %8.2f", 1e-6).c_str()));
+    result.append(format("%-30s %s\n", "  NUMA-remote reads (%)",
+            formatMetricRatio(&diff, "numaRemoteReads", "readCount",
+            " %8.1f", 100).c_str()));
 
     result.append("\nWrites:\n");
     result.append(format("%-30s %s\n", "  Objects written (K)",
@@ -304,6 +385,68 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
     result.append(format("%-30s %s\n", "  Output bytes (MB/s)",
             formatMetricRate(&diff, "networkOutputBytes",
             " %8.2f", 1e-6).c_str()));
+
+    // Latency percentiles for each opcode that was serviced during the
+    // interval (see clusterDiff for the names of these metrics).
+    std::vector<string> opcodes;
+    for (Diff::iterator it = diff.begin(); it != diff.end(); it++) {
+        const string& name = it->first;
+        if ((name.compare(0, 4, "rpc.") != 0) || (name.length() < 10) ||
+                (name.compare(name.length() - 6, 6, ".count") != 0)) {
+            continue;
+        }
+        foreach (double count, it->second) {
+            if (count != 0) {
+                opcodes.push_back(name.substr(4, name.length() - 10));
+                break;
+            }
+        }
+    }
+    std::sort(opcodes.begin(), opcodes.end());
+    if (!opcodes.empty()) {
+        result.append("\nRPC latency (us):\n");
+    }
+    foreach (string& opcode, opcodes) {
+        string prefix = "rpc." + opcode + ".";
+        result.append(format("%-30s %s\n",
+                format("  %s RPCs (K)", opcode.c_str()).c_str(),
+                formatMetric(&diff, (prefix + "count").c_str(),
+                " %8.1f", 1e-3).c_str()));
+        result.append(format("%-30s %s\n",
+                format("  %s queue p50", opcode.c_str()).c_str(),
+                formatMetric(&diff, (prefix + "queueP50").c_str(),
+                " %8.1f").c_str()));
+        result.append(format("%-30s %s\n",
+                format("  %s queue p99", opcode.c_str()).c_str(),
+                formatMetric(&diff, (prefix + "queueP99").c_str(),
+                " %8.1f").c_str()));
+        result.append(format("%-30s %s\n",
+                format("  %s service p50", opcode.c_str()).c_str(),
+                formatMetric(&diff, (prefix + "serviceP50").c_str(),
+                " %8.1f").c_str()));
+        result.append(format("%-30s %s\n",
+                format("  %s service p99", opcode.c_str()).c_str(),
+                formatMetric(&diff, (prefix + "serviceP99").c_str(),
+                " %8.1f").c_str()));
+        result.append(format("%-30s %s\n",
+                format("  %s service p99.9", opcode.c_str()).c_str(),
+                formatMetric(&diff, (prefix + "serviceP999").c_str(),
+                " %8.1f").c_str()));
+        if (diff.find(prefix + "instructions") != diff.end()) {
+            result.append(format("%-30s %s\n",
+                    format("  %s instructions/RPC", opcode.c_str()).c_str(),
+                    formatMetric(&diff, (prefix + "instructions").c_str(),
+                    " %8.0f").c_str()));
+            result.append(format("%-30s %s\n",
+                    format("  %s LLC misses/RPC", opcode.c_str()).c_str(),
+                    formatMetric(&diff, (prefix + "llcMisses").c_str(),
+                    " %8.1f").c_str()));
+            result.append(format("%-30s %s\n",
+                    format("  %s branch misses/RPC", opcode.c_str()).c_str(),
+                    formatMetric(&diff, (prefix + "branchMisses").c_str(),
+                    " %8.1f").c_str()));
+        }
+    }
     return result;
 }
 
@@ -322,7 +465,15 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
  *      Contents are replaced with information about how much each
  *      performance metric changed between the before and after
  *      measurements. See the declaration of Diff for details
- *      on the format of this information.
+ *      on the format of this information. In addition, for each
+ *      opcode X for which latency information is available, there
+ *      are entries "rpc.X.count" (number of RPCs serviced between the
+ *      readings) and "rpc.X.queueP50", "rpc.X.queueP99",
+ *      "rpc.X.serviceP50", "rpc.X.serviceP99", and "rpc.X.serviceP999"
+ *      (latency percentiles for those RPCs, in microseconds). If any
+ *      server collected hardware counters, there are also entries
+ *      "rpc.X.instructions", "rpc.X.llcMisses", and "rpc.X.branchMisses"
+ *      (average counts per RPC).
  */
 void
 PerfStats::clusterDiff(Buffer* before, Buffer* after,
@@ -330,8 +481,22 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
 {
     // First, parse each of the two readings.
     std::vector<PerfStats> firstStats, secondStats;
-    parseStats(before, &firstStats);
-    parseStats(after, &secondStats);
+    std::vector<LatencyMap> firstLatency, secondLatency;
+    parseStats(before, &firstStats, &firstLatency);
+    parseStats(after, &secondStats, &secondLatency);
+
+    // Find all of the opcodes for which any server has latency information,
+    // and whether any server collected hardware counters.
+    std::set<int> opcodes;
+    bool haveCounters = false;
+    foreach (LatencyMap& map, secondLatency) {
+        for (LatencyMap::iterator it = map.begin(); it != map.end(); it++) {
+            opcodes.insert(it->first);
+            if (it->second.counters.rpcs != 0) {
+                haveCounters = true;
+            }
+        }
+    }
 
     // Each iteration of the following loop processes one server, appending
     // information to the response.
@@ -357,6 +522,8 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
         ADD_METRIC(readCount);
         ADD_METRIC(readObjectBytes);
         ADD_METRIC(readKeyBytes);
+        ADD_METRIC(numaLocalReads);
+        ADD_METRIC(numaRemoteReads);
         ADD_METRIC(writeCount);
         ADD_METRIC(writeObjectBytes);
         ADD_METRIC(writeKeyBytes);
@@ -394,6 +561,51 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
         ADD_METRIC(temp3);
         ADD_METRIC(temp4);
         ADD_METRIC(temp5);
+
+        // Latency percentiles for RPCs serviced between the two readings.
+        double microsPerCycle = 1e06 / p1.cyclesPerSecond;
+        foreach (int opcode, opcodes) {
+            OpLatency latency;
+            memset(&latency, 0, sizeof(latency));
+            LatencyMap::iterator it = secondLatency[i].find(opcode);
+            if (it != secondLatency[i].end()) {
+                latency = it->second;
+            }
+            it = firstLatency[i].find(opcode);
+            if (it != firstLatency[i].end()) {
+                latency.queue.subtract(it->second.queue);
+                latency.service.subtract(it->second.service);
+                latency.counters.subtract(it->second.counters);
+            }
+            string prefix = format("rpc.%s.", WireFormat::opcodeSymbol(
+                    downCast<uint32_t>(opcode)));
+            (*diff)[prefix + "count"].push_back(
+                    static_cast<double>(latency.service.totalCount()));
+            (*diff)[prefix + "queueP50"].push_back(microsPerCycle *
+                    static_cast<double>(latency.queue.getPercentile(50)));
+            (*diff)[prefix + "queueP99"].push_back(microsPerCycle *
+                    static_cast<double>(latency.queue.getPercentile(99)));
+            (*diff)[prefix + "serviceP50"].push_back(microsPerCycle *
+                    static_cast<double>(latency.service.getPercentile(50)));
+            (*diff)[prefix + "serviceP99"].push_back(microsPerCycle *
+                    static_cast<double>(latency.service.getPercentile(99)));
+            (*diff)[prefix + "serviceP999"].push_back(microsPerCycle *
+                    static_cast<double>(latency.service.getPercentile(99.9)));
+            if (haveCounters) {
+                // Hardware counters are reported as averages per RPC.
+                OpCounters& counters = latency.counters;
+                double rpcs = static_cast<double>(counters.rpcs);
+                if (rpcs == 0) {
+                    rpcs = 1;
+                }
+                (*diff)[prefix + "instructions"].push_back(
+                        static_cast<double>(counters.instructions) / rpcs);
+                (*diff)[prefix + "llcMisses"].push_back(
+                        static_cast<double>(counters.llcMisses) / rpcs);
+                (*diff)[prefix + "branchMisses"].push_back(
+                        static_cast<double>(counters.branchMisses) / rpcs);
+            }
+        }
     }
 }
 
@@ -408,11 +620,19 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
  *      Filled in (possibly sparsely) with contents parsed from rawData.
  *      Entry i will contain PerfStats for the server whose ServerId has
  *      indexNumber i. Empty entries have 0 collectionTimes.
+ * \param[out] latency
+ *      If non-NULL, filled in with the RPC latency information that
+ *      followed the PerfStats for each server; it is indexed in the same
+ *      way as \a results.
  */
 void
-PerfStats::parseStats(Buffer* rawData, std::vector<PerfStats>* results)
+PerfStats::parseStats(Buffer* rawData, std::vector<PerfStats>* results,
+        std::vector<LatencyMap>* latency)
 {
     results->clear();
+    if (latency != NULL) {
+        latency->clear();
+    }
     uint32_t offset = sizeof(WireFormat::ServerControlAll::Response);
     while (offset < rawData->size()) {
         WireFormat::ServerControl::Response* header =
@@ -425,9 +645,25 @@ PerfStats::parseStats(Buffer* rawData, std::vector<PerfStats>* results)
         uint32_t i = ServerId(header->serverId).indexNumber();
         if (i >= results->size()) {
             results->resize(i+1);
+            if (latency != NULL) {
+                latency->resize(i+1);
+            }
+        }
+        uint32_t length = header->outputLength;
+        rawData->copy(offset, std::min(length, sizeof32(PerfStats)),
+                &results->at(i));
+        if (latency != NULL) {
+            uint32_t recordOffset = offset + sizeof32(PerfStats);
+            while ((recordOffset + sizeof32(LatencyRecord))
+                    <= (offset + length)) {
+                LatencyRecord* record =
+                        rawData->getOffset<LatencyRecord>(recordOffset);
+                (*latency)[i][downCast<int>(record->opcode)] =
+                        record->latency;
+                recordOffset += sizeof32(LatencyRecord);
+            }
         }
-        rawData->copy(offset, header->outputLength, &results->at(i));
-        offset += header->outputLength;
+        offset += length;
     }
 }
 
@@ -16,10 +16,13 @@
 #ifndef RAMCLOUD_PERFSTATS_H
 #define RAMCLOUD_PERFSTATS_H
 
+#include <map>
 #include <unordered_map>
 #include <vector>
 #include "Buffer.h"
+#include "LatencyHistogram.h"
 #include "SpinLock.h"
+#include "WireFormat.h"
 
 namespace RAMCloud {
 
@@ -39,6 +42,10 @@ namespace RAMCloud {
  *
  * This class should eventually replace RawMetrics because it is more
  * efficient (due to its use of thread-local structures).
+ *
+ * Latency distributions for RPCs are kept separately from the counters,
+ * in RpcLatency structures, because they are too large to live in
+ * thread-local storage; see recordRpcLatency.
  */
 struct PerfStats {
     /// Unique identifier for this thread (threads are numbered starting
@@ -68,6 +75,12 @@ struct PerfStats {
     /// metadata).
     uint64_t readKeyBytes;
 
+    /// Number of objects read whose log memory was on the same NUMA node
+    /// as the worker thread reading them, and on a different node. Only
+    /// counted by NUMA-aware masters (see ServerConfig::Master::numaAware).
+    uint64_t numaLocalReads;
+    uint64_t numaRemoteReads;
+
     /// Total number of RAMCloud objects written (each object in a multi-write
     /// operation counts as one).
     uint64_t writeCount;
@@ -262,6 +275,147 @@ struct PerfStats {
     uint64_t temp4;
     uint64_t temp5;
 
+    //--------------------------------------------------------------------
+    // RPC latency distributions and hardware counters. These are not
+    // stored in PerfStats objects themselves (see recordRpcLatency);
+    // collectStats doesn't include them.
+    //--------------------------------------------------------------------
+
+    /**
+     * Totals of hardware performance counters (see HardwareCounters) for
+     * the RPCs with one particular opcode, measured while worker threads
+     * executed the RPCs. All zero unless the server enabled counters.
+     */
+    struct OpCounters {
+        /// Number of RPCs for which the counters below were measured.
+        uint64_t rpcs;
+
+        /// Instructions retired.
+        uint64_t instructions;
+
+        /// Last-level cache misses.
+        uint64_t llcMisses;
+
+        /// Mispredicted branches.
+        uint64_t branchMisses;
+
+        void
+        add(const OpCounters& other)
+        {
+            rpcs += other.rpcs;
+            instructions += other.instructions;
+            llcMisses += other.llcMisses;
+            branchMisses += other.branchMisses;
+        }
+
+        void
+        subtract(const OpCounters& earlier)
+        {
+            rpcs -= earlier.rpcs;
+            instructions -= earlier.instructions;
+            llcMisses -= earlier.llcMisses;
+            branchMisses -= earlier.branchMisses;
+        }
+    };
+
+    /**
+     * Latency histograms and hardware counters for the RPCs with one
+     * particular opcode.
+     */
+    struct OpLatency {
+        /// Time from when the dispatch thread received a request until a
+        /// worker thread started executing it.
+        LatencyHistogram queue;
+
+        /// Time that a worker thread spent executing the request.
+        LatencyHistogram service;
+
+        /// Hardware counters for the RPCs (see recordRpcCounters).
+        OpCounters counters;
+    };
+
+    /**
+     * Latency histograms and hardware counters for all of the RPCs
+     * serviced by one thread (or, as returned by collectRpcLatency, by all
+     * threads in a server).
+     */
+    struct RpcLatency {
+        OpLatency ops[WireFormat::ILLEGAL_RPC_TYPE];
+    };
+
+    /**
+     * The response to a GET_PERF_STATS server control consists of a
+     * PerfStats object followed by one of these for each opcode that has
+     * been serviced at least once.
+     */
+    struct LatencyRecord {
+        uint64_t opcode;
+        OpLatency latency;
+    };
+
+    /// Latency information for the opcodes serviced by one server, keyed
+    /// by opcode, as returned by parseStats.
+    typedef std::map<int, OpLatency> LatencyMap;
+
+    /**
+     * Record the queueing and service times for an RPC serviced by the
+     * current thread. This is invoked once for each RPC, so it must be
+     * fast; the first call in each thread allocates that thread's
+     * histograms.
+     *
+     * \param opcode
+     *      Opcode of the RPC.
+     * \param queueCycles
+     *      Time (in Cycles::rdtsc ticks) the request waited before a worker
+     *      started executing it.
+     * \param serviceCycles
+     *      Time (in Cycles::rdtsc ticks) spent executing the request.
+     */
+    static void
+    recordRpcLatency(WireFormat::Opcode opcode, uint64_t queueCycles,
+            uint64_t serviceCycles)
+    {
+        RpcLatency* latency = threadLatency;
+        if (expect_false(latency == NULL)) {
+            latency = registerLatency();
+        }
+        OpLatency& op = latency->ops[opcode];
+        op.queue.record(queueCycles);
+        op.service.record(serviceCycles);
+    }
+
+    /**
+     * Record hardware performance counter values for an RPC serviced by
+     * the current thread. Used only when hardware counters are enabled
+     * (see HardwareCounters).
+     *
+     * \param opcode
+     *      Opcode of the RPC.
+     * \param instructions
+     *      Instructions retired while executing the RPC.
+     * \param llcMisses
+     *      Last-level cache misses while executing the RPC.
+     * \param branchMisses
+     *      Mispredicted branches while executing the RPC.
+     */
+    static void
+    recordRpcCounters(WireFormat::Opcode opcode, uint64_t instructions,
+            uint64_t llcMisses, uint64_t branchMisses)
+    {
+        RpcLatency* latency = threadLatency;
+        if (expect_false(latency == NULL)) {
+            latency = registerLatency();
+        }
+        OpCounters& counters = latency->ops[opcode].counters;
+        counters.rpcs++;
+        counters.instructions += instructions;
+        counters.llcMisses += llcMisses;
+        counters.branchMisses += branchMisses;
+    }
+
+    static uint32_t appendRpcLatency(Buffer* buffer);
+    static void collectRpcLatency(RpcLatency* total);
+
     //--------------------------------------------------------------------
     // Miscellaneous information
     //--------------------------------------------------------------------
@@ -299,7 +453,9 @@ struct PerfStats {
     static __thread PerfStats threadStats;
 
   PRIVATE:
-    static void parseStats(Buffer* rawData, std::vector<PerfStats>* results);
+    static void parseStats(Buffer* rawData, std::vector<PerfStats>* results,
+            std::vector<LatencyMap>* latency = NULL);
+    static RpcLatency* registerLatency();
 
     /// Used in a monitor-style fashion for mutual exclusion.
     static SpinLock mutex;
@@ -313,6 +469,15 @@ struct PerfStats {
     /// Next value to assign for the threadId member variable.  Used only
     /// by RegisterStats.
     static int nextThreadId;
+
+    /// Latency histograms for the current thread; NULL until the thread
+    /// records its first RPC.
+    static __thread RpcLatency* threadLatency;
+
+    /// All of the RpcLatency structures that have been allocated by
+    /// registerLatency. They are never freed, so that collectRpcLatency
+    /// can safely read them even after their threads have exited.
+    static std::vector<RpcLatency*> registeredLatency;
 };
 
 } // end RAMCloud
@@ -30,6 +30,8 @@ class PerfStatsTest : public ::testing::Test {
         : stats()
     {
         PerfStats::registeredStats.clear();
+        PerfStats::registeredLatency.clear();
+        PerfStats::threadLatency = NULL;
     }
 
     ~PerfStatsTest()
@@ -106,6 +108,26 @@ class PerfStatsTest : public ::testing::Test {
         va_end(args);
     }
 
+    /**
+     * Create a serverControlAll(GET_PERF_STATS) response for a single
+     * server (index 1), in which the PerfStats are followed by latency
+     * information for READ requests.
+     */
+    void
+    statsWithLatency(Buffer* buffer, PerfStats* stats,
+            PerfStats::OpLatency* latency)
+    {
+        combineStats(buffer, stats, ServerId(1, 0).getId(), NULL);
+        WireFormat::ServerControl::Response* subHead = buffer->getOffset<
+                WireFormat::ServerControl::Response>(
+                sizeof32(WireFormat::ServerControlAll::Response));
+        PerfStats::LatencyRecord* record =
+                buffer->emplaceAppend<PerfStats::LatencyRecord>();
+        record->opcode = WireFormat::READ;
+        record->latency = *latency;
+        subHead->outputLength += sizeof32(*record);
+    }
+
     DISALLOW_COPY_AND_ASSIGN(PerfStatsTest);
 };
 
@@ -161,6 +183,63 @@ TEST_F(PerfStatsTest, collectStats) {
     EXPECT_EQ(220u, total.writeCount);
 }
 
+TEST_F(PerfStatsTest, recordRpcLatency) {
+    PerfStats::recordRpcLatency(WireFormat::READ, 1000, 5000);
+    PerfStats::recordRpcLatency(WireFormat::READ, 1000, 5000);
+    PerfStats::recordRpcLatency(WireFormat::WRITE, 0, 100000);
+    ASSERT_EQ(1u, PerfStats::registeredLatency.size());
+    PerfStats::RpcLatency* latency = PerfStats::threadLatency;
+    EXPECT_EQ(PerfStats::registeredLatency[0], latency);
+    EXPECT_EQ(2u, latency->ops[WireFormat::READ].queue.counts[
+            LatencyHistogram::bucket(1000)]);
+    EXPECT_EQ(2u, latency->ops[WireFormat::READ].service.counts[
+            LatencyHistogram::bucket(5000)]);
+    EXPECT_EQ(1u, latency->ops[WireFormat::WRITE].service.totalCount());
+    EXPECT_EQ(0u, latency->ops[WireFormat::REMOVE].service.totalCount());
+}
+
+TEST_F(PerfStatsTest, recordRpcCounters) {
+    PerfStats::recordRpcCounters(WireFormat::READ, 1000, 10, 3);
+    PerfStats::recordRpcCounters(WireFormat::READ, 2000, 20, 4);
+    ASSERT_EQ(1u, PerfStats::registeredLatency.size());
+    PerfStats::OpCounters& counters =
+            PerfStats::threadLatency->ops[WireFormat::READ].counters;
+    EXPECT_EQ(2u, counters.rpcs);
+    EXPECT_EQ(3000u, counters.instructions);
+    EXPECT_EQ(30u, counters.llcMisses);
+    EXPECT_EQ(7u, counters.branchMisses);
+}
+
+// Helper function for the following test.
+static void testRecordLatency() {
+    PerfStats::recordRpcLatency(WireFormat::READ, 0, 5000);
+}
+
+TEST_F(PerfStatsTest, collectRpcLatency) {
+    PerfStats::recordRpcLatency(WireFormat::READ, 0, 5000);
+    std::thread thread(testRecordLatency);
+    thread.join();
+    EXPECT_EQ(2u, PerfStats::registeredLatency.size());
+    std::unique_ptr<PerfStats::RpcLatency> total(new PerfStats::RpcLatency);
+    PerfStats::collectRpcLatency(total.get());
+    EXPECT_EQ(2u, total->ops[WireFormat::READ].service.counts[
+            LatencyHistogram::bucket(5000)]);
+    EXPECT_EQ(0u, total->ops[WireFormat::WRITE].service.totalCount());
+}
+
+TEST_F(PerfStatsTest, appendRpcLatency) {
+    Buffer buffer;
+    EXPECT_EQ(0u, PerfStats::appendRpcLatency(&buffer));
+    PerfStats::recordRpcLatency(WireFormat::WRITE, 0, 5000);
+    PerfStats::recordRpcLatency(WireFormat::READ, 0, 5000);
+    EXPECT_EQ(2*sizeof32(PerfStats::LatencyRecord),
+            PerfStats::appendRpcLatency(&buffer));
+    PerfStats::LatencyRecord* record =
+            buffer.getStart<PerfStats::LatencyRecord>();
+    EXPECT_EQ(WireFormat::READ, record->opcode);
+    EXPECT_EQ(1u, record->latency.service.totalCount());
+}
+
 TEST_F(PerfStatsTest, clusterDiff_findMatchingData) {
     // Test code that skips entries where either before or after
     // data is missing.
@@ -217,6 +296,96 @@ TEST_F(PerfStatsTest, parseStats_basics) {
     EXPECT_EQ(2000u, parsed[2].readCount);
     EXPECT_EQ(15000u, parsed[5].temp5);
 }
+TEST_F(PerfStatsTest, clusterDiff_latency) {
+    PerfStats stats1, stats2;
+    fill(&stats1, 1000);
+    fill(&stats2, 2000);
+    PerfStats::OpLatency latency;
+    memset(&latency, 0, sizeof(latency));
+    latency.service.record(100000);
+    Buffer before, after;
+    statsWithLatency(&before, &stats1, &latency);
+    for (int i = 0; i < 9; i++) {
+        latency.service.record(3000);
+        latency.queue.record(0);
+    }
+    statsWithLatency(&after, &stats2, &latency);
+
+    PerfStats::Diff diff;
+    PerfStats::clusterDiff(&before, &after, &diff);
+    ASSERT_EQ(1u, diff["rpc.READ.count"].size());
+    EXPECT_EQ(9.0, diff["rpc.READ.count"][0]);
+
+    // One cycle is one microsecond (see fill).
+    LatencyHistogram expected;
+    memset(&expected, 0, sizeof(expected));
+    expected.record(3000);
+    EXPECT_EQ(static_cast<double>(expected.getPercentile(50)),
+            diff["rpc.READ.serviceP50"][0]);
+    EXPECT_EQ(static_cast<double>(expected.getPercentile(99)),
+            diff["rpc.READ.serviceP999"][0]);
+    EXPECT_EQ(0.0, diff["rpc.READ.queueP99"][0]);
+    EXPECT_EQ(0u, diff.count("rpc.WRITE.count"));
+
+    string output = PerfStats::printClusterStats(&before, &after);
+    EXPECT_TRUE(TestUtil::contains(output,
+            "RPC latency (us):\n  READ RPCs (K)"));
+    EXPECT_TRUE(TestUtil::contains(output, "  READ service p99.9"));
+}
+
+TEST_F(PerfStatsTest, clusterDiff_counters) {
+    PerfStats stats1, stats2;
+    fill(&stats1, 1000);
+    fill(&stats2, 2000);
+    PerfStats::OpLatency latency;
+    memset(&latency, 0, sizeof(latency));
+    Buffer before, after;
+    statsWithLatency(&before, &stats1, &latency);
+
+    // No counters collected: no counter metrics.
+    PerfStats::Diff diff;
+    PerfStats::clusterDiff(&before, &before, &diff);
+    EXPECT_EQ(0u, diff.count("rpc.READ.instructions"));
+
+    latency.service.record(3000);
+    latency.service.record(3000);
+    latency.counters.rpcs = 2;
+    latency.counters.instructions = 5000;
+    latency.counters.llcMisses = 41;
+    latency.counters.branchMisses = 6;
+    statsWithLatency(&after, &stats2, &latency);
+    diff.clear();
+    PerfStats::clusterDiff(&before, &after, &diff);
+    ASSERT_EQ(1u, diff["rpc.READ.instructions"].size());
+    EXPECT_EQ(2500.0, diff["rpc.READ.instructions"][0]);
+    EXPECT_EQ(20.5, diff["rpc.READ.llcMisses"][0]);
+    EXPECT_EQ(3.0, diff["rpc.READ.branchMisses"][0]);
+
+    string output = PerfStats::printClusterStats(&before, &after);
+    EXPECT_TRUE(TestUtil::contains(output,
+            "  READ LLC misses/RPC               20.5"));
+}
+
+TEST_F(PerfStatsTest, parseStats_latency) {
+    PerfStats stats1;
+    fill(&stats1, 1000);
+    PerfStats::OpLatency latency;
+    memset(&latency, 0, sizeof(latency));
+    latency.service.record(3000);
+    Buffer buffer;
+    statsWithLatency(&buffer, &stats1, &latency);
+
+    std::vector<PerfStats> parsed;
+    std::vector<PerfStats::LatencyMap> parsedLatency;
+    PerfStats::parseStats(&buffer, &parsed, &parsedLatency);
+    ASSERT_EQ(2u, parsed.size());
+    ASSERT_EQ(2u, parsedLatency.size());
+    EXPECT_EQ(10000u, parsed[1].collectionTime);
+    EXPECT_EQ(0u, parsedLatency[0].size());
+    ASSERT_EQ(1u, parsedLatency[1].size());
+    EXPECT_EQ(1u, parsedLatency[1][WireFormat::READ].service.totalCount());
+}
+
 TEST_F(PerfStatsTest, parseStats_shortBuffer) {
     PerfStats stats;
     fill(&stats, 1000);
@@ -20,6 +20,7 @@
 #include "CycleCounter.h"
 #include "Cycles.h"
 #include "MasterService.h"
+#include "MetricsRegistry.h"
 #include "RawMetrics.h"
 #include "ShortMacros.h"
 #include "PerfStats.h"
@@ -274,6 +275,27 @@ PingService::serverControl(const WireFormat::ServerControl::Request* reqHdr,
                    ->getMemoryStats(&stats);
             respHdr->outputLength = sizeof32(stats);
             rpc->replyPayload->appendCopy(&stats, respHdr->outputLength);
+            respHdr->outputLength +=
+                    PerfStats::appendRpcLatency(rpc->replyPayload);
+            break;
+        }
+        case WireFormat::GET_HOT_KEYS:
+        {
+            // Servers without a MasterService return no output.
+            if (context->getMasterService() == NULL)
+                break;
+            uint32_t limit = 10;
+            if (reqHdr->inputLength >= sizeof32(limit)) {
+                limit = *rpc->requestPayload->getOffset<uint32_t>(reqOffset);
+            }
+            respHdr->outputLength = context->getMasterService()->
+                    hotKeyTracker.appendHotKeys(rpc->replyPayload, limit);
+            break;
+        }
+        case WireFormat::GET_METRICS_SNAPSHOT:
+        {
+            respHdr->outputLength =
+                    context->metricsRegistry->appendSnapshot(rpc->replyPayload);
             break;
         }
         case WireFormat::GET_TIME_TRACE:
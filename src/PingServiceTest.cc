@@ -515,6 +515,24 @@ TEST_F(PingServiceTest, serverControl_DipatchProfilerBasics) {
                  , UnimplementedRequestError);
 }
 
+TEST_F(PingServiceTest, serverControl_getHotKeys) {
+    Buffer output;
+
+    // No MasterService: no output.
+    PingClient::serverControl(&context, serverId, WireFormat::GET_HOT_KEYS,
+            NULL, 0, &output);
+    EXPECT_EQ(0U, output.size());
+
+    addMasterService();
+    uint32_t limit = 5;
+    PingClient::serverControl(&context, serverId, WireFormat::GET_HOT_KEYS,
+            &limit, sizeof32(limit), &output);
+    HotKeyTracker::Report report;
+    EXPECT_TRUE(HotKeyTracker::parseHotKeys(&output, 0, output.size(),
+            &report));
+    EXPECT_EQ(0U, report.header.totalOps);
+}
+
 TEST_F(PingServiceTest, serverControl_DispatchProfilerExceptions) {
     Buffer output;
     uint32_t totalElements = 10000000;
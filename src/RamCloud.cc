@@ -1699,6 +1699,7 @@ MigrateTabletRpc::MigrateTabletRpc(RamCloud* ramcloud, uint64_t tableId,
     reqHdr->firstKeyHash = firstKeyHash;
     reqHdr->lastKeyHash = lastKeyHash;
     reqHdr->newOwnerMasterId = newOwnerMasterId.getId();
+    reqHdr->pull = 0;
     send();
 }
 
@@ -1876,6 +1877,8 @@ ReadRpc::ReadRpc(RamCloud* ramcloud, uint64_t tableId,
         const RejectRules* rejectRules)
     : ObjectRpcWrapper(ramcloud->clientContext, tableId, key, keyLength,
             sizeof(WireFormat::Read::Response), value)
+    , allowHotReplica(rejectRules == NULL)
+    , sentToHotReplica(false)
 {
     value->reset();
     WireFormat::Read::Request* reqHdr(allocHeader<WireFormat::Read>());
@@ -1905,10 +1908,82 @@ ReadRpc::wait(uint64_t* version)
     if (respHdr->common.status != STATUS_OK)
         ClientException::throwException(HERE, respHdr->common.status);
 
+    // If the object is hot, the owner lists the masters that hold copies of
+    // it after the object data; remember them for future reads.
+    uint32_t length = respHdr->length;
+    uint32_t numHotReplicas = respHdr->numHotReplicas;
+    if (respHdr->hotReplicasLength != 0) {
+        vector<string> locators;
+        uint32_t offset = sizeof32(*respHdr) + length;
+        for (uint32_t i = 0; i < numHotReplicas; i++) {
+            const uint16_t* locatorLength =
+                    response->getOffset<uint16_t>(offset);
+            if (locatorLength == NULL)
+                break;
+            offset += sizeof32(*locatorLength);
+            const char* locator = static_cast<const char*>(
+                    response->getRange(offset, *locatorLength));
+            if (locator == NULL)
+                break;
+            locators.emplace_back(locator, *locatorLength);
+            offset += *locatorLength;
+        }
+        context->objectFinder->setHotReplicas(tableId, keyHash, locators);
+        response->truncate(sizeof32(*respHdr) + length);
+    }
+
     // Truncate the response Buffer so that it consists of nothing
     // but the object data.
     response->truncateFront(sizeof(*respHdr));
-    assert(respHdr->length == response->size());
+    assert(length == response->size());
+}
+
+// See RpcWrapper for documentation.
+bool
+ReadRpc::checkStatus()
+{
+    if (sentToHotReplica && responseHeader->status == STATUS_UNKNOWN_TABLET) {
+        // The master no longer has a copy of the object; go to the owner.
+        context->objectFinder->flushHotReplicas(tableId, keyHash);
+        allowHotReplica = false;
+        send();
+        return false;
+    }
+    return ObjectRpcWrapper::checkStatus();
+}
+
+// See RpcWrapper for documentation.
+bool
+ReadRpc::handleTransportError()
+{
+    if (sentToHotReplica) {
+        // Don't give up on the owner just because a replica is unreachable.
+        context->objectFinder->flushHotReplicas(tableId, keyHash);
+        allowHotReplica = false;
+        session = NULL;
+        send();
+        return false;
+    }
+    return ObjectRpcWrapper::handleTransportError();
+}
+
+// See RpcWrapper for documentation.
+void
+ReadRpc::send()
+{
+    sentToHotReplica = false;
+    if (allowHotReplica) {
+        Transport::SessionRef replica =
+                context->objectFinder->lookupHotReplica(tableId, keyHash);
+        if (replica) {
+            sentToHotReplica = true;
+            session = replica;
+            state = IN_PROGRESS;
+            session->sendRequest(&request, response, this);
+            return;
+        }
+    }
+    ObjectRpcWrapper::send();
 }
 
 /**
@@ -2624,16 +2699,19 @@ RamCloud::testingWaitForAllTabletsNormal(uint64_t tableId, uint64_t timeoutNs)
  * \param async
  *      If true, the new object will not be immediately replicated to backups.
  *      Data loss may occur!
+ * \param ttl
+ *      If nonzero, the object expires this many seconds after the write:
+ *      from then on, reads treat it as if it had been deleted.
  *
  * \exception RejectRulesException
  */
 void
 RamCloud::write(uint64_t tableId, const void* key, uint16_t keyLength,
         const void* buf, uint32_t length, const RejectRules* rejectRules,
-        uint64_t* version, bool async)
+        uint64_t* version, bool async, uint32_t ttl)
 {
     WriteRpc rpc(this, tableId, key, keyLength, buf, length, rejectRules,
-            async);
+            async, ttl);
     rpc.wait(version);
 }
 
@@ -2810,10 +2888,13 @@ RamCloud::write(uint64_t tableId, uint8_t numKeys, KeyInfo *keyList,
  * \param async
  *      If true, the new object will not be immediately replicated to backups.
  *      Data loss may occur!
+ * \param ttl
+ *      If nonzero, the object expires this many seconds after the write:
+ *      from then on, reads treat it as if it had been deleted.
  */
 WriteRpc::WriteRpc(RamCloud* ramcloud, uint64_t tableId,
         const void* key, uint16_t keyLength, const void* buf, uint32_t length,
-        const RejectRules* rejectRules, bool async)
+        const RejectRules* rejectRules, bool async, uint32_t ttl)
     : LinearizableObjectRpcWrapper(ramcloud, true, tableId, key,
             keyLength, sizeof(WireFormat::Write::Response))
 {
@@ -2835,6 +2916,7 @@ WriteRpc::WriteRpc(RamCloud* ramcloud, uint64_t tableId,
     reqHdr->rejectRules = rejectRules ? *rejectRules : defaultRejectRules;
     reqHdr->async = async;
     reqHdr->length = totalLength;
+    reqHdr->ttl = ttl;
 
     fillLinearizabilityHeader<WireFormat::Write::Request>(reqHdr);
 
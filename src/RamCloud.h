@@ -146,7 +146,7 @@ class RamCloud {
     void write(uint64_t tableId, const void* key, uint16_t keyLength,
             const void* buf, uint32_t length,
             const RejectRules* rejectRules = NULL, uint64_t* version = NULL,
-            bool async = false);
+            bool async = false, uint32_t ttl = 0);
     void write(uint64_t tableId, const void* key, uint16_t keyLength,
             const char* value, const RejectRules* rejectRules = NULL,
             uint64_t* version = NULL, bool async = false);
@@ -920,7 +920,20 @@ class ReadRpc : public ObjectRpcWrapper {
     ~ReadRpc() {}
     void wait(uint64_t* version = NULL);
 
+  PROTECTED:
+    virtual bool checkStatus();
+    virtual bool handleTransportError();
+    virtual void send();
+
   PRIVATE:
+    /// True means the request may be sent to a master holding a read-only
+    /// copy of the object, rather than its owner (see HotKeyReplicas).
+    bool allowHotReplica;
+
+    /// True means the request was most recently sent to a master holding a
+    /// copy of the object rather than its owner.
+    bool sentToHotReplica;
+
     DISALLOW_COPY_AND_ASSIGN(ReadRpc);
 };
 
@@ -1028,7 +1041,8 @@ class WriteRpc : public LinearizableObjectRpcWrapper {
   public:
     WriteRpc(RamCloud* ramcloud, uint64_t tableId, const void* key,
             uint16_t keyLength, const void* buf, uint32_t length,
-            const RejectRules* rejectRules = NULL, bool async = false);
+            const RejectRules* rejectRules = NULL, bool async = false,
+            uint32_t ttl = 0);
     // this constructor will be used when the object has multiple keys
     WriteRpc(RamCloud* ramcloud, uint64_t tableId,
             uint8_t numKeys, KeyInfo *keyInfo,
@@ -20,6 +20,7 @@
 #include "Recovery.h"
 #include "BackupClient.h"
 #include "Buffer.h"
+#include "Cycles.h"
 #include "MasterClient.h"
 #include "ParallelRun.h"
 #include "ShortMacros.h"
@@ -70,6 +71,7 @@ Recovery::Recovery(Context* context,
     , context(context)
     , crashedServerId(crashedServerId)
     , masterRecoveryInfo(recoveryInfo)
+    , phases(1)
     , dataToRecover()
     , tableManager(tableManager)
     , tracker(tracker)
@@ -81,6 +83,13 @@ Recovery::Recovery(Context* context,
     , numPartitions()
     , successfulRecoveryMasters()
     , unsuccessfulRecoveryMasters()
+    , recoveryMastersStartTime()
+    , fastestRecoveryMasterTicks(~0UL)
+    , slowestRecoveryMasterTicks()
+    , nextPartition()
+    , partitionBytes()
+    , recoveredBytes()
+    , partitionMasters()
     , testingBackupStartTaskSendCallback()
     , testingMasterStartTaskSendCallback()
     , testingBackupEndTaskSendCallback()
@@ -105,7 +114,9 @@ Recovery::~Recovery()
  * Splits tablets to ensure all tablets are less than the byte and record count
  * limits for a partition.  This will be called on the tablets to be recovered
  * before they are partitioned.  If a tablet is split, the resulting tablets
- * will be (best effort) the same "size" in both byte and record count.
+ * will be (best effort) the same "size" in both byte and record count: if the
+ * estimator has a key hash histogram for the tablet's table, the split points
+ * follow the histogram, otherwise the key hash range is divided evenly.
  *
  * \param tablets
  *      Pointer to vector of tablets to be split.  Modified to reflect any
@@ -124,6 +135,8 @@ Recovery::splitTablets(vector<Tablet> *tablets,
         return;
     }
 
+    const uint64_t byteLimit = PARTITION_MAX_BYTES / phases;
+    const uint64_t recordLimit = PARTITION_MAX_RECORDS / phases;
     size_t size = tablets->size();
     for (size_t i = 0; i < size; ++i) {
         Tablet* tablet = &tablets->at(i);
@@ -135,6 +148,11 @@ Recovery::splitTablets(vector<Tablet> *tablets,
         if (tableManager->isIndexletTable(tablet->tableId))
             continue;
 
+        // Tablets involved in a pull (see Tablet::pullSource) are tracked
+        // by their whole range at both ends of the pull.
+        if (tablet->pullSource.isValid())
+            continue;
+
         TableStats::Estimator::Estimate stats = estimator->estimate(tablet);
 
         uint64_t startKeyHash = tablet->startKeyHash;
@@ -146,11 +164,9 @@ Recovery::splitTablets(vector<Tablet> *tablets,
         // For this reason, we do not code for the case in which these values
         // will overflow.
         uint64_t byteTCount =
-                (stats.byteCount + Recovery::PARTITION_MAX_BYTES - 1)
-                / Recovery::PARTITION_MAX_BYTES;
+                (stats.byteCount + byteLimit - 1) / byteLimit;
         uint64_t recordTCount =
-                (stats.recordCount + Recovery::PARTITION_MAX_RECORDS - 1)
-                / Recovery::PARTITION_MAX_RECORDS;
+                (stats.recordCount + recordLimit - 1) / recordLimit;
         uint64_t tabletCount = std::max(byteTCount, recordTCount);
 
         // The number of splits should be one less than the number of resulting
@@ -164,7 +180,36 @@ Recovery::splitTablets(vector<Tablet> *tablets,
         // Recompute tabletCount in case it changed.
         tabletCount = splits + 1;
 
-        if (tabletCount > 1) {
+        if (tabletCount > 1 && estimator->hasHistogram(tablet->tableId)) {
+            // The estimator knows how the table's data is spread over its
+            // key hashes, so choose split points that give each resulting
+            // tablet an equal share of the data (rather than an equal share
+            // of the key hashes, which could leave one recovery master with
+            // far more work than the others).
+            Tablet remainder = *tablet;
+            vector<uint64_t> splitKeyHashes;
+            for (uint64_t piecesLeft = tabletCount; piecesLeft > 1 &&
+                    remainder.startKeyHash < remainder.endKeyHash;
+                    piecesLeft--) {
+                TableStats::Estimator::Estimate rest =
+                        estimator->estimate(&remainder);
+                remainder.startKeyHash = estimator->findSplit(&remainder,
+                        rest.byteCount / piecesLeft,
+                        rest.recordCount / piecesLeft);
+                splitKeyHashes.push_back(remainder.startKeyHash);
+            }
+
+            Tablet temp = *tablet;
+            tablet->endKeyHash = splitKeyHashes[0] - 1;
+            for (size_t j = 0; j < splitKeyHashes.size(); j++) {
+                temp.startKeyHash = splitKeyHashes[j];
+                temp.endKeyHash = (j + 1 < splitKeyHashes.size())
+                        ? splitKeyHashes[j + 1] - 1 : endKeyHash;
+                tableManager->splitRecoveringTablet(temp.tableId,
+                                                    temp.startKeyHash);
+                tablets->push_back(temp);
+            }
+        } else if (tabletCount > 1) {
             // Since the full key range is not always a multiple of the number
             // of desired tablets, some tablets may be 1 key range larger than
             // others.  We determine the number of "big" tablets needed by
@@ -229,14 +274,19 @@ struct Partition {
     uint64_t partitionId;    //< Id used to differentiate tablet partitions
     uint64_t byteCount;      //< Number of bytes assigned to this partition.
     uint64_t recordCount;    //< Number of records assigned to this partition.
+    uint64_t maxBytes;       //< Most bytes the partition may hold.
+    uint64_t maxRecords;     //< Most records the partition may hold.
 
     /**
-     * Constructs a new partition with partitionId.
+     * Constructs a new partition with partitionId that holds up to maxBytes
+     * and maxRecords.
      */
-    explicit Partition(uint64_t partitionId)
+    Partition(uint64_t partitionId, uint64_t maxBytes, uint64_t maxRecords)
         : partitionId(partitionId)
         , byteCount(0)
         , recordCount(0)
+        , maxBytes(maxBytes)
+        , maxRecords(maxRecords)
     {}
 
     /**
@@ -246,11 +296,9 @@ struct Partition {
      */
     double usage() {
         double byte2 = (double(byteCount) * double(byteCount))
-                       / (double(Recovery::PARTITION_MAX_BYTES)
-                          * double(Recovery::PARTITION_MAX_BYTES));
+                       / (double(maxBytes) * double(maxBytes));
         double record2 = (double(recordCount) * double(recordCount))
-                         / (double(Recovery::PARTITION_MAX_RECORDS)
-                            * double(Recovery::PARTITION_MAX_RECORDS));
+                         / (double(maxRecords) * double(maxRecords));
         return sqrt(byte2 + record2) / sqrt(2);
     }
 
@@ -263,10 +311,9 @@ struct Partition {
      *      determine if said tablet would fit in the partition.
      */
     bool fits(TableStats::Estimator::Estimate estimate) {
-        if ((byteCount + estimate.byteCount) > Recovery::PARTITION_MAX_BYTES)
+        if ((byteCount + estimate.byteCount) > maxBytes)
             return false;
-        if ((recordCount + estimate.recordCount) >
-                Recovery::PARTITION_MAX_RECORDS)
+        if ((recordCount + estimate.recordCount) > maxRecords)
             return false;
         return true;
     }
@@ -288,7 +335,9 @@ struct Partition {
 /**
  * Divides the tablets belonging to a master into partitions, where the number
  * of bytes and number of records in each partition is limited (to ensure fast
- * crash recovery) and there are as few partitions as possible.
+ * crash recovery), there are as few partitions as possible, and the partitions
+ * are as close to the same size as possible (so that no recovery master takes
+ * much longer than the others).
  *
  * Partitions are set by serializing the tablet entry into dataToRecover and
  * setting partitionId in the entry's "user_data".
@@ -304,6 +353,7 @@ Recovery::partitionTablets(vector<Tablet> tablets,
                            TableStats::Estimator* estimator)
 {
     numPartitions = 0;
+    partitionBytes.clear();
 
     // If no usable estimator is available, this method will perform a naive
     // partition where each tablet will be placed in its own partition.  This
@@ -324,46 +374,85 @@ Recovery::partitionTablets(vector<Tablet> tablets,
 
     splitTablets(&tablets, estimator);
 
-    // An "open" partition has been partially assigned to but is not full.
-    std::vector<Partition> openPartitions;
-    foreach (Tablet& tablet, tablets) {
-        bool done = false;
-        size_t numOpenPartitions = openPartitions.size();
-        // From a few ramdomly selected open partitions, assign the tablet to
-        // the first open partition that fits.  If none of these partitions fit,
-        // create a new partition.
-        for (size_t i = 0; i < std::min(numOpenPartitions, 5lu); i++) {
-            size_t j = generateRandom() % numOpenPartitions;
-            Partition& partition = openPartitions[j];
-            if (partition.fits(estimator->estimate(&tablet))) {
-                partition.add(estimator->estimate(&tablet));
-                ProtoBuf::Tablets::Tablet& entry =
-                                            *dataToRecover.add_tablet();
-                tablet.serialize(entry);
-                entry.set_user_data(partition.partitionId);
-                // If the partition is mostly full, remove the partition
-                if (partition.usage() > 0.9) {
-                    partition = openPartitions.back();
-                    openPartitions.pop_back();
-                }
-                done = true;
-                break;
-            }
+    const uint64_t byteLimit = PARTITION_MAX_BYTES / phases;
+    const uint64_t recordLimit = PARTITION_MAX_RECORDS / phases;
+
+    // Recovery takes as long as the slowest recovery master, so the goal is
+    // to give every partition about the same amount of work while using as
+    // few partitions as the limits allow. Start with the smallest number of
+    // partitions that could possibly hold everything, then place the tablets
+    // largest first, each in the least loaded partition that it fits in (or
+    // in a new partition if it fits in none).
+    vector<TableStats::Estimator::Estimate> estimates;
+    vector<std::pair<double, size_t>> order;
+    uint64_t totalBytes = 0;
+    uint64_t totalRecords = 0;
+    for (size_t i = 0; i < tablets.size(); i++) {
+        estimates.push_back(estimator->estimate(&tablets[i]));
+        Partition single(0, byteLimit, recordLimit);
+        single.add(estimates[i]);
+        order.emplace_back(single.usage(), i);
+        totalBytes += estimates[i].byteCount;
+        totalRecords += estimates[i].recordCount;
+    }
+    std::sort(order.begin(), order.end(),
+              [](const std::pair<double, size_t>& a,
+                 const std::pair<double, size_t>& b) {
+                  if (a.first != b.first)
+                      return a.first > b.first;
+                  return a.second < b.second;
+              });
+
+    uint64_t minPartitions = std::max(
+            (totalBytes + byteLimit - 1) / byteLimit,
+            (totalRecords + recordLimit - 1) / recordLimit);
+    std::vector<Partition> partitions;
+    for (uint64_t i = 0; i < minPartitions; i++)
+        partitions.emplace_back(i, byteLimit, recordLimit);
+
+    vector<size_t> tabletPartition(tablets.size());
+    foreach (auto& item, order) {
+        size_t i = item.second;
+        Partition* best = NULL;
+        foreach (Partition& partition, partitions) {
+            if (partition.fits(estimates[i]) &&
+                    (best == NULL || partition.usage() < best->usage()))
+                best = &partition;
         }
-        if (!done) {
-            // This tablet did not fit in any of the open partitions we tried,
-            // so make a new partition.
-            Partition partition(numPartitions++);
-            partition.add(estimator->estimate(&tablet));
-            ProtoBuf::Tablets::Tablet& entry = *dataToRecover.add_tablet();
-            tablet.serialize(entry);
-            entry.set_user_data(partition.partitionId);
-            // If the partition still has room for more tablets, add it to the
-            // available set of partitions.
-            if (partition.usage() <= 0.9) {
-                openPartitions.push_back(partition);
-            }
+        if (best == NULL) {
+            partitions.emplace_back(partitions.size(), byteLimit,
+                                    recordLimit);
+            best = &partitions.back();
+        }
+        best->add(estimates[i]);
+        tabletPartition[i] = best->partitionId;
+    }
+
+    // Partition ids must be consecutive and every partition must hold at
+    // least one tablet; a partition can end up empty if a single key hash
+    // holds more than a partition's worth of data.
+    vector<int64_t> partitionIds(partitions.size(), -1);
+    uint64_t minBytes = ~0UL;
+    uint64_t maxBytes = 0;
+    for (size_t i = 0; i < tablets.size(); i++) {
+        int64_t& id = partitionIds[tabletPartition[i]];
+        if (id < 0) {
+            id = numPartitions++;
+            uint64_t bytes = partitions[tabletPartition[i]].byteCount;
+            partitionBytes.push_back(bytes);
+            minBytes = std::min(minBytes, bytes);
+            maxBytes = std::max(maxBytes, bytes);
         }
+        ProtoBuf::Tablets::Tablet& entry = *dataToRecover.add_tablet();
+        tablets[i].serialize(entry);
+        entry.set_user_data(id);
+    }
+    if (numPartitions > 0) {
+        LOG(NOTICE, "Divided %lu tablets into %u partitions holding between "
+            "%lu and %lu bytes (estimated)", tablets.size(), numPartitions,
+            minBytes, maxBytes);
+        metrics->coordinator.recoveryPartitionMinBytes = minBytes;
+        metrics->coordinator.recoveryPartitionMaxBytes = maxBytes;
     }
 }
 
@@ -403,8 +492,10 @@ Recovery::performTask()
     case WAIT_FOR_RECOVERY_MASTERS:
         // Calls to recoveryMasterFinished drive
         // recovery from WAIT_FOR_RECOVERY_MASTERS to
-        // ALL_RECOVERY_MASTERS_FINISHED.
-        assert(false);
+        // ALL_RECOVERY_MASTERS_FINISHED. They only schedule this recovery
+        // if partitions are still waiting for a recovery master (which
+        // requires phases > 1).
+        startRecoveryMasters();
         break;
     case ALL_RECOVERY_MASTERS_FINISHED:
         // Tell all of the backups that they can reclaim recovery state.
@@ -690,17 +781,19 @@ verifyLogComplete(Tub<BackupStartTask> tasks[],
  * \param taskCount
  *      Number of elements in #tasks.
  * \return
- *      Triple of segment id of the replica from which the log digest was
- *      taken, the log digest itself, and a pointer to the table stats buffer.
+ *      Tuple of segment id of the replica from which the log digest was
+ *      taken, the log digest itself, a pointer to the table stats buffer,
+ *      and the length of the table stats buffer.
  *      Empty if no log digest is found.
  */
-Tub<std::tuple<uint64_t, LogDigest, TableStats::Digest*>>
+Tub<std::tuple<uint64_t, LogDigest, TableStats::Digest*, uint32_t>>
 findLogDigest(Tub<BackupStartTask> tasks[], size_t taskCount)
 {
     uint64_t headId = ~0ul;
     void* headBuffer = NULL;
     uint32_t headBufferLength = 0;
     TableStats::Digest* tableStatsBuffer = NULL;
+    uint32_t tableStatsLength = 0;
 
     for (size_t i = 0; i < taskCount; ++i) {
         const auto& result = tasks[i]->result;
@@ -716,6 +809,7 @@ findLogDigest(Tub<BackupStartTask> tasks[], size_t taskCount)
                 // of this method's caller.
                 tableStatsBuffer = reinterpret_cast<TableStats::Digest*>
                                             (result.tableStatsBuffer.get());
+                tableStatsLength = result.tableStatsBytes;
             }
         }
     }
@@ -724,7 +818,7 @@ findLogDigest(Tub<BackupStartTask> tasks[], size_t taskCount)
         return {};
     return {std::make_tuple(headId,
                             LogDigest(headBuffer, headBufferLength),
-                            tableStatsBuffer)};
+                            tableStatsBuffer, tableStatsLength)};
 }
 
 /// Used in buildReplicaMap().
@@ -883,6 +977,7 @@ Recovery::startBackups()
     // is live.  backupStartTasks is on this methods stack and is live for
     // the scope for this method.
     TableStats::Digest* tableStats = std::get<2>(*digestInfo.get());
+    uint32_t tableStatsLength = std::get<3>(*digestInfo.get());
 
     LOG(NOTICE, "Segment %lu is the head of the log", headId);
 
@@ -897,13 +992,17 @@ Recovery::startBackups()
     }
 
     /* Broadcast 2: partition replicas into tablets for recovery masters */
-    TableStats::Estimator estimator(tableStats);
-    partitionTablets(tablets, &estimator);
-    LOG(NOTICE, "Partition Scheme for Recovery:\n%s",
-                dataToRecover.DebugString().c_str());
-
-    parallelRun(backupPartitionTasks.get(), backups.size(),
-            maxActiveBackupHosts);
+    {
+        CycleCounter<RawMetric>
+            _(&metrics->coordinator.recoveryPartitionTicks);
+        TableStats::Estimator estimator(tableStats, tableStatsLength);
+        partitionTablets(tablets, &estimator);
+        LOG(NOTICE, "Partition Scheme for Recovery:\n%s",
+                    dataToRecover.DebugString().c_str());
+
+        parallelRun(backupPartitionTasks.get(), backups.size(),
+                maxActiveBackupHosts);
+    }
 
     replicaMap = buildReplicaMap(backupStartTasks.get(), backups.size(),
                                  tracker, headId);
@@ -997,44 +1096,65 @@ using namespace RecoveryInternal; // NOLINT
  * Start recovery of each of the partitions on a recovery master.  Each
  * master will only be assigned one partition at a time. If there are
  * too few masters to perform the full recovery then only a subset of
- * the partitions will be recovered. When this recovery completes if there
- * are partitions that still need recovery a follow up recovery will
- * be scheduled.
+ * the partitions will be recovered. With a single phase (see #phases), when
+ * this recovery completes if there are partitions that still need recovery
+ * a follow up recovery will be scheduled. With more than one phase, the
+ * remaining partitions wait for recovery masters to finish their current
+ * partition, and this method is called again to hand them out.
  */
 void
 Recovery::startRecoveryMasters()
 {
     CycleCounter<RawMetric> _(&metrics->coordinator.recoveryStartTicks);
-    LOG(NOTICE, "Starting recovery %lu for crashed server %s with %u "
-        "partitions", recoveryId, crashedServerId.toString().c_str(),
-        numPartitions);
+    if (nextPartition == 0) {
+        LOG(NOTICE, "Starting recovery %lu for crashed server %s with %u "
+            "partitions", recoveryId, crashedServerId.toString().c_str(),
+            numPartitions);
+        recoveryMastersStartTime = Cycles::rdtsc();
+        partitionBytes.resize(numPartitions);
+        partitionMasters.resize(numPartitions);
+    }
 
     // Set up the tasks to execute the RPCs.
     std::vector<ServerId> masters =
         tracker->getServersWithService(WireFormat::MASTER_SERVICE);
     std::random_shuffle(masters.begin(), masters.end(), randomNumberGenerator);
+    const uint32_t firstPartition = nextPartition;
+    const uint32_t waiting = numPartitions - firstPartition;
+    const uint32_t running = firstPartition - successfulRecoveryMasters
+                             - unsuccessfulRecoveryMasters;
     uint32_t started = 0;
-    Tub<MasterStartTask> recoverTasks[numPartitions];
+    Tub<MasterStartTask> recoverTasks[waiting];
     foreach (ServerId master, masters) {
-        if (started == numPartitions)
+        if (started == waiting)
             break;
         Recovery* preexistingRecovery = (*tracker)[master];
         if (!preexistingRecovery) {
             auto& task = recoverTasks[started];
-            task.construct(*this, master, started, replicaMap);
+            task.construct(*this, master, firstPartition + started,
+                           replicaMap);
+            partitionMasters[firstPartition + started] = master;
             ++started;
         }
     }
+    nextPartition += started;
 
     // If we couldn't find enough masters that weren't already busy with
     // another recovery, then count the remaining partitions as having
     // been on unsuccessful recovery masters so we know when to quit
-    // waiting for recovery masters.
-    const uint32_t partitionsWithoutARecoveryMaster = (numPartitions - started);
-    if (partitionsWithoutARecoveryMaster > 0) {
+    // waiting for recovery masters. With multiple phases they can wait
+    // for one of this recovery's masters instead, unless there are none.
+    const uint32_t partitionsWithoutARecoveryMaster = (waiting - started);
+    if (partitionsWithoutARecoveryMaster > 0 &&
+            phases > 1 && running + started > 0) {
+        LOG(NOTICE, "%u partitions will be recovered once recovery masters "
+            "finish their current partitions",
+            partitionsWithoutARecoveryMaster);
+    } else if (partitionsWithoutARecoveryMaster > 0) {
         LOG(NOTICE, "Couldn't find enough masters not already performing a "
             "recovery to recover all partitions: %u partitions will be "
             "recovered later", partitionsWithoutARecoveryMaster);
+        nextPartition = numPartitions;
         for (uint32_t i = 0; i < partitionsWithoutARecoveryMaster; ++i)
             recoveryMasterFinished(ServerId(), false);
     }
@@ -1042,7 +1162,10 @@ Recovery::startRecoveryMasters()
     // Hand out each tablet to one of the recovery masters depending on
     // which partition it was in.
     foreach (auto& tablet, dataToRecover.tablet()) {
-        auto& task = recoverTasks[tablet.user_data()];
+        if (tablet.user_data() < firstPartition ||
+                tablet.user_data() >= firstPartition + started)
+            continue;
+        auto& task = recoverTasks[tablet.user_data() - firstPartition];
         if (task) {
             *task->dataToRecover.add_tablet() = tablet;
             if (tableManager->isIndexletTable(tablet.table_id())) {
@@ -1058,7 +1181,7 @@ Recovery::startRecoveryMasters()
     }
 
     // Tell the recovery masters to begin recovery.
-    parallelRun(recoverTasks, numPartitions, 10);
+    parallelRun(recoverTasks, started, 10);
 
     // If all of the recovery masters failed to get off to a start then
     // skip waiting for them.
@@ -1095,14 +1218,40 @@ void
 Recovery::recoveryMasterFinished(ServerId recoveryMasterId,
                                  bool successful)
 {
+    uint32_t partition = ~0u;
     if (recoveryMasterId.isValid()) {
         if (!(*tracker)[recoveryMasterId])
             return;
         (*tracker)[recoveryMasterId] = NULL;
+        for (uint32_t i = 0; i < partitionMasters.size(); i++) {
+            if (partitionMasters[i] == recoveryMasterId) {
+                partitionMasters[i] = ServerId();
+                partition = i;
+                break;
+            }
+        }
     }
 
     if (successful) {
         ++successfulRecoveryMasters;
+        if (recoveryMasterId.isValid()) {
+            uint64_t ticks = Cycles::rdtsc() - recoveryMastersStartTime;
+            fastestRecoveryMasterTicks = std::min(fastestRecoveryMasterTicks,
+                                                  ticks);
+            slowestRecoveryMasterTicks = std::max(slowestRecoveryMasterTicks,
+                                                  ticks);
+
+            // Log how much of the crashed master's data is back; over the
+            // course of the recovery these lines trace out how quickly its
+            // data becomes available to clients.
+            if (partition < partitionBytes.size()) {
+                recoveredBytes += partitionBytes[partition];
+                LOG(NOTICE, "Partition %u of crashed server %s available "
+                    "after %.1f ms (%lu bytes recovered so far)", partition,
+                    crashedServerId.toString().c_str(),
+                    Cycles::toSeconds(ticks) * 1e03, recoveredBytes);
+            }
+        }
     } else {
         ++unsuccessfulRecoveryMasters;
         if (recoveryMasterId.isValid())
@@ -1116,11 +1265,27 @@ Recovery::recoveryMasterFinished(ServerId recoveryMasterId,
         successfulRecoveryMasters + unsuccessfulRecoveryMasters;
     if (completedRecoveryMasters == numPartitions) {
         recoveryTicks.destroy();
+        if (slowestRecoveryMasterTicks > 0) {
+            LOG(NOTICE, "Recovery masters for crashed server %s took "
+                "between %.1f and %.1f ms",
+                crashedServerId.toString().c_str(),
+                Cycles::toSeconds(fastestRecoveryMasterTicks) * 1e03,
+                Cycles::toSeconds(slowestRecoveryMasterTicks) * 1e03);
+            metrics->coordinator.recoveryMasterFastestTicks =
+                    fastestRecoveryMasterTicks;
+            metrics->coordinator.recoveryMasterSlowestTicks =
+                    slowestRecoveryMasterTicks;
+        }
         status = ALL_RECOVERY_MASTERS_FINISHED;
 #if BCAST_INLINE
         broadcastRecoveryComplete();
 #endif
         schedule();
+    } else if (phases > 1 && nextPartition < numPartitions &&
+            status == WAIT_FOR_RECOVERY_MASTERS) {
+        // A recovery master may have become free; hand it one of the
+        // partitions that are still waiting.
+        schedule();
     }
 }
 
@@ -99,7 +99,7 @@ class BackupStartPartitionTask {
 bool verifyLogComplete(Tub<BackupStartTask> tasks[],
                        size_t taskCount,
                        const LogDigest& digest);
-Tub<std::tuple<uint64_t, LogDigest, TableStats::Digest*>>
+Tub<std::tuple<uint64_t, LogDigest, TableStats::Digest*, uint32_t>>
 findLogDigest(Tub<BackupStartTask> tasks[], size_t taskCount);
 vector<WireFormat::Recover::Replica> buildReplicaMap(
     Tub<BackupStartTask> tasks[], size_t taskCount,
@@ -178,6 +178,19 @@ class Recovery : public Task {
     /// Defines the max number of records a tablet partition should accommodate.
     static const uint64_t PARTITION_MAX_RECORDS = 2000000;
 
+    /**
+     * Number of phases in which the crashed master's data is brought back
+     * online. With more than one phase, partitions are limited to
+     * 1/phases of PARTITION_MAX_BYTES and PARTITION_MAX_RECORDS, so there are
+     * several times as many of them, and the partitions that don't get a
+     * recovery master right away are handed out as recovery masters finish
+     * earlier ones. Since each partition's tablets become available as soon
+     * as its recovery master finishes, the first of the crashed master's
+     * data is back much sooner, at the cost of somewhat longer total
+     * recovery time. Set from the "recoveryPhases" RuntimeOption.
+     */
+    uint32_t phases;
+
   PRIVATE:
     void splitTablets(vector<Tablet> *tablets,
                       TableStats::Estimator* estimator);
@@ -276,6 +289,35 @@ class Recovery : public Task {
      */
     uint32_t unsuccessfulRecoveryMasters;
 
+    /// Cycles::rdtsc() time when recovery masters were told to start.
+    uint64_t recoveryMastersStartTime;
+
+    /// Time from #recoveryMastersStartTime until the first and the last
+    /// partition were successfully recovered, in Cycles::rdtsc() ticks.
+    /// With a single phase, the spread between them shows how well the
+    /// partitions were balanced.
+    uint64_t fastestRecoveryMasterTicks;
+    uint64_t slowestRecoveryMasterTicks;
+
+    /**
+     * Id of the next partition to hand to a recovery master. Partitions are
+     * handed out in order; those at or above this id are waiting for a
+     * recovery master (only possible if #phases > 1).
+     */
+    uint32_t nextPartition;
+
+    /// Estimated number of bytes in each partition, indexed by partition id.
+    /// Used to log how much of the crashed master's data is available as
+    /// recovery progresses.
+    vector<uint64_t> partitionBytes;
+
+    /// Estimated number of bytes in the partitions recovered so far.
+    uint64_t recoveredBytes;
+
+    /// The recovery master working on each partition, indexed by partition
+    /// id (invalid if the partition hasn't been handed out).
+    vector<ServerId> partitionMasters;
+
   PUBLIC:
     /**
      * If non-NULL then this callback is invoked instead of
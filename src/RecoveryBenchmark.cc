@@ -0,0 +1,324 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "Cycles.h"
+#include "Logger.h"
+#include "MockCluster.h"
+#include "OptionParser.h"
+#include "RamCloud.h"
+#include "Recovery.h"
+#include "Seglet.h"
+
+namespace RAMCloud {
+
+/**
+ * Runs a complete master recovery inside a single process, so that changes
+ * to recovery performance can be measured without a cluster. The servers
+ * are part of a MockCluster (BindTransport, in-memory backups); one of them
+ * is filled with data and then recovered onto the others, and the time
+ * spent in each phase of the recovery is printed.
+ *
+ * Because BindTransport executes RPCs in the caller's thread, the recovery
+ * masters run one after another rather than in parallel, and the crashed
+ * master isn't actually removed from the cluster: it just stops serving its
+ * tablets. The phase times are still comparable between runs, which is what
+ * this benchmark is for; use RecoveryMain for absolute numbers.
+ */
+class RecoveryBenchmark {
+
+  public:
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    Server* victim;
+    uint64_t tableId;
+    uint64_t numObjects;
+
+    RecoveryBenchmark(int numServers, uint32_t numReplicas,
+            uint64_t dataBytes, uint32_t numTablets)
+        : context()
+        , cluster(&context)
+        , ramcloud()
+        , victim(NULL)
+        , tableId()
+        , numObjects(0)
+    {
+        Logger::get().setLogLevels(WARNING);
+
+        // Each backup must hold its share of the crashed master's replicas
+        // plus the replicas written by recovery masters as they re-replicate
+        // the recovered data.
+        uint64_t segmentSize = Segment::DEFAULT_SEGMENT_SIZE;
+        uint64_t perBackup = 2 * dataBytes * std::max(numReplicas, 1U) /
+                             (numServers - 1);
+        uint64_t logMegs = std::max(3 * dataBytes / 1024 / 1024, 64UL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::BACKUP_SERVICE,
+                           WireFormat::PING_SERVICE,
+                           WireFormat::MEMBERSHIP_SERVICE};
+        config.segmentSize = Segment::DEFAULT_SEGMENT_SIZE;
+        config.segletSize = Seglet::DEFAULT_SEGLET_SIZE;
+        config.maxObjectDataSize = config.segmentSize / 8;
+        config.setLogAndHashTableSize(format("%lu", logMegs), "10%");
+        config.master.numReplicas = numReplicas;
+        config.backup.numSegmentFrames =
+                downCast<uint32_t>(perBackup / segmentSize + 16);
+        for (int i = 0; i < numServers; i++) {
+            config.localLocator = format("mock:host=server%d", i);
+            Server* server = cluster.addServer(config);
+            if (victim == NULL)
+                victim = server;
+        }
+        cluster.syncCoordinatorServerList();
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = cluster.coordinator->tableManager.createTable("recovery",
+                numTablets, victim->serverId);
+    }
+
+    /**
+     * Fill the victim with objects.
+     *
+     * \param dataBytes
+     *      Total number of bytes of object data to write.
+     * \param objectSize
+     *      Size of each object's value, in bytes.
+     */
+    void
+    fill(uint64_t dataBytes, uint32_t objectSize)
+    {
+        char value[objectSize];
+        memset(value, 'x', objectSize);
+        numObjects = dataBytes / objectSize;
+
+        uint64_t start = Cycles::rdtsc();
+        for (uint64_t i = 0; i < numObjects; i++)
+            ramcloud->write(tableId, &i, sizeof(i), value, objectSize);
+        double seconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+        printf("Wrote %lu %u-byte objects (%.1f MB) in %.1f s\n",
+               numObjects, objectSize,
+               static_cast<double>(dataBytes) / 1024. / 1024., seconds);
+    }
+
+    /**
+     * Recover the victim's tablets onto the other servers and print how long
+     * each part of the recovery took.
+     *
+     * \param phases
+     *      Value for Recovery::phases; see RuntimeOptions::recoveryPhases.
+     * \param verify
+     *      If true, read back every object after recovery.
+     */
+    void
+    run(uint32_t phases, bool verify)
+    {
+        CoordinatorService* coordinator = cluster.coordinator.get();
+        MasterRecoveryManager* manager = &coordinator->recoveryManager;
+
+        // Let the recovery manager learn about all of the servers, then
+        // start its thread: recovery masters report to it when they finish.
+        while (manager->taskQueue.performTask()) {
+            // Keep applying server list changes.
+        }
+        manager->start();
+
+        // "Crash" the victim: it stops serving its tablets, so clients must
+        // find the recovered copies. It is still up as far as the rest of
+        // the cluster is concerned (see the class documentation).
+        vector<TabletManager::Tablet> tablets;
+        victim->master->tabletManager.getTablets(&tablets);
+        foreach (TabletManager::Tablet& tablet, tablets) {
+            victim->master->tabletManager.deleteTablet(tablet.tableId,
+                    tablet.startKeyHash, tablet.endKeyHash);
+        }
+
+        // Drive the recovery from this thread rather than the recovery
+        // manager's, so that the RPCs it issues (which execute inline) don't
+        // deadlock against the recovery masters' calls back to the manager.
+        TaskQueue queue;
+        Recovery recovery(&cluster.coordinatorContext, queue,
+                &coordinator->tableManager, &manager->tracker, NULL,
+                victim->serverId, ProtoBuf::MasterRecoveryInfo());
+        recovery.phases = phases;
+        manager->activeRecoveries[recovery.getRecoveryId()] = &recovery;
+        manager->tracker[victim->serverId] = &recovery;
+
+        Snapshot before;
+        uint64_t backupTicks = 0;
+        uint64_t mastersTicks = 0;
+        uint64_t completeTicks = 0;
+        recovery.schedule();
+        uint64_t start = Cycles::rdtsc();
+        while (!recovery.isDone()) {
+            uint64_t taskStart = Cycles::rdtsc();
+            if (!queue.performTask())
+                DIE("Recovery stalled before completing");
+            uint64_t ticks = Cycles::rdtsc() - taskStart;
+            if (backupTicks == 0)
+                backupTicks = ticks;
+            else if (recovery.isDone())
+                completeTicks = ticks;
+            else
+                mastersTicks += ticks;
+        }
+        uint64_t recoveryTicks = Cycles::rdtsc() - start;
+        Snapshot after;
+
+        // The first read after recovery goes to the victim, which rejects
+        // it; the client then fetches the new tablet map from the
+        // coordinator and retries at the recovery master.
+        uint64_t readStart = Cycles::rdtsc();
+        uint64_t key = 0;
+        Buffer value;
+        ramcloud->read(tableId, &key, sizeof(key), &value);
+        uint64_t handoffTicks = Cycles::rdtsc() - readStart;
+
+        manager->tracker[victim->serverId] = NULL;
+        manager->activeRecoveries.erase(recovery.getRecoveryId());
+        manager->halt();
+
+        if (!recovery.wasCompletelySuccessful()) {
+            printf("Recovery failed\n");
+            return;
+        }
+
+        uint64_t partitionTicks = after.partitionTicks -
+                                  before.partitionTicks;
+        uint64_t fetchTicks = after.fetchTicks - before.fetchTicks;
+        uint64_t replayTicks = after.replayTicks - before.replayTicks;
+        uint64_t syncTicks = after.syncTicks - before.syncTicks;
+        uint64_t otherTicks = mastersTicks - std::min(mastersTicks,
+                fetchTicks + replayTicks + syncTicks);
+        printf("Recovered %lu objects in %u partitions\n", numObjects,
+               recovery.numPartitions);
+        printf("  Backup start:             %8.1f ms\n",
+               toMs(backupTicks - partitionTicks));
+        printf("  Partition:                %8.1f ms\n", toMs(partitionTicks));
+        printf("  Recovery masters:         %8.1f ms\n", toMs(mastersTicks));
+        printf("    Fetch (stalled):        %8.1f ms\n", toMs(fetchTicks));
+        printf("    Replay:                 %8.1f ms\n", toMs(replayTicks));
+        printf("    Log sync:               %8.1f ms\n", toMs(syncTicks));
+        printf("    Other:                  %8.1f ms\n", toMs(otherTicks));
+        printf("  Recovery complete:        %8.1f ms\n", toMs(completeTicks));
+        printf("  Total:                    %8.1f ms\n", toMs(recoveryTicks));
+        printf("Backup replica reads:       %8.1f ms\n",
+               toMs(after.storageReadTicks - before.storageReadTicks));
+        printf("Tablet handoff (first read):%8.1f ms\n", toMs(handoffTicks));
+
+        if (verify) {
+            uint64_t missing = 0;
+            for (uint64_t i = 0; i < numObjects; i++) {
+                try {
+                    ramcloud->read(tableId, &i, sizeof(i), &value);
+                } catch (ObjectDoesntExistException& e) {
+                    missing++;
+                }
+            }
+            printf("Verified %lu objects, %lu missing\n", numObjects,
+                   missing);
+        }
+    }
+
+  PRIVATE:
+    /**
+     * The recovery metrics this benchmark reports. Metrics are shared by
+     * all of the servers in the process, so these are sums over servers.
+     */
+    struct Snapshot {
+        Snapshot()
+            : partitionTicks(metrics->coordinator.recoveryPartitionTicks.load())
+            , fetchTicks(metrics->master.segmentReadStallTicks.load())
+            , replayTicks(metrics->master.recoverSegmentTicks.load())
+            , syncTicks(metrics->master.logSyncTicks.load())
+            , storageReadTicks(metrics->backup.storageReadTicks.load())
+        {}
+        uint64_t partitionTicks;
+        uint64_t fetchTicks;
+        uint64_t replayTicks;
+        uint64_t syncTicks;
+        uint64_t storageReadTicks;
+    };
+
+    static double
+    toMs(uint64_t ticks)
+    {
+        return Cycles::toSeconds(ticks) * 1e03;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RecoveryBenchmark);
+};
+
+}  // namespace RAMCloud
+
+int
+main(int argc, char** argv)
+{
+    using namespace RAMCloud;
+
+    int numServers;
+    uint32_t numReplicas, objectSize, numTablets, phases;
+    uint64_t dataMegs;
+    bool verify;
+
+    OptionsDescription benchmarkOptions("RecoveryBenchmark");
+    benchmarkOptions.add_options()
+        ("servers,n",
+         ProgramOptions::value<int>(&numServers)->default_value(4),
+         "Number of servers, including the one that is recovered")
+        ("dataMegs,d",
+         ProgramOptions::value<uint64_t>(&dataMegs)->default_value(100),
+         "Megabytes of object data on the recovered master")
+        ("objectSize,s",
+         ProgramOptions::value<uint32_t>(&objectSize)->default_value(1000),
+         "Size of each object's value in bytes")
+        ("replicas,r",
+         ProgramOptions::value<uint32_t>(&numReplicas)->default_value(3),
+         "Number of backup replicas of each segment")
+        ("tablets,t",
+         ProgramOptions::value<uint32_t>(&numTablets)->default_value(4),
+         "Number of tablets the recovered data is divided into")
+        ("phases,p",
+         ProgramOptions::value<uint32_t>(&phases)->default_value(1),
+         "Number of phases in which to bring the data back online; "
+         "more phases means smaller partitions")
+        ("verify",
+         ProgramOptions::bool_switch(&verify),
+         "Read back every object after recovery");
+
+    OptionParser optionParser(benchmarkOptions, argc, argv);
+
+    if (numServers < 2 ||
+            numReplicas > static_cast<uint32_t>(numServers - 1)) {
+        fprintf(stderr, "Need at least 2 servers and more servers than "
+                "replicas\n");
+        return 1;
+    }
+    if (objectSize == 0 || objectSize > Segment::DEFAULT_SEGMENT_SIZE / 8) {
+        fprintf(stderr, "Object size must be between 1 and %u bytes\n",
+                Segment::DEFAULT_SEGMENT_SIZE / 8);
+        return 1;
+    }
+
+    uint64_t dataBytes = dataMegs * 1024 * 1024;
+    RecoveryBenchmark benchmark(numServers, numReplicas, dataBytes,
+                                numTablets);
+    benchmark.fill(dataBytes, objectSize);
+    benchmark.run(std::max(phases, 1U), verify);
+    return 0;
+}
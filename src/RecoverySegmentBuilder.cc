@@ -80,6 +80,7 @@ RecoverySegmentBuilder::build(const void* buffer, uint32_t length,
             continue;
         }
         if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJTOMB
+            && type != LOG_ENTRY_TYPE_OBJCOMP
             && type != LOG_ENTRY_TYPE_SAFEVERSION
             && type != LOG_ENTRY_TYPE_RPCRESULT
             && type != LOG_ENTRY_TYPE_PREP
@@ -140,7 +141,7 @@ RecoverySegmentBuilder::build(const void* buffer, uint32_t length,
             continue;
         }
 
-        if (type == LOG_ENTRY_TYPE_OBJ) {
+        if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJCOMP) {
             Object object(entryBuffer);
             tableId = object.getTableId();
             keyHash = Key::getHash(tableId,
@@ -543,6 +543,58 @@ TEST_F(RecoveryTest, splitTablets_full_table) {
               tablets[1].debugString(1));
 }
 
+TEST_F(RecoveryTest, splitTablets_histogram) {
+    // Case where the table's data is all in the lowest key hashes; the split
+    // should follow the data rather than divide the key hashes evenly.
+    Lock lock(mutex);     // To trick TableManager internal calls.
+    Tub<Recovery> recovery;
+    Recovery::Owner* own = static_cast<Recovery::Owner*>(NULL);
+    tableManager.testCreateTable("t", 1);
+    tableManager.testAddTablet(
+        {1,  0,  0xFFFFFFFFFFFFFFFF, {99, 0}, Tablet::RECOVERING, {}});
+    recovery.construct(&context, taskQueue, &tableManager, &tracker, own,
+                       ServerId(99), recoveryInfo);
+    auto tablets = tableManager.markAllTabletsRecovering(ServerId(99));
+
+    double bytesPerKeyHash =
+            double(Recovery::PARTITION_MAX_BYTES) * 1.5 / 0x1p64;
+    double recordsPerKeyHash =
+            double(Recovery::PARTITION_MAX_RECORDS) * 0.5 / 0x1p64;
+    Buffer buffer;
+    *buffer.emplaceAppend<TableStats::DigestHeader>() = {0, 0, 1};
+    *buffer.emplaceAppend<TableStats::DigestEntry>() =
+            {1, bytesPerKeyHash, recordsPerKeyHash};
+    *buffer.emplaceAppend<TableStats::DigestHistogramHeader>() =
+            {TableStats::digestHistogramVersion,
+             sizeof32(TableStats::DigestHistogramEntry), 1};
+    TableStats::DigestHistogramEntry* histogram =
+            buffer.emplaceAppend<TableStats::DigestHistogramEntry>();
+    histogram->tableId = 1;
+    histogram->startKeyHash = 0;
+    histogram->endKeyHash = ~0UL;
+    histogram->bytesPerKeyHash = bytesPerKeyHash;
+    histogram->recordsPerKeyHash = recordsPerKeyHash;
+    histogram->byteShares[0] = 255;
+    histogram->recordShares[0] = 255;
+    const TableStats::Digest* digest =
+            reinterpret_cast<const TableStats::Digest*>(
+                    buffer.getRange(0, buffer.size()));
+
+    TableStats::Estimator e(digest, buffer.size());
+    EXPECT_TRUE(e.hasHistogram(1));
+
+    recovery->splitTablets(&tablets, &e);
+
+    EXPECT_EQ(2u, tablets.size());
+    EXPECT_EQ("{ 1: 0x0-0x3ffffffffffffff }", tablets[0].debugString(1));
+    EXPECT_EQ("{ 1: 0x400000000000000-0xffffffffffffffff }",
+              tablets[1].debugString(1));
+    Tablet* tablet = tableManager.testFindTablet(1u, 0x400000000000000);
+    ASSERT_TRUE(tablet != NULL);
+    EXPECT_EQ("{ 1: 0x400000000000000-0xffffffffffffffff }",
+              tablet->debugString(1));
+}
+
 TEST_F(RecoveryTest, partitionTablets_no_estimator) {
     Lock lock(mutex);     // To trick TableManager internal calls.
     Tub<Recovery> recovery;
@@ -607,6 +659,36 @@ TEST_F(RecoveryTest, partitionTablets_splits) {
     EXPECT_EQ(20lu, recovery->numPartitions);
 }
 
+TEST_F(RecoveryTest, partitionTablets_phases) {
+    Lock lock(mutex);     // To trick TableManager internal calls.
+    tableManager.testCreateTable("t1", 1);
+    tableManager.testAddTablet({1,  0,  99, {99, 0}, Tablet::RECOVERING, {}});
+    Recovery recovery(&context, taskQueue, &tableManager, &tracker, NULL,
+                      ServerId(99), recoveryInfo);
+    auto tablets = tableManager.markAllTabletsRecovering(ServerId(99));
+
+    char buffer[sizeof(TableStats::DigestHeader) +
+                sizeof(TableStats::DigestEntry)];
+    memset(buffer, 0, sizeof(buffer));
+    TableStats::Digest* digest = reinterpret_cast<TableStats::Digest*>(buffer);
+    digest->header.entryCount = 1;
+    digest->entries[0].tableId = 1;
+    digest->entries[0].bytesPerKeyHash = (1.5 / 100)
+                                         * Recovery::PARTITION_MAX_BYTES;
+    digest->entries[0].recordsPerKeyHash = 1;
+    TableStats::Estimator e(digest);
+
+    recovery.partitionTablets(tablets, &e);
+    EXPECT_EQ(2lu, recovery.numPartitions);
+
+    // Each phase's partitions hold a third as much.
+    recovery.phases = 3;
+    recovery.dataToRecover.Clear();
+    recovery.partitionTablets(tablets, &e);
+    EXPECT_EQ(5lu, recovery.numPartitions);
+    EXPECT_EQ(5lu, recovery.partitionBytes.size());
+}
+
 TEST_F(RecoveryTest, partitionTablets_basic) {
     // This covers the following cases:
     //      (1) No partitions to choose from
@@ -974,6 +1056,8 @@ TEST_F(RecoveryTest, findLogDigest) {
     ASSERT_TRUE(digest);
     EXPECT_EQ(10lu, std::get<0>(*digest.get()));
     EXPECT_EQ(0u, std::get<1>(*digest.get())[0]);
+    EXPECT_TRUE(std::get<2>(*digest.get()) == NULL);
+    EXPECT_EQ(0u, std::get<3>(*digest.get()));
 
     result1.logDigestSegmentId = 9;
     // Two log digests, later one has a lower segment id.
@@ -1205,6 +1289,51 @@ TEST_F(RecoveryTest, startRecoveryMasters_noIdleMasters) {
     EXPECT_FALSE(owner.finishedCalled);
 }
 
+TEST_F(RecoveryTest, startRecoveryMasters_phases) {
+    // With more than one phase, partitions that don't get a recovery master
+    // wait for one to finish rather than being left for a later recovery.
+    struct Cb : public MasterStartTaskTestingCallback {
+        vector<uint32_t> partitions;
+        Cb() : partitions() {}
+        void masterStartTaskSend(uint64_t recoveryId,
+            ServerId crashedServerId, uint32_t partitionId,
+            const ProtoBuf::RecoveryPartition& recoveryPartition,
+            const WireFormat::Recover::Replica replicaMap[],
+            size_t replicaMapSize)
+        {
+            EXPECT_EQ(1, recoveryPartition.tablet_size());
+            partitions.push_back(partitionId);
+        }
+    } callback;
+    Lock lock(mutex);     // To trick TableManager internal calls.
+    MockRandom _(1);
+    addServersToTracker(1, {WireFormat::MASTER_SERVICE});
+    tableManager.testCreateTable("t", 123);
+    tableManager.testAddTablet({123,  0,  9, {99, 0}, Tablet::RECOVERING, {}});
+    tableManager.testAddTablet({123, 10, 19, {99, 0}, Tablet::RECOVERING, {}});
+    Recovery recovery(&context, taskQueue, &tableManager, &tracker, NULL,
+                      {99, 0}, recoveryInfo);
+    recovery.phases = 2;
+    recovery.partitionTablets(
+                tableManager.markAllTabletsRecovering({99, 0}), NULL);
+    recovery.testingMasterStartTaskSendCallback = &callback;
+
+    recovery.startRecoveryMasters();
+    EXPECT_EQ(vector<uint32_t>({0}), callback.partitions);
+    EXPECT_EQ(0u, recovery.unsuccessfulRecoveryMasters);
+    EXPECT_EQ(Recovery::WAIT_FOR_RECOVERY_MASTERS, recovery.status);
+    EXPECT_FALSE(recovery.isScheduled());
+
+    recovery.recoveryMasterFinished({1, 0}, true);
+    EXPECT_TRUE(recovery.isScheduled());
+    recovery.performTask();
+    EXPECT_EQ(vector<uint32_t>({0, 1}), callback.partitions);
+
+    recovery.recoveryMasterFinished({1, 0}, true);
+    EXPECT_EQ(2u, recovery.successfulRecoveryMasters);
+    EXPECT_EQ(Recovery::ALL_RECOVERY_MASTERS_FINISHED, recovery.status);
+}
+
 TEST_F(RecoveryTest, startRecoveryMasters_allFailDuringRecoverRpc) {
     Lock lock(mutex);     // To trick TableManager internal calls.
     addServersToTracker(2, {WireFormat::MASTER_SERVICE});
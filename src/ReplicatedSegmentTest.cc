@@ -1137,7 +1137,7 @@ TEST_F(ReplicatedSegmentTest, performFreeRpcIsReady) {
     segment->replicas[0].freeRpc.construct(&context, backupId1,
                                            masterId, segmentId);
     freeRpcsInFlight = 2;
-    EXPECT_STREQ("sendRequest: 0x1001c 0 0 999 0 888 0",
+    EXPECT_STREQ("sendRequest: 0x1001c 0 0 0 999 0 888 0",
                  transport.outputLog.c_str());
     segment->performFree(segment->replicas[0]);
     EXPECT_FALSE(segment->replicas[0].isActive);
@@ -0,0 +1,63 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Common.h"
+#include "RpcTrace.h"
+
+namespace RAMCloud {
+
+__thread uint32_t RpcTrace::currentId = 0;
+uint32_t RpcTrace::sampleInterval = 0;
+__thread uint32_t RpcTrace::rpcsUntilSample = 0;
+
+/**
+ * Specify how often new outgoing RPCs should be traced.
+ *
+ * \param interval
+ *      One out of every \a interval RPCs issued by each thread will be
+ *      traced; 0 disables tracing.
+ */
+void
+RpcTrace::setSampleInterval(uint32_t interval)
+{
+    sampleInterval = interval;
+}
+
+/**
+ * Decide whether a new outgoing RPC should be traced; invoked by
+ * newTraceId when tracing is enabled.
+ *
+ * \return
+ *      A new trace id for the RPC, or 0 if it should not be traced.
+ */
+uint32_t
+RpcTrace::sample()
+{
+    if (rpcsUntilSample > 1) {
+        rpcsUntilSample--;
+        return 0;
+    }
+    rpcsUntilSample = sampleInterval;
+
+    // Ids are chosen at random so that ids generated by different clients
+    // are unlikely to collide.
+    uint32_t id = 0;
+    while (id == 0) {
+        id = downCast<uint32_t>(generateRandom() & 0xffffffff);
+    }
+    return id;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,137 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_RPCTRACE_H
+#define RAMCLOUD_RPCTRACE_H
+
+#include "TimeTrace.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+/**
+ * This class makes it possible to follow individual RPCs through the
+ * time traces of all of the processes that handle them. A small fraction
+ * of outgoing RPCs (selected by setSampleInterval) are assigned a nonzero
+ * trace id, which is carried in the traceId field of the request header.
+ * Every process that handles a traced RPC records TimeTrace events of the
+ * form "rpc <id>: <event>"; scripts/rpctrace.py merges the GET_TIME_TRACE
+ * output from several servers into a per-RPC timeline.
+ *
+ * While a worker thread is servicing a traced RPC, that RPC's id is the
+ * thread's "current" trace id: RPCs issued by the worker inherit the id
+ * (so nested RPCs appear in the same timeline), and deeper layers such as
+ * the log can call record to add events without knowing anything about
+ * the RPC.
+ *
+ * When tracing is disabled (the default) the cost is a thread-local load
+ * and a branch per RPC. This class offers only static methods.
+ */
+class RpcTrace {
+  PUBLIC:
+    /**
+     * Return the trace id to use for a new outgoing RPC: the id of the
+     * RPC currently being serviced by this thread, if any; otherwise a
+     * new id if this RPC is selected for tracing, or 0 if it isn't.
+     */
+    static inline uint32_t
+    newTraceId()
+    {
+        if (currentId != 0) {
+            return currentId;
+        }
+        if (sampleInterval == 0) {
+            return 0;
+        }
+        return sample();
+    }
+
+    /**
+     * Return the trace id carried by an incoming request, or 0 if the
+     * request is not being traced.
+     *
+     * \param request
+     *      Request message; must start with a RequestCommon.
+     */
+    static inline uint32_t
+    getTraceId(Buffer* request)
+    {
+        const WireFormat::RequestCommon* header =
+                request->getStart<WireFormat::RequestCommon>();
+        return (header == NULL) ? 0 : header->traceId;
+    }
+
+    /**
+     * If this thread is servicing a traced RPC, add an event to the time
+     * trace for that RPC; otherwise do nothing.
+     *
+     * \param format
+     *      Describes the event; must have the form "rpc %u: ...", where
+     *      the %u is replaced by the trace id. Must be a static string
+     *      (see TimeTrace::record).
+     * \param arg1
+     *      Optional argument to substitute into the format string.
+     */
+    static inline void
+    record(const char* format, uint32_t arg1 = 0)
+    {
+        if (currentId != 0) {
+            TimeTrace::record(format, currentId, arg1);
+        }
+    }
+
+    /**
+     * Add an event to the time trace for a given RPC, if it is being
+     * traced; otherwise do nothing.
+     *
+     * \param traceId
+     *      Trace id of the RPC, or 0 if the RPC is not being traced.
+     * \param format
+     *      Describes the event; see the other form of record.
+     * \param arg1
+     *      Optional argument to substitute into the format string.
+     */
+    static inline void
+    record(uint32_t traceId, const char* format, uint32_t arg1 = 0)
+    {
+        if (traceId != 0) {
+            TimeTrace::record(format, traceId, arg1);
+        }
+    }
+
+    static void setSampleInterval(uint32_t interval);
+
+    /// Trace id of the RPC that the current thread is servicing, or 0 if
+    /// the thread isn't servicing a traced RPC.
+    static __thread uint32_t currentId;
+
+  PRIVATE:
+    static uint32_t sample();
+
+    /// Trace one out of every sampleInterval new outgoing RPCs (those
+    /// not issued on behalf of a traced RPC); 0 means trace nothing.
+    static uint32_t sampleInterval;
+
+    /// Number of new outgoing RPCs this thread must issue before it
+    /// traces another one.
+    static __thread uint32_t rpcsUntilSample;
+
+    // This class is not intended to be instantiated.
+    RpcTrace() {}
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_RPCTRACE_H
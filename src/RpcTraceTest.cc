@@ -0,0 +1,87 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "RpcTrace.h"
+
+namespace RAMCloud {
+
+class RpcTraceTest : public ::testing::Test {
+  public:
+    RpcTraceTest()
+    {
+        RpcTrace::currentId = 0;
+        RpcTrace::rpcsUntilSample = 0;
+        RpcTrace::setSampleInterval(0);
+        TimeTrace::reset();
+    }
+
+    ~RpcTraceTest()
+    {
+        RpcTrace::currentId = 0;
+        RpcTrace::setSampleInterval(0);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RpcTraceTest);
+};
+
+TEST_F(RpcTraceTest, newTraceId_disabled) {
+    EXPECT_EQ(0u, RpcTrace::newTraceId());
+}
+
+TEST_F(RpcTraceTest, newTraceId_inheritCurrentId) {
+    RpcTrace::currentId = 44;
+    EXPECT_EQ(44u, RpcTrace::newTraceId());
+}
+
+TEST_F(RpcTraceTest, newTraceId_sample) {
+    MockRandom _(100);
+    RpcTrace::setSampleInterval(3);
+    EXPECT_EQ(100u, RpcTrace::newTraceId());
+    EXPECT_EQ(0u, RpcTrace::newTraceId());
+    EXPECT_EQ(0u, RpcTrace::newTraceId());
+    EXPECT_EQ(101u, RpcTrace::newTraceId());
+}
+
+TEST_F(RpcTraceTest, sample_skipZero) {
+    MockRandom _(0x100000000);
+    RpcTrace::setSampleInterval(1);
+    EXPECT_EQ(1u, RpcTrace::newTraceId());
+}
+
+TEST_F(RpcTraceTest, getTraceId) {
+    Buffer request;
+    EXPECT_EQ(0u, RpcTrace::getTraceId(&request));
+    WireFormat::RequestCommon* header =
+            request.emplaceAppend<WireFormat::RequestCommon>();
+    header->traceId = 99;
+    EXPECT_EQ(99u, RpcTrace::getTraceId(&request));
+}
+
+TEST_F(RpcTraceTest, record) {
+    RpcTrace::record("rpc %u: first event");
+    RpcTrace::record(0, "rpc %u: second event");
+    RpcTrace::currentId = 12;
+    RpcTrace::record("rpc %u: third event %u", 7);
+    RpcTrace::record(13, "rpc %u: fourth event");
+    string trace = TimeTrace::getTrace();
+    EXPECT_FALSE(TestUtil::contains(trace, "first event"));
+    EXPECT_FALSE(TestUtil::contains(trace, "second event"));
+    EXPECT_TRUE(TestUtil::contains(trace, "rpc 12: third event 7"));
+    EXPECT_TRUE(TestUtil::contains(trace, "rpc 13: fourth event"));
+}
+
+}  // namespace RAMCloud
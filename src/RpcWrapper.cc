@@ -46,6 +46,7 @@ RpcWrapper::RpcWrapper(uint32_t responseHeaderLength, Buffer* response)
     , retryTime(0)
     , responseHeaderLength(responseHeaderLength)
     , responseHeader(NULL)
+    , traceId(0)
 {
     if (response == NULL) {
         defaultResponse.construct();
@@ -156,6 +157,11 @@ RpcWrapper::isReady() {
     RpcState copyOfState = getState();
 
     if (copyOfState == FINISHED) {
+        if (traceId != 0) {
+            RpcTrace::record(traceId, "rpc %u: client received response");
+            traceId = 0;
+        }
+
         // Retrieve the status value from the response and handle the
         // normal case of success as quickly as possible.  Note: check to
         // make sure the server has returned enough bytes for the header length
@@ -18,6 +18,7 @@
 
 #include "Fence.h"
 #include "RpcLevel.h"
+#include "RpcTrace.h"
 #include "ServerId.h"
 #include "Transport.h"
 #include "WireFormat.h"
@@ -111,6 +112,9 @@ class RpcWrapper : public Transport::RpcNotifier {
         memset(reqHdr, 0, sizeof(*reqHdr));
         reqHdr->common.opcode = RpcType::opcode;
         reqHdr->common.service = RpcType::service;
+        reqHdr->common.traceId = traceId = RpcTrace::newTraceId();
+        RpcTrace::record(traceId, "rpc %u: client sent opcode %u",
+                RpcType::opcode);
         return reqHdr;
     }
 
@@ -143,6 +147,9 @@ class RpcWrapper : public Transport::RpcNotifier {
         reqHdr->common.opcode = RpcType::opcode;
         reqHdr->common.service = RpcType::service;
         reqHdr->common.targetId = targetId.getId();
+        reqHdr->common.traceId = traceId = RpcTrace::newTraceId();
+        RpcTrace::record(traceId, "rpc %u: client sent opcode %u",
+                RpcType::opcode);
         return reqHdr;
     }
 
@@ -244,6 +251,10 @@ class RpcWrapper : public Transport::RpcNotifier {
     /// least responseHeaderLength bytes if the RPC succeeds.
     const WireFormat::ResponseCommon* responseHeader;
 
+    /// Trace id from the request header (see RpcTrace), or 0 if this RPC
+    /// isn't being traced or its completion has already been recorded.
+    uint32_t traceId;
+
     DISALLOW_COPY_AND_ASSIGN(RpcWrapper);
 };
 
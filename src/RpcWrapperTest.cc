@@ -111,6 +111,24 @@ TEST_F(RpcWrapperTest, isReady_finished) {
     EXPECT_TRUE(wrapper.isReady());
 }
 
+TEST_F(RpcWrapperTest, isReady_traced) {
+    TimeTrace::reset();
+    RpcTrace::currentId = 77;
+    RpcWrapper wrapper(4);
+    wrapper.allocHeader<WireFormat::Ping>();
+    RpcTrace::currentId = 0;
+    EXPECT_EQ(77u, RpcTrace::getTraceId(&wrapper.request));
+    wrapper.state = RpcWrapper::RpcState::FINISHED;
+    setStatus(wrapper.response, Status::STATUS_OK);
+    EXPECT_TRUE(wrapper.isReady());
+    EXPECT_EQ(0u, wrapper.traceId);
+    string trace = TimeTrace::getTrace();
+    EXPECT_TRUE(TestUtil::contains(trace, format(
+            "rpc 77: client sent opcode %d", WireFormat::PING)));
+    EXPECT_TRUE(TestUtil::contains(trace,
+            "rpc 77: client received response"));
+}
+
 TEST_F(RpcWrapperTest, isReady_shortResponseWithErrorStatus) {
     TestLog::Enable _;
     RpcWrapper wrapper(8);
@@ -69,6 +69,36 @@ struct Parser<std::queue<T>> : public RuntimeOptions::Parseable {
 
 };
 
+/**
+ * Specialization which parses a single unsigned 32-bit integer.
+ * Unparseable strings leave the target unchanged.
+ */
+template <>
+struct Parser<uint32_t> : public RuntimeOptions::Parseable {
+    explicit Parser(uint32_t& target)
+        : target(target), optionValue(std::to_string(target))
+    {}
+
+    void
+    parse(const char* value)
+    {
+        std::istringstream iss(value);
+        uint32_t parsed;
+        if (!(iss >> parsed))
+            return;
+        target = parsed;
+        optionValue = value;
+    }
+    std::string
+    getValue() {
+        return optionValue;
+    }
+    // target holds a parsed copy of value for the option.
+    uint32_t& target;
+    // A copy of the value string is saved in optionValue.
+    std::string optionValue;
+};
+
 /**
  * Parser for coordinator crash point run time options.
  * An option is just a string in this case and currently,
@@ -130,12 +160,21 @@ RuntimeOptions::RuntimeOptions()
     , mutex()
     , failRecoveryMasters()
     , crashCoordinator()
+    , balancer()
+    , recoveryPhases(1)
 {
 #define REGISTER(field) registerOption(#field, newParser(field))
     REGISTER(failRecoveryMasters);
+    REGISTER(recoveryPhases);
 #undef REGISTER
     registerOption("crashCoordinator",
             newcrashCoordParser(crashCoordinator));
+    registerOption("balancerIntervalMs", newParser(balancer.intervalMs));
+    registerOption("balancerImbalancePercent",
+            newParser(balancer.imbalancePercent));
+    registerOption("balancerMaxActionsPerRound",
+            newParser(balancer.maxActionsPerRound));
+    registerOption("balancerMinLoad", newParser(balancer.minLoad));
 }
 
 /// Free all parsers created in the constructor.
@@ -218,6 +257,27 @@ RuntimeOptions::checkAndCrashCoordinator(const char *crashPoint)
     }
 }
 
+/**
+ * Return a snapshot of the options that control the TabletBalancer.
+ */
+RuntimeOptions::BalancerOptions
+RuntimeOptions::getBalancerOptions()
+{
+    Lock _(mutex);
+    return balancer;
+}
+
+/**
+ * Return the number of phases in which crashed masters should be recovered
+ * (see Recovery::phases); always at least 1.
+ */
+uint32_t
+RuntimeOptions::getRecoveryPhases()
+{
+    Lock _(mutex);
+    return std::max(recoveryPhases, 1u);
+}
+
 // - private -
 
 /**
@@ -38,6 +38,39 @@ namespace RAMCloud {
  */
 class RuntimeOptions {
     PUBLIC:
+        /**
+         * Settings for the coordinator's TabletBalancer; see
+         * getBalancerOptions(). Each field is exposed as a runtime option
+         * named "balancer" followed by the field name with its first letter
+         * capitalized (e.g. "balancerIntervalMs").
+         */
+        struct BalancerOptions {
+            BalancerOptions()
+                : intervalMs(0)
+                , imbalancePercent(125)
+                , maxActionsPerRound(1)
+                , minLoad(1000)
+            {}
+
+            /// How often the balancer runs, in milliseconds. 0 (the default)
+            /// disables automatic balancing.
+            uint32_t intervalMs;
+
+            /// The balancer acts only if the busiest master served more than
+            /// this percentage of the average master's requests since the
+            /// last round.
+            uint32_t imbalancePercent;
+
+            /// Upper limit on the number of splits plus migrations the
+            /// balancer will start in a single round.
+            uint32_t maxActionsPerRound;
+
+            /// The balancer ignores rounds in which the busiest master served
+            /// fewer than this many requests; small samples are too noisy to
+            /// act on.
+            uint32_t minLoad;
+        };
+
         RuntimeOptions();
         ~RuntimeOptions();
 
@@ -45,6 +78,8 @@ class RuntimeOptions {
         std::string get(const char* option);
         uint32_t popFailRecoveryMasters();
         void checkAndCrashCoordinator(const char *crashPoint);
+        BalancerOptions getBalancerOptions();
+        uint32_t getRecoveryPhases();
 
     PRIVATE:
         /**
@@ -94,6 +129,19 @@ class RuntimeOptions {
          */
         std::string crashCoordinator;
 
+        /**
+         * Controls automatic splitting and migration of hot tablets by the
+         * coordinator's TabletBalancer.
+         */
+        BalancerOptions balancer;
+
+        /**
+         * Number of phases in which the data of a crashed master is brought
+         * back online; see Recovery::phases. Values below 1 are treated
+         * as 1 (the default), which recovers everything at once.
+         */
+        uint32_t recoveryPhases;
+
     DISALLOW_COPY_AND_ASSIGN(RuntimeOptions);
 };
 
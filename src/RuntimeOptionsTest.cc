@@ -70,5 +70,32 @@ TEST_F(RuntimeOptionsTest, popFailRecoveryMasters) {
     EXPECT_EQ(0u, options.popFailRecoveryMasters());
 }
 
+TEST_F(RuntimeOptionsTest, getBalancerOptions) {
+    EXPECT_EQ(0u, options.getBalancerOptions().intervalMs);
+    EXPECT_EQ("0", options.get("balancerIntervalMs"));
+    options.set("balancerIntervalMs", "500");
+    options.set("balancerImbalancePercent", "150");
+    options.set("balancerMaxActionsPerRound", "3");
+    options.set("balancerMinLoad", "10");
+    RuntimeOptions::BalancerOptions balancer = options.getBalancerOptions();
+    EXPECT_EQ(500u, balancer.intervalMs);
+    EXPECT_EQ(150u, balancer.imbalancePercent);
+    EXPECT_EQ(3u, balancer.maxActionsPerRound);
+    EXPECT_EQ(10u, balancer.minLoad);
+    EXPECT_EQ("500", options.get("balancerIntervalMs"));
+
+    // Garbage is ignored.
+    options.set("balancerIntervalMs", "soon");
+    EXPECT_EQ(500u, options.getBalancerOptions().intervalMs);
+}
+
+TEST_F(RuntimeOptionsTest, getRecoveryPhases) {
+    EXPECT_EQ(1u, options.getRecoveryPhases());
+    options.set("recoveryPhases", "4");
+    EXPECT_EQ(4u, options.getRecoveryPhases());
+    options.set("recoveryPhases", "0");
+    EXPECT_EQ(1u, options.getRecoveryPhases());
+}
+
 
 }  // namespace RAMCloud
@@ -16,6 +16,7 @@
 #include "Common.h"
 #include "BitOps.h"
 #include "LogSegment.h"
+#include "Numa.h"
 #include "SegletAllocator.h"
 #include "Segment.h"
 #include "ServerConfig.h"
@@ -26,7 +27,9 @@ namespace RAMCloud {
 /**
  * Construct a new SegmentAllocator by allocating a large chunk of memory
  * and chopping it up into individual seglets of the specified size. All
- * seglets will be placed in the lowest priority "default" pool.
+ * seglets will be placed in the lowest priority "default" pool. If the
+ * server is NUMA-aware, the memory is divided into one contiguous range per
+ * node, and each range is bound to its node.
  *
  * \param config
  *      Server runtime configuration, specifying various parameters like
@@ -41,18 +44,41 @@ SegletAllocator::SegletAllocator(const ServerConfig* config)
       emergencyHeadPoolReserve(0),
       cleanerPool(),
       cleanerPoolReserve(0),
-      defaultPool(),
+      defaultPools(),
+      freeDefaultSeglets(0),
+      numNodes(1),
+      segletsPerNode(0),
       segletToSegmentTable(),
       block(config->master.logBytes)
 {
     assert(BitOps::isPowerOfTwo(segletSize));
+    size_t numSeglets = block.length / segletSize;
+    if (config->master.numaAware) {
+        numNodes = std::max(1, std::min(Numa::getNumNodes(),
+                downCast<int>(numSeglets)));
+    }
+    segletsPerNode = std::max(numSeglets / numNodes, 1UL);
+    defaultPools.resize(numNodes);
+
     uint8_t* segletBlock = block.get();
-    for (size_t i = 0; i < (block.length / segletSize); i++) {
+    for (size_t i = 0; i < numSeglets; i++) {
         Seglet* seglet = new Seglet(*this, segletBlock, segletSize);
         segletToSegmentTable.push_back(NULL);
-        defaultPool.push_back(seglet);
+        defaultPools[getNumaNode(segletBlock)].push_back(seglet);
         segletBlock += segletSize;
     }
+    freeDefaultSeglets = numSeglets;
+
+    if (numNodes > 1) {
+        for (int node = 0; node < numNodes; node++) {
+            size_t seglets = (node == numNodes - 1)
+                    ? numSeglets - node * segletsPerNode : segletsPerNode;
+            Numa::bindMemory(block.get() + node * segletsPerNode * segletSize,
+                    seglets * segletSize, node);
+        }
+        LOG(NOTICE, "Divided %lu seglets among %d NUMA nodes", numSeglets,
+                numNodes);
+    }
 }
 
 /**
@@ -63,7 +89,7 @@ SegletAllocator::~SegletAllocator()
 {
     size_t totalFree = emergencyHeadPool.size() +
                        cleanerPool.size() +
-                       defaultPool.size();
+                       getDefaultPoolSize();
     size_t expectedFree = block.length / segletSize;
 
     if (totalFree != expectedFree)
@@ -73,8 +99,10 @@ SegletAllocator::~SegletAllocator()
         delete s;
     foreach (Seglet* s, cleanerPool)
         delete s;
-    foreach (Seglet* s, defaultPool)
-        delete s;
+    foreach (vector<Seglet*>& pool, defaultPools) {
+        foreach (Seglet* s, pool)
+            delete s;
+    }
 }
 
 /**
@@ -95,7 +123,7 @@ SegletAllocator::getMetrics(ProtoBuf::LogMetrics_SegletMetrics& m)
     m.set_emergency_head_pool_count(emergencyHeadPool.size());
     m.set_cleaner_pool_reserve(cleanerPoolReserve);
     m.set_cleaner_pool_count(cleanerPool.size());
-    m.set_default_pool_count(defaultPool.size());
+    m.set_default_pool_count(getDefaultPoolSize());
 }
 
 /**
@@ -124,7 +152,7 @@ SegletAllocator::alloc(AllocationType type,
     if (type == CLEANER)
         return allocFromPool(cleanerPool, count, outSeglets);
 
-    return allocFromPool(defaultPool, count, outSeglets);
+    return allocFromDefaultPools(count, outSeglets);
 }
 
 /**
@@ -148,7 +176,7 @@ SegletAllocator::initializeEmergencyHeadReserve(uint32_t numSeglets)
     if (emergencyHeadPoolReserve != 0)
         return false;
 
-    if (!allocFromPool(defaultPool, numSeglets, emergencyHeadPool))
+    if (!allocFromDefaultPools(numSeglets, emergencyHeadPool))
         return false;
 
     foreach (Seglet* seglet, emergencyHeadPool)
@@ -158,8 +186,8 @@ SegletAllocator::initializeEmergencyHeadReserve(uint32_t numSeglets)
         "%lu seglets (%lu MB) left in default pool.",
         numSeglets,
         static_cast<uint64_t>(numSeglets) * segletSize / 1024 / 1024,
-        defaultPool.size(),
-        defaultPool.size() * segletSize / 1024 / 1024);
+        getDefaultPoolSize(),
+        getDefaultPoolSize() * segletSize / 1024 / 1024);
 
     emergencyHeadPoolReserve = numSeglets;
     return true;
@@ -186,15 +214,15 @@ SegletAllocator::initializeCleanerReserve(uint32_t numSeglets)
     if (cleanerPoolReserve != 0)
         return false;
 
-    if (!allocFromPool(defaultPool, numSeglets, cleanerPool))
+    if (!allocFromDefaultPools(numSeglets, cleanerPool))
         return false;
 
     LOG(NOTICE, "Reserved %u seglets for the cleaner (%lu MB). %lu seglets "
         "(%lu MB) left in default pool.",
         numSeglets,
         static_cast<uint64_t>(numSeglets) * segletSize / 1024 / 1024,
-        defaultPool.size(),
-        defaultPool.size() * segletSize / 1024 / 1024);
+        getDefaultPoolSize(),
+        getDefaultPoolSize() * segletSize / 1024 / 1024);
 
     cleanerPoolReserve = numSeglets;
     return true;
@@ -240,7 +268,8 @@ SegletAllocator::free(Seglet* seglet)
     // If we're making forward progress, any excess clean seglets accumulate in
     // the default pool. New log heads can allocate from this to service new
     // log appends.
-    defaultPool.push_back(seglet);
+    defaultPools[getNumaNode(seglet->get())].push_back(seglet);
+    freeDefaultSeglets++;
 }
 
 /**
@@ -255,19 +284,20 @@ SegletAllocator::getTotalCount()
 
 /**
  * Return the number of free seglets available for the given allocation
- * type.
+ * type. The count for the DEFAULT type is read without acquiring the
+ * allocator's lock.
  */
 size_t
 SegletAllocator::getFreeCount(AllocationType type)
 {
-    std::lock_guard<SpinLock> guard(lock);
+    if (type == DEFAULT)
+        return freeDefaultSeglets;
 
+    std::lock_guard<SpinLock> guard(lock);
     if (type == EMERGENCY_HEAD)
         return emergencyHeadPool.size();
-    if (type == CLEANER)
-        return cleanerPool.size();
-    assert(type == DEFAULT);
-    return defaultPool.size();
+    assert(type == CLEANER);
+    return cleanerPool.size();
 }
 
 size_t
@@ -290,6 +320,31 @@ SegletAllocator::getSegletSize()
     return segletSize;
 }
 
+/**
+ * Return the NUMA node on which a given byte of log memory is placed (0 if
+ * the server isn't NUMA-aware).
+ *
+ * \param p
+ *      Pointer anywhere into the memory managed by this allocator.
+ */
+int
+SegletAllocator::getNumaNode(const void* p)
+{
+    size_t node = getSegletIndex(p) / segletsPerNode;
+    return (node < static_cast<size_t>(numNodes)) ? downCast<int>(node)
+                                                  : numNodes - 1;
+}
+
+/**
+ * Return the number of NUMA nodes that log memory is divided among (1 if
+ * the server isn't NUMA-aware).
+ */
+int
+SegletAllocator::getNumNumaNodes()
+{
+    return numNodes;
+}
+
 /**
  * Return a pointer to the first byte of the contiguous buffer that all log
  * memory is allocated from. This is used by the transports to register
@@ -324,7 +379,7 @@ SegletAllocator::getMemoryUtilization()
     size_t maxDefaultPoolSize = getTotalCount() -
                                 emergencyHeadPoolReserve -
                                 cleanerPoolReserve;
-    return downCast<int>(100 * (maxDefaultPoolSize - defaultPool.size()) /
+    return downCast<int>(100 * (maxDefaultPoolSize - getDefaultPoolSize()) /
                          maxDefaultPoolSize);
 }
 
@@ -400,4 +455,57 @@ SegletAllocator::allocFromPool(vector<Seglet*>& pool,
     return true;
 }
 
+/**
+ * Allocate the exact number of requested seglets from the default pools,
+ * preferring the pool for the NUMA node of the calling thread. If that
+ * pool doesn't have enough seglets, the rest come from other nodes. If the
+ * full allocation cannot be met, allocate nothing and return false.
+ *
+ * This must be called with the monitor lock held.
+ *
+ * \param count
+ *      The number of seglets to allocate.
+ * \param outSeglets
+ *      Vector to return allocated seglets in.
+ * \return
+ *      True if the full allocation succeeded, otherwise false.
+ */
+bool
+SegletAllocator::allocFromDefaultPools(uint32_t count,
+                                       vector<Seglet*>& outSeglets)
+{
+    int node = (numNodes > 1) ? Numa::getCurrentNode() : 0;
+    if (node >= numNodes)
+        node = 0;
+    if (allocFromPool(defaultPools[node], count, outSeglets)) {
+        freeDefaultSeglets -= count;
+        return true;
+    }
+    if (numNodes == 1 || getDefaultPoolSize() < count)
+        return false;
+
+    freeDefaultSeglets -= count;
+    for (int i = 0; i < numNodes && count > 0; i++) {
+        vector<Seglet*>& pool = defaultPools[(node + i) % numNodes];
+        uint32_t n = std::min(count, downCast<uint32_t>(pool.size()));
+        allocFromPool(pool, n, outSeglets);
+        count -= n;
+    }
+    return true;
+}
+
+/**
+ * Return the total number of seglets in the default pools.
+ *
+ * This must be called with the monitor lock held.
+ */
+size_t
+SegletAllocator::getDefaultPoolSize()
+{
+    size_t size = 0;
+    foreach (vector<Seglet*>& pool, defaultPools)
+        size += pool.size();
+    return size;
+}
+
 } // end RAMCloud
@@ -16,6 +16,8 @@
 #ifndef RAMCLOUD_SEGLETALLOCATOR_H
 #define RAMCLOUD_SEGLETALLOCATOR_H
 
+#include <atomic>
+
 #include "Common.h"
 #include "LargeBlockOfMemory.h"
 #include "Seglet.h"
@@ -47,7 +49,10 @@ class LogSegment;
  * the pool is always completely re-filled.
  *
  * Finally, there is a "default" pool from which regular log heads are allocated
- * to service normal log appends.
+ * to service normal log appends. If the server is NUMA-aware (see
+ * ServerConfig::Master::numaAware), the memory is divided evenly among the
+ * machine's nodes and the default pool is split into one pool per node;
+ * allocations are satisfied from the caller's node whenever possible.
  *
  * How seglets are returned to appropriate pools is somewhat subtle (and
  * annoyingly so). See the free() method's documentation if you're interested.
@@ -83,6 +88,8 @@ class SegletAllocator {
     size_t getTotalCount(AllocationType type);
     size_t getFreeCount(AllocationType type);
     uint32_t getSegletSize();
+    int getNumaNode(const void* p);
+    int getNumNumaNodes();
     const void* getBaseAddress();
     uint64_t getTotalBytes();
     int getMemoryUtilization();
@@ -94,6 +101,8 @@ class SegletAllocator {
     bool allocFromPool(vector<Seglet*>& pool,
                        uint32_t count,
                        vector<Seglet*>& outSeglets);
+    bool allocFromDefaultPools(uint32_t count, vector<Seglet*>& outSeglets);
+    size_t getDefaultPoolSize();
 
     /// Size of each seglet in bytes.
     const uint32_t segletSize;
@@ -137,8 +146,24 @@ class SegletAllocator {
     /// Maximum number of seglets to reserve in the cleanerPool.
     uint32_t cleanerPoolReserve;
 
-    /// Pool holding all other seglets not otherwise reserved.
-    vector<Seglet*> defaultPool;
+    /// Pools holding all other seglets not otherwise reserved. Element i
+    /// holds the free seglets whose memory is on NUMA node i; there is only
+    /// one pool unless the server is NUMA-aware.
+    vector<vector<Seglet*>> defaultPools;
+
+    /// Total number of seglets in defaultPools. It is only modified with
+    /// #lock held, but getFreeCount reads it without the lock so that
+    /// statistics can be gathered without delaying allocations.
+    std::atomic<size_t> freeDefaultSeglets;
+
+    /// Number of NUMA nodes the seglets are spread across (1 unless the
+    /// server is NUMA-aware and runs on a multi-node machine).
+    int numNodes;
+
+    /// Number of consecutive seglets placed on each NUMA node: the seglets
+    /// on node i are those starting at index i * segletsPerNode (the last
+    /// node also gets any left over).
+    size_t segletsPerNode;
 
     /// Table mapping blocks of memory backing Seglets to their owner LogSegment
     /// objects. This allows getOwnerSegment() to look up a LogSegment object
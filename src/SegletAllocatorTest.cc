@@ -15,6 +15,7 @@
 
 #include "TestUtil.h"
 
+#include "Numa.h"
 #include "Seglet.h"
 #include "ServerConfig.h"
 
@@ -44,7 +45,23 @@ TEST_F(SegletAllocatorTest, constructor) {
     EXPECT_EQ(0U, allocator.cleanerPoolReserve);
     EXPECT_EQ(0U, allocator.cleanerPool.size());
     EXPECT_EQ(serverConfig.master.logBytes / serverConfig.segletSize,
-        allocator.defaultPool.size());
+        allocator.defaultPools[0].size());
+}
+
+TEST_F(SegletAllocatorTest, constructor_numaAware) {
+    Numa::mockNumNodes = 2;
+    serverConfig.master.numaAware = true;
+    SegletAllocator numaAllocator(&serverConfig);
+    Numa::mockNumNodes = 0;
+
+    size_t numSeglets = serverConfig.master.logBytes / serverConfig.segletSize;
+    EXPECT_EQ(2, numaAllocator.getNumNumaNodes());
+    EXPECT_EQ(numSeglets / 2, numaAllocator.segletsPerNode);
+    EXPECT_EQ(numSeglets / 2, numaAllocator.defaultPools[0].size());
+    EXPECT_EQ(numSeglets - numSeglets / 2,
+              numaAllocator.defaultPools[1].size());
+    foreach (Seglet* seglet, numaAllocator.defaultPools[1])
+        EXPECT_EQ(1, numaAllocator.getNumaNode(seglet->get()));
 }
 
 TEST_F(SegletAllocatorTest, destructor) {
@@ -74,7 +91,7 @@ TEST_F(SegletAllocatorTest, alloc) {
     EXPECT_EQ(0U, allocator.cleanerPool.size());
     EXPECT_FALSE(allocator.alloc(SegletAllocator::CLEANER, 1, seglets));
 
-    EXPECT_EQ(318U, allocator.defaultPool.size());
+    EXPECT_EQ(318U, allocator.defaultPools[0].size());
     EXPECT_TRUE(allocator.alloc(SegletAllocator::DEFAULT, 254, seglets));
     EXPECT_EQ(0U, allocator.cleanerPool.size());
 
@@ -88,7 +105,8 @@ TEST_F(SegletAllocatorTest, initializeEmergencyHeadReserve) {
     EXPECT_EQ(0U, allocator.emergencyHeadPool.size());
     allocator.emergencyHeadPoolReserve = 0;
 
-    uint32_t maxSeglets = downCast<uint32_t>(allocator.defaultPool.size());
+    uint32_t maxSeglets = downCast<uint32_t>(
+            allocator.defaultPools[0].size());
     EXPECT_FALSE(allocator.initializeEmergencyHeadReserve(maxSeglets + 1));
     EXPECT_EQ(0U, allocator.emergencyHeadPool.size());
 
@@ -104,7 +122,8 @@ TEST_F(SegletAllocatorTest, initializeCleanerReserve) {
     EXPECT_EQ(0U, allocator.cleanerPool.size());
     allocator.cleanerPoolReserve = 0;
 
-    uint32_t maxSeglets = downCast<uint32_t>(allocator.defaultPool.size());
+    uint32_t maxSeglets = downCast<uint32_t>(
+            allocator.defaultPools[0].size());
     EXPECT_FALSE(allocator.initializeCleanerReserve(maxSeglets + 1));
     EXPECT_EQ(0U, allocator.cleanerPool.size());
 
@@ -132,13 +151,14 @@ TEST_F(SegletAllocatorTest, free) {
     allocator.free(seglets[0]);
     EXPECT_EQ(1U, allocator.cleanerPool.size());
 
-    uint32_t defaultSeglets = downCast<uint32_t>(allocator.defaultPool.size());
+    uint32_t defaultSeglets = downCast<uint32_t>(
+            allocator.defaultPools[0].size());
     allocator.free(seglets[1]);
-    EXPECT_EQ(defaultSeglets + 1, allocator.defaultPool.size());
+    EXPECT_EQ(defaultSeglets + 1, allocator.defaultPools[0].size());
 }
 
 TEST_F(SegletAllocatorTest, getFreeCount) {
-    size_t defaultSeglets = allocator.defaultPool.size();
+    size_t defaultSeglets = allocator.defaultPools[0].size();
 
     EXPECT_EQ(0U, allocator.getFreeCount(SegletAllocator::EMERGENCY_HEAD));
     allocator.initializeEmergencyHeadReserve(2);
@@ -182,24 +202,64 @@ TEST_F(SegletAllocatorTest, getMemoryUtilization) {
     EXPECT_EQ(0, allocator.getMemoryUtilization());
 }
 
+TEST_F(SegletAllocatorTest, allocFromDefaultPools) {
+    Numa::mockNumNodes = 2;
+    Numa::mockCurrentNode = 1;
+    serverConfig.master.numaAware = true;
+    SegletAllocator numaAllocator(&serverConfig);
+    size_t node0Seglets = numaAllocator.defaultPools[0].size();
+    uint32_t node1Seglets = downCast<uint32_t>(
+            numaAllocator.defaultPools[1].size());
+
+    // Seglets come from the caller's node when possible...
+    vector<Seglet*> seglets;
+    EXPECT_TRUE(numaAllocator.allocFromDefaultPools(1, seglets));
+    EXPECT_EQ(1, numaAllocator.getNumaNode(seglets[0]->get()));
+    EXPECT_EQ(node0Seglets, numaAllocator.defaultPools[0].size());
+
+    // ...and from other nodes when not.
+    EXPECT_TRUE(numaAllocator.allocFromDefaultPools(node1Seglets, seglets));
+    EXPECT_EQ(0U, numaAllocator.defaultPools[1].size());
+    EXPECT_EQ(node0Seglets - 1, numaAllocator.defaultPools[0].size());
+    EXPECT_EQ(0, numaAllocator.getNumaNode(seglets.back()->get()));
+
+    // All or nothing.
+    EXPECT_FALSE(numaAllocator.allocFromDefaultPools(
+            downCast<uint32_t>(node0Seglets), seglets));
+    EXPECT_EQ(node0Seglets - 1, numaAllocator.defaultPools[0].size());
+    EXPECT_EQ(node0Seglets - 1,
+            numaAllocator.getFreeCount(SegletAllocator::DEFAULT));
+    Numa::mockNumNodes = 0;
+    Numa::mockCurrentNode = 0;
+
+    // Freed seglets return to the pool for their node.
+    foreach (Seglet* seglet, seglets)
+        seglet->free();
+    EXPECT_EQ(node0Seglets, numaAllocator.defaultPools[0].size());
+    EXPECT_EQ(node1Seglets, numaAllocator.defaultPools[1].size());
+    EXPECT_EQ(node0Seglets + node1Seglets,
+            numaAllocator.getFreeCount(SegletAllocator::DEFAULT));
+}
+
 TEST_F(SegletAllocatorTest, allocFromPool) {
     vector<Seglet*> seglets;
-    uint32_t maxSeglets = downCast<uint32_t>(allocator.defaultPool.size());
+    uint32_t maxSeglets = downCast<uint32_t>(
+            allocator.defaultPools[0].size());
 
-    EXPECT_FALSE(allocator.allocFromPool(allocator.defaultPool,
+    EXPECT_FALSE(allocator.allocFromPool(allocator.defaultPools[0],
                                          maxSeglets + 1,
                                          seglets));
 
-    EXPECT_EQ(maxSeglets, allocator.defaultPool.size());
+    EXPECT_EQ(maxSeglets, allocator.defaultPools[0].size());
     EXPECT_EQ(0U, seglets.size());
-    EXPECT_TRUE(allocator.allocFromPool(allocator.defaultPool,
+    EXPECT_TRUE(allocator.allocFromPool(allocator.defaultPools[0],
                                         maxSeglets,
                                         seglets));
-    EXPECT_EQ(0U, allocator.defaultPool.size());
+    EXPECT_EQ(0U, allocator.defaultPools[0].size());
     EXPECT_EQ(maxSeglets, seglets.size());
 
     // return to allocator
-    allocator.allocFromPool(seglets, maxSeglets, allocator.defaultPool);
+    allocator.allocFromPool(seglets, maxSeglets, allocator.defaultPools[0]);
 }
 
 } // namespace RAMCloud
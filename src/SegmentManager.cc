@@ -158,14 +158,15 @@ SegmentManager::getMetrics(ProtoBuf::LogMetrics_SegmentMetrics& m)
 
 /**
  * Returns the number of segments currently on backup disks. May be used for
- * calculating backup space usage.
+ * calculating backup space usage. The count is read without acquiring the
+ * SegmentManager's lock, so that statistics can be gathered without delaying
+ * the log.
  *
  * @return segments on disk.
  */
 uint32_t
 SegmentManager::getSegmentsOnDisk()
 {
-    SpinLock::Guard _(lock);
     return segmentsOnDisk;
 }
 
@@ -390,6 +391,11 @@ SegmentManager::cleaningComplete(LogSegmentVector& clean,
 
     // Mark the new segments for insertion into the log when the next digest is
     // written and mark the cleaned segments for removal at the same point.
+    // The cleaner may have dropped expired or evicted objects without writing
+    // tombstones and relied on raiseSafeVersion() instead; this is safe since
+    // the head segment carrying that digest also carries the safe version
+    // (see allocHeadSegment()), so the cleaned segments can't disappear from
+    // backups before it does.
     foreach (LogSegment* s, survivors)
         injectSideSegment(s, CLEANABLE_PENDING_DIGEST, guard);
     foreach (LogSegment* s, clean)
@@ -359,8 +359,9 @@ class SegmentManager {
     SpinLock lock;
 
     /// Number of segments currently on backup disks. This is exactly the number
-    /// of ReplicatedSegments that exist.
-    uint32_t segmentsOnDisk;
+    /// of ReplicatedSegments that exist. Only modified with #lock held, but
+    /// getSegmentsOnDisk reads it without the lock.
+    std::atomic<uint32_t> segmentsOnDisk;
 
     /// Histogram used to track the number of segments present on disk so that
     /// disk utilization of masters can be monitored. This is updated every
@@ -23,6 +23,7 @@
 #include "ServerConfig.h"
 #include "ServerRpcPool.h"
 #include "MasterTableMetadata.h"
+#include "Object.h"
 #include "WorkerTimer.h"
 
 namespace RAMCloud {
@@ -258,6 +259,36 @@ TEST_F(SegmentManagerTest, cleaningComplete) {
     EXPECT_EQ(17530U, cleaned->cleanedEpoch);
 }
 
+TEST_F(SegmentManagerTest, cleaningComplete_safeVersionLoggedBeforeFree) {
+    LogSegment* cleaned = segmentManager.allocHeadSegment();
+    segmentManager.allocHeadSegment();
+    segmentManager.changeState(*cleaned, SegmentManager::CLEANABLE);
+
+    // The cleaner dropped an object of version 999 without a tombstone.
+    segmentManager.raiseSafeVersion(1000);
+    LogSegmentVector survivors;
+    LogSegmentVector clean;
+    clean.push_back(cleaned);
+    segmentManager.cleaningComplete(clean, survivors);
+    EXPECT_EQ(1U, segmentManager.segmentsByState[
+        SegmentManager::FREEABLE_PENDING_DIGEST_AND_REFERENCES].size());
+
+    // The head whose digest releases the cleaned segment must also carry
+    // the raised safe version.
+    LogSegment* head = segmentManager.allocHeadSegment();
+    EXPECT_EQ(0U, segmentManager.segmentsByState[
+        SegmentManager::FREEABLE_PENDING_DIGEST_AND_REFERENCES].size());
+    uint64_t loggedSafeVersion = 0;
+    for (SegmentIterator it(*head); !it.isDone(); it.next()) {
+        if (it.getType() != LOG_ENTRY_TYPE_SAFEVERSION)
+            continue;
+        Buffer buffer;
+        it.appendToBuffer(buffer);
+        loggedSafeVersion = ObjectSafeVersion(buffer).getSafeVersion();
+    }
+    EXPECT_EQ(1000U, loggedSafeVersion);
+}
+
 TEST_F(SegmentManagerTest, cleanableSegments) {
     LogSegmentVector cleanable;
 
@@ -238,6 +238,15 @@ struct ServerConfig {
             , numReplicas(0)
             , useMinCopysets(false)
             , allowLocalBackup(false)
+            , migrationMaxInFlight(DEFAULT_MIGRATION_MAX_IN_FLIGHT)
+            , hotKeyReplicas(0)
+            , hotKeySampleInterval(0)
+            , compactObjectBytes(0)
+            , compressColdObjectAge(0)
+            , promoteCompressedReads(0)
+            , cacheTables()
+            , cacheEvictionUtilization(95)
+            , numaAware(false)
         {}
 
         /**
@@ -257,6 +266,15 @@ struct ServerConfig {
             , numReplicas()
             , useMinCopysets()
             , allowLocalBackup()
+            , migrationMaxInFlight()
+            , hotKeyReplicas()
+            , hotKeySampleInterval()
+            , compactObjectBytes()
+            , compressColdObjectAge()
+            , promoteCompressedReads()
+            , cacheTables()
+            , cacheEvictionUtilization()
+            , numaAware()
         {}
 
         /**
@@ -276,6 +294,15 @@ struct ServerConfig {
             config.set_num_replicas(numReplicas);
             config.set_use_mincopysets(useMinCopysets);
             config.set_use_local_backup(allowLocalBackup);
+            config.set_migration_max_in_flight(migrationMaxInFlight);
+            config.set_hot_key_replicas(hotKeyReplicas);
+            config.set_hot_key_sample_interval(hotKeySampleInterval);
+            config.set_compact_object_bytes(compactObjectBytes);
+            config.set_compress_cold_object_age(compressColdObjectAge);
+            config.set_promote_compressed_reads(promoteCompressedReads);
+            config.set_cache_tables(cacheTables);
+            config.set_cache_eviction_utilization(cacheEvictionUtilization);
+            config.set_numa_aware(numaAware);
         }
 
         /**
@@ -296,6 +323,15 @@ struct ServerConfig {
             numReplicas = config.num_replicas();
             useMinCopysets = config.use_mincopysets();
             allowLocalBackup = config.use_local_backup();
+            migrationMaxInFlight = config.migration_max_in_flight();
+            hotKeyReplicas = config.hot_key_replicas();
+            hotKeySampleInterval = config.hot_key_sample_interval();
+            compactObjectBytes = config.compact_object_bytes();
+            compressColdObjectAge = config.compress_cold_object_age();
+            promoteCompressedReads = config.promote_compressed_reads();
+            cacheTables = config.cache_tables();
+            cacheEvictionUtilization = config.cache_eviction_utilization();
+            numaAware = config.numa_aware();
         }
 
         /// Total number bytes to use for the in-memory Log.
@@ -339,6 +375,57 @@ struct ServerConfig {
 
         /// If true, allow replication to local backup.
         bool allowLocalBackup;
+
+        /// Maximum number of migration data RPCs this master will keep
+        /// outstanding to the receiver while migrating a tablet. 0 sends
+        /// each transfer segment synchronously.
+        uint32_t migrationMaxInFlight;
+
+        /// Default value for migrationMaxInFlight, used both by the testing
+        /// configuration and by the --migrationMaxInFlight option.
+        static const uint32_t DEFAULT_MIGRATION_MAX_IN_FLIGHT = 4;
+
+        /// Number of other masters to which this master pushes read-only
+        /// copies of its hottest objects (see HotKeyReplicas). 0 disables
+        /// hot key replication.
+        uint32_t hotKeyReplicas;
+
+        /// Sample one out of every this many reads and writes to find the
+        /// hottest keys and tablets (see HotKeyTracker). 0 disables
+        /// sampling.
+        uint32_t hotKeySampleInterval;
+
+        /// Objects whose keys and value add up to at most this many bytes
+        /// are written to the log with a compact header (see Object). 0
+        /// means all objects use the full header.
+        uint32_t compactObjectBytes;
+
+        /// When the log cleaner relocates an object that hasn't been written
+        /// for at least this many seconds, it stores the value compressed
+        /// (see CompressedObject). 0 disables compression.
+        uint32_t compressColdObjectAge;
+
+        /// A read of a compressed object rewrites it uncompressed with
+        /// probability 1/promoteCompressedReads, so objects that become hot
+        /// again stop paying for decompression. 0 disables promotion.
+        uint32_t promoteCompressedReads;
+
+        /// Comma-separated list of the ids of tables that hold data the
+        /// application can recompute. When memory is nearly full, the log
+        /// cleaner evicts objects in these tables that haven't been
+        /// accessed recently instead of relocating them. Empty means no
+        /// table is a cache.
+        string cacheTables;
+
+        /// The log cleaner evicts objects from cacheTables only while
+        /// memory utilization (in percent) is at least this high.
+        uint32_t cacheEvictionUtilization;
+
+        /// If true, log memory is divided evenly among the machine's NUMA
+        /// nodes, new segments are preferably built from memory on the node
+        /// of the thread allocating them, and the hash table is interleaved
+        /// across all nodes. Has no effect on machines with a single node.
+        bool numaAware;
     } master;
 
     /**
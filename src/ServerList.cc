@@ -193,7 +193,14 @@ ServerList::applyServerList(const ProtoBuf::ServerList& list)
             LOG(NOTICE, "Server %s is crashed (server list version %lu)",
                     ServerId{server.server_id()}.toString().c_str(),
                     list.version_number());
-            entry.construct(ServerDetails(server));
+            // Deltas (see parseDelta) leave out the locator of a crashed
+            // server; keep the one we already have.
+            if (entry && entry->serverId == ServerId{server.server_id()} &&
+                    server.service_locator().empty()) {
+                entry->status = ServerStatus::CRASHED;
+            } else {
+                entry.construct(ServerDetails(server));
+            }
             foreach (ServerTrackerInterface* tracker, trackers) {
                 tracker->enqueueChange(*entry,
                                        ServerChangeEvent::SERVER_CRASHED);
@@ -223,6 +230,84 @@ ServerList::applyServerList(const ProtoBuf::ServerList& list)
     return version;
 }
 
+/**
+ * Append a compact binary encoding of an incremental server list update to
+ * a buffer; this is what the coordinator sends in UPDATE_SERVER_LIST RPCs
+ * in place of the ProtoBuf, which is both larger and slower to parse. Use
+ * parseDelta() to decode it.
+ *
+ * \param update
+ *      An incremental update (type UPDATE) describing a single server.
+ * \param buffer
+ *      The encoded update is appended here.
+ * \return
+ *      The number of bytes appended to \a buffer.
+ */
+uint32_t
+ServerList::appendDelta(const ProtoBuf::ServerList& update, Buffer* buffer)
+{
+    assert(update.type() == ProtoBuf::ServerList::UPDATE);
+    assert(update.server_size() == 1);
+    const ProtoBuf::ServerList::Entry& server = update.server(0);
+    bool up = static_cast<ServerStatus>(server.status()) == ServerStatus::UP;
+
+    typedef WireFormat::UpdateServerList::Request::Delta Delta;
+    Delta* delta = buffer->emplaceAppend<Delta>();
+    delta->version = update.version_number();
+    delta->serverId = server.server_id();
+    delta->replicationId = server.replication_id();
+    delta->services = server.services();
+    delta->expectedReadMBytesPerSec = server.expected_read_mbytes_per_sec();
+    delta->status = downCast<uint8_t>(server.status());
+    delta->locatorLength = up ? downCast<uint16_t>(
+            server.service_locator().size()) : 0;
+    buffer->appendCopy(server.service_locator().data(), delta->locatorLength);
+    return sizeof32(*delta) + delta->locatorLength;
+}
+
+/**
+ * Decode an update encoded by appendDelta().
+ *
+ * \param buffer
+ *      Holds the encoded update.
+ * \param offset
+ *      Offset within \a buffer of the encoded update.
+ * \param length
+ *      Number of bytes in the encoded update.
+ * \param[out] update
+ *      Filled in with the equivalent ProtoBuf, suitable for
+ *      applyServerList(). The service locator is empty unless the server
+ *      is UP.
+ * \return
+ *      True if the update was decoded, false if it was malformed.
+ */
+bool
+ServerList::parseDelta(Buffer* buffer, uint32_t offset, uint32_t length,
+                       ProtoBuf::ServerList* update)
+{
+    const WireFormat::UpdateServerList::Request::Delta* delta =
+            buffer->getOffset<WireFormat::UpdateServerList::Request::Delta>(
+            offset);
+    if (delta == NULL || length != sizeof32(*delta) + delta->locatorLength)
+        return false;
+    const char* locator = static_cast<const char*>(buffer->getRange(
+            offset + sizeof32(*delta), delta->locatorLength));
+    if (locator == NULL && delta->locatorLength > 0)
+        return false;
+
+    update->Clear();
+    update->set_version_number(delta->version);
+    update->set_type(ProtoBuf::ServerList::UPDATE);
+    ProtoBuf::ServerList::Entry* server = update->add_server();
+    server->set_services(delta->services);
+    server->set_server_id(delta->serverId);
+    server->set_service_locator(locator, delta->locatorLength);
+    server->set_expected_read_mbytes_per_sec(delta->expectedReadMBytesPerSec);
+    server->set_status(delta->status);
+    server->set_replication_id(delta->replicationId);
+    return true;
+}
+
 // - private -
 
 /**
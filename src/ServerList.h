@@ -50,6 +50,11 @@ class ServerList : public AbstractServerList {
     ServerId operator[](uint32_t indexNumber);
     uint64_t applyServerList(const ProtoBuf::ServerList& list);
 
+    static uint32_t appendDelta(const ProtoBuf::ServerList& update,
+                                Buffer* buffer);
+    static bool parseDelta(Buffer* buffer, uint32_t offset, uint32_t length,
+                           ProtoBuf::ServerList* update);
+
   PROTECTED:
     /// Internal Use Only - Does not grab locks
     ServerDetails* iget(ServerId id);
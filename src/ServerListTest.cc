@@ -171,4 +171,52 @@ TEST_F(ServerListTest, applyServerList_success) {
     tr.changes.pop();
 }
 
+TEST_F(ServerListTest, applyServerList_crashedWithoutLocator) {
+    ProtoBuf::ServerList wholeList;
+    ServerListBuilder{wholeList}
+        ({}, *ServerId{1, 0}, "mock:host=one", 101, 1);
+    wholeList.set_version_number(1);
+    wholeList.set_type(ProtoBuf::ServerList_Type_FULL_LIST);
+    sl.applyServerList(wholeList);
+
+    // Deltas for crashed servers don't carry the locator.
+    ProtoBuf::ServerList update;
+    ServerListBuilder{update}
+        ({}, *ServerId{1, 0}, "", 101, 1, ServerStatus::CRASHED);
+    update.set_version_number(2);
+    update.set_type(ProtoBuf::ServerList_Type_UPDATE);
+    sl.applyServerList(update);
+    EXPECT_FALSE(sl.isUp({1, 0}));
+    EXPECT_TRUE(sl.contains({1, 0}));
+    EXPECT_EQ("mock:host=one", sl.getLocator({1, 0}));
+}
+
+TEST_F(ServerListTest, appendDelta_parseDelta) {
+    ProtoBuf::ServerList update;
+    ServerListBuilder{update}
+        ({WireFormat::MASTER_SERVICE}, *ServerId{3, 1}, "mock:host=three",
+         103, 7);
+    update.set_version_number(12);
+    update.set_type(ProtoBuf::ServerList_Type_UPDATE);
+
+    Buffer buffer;
+    buffer.appendCopy("xx", 2);
+    uint32_t length = ServerList::appendDelta(update, &buffer);
+    EXPECT_EQ(buffer.size() - 2, length);
+    ProtoBuf::ServerList parsed;
+    EXPECT_TRUE(ServerList::parseDelta(&buffer, 2, length, &parsed));
+    EXPECT_EQ(update.ShortDebugString(), parsed.ShortDebugString());
+    EXPECT_FALSE(ServerList::parseDelta(&buffer, 2, length - 1, &parsed));
+
+    // The locator is omitted unless the server is up.
+    update.mutable_server(0)->set_status(
+            uint32_t(ServerStatus::CRASHED));
+    buffer.reset();
+    length = ServerList::appendDelta(update, &buffer);
+    EXPECT_TRUE(ServerList::parseDelta(&buffer, 0, length, &parsed));
+    EXPECT_EQ("", parsed.server(0).service_locator());
+    EXPECT_EQ(uint32_t(ServerStatus::CRASHED), parsed.server(0).status());
+    EXPECT_EQ(12lu, parsed.version_number());
+}
+
 }  // namespace RAMCloud
@@ -0,0 +1,162 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "CoordinatorServerList.h"
+#include "Cycles.h"
+#include "Logger.h"
+#include "MockCluster.h"
+#include "OptionParser.h"
+
+namespace RAMCloud {
+
+/**
+ * Measures how long it takes the coordinator to propagate a server list
+ * update to every server in a large cluster, and how many RPCs it sends to
+ * do so. The cluster is a MockCluster of servers that run only the
+ * membership and ping services, so that thousands of them fit in one
+ * process. Each round crashes one server and times
+ * CoordinatorServerList::sync(), which returns once every remaining server
+ * has acknowledged the update.
+ *
+ * BindTransport executes RPCs in the caller's thread, so a server that
+ * forwards an update reaches its servers one after another rather than in
+ * parallel; the time reported is the total work to update the cluster, not
+ * the latency a real cluster would see. The number of RPCs sent by the
+ * coordinator is exact.
+ */
+class ServerListUpdateBenchmark {
+
+  public:
+    Context context;
+    MockCluster cluster;
+    vector<Server*> servers;
+
+    explicit ServerListUpdateBenchmark(int numServers)
+        : context()
+        , cluster(&context)
+        , servers()
+    {
+        Logger::get().setLogLevels(WARNING);
+        cluster.coordinatorContext.recoveryManager->doNotStartRecoveries
+                = true;
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::PING_SERVICE,
+                           WireFormat::MEMBERSHIP_SERVICE};
+        uint64_t start = Cycles::rdtsc();
+        for (int i = 0; i < numServers; i++) {
+            config.localLocator = format("mock:host=server%d", i);
+            servers.push_back(cluster.addServer(config));
+        }
+        cluster.syncCoordinatorServerList();
+        printf("Started %d servers in %.1f s\n", numServers,
+               Cycles::toSeconds(Cycles::rdtsc() - start));
+    }
+
+    /**
+     * Crash servers one at a time, and print how long it took for each
+     * crash to be propagated to the rest of the cluster.
+     *
+     * \param rounds
+     *      Number of servers to crash.
+     * \param fanout
+     *      Value for CoordinatorServerList::updateTreeFanout; 0 means the
+     *      coordinator updates every server itself.
+     */
+    void
+    run(int rounds, uint32_t fanout)
+    {
+        CoordinatorServerList* serverList =
+                cluster.coordinatorContext.coordinatorServerList;
+        serverList->updateTreeFanout = fanout;
+
+        uint64_t totalTicks = 0;
+        uint64_t totalRpcs = 0;
+        uint64_t totalForwarded = 0;
+        for (int i = 0; i < rounds && !servers.empty(); i++) {
+            Server* victim = servers.back();
+            servers.pop_back();
+
+            uint64_t rpcsBefore =
+                    metrics->coordinator.serverListUpdateRpcCount.load();
+            uint64_t forwardedBefore =
+                    metrics->coordinator.serverListForwardedCount.load();
+            uint64_t start = Cycles::rdtsc();
+            serverList->serverCrashed(victim->serverId);
+            serverList->sync();
+            uint64_t ticks = Cycles::rdtsc() - start;
+            uint64_t rpcs =
+                    metrics->coordinator.serverListUpdateRpcCount.load() -
+                    rpcsBefore;
+            uint64_t forwarded =
+                    metrics->coordinator.serverListForwardedCount.load() -
+                    forwardedBefore;
+
+            printf("Round %3d: %8.1f us, %5lu coordinator RPCs, "
+                   "%5lu servers updated by forwarding\n",
+                   i, Cycles::toSeconds(ticks) * 1e06, rpcs, forwarded);
+            totalTicks += ticks;
+            totalRpcs += rpcs;
+            totalForwarded += forwarded;
+        }
+        if (rounds > 0) {
+            printf("Average:   %8.1f us, %7.1f coordinator RPCs, "
+                   "%7.1f servers updated by forwarding\n",
+                   Cycles::toSeconds(totalTicks) * 1e06 / rounds,
+                   static_cast<double>(totalRpcs) / rounds,
+                   static_cast<double>(totalForwarded) / rounds);
+        }
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ServerListUpdateBenchmark);
+};
+
+}  // namespace RAMCloud
+
+int
+main(int argc, char** argv)
+{
+    using namespace RAMCloud;
+
+    int numServers, rounds;
+    uint32_t fanout;
+
+    OptionsDescription benchmarkOptions("ServerListUpdateBenchmark");
+    benchmarkOptions.add_options()
+        ("servers,n",
+         ProgramOptions::value<int>(&numServers)->default_value(500),
+         "Number of servers in the cluster")
+        ("rounds,r",
+         ProgramOptions::value<int>(&rounds)->default_value(10),
+         "Number of server crashes to propagate")
+        ("fanout,f",
+         ProgramOptions::value<uint32_t>(&fanout)->default_value(32),
+         "Number of servers each recipient forwards an update to; 0 means "
+         "the coordinator updates every server directly");
+
+    OptionParser optionParser(benchmarkOptions, argc, argv);
+
+    if (numServers < 2 || rounds >= numServers) {
+        fprintf(stderr, "Need at least 2 servers and more servers than "
+                "rounds\n");
+        return 1;
+    }
+
+    ServerListUpdateBenchmark benchmark(numServers);
+    benchmark.run(rounds, fanout);
+    return 0;
+}
@@ -20,6 +20,7 @@
 
 #include "Context.h"
 #include "CoordinatorSession.h"
+#include "HardwareCounters.h"
 #if INFINIBAND
 #include "InfRcTransport.h"
 #endif
@@ -103,6 +104,7 @@ main(int argc, char *argv[])
 
         bool masterOnly;
         bool backupOnly;
+        bool hardwareCounters;
 
         OptionsDescription serverOptions("Server");
         serverOptions.add_options()
@@ -127,6 +129,20 @@ main(int argc, char *argv[])
              "of bandwidth this backup should use. Useful for artificially "
              "restricting bandwidth when measuring various parts of the "
              "system.")
+            ("cacheEvictionUtilization",
+             ProgramOptions::value<uint32_t>(
+                &config.master.cacheEvictionUtilization)->default_value(95),
+             "Once this percentage of the master's memory is in use, the log "
+             "cleaner evicts objects of cache tables (see --cacheTables) that "
+             "haven't been read or written recently, instead of relocating "
+             "them.")
+            ("cacheTables",
+             ProgramOptions::value<string>(&config.master.cacheTables)->
+                default_value(""),
+             "Comma-separated list of ids of tables whose objects this master "
+             "may evict when it runs low on memory. Use this only for tables "
+             "whose contents the application can recompute: reads of evicted "
+             "objects fail as if the objects had been deleted.")
             ("cleanerBalancer",
              ProgramOptions::value<string>(&config.master.cleanerBalancer)->
                 default_value("tombstoneRatio:0.40"),
@@ -136,6 +152,23 @@ main(int argc, char *argv[])
              "default value. Currently the only other option is \"fixed:X\", "
              "where 0 <= X <= 100 represents the percentage of CPU time the "
              "disk cleaner will be limited to (the rest is for compaction).")
+            ("compactObjectBytes",
+             ProgramOptions::value<uint32_t>(
+                &config.master.compactObjectBytes)->default_value(0),
+             "Objects whose keys and value add up to at most this many bytes "
+             "are stored with a compact header (typically 10-16 bytes "
+             "instead of 24). Servers running older versions of RAMCloud "
+             "can't read such objects during recovery or migration, so only "
+             "enable this once every server in the cluster supports it. 0 "
+             "disables compact headers.")
+            ("compressColdObjectAge",
+             ProgramOptions::value<uint32_t>(
+                &config.master.compressColdObjectAge)->default_value(0),
+             "When the log cleaner relocates an object that hasn't been "
+             "written for at least this many seconds, it stores the value "
+             "compressed with LZ4. This trades read latency for memory on "
+             "cold data. Only enable this once every server in the cluster "
+             "supports compressed objects. 0 disables compression.")
             ("detectFailures",
              ProgramOptions::value<bool>(&config.detectFailures)->
                 default_value(true),
@@ -162,11 +195,32 @@ main(int argc, char *argv[])
              ProgramOptions::value<string>(&config.backup.file)->
                 default_value("/var/tmp/backup.log"),
              "The file path to the backup storage.")
+            ("hardwareCounters",
+             ProgramOptions::bool_switch(&hardwareCounters),
+             "Measure instructions, last-level cache misses, and branch "
+             "mispredicts for each RPC with hardware performance counters; "
+             "results are reported per opcode by GET_PERF_STATS")
             ("hashTableMemory,h",
              ProgramOptions::value<string>(&hashTableMemory)->
                 default_value("10%"),
              "Percentage or megabytes of master memory allocated to "
              "the hash table")
+            ("hotKeyReplicas",
+             ProgramOptions::value<uint32_t>(
+                &config.master.hotKeyReplicas)->default_value(0),
+             "Number of other masters to which this master pushes read-only "
+             "copies of any object that receives a large fraction of its "
+             "reads, so that clients can spread reads of that object across "
+             "several servers. 0 disables hot key replication, as does "
+             "setting hotKeySampleInterval to 0.")
+            ("hotKeySampleInterval",
+             ProgramOptions::value<uint32_t>(
+                &config.master.hotKeySampleInterval)->default_value(128),
+             "Sample one out of every this many reads and writes in order "
+             "to keep track of the hottest keys and tablets on this master "
+             "(retrieved with the GET_HOT_KEYS server control) and the "
+             "objects to replicate (see hotKeyReplicas). 0 disables "
+             "sampling.")
             ("logCleanerThreads",
              ProgramOptions::value<uint32_t>(
                 &config.master.cleanerThreadCount)->default_value(1),
@@ -192,12 +246,33 @@ main(int argc, char *argv[])
              "value 0 is special: it tells the server to set the "
              "limit equal to the \"segmentFrames\" value, effectively making "
              "buffering unlimited.")
+            ("migrationMaxInFlight",
+             ProgramOptions::value<uint32_t>(
+                &config.master.migrationMaxInFlight)->default_value(uint32_t(
+                ServerConfig::Master::DEFAULT_MIGRATION_MAX_IN_FLIGHT)),
+             "Maximum number of transfer segments this master will keep in "
+             "flight to the receiving master while migrating a tablet. Higher "
+             "values overlap the log scan with the network transfer and let "
+             "the receiver replay several segments in parallel. 0 sends each "
+             "segment synchronously.")
+            ("numaAware",
+             ProgramOptions::bool_switch(&config.master.numaAware),
+             "Divide the master's log memory among the machine's NUMA nodes, "
+             "build new segments from memory on the node of the thread that "
+             "allocates them, and interleave the hash table across all "
+             "nodes.")
             ("preferredIndex",
              ProgramOptions::value<uint32_t>(
                 &config.preferredIndex)->default_value(0),
              "Use this value as the index number for this server's server id, "
              "if that number isn't already in use. Can be used to ensure "
              "a reproducible assignment of server ids.")
+            ("promoteCompressedReads",
+             ProgramOptions::value<uint32_t>(
+                &config.master.promoteCompressedReads)->default_value(0),
+             "Rewrite a compressed object uncompressed on about one in this "
+             "many reads, so that objects that become hot again stop paying "
+             "for decompression. 0 disables promotion.")
             ("replicas,r",
              ProgramOptions::value<uint32_t>(&config.master.numReplicas),
              "Number of backup copies to make for each segment")
@@ -270,6 +345,8 @@ main(int argc, char *argv[])
                                WireFormat::PING_SERVICE};
         }
 
+        HardwareCounters::setEnabled(hardwareCounters);
+
         const string localLocator = optionParser.options.getLocalLocator();
 
 #if INFINIBAND
@@ -0,0 +1,204 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_SPACESAVING_H
+#define RAMCLOUD_SPACESAVING_H
+
+#include <algorithm>
+#include <map>
+
+#include "Common.h"
+
+namespace RAMCloud {
+
+/**
+ * Finds the most frequent items in a stream using a fixed amount of memory,
+ * with the Space-Saving algorithm of Metwally, Agrawal, and El Abbadi.
+ *
+ * The sketch keeps a counter for at most #capacity distinct items. An item
+ * that isn't being counted replaces the item with the smallest count and
+ * inherits that count (which is recorded as the new item's possible
+ * overestimate). Any item whose true count exceeds total/capacity is
+ * guaranteed to be in the sketch, and no count is ever too low.
+ *
+ * This class is not thread-safe; callers are expected to sample their
+ * stream and serialize calls to #add under a lock of their own.
+ *
+ * \tparam K
+ *      Type of the items counted. Must be copyable and have operator<.
+ */
+template<typename K>
+class SpaceSaving {
+  public:
+    /**
+     * One entry in the result of #getTop.
+     */
+    struct Item {
+        Item(const K& key, uint64_t count, uint64_t error)
+            : key(key)
+            , count(count)
+            , error(error)
+        {}
+
+        /// The item.
+        K key;
+
+        /// Upper bound on the total weight added for #key since the last
+        /// #reset.
+        uint64_t count;
+
+        /// How much #count may overstate the true weight; count - error is
+        /// a lower bound.
+        uint64_t error;
+    };
+
+    /**
+     * Construct an empty sketch.
+     *
+     * \param capacity
+     *      Maximum number of distinct items to count. Memory use and the
+     *      cost of #add are proportional to this.
+     */
+    explicit SpaceSaving(uint32_t capacity)
+        : capacity(std::max(capacity, 1U))
+        , counters()
+        , total(0)
+    {}
+
+    /**
+     * Record an occurrence of an item.
+     *
+     * \param key
+     *      The item.
+     * \param weight
+     *      How much to add to the item's count (e.g. 1 for an operation, or
+     *      a number of bytes).
+     */
+    void
+    add(const K& key, uint64_t weight = 1)
+    {
+        total += weight;
+        typename CounterMap::iterator it = counters.find(key);
+        if (it != counters.end()) {
+            it->second.count += weight;
+            return;
+        }
+        if (counters.size() < capacity) {
+            counters.insert({key, Counter(weight, 0)});
+            return;
+        }
+
+        // Evict the item with the smallest count. The scan is linear, but
+        // the sketch is small and only sampled items ever get here.
+        typename CounterMap::iterator min = counters.begin();
+        for (it = counters.begin(); it != counters.end(); it++) {
+            if (it->second.count < min->second.count)
+                min = it;
+        }
+        uint64_t minCount = min->second.count;
+        counters.erase(min);
+        counters.insert({key, Counter(minCount + weight, minCount)});
+    }
+
+    /**
+     * Return an upper bound on the weight recorded for an item since the
+     * last #reset (0 if the item isn't currently counted).
+     */
+    uint64_t
+    estimate(const K& key) const
+    {
+        typename CounterMap::const_iterator it = counters.find(key);
+        if (it == counters.end())
+            return 0;
+        return it->second.count;
+    }
+
+    /**
+     * Return the items currently counted, most frequent first.
+     *
+     * \param[out] items
+     *      The items are appended here.
+     * \param limit
+     *      Return at most this many items.
+     */
+    void
+    getTop(vector<Item>* items, uint32_t limit = ~0U) const
+    {
+        size_t first = items->size();
+        for (typename CounterMap::const_iterator it = counters.begin();
+                it != counters.end(); it++) {
+            items->emplace_back(it->first, it->second.count,
+                    it->second.error);
+        }
+        std::sort(items->begin() + first, items->end(),
+                [](const Item& a, const Item& b) { return a.count > b.count; });
+        if (items->size() - first > limit)
+            items->erase(items->begin() + first + limit, items->end());
+    }
+
+    /**
+     * Return the total weight added since the last #reset.
+     */
+    uint64_t
+    getTotal() const
+    {
+        return total;
+    }
+
+    /**
+     * Forget everything recorded so far; used to start a new measurement
+     * window.
+     */
+    void
+    reset()
+    {
+        counters.clear();
+        total = 0;
+    }
+
+  PRIVATE:
+    /**
+     * Count for one item.
+     */
+    struct Counter {
+        Counter(uint64_t count, uint64_t error)
+            : count(count)
+            , error(error)
+        {}
+
+        /// See Item::count.
+        uint64_t count;
+
+        /// See Item::error.
+        uint64_t error;
+    };
+
+    typedef std::map<K, Counter> CounterMap;
+
+    /// Maximum number of entries in #counters.
+    const uint32_t capacity;
+
+    /// Items currently being counted.
+    CounterMap counters;
+
+    /// Total weight added since the last #reset.
+    uint64_t total;
+
+    DISALLOW_COPY_AND_ASSIGN(SpaceSaving);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_SPACESAVING_H
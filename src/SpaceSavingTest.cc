@@ -0,0 +1,99 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "SpaceSaving.h"
+
+namespace RAMCloud {
+
+class SpaceSavingTest : public ::testing::Test {
+  public:
+    typedef SpaceSaving<string>::Item Item;
+
+    SpaceSaving<string> sketch;
+
+    SpaceSavingTest()
+        : sketch(3)
+    {}
+
+    DISALLOW_COPY_AND_ASSIGN(SpaceSavingTest);
+};
+
+TEST_F(SpaceSavingTest, add_existingAndNew) {
+    sketch.add("a");
+    sketch.add("a", 4);
+    sketch.add("b", 2);
+    EXPECT_EQ(5U, sketch.estimate("a"));
+    EXPECT_EQ(2U, sketch.estimate("b"));
+    EXPECT_EQ(0U, sketch.estimate("c"));
+    EXPECT_EQ(7U, sketch.getTotal());
+}
+
+TEST_F(SpaceSavingTest, add_evictsSmallest) {
+    sketch.add("a", 10);
+    sketch.add("b", 2);
+    sketch.add("c", 5);
+    sketch.add("d");
+    EXPECT_EQ(0U, sketch.estimate("b"));
+    EXPECT_EQ(3U, sketch.estimate("d"));
+
+    vector<Item> items;
+    sketch.getTop(&items);
+    ASSERT_EQ(3U, items.size());
+    EXPECT_EQ("d", items[2].key);
+    EXPECT_EQ(3U, items[2].count);
+    EXPECT_EQ(2U, items[2].error);
+    EXPECT_EQ(0U, items[0].error);
+}
+
+TEST_F(SpaceSavingTest, add_heavyHitterSurvives) {
+    // "hot" gets more than a third of the stream, so it can never be
+    // evicted from a sketch of capacity 3.
+    for (int i = 0; i < 100; i++) {
+        sketch.add("hot");
+        sketch.add(format("cold%d", i));
+    }
+    EXPECT_LE(100U, sketch.estimate("hot"));
+    vector<Item> items;
+    sketch.getTop(&items, 1);
+    ASSERT_EQ(1U, items.size());
+    EXPECT_EQ("hot", items[0].key);
+}
+
+TEST_F(SpaceSavingTest, getTop) {
+    vector<Item> items;
+    items.emplace_back("existing", 99, 0);
+    sketch.add("a", 1);
+    sketch.add("b", 3);
+    sketch.add("c", 2);
+    sketch.getTop(&items, 2);
+    ASSERT_EQ(3U, items.size());
+    EXPECT_EQ("existing", items[0].key);
+    EXPECT_EQ("b", items[1].key);
+    EXPECT_EQ("c", items[2].key);
+}
+
+TEST_F(SpaceSavingTest, reset) {
+    sketch.add("a", 3);
+    sketch.reset();
+    EXPECT_EQ(0U, sketch.estimate("a"));
+    EXPECT_EQ(0U, sketch.getTotal());
+    vector<Item> items;
+    sketch.getTop(&items);
+    EXPECT_EQ(0U, items.size());
+}
+
+}  // namespace RAMCloud
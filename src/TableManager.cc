@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <set>
+
 #include "CoordinatorServerList.h"
 #include "CoordinatorService.h"
 #include "IndexKey.h"
@@ -42,6 +44,8 @@ TableManager::TableManager(Context* context,
     , directory()
     , idMap()
     , backingTableMap()
+    , configEpoch(generateRandom())
+    , lastConfigVersion(0)
 {
     context->tableManager = this;
 }
@@ -181,6 +185,7 @@ TableManager::coordSplitAndMigrateIndexlet(
     index->indexlets.push_back(new Indexlet(
             splitKey, splitKeyLength, firstNotOwnedKey, firstNotOwnedKeyLength,
             newOwner, newBackingTableId, tableId, indexId));
+    recordIndexChange(lock, table);
 
     MasterClient::takeIndexletOwnership(
             context, newOwner, tableId, indexId, newBackingTableId,
@@ -299,6 +304,7 @@ TableManager::createIndex(uint64_t tableId, uint8_t indexId, uint8_t indexType,
     }
 
     table->indexMap[indexId] = index;
+    recordIndexChange(lock, table);
     notifyCreateIndex(lock, index);
     return;
 }
@@ -555,6 +561,7 @@ TableManager::indexletRecovered(
         {
             indexlet->serverId = serverId;
             indexlet->backingTableId = backingTableId;
+            recordIndexChange(lock, table);
             foundIndexlet = 1;
             LOG(NOTICE, "found indexlet and changed its server id to %s",
                 serverId.toString().c_str());
@@ -589,7 +596,10 @@ TableManager::isIndexletTable(uint64_t tableId)
  *      Identifies the server whose tablets status should be marked as
  *      recovering.
  * \return
- *      Copies of all the Tablets that are owned by \a serverId.
+ *      Copies of all the Tablets that are owned by \a serverId. Also
+ *      included, with status PULL_SOURCE, are the copies \a serverId was
+ *      keeping for masters still pulling tablets from it; these tablets
+ *      stay available at their owners, so they are not marked.
  */
 vector<Tablet>
 TableManager::markAllTabletsRecovering(ServerId serverId)
@@ -602,19 +612,93 @@ TableManager::markAllTabletsRecovering(ServerId serverId)
         foreach (Tablet* tablet, table->tablets) {
             if (tablet->serverId == serverId) {
                 tablet->status = Tablet::RECOVERING;
+                recordTabletChange(lock, table, tablet->startKeyHash);
                 results.push_back(*tablet);
+            } else if (tablet->pullSource == serverId) {
+                Tablet copy(*tablet);
+                copy.serverId = serverId;
+                copy.status = Tablet::PULL_SOURCE;
+                copy.ctime = tablet->pullSourceCtime;
+                results.push_back(copy);
             }
         }
     }
     return results;
 }
 
+/**
+ * Invoked by MasterRecoveryManager once a recovery master has restored
+ * the copy of a tablet that a crashed master was keeping for the
+ * tablet's owner to pull from (see markAllTabletsRecovering). The owner
+ * is told to continue its pull from the recovery master.
+ *
+ * \param tableId
+ *      Id of table containing the tablet.
+ * \param startKeyHash
+ *      First key hash that is part of range of key hashes for the tablet.
+ * \param endKeyHash
+ *      Last key hash that is part of range of key hashes for the tablet.
+ * \param serverId
+ *      Recovery master that now holds the copy.
+ * \param ctime
+ *      The copy's ctime in the log of \a serverId.
+ * \throw NoSuchTablet
+ *      If the arguments do not identify a tablet currently in the tablet map.
+ */
+void
+TableManager::pullSourceRecovered(
+        uint64_t tableId, uint64_t startKeyHash, uint64_t endKeyHash,
+        ServerId serverId, LogPosition ctime)
+{
+    Lock lock(mutex);
+    IdMap::iterator it = idMap.find(tableId);
+    if (it == idMap.end())
+        throw NoSuchTablet(HERE);
+    Table* table = it->second;
+    Tablet* tablet = findTablet(lock, table, startKeyHash);
+    if ((tablet->startKeyHash != startKeyHash) ||
+            (tablet->endKeyHash != endKeyHash)) {
+        throw NoSuchTablet(HERE);
+    }
+    if (!tablet->pullSource.isValid()) {
+        // The owner finished its pull while the old source was being
+        // recovered. The recovered copy is no longer needed, but the
+        // recovery master is still installing it, so it can't be dropped
+        // yet; it just wastes memory.
+        LOG(WARNING, "Tablet [0x%lx,0x%lx] in tableId %lu was already "
+                "pulled; copy recovered on %s is unused",
+                startKeyHash, endKeyHash, tableId,
+                serverId.toString().c_str());
+        return;
+    }
+
+    LOG(NOTICE, "%s now pulls tablet [0x%lx,0x%lx] in tableId %lu from %s",
+            tablet->serverId.toString().c_str(), startKeyHash, endKeyHash,
+            tableId, serverId.toString().c_str());
+    tablet->pullSource = serverId;
+    tablet->pullSourceCtime = ctime;
+
+    ProtoBuf::Table externalInfo;
+    serializeTable(lock, table, &externalInfo);
+    externalInfo.set_sequence_number(updateManager->nextSequenceNumber());
+    ProtoBuf::Table::Reassign* reassign = externalInfo.mutable_reassign();
+    reassign->set_server_id(tablet->serverId.getId());
+    reassign->set_start_key_hash(startKeyHash);
+    reassign->set_end_key_hash(endKeyHash);
+    reassign->set_pull_source_id(serverId.getId());
+    syncTable(lock, table, &externalInfo);
+
+    notifyReassignTablet(lock, &externalInfo);
+    updateManager->updateFinished(externalInfo.sequence_number());
+}
+
 /**
  * Switch ownership of a tablet from one master to another and alert the new
  * master that it should begin servicing requests on that tablet. This method
  * does not actually transfer the contents of the tablet; the caller should
- * already have taken care of that. This method is used to complete the
- * migration of a tablet from one server to another.
+ * already have taken care of that, unless \a pullSource is given. This
+ * method is used to complete the migration of a tablet from one server to
+ * another.
  *
  * \param newOwner
  *      ServerId of the server that will own this tablet at the end of
@@ -629,6 +713,11 @@ TableManager::markAllTabletsRecovering(ServerId serverId)
  *      ServerId of the log head before migration.
  * \param ctimeSegmentOffset
  *      Offset in log head before migration.
+ * \param pullSource
+ *      If valid, the new owner takes the tablet over at once and pulls its
+ *      objects from this master afterwards. If invalid and \a newOwner
+ *      already owns the tablet, \a newOwner has finished such a pull, and
+ *      the master it pulled from is told to drop its copy.
  *
  * \throw NoSuchTable
  *      If tableId does not specify an existing table.
@@ -639,7 +728,8 @@ void
 TableManager::reassignTabletOwnership(
         ServerId newOwner, uint64_t tableId,
         uint64_t startKeyHash, uint64_t endKeyHash,
-        uint64_t ctimeSegmentId, uint64_t ctimeSegmentOffset)
+        uint64_t ctimeSegmentId, uint64_t ctimeSegmentOffset,
+        ServerId pullSource)
 {
     Lock lock(mutex);
     IdMap::iterator it = idMap.find(tableId);
@@ -651,6 +741,32 @@ TableManager::reassignTabletOwnership(
             || (tablet->endKeyHash != endKeyHash))
         throw NoSuchTablet(HERE);
     if (tablet->serverId == newOwner) {
+        if (!pullSource.isValid() && tablet->pullSource.isValid()) {
+            // The owner has pulled all of the tablet's objects.
+            LOG(NOTICE, "%s finished pulling tablet [0x%lx,0x%lx] in "
+                    "tableId %lu from %s", newOwner.toString().c_str(),
+                    startKeyHash, endKeyHash, tableId,
+                    tablet->pullSource.toString().c_str());
+            ServerId oldSource = tablet->pullSource;
+            tablet->pullSource = ServerId();
+            tablet->pullSourceCtime = LogPosition();
+
+            ProtoBuf::Table externalInfo;
+            serializeTable(lock, table, &externalInfo);
+            externalInfo.set_sequence_number(
+                    updateManager->nextSequenceNumber());
+            ProtoBuf::Table::Reassign* reassign =
+                    externalInfo.mutable_reassign();
+            reassign->set_server_id(newOwner.getId());
+            reassign->set_start_key_hash(startKeyHash);
+            reassign->set_end_key_hash(endKeyHash);
+            reassign->set_finished_pull_source_id(oldSource.getId());
+            syncTable(lock, table, &externalInfo);
+
+            notifyReassignTablet(lock, &externalInfo);
+            updateManager->updateFinished(externalInfo.sequence_number());
+            return;
+        }
         RAMCLOUD_LOG(NOTICE, "Ownership of tablet [0x%lx,0x%lx] in tableId %lu"
                 " already transfered", startKeyHash, endKeyHash, tableId);
         return;
@@ -666,9 +782,14 @@ TableManager::reassignTabletOwnership(
     // from being considered part of this tablet.
     LogPosition headOfLogAtCreation(ctimeSegmentId,
                                       ctimeSegmentOffset);
+    if (pullSource.isValid()) {
+        tablet->pullSource = pullSource;
+        tablet->pullSourceCtime = tablet->ctime;
+    }
     tablet->ctime = headOfLogAtCreation;
     tablet->serverId = newOwner;
     tablet->status = Tablet::NORMAL;
+    recordTabletChange(lock, table, startKeyHash);
 
     // Record information about the new assignment in external storage,
     // in case we crash.
@@ -679,6 +800,8 @@ TableManager::reassignTabletOwnership(
     reassign->set_server_id(newOwner.getId());
     reassign->set_start_key_hash(startKeyHash);
     reassign->set_end_key_hash(endKeyHash);
+    if (pullSource.isValid())
+        reassign->set_pull_source_id(pullSource.getId());
     syncTable(lock, table, &externalInfo);
 
     // Finish up by notifying the relevant master.
@@ -786,19 +909,7 @@ TableManager::serializeTableConfig(ProtoBuf::TableConfig* tableConfig,
 
     // filling tablets
     foreach (Tablet* tablet, table->tablets) {
-        ProtoBuf::TableConfig::Tablet& entry(*tableConfig->add_tablet());
-        tablet->serialize((ProtoBuf::Tablets::Tablet&)entry);
-        try {
-            string locator = context->serverList->getLocator(
-                    tablet->serverId);
-            entry.set_service_locator(locator);
-        } catch (const ServerListException& e) {
-            RAMCLOUD_CLOG(NOTICE, "Server id (%s) in tablet map no longer "
-                    "in server list; omitting locator for entry (tableName %s, "
-                    "tableId %lu, startKeyHash 0x%lx)",
-                    tablet->serverId.toString().c_str(), table->name.c_str(),
-                    tableId, tablet->startKeyHash);
-        }
+        serializeTablet(lock, table, tablet, tableConfig);
     }
 
     // filling indexes
@@ -848,6 +959,75 @@ TableManager::serializeTableConfig(ProtoBuf::TableConfig* tableConfig,
     }
 }
 
+/**
+ * Fills in a protocol buffer with the configuration of a table, like
+ * serializeTableConfig, except that if the caller already has a recent
+ * version of the configuration, only the tablets that have changed since
+ * are included.
+ *
+ * \param tableConfig
+ *      Protocol buffer to which entries are added. If the return value is
+ *      true, it contains an entry for each tablet that was created or
+ *      modified since the given version, and the start key hash of each
+ *      tablet that was deleted since then (removed_start_key_hash); there
+ *      are no index entries.
+ * \param tableId
+ *      The id of the table whose configuration will be fetched. If
+ *      the table doesn't exist, then the protocol buffer ends up empty.
+ * \param[in,out] epoch
+ *      On entry, the epoch of the configuration the caller already has (as
+ *      returned by an earlier call), or 0. On return, the epoch of the
+ *      current configuration (0 if the table doesn't exist).
+ * \param[in,out] version
+ *      On entry, the version of the configuration the caller already has,
+ *      or 0. On return, the version of the current configuration.
+ * \return
+ *      True means \a tableConfig only describes the changes since the
+ *      caller's version; false means it describes the entire table.
+ */
+bool
+TableManager::serializeTableConfigChanges(ProtoBuf::TableConfig* tableConfig,
+        uint64_t tableId, uint64_t* epoch, uint64_t* version)
+{
+    Lock lock(mutex);
+    uint64_t knownEpoch = *epoch;
+    uint64_t knownVersion = *version;
+    *epoch = 0;
+    *version = 0;
+    IdMap::iterator it = idMap.find(tableId);
+    if (it == idMap.end())
+        return false;
+    Table* table = it->second;
+    *epoch = configEpoch;
+    *version = table->version;
+
+    if (knownEpoch != configEpoch ||
+            knownVersion < table->firstChangeVersion ||
+            knownVersion < table->indexVersion ||
+            knownVersion > table->version) {
+        // The caller's version is too old (or came from a different
+        // coordinator): send everything.
+        lock.unlock();
+        serializeTableConfig(tableConfig, tableId);
+        return false;
+    }
+
+    std::set<uint64_t> changed;
+    for (auto change = table->tabletChanges.rbegin();
+            change != table->tabletChanges.rend() &&
+            change->version > knownVersion; change++) {
+        changed.insert(change->startKeyHash);
+    }
+    foreach (Tablet* tablet, table->tablets) {
+        if (changed.erase(tablet->startKeyHash) > 0)
+            serializeTablet(lock, table, tablet, tableConfig);
+    }
+    foreach (uint64_t startKeyHash, changed) {
+        tableConfig->add_removed_start_key_hash(startKeyHash);
+    }
+    return true;
+}
+
 /**
  * Split a tablet into two disjoint tablets at a specific key hash. Check
  * if the split already exists, in which case, just return. Also informs
@@ -870,7 +1050,49 @@ TableManager::splitTablet(const char* name, uint64_t splitKeyHash)
     Directory::iterator it = directory.find(name);
     if (it == directory.end())
         throw NoSuchTable(HERE);
-    Table* table = it->second;
+    splitTablet(lock, it->second, splitKeyHash);
+}
+
+/**
+ * Split a tablet into two disjoint tablets at a specific key hash. This
+ * method is identical to the one above except that the table is
+ * identified by its id rather than its name.
+ *
+ * \param tableId
+ *      Id of the table that contains the tablet to be split.
+ * \param splitKeyHash
+ *      Key hash to used to partition the tablet into two. Keys less than
+ *      \a splitKeyHash belong to one tablet, keys greater than or equal to
+ *      \a splitKeyHash belong to the other.
+ *
+ * \throw NoSuchTable
+ *      If tableId does not specify an existing table.
+ */
+void
+TableManager::splitTablet(uint64_t tableId, uint64_t splitKeyHash)
+{
+    Lock lock(mutex);
+    IdMap::iterator it = idMap.find(tableId);
+    if (it == idMap.end())
+        throw NoSuchTable(HERE);
+    splitTablet(lock, it->second, splitKeyHash);
+}
+
+/**
+ * Does most of the work of the public splitTablet methods, once the table
+ * has been located.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table that contains the tablet to be split.
+ * \param splitKeyHash
+ *      Key hash to used to partition the tablet into two.
+ */
+void
+TableManager::splitTablet(const Lock& lock, Table* table,
+        uint64_t splitKeyHash)
+{
     Tablet* tablet = findTablet(lock, table, splitKeyHash);
     if (splitKeyHash == tablet->startKeyHash)
         return;
@@ -880,12 +1102,20 @@ TableManager::splitTablet(const char* name, uint64_t splitKeyHash)
         throw RetryException(HERE, 1000000, 2000000,
                 "can't split tablet now: recovery is underway");
     }
+    if (tablet->pullSource.isValid()) {
+        // The owner and its pull source each track the tablet by its
+        // whole range; wait until the pull is done.
+        throw RetryException(HERE, 1000000, 2000000,
+                "can't split tablet now: its objects are still being pulled");
+    }
 
     // Perform the split on our in-memory structures.
     table->tablets.push_back(new Tablet(tablet->tableId, splitKeyHash,
             tablet->endKeyHash, tablet->serverId, tablet->status,
             tablet->ctime));
     tablet->endKeyHash = splitKeyHash - 1;
+    recordTabletChange(lock, table, tablet->startKeyHash);
+    recordTabletChange(lock, table, splitKeyHash);
 
     // Record information about the split in external storage, in case we
     // crash.
@@ -930,12 +1160,15 @@ TableManager::splitRecoveringTablet(uint64_t tableId, uint64_t splitKeyHash)
     if (splitKeyHash == tablet->startKeyHash)
         return;
     assert(tablet->status == Tablet::RECOVERING);
+    assert(!tablet->pullSource.isValid());
 
     // Perform the split on our in-memory structures.
     table->tablets.push_back(new Tablet(tablet->tableId, splitKeyHash,
             tablet->endKeyHash, tablet->serverId, tablet->status,
             tablet->ctime));
     tablet->endKeyHash = splitKeyHash - 1;
+    recordTabletChange(lock, table, tablet->startKeyHash);
+    recordTabletChange(lock, table, splitKeyHash);
 
     // No need to record anything in external storage right now. If
     // recovery completes successfully, the Table info will get written
@@ -985,10 +1218,16 @@ TableManager::tabletRecovered(
         throw NoSuchTablet(HERE);
     }
 
-    // Update in-memory data structures.
+    // Update in-memory data structures. If the crashed master was still
+    // pulling the tablet, the recovery master pulled the rest of it, so
+    // the old source's copy is no longer needed.
+    ServerId oldSource = tablet->pullSource;
     tablet->serverId = serverId;
     tablet->status = Tablet::NORMAL;
     tablet->ctime = ctime;
+    tablet->pullSource = ServerId();
+    tablet->pullSourceCtime = LogPosition();
+    recordTabletChange(lock, table, startKeyHash);
 
     // Record this update in external storage, in case we crash.  For this
     // operation there is nothing to "complete" after crash recovery other
@@ -998,6 +1237,9 @@ TableManager::tabletRecovered(
     serializeTable(lock, table, &externalInfo);
     externalInfo.set_sequence_number(0);
     syncTable(lock, table, &externalInfo);
+
+    if (oldSource.isValid())
+        dropPullSource(lock, tableId, startKeyHash, endKeyHash, oldSource);
 }
 
 /**
@@ -1035,7 +1277,7 @@ TableManager::createTable(const Lock& lock, const char* name,
 
     // Each iteration through the following loop assigns one tablet
     // for the table to a master.
-    Table* table = new Table(name, tableId);
+    Table* table = new Table(name, tableId, ++lastConfigVersion);
     try {
         uint64_t tabletRange = 1 + ~0UL / serverSpan;
         for (uint32_t i = 0; i < serverSpan; i++) {
@@ -1138,6 +1380,7 @@ TableManager::dropIndex(const Lock& lock, uint64_t tableId, uint8_t indexId)
 
     LOG(NOTICE, "Dropping index '%u' from table '%lu'", indexId, tableId);
     table->indexMap.erase(indexId);
+    recordIndexChange(lock, table);
     notifyDropIndex(lock, index);
     delete index;
 
@@ -1207,6 +1450,40 @@ TableManager::dropTable(const Lock& lock, const char* name)
     updateManager->updateFinished(externalInfo.sequence_number());
 }
 
+/**
+ * Tell a master that was serving a tablet to a puller (see
+ * Tablet::pullSource) that it can delete its copy of the tablet.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param tableId
+ *      Id of table containing the tablet.
+ * \param startKeyHash
+ *      First key hash that is part of range of key hashes for the tablet.
+ * \param endKeyHash
+ *      Last key hash that is part of range of key hashes for the tablet.
+ * \param pullSource
+ *      Master holding the copy.
+ */
+void
+TableManager::dropPullSource(const Lock& lock, uint64_t tableId,
+        uint64_t startKeyHash, uint64_t endKeyHash, ServerId pullSource)
+{
+    try {
+        LOG(NOTICE, "Requesting pull source %s to drop table id %lu, "
+                "key hashes 0x%lx-0x%lx", pullSource.toString().c_str(),
+                tableId, startKeyHash, endKeyHash);
+        MasterClient::dropTabletOwnership(context, pullSource, tableId,
+                startKeyHash, endKeyHash);
+    } catch (ServerNotUpException& e) {
+        // A crashed master's copy goes away with it.
+        LOG(NOTICE, "dropTabletOwnership skipped for pull source %s "
+                "(table %lu, key hashes 0x%lx-0x%lx) because server isn't "
+                "running", pullSource.toString().c_str(), tableId,
+                startKeyHash, endKeyHash);
+    }
+}
+
 /**
  * Given an index key, find the indexlet containing that entry.
  *
@@ -1372,6 +1649,10 @@ TableManager::notifyDropTable(const Lock& lock, ProtoBuf::Table* info)
                     serverId.toString().c_str(), info->id(),
                     tablet.start_key_hash(), tablet.end_key_hash());
         }
+        if (tablet.has_pull_source_id()) {
+            dropPullSource(lock, info->id(), tablet.start_key_hash(),
+                    tablet.end_key_hash(), ServerId(tablet.pull_source_id()));
+        }
     }
 
     // If the deleted table's id is the largest one in use, we need
@@ -1486,13 +1767,23 @@ TableManager::notifyReassignTablet(const Lock& lock, ProtoBuf::Table* info)
 {
     const ProtoBuf::Table::Reassign& reassign = info->reassign();
     ServerId serverId(reassign.server_id());
+    if (reassign.has_finished_pull_source_id()) {
+        dropPullSource(lock, info->id(), reassign.start_key_hash(),
+                reassign.end_key_hash(),
+                ServerId(reassign.finished_pull_source_id()));
+        return;
+    }
+    ServerId pullSource;
+    if (reassign.has_pull_source_id())
+        pullSource = ServerId(reassign.pull_source_id());
     try {
         LOG(NOTICE, "Reassigning table id %lu, key hashes 0x%lx-0x%lx "
                 "to master %s",
                 info->id(), reassign.start_key_hash(), reassign.end_key_hash(),
                 serverId.toString().c_str());
         MasterClient::takeTabletOwnership(context, serverId, info->id(),
-                reassign.start_key_hash(), reassign.end_key_hash());
+                reassign.start_key_hash(), reassign.end_key_hash(),
+                pullSource);
     } catch (ServerNotUpException& e) {
         // The master has apparently crashed. This should be benign (we will
         // eventually recover the tablet as part of recovering the master),
@@ -1538,6 +1829,46 @@ TableManager::notifySplitTablet(const Lock& lock, ProtoBuf::Table* info)
     }
 }
 
+/**
+ * Record that one of a table's indexes has changed, so that clients will
+ * fetch the table's entire configuration the next time they refresh it.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table whose index changed.
+ */
+void
+TableManager::recordIndexChange(const Lock& lock, Table* table)
+{
+    table->version = ++lastConfigVersion;
+    table->indexVersion = table->version;
+}
+
+/**
+ * Record that a tablet has been created, modified, or deleted, so that
+ * clients refreshing the table's configuration will fetch it again (see
+ * serializeTableConfigChanges).
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table containing the tablet.
+ * \param startKeyHash
+ *      Start key hash of the tablet that changed.
+ */
+void
+TableManager::recordTabletChange(const Lock& lock, Table* table,
+        uint64_t startKeyHash)
+{
+    table->version = ++lastConfigVersion;
+    table->tabletChanges.emplace_back(table->version, startKeyHash);
+    if (table->tabletChanges.size() > MAX_TABLET_CHANGES) {
+        table->firstChangeVersion = table->tabletChanges.front().version;
+        table->tabletChanges.pop_front();
+    }
+}
+
 /**
  * This method re-creates the internal data structures for a table, based
  * on a protocol buffer read from external storage.
@@ -1565,7 +1896,7 @@ TableManager::recreateTable(const Lock& lock, ProtoBuf::Table* info)
                 name.c_str(), id));
     }
 
-    Table* table = new Table(name.c_str(), id);
+    Table* table = new Table(name.c_str(), id, ++lastConfigVersion);
     int numTablets = info->tablet_size();
     for (int i = 0; i < numTablets; i++) {
         const ProtoBuf::Table::Tablet& tabletInfo = info->tablet(i);
@@ -1585,6 +1916,12 @@ TableManager::recreateTable(const Lock& lock, ProtoBuf::Table* info)
                 status,
                 LogPosition(tabletInfo.ctime_log_head_id(),
                               tabletInfo.ctime_log_head_offset()));
+        if (tabletInfo.has_pull_source_id()) {
+            tablet->pullSource = ServerId(tabletInfo.pull_source_id());
+            tablet->pullSourceCtime = LogPosition(
+                    tabletInfo.pull_source_ctime_log_head_id(),
+                    tabletInfo.pull_source_ctime_log_head_offset());
+        }
         table->tablets.push_back(tablet);
         LOG(NOTICE, "Recovered tablet 0x%lx-0x%lx for table '%s' (id %lu) "
                 "on server %s", tablet->startKeyHash, tablet->endKeyHash,
@@ -1631,6 +1968,44 @@ TableManager::serializeTable(const Lock& lock, Table* table,
         externalTablet->set_ctime_log_head_id(tablet->ctime.getSegmentId());
         externalTablet->set_ctime_log_head_offset(
                 tablet->ctime.getSegmentOffset());
+        if (tablet->pullSource.isValid()) {
+            externalTablet->set_pull_source_id(tablet->pullSource.getId());
+            externalTablet->set_pull_source_ctime_log_head_id(
+                    tablet->pullSourceCtime.getSegmentId());
+            externalTablet->set_pull_source_ctime_log_head_offset(
+                    tablet->pullSourceCtime.getSegmentOffset());
+        }
+    }
+}
+
+/**
+ * Append a description of one tablet, including the service locator of its
+ * master, to a protocol buffer being returned to a client.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table containing the tablet.
+ * \param tablet
+ *      Tablet to describe.
+ * \param tableConfig
+ *      A new entry describing \a tablet is added here.
+ */
+void
+TableManager::serializeTablet(const Lock& lock, Table* table, Tablet* tablet,
+        ProtoBuf::TableConfig* tableConfig)
+{
+    ProtoBuf::TableConfig::Tablet& entry(*tableConfig->add_tablet());
+    tablet->serialize((ProtoBuf::Tablets::Tablet&)entry);
+    try {
+        string locator = context->serverList->getLocator(tablet->serverId);
+        entry.set_service_locator(locator);
+    } catch (const ServerListException& e) {
+        RAMCLOUD_CLOG(NOTICE, "Server id (%s) in tablet map no longer "
+                "in server list; omitting locator for entry (tableName %s, "
+                "tableId %lu, startKeyHash 0x%lx)",
+                tablet->serverId.toString().c_str(), table->name.c_str(),
+                table->id, tablet->startKeyHash);
     }
 }
 
@@ -1694,6 +2069,7 @@ TableManager::testAddTablet(const Tablet& tablet)
         throw FatalError(HERE, "table doesn't exist");
     Table* table = it->second;
     table->tablets.push_back(new Tablet(tablet));
+    recordTabletChange(lock, table, tablet.startKeyHash);
 }
 
 /**
@@ -1711,7 +2087,7 @@ void
 TableManager::testCreateTable(const char* name, uint64_t id)
 {
     Lock lock(mutex);
-    Table* table = new Table(name, id);
+    Table* table = new Table(name, id, ++lastConfigVersion);
     directory[name] = table;
     idMap[id] = table;
     if (nextTableId <= id)
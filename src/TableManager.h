@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_TABLEMANAGER_H
 #define RAMCLOUD_TABLEMANAGER_H
 
+#include <deque>
 #include <mutex>
 
 #include "Common.h"
@@ -35,6 +36,12 @@ namespace RAMCloud {
  *
  * Instances are locked for thread-safety, and methods return tablets
  * by-value to avoid inconsistencies due to concurrency.
+ *
+ * Each table's configuration carries a version number that changes whenever
+ * any of its tablets or indexes change, and the TableManager remembers which
+ * tablets changed in recent versions. This allows clients that already have
+ * an older version of a large table's configuration to fetch just the
+ * tablets that have changed since (see serializeTableConfigChanges).
  */
 class TableManager {
   PUBLIC:
@@ -85,17 +92,28 @@ class TableManager {
             ServerId serverId, uint64_t backingTableId);
     bool isIndexletTable(uint64_t tableId);
     vector<Tablet> markAllTabletsRecovering(ServerId serverId);
+    void pullSourceRecovered(uint64_t tableId, uint64_t startKeyHash,
+            uint64_t endKeyHash, ServerId serverId, LogPosition ctime);
     void reassignTabletOwnership(ServerId newOwner, uint64_t tableId,
             uint64_t startKeyHash, uint64_t endKeyHash,
-            uint64_t ctimeSegmentId, uint64_t ctimeSegmentOffset);
+            uint64_t ctimeSegmentId, uint64_t ctimeSegmentOffset,
+            ServerId pullSource = ServerId());
     void recover(uint64_t lastCompletedUpdate);
     void serializeTableConfig(ProtoBuf::TableConfig* tableConfig,
             uint64_t tableId);
+    bool serializeTableConfigChanges(ProtoBuf::TableConfig* tableConfig,
+            uint64_t tableId, uint64_t* epoch, uint64_t* version);
     void splitTablet(const char* name, uint64_t splitKeyHash);
+    void splitTablet(uint64_t tableId, uint64_t splitKeyHash);
     void splitRecoveringTablet(uint64_t tableId, uint64_t splitKeyHash);
     void tabletRecovered(uint64_t tableId, uint64_t startKeyHash,
             uint64_t endKeyHash, ServerId serverId, LogPosition ctime);
 
+    /// Most tablet changes remembered for each table. Clients whose
+    /// configuration is older than this many changes must fetch the whole
+    /// configuration again.
+    static const size_t MAX_TABLET_CHANGES = 1000;
+
   PRIVATE:
     /**
      * The following structure holds information about a indexlet of an index.
@@ -180,12 +198,34 @@ class TableManager {
     /// indexId for that table.
     typedef std::unordered_map<uint8_t, Index*> IndexMap;
 
+    /**
+     * Records that the tablet starting at a given key hash was created,
+     * modified, or deleted in a particular version of a table's
+     * configuration.
+     */
+    struct TabletChange {
+        TabletChange(uint64_t version, uint64_t startKeyHash)
+            : version(version)
+            , startKeyHash(startKeyHash)
+        {}
+
+        /// The configuration version in which the change was made.
+        uint64_t version;
+
+        /// Start key hash of the tablet that changed.
+        uint64_t startKeyHash;
+    };
+
     struct Table {
-        Table(const char* name, uint64_t id)
+        Table(const char* name, uint64_t id, uint64_t version = 0)
             : name(name)
             , id(id)
             , tablets()
             , indexMap()
+            , version(version)
+            , indexVersion(version)
+            , firstChangeVersion(version)
+            , tabletChanges()
         {}
         ~Table();
 
@@ -202,6 +242,19 @@ class TableManager {
         /// Information about each of the indexes in the table. The
         /// entries are allocated and freed dynamically.
         IndexMap indexMap;
+
+        /// Version of the table's current configuration.
+        uint64_t version;
+
+        /// The version in which the table's indexes last changed.
+        uint64_t indexVersion;
+
+        /// #tabletChanges describes every change made after this version.
+        uint64_t firstChangeVersion;
+
+        /// The most recent changes to #tablets, oldest first; at most
+        /// MAX_TABLET_CHANGES entries.
+        std::deque<TabletChange> tabletChanges;
     };
 
     /**
@@ -241,10 +294,21 @@ class TableManager {
     typedef std::unordered_map<uint64_t, Indexlet*> IndexletTableMap;
     IndexletTableMap backingTableMap;
 
+    /// Distinguishes the configuration versions issued by this TableManager
+    /// from those issued by earlier coordinators: versions aren't persisted,
+    /// so they start over whenever a new coordinator takes over.
+    const uint64_t configEpoch;
+
+    /// The version number most recently assigned to a table configuration.
+    /// Versions are unique across all of the tables.
+    uint64_t lastConfigVersion;
+
     uint64_t createTable(const Lock& lock, const char* name,
             uint32_t serverSpan, ServerId serverId = ServerId());
     void dropIndex(const Lock& lock, uint64_t tableId, uint8_t indexId);
     void dropTable(const Lock& lock, const char* name);
+    void dropPullSource(const Lock& lock, uint64_t tableId,
+            uint64_t startKeyHash, uint64_t endKeyHash, ServerId pullSource);
     TableManager::Indexlet* findIndexlet(const Lock& lock, Index* index,
             const void* key, uint16_t keyLength);
     Tablet* findTablet(const Lock& lock, Table* table, uint64_t keyHash);
@@ -253,11 +317,17 @@ class TableManager {
     void notifyDropTable(const Lock& lock, ProtoBuf::Table* info);
     void notifyDropIndex(const Lock& lock, Index* index);
     void notifySplitTablet(const Lock& lock, ProtoBuf::Table* info);
+    void recordIndexChange(const Lock& lock, Table* table);
+    void recordTabletChange(const Lock& lock, Table* table,
+            uint64_t startKeyHash);
     void notifyReassignIndexlet(const Lock& lock, ProtoBuf::Table* info);
     void notifyReassignTablet(const Lock& lock, ProtoBuf::Table* info);
     Table* recreateTable(const Lock& lock, ProtoBuf::Table* info);
     void serializeTable(const Lock& lock, Table* table,
             ProtoBuf::Table* externalInfo);
+    void serializeTablet(const Lock& lock, Table* table, Tablet* tablet,
+            ProtoBuf::TableConfig* tableConfig);
+    void splitTablet(const Lock& lock, Table* table, uint64_t splitKeyHash);
     void syncNextTableId(const Lock& lock);
     void syncTable(const Lock& lock, Table* table,
             ProtoBuf::Table* externalInfo);
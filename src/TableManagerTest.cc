@@ -433,6 +433,44 @@ TEST_F(TableManagerTest, markAllTabletsRecovering) {
             tableManager->debugString());
 }
 
+TEST_F(TableManagerTest, pullSourceRecovered) {
+    cluster.addServer(masterConfig);
+    Server* master2 = cluster.addServer(masterConfig);
+    master2->master->tabletPuller.halt();
+    tableManager->createTable("table1", 1);
+    tableManager->reassignTabletOwnership(ServerId(2), 1, 0, ~0UL, 99, 100,
+            ServerId(1));
+    TestLog::reset();
+    TestLog::Enable _("pullSourceRecovered", "beginPull", NULL);
+
+    tableManager->pullSourceRecovered(1, 0, ~0UL, ServerId(3),
+            LogPosition(5, 6));
+    EXPECT_EQ("pullSourceRecovered: 2.0 now pulls tablet "
+            "[0x0,0xffffffffffffffff] in tableId 1 from 3.0 | "
+            "beginPull: Pulling tablet [0x0,0xffffffffffffffff] in tableId 1 "
+            "from 3.0 instead of 1.0", TestLog::get());
+    Tablet tablet = tableManager->getTablet(1, 0);
+    EXPECT_EQ(ServerId(2), tablet.serverId);
+    EXPECT_EQ(ServerId(3), tablet.pullSource);
+    EXPECT_EQ(LogPosition(5, 6), tablet.pullSourceCtime);
+    EXPECT_EQ(LogPosition(99, 100), tablet.ctime);
+
+    // The owner finished pulling in the meantime.
+    tableManager->reassignTabletOwnership(ServerId(2), 1, 0, ~0UL, 0, 0);
+    TestLog::reset();
+    tableManager->pullSourceRecovered(1, 0, ~0UL, ServerId(4),
+            LogPosition(7, 8));
+    EXPECT_EQ("pullSourceRecovered: Tablet [0x0,0xffffffffffffffff] in "
+            "tableId 1 was already pulled; copy recovered on 4.0 is unused",
+            TestLog::get());
+    EXPECT_FALSE(tableManager->getTablet(1, 0).pullSource.isValid());
+
+    EXPECT_THROW(tableManager->pullSourceRecovered(1, 0, 5, ServerId(3),
+            LogPosition(5, 6)), TableManager::NoSuchTablet);
+    EXPECT_THROW(tableManager->pullSourceRecovered(9, 0, ~0UL, ServerId(3),
+            LogPosition(5, 6)), TableManager::NoSuchTablet);
+}
+
 TEST_F(TableManagerTest, reassignTabletOwnership_basics) {
     cluster.addServer(masterConfig);
     MasterService* master2 = cluster.addServer(masterConfig)->master.get();
@@ -490,6 +528,53 @@ TEST_F(TableManagerTest, reassignTabletOwnership_exceptions) {
             1, 0x7fffffffffffffff, 99, 100), TableManager::NoSuchTablet);
 }
 
+TEST_F(TableManagerTest, reassignTabletOwnership_pullSource) {
+    cluster.addServer(masterConfig);
+    Server* master2 = cluster.addServer(masterConfig);
+    master2->master->tabletPuller.halt();
+    tableManager->createTable("table1", 1);
+    cluster.externalStorage.log.clear();
+    TestLog::reset();
+    TestLog::Enable _("reassignTabletOwnership", "beginPull",
+            "dropPullSource", NULL);
+
+    // Handing the tablet over records where its objects are.
+    tableManager->reassignTabletOwnership(ServerId(2), 1, 0, ~0UL, 99, 100,
+            ServerId(1));
+    Tablet tablet = tableManager->getTablet(1, 0);
+    EXPECT_EQ(ServerId(2), tablet.serverId);
+    EXPECT_EQ(ServerId(1), tablet.pullSource);
+    EXPECT_EQ(LogPosition(0, 0), tablet.pullSourceCtime);
+    EXPECT_EQ(LogPosition(99, 100), tablet.ctime);
+    EXPECT_NE(string::npos, cluster.externalStorage.getPbValue<
+            ProtoBuf::Table>().find("reassign { server_id: 2 "
+            "start_key_hash: 0 end_key_hash: 18446744073709551615 "
+            "pull_source_id: 1 }"));
+    EXPECT_TRUE(master2->master->tabletPuller.isPulling(1, 0, ~0UL));
+
+    // The source's copy must be recovered if it crashes.
+    vector<Tablet> tablets = tableManager->markAllTabletsRecovering(
+            ServerId(1));
+    ASSERT_EQ(1U, tablets.size());
+    EXPECT_EQ(ServerId(1), tablets[0].serverId);
+    EXPECT_EQ(Tablet::PULL_SOURCE, tablets[0].status);
+    EXPECT_EQ(Tablet::NORMAL, tableManager->getTablet(1, 0).status);
+
+    // The owner reports that it is done; the source drops its copy.
+    TestLog::reset();
+    tableManager->reassignTabletOwnership(ServerId(2), 1, 0, ~0UL, 0, 0);
+    EXPECT_EQ("reassignTabletOwnership: 2.0 finished pulling tablet "
+            "[0x0,0xffffffffffffffff] in tableId 1 from 1.0 | "
+            "dropPullSource: Requesting pull source 1.0 to drop table id 1, "
+            "key hashes 0x0-0xffffffffffffffff", TestLog::get());
+    tablet = tableManager->getTablet(1, 0);
+    EXPECT_FALSE(tablet.pullSource.isValid());
+    EXPECT_EQ(LogPosition(99, 100), tablet.ctime);
+    EXPECT_EQ(0U, cluster.servers[0]->master->tabletManager.getNumTablets());
+    EXPECT_EQ(0U, tableManager->markAllTabletsRecovering(
+            ServerId(1)).size());
+}
+
 TEST_F(TableManagerTest, recover_basics) {
     // Set up recovery information for 2 tables, one with 1 tablet and
     // the other with 2 tablets.
@@ -744,12 +829,124 @@ TEST_F(TableManagerTest, serializeTabletConfig) {
             "server_id: 1 service_locator: \"mock:host=server0\" "
             "ctime_log_head_id: 0 ctime_log_head_offset: 0 }",
             tableConfig.ShortDebugString());
-    EXPECT_EQ("serializeTableConfig: Server id (4.0) in tablet map no longer "
+    EXPECT_EQ("serializeTablet: Server id (4.0) in tablet map no longer "
             "in server list; omitting locator for entry (tableName table2, "
             "tableId 2, startKeyHash 0x0)",
             TestLog::get());
 }
 
+TEST_F(TableManagerTest, serializeTableConfigChanges_fullConfig) {
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 2);
+    ProtoBuf::TableConfig tableConfig;
+
+    // Nonexistent table.
+    uint64_t epoch = 0, version = 0;
+    EXPECT_FALSE(tableManager->serializeTableConfigChanges(&tableConfig, 99,
+            &epoch, &version));
+    EXPECT_EQ(0U, epoch);
+    EXPECT_EQ("", tableConfig.ShortDebugString());
+
+    // Caller has nothing yet.
+    EXPECT_FALSE(tableManager->serializeTableConfigChanges(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ(tableManager->configEpoch, epoch);
+    EXPECT_EQ(tableManager->idMap[1]->version, version);
+    EXPECT_EQ(2, tableConfig.tablet_size());
+
+    // Caller's version came from a different coordinator.
+    tableConfig.Clear();
+    epoch++;
+    EXPECT_FALSE(tableManager->serializeTableConfigChanges(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ(2, tableConfig.tablet_size());
+
+    // Caller's version is newer than ours.
+    tableConfig.Clear();
+    version++;
+    EXPECT_FALSE(tableManager->serializeTableConfigChanges(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ(2, tableConfig.tablet_size());
+
+    // Caller is up to date.
+    tableConfig.Clear();
+    EXPECT_TRUE(tableManager->serializeTableConfigChanges(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ("", tableConfig.ShortDebugString());
+}
+
+TEST_F(TableManagerTest, serializeTableConfigChanges_delta) {
+    cluster.addServer(masterConfig);
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 2);
+    ProtoBuf::TableConfig tableConfig;
+    uint64_t epoch = 0, version = 0;
+    tableManager->serializeTableConfigChanges(&tableConfig, 1, &epoch,
+            &version);
+    uint64_t oldVersion = version;
+
+    tableManager->splitTablet("foo", 0x1000);
+    tableConfig.Clear();
+    EXPECT_TRUE(tableManager->serializeTableConfigChanges(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_LT(oldVersion, version);
+    ASSERT_EQ(2, tableConfig.tablet_size());
+    EXPECT_EQ(0U, tableConfig.tablet(0).start_key_hash());
+    EXPECT_EQ(0xfffU, tableConfig.tablet(0).end_key_hash());
+    EXPECT_EQ(0x1000U, tableConfig.tablet(1).start_key_hash());
+    EXPECT_EQ(0, tableConfig.removed_start_key_hash_size());
+
+    // A change to a tablet that no longer exists is reported as a removal.
+    TableManager::Table* table = tableManager->idMap[1];
+    table->version = ++tableManager->lastConfigVersion;
+    table->tabletChanges.emplace_back(table->version, 0x2000);
+    tableConfig.Clear();
+    EXPECT_TRUE(tableManager->serializeTableConfigChanges(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ("removed_start_key_hash: 8192",
+            tableConfig.ShortDebugString());
+}
+
+TEST_F(TableManagerTest, serializeTableConfigChanges_historyTooShort) {
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 2);
+    ProtoBuf::TableConfig tableConfig;
+    uint64_t epoch = 0, version = 0;
+    tableManager->serializeTableConfigChanges(&tableConfig, 1, &epoch,
+            &version);
+
+    // Changes older than the retained history.
+    tableManager->splitTablet("foo", 0x1000);
+    TableManager::Table* table = tableManager->idMap[1];
+    table->firstChangeVersion = version + 1;
+    tableConfig.Clear();
+    uint64_t knownVersion = version;
+    EXPECT_FALSE(tableManager->serializeTableConfigChanges(&tableConfig, 1,
+            &epoch, &knownVersion));
+    EXPECT_EQ(3, tableConfig.tablet_size());
+
+    // Index changes always force a full configuration.
+    table->firstChangeVersion = 0;
+    tableManager->createIndex(1, 1, 0, 1);
+    tableConfig.Clear();
+    knownVersion = version;
+    EXPECT_FALSE(tableManager->serializeTableConfigChanges(&tableConfig, 1,
+            &epoch, &knownVersion));
+    EXPECT_EQ(1, tableConfig.index_size());
+}
+
+TEST_F(TableManagerTest, recordTabletChange_trimsHistory) {
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 1);
+    TableManager::Table* table = tableManager->idMap[1];
+    TableManager::Lock lock(tableManager->mutex);
+    for (size_t i = 0; i < TableManager::MAX_TABLET_CHANGES + 2; i++)
+        tableManager->recordTabletChange(lock, table, 0);
+    EXPECT_EQ(TableManager::MAX_TABLET_CHANGES, table->tabletChanges.size());
+    EXPECT_EQ(table->tabletChanges.front().version - 1,
+            table->firstChangeVersion);
+}
+
 TEST_F(TableManagerTest, serializeIndexConfig) {
     cluster.addServer(masterConfig);
     cluster.addServer(masterConfig);
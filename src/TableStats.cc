@@ -21,6 +21,83 @@ namespace RAMCloud {
 
 namespace TableStats {
 
+/**
+ * Find the key hashes covered by one bucket of a histogram.
+ *
+ * \param startKeyHash
+ *      First key hash covered by the histogram.
+ * \param endKeyHash
+ *      Last key hash covered by the histogram.
+ * \param bucket
+ *      Index of the bucket.
+ * \param[out] first
+ *      First key hash covered by the bucket.
+ * \param[out] last
+ *      Last key hash covered by the bucket.
+ * \return
+ *      False if the range is so small that the bucket covers no key hashes
+ *      (in which case #first and #last are not modified).
+ */
+bool
+histogramBucketRange(uint64_t startKeyHash, uint64_t endKeyHash,
+                     uint32_t bucket, uint64_t* first, uint64_t* last)
+{
+    uint64_t span = histogramBucketSpan(startKeyHash, endKeyHash);
+    uint64_t offset = bucket * span;
+    if (offset > endKeyHash - startKeyHash)
+        return false;
+    *first = startKeyHash + offset;
+    *last = startKeyHash + std::min(offset + (span - 1),
+                                    endKeyHash - startKeyHash);
+    return true;
+}
+
+/**
+ * Return the number of key hashes that two ranges of key hashes have in
+ * common.
+ */
+static double
+overlap(uint64_t start1, uint64_t end1, uint64_t start2, uint64_t end2)
+{
+    uint64_t start = std::max(start1, start2);
+    uint64_t end = std::min(end1, end2);
+    if (start > end)
+        return 0;
+    return double(end - start) + 1;
+}
+
+/**
+ * Add the counts of one histogram to another that covers an overlapping range
+ * of key hashes.  Counts are assumed to be spread evenly over the key hashes
+ * of each bucket of #from and are divided among the buckets of #to in
+ * proportion to the overlap; counts outside #to's range are dropped.
+ */
+static void
+addHistogram(const TabletHistogram* from, TabletHistogram* to)
+{
+    for (uint32_t b = 0; b < histogramBuckets; b++) {
+        uint64_t first, last;
+        if (!histogramBucketRange(from->startKeyHash, from->endKeyHash, b,
+                                  &first, &last))
+            break;
+        if (from->byteCount[b] == 0 && from->recordCount[b] == 0)
+            continue;
+        double keyHashes = double(last - first) + 1;
+        for (uint32_t c = 0; c < histogramBuckets; c++) {
+            uint64_t toFirst, toLast;
+            if (!histogramBucketRange(to->startKeyHash, to->endKeyHash, c,
+                                      &toFirst, &toLast))
+                break;
+            double fraction = overlap(first, last, toFirst, toLast)
+                    / keyHashes;
+            to->byteCount[c] += uint64_t(double(from->byteCount[b]) * fraction
+                                         + 0.5);
+            to->recordCount[c] += uint64_t(double(from->recordCount[b])
+                                           * fraction + 0.5);
+        }
+    }
+}
+
 /**
  * Update the table status information in the event a tablet is added to keep
  * track of the number of key hash values that this master owns for the given
@@ -56,6 +133,7 @@ addKeyHashRange(MasterTableMetadata* mtm,
     if (entry->stats.keyHashCount == 0) {
         entry->stats.totalOwnership = true;
     }
+    entry->stats.histograms.emplace_back(startKeyHash, endKeyHash);
     TEST_LOG("tableId %lu range [0x%lx,0x%lx]",
             tableId, startKeyHash, endKeyHash);
 }
@@ -95,11 +173,49 @@ deleteKeyHashRange(MasterTableMetadata* mtm,
         entry->stats.keyHashCount -= (endKeyHash - startKeyHash);
         entry->stats.keyHashCount -= 1;
         entry->stats.totalOwnership = false;
+
+        // Drop the histograms for the deleted range. If only part of a
+        // histogram's range was deleted (e.g. one half of a tablet that was
+        // split on this master), keep a histogram for what remains.
+        std::vector<TabletHistogram> histograms;
+        foreach (const TabletHistogram& histogram, entry->stats.histograms) {
+            if (histogram.endKeyHash < startKeyHash ||
+                    histogram.startKeyHash > endKeyHash) {
+                histograms.push_back(histogram);
+                continue;
+            }
+            if (histogram.startKeyHash < startKeyHash) {
+                histograms.emplace_back(histogram.startKeyHash,
+                                        startKeyHash - 1);
+                addHistogram(&histogram, &histograms.back());
+            }
+            if (histogram.endKeyHash > endKeyHash) {
+                histograms.emplace_back(endKeyHash + 1,
+                                        histogram.endKeyHash);
+                addHistogram(&histogram, &histograms.back());
+            }
+        }
+        entry->stats.histograms.swap(histograms);
     }
     TEST_LOG("tableId %lu range [0x%lx,0x%lx]",
             tableId, startKeyHash, endKeyHash);
 }
 
+/**
+ * Return the histogram in a Block that covers a given key hash, or NULL if
+ * there is none.  The caller must hold the Block's lock.
+ */
+static TabletHistogram*
+findHistogram(Block* stats, uint64_t keyHash)
+{
+    foreach (TabletHistogram& histogram, stats->histograms) {
+        if (keyHash >= histogram.startKeyHash &&
+                keyHash <= histogram.endKeyHash)
+            return &histogram;
+    }
+    return NULL;
+}
+
 /**
  * Update table stats information, incrementing the exisitng stats values by the
  * values provided.  If no stats information previously existed for the
@@ -112,6 +228,10 @@ deleteKeyHashRange(MasterTableMetadata* mtm,
  *      stats information.  Must not be NULL.
  * \param tableId
  *      Id of table whose stats information will be updated.
+ * \param keyHash
+ *      Key hash of the new records; determines which histogram bucket
+ *      is updated (none if the key hash isn't in a range added with
+ *      addKeyHashRange).
  * \param byteCount
  *      Number of bytes of new data (related to tableId) added to the log.
  * \param recordCount
@@ -120,6 +240,7 @@ deleteKeyHashRange(MasterTableMetadata* mtm,
 void
 increment(MasterTableMetadata* mtm,
           uint64_t tableId,
+          uint64_t keyHash,
           uint64_t byteCount,
           uint64_t recordCount)
 {
@@ -129,6 +250,13 @@ increment(MasterTableMetadata* mtm,
     SpinLock::Guard _(entry->stats.lock);
     entry->stats.byteCount += byteCount;
     entry->stats.recordCount += recordCount;
+    TabletHistogram* histogram = findHistogram(&entry->stats, keyHash);
+    if (histogram != NULL) {
+        uint32_t bucket = histogramBucket(histogram->startKeyHash,
+                                          histogram->endKeyHash, keyHash);
+        histogram->byteCount[bucket] += byteCount;
+        histogram->recordCount[bucket] += recordCount;
+    }
 }
 
 /**
@@ -143,6 +271,10 @@ increment(MasterTableMetadata* mtm,
  *      stats information.  Must not be NULL.
  * \param tableId
  *      Id of table whose stats information will be updated.
+ * \param keyHash
+ *      Key hash of the cleaned records; determines which histogram bucket
+ *      is updated (none if the key hash isn't in a range added with
+ *      addKeyHashRange).
  * \param byteCount
  *      Number of bytes of data (related to tableId) cleaned from the log.
  * \param recordCount
@@ -151,6 +283,7 @@ increment(MasterTableMetadata* mtm,
 void
 decrement(MasterTableMetadata* mtm,
           uint64_t tableId,
+          uint64_t keyHash,
           uint64_t byteCount,
           uint64_t recordCount)
 {
@@ -161,9 +294,48 @@ decrement(MasterTableMetadata* mtm,
         SpinLock::Guard _(entry->stats.lock);
         entry->stats.byteCount -= byteCount;
         entry->stats.recordCount -= recordCount;
+        TabletHistogram* histogram = findHistogram(&entry->stats, keyHash);
+        if (histogram != NULL) {
+            // The histogram is only a hint (and loses precision when part of
+            // it is deleted), so don't let a mismatched decrement wrap a
+            // bucket around.
+            uint32_t bucket = histogramBucket(histogram->startKeyHash,
+                                              histogram->endKeyHash, keyHash);
+            uint64_t* bytes = &histogram->byteCount[bucket];
+            uint64_t* records = &histogram->recordCount[bucket];
+            *bytes -= std::min(*bytes, byteCount);
+            *records -= std::min(*records, recordCount);
+        }
     }
 }
 
+/**
+ * Convert a tablet's key hash histogram into the form stored in a
+ * DigestHistogramEntry: each bucket's fraction of the total, in units of
+ * 1/255.
+ *
+ * \param counts
+ *      Histogram of bytes or records (histogramBuckets entries).
+ * \param[out] shares
+ *      The fractions are stored here (histogramBuckets entries). All zeros
+ *      if the histogram is empty.
+ * \return
+ *      The total of the counts.
+ */
+static double
+computeShares(const uint64_t* counts, uint8_t* shares)
+{
+    double total = 0;
+    for (uint32_t i = 0; i < histogramBuckets; i++)
+        total += double(counts[i]);
+    for (uint32_t i = 0; i < histogramBuckets; i++) {
+        shares[i] = (total == 0) ? 0
+                : downCast<uint8_t>(uint32_t(255 * double(counts[i]) / total
+                                             + 0.5));
+    }
+    return total;
+}
+
 
 /**
  * Compress and serialize all table stats information in the MasterTableMetadata
@@ -193,6 +365,10 @@ serialize(Buffer *buf, MasterTableMetadata *mtm)
     DigestHeader* header = buf->emplaceAppend<DigestHeader>();
     *header = {0, 0, 0};
 
+    // The histogram section must follow all of the entries, so collect it
+    // separately.
+    std::vector<DigestHistogramEntry> histogramEntries;
+
     double otherKeyHashCount = 0;
     uint64_t otherByteCount = 0;
     uint64_t otherRecordCount = 0;
@@ -223,8 +399,25 @@ serialize(Buffer *buf, MasterTableMetadata *mtm)
                                          keyHashCount;
                 double recordsPerKeyHash = double(entry->stats.recordCount) /
                                            keyHashCount;
-                *(buf->emplaceAppend<DigestEntry>()) =
-                        {entry->tableId, bytesPerKeyHash, recordsPerKeyHash};
+                DigestEntry* digestEntry = buf->emplaceAppend<DigestEntry>();
+                digestEntry->tableId = entry->tableId;
+                digestEntry->bytesPerKeyHash = bytesPerKeyHash;
+                digestEntry->recordsPerKeyHash = recordsPerKeyHash;
+
+                foreach (const TabletHistogram& histogram,
+                         entry->stats.histograms) {
+                    histogramEntries.emplace_back();
+                    DigestHistogramEntry* h = &histogramEntries.back();
+                    h->tableId = entry->tableId;
+                    h->startKeyHash = histogram.startKeyHash;
+                    h->endKeyHash = histogram.endKeyHash;
+                    double keyHashes = double(histogram.endKeyHash -
+                                              histogram.startKeyHash) + 1;
+                    h->bytesPerKeyHash = computeShares(histogram.byteCount,
+                            h->byteShares) / keyHashes;
+                    h->recordsPerKeyHash = computeShares(histogram.recordCount,
+                            h->recordShares) / keyHashes;
+                }
 
             } else {
                 otherKeyHashCount += keyHashCount;
@@ -241,6 +434,14 @@ serialize(Buffer *buf, MasterTableMetadata *mtm)
             header->otherRecordsPerKeyHash = double(otherRecordCount) /
                                              otherKeyHashCount;
     }
+
+    DigestHistogramHeader* histogramHeader =
+            buf->emplaceAppend<DigestHistogramHeader>();
+    *histogramHeader = {digestHistogramVersion,
+                        sizeof32(DigestHistogramEntry),
+                        histogramEntries.size()};
+    foreach (const DigestHistogramEntry& h, histogramEntries)
+        buf->appendCopy(&h);
 }
 
 /**
@@ -251,11 +452,17 @@ serialize(Buffer *buf, MasterTableMetadata *mtm)
  *      of each of its segments.  This digest is the summarized table stats
  *      information extracted from the head segment of the failed master that is
  *      now to be recovered.
+ * \param digestLength
+ *      Size of the digest in bytes. If the digest carries key hash histograms
+ *      they are used to produce more accurate estimates for the tablets of
+ *      the tables large enough to have them; if it doesn't (or if this is 0),
+ *      data is assumed to be spread evenly over each table's key hashes.
  */
-Estimator::Estimator(const Digest* digest)
+Estimator::Estimator(const Digest* digest, uint32_t digestLength)
     : valid(false)
     , tableStats()
     , otherStats()
+    , tableHistograms()
 {
     // If for some reason, the digest the estimator needs is not available, we
     // should log an error as this should never be the case during normal
@@ -279,6 +486,80 @@ Estimator::Estimator(const Digest* digest)
                   digest->header.otherRecordsPerKeyHash};
 
     valid = true;
+
+    // Digests written before the histograms were introduced end right after
+    // the entries.
+    const char* base = reinterpret_cast<const char*>(digest);
+    uint64_t offset = sizeof(DigestHeader)
+            + digest->header.entryCount * sizeof(DigestEntry);
+    if (digestLength < offset + sizeof(DigestHistogramHeader))
+        return;
+    const DigestHistogramHeader* histogramHeader =
+            reinterpret_cast<const DigestHistogramHeader*>(base + offset);
+    if (histogramHeader->version != digestHistogramVersion ||
+            histogramHeader->entryLength < sizeof(DigestHistogramEntry)) {
+        LOG(NOTICE, "Ignoring table stats histograms in unknown format "
+            "(version %u, entry length %u)", histogramHeader->version,
+            histogramHeader->entryLength);
+        return;
+    }
+    offset += sizeof(DigestHistogramHeader);
+
+    // Turn the histograms' shares back into densities.
+    for (uint64_t i = 0; i < histogramHeader->entryCount; i++) {
+        if (offset + histogramHeader->entryLength > digestLength) {
+            LOG(WARNING, "Table stats histograms truncated after %lu of %lu "
+                "entries", i, histogramHeader->entryCount);
+            break;
+        }
+        const DigestHistogramEntry* entry =
+                reinterpret_cast<const DigestHistogramEntry*>(base + offset);
+        offset += histogramHeader->entryLength;
+        if (entry->startKeyHash > entry->endKeyHash)
+            continue;
+
+        double byteShares = 0;
+        double recordShares = 0;
+        for (uint32_t b = 0; b < histogramBuckets; b++) {
+            byteShares += entry->byteShares[b];
+            recordShares += entry->recordShares[b];
+        }
+        double keyHashes = double(entry->endKeyHash - entry->startKeyHash) + 1;
+        double totalBytes = entry->bytesPerKeyHash * keyHashes;
+        double totalRecords = entry->recordsPerKeyHash * keyHashes;
+
+        Histogram histogram;
+        histogram.startKeyHash = entry->startKeyHash;
+        histogram.endKeyHash = entry->endKeyHash;
+        for (uint32_t b = 0; b < histogramBuckets; b++) {
+            histogram.bytesPerKeyHash[b] = 0;
+            histogram.recordsPerKeyHash[b] = 0;
+            uint64_t first, last;
+            if (!histogramBucketRange(entry->startKeyHash, entry->endKeyHash,
+                                      b, &first, &last))
+                continue;
+            double bucketKeyHashes = double(last - first) + 1;
+            if (byteShares > 0) {
+                histogram.bytesPerKeyHash[b] = totalBytes
+                        * (entry->byteShares[b] / byteShares)
+                        / bucketKeyHashes;
+            }
+            if (recordShares > 0) {
+                histogram.recordsPerKeyHash[b] = totalRecords
+                        * (entry->recordShares[b] / recordShares)
+                        / bucketKeyHashes;
+            }
+        }
+        tableHistograms[entry->tableId].push_back(histogram);
+    }
+
+    for (HistogramMap::iterator it = tableHistograms.begin();
+            it != tableHistograms.end(); it++) {
+        std::sort(it->second.begin(), it->second.end(),
+                  [](const Histogram& a, const Histogram& b) {
+                      return a.startKeyHash < b.startKeyHash;
+                  });
+    }
 }
 
 /**
@@ -290,34 +571,161 @@ Estimator::Estimator(const Digest* digest)
  *      Pointer to tablet for which an estimate will be provided.
  * \return
  *      Returns an Entry containing the estimated stats information for the
- *      provided tablet.  If information specific to the tablet's table is
+ *      provided tablet.  If histograms covering the tablet are available, they
+ *      are used.  Otherwise, if information specific to the tablet's table is
  *      available, the table information is used.  If no specific table
  *      information is found, the cumulative stats information is used.
  */
 Estimator::Estimate
 Estimator::estimate(Tablet *tablet)
 {
-    Estimate est = {0, 0};
-    double keyRange = double(tablet->endKeyHash - tablet->startKeyHash) + 1;
+    vector<Density> densities;
+    getDensities(tablet, &densities);
 
-    StatsMap::iterator entry = tableStats.find(tablet->tableId);
-    if (entry != tableStats.end()) {
-        // The table was large enough that statistics were kept specifically
-        // for this table.
-        est.byteCount = uint64_t(entry->second.bytesPerKeyHash * keyRange);
-        est.recordCount = uint64_t(entry->second.recordsPerKeyHash * keyRange);
-    } else {
-        // This table was so small that statistics were not kept separately for
-        // it; instead, its statistics were lumped together with all of the
-        // other small tables. Use that aggregate information to estimate the
-        // info for this table.
-        est.byteCount = uint64_t(otherStats.bytesPerKeyHash * keyRange);
-        est.recordCount = uint64_t(otherStats.recordsPerKeyHash * keyRange);
+    double byteCount = 0;
+    double recordCount = 0;
+    foreach (const Density& density, densities) {
+        double keyHashes = double(density.endKeyHash - density.startKeyHash)
+                + 1;
+        byteCount += density.bytesPerKeyHash * keyHashes;
+        recordCount += density.recordsPerKeyHash * keyHashes;
     }
-
+    Estimate est = {uint64_t(byteCount), uint64_t(recordCount)};
     return est;
 }
 
+/**
+ * Returns true if estimates for the given table take into account how its
+ * data is spread over its key hashes (as opposed to assuming it is spread
+ * evenly).
+ *
+ * \param tableId
+ *      Identifies the table.
+ */
+bool
+Estimator::hasHistogram(uint64_t tableId)
+{
+    return tableHistograms.find(tableId) != tableHistograms.end();
+}
+
+/**
+ * Find where to split a tablet so that the first piece holds (approximately)
+ * a given amount of data. Within a histogram bucket, data is assumed to be
+ * spread evenly over the key hashes.
+ *
+ * \param tablet
+ *      The tablet to split; must contain at least two key hashes.
+ * \param byteCount
+ *      The first piece should hold no more than this many bytes...
+ * \param recordCount
+ *      ... and no more than this many log records.
+ * \return
+ *      The first key hash of the second piece. Both pieces are guaranteed to
+ *      be nonempty, even if that means exceeding the limits.
+ */
+uint64_t
+Estimator::findSplit(Tablet* tablet, uint64_t byteCount, uint64_t recordCount)
+{
+    assert(tablet->startKeyHash < tablet->endKeyHash);
+    vector<Density> densities;
+    getDensities(tablet, &densities);
+
+    double bytes = 0;
+    double records = 0;
+    uint64_t split = tablet->endKeyHash;
+    foreach (const Density& density, densities) {
+        double keyHashes = double(density.endKeyHash - density.startKeyHash)
+                + 1;
+        double pieceBytes = density.bytesPerKeyHash * keyHashes;
+        double pieceRecords = density.recordsPerKeyHash * keyHashes;
+        if (bytes + pieceBytes > double(byteCount) ||
+                records + pieceRecords > double(recordCount)) {
+            // The limit is reached within this range.
+            double fraction = 1.0;
+            if (pieceBytes > 0) {
+                fraction = std::min(fraction,
+                        (double(byteCount) - bytes) / pieceBytes);
+            }
+            if (pieceRecords > 0) {
+                fraction = std::min(fraction,
+                        (double(recordCount) - records) / pieceRecords);
+            }
+            split = std::min(density.endKeyHash, density.startKeyHash
+                    + uint64_t(std::max(fraction, 0.0) * keyHashes));
+            break;
+        }
+        bytes += pieceBytes;
+        records += pieceRecords;
+    }
+    return std::min(std::max(split, tablet->startKeyHash + 1),
+                    tablet->endKeyHash);
+}
+
+/**
+ * Break a tablet's key hashes into ranges over which the estimated density
+ * of data is constant: one for each histogram bucket that overlaps the
+ * tablet, plus ranges using the table's average density for the parts of the
+ * tablet that no histogram covers.
+ *
+ * \param tablet
+ *      The tablet whose data is to be estimated.
+ * \param[out] densities
+ *      The ranges are appended here in key hash order; together they cover
+ *      the tablet exactly.
+ */
+void
+Estimator::getDensities(Tablet* tablet, vector<Density>* densities)
+{
+    Entry average = otherStats;
+    StatsMap::iterator entry = tableStats.find(tablet->tableId);
+    if (entry != tableStats.end())
+        average = entry->second;
+
+    // First key hash not yet covered; only meaningful while !covered (it
+    // would overflow once the last key hash is covered).
+    uint64_t next = tablet->startKeyHash;
+    bool covered = false;
+    HistogramMap::iterator it = tableHistograms.find(tablet->tableId);
+    if (it != tableHistograms.end()) {
+        foreach (const Histogram& histogram, it->second) {
+            if (histogram.endKeyHash < next)
+                continue;
+            if (histogram.startKeyHash > tablet->endKeyHash)
+                break;
+            if (histogram.startKeyHash > next) {
+                densities->push_back({next, histogram.startKeyHash - 1,
+                                      average.bytesPerKeyHash,
+                                      average.recordsPerKeyHash});
+                next = histogram.startKeyHash;
+            }
+            for (uint32_t b = 0; b < histogramBuckets && !covered; b++) {
+                uint64_t first, last;
+                if (!histogramBucketRange(histogram.startKeyHash,
+                                          histogram.endKeyHash, b,
+                                          &first, &last))
+                    break;
+                if (last < next)
+                    continue;
+                uint64_t end = std::min(last, tablet->endKeyHash);
+                densities->push_back({next, end,
+                                      histogram.bytesPerKeyHash[b],
+                                      histogram.recordsPerKeyHash[b]});
+                if (end == tablet->endKeyHash)
+                    covered = true;
+                else
+                    next = end + 1;
+            }
+            if (covered)
+                break;
+        }
+    }
+    if (!covered) {
+        densities->push_back({next, tablet->endKeyHash,
+                              average.bytesPerKeyHash,
+                              average.recordsPerKeyHash});
+    }
+}
+
 } // namespace TableStats
 
 } // namespace RAMCloud
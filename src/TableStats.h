@@ -17,6 +17,7 @@
 #define RAMCLOUD_TABLESTATS_H
 
 #include <unordered_map>
+#include <vector>
 
 #include "Common.h"
 #include "SpinLock.h"
@@ -47,6 +48,62 @@ class MasterTableMetadata;
  * is kept.
  */
 namespace TableStats {
+/**
+ * Number of buckets in the per-tablet histograms that break a tablet's byte
+ * and record counts down by key hash (see TabletHistogram). The tablet's key
+ * hash range is divided evenly among the buckets; these histograms let the
+ * coordinator split a crashed master's tablets into pieces holding equal
+ * amounts of data, even when the data isn't spread evenly over the key hashes.
+ */
+const uint32_t histogramBuckets = 32;
+
+/**
+ * Return the number of key hashes covered by each bucket of a histogram over
+ * a given range of key hashes (the last bucket may cover fewer).
+ */
+inline uint64_t
+histogramBucketSpan(uint64_t startKeyHash, uint64_t endKeyHash)
+{
+    return (endKeyHash - startKeyHash) / histogramBuckets + 1;
+}
+
+/**
+ * Return the index of the bucket that covers a given key hash in a histogram
+ * over a given range of key hashes.  The key hash must be within the range.
+ */
+inline uint32_t
+histogramBucket(uint64_t startKeyHash, uint64_t endKeyHash, uint64_t keyHash)
+{
+    return downCast<uint32_t>((keyHash - startKeyHash) /
+                              histogramBucketSpan(startKeyHash, endKeyHash));
+}
+
+bool histogramBucketRange(uint64_t startKeyHash, uint64_t endKeyHash,
+                          uint32_t bucket, uint64_t* first, uint64_t* last);
+
+/**
+ * Key hash histogram of the bytes and log records belonging to one tablet
+ * (or to a key hash range that was added by a single call to addKeyHashRange;
+ * if the tablet is later split on this master, the histogram keeps covering
+ * both halves).
+ */
+struct TabletHistogram {
+    uint64_t startKeyHash;  /// First key hash covered by the histogram.
+    uint64_t endKeyHash;    /// Last key hash covered by the histogram.
+    uint64_t byteCount[histogramBuckets];
+                            /// Number of bytes of data in each bucket (see
+                            /// histogramBucket).
+    uint64_t recordCount[histogramBuckets];
+                            /// Number of log records in each bucket.
+
+    TabletHistogram(uint64_t startKeyHash, uint64_t endKeyHash)
+        : startKeyHash(startKeyHash)
+        , endKeyHash(endKeyHash)
+        , byteCount()
+        , recordCount()
+    {}
+};
+
 /**
  * This structure represents a block of stats information for an individual
  * table on a given master.  One of these blocks is stored in each entry
@@ -62,6 +119,10 @@ struct Block {
     bool totalOwnership;    /// True if this master completely owns this table.
     uint64_t byteCount;     /// Number of bytes of data related to a table.
     uint64_t recordCount;   /// Number of log records related to a table.
+    std::vector<TabletHistogram> histograms;
+                            /// byteCount and recordCount broken down by
+                            /// tablet and key hash; one histogram for each
+                            /// key hash range this master owns.
 
     Block()
         : lock("TableStats::lock")
@@ -69,6 +130,7 @@ struct Block {
         , totalOwnership(false)
         , byteCount(0)
         , recordCount(0)
+        , histograms()
     {}
 };
 
@@ -82,10 +144,12 @@ void deleteKeyHashRange(MasterTableMetadata* mtm,
                         uint64_t endKeyHash);
 void increment(MasterTableMetadata* mtm,
                uint64_t tableId,
+               uint64_t keyHash,
                uint64_t byteCount,
                uint64_t recordCount);
 void decrement(MasterTableMetadata* mtm,
                uint64_t tableId,
+               uint64_t keyHash,
                uint64_t byteCount,
                uint64_t recordCount);
 void serialize(Buffer* buf, MasterTableMetadata *mtm);
@@ -115,6 +179,12 @@ void serialize(Buffer* buf, MasterTableMetadata *mtm);
  * should be noted that if the MasterCapasity grows we will either need to
  * increase the threshold or increase the number of entries we are willing to
  * store in order to compensate.
+ *
+ * The key hash histograms (see DigestHistogramEntry) add 104B for each tablet
+ * of a table above the threshold.  A master whose tables are all just above
+ * the threshold and unsplit would therefore have a stats block about 5x the
+ * size computed above (still under 5% of a segment); in practice large tables
+ * are few and much larger than the threshold.
  */
 const uint64_t threshold = 24*1024*1024;  // 24 MB.
 
@@ -148,6 +218,10 @@ struct DigestHeader {
 
 /**
  * Represents the compressed and serialized form of table stats information.
+ * The entries may be followed by a key hash histogram section (see
+ * DigestHistogramHeader); digests written before histograms were introduced
+ * end after the entries, and readers that don't know about the section simply
+ * ignore the trailing bytes.
  */
 struct Digest {
     /// See DigestHeader struct.
@@ -157,6 +231,48 @@ struct Digest {
     DigestEntry entries[0];
 } __attribute__((__packed__));
 
+/// Current version of the histogram section of a Digest.
+const uint32_t digestHistogramVersion = 1;
+
+/**
+ * Header of the optional section following the entries of a Digest that
+ * holds key hash histograms for the tablets of the tables that have a
+ * DigestEntry.
+ */
+struct DigestHistogramHeader {
+    /// Format of the section; readers skip sections with versions they
+    /// don't understand.
+    uint32_t version;
+    /// Size in bytes of each entry in the section.  Later versions may
+    /// append fields to DigestHistogramEntry; readers step over them.
+    uint32_t entryLength;
+    /// Number of entries following this header.
+    uint64_t entryCount;
+} __attribute__((__packed__));
+
+/**
+ * Key hash histogram for one tablet in the histogram section of a Digest.
+ */
+struct DigestHistogramEntry {
+    /// Id of the table containing the tablet.
+    uint64_t tableId;
+    /// First key hash covered by the histogram.
+    uint64_t startKeyHash;
+    /// Last key hash covered by the histogram.
+    uint64_t endKeyHash;
+    /// Avg num bytes per key hash over the whole range.
+    double bytesPerKeyHash;
+    /// Avg num log records per key hash over the whole range.
+    double recordsPerKeyHash;
+    /// Fraction of the range's bytes in each histogram bucket, in units of
+    /// 1/255. The fractions are rounded, so they needn't add up to exactly
+    /// 255.
+    uint8_t byteShares[histogramBuckets];
+    /// Fraction of the range's log records in each histogram bucket, in the
+    /// same form as byteShares.
+    uint8_t recordShares[histogramBuckets];
+} __attribute__((__packed__));
+
 /**
  * Provides estimated tablet size and record count information.  Estimates are
  * only used to inform the tablet partitioning algorithm on the coordinator
@@ -172,8 +288,11 @@ class Estimator {
         uint64_t recordCount;
     };
 
-    explicit Estimator(const Digest* digest);
+    explicit Estimator(const Digest* digest, uint32_t digestLength = 0);
     Estimate estimate(Tablet *tablet);
+    bool hasHistogram(uint64_t tableId);
+    uint64_t findSplit(Tablet* tablet, uint64_t byteCount,
+                       uint64_t recordCount);
 
     /// Flag indicating whether the estimator contains valid estimates
     bool valid;
@@ -199,6 +318,42 @@ class Estimator {
 
     /// Contains cumulative Entry information for tables below threshold.
     Entry otherStats;
+
+    /**
+     * Represents the statistics information for a range of key hashes in a
+     * single table (normally one tablet) broken down by histogram bucket.
+     */
+    struct Histogram {
+        /// First key hash covered by the histogram.
+        uint64_t startKeyHash;
+        /// Last key hash covered by the histogram.
+        uint64_t endKeyHash;
+        /// Avg num bytes per key hash in each bucket.
+        double bytesPerKeyHash[histogramBuckets];
+        /// Avg num log records per key hash in each bucket.
+        double recordsPerKeyHash[histogramBuckets];
+    };
+
+    /**
+     * A range of key hashes over which the estimated density of data is
+     * constant; see getDensities.
+     */
+    struct Density {
+        uint64_t startKeyHash;      /// First key hash in the range.
+        uint64_t endKeyHash;        /// Last key hash in the range.
+        double bytesPerKeyHash;     /// Avg num bytes per key hash
+        double recordsPerKeyHash;   /// Avg num log records per key hash
+    };
+
+    void getDensities(Tablet* tablet, vector<Density>* densities);
+
+    /// Type defining map between tableId and the table's histograms, sorted
+    /// by key hash.
+    typedef std::unordered_map<uint64_t, vector<Histogram>> HistogramMap;
+
+    /// Contains Histogram information for those tables in #tableStats whose
+    /// tablets' histograms were found in the digest.
+    HistogramMap tableHistograms;
 };
 
 } // namespace TableStats
@@ -32,17 +32,17 @@ class TableStatsTest : public ::testing::Test {
 
     void fillMtm() {
         TableStats::addKeyHashRange(&mtm, 1, 0, 9);
-        TableStats::increment(&mtm, 1, 11, 111);
+        TableStats::increment(&mtm, 1, 0, 11, 111);
         TableStats::addKeyHashRange(&mtm, 2, 0, 9);
-        TableStats::increment(&mtm, 2, 22, 222);
+        TableStats::increment(&mtm, 2, 0, 22, 222);
         TableStats::addKeyHashRange(&mtm, 63, 0, 9);
-        TableStats::increment(&mtm, 63, TableStats::threshold - 1, 63000);
+        TableStats::increment(&mtm, 63, 0, TableStats::threshold - 1, 63000);
         TableStats::addKeyHashRange(&mtm, 64, 0, 9);
-        TableStats::increment(&mtm, 64, TableStats::threshold, 64000);
+        TableStats::increment(&mtm, 64, 0, TableStats::threshold, 64000);
         TableStats::addKeyHashRange(&mtm, 65, 0, 9);
-        TableStats::increment(&mtm, 65, TableStats::threshold + 1, 65000);
+        TableStats::increment(&mtm, 65, 0, TableStats::threshold + 1, 65000);
         TableStats::addKeyHashRange(&mtm, 66, 0, 9);
-        TableStats::increment(&mtm, 66, TableStats::threshold + 2, 66000);
+        TableStats::increment(&mtm, 66, 0, TableStats::threshold + 2, 66000);
     }
 
     const TableStats::DigestEntry*
@@ -132,7 +132,7 @@ TEST_F(TableStatsTest, deleteKeyHashRange) {
 TEST_F(TableStatsTest, increment) {
     MasterTableMetadata::Entry* entry;
     EXPECT_TRUE(mtm.find(0) == NULL);
-    TableStats::increment(&mtm, 0, 2, 3);
+    TableStats::increment(&mtm, 0, 0, 2, 3);
     EXPECT_NE(mtm.tableMetadataMap.end(), mtm.tableMetadataMap.find(0));
     entry = mtm.find(0);
     EXPECT_FALSE(entry == NULL);
@@ -142,7 +142,7 @@ TEST_F(TableStatsTest, increment) {
         EXPECT_EQ(3u, entry->stats.recordCount);
     }
 
-    TableStats::increment(&mtm, 0, 4, 5);
+    TableStats::increment(&mtm, 0, 0, 4, 5);
     {
         SpinLock::Guard _(entry->stats.lock);
         EXPECT_EQ(6u, entry->stats.byteCount);
@@ -153,11 +153,11 @@ TEST_F(TableStatsTest, increment) {
 TEST_F(TableStatsTest, decrement) {
     MasterTableMetadata::Entry* entry;
     EXPECT_TRUE(mtm.find(1) == NULL);
-    TableStats::decrement(&mtm, 1, 2, 3);
+    TableStats::decrement(&mtm, 1, 0, 2, 3);
     entry = mtm.find(1);
     EXPECT_TRUE(entry == NULL);
 
-    TableStats::increment(&mtm, 1, 10, 10);
+    TableStats::increment(&mtm, 1, 0, 10, 10);
     entry = mtm.find(1);
     EXPECT_FALSE(entry == NULL);
     {
@@ -166,7 +166,7 @@ TEST_F(TableStatsTest, decrement) {
         EXPECT_EQ(10u, entry->stats.recordCount);
     }
 
-    TableStats::decrement(&mtm, 1, 2, 3);
+    TableStats::decrement(&mtm, 1, 0, 2, 3);
     EXPECT_FALSE(entry == NULL);
     {
         SpinLock::Guard _(entry->stats.lock);
@@ -175,6 +175,98 @@ TEST_F(TableStatsTest, decrement) {
     }
 }
 
+TEST_F(TableStatsTest, deleteKeyHashRange_histogram) {
+    TableStats::addKeyHashRange(&mtm, 0, 0, 319);
+    TableStats::increment(&mtm, 0, 5, 10, 1);
+    TableStats::increment(&mtm, 0, 155, 20, 2);
+    TableStats::increment(&mtm, 0, 315, 30, 3);
+    MasterTableMetadata::Entry* entry = mtm.find(0);
+    ASSERT_FALSE(entry == NULL);
+
+    // Deleting part of the range re-buckets what remains.
+    TableStats::deleteKeyHashRange(&mtm, 0, 160, 319);
+    {
+        SpinLock::Guard _(entry->stats.lock);
+        ASSERT_EQ(1u, entry->stats.histograms.size());
+        TableStats::TabletHistogram* histogram = &entry->stats.histograms[0];
+        EXPECT_EQ(0u, histogram->startKeyHash);
+        EXPECT_EQ(159u, histogram->endKeyHash);
+        EXPECT_EQ(5u, histogram->byteCount[0]);
+        EXPECT_EQ(5u, histogram->byteCount[1]);
+        EXPECT_EQ(0u, histogram->byteCount[2]);
+        EXPECT_EQ(10u, histogram->byteCount[30]);
+        EXPECT_EQ(10u, histogram->byteCount[31]);
+    }
+
+    TableStats::deleteKeyHashRange(&mtm, 0, 0, 159);
+    {
+        SpinLock::Guard _(entry->stats.lock);
+        EXPECT_EQ(0u, entry->stats.histograms.size());
+    }
+
+    // Deleting the middle of a range leaves two histograms.
+    TableStats::addKeyHashRange(&mtm, 0, 0, 63);
+    TableStats::deleteKeyHashRange(&mtm, 0, 16, 31);
+    {
+        SpinLock::Guard _(entry->stats.lock);
+        ASSERT_EQ(2u, entry->stats.histograms.size());
+        EXPECT_EQ(0u, entry->stats.histograms[0].startKeyHash);
+        EXPECT_EQ(15u, entry->stats.histograms[0].endKeyHash);
+        EXPECT_EQ(32u, entry->stats.histograms[1].startKeyHash);
+        EXPECT_EQ(63u, entry->stats.histograms[1].endKeyHash);
+    }
+}
+
+TEST_F(TableStatsTest, increment_histogram) {
+    TableStats::addKeyHashRange(&mtm, 0, 0, 319);
+    TableStats::addKeyHashRange(&mtm, 0, 1000, ~0UL);
+    TableStats::increment(&mtm, 0, 0, 2, 3);
+    TableStats::increment(&mtm, 0, 35, 4, 5);
+    TableStats::increment(&mtm, 0, ~0UL, 6, 7);
+    // Not covered by any histogram.
+    TableStats::increment(&mtm, 0, 500, 8, 9);
+    MasterTableMetadata::Entry* entry = mtm.find(0);
+    ASSERT_FALSE(entry == NULL);
+    SpinLock::Guard _(entry->stats.lock);
+    EXPECT_EQ(20u, entry->stats.byteCount);
+    ASSERT_EQ(2u, entry->stats.histograms.size());
+    TableStats::TabletHistogram* first = &entry->stats.histograms[0];
+    TableStats::TabletHistogram* second = &entry->stats.histograms[1];
+    EXPECT_EQ(2u, first->byteCount[0]);
+    EXPECT_EQ(3u, first->recordCount[0]);
+    EXPECT_EQ(4u, first->byteCount[3]);
+    EXPECT_EQ(5u, first->recordCount[3]);
+    EXPECT_EQ(0u, first->byteCount[1]);
+    EXPECT_EQ(6u, second->byteCount[31]);
+    EXPECT_EQ(7u, second->recordCount[31]);
+    EXPECT_EQ(0u, second->byteCount[0]);
+}
+
+TEST_F(TableStatsTest, decrement_histogram) {
+    TableStats::addKeyHashRange(&mtm, 1, 0, ~0UL);
+    uint64_t keyHash = 2 * TableStats::histogramBucketSpan(0, ~0UL);
+    TableStats::increment(&mtm, 1, keyHash, 10, 10);
+    TableStats::increment(&mtm, 1, 0, 10, 10);
+    TableStats::decrement(&mtm, 1, keyHash, 2, 3);
+    MasterTableMetadata::Entry* entry = mtm.find(1);
+    ASSERT_FALSE(entry == NULL);
+    TableStats::TabletHistogram* histogram = &entry->stats.histograms[0];
+    {
+        SpinLock::Guard _(entry->stats.lock);
+        EXPECT_EQ(8u, histogram->byteCount[2]);
+        EXPECT_EQ(7u, histogram->recordCount[2]);
+    }
+
+    // Decrementing a bucket by more than it holds leaves it at zero.
+    TableStats::decrement(&mtm, 1, keyHash, 9, 9);
+    {
+        SpinLock::Guard _(entry->stats.lock);
+        EXPECT_EQ(0u, histogram->byteCount[2]);
+        EXPECT_EQ(0u, histogram->recordCount[2]);
+        EXPECT_EQ(10u, histogram->byteCount[0]);
+    }
+}
+
 TEST_F(TableStatsTest, serialize_basic) {
     // First Check an empty mtm.
     {
@@ -239,7 +331,7 @@ TEST_F(TableStatsTest, serialize_basic) {
 
 TEST_F(TableStatsTest, serialize_fullTable) {
     TableStats::addKeyHashRange(&mtm, 1, 0, ~0UL);
-    TableStats::increment(&mtm, 1, 100, 200);
+    TableStats::increment(&mtm, 1, 0, 100, 200);
 
     Buffer buffer;
     TableStats::serialize(&buffer, &mtm);
@@ -257,7 +349,7 @@ TEST_F(TableStatsTest, serialize_fullTable) {
 
 TEST_F(TableStatsTest, serialize_skipTable) {
     TableStats::addKeyHashRange(&mtm, 1, 0, 100);
-    TableStats::increment(&mtm, 1, TableStats::threshold + 2, 200);
+    TableStats::increment(&mtm, 1, 0, TableStats::threshold + 2, 200);
     TableStats::deleteKeyHashRange(&mtm, 1, 0, 100);
 
     Buffer buffer;
@@ -272,6 +364,58 @@ TEST_F(TableStatsTest, serialize_skipTable) {
     EXPECT_EQ(double(0), digest->header.otherRecordsPerKeyHash);
 }
 
+TEST_F(TableStatsTest, serialize_histogram) {
+    // Entries keep the layout they had before histograms were added.
+    EXPECT_EQ(24u, sizeof(TableStats::DigestEntry));
+
+    TableStats::addKeyHashRange(&mtm, 70, 0, 0x7fffffffffffffff);
+    TableStats::addKeyHashRange(&mtm, 70, 0x8000000000000000, ~0UL);
+    TableStats::increment(&mtm, 70, 0, 3 * TableStats::threshold, 300);
+    TableStats::increment(&mtm, 70, ~0UL, TableStats::threshold, 100);
+    // Too small to have an entry, so no histogram either.
+    TableStats::addKeyHashRange(&mtm, 71, 0, ~0UL);
+    TableStats::increment(&mtm, 71, 0, 100, 1);
+
+    Buffer buffer;
+    TableStats::serialize(&buffer, &mtm);
+    const TableStats::Digest* digest =
+            reinterpret_cast<const TableStats::Digest*>(
+                    buffer.getRange(0, buffer.size()));
+    ASSERT_EQ(1u, digest->header.entryCount);
+    uint32_t offset = sizeof32(TableStats::DigestHeader) +
+            sizeof32(TableStats::DigestEntry);
+    ASSERT_EQ(offset + sizeof(TableStats::DigestHistogramHeader) +
+              2 * sizeof(TableStats::DigestHistogramEntry), buffer.size());
+
+    const TableStats::DigestHistogramHeader* header =
+            buffer.getOffset<TableStats::DigestHistogramHeader>(offset);
+    EXPECT_EQ(TableStats::digestHistogramVersion, header->version);
+    EXPECT_EQ(sizeof(TableStats::DigestHistogramEntry), header->entryLength);
+    EXPECT_EQ(2u, header->entryCount);
+
+    offset += sizeof32(TableStats::DigestHistogramHeader);
+    const TableStats::DigestHistogramEntry* entry =
+            buffer.getOffset<TableStats::DigestHistogramEntry>(offset);
+    EXPECT_EQ(70u, entry->tableId);
+    EXPECT_EQ(0u, entry->startKeyHash);
+    EXPECT_EQ(0x7fffffffffffffffu, entry->endKeyHash);
+    EXPECT_EQ(3 * double(TableStats::threshold) / 0x1p63,
+              entry->bytesPerKeyHash);
+    EXPECT_EQ(255u, entry->byteShares[0]);
+    EXPECT_EQ(255u, entry->recordShares[0]);
+    for (uint32_t b = 1; b < TableStats::histogramBuckets; b++)
+        EXPECT_EQ(0u, entry->byteShares[b]);
+
+    offset += sizeof32(TableStats::DigestHistogramEntry);
+    entry = buffer.getOffset<TableStats::DigestHistogramEntry>(offset);
+    EXPECT_EQ(0x8000000000000000u, entry->startKeyHash);
+    EXPECT_EQ(~0UL, entry->endKeyHash);
+    EXPECT_EQ(100 / 0x1p63, entry->recordsPerKeyHash);
+    EXPECT_EQ(255u, entry->byteShares[31]);
+    EXPECT_EQ(255u, entry->recordShares[31]);
+    EXPECT_EQ(0u, entry->byteShares[0]);
+}
+
 TEST_F(TableStatsTest, estimator_constructor) {
     fillMtm();
     const TableStats::Digest* digest = getDigest();
@@ -354,4 +498,110 @@ TEST_F(TableStatsTest, estimator_estimate_basic) {
     entry = NULL;
 }
 
+TEST_F(TableStatsTest, estimator_histogram) {
+    TableStats::addKeyHashRange(&mtm, 70, 0, ~0UL);
+    TableStats::increment(&mtm, 70, 0, 3 * TableStats::threshold, 300);
+    TableStats::increment(&mtm, 70, ~0UL, TableStats::threshold, 100);
+    Buffer buffer;
+    TableStats::serialize(&buffer, &mtm);
+    uint32_t length = buffer.size();
+    const TableStats::Digest* digest =
+            reinterpret_cast<const TableStats::Digest*>(
+                    buffer.getRange(0, length));
+
+    // Without the length, the data is assumed to be spread evenly.
+    TableStats::Estimator uniform(digest);
+    EXPECT_FALSE(uniform.hasHistogram(70));
+
+    TableStats::Estimator e(digest, length);
+    EXPECT_TRUE(e.hasHistogram(70));
+
+    uint64_t span = TableStats::histogramBucketSpan(0, ~0UL);
+    double total = 4.0 * TableStats::threshold;
+    Tablet first = {70, 0, span - 1, ServerId(), Tablet::NORMAL,
+                    LogPosition()};
+    EXPECT_NEAR(total * 191 / 255, double(e.estimate(&first).byteCount),
+                total / 1000);
+    EXPECT_NEAR(400.0 * 191 / 255, double(e.estimate(&first).recordCount),
+                1);
+    Tablet middle = {70, span, 31 * span - 1, ServerId(), Tablet::NORMAL,
+                     LogPosition()};
+    EXPECT_EQ(0u, e.estimate(&middle).byteCount);
+
+    // Half of the data lies within the first two thirds of bucket 0.
+    Tablet all = {70, 0, ~0UL, ServerId(), Tablet::NORMAL, LogPosition()};
+    uint64_t split = e.findSplit(&all, TableStats::threshold * 2, 1000);
+    EXPECT_NEAR(double(span) * 2 * 255 / 191 / 4, double(split),
+                double(span) / 100);
+    split = uniform.findSplit(&all, TableStats::threshold * 2, 1000);
+    EXPECT_NEAR(double(~0UL) / 2, double(split), double(span) / 100);
+
+    // Both pieces must be nonempty.
+    EXPECT_EQ(1u, e.findSplit(&all, 0, 0));
+    EXPECT_EQ(~0UL, e.findSplit(&all, ~0UL, ~0UL));
+}
+
+TEST_F(TableStatsTest, estimator_histogramPartialCoverage) {
+    TableStats::addKeyHashRange(&mtm, 80, 0, 99);
+    TableStats::increment(&mtm, 80, 0, 2 * TableStats::threshold, 200);
+    Buffer buffer;
+    TableStats::serialize(&buffer, &mtm);
+    const TableStats::Digest* digest =
+            reinterpret_cast<const TableStats::Digest*>(
+                    buffer.getRange(0, buffer.size()));
+    TableStats::Estimator e(digest, buffer.size());
+    ASSERT_TRUE(e.hasHistogram(80));
+
+    // All of the data is in the first bucket (key hashes 0-3).
+    Tablet covered = {80, 0, 3, ServerId(), Tablet::NORMAL, LogPosition()};
+    EXPECT_NEAR(2.0 * TableStats::threshold,
+                double(e.estimate(&covered).byteCount), 1);
+
+    // Key hashes the histogram doesn't cover get the table's average.
+    Tablet partial = {80, 50, 149, ServerId(), Tablet::NORMAL, LogPosition()};
+    EXPECT_NEAR(double(TableStats::threshold),
+                double(e.estimate(&partial).byteCount), 1);
+    EXPECT_NEAR(100.0, double(e.estimate(&partial).recordCount), 1);
+}
+
+TEST_F(TableStatsTest, estimator_histogramFormat) {
+    TableStats::addKeyHashRange(&mtm, 70, 0, ~0UL);
+    TableStats::increment(&mtm, 70, 0, 3 * TableStats::threshold, 300);
+    Buffer buffer;
+    TableStats::serialize(&buffer, &mtm);
+    uint32_t length = buffer.size();
+    vector<char> digestCopy(length);
+    buffer.copy(0, length, digestCopy.data());
+    const TableStats::Digest* digest =
+            reinterpret_cast<const TableStats::Digest*>(digestCopy.data());
+    uint32_t entriesLength = sizeof32(TableStats::DigestHeader) +
+            sizeof32(TableStats::DigestEntry);
+
+    // A digest in the layout used before histograms were added.
+    TableStats::Estimator old(digest, entriesLength);
+    EXPECT_TRUE(old.valid);
+    EXPECT_FALSE(old.hasHistogram(70));
+    EXPECT_EQ(digest->entries[0].bytesPerKeyHash,
+              old.tableStats[70].bytesPerKeyHash);
+
+    // A truncated histogram section.
+    TestLog::Enable _("Estimator", NULL);
+    TableStats::Estimator truncated(digest, length - 1);
+    EXPECT_FALSE(truncated.hasHistogram(70));
+    EXPECT_EQ("Estimator: Table stats histograms truncated after 0 of 1 "
+              "entries", TestLog::get());
+
+    // A histogram section in a format this version doesn't understand.
+    TableStats::DigestHistogramHeader* header =
+            reinterpret_cast<TableStats::DigestHistogramHeader*>(
+                    digestCopy.data() + entriesLength);
+    header->version = TableStats::digestHistogramVersion + 1;
+    TestLog::reset();
+    TableStats::Estimator unknown(digest, length);
+    EXPECT_TRUE(unknown.valid);
+    EXPECT_FALSE(unknown.hasHistogram(70));
+    EXPECT_EQ("Estimator: Ignoring table stats histograms in unknown format "
+              "(version 2, entry length 104)", TestLog::get());
+}
+
 } // namespace RAMCloud
@@ -38,10 +38,14 @@ Tablet::serialize(ProtoBuf::Tablets::Tablet& entry) const
         entry.set_state(ProtoBuf::Tablets::Tablet::NORMAL);
     else if (status == RECOVERING)
         entry.set_state(ProtoBuf::Tablets::Tablet::RECOVERING);
+    else if (status == PULL_SOURCE)
+        entry.set_state(ProtoBuf::Tablets::Tablet::PULL_SOURCE);
     else
         DIE("Unknown status stored in tablet map");
     entry.set_ctime_log_head_id(ctime.getSegmentId());
     entry.set_ctime_log_head_offset(ctime.getSegmentOffset());
+    if (pullSource.isValid())
+        entry.set_pull_source_id(pullSource.getId());
 }
 
 /**
@@ -66,8 +70,10 @@ Tablet::debugString(int usecase) const
             break;
         default:
             const char* status_str = "NORMAL";
-            if (status != Tablet::NORMAL)
+            if (status == Tablet::RECOVERING)
                 status_str = "RECOVERING";
+            else if (status == Tablet::PULL_SOURCE)
+                status_str = "PULL_SOURCE";
             result = format("Tablet { tableId: %lu, startKeyHash: 0x%lx, "
                             "endKeyHash: 0x%lx, serverId: %s, status: %s, "
                             "ctime: %ld.%d }",
@@ -47,6 +47,10 @@ struct Tablet {
         NORMAL = 0 ,
         /// The tablet is being recovered, it is not available.
         RECOVERING = 1,
+        /// Never stored in the tablet map: marks the copy of a tablet that
+        /// a crashed master was still serving to the tablet's puller (see
+        /// #pullSource), so that recovery restores it as a pull source.
+        PULL_SOURCE = 2,
     };
 
     /// The status of the tablet, see Status.
@@ -59,6 +63,21 @@ struct Tablet {
      */
     LogPosition ctime;
 
+    /**
+     * If valid, #serverId took this tablet over with a pull-based migration
+     * and is still pulling its objects from this master, which keeps its
+     * copy of the tablet until the pull is done. Recovering either master
+     * in the meantime needs this lineage: the new owner's log alone does
+     * not hold the whole tablet.
+     */
+    ServerId pullSource;
+
+    /**
+     * The tablet's ctime in #pullSource's log, from before the handover.
+     * Only meaningful if #pullSource is valid.
+     */
+    LogPosition pullSourceCtime;
+
     Tablet(uint64_t tableId, uint64_t startKeyHash, uint64_t endKeyHash,
             ServerId serverId, Status status, LogPosition ctime)
         : tableId(tableId)
@@ -67,6 +86,8 @@ struct Tablet {
         , serverId(serverId)
         , status(status)
         , ctime(ctime)
+        , pullSource()
+        , pullSourceCtime()
     {}
 
     Tablet(const Tablet& tablet)
@@ -76,6 +97,8 @@ struct Tablet {
         , serverId(tablet.serverId)
         , status(tablet.status)
         , ctime(tablet.ctime)
+        , pullSource(tablet.pullSource)
+        , pullSourceCtime(tablet.pullSourceCtime)
     {}
 
     void serialize(ProtoBuf::Tablets::Tablet& entry) const;
@@ -0,0 +1,427 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ClientException.h"
+#include "CoordinatorServerList.h"
+#include "MasterClient.h"
+#include "ShortMacros.h"
+#include "TabletBalancer.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a TabletBalancer. The balancer does nothing until start() is
+ * invoked.
+ *
+ * \param context
+ *      Overall information about the coordinator.
+ * \param tableManager
+ *      The coordinator's table manager; used to split tablets.
+ * \param runtimeOptions
+ *      Supplies the balancer's configuration, which is reread every round.
+ */
+TabletBalancer::TabletBalancer(Context* context, TableManager* tableManager,
+        RuntimeOptions* runtimeOptions)
+    : context(context)
+    , tableManager(tableManager)
+    , runtimeOptions(runtimeOptions)
+    , previousCounts()
+    , mutex()
+    , halting(false)
+    , haltRequested()
+    , thread()
+{
+}
+
+TabletBalancer::~TabletBalancer()
+{
+    halt();
+}
+
+/**
+ * Start the balancer's thread. Calling start() on a balancer that is
+ * already running has no effect. start() and halt() are not thread-safe.
+ */
+void
+TabletBalancer::start()
+{
+    if (thread)
+        return;
+    halting = false;
+    thread.construct(&TabletBalancer::main, this);
+}
+
+/**
+ * Stop the balancer's thread, waiting for any round in progress to finish.
+ * Calling halt() on a balancer that isn't running has no effect.
+ */
+void
+TabletBalancer::halt()
+{
+    Lock lock(mutex);
+    halting = true;
+    haltRequested.notify_one();
+    lock.unlock();
+
+    if (thread) {
+        thread->join();
+        thread.destroy();
+    }
+}
+
+/**
+ * Top-level method of the balancer's thread: runs rounds until halt() is
+ * invoked.
+ */
+void
+TabletBalancer::main()
+try {
+    Lock lock(mutex);
+    while (!halting) {
+        lock.unlock();
+        uint64_t intervalMs = runRound();
+        lock.lock();
+        haltRequested.wait_for(lock, std::chrono::milliseconds(intervalMs),
+                [this] { return halting; });
+    }
+    TEST_LOG("Balancer exited");
+} catch (const std::exception& e) {
+    LOG(ERROR, "Fatal error in TabletBalancer: %s", e.what());
+    throw;
+} catch (...) {
+    LOG(ERROR, "Unknown fatal error in TabletBalancer.");
+    throw;
+}
+
+/**
+ * Runs one balancing round, if balancing is enabled.
+ *
+ * \return
+ *      The number of milliseconds to wait before the next round.
+ */
+uint64_t
+TabletBalancer::runRound()
+{
+    RuntimeOptions::BalancerOptions options =
+            runtimeOptions->getBalancerOptions();
+    uint64_t intervalMs = options.intervalMs;
+    if (intervalMs == 0) {
+        // Disabled; forget old counts so that when balancing is turned back
+        // on it doesn't act on load from long ago. Check back in a second
+        // to see whether it has been enabled.
+        previousCounts.clear();
+        intervalMs = 1000;
+    } else {
+        try {
+            balance();
+        } catch (const Exception& e) {
+            LOG(WARNING, "Tablet balancing round failed: %s", e.what());
+        }
+    }
+    return intervalMs;
+}
+
+/**
+ * Perform one round of balancing: gather load information from all masters
+ * and, if the busiest master is overloaded relative to the others, split
+ * and/or migrate tablets from it to the least loaded master. The first
+ * round after construction (or after balancing was disabled) only records
+ * a baseline. This method is invoked automatically by runRound;
+ * it is public so that tests can drive rounds directly.
+ *
+ * \return
+ *      The number of tablets split or migrated.
+ */
+uint32_t
+TabletBalancer::balance()
+{
+    RuntimeOptions::BalancerOptions options =
+            runtimeOptions->getBalancerOptions();
+    bool haveBaseline = !previousCounts.empty();
+
+    std::map<uint64_t, uint64_t> masterLoad;
+    vector<TabletLoad> tablets;
+    collectLoad(&masterLoad, &tablets);
+    if (!haveBaseline || masterLoad.size() < 2)
+        return 0;
+
+    uint64_t totalLoad = 0;
+    foreach (const auto& entry, masterLoad)
+        totalLoad += entry.second;
+
+    uint32_t actions = 0;
+    while (actions < options.maxActionsPerRound) {
+        auto hottest = masterLoad.begin();
+        auto coldest = masterLoad.begin();
+        for (auto it = masterLoad.begin(); it != masterLoad.end(); it++) {
+            if (it->second > hottest->second)
+                hottest = it;
+            if (it->second < coldest->second)
+                coldest = it;
+        }
+        if (hottest->second < options.minLoad)
+            break;
+        if (hottest->second * 100 * masterLoad.size() <=
+                totalLoad * options.imbalancePercent)
+            break;
+
+        TabletLoad* candidate = NULL;
+        foreach (TabletLoad& tablet, tablets) {
+            if (tablet.owner.getId() != hottest->first || !tablet.movable ||
+                    tablet.load == 0)
+                continue;
+            if (candidate == NULL || tablet.load > candidate->load)
+                candidate = &tablet;
+        }
+        if (candidate == NULL)
+            break;
+
+        // Whatever happens, don't consider this tablet again this round:
+        // its load information is stale once it has been split or moved.
+        candidate->movable = false;
+        uint64_t moved;
+        if (!moveLoad(candidate, ServerId(coldest->first),
+                hottest->second - coldest->second, &moved))
+            continue;
+        actions++;
+        hottest->second -= moved;
+        coldest->second += moved;
+    }
+    return actions;
+}
+
+// - private -
+
+/**
+ * Ask every master for its tablet statistics and compute the load each
+ * tablet and master received since the previous call. The requests are
+ * issued to all masters in parallel, so a round takes about as long as
+ * the slowest master rather than the sum of them.
+ *
+ * \param[out] masterLoad
+ *      Filled in with the number of requests each master (indexed by
+ *      ServerId::getId()) served since the previous round. Every master
+ *      that responded has an entry, even if idle.
+ * \param[out] tablets
+ *      Filled in with the load on each tablet.
+ */
+void
+TabletBalancer::collectLoad(std::map<uint64_t, uint64_t>* masterLoad,
+        vector<TabletLoad>* tablets)
+{
+    const uint32_t numSlices = TabletManager::Tablet::NUM_LOAD_SLICES;
+    std::map<TabletKey, TabletCounts> currentCounts;
+
+    vector<ServerId> masters;
+    ServerId id;
+    while (true) {
+        bool end;
+        id = context->coordinatorServerList->nextServer(id,
+                ServiceMask({WireFormat::MASTER_SERVICE}), &end);
+        if (end)
+            break;
+        masters.push_back(id);
+    }
+
+    Tub<GetTabletStatisticsRpc> rpcs[masters.size()];
+    for (size_t i = 0; i < masters.size(); i++)
+        rpcs[i].construct(context, masters[i]);
+
+    for (size_t i = 0; i < masters.size(); i++) {
+        id = masters[i];
+        ProtoBuf::ServerStatistics stats;
+        try {
+            rpcs[i]->wait(&stats);
+        } catch (const ServerNotUpException& e) {
+            continue;
+        }
+
+        uint64_t* load = &(*masterLoad)[id.getId()];
+        for (int i = 0; i < stats.tabletentry_size(); i++) {
+            const ProtoBuf::ServerStatistics_TabletEntry& entry =
+                    stats.tabletentry(i);
+            TabletKey key(entry.table_id(), entry.start_key_hash(),
+                    entry.end_key_hash());
+            TabletCounts& counts = currentCounts[key];
+            counts.total = entry.number_read_and_writes();
+            for (uint32_t j = 0; j < numSlices &&
+                    static_cast<int>(j) < entry.key_hash_load_size(); j++)
+                counts.slices[j] = entry.key_hash_load(static_cast<int>(j));
+
+            TabletLoad tablet;
+            tablet.tableId = entry.table_id();
+            tablet.startKeyHash = entry.start_key_hash();
+            tablet.endKeyHash = entry.end_key_hash();
+            tablet.owner = id;
+            tablet.movable = !tableManager->isIndexletTable(tablet.tableId);
+
+            // Counts are reset when a tablet is split or moved; in that case
+            // the tablet appears under a new key (or its counts go
+            // backwards) and everything it reports is new.
+            std::map<TabletKey, TabletCounts>::iterator previous =
+                    previousCounts.find(key);
+            bool havePrevious = previous != previousCounts.end() &&
+                    previous->second.total <= counts.total;
+            tablet.load = counts.total;
+            for (uint32_t j = 0; j < numSlices; j++)
+                tablet.sliceLoad[j] = counts.slices[j];
+            if (havePrevious) {
+                tablet.load -= previous->second.total;
+                for (uint32_t j = 0; j < numSlices; j++)
+                    tablet.sliceLoad[j] -= previous->second.slices[j];
+            }
+
+            *load += tablet.load;
+            tablets->push_back(tablet);
+        }
+    }
+
+    previousCounts.swap(currentCounts);
+}
+
+/**
+ * Move load from an overloaded master to another master by migrating a
+ * tablet, or part of it, to the other master.
+ *
+ * \param tablet
+ *      Hot tablet on the overloaded master.
+ * \param newOwner
+ *      Master that will receive the load.
+ * \param gap
+ *      Difference in load between the overloaded master and \a newOwner.
+ *      The best outcome is to move half of this; moving all of it or more
+ *      would merely swap the two masters' roles.
+ * \param[out] moved
+ *      Set to the amount of load moved to \a newOwner (0 if the tablet was
+ *      only split).
+ * \return
+ *      True if a tablet was split or migrated, false if nothing was done.
+ */
+bool
+TabletBalancer::moveLoad(TabletLoad* tablet, ServerId newOwner, uint64_t gap,
+        uint64_t* moved)
+{
+    const uint32_t numSlices = TabletManager::Tablet::NUM_LOAD_SLICES;
+    *moved = 0;
+
+    // The load information may be stale: make sure the coordinator agrees
+    // about the tablet before acting on it.
+    try {
+        Tablet current = tableManager->getTablet(tablet->tableId,
+                tablet->startKeyHash);
+        if (current.serverId != tablet->owner ||
+                current.startKeyHash != tablet->startKeyHash ||
+                current.endKeyHash != tablet->endKeyHash ||
+                current.status != Tablet::NORMAL)
+            return false;
+    } catch (const TableManager::NoSuchTable& e) {
+        return false;
+    } catch (const TableManager::NoSuchTablet& e) {
+        return false;
+    }
+
+    uint64_t firstKeyHash = tablet->startKeyHash;
+    uint64_t lastKeyHash = tablet->endKeyHash;
+    uint64_t loadToMove = tablet->load;
+    uint64_t splitKeyHash = 0;
+    if (tablet->load >= gap) {
+        // Moving the whole tablet would just move the hot spot. Find the
+        // slice boundary that splits off a piece (from either end of the
+        // tablet) whose load is closest to half the gap.
+        if (tablet->startKeyHash == tablet->endKeyHash) {
+            // A single hot key hash; nothing useful can be done here.
+            return false;
+        }
+        uint64_t range = tablet->endKeyHash - tablet->startKeyHash;
+        uint64_t sliceWidth = range / numSlices + 1;
+        uint64_t target = gap / 2;
+        uint64_t bestDistance = ~0UL;
+        uint64_t lowerLoad = 0;
+        for (uint32_t i = 1; i < numSlices && sliceWidth * i <= range; i++) {
+            lowerLoad += tablet->sliceLoad[i - 1];
+            uint64_t upperLoad = tablet->load - lowerLoad;
+            uint64_t boundary = tablet->startKeyHash + sliceWidth * i;
+            if (lowerLoad > 0 && upperLoad > 0) {
+                uint64_t distance = lowerLoad > target ?
+                        lowerLoad - target : target - lowerLoad;
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    splitKeyHash = boundary;
+                    firstKeyHash = tablet->startKeyHash;
+                    lastKeyHash = boundary - 1;
+                    loadToMove = lowerLoad;
+                }
+                distance = upperLoad > target ?
+                        upperLoad - target : target - upperLoad;
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    splitKeyHash = boundary;
+                    firstKeyHash = boundary;
+                    lastKeyHash = tablet->endKeyHash;
+                    loadToMove = upperLoad;
+                }
+            }
+        }
+
+        if (splitKeyHash == 0) {
+            // All of the load falls in a single slice, so no split at a
+            // slice boundary helps. Split off that slice so that the next
+            // round sees the load at a finer granularity.
+            uint32_t hot = 0;
+            for (uint32_t i = 1; i < numSlices; i++) {
+                if (tablet->sliceLoad[i] > tablet->sliceLoad[hot])
+                    hot = i;
+            }
+            splitKeyHash = tablet->startKeyHash +
+                    sliceWidth * (hot == 0 ? 1 : hot);
+            loadToMove = 0;
+        }
+
+        LOG(NOTICE, "Splitting hot tablet [0x%lx,0x%lx] in tableId %lu "
+                "at 0x%lx", tablet->startKeyHash, tablet->endKeyHash,
+                tablet->tableId, splitKeyHash);
+        try {
+            tableManager->splitTablet(tablet->tableId, splitKeyHash);
+        } catch (const ClientException& e) {
+            LOG(WARNING, "Couldn't split tablet [0x%lx,0x%lx] in tableId %lu: "
+                    "%s", tablet->startKeyHash, tablet->endKeyHash,
+                    tablet->tableId, e.what());
+            return false;
+        } catch (const TableManager::NoSuchTable& e) {
+            return false;
+        }
+        if (loadToMove == 0)
+            return true;
+    }
+
+    LOG(NOTICE, "Migrating tablet [0x%lx,0x%lx] in tableId %lu from "
+            "server %s to server %s to balance load", firstKeyHash,
+            lastKeyHash, tablet->tableId, tablet->owner.toString().c_str(),
+            newOwner.toString().c_str());
+    try {
+        MasterClient::requestMigration(context, tablet->owner,
+                tablet->tableId, firstKeyHash, lastKeyHash, newOwner, true);
+    } catch (const ClientException& e) {
+        LOG(WARNING, "Migration of tablet [0x%lx,0x%lx] in tableId %lu "
+                "failed: %s", firstKeyHash, lastKeyHash, tablet->tableId,
+                e.what());
+        // If the tablet was split, that still counts as progress.
+        return splitKeyHash != 0;
+    }
+    *moved = loadToMove;
+    return true;
+}
+
+} // namespace RAMCloud
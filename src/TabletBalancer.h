@@ -0,0 +1,158 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_TABLETBALANCER_H
+#define RAMCLOUD_TABLETBALANCER_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+#include "RuntimeOptions.h"
+#include "ServerId.h"
+#include "TableManager.h"
+#include "TabletManager.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+/**
+ * Runs on the coordinator and spreads request load across masters by
+ * splitting hot tablets and migrating them off of overloaded masters.
+ *
+ * Each round, the balancer collects per-tablet access counts from every
+ * master (see TabletManager::getStatistics) and computes how many requests
+ * each master served since the previous round. If the busiest master is
+ * sufficiently more loaded than the average, the balancer moves load from
+ * it to the least loaded master: either an entire tablet, or, if the
+ * hottest tablet carries more load than should be moved, the part of it
+ * that carries about the right amount, as judged by the tablet's per-key-hash
+ * access counts. Splits go through TableManager::splitTablet and moves
+ * through MIGRATE_TABLET in pull mode, so that the load shifts to the new
+ * owner as soon as the move starts, rather than once the tablet's data has
+ * been copied (see TabletPuller).
+ *
+ * The balancer runs in a thread of its own, since a round waits for RPCs
+ * to every master and for migrations to finish; doing that in a WorkerTimer
+ * would hold up other timers on the coordinator, such as the one renewing
+ * its lease on external storage. It is controlled by the "balancer*"
+ * runtime options (see RuntimeOptions::BalancerOptions) and is idle unless
+ * balancerIntervalMs is set.
+ */
+class TabletBalancer {
+  PUBLIC:
+    TabletBalancer(Context* context, TableManager* tableManager,
+            RuntimeOptions* runtimeOptions);
+    ~TabletBalancer();
+    void start();
+    void halt();
+    uint32_t balance();
+
+  PRIVATE:
+    /**
+     * Describes the load on one tablet during the most recent round.
+     */
+    struct TabletLoad {
+        TabletLoad()
+            : tableId(0)
+            , startKeyHash(0)
+            , endKeyHash(0)
+            , owner()
+            , movable(false)
+            , load(0)
+            , sliceLoad()
+        {}
+
+        /// Identifies the tablet.
+        uint64_t tableId;
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+
+        /// Master that reported the tablet.
+        ServerId owner;
+
+        /// False means the balancer must not move this tablet (for
+        /// example, because it backs an indexlet).
+        bool movable;
+
+        /// Reads plus writes since the previous round.
+        uint64_t load;
+
+        /// #load broken down by key hash; see
+        /// TabletManager::Tablet::keyHashLoad.
+        uint64_t sliceLoad[TabletManager::Tablet::NUM_LOAD_SLICES];
+    };
+
+    /**
+     * Cumulative access counts reported for a tablet, used to compute the
+     * load in the next round.
+     */
+    struct TabletCounts {
+        TabletCounts()
+            : total(0)
+            , slices()
+        {}
+
+        uint64_t total;
+        uint64_t slices[TabletManager::Tablet::NUM_LOAD_SLICES];
+    };
+
+    /// Identifies a tablet: table id, first key hash, last key hash.
+    typedef std::tuple<uint64_t, uint64_t, uint64_t> TabletKey;
+
+    typedef std::unique_lock<std::mutex> Lock;
+
+    void main();
+    uint64_t runRound();
+    void collectLoad(std::map<uint64_t, uint64_t>* masterLoad,
+            vector<TabletLoad>* tablets);
+    bool moveLoad(TabletLoad* tablet, ServerId newOwner, uint64_t target,
+            uint64_t* moved);
+
+    /// Shared information about the coordinator.
+    Context* context;
+
+    /// Coordinator's authoritative tablet map; used to split tablets and to
+    /// double-check ownership before acting.
+    TableManager* tableManager;
+
+    /// Source of the balancer's configuration.
+    RuntimeOptions* runtimeOptions;
+
+    /// Cumulative counts from the previous round, so that each round only
+    /// considers the requests served since the round before it. Empty
+    /// means the next round only establishes a baseline.
+    std::map<TabletKey, TabletCounts> previousCounts;
+
+    /// Protects #halting.
+    std::mutex mutex;
+
+    /// Set by halt() to tell #thread to exit.
+    bool halting;
+
+    /// Notified by halt() so that #thread doesn't sleep out its interval.
+    std::condition_variable haltRequested;
+
+    /// Runs main(); empty unless the balancer has been started.
+    Tub<std::thread> thread;
+
+    DISALLOW_COPY_AND_ASSIGN(TabletBalancer);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_TABLETBALANCER_H
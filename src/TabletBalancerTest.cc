@@ -0,0 +1,320 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+#include "TabletBalancer.h"
+
+namespace RAMCloud {
+
+class TabletBalancerTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    CoordinatorService* service;
+    ServerId master1;
+    ServerId master2;
+    RuntimeOptions* options;
+    TabletBalancer balancer;
+    uint64_t tableId;
+
+    TabletBalancerTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , service(cluster.coordinator.get())
+        , master1()
+        , master2()
+        , options(service->getRuntimeOptionsFromCoordinator())
+        , balancer(service->context, &service->tableManager, options)
+        , tableId()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::PING_SERVICE,
+                           WireFormat::MEMBERSHIP_SERVICE};
+        config.master.numReplicas = 0;
+        config.localLocator = "mock:host=master1";
+        master1 = cluster.addServer(config)->serverId;
+        config.localLocator = "mock:host=master2";
+        master2 = cluster.addServer(config)->serverId;
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = service->tableManager.createTable("table", 1, master1);
+
+        options->set("balancerMinLoad", "1");
+        options->set("balancerImbalancePercent", "120");
+        options->set("balancerMaxActionsPerRound", "1");
+    }
+
+    /**
+     * Return the keys of \a count objects whose key hashes lie in
+     * [firstKeyHash, firstKeyHash + 2^60), i.e. in a narrow slice of the
+     * key hash space, and write them to the table.
+     */
+    vector<string>
+    makeHotSpot(uint64_t firstKeyHash, uint32_t count)
+    {
+        vector<string> keys;
+        for (uint32_t i = 0; keys.size() < count; i++) {
+            string key = format("%lx-%u", firstKeyHash, i);
+            uint64_t keyHash = Key(tableId, key.c_str(),
+                    downCast<uint16_t>(key.length())).getHash();
+            if (keyHash - firstKeyHash < (1UL << 60)) {
+                ramcloud->write(tableId, key.c_str(),
+                        downCast<uint16_t>(key.length()), "value");
+                keys.push_back(key);
+            }
+        }
+        return keys;
+    }
+
+    /**
+     * Read each key in \a keys several times, then return the percentage of
+     * those reads that went to the busier of the two masters.
+     */
+    uint64_t
+    readHotSpot(const vector<string>& keys)
+    {
+        uint64_t reads[2] = {0, 0};
+        for (int rep = 0; rep < 5; rep++) {
+            foreach (const string& key, keys) {
+                Buffer value;
+                ramcloud->read(tableId, key.c_str(),
+                        downCast<uint16_t>(key.length()), &value);
+                uint64_t keyHash = Key(tableId, key.c_str(),
+                        downCast<uint16_t>(key.length())).getHash();
+                Tablet tablet = service->tableManager.getTablet(tableId,
+                        keyHash);
+                reads[tablet.serverId == master1 ? 0 : 1]++;
+            }
+        }
+        return 100 * std::max(reads[0], reads[1]) / (reads[0] + reads[1]);
+    }
+
+    /**
+     * Return a description of the table's only tablet, as collectLoad
+     * would report it, with all of \a load in the given slices.
+     */
+    TabletBalancer::TabletLoad
+    tabletLoad(uint32_t firstSlice, uint32_t lastSlice, uint64_t load)
+    {
+        TabletBalancer::TabletLoad tablet;
+        tablet.tableId = tableId;
+        tablet.startKeyHash = 0;
+        tablet.endKeyHash = ~0UL;
+        tablet.owner = master1;
+        tablet.movable = true;
+        tablet.load = load;
+        for (uint32_t i = firstSlice; i <= lastSlice; i++)
+            tablet.sliceLoad[i] = load / (lastSlice - firstSlice + 1);
+        return tablet;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(TabletBalancerTest);
+};
+
+TEST_F(TabletBalancerTest, balance_firstRoundIsBaseline) {
+    vector<string> keys = makeHotSpot(0, 8);
+    EXPECT_EQ(100U, readHotSpot(keys));
+    EXPECT_EQ(0U, balancer.balance());
+    EXPECT_EQ(100U, readHotSpot(keys));
+    EXPECT_EQ(1U, balancer.balance());
+}
+
+TEST_F(TabletBalancerTest, balance_notImbalanced) {
+    options->set("balancerImbalancePercent", "1000");
+    vector<string> keys = makeHotSpot(0, 8);
+    balancer.balance();
+    readHotSpot(keys);
+    EXPECT_EQ(0U, balancer.balance());
+
+    options->set("balancerImbalancePercent", "120");
+    options->set("balancerMinLoad", "1000000");
+    readHotSpot(keys);
+    EXPECT_EQ(0U, balancer.balance());
+}
+
+TEST_F(TabletBalancerTest, balance_migratesWholeTablet) {
+    // Two tablets on master1, equally hot: moving one of them whole
+    // balances the load, so no split is needed.
+    service->tableManager.splitTablet(tableId, 1UL << 63);
+    vector<string> keys = makeHotSpot(0, 8);
+    vector<string> more = makeHotSpot(1UL << 63, 8);
+    keys.insert(keys.end(), more.begin(), more.end());
+    balancer.balance();
+    readHotSpot(keys);
+    EXPECT_EQ(1U, balancer.balance());
+
+    Tablet low = service->tableManager.getTablet(tableId, 0);
+    Tablet high = service->tableManager.getTablet(tableId, ~0UL);
+    EXPECT_EQ(0U, low.startKeyHash);
+    EXPECT_EQ((1UL << 63) - 1, low.endKeyHash);
+    EXPECT_NE(low.serverId, high.serverId);
+    EXPECT_EQ(50U, readHotSpot(keys));
+}
+
+TEST_F(TabletBalancerTest, balance_shiftingHotSpot) {
+    // A hot spot confined to a small part of the key hash space: the
+    // balancer has to zoom in on it through successive splits before it can
+    // divide the load between the masters.
+    vector<string> hotSpotA = makeHotSpot(0, 16);
+    vector<string> hotSpotB = makeHotSpot(0xa000000000000000UL, 16);
+    balancer.balance();
+
+    EXPECT_EQ(100U, readHotSpot(hotSpotA));
+    for (int round = 0; round < 8; round++) {
+        balancer.balance();
+        readHotSpot(hotSpotA);
+    }
+    EXPECT_GE(70U, readHotSpot(hotSpotA));
+
+    // Now the hot spot moves somewhere else.
+    for (int round = 0; round < 8; round++) {
+        balancer.balance();
+        readHotSpot(hotSpotB);
+    }
+    EXPECT_GE(70U, readHotSpot(hotSpotB));
+}
+
+TEST_F(TabletBalancerTest, balance_singleHotKey) {
+    // One key hash can't be divided, so once the balancer has isolated it
+    // in its own tablet it must leave it alone rather than bounce it back
+    // and forth between masters.
+    vector<string> keys = makeHotSpot(0, 1);
+    Key key(tableId, keys[0].c_str(), downCast<uint16_t>(keys[0].length()));
+    service->tableManager.splitTablet(tableId, key.getHash());
+    service->tableManager.splitTablet(tableId, key.getHash() + 1);
+    balancer.balance();
+    readHotSpot(keys);
+    EXPECT_EQ(0U, balancer.balance());
+}
+
+TEST_F(TabletBalancerTest, startAndHalt) {
+    balancer.start();
+    EXPECT_TRUE(balancer.thread);
+    balancer.halt();
+    EXPECT_FALSE(balancer.thread);
+    EXPECT_EQ("main: Balancer exited", TestLog::get());
+
+    // Halting again (as the destructor does) is harmless.
+    balancer.halt();
+}
+
+TEST_F(TabletBalancerTest, runRound_disabled) {
+    vector<string> keys = makeHotSpot(0, 8);
+    balancer.balance();
+    readHotSpot(keys);
+    EXPECT_EQ(1000U, balancer.runRound());
+    EXPECT_TRUE(balancer.previousCounts.empty());
+}
+
+TEST_F(TabletBalancerTest, runRound_enabled) {
+    options->set("balancerIntervalMs", "50");
+    makeHotSpot(0, 8);
+    EXPECT_EQ(50U, balancer.runRound());
+    EXPECT_EQ(1U, balancer.previousCounts.size());
+}
+
+TEST_F(TabletBalancerTest, collectLoad_loadSincePreviousRound) {
+    vector<string> keys = makeHotSpot(0, 1);
+    std::map<uint64_t, uint64_t> masterLoad;
+    vector<TabletBalancer::TabletLoad> tablets;
+    balancer.collectLoad(&masterLoad, &tablets);
+
+    masterLoad.clear();
+    tablets.clear();
+    readHotSpot(keys);
+    balancer.collectLoad(&masterLoad, &tablets);
+    EXPECT_EQ(2U, masterLoad.size());
+    EXPECT_EQ(5U, masterLoad[master1.getId()]);
+    EXPECT_EQ(0U, masterLoad[master2.getId()]);
+    ASSERT_EQ(1U, tablets.size());
+    EXPECT_EQ(master1, tablets[0].owner);
+    EXPECT_TRUE(tablets[0].movable);
+    EXPECT_EQ(5U, tablets[0].load);
+    EXPECT_EQ(5U, tablets[0].sliceLoad[0]);
+}
+
+TEST_F(TabletBalancerTest, collectLoad_countsReset) {
+    vector<string> keys = makeHotSpot(0, 1);
+    readHotSpot(keys);
+    std::map<uint64_t, uint64_t> masterLoad;
+    vector<TabletBalancer::TabletLoad> tablets;
+    TabletBalancer::TabletKey key(tableId, 0, ~0UL);
+    balancer.previousCounts[key].total = 1000;
+    balancer.collectLoad(&masterLoad, &tablets);
+    ASSERT_EQ(1U, tablets.size());
+    EXPECT_EQ(6U, tablets[0].load);
+    EXPECT_EQ(6U, masterLoad[master1.getId()]);
+}
+
+TEST_F(TabletBalancerTest, moveLoad_staleTablet) {
+    TabletBalancer::TabletLoad tablet = tabletLoad(0, 1, 100);
+    tablet.owner = master2;
+    uint64_t moved = 1;
+    EXPECT_FALSE(balancer.moveLoad(&tablet, master1, 100, &moved));
+    EXPECT_EQ(0U, moved);
+    Tablet current = service->tableManager.getTablet(tableId, 0);
+    EXPECT_EQ(master1, current.serverId);
+    EXPECT_EQ(~0UL, current.endKeyHash);
+}
+
+TEST_F(TabletBalancerTest, moveLoad_wholeTablet) {
+    TabletBalancer::TabletLoad tablet = tabletLoad(0, 1, 100);
+    uint64_t moved;
+    EXPECT_TRUE(balancer.moveLoad(&tablet, master2, 300, &moved));
+    EXPECT_EQ(100U, moved);
+    Tablet current = service->tableManager.getTablet(tableId, 0);
+    EXPECT_EQ(master2, current.serverId);
+    EXPECT_EQ(~0UL, current.endKeyHash);
+}
+
+TEST_F(TabletBalancerTest, moveLoad_splitsAtBestBoundary) {
+    // Half the gap is 50, which is exactly the load in the first slice.
+    TabletBalancer::TabletLoad tablet = tabletLoad(0, 1, 100);
+    uint64_t moved;
+    EXPECT_TRUE(balancer.moveLoad(&tablet, master2, 100, &moved));
+    EXPECT_EQ(50U, moved);
+    Tablet low = service->tableManager.getTablet(tableId, 0);
+    Tablet high = service->tableManager.getTablet(tableId, ~0UL);
+    EXPECT_EQ(master2, low.serverId);
+    EXPECT_EQ((1UL << 61) - 1, low.endKeyHash);
+    EXPECT_EQ(master1, high.serverId);
+    EXPECT_EQ(1UL << 61, high.startKeyHash);
+}
+
+TEST_F(TabletBalancerTest, moveLoad_singleSlice) {
+    // All of the load is in slice 3: split it off, but don't move anything
+    // until the next round can see how the load falls within it.
+    TabletBalancer::TabletLoad tablet = tabletLoad(3, 3, 100);
+    uint64_t moved = 1;
+    EXPECT_TRUE(balancer.moveLoad(&tablet, master2, 100, &moved));
+    EXPECT_EQ(0U, moved);
+    Tablet low = service->tableManager.getTablet(tableId, 0);
+    Tablet high = service->tableManager.getTablet(tableId, ~0UL);
+    EXPECT_EQ(master1, low.serverId);
+    EXPECT_EQ((3UL << 61) - 1, low.endKeyHash);
+    EXPECT_EQ(master1, high.serverId);
+    EXPECT_EQ(3UL << 61, high.startKeyHash);
+}
+
+}  // namespace RAMCloud
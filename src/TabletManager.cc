@@ -24,6 +24,8 @@ namespace RAMCloud {
 TabletManager::TabletManager()
     : tabletMap()
     , lock("TabletManager::lock")
+    , version(0)
+    , numTablets(0)
 {
 }
 
@@ -60,6 +62,8 @@ TabletManager::addTablet(uint64_t tableId,
 
     tabletMap.insert(std::make_pair(tableId,
                      Tablet(tableId, startKeyHash, endKeyHash, state)));
+    numTablets++;
+    version++;
     return true;
 }
 
@@ -89,6 +93,7 @@ TabletManager::checkAndIncrementReadCount(Key& key) {
     }
 
     it->second.readCount++;
+    it->second.recordLoad(key.getHash());
     return true;
 }
 
@@ -243,6 +248,8 @@ TabletManager::deleteTablet(uint64_t tableId,
     }
 
     tabletMap.erase(it);
+    numTablets--;
+    version++;
     return true;
 }
 
@@ -288,6 +295,9 @@ TabletManager::splitTablet(uint64_t tableId,
         // behavior was to simply zero them, so for the time being we'll
         // stick with that. At the very least it's what Christian expects.
         t->readCount = t->writeCount = 0;
+        memset(t->keyHashLoad, 0, sizeof(t->keyHashLoad));
+        numTablets++;
+        version++;
     }
 
     return true;
@@ -357,8 +367,10 @@ TabletManager::incrementReadCount(uint64_t tableId, KeyHash keyHash)
 {
     SpinLock::Guard guard(lock);
     TabletMap::iterator it = lookup(tableId, keyHash, guard);
-    if (it != tabletMap.end())
+    if (it != tabletMap.end()) {
         it->second.readCount++;
+        it->second.recordLoad(keyHash);
+    }
 }
 
 /**
@@ -380,8 +392,10 @@ TabletManager::incrementWriteCount(uint64_t tableId, KeyHash keyHash)
 {
     SpinLock::Guard guard(lock);
     TabletMap::iterator it = lookup(tableId, keyHash, guard);
-    if (it != tabletMap.end())
+    if (it != tabletMap.end()) {
         it->second.writeCount++;
+        it->second.recordLoad(keyHash);
+    }
 }
 
 /**
@@ -402,20 +416,23 @@ TabletManager::getStatistics(ProtoBuf::ServerStatistics* serverStatistics)
         entry->set_start_key_hash(t->startKeyHash);
         entry->set_end_key_hash(t->endKeyHash);
         uint64_t totalOperations = t->readCount + t->writeCount;
-        if (totalOperations > 0)
+        if (totalOperations > 0) {
             entry->set_number_read_and_writes(totalOperations);
+            for (uint32_t i = 0; i < Tablet::NUM_LOAD_SLICES; i++)
+                entry->add_key_hash_load(t->keyHashLoad[i]);
+        }
         ++it;
     }
 }
 
 /**
- * Obtain the total number of tablets this object is managing.
+ * Obtain the total number of tablets this object is managing. This method
+ * doesn't acquire the TabletManager's lock.
  */
 size_t
 TabletManager::getNumTablets()
 {
-    SpinLock::Guard _(lock);
-    return tabletMap.size();
+    return numTablets;
 }
 
 
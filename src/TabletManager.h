@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_TABLETMANAGER_H
 #define RAMCLOUD_TABLETMANAGER_H
 
+#include <atomic>
 #include <unordered_map>
 
 #include "Common.h"
@@ -60,6 +61,7 @@ class TabletManager {
         RECOVERING = ProtoBuf::Tablets_Tablet_State_RECOVERING,
         LOCKED_FOR_MIGRATION =
             ProtoBuf::Tablets_Tablet_State_LOCKED_FOR_MIGRATION,
+        PULL_SOURCE = ProtoBuf::Tablets_Tablet_State_PULL_SOURCE,
     };
 
     /**
@@ -80,6 +82,7 @@ class TabletManager {
             , state(RECOVERING)
             , readCount(-1)
             , writeCount(-1)
+            , keyHashLoad()
         {
         }
 
@@ -93,9 +96,25 @@ class TabletManager {
             , state(state)
             , readCount(0)
             , writeCount(0)
+            , keyHashLoad()
         {
         }
 
+        /**
+         * Record a read or write of an object in this tablet in the
+         * appropriate slice of #keyHashLoad.
+         *
+         * \param keyHash
+         *      Key hash of the object accessed; must lie within this tablet.
+         */
+        void
+        recordLoad(KeyHash keyHash)
+        {
+            uint64_t sliceWidth =
+                    (endKeyHash - startKeyHash) / NUM_LOAD_SLICES + 1;
+            keyHashLoad[(keyHash - startKeyHash) / sliceWidth]++;
+        }
+
         /// The identifier of the table that this tablet describes a portion of.
         uint64_t tableId;
 
@@ -113,6 +132,15 @@ class TabletManager {
 
         /// The number of write operations performed on objects in this tablet.
         uint64_t writeCount;
+
+        /// The number of equal-width slices the tablet's key hash range is
+        /// divided into for #keyHashLoad.
+        static const uint32_t NUM_LOAD_SLICES = 8;
+
+        /// Reads plus writes performed on objects in each slice of this
+        /// tablet's key hash range, lowest key hashes first. This lets the
+        /// coordinator see where within a hot tablet the load falls.
+        uint64_t keyHashLoad[NUM_LOAD_SLICES];
     };
 
     TabletManager();
@@ -151,6 +179,18 @@ class TabletManager {
     size_t getNumTablets();
     string toString();
 
+    /**
+     * Return a number that changes whenever a tablet is added, deleted, or
+     * split. This lets callers cache the key hash ranges of tablets without
+     * taking #lock on every lookup: if the version hasn't changed since a
+     * range was cached, the range is still accurate.
+     */
+    uint64_t
+    getVersion()
+    {
+        return version;
+    }
+
   PRIVATE:
     /// Tablets are stored in a multimap that is indexed by table identifier.
     /// The assumption is that we are likely to have many tablets, but
@@ -166,6 +206,13 @@ class TabletManager {
     /// Monitor spinlock used to protect the tabletMap from concurrent access.
     SpinLock lock;
 
+    /// Incremented (with #lock held) after each change to the key hash
+    /// ranges in #tabletMap; see getVersion.
+    std::atomic<uint64_t> version;
+
+    /// Mirrors tabletMap.size(), so that getNumTablets needn't take #lock.
+    std::atomic<size_t> numTablets;
+
     DISALLOW_COPY_AND_ASSIGN(TabletManager);
 };
 
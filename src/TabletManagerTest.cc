@@ -204,6 +204,23 @@ TEST_F(TabletManagerTest, splitTablet) {
     EXPECT_EQ(TabletManager::NORMAL, tablet.state);
 }
 
+TEST_F(TabletManagerTest, getVersion) {
+    EXPECT_EQ(0U, tm.getVersion());
+    EXPECT_TRUE(tm.addTablet(0, 50, 100, TabletManager::NORMAL));
+    EXPECT_EQ(1U, tm.getVersion());
+    EXPECT_FALSE(tm.addTablet(0, 60, 70, TabletManager::NORMAL));
+    EXPECT_EQ(1U, tm.getVersion());
+    EXPECT_TRUE(tm.splitTablet(0, 60));
+    EXPECT_EQ(2U, tm.getVersion());
+    EXPECT_TRUE(tm.splitTablet(0, 60));
+    EXPECT_EQ(2U, tm.getVersion());
+    EXPECT_TRUE(tm.changeState(0, 60, 100, TabletManager::NORMAL,
+            TabletManager::RECOVERING));
+    EXPECT_EQ(2U, tm.getVersion());
+    EXPECT_TRUE(tm.deleteTablet(0, 60, 100));
+    EXPECT_EQ(3U, tm.getVersion());
+}
+
 TEST_F(TabletManagerTest, changeState) {
     EXPECT_TRUE(tm.addTablet(0, 10, 20, TabletManager::RECOVERING));
 
@@ -243,11 +260,21 @@ TEST_F(TabletManagerTest, getStatistics) {
     Key key(58, "1", 1);
     tm.incrementReadCount(key);
 
+    // All of the accesses land in the slice containing the key's hash.
+    uint64_t slice = key.getHash() /
+            (~0UL / TabletManager::Tablet::NUM_LOAD_SLICES + 1);
+    string load1, load2;
+    for (uint64_t i = 0; i < TabletManager::Tablet::NUM_LOAD_SLICES; i++) {
+        load1 += format(" key_hash_load: %d", i == slice ? 1 : 0);
+        load2 += format(" key_hash_load: %d", i == slice ? 2 : 0);
+    }
+
     {
         ProtoBuf::ServerStatistics stats;
         tm.getStatistics(&stats);
         EXPECT_EQ("tabletentry { table_id: 58 start_key_hash: 0 "
-            "end_key_hash: 18446744073709551615 number_read_and_writes: 1 }",
+            "end_key_hash: 18446744073709551615 number_read_and_writes: 1" +
+            load1 + " }",
             stats.ShortDebugString());
     }
 
@@ -257,17 +284,42 @@ TEST_F(TabletManagerTest, getStatistics) {
         ProtoBuf::ServerStatistics stats;
         tm.getStatistics(&stats);
         EXPECT_EQ("tabletentry { table_id: 58 start_key_hash: 0 "
-            "end_key_hash: 18446744073709551615 number_read_and_writes: 2 }",
+            "end_key_hash: 18446744073709551615 number_read_and_writes: 2" +
+            load2 + " }",
             stats.ShortDebugString());
     }
 }
 
+TEST_F(TabletManagerTest, Tablet_recordLoad) {
+    TabletManager::Tablet tablet(1, 100, 179, TabletManager::NORMAL);
+    tablet.recordLoad(100);
+    tablet.recordLoad(109);
+    tablet.recordLoad(110);
+    tablet.recordLoad(179);
+    EXPECT_EQ(2U, tablet.keyHashLoad[0]);
+    EXPECT_EQ(1U, tablet.keyHashLoad[1]);
+    EXPECT_EQ(1U, tablet.keyHashLoad[7]);
+
+    TabletManager::Tablet whole(1, 0, ~0UL, TabletManager::NORMAL);
+    whole.recordLoad(0);
+    whole.recordLoad(~0UL);
+    EXPECT_EQ(1U, whole.keyHashLoad[0]);
+    EXPECT_EQ(1U, whole.keyHashLoad[7]);
+
+    TabletManager::Tablet single(1, 5, 5, TabletManager::NORMAL);
+    single.recordLoad(5);
+    EXPECT_EQ(1U, single.keyHashLoad[0]);
+}
+
 TEST_F(TabletManagerTest, getNumTablets) {
     EXPECT_EQ(0U, tm.getNumTablets());
     tm.addTablet(0, 0, 0, TabletManager::NORMAL);
     EXPECT_EQ(1U, tm.getNumTablets());
     tm.deleteTablet(0, 0, 0);
     EXPECT_EQ(0U, tm.getNumTablets());
+    tm.addTablet(0, 0, 10, TabletManager::NORMAL);
+    tm.splitTablet(0, 5);
+    EXPECT_EQ(2U, tm.getNumTablets());
 }
 
 TEST_F(TabletManagerTest, toString) {
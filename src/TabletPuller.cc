@@ -0,0 +1,590 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ClientException.h"
+#include "CoordinatorClient.h"
+#include "MasterClient.h"
+#include "SegmentIterator.h"
+#include "ShortMacros.h"
+#include "SideLog.h"
+#include "TabletPuller.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a TabletPuller. Tablets can be pulled on demand right away;
+ * background pulls begin once start() is invoked.
+ *
+ * \param context
+ *      Overall information about the RAMCloud server.
+ * \param serverId
+ *      Id of this master; may not be valid until start() is called.
+ * \param objectManager
+ *      Pulled objects are replayed into this ObjectManager.
+ */
+TabletPuller::TabletPuller(Context* context, const ServerId* serverId,
+        ObjectManager* objectManager)
+    : context(context)
+    , serverId(serverId)
+    , objectManager(objectManager)
+    , mutex()
+    , pulls()
+    , numPulls(0)
+    , nextGeneration(1)
+    , lastRound()
+    , tombstoneProtector()
+    , replayMutex()
+    , halting(false)
+    , workAvailable()
+    , thread()
+{
+}
+
+TabletPuller::~TabletPuller()
+{
+    halt();
+}
+
+/**
+ * Start the thread that pulls tablets in the background. Calling start()
+ * on a puller that is already running has no effect. start() and halt()
+ * are not thread-safe.
+ */
+void
+TabletPuller::start()
+{
+    if (thread)
+        return;
+    halting = false;
+    thread.construct(&TabletPuller::main, this);
+}
+
+/**
+ * Stop the background thread, waiting for any round in progress to finish.
+ * Pulls that haven't finished are resumed by the next call to start().
+ * Calling halt() on a puller that isn't running has no effect.
+ */
+void
+TabletPuller::halt()
+{
+    Lock lock(mutex);
+    halting = true;
+    workAvailable.notify_one();
+    lock.unlock();
+
+    if (thread) {
+        thread->join();
+        thread.destroy();
+    }
+}
+
+/**
+ * Start pulling a tablet that this master has just been given, or switch
+ * an existing pull to a different source (because the old source crashed
+ * and its copy of the tablet was recovered elsewhere). Must be called
+ * before the tablet is served, so that no request gets past
+ * #ensurePulled unchecked.
+ *
+ * \param tableId
+ *      Table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ * \param source
+ *      Master holding the tablet's objects in the PULL_SOURCE state.
+ */
+void
+TabletPuller::beginPull(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash, ServerId source)
+{
+    Lock lock(mutex);
+    Pull& pull = pulls[std::make_pair(tableId, firstKeyHash)];
+    if (pull.source.isValid()) {
+        LOG(NOTICE, "Pulling tablet [0x%lx,0x%lx] in tableId %lu from %s "
+                "instead of %s", firstKeyHash, lastKeyHash, tableId,
+                source.toString().c_str(), pull.source.toString().c_str());
+    } else {
+        LOG(NOTICE, "Pulling tablet [0x%lx,0x%lx] in tableId %lu from %s",
+                firstKeyHash, lastKeyHash, tableId,
+                source.toString().c_str());
+        pull.tableId = tableId;
+        pull.firstKeyHash = firstKeyHash;
+        pull.lastKeyHash = lastKeyHash;
+        numPulls = downCast<uint32_t>(pulls.size());
+        if (!tombstoneProtector)
+            tombstoneProtector.construct(objectManager);
+    }
+
+    // The new source's hash table is laid out differently, so the
+    // background pull starts over; objects already pulled stay pulled.
+    pull.source = source;
+    pull.generation = nextGeneration++;
+    if (!pull.bulkDone) {
+        for (uint32_t i = 0; i < NUM_PARTITIONS; i++) {
+            pull.cursors[i] = 0;
+            pull.partitionDone[i] = false;
+        }
+    }
+    workAvailable.notify_one();
+}
+
+/**
+ * Abandon the pulls of any tablets in a key hash range; called when this
+ * master stops owning the range. Waits for replays in progress for these
+ * tablets to finish, so that nothing more is added to the hash table for
+ * them once this method returns.
+ *
+ * \param tableId
+ *      Table containing the range.
+ * \param firstKeyHash
+ *      Lowest key hash in the range.
+ * \param lastKeyHash
+ *      Highest key hash in the range.
+ */
+void
+TabletPuller::drop(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash)
+{
+    std::lock_guard<std::mutex> replayLock(replayMutex);
+    Lock lock(mutex);
+    PullMap::iterator it = pulls.lower_bound(std::make_pair(tableId, 0lu));
+    while (it != pulls.end() && it->first.first == tableId) {
+        Pull& pull = it->second;
+        if (pull.lastKeyHash < firstKeyHash ||
+                pull.firstKeyHash > lastKeyHash) {
+            ++it;
+            continue;
+        }
+        LOG(NOTICE, "Abandoning pull of tablet [0x%lx,0x%lx] in tableId %lu",
+                pull.firstKeyHash, pull.lastKeyHash, tableId);
+        erasePull(lock, it++);
+    }
+}
+
+/**
+ * Make sure that the objects for a key hash have been pulled, if it
+ * belongs to a tablet that is still being pulled. ObjectManager calls this
+ * before every operation on a key; it must not be called with a hash table
+ * bucket lock held.
+ *
+ * \param tableId
+ *      Table containing the key.
+ * \param keyHash
+ *      Hash of the key.
+ *
+ * \throw RetryException
+ *      The objects could not be pulled right now (for example, because the
+ *      source has crashed and its copy of the tablet is being recovered).
+ */
+void
+TabletPuller::ensurePulled(uint64_t tableId, KeyHash keyHash)
+{
+    if (numPulls.load() == 0)
+        return;
+
+    ServerId source;
+    {
+        Lock lock(mutex);
+        Pull* pull = findPull(lock, tableId, keyHash);
+        if (pull == NULL || pull->bulkDone || pull->pulled.count(keyHash))
+            return;
+        source = pull->source;
+    }
+
+    Buffer response;
+    SegmentCertificate certificate;
+    try {
+        PullTabletDataRpc rpc(context, source, tableId, keyHash, &response);
+        rpc.wait(NULL, &certificate);
+    } catch (const ClientException& e) {
+        RAMCLOUD_CLOG(NOTICE, "Couldn't pull key hash 0x%lx in tableId %lu "
+                "from %s: %s", keyHash, tableId, source.toString().c_str(),
+                e.what());
+        throw RetryException(HERE, 1000000, 2000000,
+                "object hasn't been pulled from the tablet's old owner yet");
+    }
+    replay(tableId, keyHash, &response, certificate, true, &keyHash);
+}
+
+/**
+ * Tell whether a key hash belongs to a tablet that is still being pulled.
+ *
+ * \param tableId
+ *      Table containing the key.
+ * \param keyHash
+ *      Hash of the key.
+ */
+bool
+TabletPuller::isPulling(uint64_t tableId, KeyHash keyHash)
+{
+    if (numPulls.load() == 0)
+        return false;
+    Lock lock(mutex);
+    return findPull(lock, tableId, keyHash) != NULL;
+}
+
+/**
+ * Tell whether any part of a key hash range belongs to a tablet that is
+ * still being pulled.
+ *
+ * \param tableId
+ *      Table containing the range.
+ * \param firstKeyHash
+ *      Lowest key hash in the range.
+ * \param lastKeyHash
+ *      Highest key hash in the range.
+ */
+bool
+TabletPuller::isPulling(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash)
+{
+    if (numPulls.load() == 0)
+        return false;
+    Lock lock(mutex);
+    PullMap::iterator it = pulls.lower_bound(std::make_pair(tableId, 0lu));
+    for (; it != pulls.end() && it->first.first == tableId; ++it) {
+        if (it->second.lastKeyHash >= firstKeyHash &&
+                it->second.firstKeyHash <= lastKeyHash)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Pull all of a tablet's objects from a master and replay them, without
+ * checking what is in the hash table already other than by version. Used
+ * by a recovery master for a tablet whose crashed owner was still pulling
+ * it: once the crashed master's log has been replayed, this fills in
+ * whatever the crashed master hadn't pulled yet. The tablet must still be
+ * RECOVERING, so that tombstones from the log stop older objects from
+ * being resurrected.
+ *
+ * \param tableId
+ *      Table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ * \param source
+ *      Master holding the tablet's objects in the PULL_SOURCE state.
+ *
+ * \throw ClientException
+ *      A request to \a source failed.
+ */
+void
+TabletPuller::pullAll(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash, ServerId source)
+{
+    LOG(NOTICE, "Pulling the rest of tablet [0x%lx,0x%lx] in tableId %lu "
+            "from %s", firstKeyHash, lastKeyHash, tableId,
+            source.toString().c_str());
+    ObjectManager::TombstoneProtector protector(objectManager);
+    uint64_t cursors[NUM_PARTITIONS] = {0};
+    bool partitionDone[NUM_PARTITIONS] = {false};
+    while (!pullPartitions(tableId, firstKeyHash, lastKeyHash, source,
+            cursors, partitionDone, false)) {
+        // Keep going.
+    }
+}
+
+/**
+ * Remove an entry from #pulls.
+ *
+ * \param lock
+ *      Ensures that the caller holds #mutex. The caller must also hold
+ *      #replayMutex.
+ * \param it
+ *      Entry to remove.
+ */
+void
+TabletPuller::erasePull(const Lock& lock, PullMap::iterator it)
+{
+    pulls.erase(it);
+    numPulls = downCast<uint32_t>(pulls.size());
+    if (pulls.empty())
+        tombstoneProtector.destroy();
+}
+
+/**
+ * Find the pull of the tablet that contains a key hash.
+ *
+ * \param lock
+ *      Ensures that the caller holds #mutex.
+ * \param tableId
+ *      Table containing the key.
+ * \param keyHash
+ *      Hash of the key.
+ * \return
+ *      The pull, or NULL if the key hash isn't in a tablet being pulled.
+ */
+TabletPuller::Pull*
+TabletPuller::findPull(const Lock& lock, uint64_t tableId, KeyHash keyHash)
+{
+    PullMap::iterator it = pulls.upper_bound(std::make_pair(tableId, keyHash));
+    if (it == pulls.begin())
+        return NULL;
+    --it;
+    Pull* pull = &it->second;
+    if (pull->tableId != tableId || keyHash > pull->lastKeyHash)
+        return NULL;
+    return pull;
+}
+
+/**
+ * Top-level method of the background thread: runs rounds while there are
+ * tablets to pull, until halt() is invoked.
+ */
+void
+TabletPuller::main()
+try {
+    Lock lock(mutex);
+    while (!halting) {
+        if (pulls.empty()) {
+            workAvailable.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        bool progress = pullRound();
+        lock.lock();
+        if (!progress) {
+            workAvailable.wait_for(lock,
+                    std::chrono::milliseconds(RETRY_INTERVAL_MS),
+                    [this] { return halting; });
+        }
+    }
+    TEST_LOG("Puller exited");
+} catch (const std::exception& e) {
+    LOG(ERROR, "Fatal error in TabletPuller: %s", e.what());
+    throw;
+} catch (...) {
+    LOG(ERROR, "Unknown fatal error in TabletPuller.");
+    throw;
+}
+
+/**
+ * Issue one PULL_TABLET_DATA request for each slice of the source's hash
+ * table that hasn't been pulled completely, all in parallel, and replay
+ * the responses.
+ *
+ * \param tableId
+ *      Table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ * \param source
+ *      Master to pull from.
+ * \param[in,out] cursors
+ *      Where to continue in each slice; updated as responses arrive.
+ * \param[in,out] partitionDone
+ *      Which slices have been pulled completely; updated as responses
+ *      arrive.
+ * \param filter
+ *      True means the tablet has an entry in #pulls, and objects whose key
+ *      hashes have already been pulled must be skipped (see #replay).
+ * \return
+ *      True if every slice has now been pulled completely.
+ *
+ * \throw ClientException
+ *      A request to \a source failed.
+ */
+bool
+TabletPuller::pullPartitions(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash, ServerId source, uint64_t cursors[],
+        bool partitionDone[], bool filter)
+{
+    Tub<PullTabletDataRpc> rpcs[NUM_PARTITIONS];
+    Buffer responses[NUM_PARTITIONS];
+    for (uint32_t i = 0; i < NUM_PARTITIONS; i++) {
+        if (!partitionDone[i]) {
+            rpcs[i].construct(context, source, tableId, firstKeyHash,
+                    lastKeyHash, i, NUM_PARTITIONS, cursors[i], &responses[i]);
+        }
+    }
+
+    bool allDone = true;
+    for (uint32_t i = 0; i < NUM_PARTITIONS; i++) {
+        if (rpcs[i]) {
+            SegmentCertificate certificate;
+            partitionDone[i] = rpcs[i]->wait(&cursors[i], &certificate);
+            replay(tableId, firstKeyHash, &responses[i], certificate, filter,
+                    NULL);
+        }
+        allDone = allDone && partitionDone[i];
+    }
+    return allDone;
+}
+
+/**
+ * Make progress on one of the tablets being pulled: either pull another
+ * batch from each slice of the source's hash table or, once everything has
+ * been pulled, tell the coordinator so that it can have the source drop its
+ * copy, and forget about the tablet.
+ *
+ * \return
+ *      False if the round failed and the next one should wait a while;
+ *      true otherwise.
+ */
+bool
+TabletPuller::pullRound()
+{
+    Lock lock(mutex);
+    if (pulls.empty())
+        return true;
+    PullMap::iterator it = pulls.upper_bound(lastRound);
+    if (it == pulls.end())
+        it = pulls.begin();
+    lastRound = it->first;
+
+    // Work on a copy, since the pull may be changed or dropped while the
+    // lock isn't held.
+    Pull& pull = it->second;
+    uint64_t tableId = pull.tableId;
+    uint64_t firstKeyHash = pull.firstKeyHash;
+    uint64_t lastKeyHash = pull.lastKeyHash;
+    ServerId source = pull.source;
+    uint64_t generation = pull.generation;
+    bool bulkDone = pull.bulkDone;
+    uint64_t cursors[NUM_PARTITIONS];
+    bool partitionDone[NUM_PARTITIONS];
+    std::copy(pull.cursors, pull.cursors + NUM_PARTITIONS, cursors);
+    std::copy(pull.partitionDone, pull.partitionDone + NUM_PARTITIONS,
+            partitionDone);
+    lock.unlock();
+
+    if (!bulkDone) {
+        try {
+            bulkDone = pullPartitions(tableId, firstKeyHash, lastKeyHash,
+                    source, cursors, partitionDone, true);
+        } catch (const ClientException& e) {
+            RAMCLOUD_CLOG(NOTICE, "Pulling tablet [0x%lx,0x%lx] in tableId "
+                    "%lu from %s failed: %s", firstKeyHash, lastKeyHash,
+                    tableId, source.toString().c_str(), e.what());
+            return false;
+        }
+
+        lock.lock();
+        Pull* current = findPull(lock, tableId, firstKeyHash);
+        if (current == NULL || current->generation != generation)
+            return true;
+        std::copy(cursors, cursors + NUM_PARTITIONS, current->cursors);
+        std::copy(partitionDone, partitionDone + NUM_PARTITIONS,
+                current->partitionDone);
+        current->bulkDone = bulkDone;
+        return true;
+    }
+
+    // Everything has been pulled. Once the coordinator knows, it no longer
+    // needs the source for recovering the tablet, and has the source drop
+    // its copy.
+    try {
+        CoordinatorClient::reassignTabletOwnership(context, tableId,
+                firstKeyHash, lastKeyHash, *serverId, 0, 0);
+    } catch (const ClientException& e) {
+        LOG(WARNING, "Couldn't report the end of the pull of tablet "
+                "[0x%lx,0x%lx] in tableId %lu: %s", firstKeyHash, lastKeyHash,
+                tableId, e.what());
+        return false;
+    }
+    LOG(NOTICE, "Finished pulling tablet [0x%lx,0x%lx] in tableId %lu "
+            "from %s", firstKeyHash, lastKeyHash, tableId,
+            source.toString().c_str());
+
+    std::lock_guard<std::mutex> replayLock(replayMutex);
+    lock.lock();
+    it = pulls.find(std::make_pair(tableId, firstKeyHash));
+    if (it != pulls.end())
+        erasePull(lock, it);
+    return true;
+}
+
+/**
+ * Replay the objects in a PULL_TABLET_DATA response into the log and hash
+ * table.
+ *
+ * \param tableId
+ *      Table containing the tablet.
+ * \param keyHash
+ *      Any key hash in the tablet.
+ * \param response
+ *      Holds the segment returned by the source.
+ * \param certificate
+ *      Certificate for the segment in \a response.
+ * \param filter
+ *      True means the tablet has an entry in #pulls: objects whose key
+ *      hashes have been pulled already are skipped, and the key hashes of
+ *      the others are recorded as pulled. If the tablet's pull has been
+ *      dropped meanwhile, nothing is replayed.
+ * \param requested
+ *      If not NULL, this key hash is also recorded as pulled (even if the
+ *      source has no objects for it).
+ */
+void
+TabletPuller::replay(uint64_t tableId, KeyHash keyHash, Buffer* response,
+        const SegmentCertificate& certificate, bool filter,
+        const KeyHash* requested)
+{
+    std::lock_guard<std::mutex> replayLock(replayMutex);
+    uint32_t length = response->size();
+    SegmentIterator it(response->getRange(0, length), length, certificate);
+    it.checkMetadataIntegrity();
+
+    Segment filtered;
+    vector<KeyHash> keyHashes;
+    if (filter) {
+        Lock lock(mutex);
+        Pull* pull = findPull(lock, tableId, keyHash);
+        if (pull == NULL)
+            return;
+        for (; !it.isDone(); it.next()) {
+            LogEntryType type = it.getType();
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJCOMP) {
+                KeyHash entryKeyHash = Key(type, buffer).getHash();
+                if (pull->pulled.count(entryKeyHash))
+                    continue;
+                keyHashes.push_back(entryKeyHash);
+            }
+
+            // Other entries (the source's safe version) are always needed.
+            // The source's segment was no bigger than this one, so what's
+            // left of it always fits.
+            bool appended = filtered.append(type, buffer);
+            assert(appended);
+        }
+    }
+
+    SideLog sideLog(objectManager->getLog());
+    if (filter) {
+        SegmentIterator filteredIt(filtered);
+        objectManager->replaySegment(&sideLog, filteredIt);
+    } else {
+        objectManager->replaySegment(&sideLog, it);
+    }
+    sideLog.commit();
+
+    if (filter) {
+        Lock lock(mutex);
+        Pull* pull = findPull(lock, tableId, keyHash);
+        assert(pull != NULL);
+        pull->pulled.insert(keyHashes.begin(), keyHashes.end());
+        if (requested != NULL)
+            pull->pulled.insert(*requested);
+    }
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,199 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_TABLETPULLER_H
+#define RAMCLOUD_TABLETPULLER_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#include "Common.h"
+#include "Atomic.h"
+#include "Buffer.h"
+#include "Key.h"
+#include "ObjectManager.h"
+#include "Segment.h"
+#include "ServerId.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+/**
+ * Runs on the new owner of a tablet that was migrated by handing ownership
+ * over first and moving the data afterwards (see
+ * WireFormat::MigrateTablet::Request::pull). The old owner keeps its copy
+ * of the tablet in the PULL_SOURCE state, and this class moves the
+ * tablet's objects from there into the local log while the tablet is
+ * already being served here:
+ * - Before ObjectManager touches a key of such a tablet, it calls
+ *   #ensurePulled, which fetches that key's objects from the source with a
+ *   priority PULL_TABLET_DATA request unless they have been pulled already.
+ * - Meanwhile a thread of its own pulls the whole tablet in the background,
+ *   with one request outstanding per slice of the source's hash table.
+ *   Once it is done it tells the coordinator, which then has the source
+ *   drop its copy.
+ *
+ * Pulled objects are replayed with ObjectManager::replaySegment, whose
+ * version checks keep anything written here from being overwritten. To
+ * keep the (unversioned) absence of a deleted object from being undone,
+ * the key hashes already pulled are remembered, and objects for them are
+ * never replayed again.
+ *
+ * Until the pull is done the coordinator records the source as the
+ * tablet's pull source (see Tablet::pullSource). If this master crashes,
+ * the recovery master replays its log and then pulls the rest of the
+ * tablet itself (#pullAll); if the source crashes, its copy is recovered
+ * elsewhere and the pull is pointed there (#beginPull).
+ */
+class TabletPuller {
+  PUBLIC:
+    TabletPuller(Context* context, const ServerId* serverId,
+            ObjectManager* objectManager);
+    ~TabletPuller();
+    void start();
+    void halt();
+    void beginPull(uint64_t tableId, uint64_t firstKeyHash,
+            uint64_t lastKeyHash, ServerId source);
+    void drop(uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash);
+    void ensurePulled(uint64_t tableId, KeyHash keyHash);
+    bool isPulling(uint64_t tableId, KeyHash keyHash);
+    bool isPulling(uint64_t tableId, uint64_t firstKeyHash,
+            uint64_t lastKeyHash);
+    void pullAll(uint64_t tableId, uint64_t firstKeyHash,
+            uint64_t lastKeyHash, ServerId source);
+
+    /// The source's hash table is divided into this many slices, each
+    /// pulled by its own stream of PULL_TABLET_DATA requests.
+    static const uint32_t NUM_PARTITIONS = 8;
+
+    /// How long the background pull waits before trying again after a
+    /// request failed (for example, because the source crashed).
+    static const uint32_t RETRY_INTERVAL_MS = 100;
+
+  PRIVATE:
+    /**
+     * State of the pull of one tablet.
+     */
+    struct Pull {
+        Pull()
+            : tableId(0)
+            , firstKeyHash(0)
+            , lastKeyHash(0)
+            , source()
+            , generation(0)
+            , cursors()
+            , partitionDone()
+            , pulled()
+            , bulkDone(false)
+        {}
+
+        /// Identifies the tablet.
+        uint64_t tableId;
+        uint64_t firstKeyHash;
+        uint64_t lastKeyHash;
+
+        /// Master holding the tablet's objects.
+        ServerId source;
+
+        /// Changes whenever #source does; a background round that was
+        /// started against an earlier source doesn't update #cursors.
+        uint64_t generation;
+
+        /// Position of the background pull in each slice of #source's
+        /// hash table.
+        uint64_t cursors[NUM_PARTITIONS];
+        bool partitionDone[NUM_PARTITIONS];
+
+        /// Key hashes whose objects have been pulled already: the source's
+        /// copies of them must never be replayed again, since the objects
+        /// may have been modified or deleted here since.
+        std::unordered_set<KeyHash> pulled;
+
+        /// Set once every slice has been pulled; from then on nothing needs
+        /// to be pulled on demand, and all that's left is telling the
+        /// coordinator.
+        bool bulkDone;
+    };
+
+    /// Pulls indexed by table id and first key hash.
+    typedef std::map<std::pair<uint64_t, uint64_t>, Pull> PullMap;
+    typedef std::unique_lock<std::mutex> Lock;
+
+    void erasePull(const Lock& lock, PullMap::iterator it);
+    Pull* findPull(const Lock& lock, uint64_t tableId, KeyHash keyHash);
+    void main();
+    bool pullPartitions(uint64_t tableId, uint64_t firstKeyHash,
+            uint64_t lastKeyHash, ServerId source, uint64_t cursors[],
+            bool partitionDone[], bool filter);
+    bool pullRound();
+    void replay(uint64_t tableId, KeyHash keyHash, Buffer* response,
+            const SegmentCertificate& certificate, bool filter,
+            const KeyHash* requested);
+
+    /// Shared information about the server.
+    Context* context;
+
+    /// This master's id, which is reported to the coordinator when a pull
+    /// is done.
+    const ServerId* serverId;
+
+    /// Pulled objects are replayed into this master's log and hash table.
+    ObjectManager* objectManager;
+
+    /// Monitor lock protecting all of the fields below except #replayMutex.
+    /// It is never held while taking hash table bucket locks or sending
+    /// RPCs.
+    std::mutex mutex;
+
+    /// Tablets being pulled.
+    PullMap pulls;
+
+    /// Number of entries in #pulls; lets #ensurePulled return without
+    /// taking #mutex when nothing is being pulled.
+    Atomic<uint32_t> numPulls;
+
+    /// Used to assign Pull::generation.
+    uint64_t nextGeneration;
+
+    /// Key of the pull handled by the most recent background round, so
+    /// that rounds take turns among the pulls.
+    std::pair<uint64_t, uint64_t> lastRound;
+
+    /// Held while there are any pulls, since replaySegment requires one.
+    Tub<ObjectManager::TombstoneProtector> tombstoneProtector;
+
+    /// Serializes replays, so that the check against Pull::pulled and the
+    /// update after replaying happen atomically with respect to other
+    /// replays. Taken before #mutex.
+    std::mutex replayMutex;
+
+    /// Set by halt() to tell #thread to exit.
+    bool halting;
+
+    /// Notified when there's a new pull or halt() is called.
+    std::condition_variable workAvailable;
+
+    /// Runs main(); empty unless the puller has been started.
+    Tub<std::thread> thread;
+
+    DISALLOW_COPY_AND_ASSIGN(TabletPuller);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_TABLETPULLER_H
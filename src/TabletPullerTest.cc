@@ -0,0 +1,264 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "TabletPuller.h"
+#include "MasterClient.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+class TabletPullerTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    Server* source;
+    Server* target;
+    TabletPuller* puller;
+    uint64_t tableId;
+
+    TabletPullerTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , source()
+        , target()
+        , puller()
+        , tableId()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::PING_SERVICE,
+                           WireFormat::MEMBERSHIP_SERVICE};
+        config.master.numReplicas = 0;
+        config.localLocator = "mock:host=master1";
+        source = cluster.addServer(config);
+        config.localLocator = "mock:host=master2";
+        target = cluster.addServer(config);
+
+        // Keep the background pulls out of the way; tests run rounds
+        // explicitly.
+        source->master->tabletPuller.halt();
+        target->master->tabletPuller.halt();
+        puller = &target->master->tabletPuller;
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = cluster.coordinator->tableManager.createTable("table", 1,
+                source->serverId);
+        ramcloud->write(tableId, "a", 1, "value-a");
+        ramcloud->write(tableId, "b", 1, "value-b");
+        ramcloud->write(tableId, "c", 1, "value-c");
+
+        MasterClient::requestMigration(&context, source->serverId, tableId,
+                0, ~0UL, target->serverId, true);
+    }
+
+    /**
+     * Return the value of an object as stored at the target (without
+     * pulling it first), or "(none)" if the target doesn't have it.
+     */
+    string
+    targetValue(const char* key)
+    {
+        Key k(tableId, key, downCast<uint16_t>(strlen(key)));
+        Buffer value;
+        TabletPuller* saved = target->master->objectManager.tabletPuller;
+        target->master->objectManager.tabletPuller = NULL;
+        Status status = target->master->objectManager.readObject(k, &value,
+                NULL, NULL, true);
+        target->master->objectManager.tabletPuller = saved;
+        if (status != STATUS_OK)
+            return "(none)";
+        return TestUtil::toString(&value);
+    }
+
+    /**
+     * Run background rounds until the pull of the migrated tablet is done.
+     */
+    void
+    finishPull()
+    {
+        for (int i = 0; i < 10 && puller->isPulling(tableId, 0, ~0UL); i++)
+            EXPECT_TRUE(puller->pullRound());
+        EXPECT_FALSE(puller->isPulling(tableId, 0, ~0UL));
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(TabletPullerTest);
+};
+
+TEST_F(TabletPullerTest, beginPull_switchSource) {
+    TabletPuller::Pull* pull = &puller->pulls[std::make_pair(tableId, 0UL)];
+    EXPECT_EQ(source->serverId, pull->source);
+    uint64_t generation = pull->generation;
+    pull->cursors[3] = 77;
+    pull->partitionDone[4] = true;
+
+    TestLog::reset();
+    puller->beginPull(tableId, 0, ~0UL, ServerId(9, 0));
+    EXPECT_EQ(format("beginPull: Pulling tablet [0x0,0xffffffffffffffff] in "
+            "tableId %lu from 9.0 instead of %s", tableId,
+            source->serverId.toString().c_str()), TestLog::get());
+    EXPECT_EQ(1U, puller->pulls.size());
+    EXPECT_EQ(ServerId(9, 0), pull->source);
+    EXPECT_NE(generation, pull->generation);
+    EXPECT_EQ(0U, pull->cursors[3]);
+    EXPECT_FALSE(pull->partitionDone[4]);
+}
+
+TEST_F(TabletPullerTest, drop) {
+    puller->beginPull(tableId + 1, 0, ~0UL, source->serverId);
+    EXPECT_EQ(2U, puller->numPulls.load());
+
+    TestLog::reset();
+    puller->drop(tableId, 0, 100);
+    EXPECT_EQ(format("drop: Abandoning pull of tablet "
+            "[0x0,0xffffffffffffffff] in tableId %lu", tableId),
+            TestLog::get());
+    EXPECT_FALSE(puller->isPulling(tableId, 0, ~0UL));
+    EXPECT_EQ(1U, puller->numPulls.load());
+    EXPECT_TRUE(puller->tombstoneProtector);
+
+    puller->drop(tableId + 1, 0, ~0UL);
+    EXPECT_EQ(0U, puller->numPulls.load());
+    EXPECT_FALSE(puller->tombstoneProtector);
+}
+
+TEST_F(TabletPullerTest, ensurePulled) {
+    EXPECT_EQ("(none)", targetValue("a"));
+    Key key(tableId, "a", 1);
+    puller->ensurePulled(tableId, key.getHash());
+    EXPECT_EQ("value-a", targetValue("a"));
+    EXPECT_EQ("(none)", targetValue("b"));
+    EXPECT_EQ(1U, puller->pulls[std::make_pair(tableId, 0UL)].pulled.count(
+            key.getHash()));
+
+    // Reads at the new owner pull on demand.
+    Buffer value;
+    ramcloud->read(tableId, "b", 1, &value);
+    EXPECT_EQ("value-b", TestUtil::toString(&value));
+}
+
+TEST_F(TabletPullerTest, ensurePulled_notPulling) {
+    puller->drop(tableId, 0, ~0UL);
+    Key key(tableId, "a", 1);
+    puller->ensurePulled(tableId, key.getHash());
+    EXPECT_EQ("(none)", targetValue("a"));
+}
+
+TEST_F(TabletPullerTest, ensurePulled_sourceFails) {
+    // The target doesn't hold the tablet as a pull source.
+    puller->beginPull(tableId, 0, ~0UL, target->serverId);
+    Key key(tableId, "a", 1);
+    EXPECT_THROW(puller->ensurePulled(tableId, key.getHash()),
+            RetryException);
+    EXPECT_EQ("(none)", targetValue("a"));
+    EXPECT_EQ(0U, puller->pulls[std::make_pair(tableId, 0UL)].pulled.size());
+}
+
+TEST_F(TabletPullerTest, isPulling) {
+    puller->drop(tableId, 0, ~0UL);
+    EXPECT_FALSE(puller->isPulling(tableId, 15));
+    puller->beginPull(tableId, 10, 20, source->serverId);
+    EXPECT_FALSE(puller->isPulling(tableId, 9));
+    EXPECT_TRUE(puller->isPulling(tableId, 10));
+    EXPECT_TRUE(puller->isPulling(tableId, 20));
+    EXPECT_FALSE(puller->isPulling(tableId, 21));
+    EXPECT_FALSE(puller->isPulling(tableId + 1, 15));
+    EXPECT_FALSE(puller->isPulling(tableId, 0, 9));
+    EXPECT_TRUE(puller->isPulling(tableId, 0, 10));
+    EXPECT_TRUE(puller->isPulling(tableId, 12, 14));
+    EXPECT_TRUE(puller->isPulling(tableId, 20, 30));
+    EXPECT_FALSE(puller->isPulling(tableId, 21, 30));
+}
+
+TEST_F(TabletPullerTest, pullAll) {
+    // The pull is dropped here, as for a recovery master that replayed the
+    // log of a master that hadn't finished pulling the tablet.
+    puller->drop(tableId, 0, ~0UL);
+    puller->pullAll(tableId, 0, ~0UL, source->serverId);
+    EXPECT_EQ("value-a", targetValue("a"));
+    EXPECT_EQ("value-b", targetValue("b"));
+    EXPECT_EQ("value-c", targetValue("c"));
+    EXPECT_FALSE(puller->tombstoneProtector);
+}
+
+TEST_F(TabletPullerTest, pullRound_finish) {
+    TestLog::Enable _("pullRound");
+    EXPECT_TRUE(puller->pullRound());
+    EXPECT_EQ("value-a", targetValue("a"));
+    EXPECT_EQ("value-b", targetValue("b"));
+    EXPECT_EQ("value-c", targetValue("c"));
+    EXPECT_TRUE(puller->pulls[std::make_pair(tableId, 0UL)].bulkDone);
+    EXPECT_EQ("", TestLog::get());
+
+    // Once the coordinator knows, the source drops its copy.
+    EXPECT_TRUE(puller->pullRound());
+    EXPECT_EQ(format("pullRound: Finished pulling tablet "
+            "[0x0,0xffffffffffffffff] in tableId %lu from %s", tableId,
+            source->serverId.toString().c_str()), TestLog::get());
+    EXPECT_FALSE(puller->isPulling(tableId, 0, ~0UL));
+    EXPECT_EQ(0U, puller->numPulls.load());
+    Tablet tablet = cluster.coordinator->tableManager.getTablet(tableId, 0);
+    EXPECT_EQ(target->serverId, tablet.serverId);
+    EXPECT_FALSE(tablet.pullSource.isValid());
+    TabletManager::Tablet local;
+    EXPECT_FALSE(source->master->tabletManager.getTablet(tableId, 0, ~0UL,
+            &local));
+}
+
+TEST_F(TabletPullerTest, pullRound_sourceFails) {
+    puller->beginPull(tableId, 0, ~0UL, target->serverId);
+    EXPECT_FALSE(puller->pullRound());
+    TabletPuller::Pull* pull = &puller->pulls[std::make_pair(tableId, 0UL)];
+    EXPECT_FALSE(pull->bulkDone);
+    EXPECT_EQ("(none)", targetValue("a"));
+
+    // The source has been recovered.
+    puller->beginPull(tableId, 0, ~0UL, source->serverId);
+    finishPull();
+    EXPECT_EQ("value-a", targetValue("a"));
+}
+
+TEST_F(TabletPullerTest, replay_keepsNewerWrites) {
+    ramcloud->write(tableId, "a", 1, "new-a");
+    ramcloud->remove(tableId, "b", 1);
+    finishPull();
+    EXPECT_EQ("new-a", targetValue("a"));
+    EXPECT_EQ("(none)", targetValue("b"));
+    EXPECT_EQ("value-c", targetValue("c"));
+
+    Buffer value;
+    EXPECT_THROW(ramcloud->read(tableId, "b", 1, &value),
+            ObjectDoesntExistException);
+}
+
+TEST_F(TabletPullerTest, replay_pullDropped) {
+    Buffer response;
+    SegmentCertificate certificate;
+    PullTabletDataRpc rpc(&context, source->serverId, tableId, 0, ~0UL, 0, 1,
+            0, &response);
+    rpc.wait(NULL, &certificate);
+    puller->drop(tableId, 0, ~0UL);
+    puller->replay(tableId, 0, &response, certificate, true, NULL);
+    EXPECT_EQ("(none)", targetValue("a"));
+}
+
+}  // namespace RAMCloud
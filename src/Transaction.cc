@@ -104,6 +104,30 @@ Transaction::commitAndSync()
     return commit();
 }
 
+/**
+ * Start committing the transaction, if that hasn't already happened, and
+ * make progress on the commit without blocking. This allows a client to
+ * overlap the commits of many transactions.
+ *
+ * \return
+ *      True means a decision has been reached and sent to all participant
+ *      servers, so commit will return the outcome without blocking.
+ */
+bool
+Transaction::isCommitReady()
+{
+    ClientTransactionTask* task = taskPtr.get();
+
+    if (!commitStarted) {
+        commitStarted = true;
+        ramcloud->transactionManager->startTransactionTask(taskPtr);
+    }
+
+    ramcloud->transactionManager->poll();
+    ramcloud->poll();
+    return task->allDecisionsSent();
+}
+
 /**
  * Read the current contents of an object as part of this transaction.
  *
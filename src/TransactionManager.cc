@@ -403,6 +403,24 @@ TransactionManager::isOpDeleted(uint64_t leaseId,
     }
 }
 
+/**
+ * Return the log references of all buffered PreparedOps. Used when handing
+ * a tablet over to another master, which must take over the tablet's
+ * transactions that are still in progress.
+ *
+ * \param[out] references
+ *      Log references to PreparedOp entries are appended here.
+ */
+void
+TransactionManager::collectPreparedOps(vector<uint64_t>* references)
+{
+    Lock lock(mutex);
+    for (ItemsMap::iterator it = items.begin(); it != items.end(); ++it) {
+        if (it->second != NULL)
+            references->push_back(it->second->newOpPtr);
+    }
+}
+
 /**
  * InProgressTransaction constructor; should also call registerAndStart to
  * complete the registration of the transaction.
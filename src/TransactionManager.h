@@ -69,6 +69,7 @@ class TransactionManager {
     void updateOpPtr(uint64_t leaseId, uint64_t rpcId, uint64_t newOpPtr);
     void markOpDeleted(uint64_t leaseId, uint64_t rpcId);
     bool isOpDeleted(uint64_t leaseId, uint64_t rpcId);
+    void collectPreparedOps(vector<uint64_t>* references);
     void regrabLocksAfterRecovery(ObjectManager* objectManager);
 
   PRIVATE:
@@ -60,7 +60,8 @@ class TransactionManagerTest : public ::testing::Test {
                         &masterTableMetadata,
                         &unackedRpcResults,
                         &transactionManager,
-                        &txRecoveryManager)
+                        &txRecoveryManager,
+                        NULL)
         , unackedRpcResults(&context, NULL, &clientLeaseValidator)
         , transactionManager(&context,
                              objectManager.getLog(),
@@ -148,6 +148,26 @@ TEST_F(TransactionTest, commit_internalError) {
     EXPECT_THROW(transaction->commit(), InternalError);
 }
 
+TEST_F(TransactionTest, isCommitReady) {
+    ramcloud->write(tableId1, "0", 1, "abcdef", 6);
+    transaction->write(tableId1, "0", 1, "hello", 5);
+
+    EXPECT_FALSE(transaction->commitStarted);
+    int polls = 0;
+    while (!transaction->isCommitReady()) {
+        polls++;
+        ASSERT_LT(polls, 1000);
+    }
+    EXPECT_TRUE(transaction->commitStarted);
+    EXPECT_TRUE(transaction->taskPtr.get()->allDecisionsSent());
+    EXPECT_TRUE(transaction->commit());
+
+    Buffer value;
+    ramcloud->read(tableId1, "0", 1, &value);
+    EXPECT_EQ("hello", string(reinterpret_cast<const char*>(
+            value.getRange(0, value.size())), value.size()));
+}
+
 TEST_F(TransactionTest, sync_basic) {
     ramcloud->write(tableId1, "0", 1, "abcdef", 6);
 
@@ -74,6 +74,7 @@ class Transport {
             , replyPayload()
             , epoch(0)
             , activities(~0)
+            , receivedTime(0)
             , outstandingRpcListHook()
         {}
 
@@ -152,6 +153,13 @@ class Transport {
         static const int READ_ACTIVITY = 1;
         static const int APPEND_ACTIVITY = 2;
 
+        /**
+         * Approximate Cycles::rdtsc time when the dispatch thread received
+         * this request; set by WorkerManager::handleRpc and used to measure
+         * how long requests wait for a worker thread.
+         */
+        uint64_t receivedTime;
+
         /**
          * Hook for the list of active server RPCs that the ServerRpcPool class
          * maintains. RPCs are added when ServerRpc-derived classes are
@@ -473,6 +473,28 @@ UnackedRpcResults::isRpcAcked(uint64_t clientId, uint64_t rpcId)
     }
 }
 
+/**
+ * Return the log references of all RPC results that clients have not yet
+ * acknowledged. Used when handing a tablet over to another master, which
+ * must be able to answer retries of RPCs this master completed.
+ *
+ * \param[out] references
+ *      Log references to RpcResult entries are appended here.
+ */
+void
+UnackedRpcResults::collectResults(vector<uint64_t>* references)
+{
+    Lock lock(mutex);
+    for (ClientMap::iterator it = clients.begin(); it != clients.end(); ++it) {
+        Client* client = it->second;
+        for (int i = 0; i < client->len; i++) {
+            UnackedRpc& rpc = client->rpcs[i];
+            if (rpc.id > client->maxAckId && rpc.result != NULL)
+                references->push_back(reinterpret_cast<uint64_t>(rpc.result));
+        }
+    }
+}
+
 /**
  * Construct to prevent a specific client's record from being removed.
  *
@@ -60,6 +60,7 @@ class UnackedRpcResults {
     void resetRecord(uint64_t clientId,
                      uint64_t rpcId);
     bool isRpcAcked(uint64_t clientId, uint64_t rpcId);
+    void collectResults(vector<uint64_t>* references);
 
     /**
      * This class is used to prevent RPC Result records for a specified client
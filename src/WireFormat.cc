@@ -122,6 +122,10 @@ opcodeSymbol(uint32_t opcode)
         case TX_PREPARE:                   return "TX_PREPARE";
         case TX_REQUEST_ABORT:             return "TX_REQUEST_ABORT";
         case TX_HINT_FAILED:               return "TX_HINT_FAILED";
+        case PUSH_HOT_OBJECT:              return "PUSH_HOT_OBJECT";
+        case DROP_HOT_OBJECT:              return "DROP_HOT_OBJECT";
+        case FORWARD_SERVER_LIST:          return "FORWARD_SERVER_LIST";
+        case PULL_TABLET_DATA:             return "PULL_TABLET_DATA";
         case ILLEGAL_RPC_TYPE:             return "ILLEGAL_RPC_TYPE";
     }
 
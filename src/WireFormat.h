@@ -130,7 +130,11 @@ enum Opcode {
     TX_PREPARE                  = 77,
     TX_REQUEST_ABORT            = 78,
     TX_HINT_FAILED              = 79,
-    ILLEGAL_RPC_TYPE            = 80, // 1 + the highest legitimate Opcode
+    PUSH_HOT_OBJECT             = 80,
+    DROP_HOT_OBJECT             = 81,
+    FORWARD_SERVER_LIST         = 82,
+    PULL_TABLET_DATA            = 83,
+    ILLEGAL_RPC_TYPE            = 84, // 1 + the highest legitimate Opcode
 };
 
 /**
@@ -153,6 +157,8 @@ enum ControlOp {
     RESET_METRICS               = 1011,
     QUIESCE                     = 1012,
     LOG_BASIC_TRANSPORT_ISSUES  = 1013,
+    GET_HOT_KEYS                = 1014,
+    GET_METRICS_SNAPSHOT        = 1015,
 };
 
 /**
@@ -173,6 +179,10 @@ struct ClientLease {
 struct RequestCommon {
     uint16_t opcode;              /// Opcode of operation to be performed.
     uint16_t service;             /// ServiceType to invoke for this rpc.
+    uint32_t traceId;             /// Nonzero means this RPC is being traced
+                                  /// and all processes that handle it
+                                  /// should record time trace events for
+                                  /// it (see RpcTrace). 0 means no tracing.
 } __attribute__((packed));
 
 /**
@@ -184,6 +194,7 @@ struct RequestCommon {
 struct RequestCommonWithId {
     uint16_t opcode;              /// Opcode of operation to be performed.
     uint16_t service;             /// ServiceType to invoke for this rpc.
+    uint32_t traceId;             /// See RequestCommon.
     uint64_t targetId;            /// ServerId for which this RPC is
                                   /// intended. 0 means "ignore this field":
                                   /// for convenience during testing.
@@ -550,6 +561,24 @@ struct DropIndexletOwnership {
     } __attribute__((packed));
 };
 
+struct DropHotObject {
+    static const Opcode opcode = DROP_HOT_OBJECT;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t tableId;
+        uint16_t keyLength;           // Length of the key in bytes.
+                                      // The actual key follows
+                                      // immediately after this header.
+        uint64_t pushId;              // The replica must discard its copy and
+                                      // ignore any push of this object with
+                                      // a pushId at or below this value.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+    } __attribute__((packed));
+};
+
 struct DropTabletOwnership {
     static const Opcode opcode = DROP_TABLET_OWNERSHIP;
     static const ServiceType service = MASTER_SERVICE;
@@ -640,6 +669,23 @@ struct FillWithTestData {
     } __attribute__((packed));
 };
 
+struct ForwardServerList {
+    static const Opcode opcode = FORWARD_SERVER_LIST;
+    static const ServiceType service = MEMBERSHIP_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        // Immediately following this header are the updates from an
+        // UPDATE_SERVER_LIST request, in the same format (a sequence of
+        // UpdateServerList::Request::Parts, each followed by its data).
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t currentVersion;      // The server list version number of the
+                                      // RPC recipient, after processing this
+                                      // request.
+    } __attribute__((packed));
+};
+
 struct GetBackupConfig {
     static const Opcode opcode = GET_BACKUP_CONFIG;
     static const ServiceType service = COORDINATOR_SERVICE;
@@ -825,6 +871,10 @@ struct GetTableConfig {
     struct Request {
         RequestCommon common;
         uint64_t tableId;
+        uint64_t knownEpoch;       // configEpoch and configVersion from an
+        uint64_t knownVersion;     // earlier response for this table whose
+                                   // contents the client still has, or 0
+                                   // to request the complete configuration.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -832,6 +882,13 @@ struct GetTableConfig {
                                    // The bytes of the tablet map follow
                                    // immediately after this header. See
                                    // ProtoBuf::Tablets.
+        uint64_t configEpoch;      // Identifies the configuration returned;
+        uint64_t configVersion;    // pass these back in a later request to
+                                   // get only what has changed since.
+        uint8_t delta;             // Nonzero means the tablet map only
+                                   // describes the changes since the known
+                                   // version in the request; see
+                                   // ProtoBuf::TableConfig.
     } __attribute__((packed));
 };
 
@@ -1005,6 +1062,9 @@ struct MigrateTablet {
         uint64_t firstKeyHash;      // First key of the tablet to migrate.
         uint64_t lastKeyHash;       // Last key of the tablet to migrate.
         uint64_t newOwnerMasterId;  // ServerId of the master to migrate to.
+        uint8_t pull;               // If nonzero, hand ownership over at
+                                    // once and let the new owner pull the
+                                    // tablet's objects afterwards.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -1228,6 +1288,60 @@ struct ProxyPing {
     } __attribute__((packed));
 };
 
+struct PullTabletData {
+    static const Opcode opcode = PULL_TABLET_DATA;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t tableId;           // Table containing the tablet.
+        uint64_t firstKeyHash;      // First key hash of the range to pull.
+        uint64_t lastKeyHash;       // Last key hash of the range to pull.
+        uint32_t partition;         // Which of #numPartitions disjoint slices
+                                    // of the source's hash table to scan.
+        uint32_t numPartitions;     // Number of slices the requester divides
+                                    // the pull into (one per parallel pull).
+        uint64_t cursor;            // Where to resume within the partition;
+                                    // 0 on the first pull of a partition,
+                                    // else the cursor from the last response.
+        uint8_t priority;           // If nonzero, ignore partition/cursor and
+                                    // return only entries for #keyHash.
+        uint64_t keyHash;           // Key hash for a priority pull.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t cursor;            // Pass back in the next request to
+                                    // continue this partition.
+        uint8_t done;               // Nonzero means the partition has been
+                                    // fully scanned; #cursor is meaningless.
+        uint32_t segmentBytes;      // Length of the Segment following this
+                                    // header.
+        SegmentCertificate certificate; // Certificate for the segment; used
+                                        // by the requester to iterate it.
+        // In buffer: Segment containing the pulled log entries.
+    } __attribute__((packed));
+};
+
+struct PushHotObject {
+    static const Opcode opcode = PUSH_HOT_OBJECT;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t tableId;
+        uint16_t keyLength;           // Length of the key in bytes.
+        uint64_t pushId;              // Orders pushes and drops of the same
+                                      // object from its owner.
+        uint64_t version;             // Version of the object being pushed.
+        uint32_t leaseMs;             // The replica may serve reads of this
+                                      // copy for this many milliseconds after
+                                      // receiving it.
+        uint32_t length;              // Length of the object's value in bytes.
+        // In buffer: the key, followed by the object's value.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+    } __attribute__((packed));
+};
+
 struct Read {
     static const Opcode opcode = READ;
     static const ServiceType service = MASTER_SERVICE;
@@ -1245,6 +1359,13 @@ struct Read {
         uint32_t length;              // Length of the object's value in bytes.
                                       // The actual bytes of the object follow
                                       // immediately after this header.
+        uint8_t numHotReplicas;       // Number of other masters that hold
+                                      // read-only copies of this object (see
+                                      // HotKeyReplicas). For each, a uint16_t
+                                      // length and a service locator follow
+                                      // the object's value.
+        uint16_t hotReplicasLength;   // Total bytes of replica information
+                                      // following the object's value.
     } __attribute__((packed));
 };
 
@@ -1283,6 +1404,9 @@ struct ReassignTabletOwnership {
                                     // Used with above to set the migrated
                                     // tablet's log ``creation time'' on the
                                     // coordinator.
+        uint64_t pullSourceId;      // If a valid ServerId, the old owner,
+                                    // which keeps the tablet's objects until
+                                    // the new owner has pulled them all.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -1618,6 +1742,9 @@ struct TakeTabletOwnership {
         uint64_t tableId;
         uint64_t firstKeyHash;
         uint64_t lastKeyHash;
+        uint64_t pullSourceId;      // If a valid ServerId, the master from
+                                    // which the tablet's objects must still
+                                    // be pulled.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -1876,15 +2003,40 @@ struct UpdateServerList {
     static const ServiceType service = MEMBERSHIP_SERVICE;
     struct Request {
         RequestCommonWithId common;
+        uint32_t forwardCount;        // Number of servers to which the
+                                      // recipient must forward this update
+                                      // with FORWARD_SERVER_LIST (see below);
+                                      // 0 means none.
 
         // Immediately following this header are one or more groups,
         // where each group consists of a Part object (defined below)
-        // followed by a serialized ProtoBuf::ServerList.
+        // followed by either a serialized ProtoBuf::ServerList or a Delta
+        // (defined below). After the last group come forwardCount 64-bit
+        // ServerIds, which identify the servers to forward to.
         struct Part {
             uint32_t serverListLength; // Number of bytes in the server list.
                                        // The bytes of the server list follow
-                                       // immediately after this header. See
-                                       // ProtoBuf::ServerList.
+                                       // immediately after this header.
+            uint8_t format;            // Either PROTOBUF (the bytes are a
+                                       // ProtoBuf::ServerList) or DELTA.
+        }  __attribute__((packed));
+        enum Format { PROTOBUF = 0, DELTA = 1 };
+
+        // Compact encoding of an incremental update that changes a single
+        // server's entry (the common case). Fields have the same meaning as
+        // in ProtoBuf::ServerList::Entry.
+        struct Delta {
+            uint64_t version;          // Server list version number after
+                                       // applying this update.
+            uint64_t serverId;
+            uint64_t replicationId;
+            uint32_t services;         // See ServiceMask::serialize.
+            uint32_t expectedReadMBytesPerSec;
+            uint8_t status;            // See ServerStatus.
+            uint16_t locatorLength;    // Bytes of service locator following
+                                       // this header. Locators are only sent
+                                       // for servers that are UP; recipients
+                                       // already know the others.
         }  __attribute__((packed));
     } __attribute__((packed));
     struct Response {
@@ -1892,6 +2044,16 @@ struct UpdateServerList {
         uint64_t currentVersion;      // The server list version number of the
                                       // RPC recipient, after processing this
                                       // request.
+
+        // If the request asked the recipient to forward the update, then
+        // following this header is one Forwarded object for each of those
+        // servers, in the same order as in the request.
+        struct Forwarded {
+            uint64_t serverId;
+            uint64_t currentVersion;  // The server list version of serverId
+                                      // after processing the update, or 0 if
+                                      // the update couldn't be delivered.
+        } __attribute__((packed));
     } __attribute__((packed));
 };
 
@@ -1921,6 +2083,8 @@ struct Write {
                                       // follow immediately after this header
         RejectRules rejectRules;
         uint8_t async;
+        uint32_t ttl;                 // If nonzero, the object expires
+                                      // this many seconds after the write.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
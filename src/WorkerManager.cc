@@ -18,11 +18,13 @@
 #include "Cycles.h"
 #include "CycleCounter.h"
 #include "Fence.h"
+#include "HardwareCounters.h"
 #include "Initialize.h"
 #include "LogProtector.h"
 #include "PerfStats.h"
 #include "RawMetrics.h"
 #include "RpcLevel.h"
+#include "RpcTrace.h"
 #include "ShortMacros.h"
 #include "ServerRpcPool.h"
 #include "TimeTrace.h"
@@ -164,6 +166,9 @@ WorkerManager::handleRpc(Transport::ServerRpc* rpc)
         return;
     }
     int level = RpcLevel::getLevel(WireFormat::Opcode(header->opcode));
+    rpc->receivedTime = context->dispatch->currentTime;
+    RpcTrace::record(header->traceId, "rpc %u: server received opcode %u",
+            header->opcode);
 #ifdef LOG_RPCS
     LOG(NOTICE, "Received %s RPC at %lu with %u bytes",
             WireFormat::opcodeSymbol(header->opcode),
@@ -287,8 +292,12 @@ WorkerManager::poll()
                     }
                     rpcsWaiting--;
                     level->requestsRunning++;
+                    Transport::ServerRpc* waiting = level->waitingRpcs.front();
+                    worker->opcode = WireFormat::Opcode(waiting->
+                            requestPayload.getStart<WireFormat::RequestCommon>()
+                            ->opcode);
                     worker->level = i;
-                    worker->handoff(level->waitingRpcs.front());
+                    worker->handoff(waiting);
                     level->waitingRpcs.pop();
                     startedNewRpc = true;
                     break;
@@ -304,7 +313,9 @@ WorkerManager::poll()
                     reinterpret_cast<uint64_t>(rpc),
                     rpc->replyPayload.size());
 #endif
+            uint32_t traceId = RpcTrace::getTraceId(&rpc->requestPayload);
             rpc->sendReply();
+            RpcTrace::record(traceId, "rpc %u: reply sent");
 #ifdef SMTT
             context->timeTrace->record(
                     TimeTraceUtil::statusMsg(worker->threadId,
@@ -427,10 +438,32 @@ WorkerManager::workerMain(Worker* worker)
                     TimeTraceUtil::RequestStatus::WORKER_START));
 #endif
 
+            // Save information needed for latency statistics now: once the
+            // reply has been sent, the dispatch thread may free the RPC.
+            WireFormat::Opcode opcode = worker->opcode;
+            uint64_t queueCycles = (lastIdle > worker->rpc->receivedTime)
+                    ? lastIdle - worker->rpc->receivedTime : 0;
+
+            RpcTrace::currentId = RpcTrace::getTraceId(
+                    &worker->rpc->requestPayload);
+            RpcTrace::record("rpc %u: worker started");
+
             worker->rpc->epoch = LogProtector::getCurrentEpoch();
             Service::Rpc rpc(worker, &worker->rpc->requestPayload,
                     &worker->rpc->replyPayload);
+            HardwareCounters::Reading countersBefore, countersAfter;
+            bool counting = HardwareCounters::read(&countersBefore);
             Service::handleRpc(worker->context, &rpc);
+            if (counting && HardwareCounters::read(&countersAfter)) {
+                countersAfter.subtract(countersBefore);
+                uint64_t* counts = countersAfter.values;
+                PerfStats::recordRpcCounters(opcode,
+                        counts[HardwareCounters::INSTRUCTIONS],
+                        counts[HardwareCounters::LLC_MISSES],
+                        counts[HardwareCounters::BRANCH_MISSES]);
+            }
+            RpcTrace::record("rpc %u: worker finished");
+            RpcTrace::currentId = 0;
 
             // Pass the RPC back to the dispatch thread for completion.
             Fence::leave();
@@ -445,6 +478,8 @@ WorkerManager::workerMain(Worker* worker)
             // Update performance statistics.
             uint64_t current = Cycles::rdtsc();
             PerfStats::threadStats.workerActiveCycles += (current - lastIdle);
+            PerfStats::recordRpcLatency(opcode, queueCycles,
+                    current - lastIdle);
             lastIdle = current;
         }
         TEST_LOG("exiting");
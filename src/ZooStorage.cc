@@ -389,6 +389,120 @@ ZooStorage::setInternal(Lock& lock, Hint flavor, const char* absName,
     }
 }
 
+/**
+ * Write several objects with ZooKeeper "multi" operations, so that they are
+ * committed atomically in one round trip. See the documentation for
+ * ExternalStorage::setMulti. ZooKeeper drops the connection on requests
+ * larger than its jute.maxbuffer limit (1MB by default), which would look
+ * like a transient error and be retried forever, so writes beyond
+ * MAX_MULTI_OPS operations or MAX_MULTI_BYTES bytes are divided among
+ * several multi operations; each of these is atomic, but the set as a whole
+ * is not.
+ */
+void
+ZooStorage::setMulti(vector<Write>* writes)
+{
+    Lock lock(mutex);
+    size_t start = 0;
+    while (start < writes->size()) {
+        if (lostLeadership) {
+            throw LostLeadershipException(HERE);
+        }
+        size_t end = start;
+        size_t bytes = 0;
+        while (end < writes->size()) {
+            Write& write = (*writes)[end];
+            size_t writeBytes = write.name.size() + write.value.size();
+            if ((end > start) && ((end - start >= MAX_MULTI_OPS) ||
+                    (bytes + writeBytes > MAX_MULTI_BYTES))) {
+                break;
+            }
+            bytes += writeBytes;
+            end++;
+        }
+        multi(lock, &(*writes)[start], end - start);
+        start = end;
+    }
+    if (lostLeadership) {
+        throw LostLeadershipException(HERE);
+    }
+}
+
+/**
+ * Write several objects with a single ZooKeeper "multi" operation; this
+ * method does most of the work of setMulti.
+ *
+ * \param lock
+ *      Ensures that caller has acquired mutex.
+ * \param writes
+ *      The objects to write (the first of #count consecutive elements). Hints
+ *      are corrected in place if they turn out to be wrong.
+ * \param count
+ *      Number of objects to write; must be at least 1.
+ */
+void
+ZooStorage::multi(Lock& lock, Write* writes, size_t count)
+{
+    vector<string> absNames;
+    for (size_t i = 0; i < count; i++) {
+        absNames.emplace_back(getFullName(writes[i].name.c_str()));
+    }
+
+    vector<zoo_op_t> ops(count);
+    vector<zoo_op_result_t> results(count);
+    while (1) {
+        for (size_t i = 0; i < count; i++) {
+            Write& write = writes[i];
+            if (write.flavor == Hint::CREATE) {
+                zoo_create_op_init(&ops[i], absNames[i].c_str(),
+                        write.value.data(),
+                        downCast<int>(write.value.size()),
+                        &ZOO_OPEN_ACL_UNSAFE, 0, NULL, 0);
+            } else {
+                zoo_set_op_init(&ops[i], absNames[i].c_str(),
+                        write.value.data(),
+                        downCast<int>(write.value.size()), -1, NULL);
+            }
+        }
+        int status = zoo_multi(zoo, downCast<int>(count), &ops[0],
+                &results[0]);
+        if (status == ZOK) {
+            return;
+        }
+
+        // If the multi failed because of an incorrect hint or a missing
+        // parent, fix the offending operation and try again. ZooKeeper
+        // aborts the multi at the first failure, so there is at most one.
+        bool fixed = false;
+        for (size_t i = 0; i < count; i++) {
+            int err = results[i].err;
+            Write& write = writes[i];
+            if (write.flavor == Hint::CREATE) {
+                if (err == ZNONODE) {
+                    createParent(lock, absNames[i].c_str());
+                    fixed = true;
+                } else if (err == ZNODEEXISTS) {
+                    RAMCLOUD_LOG(DEBUG, "Incorrect CREATE hint for \"%s\": "
+                            "object already exists", absNames[i].c_str());
+                    write.flavor = Hint::UPDATE;
+                    fixed = true;
+                }
+            } else if (err == ZNONODE) {
+                RAMCLOUD_LOG(DEBUG, "Incorrect UPDATE hint for \"%s\": "
+                        "object doesn't exist", absNames[i].c_str());
+                write.flavor = Hint::CREATE;
+                fixed = true;
+            }
+        }
+        if (fixed) {
+            continue;
+        }
+        handleError(lock, status);
+        RAMCLOUD_LOG(WARNING, "Retrying after %s error writing %lu objects",
+                zerror(status), count);
+    }
+}
+
 /**
  * This method makes a single attempt to become leader (it checks the
  * leader object, and if it doesn't exist, or its version hasn't changed
@@ -40,6 +40,16 @@ class ZooStorage: public ExternalStorage {
     virtual void remove(const char* name);
     virtual void set(Hint flavor, const char* name, const char* value,
             int valueLength = -1);
+    virtual void setMulti(vector<Write>* writes);
+
+    /// Maximum number of operations in a single ZooKeeper multi operation
+    /// issued by setMulti.
+    static const size_t MAX_MULTI_OPS = 1000;
+
+    /// Maximum total size of the names and values in a single ZooKeeper
+    /// multi operation issued by setMulti; this leaves plenty of room for
+    /// per-operation overheads within ZooKeeper's default 1MB limit.
+    static const size_t MAX_MULTI_BYTES = 512*1024;
 
   PRIVATE:
     /**
@@ -130,6 +140,7 @@ class ZooStorage: public ExternalStorage {
     void close(Lock& lock);
     void createParent(Lock& lock, const char* childName);
     void handleError(Lock& lock, int status);
+    void multi(Lock& lock, Write* writes, size_t count);
     void open(Lock& lock);
     void removeInternal(Lock& lock, const char* name);
     bool renewLease(Lock& lock);
@@ -362,6 +362,65 @@ TEST_F(ZooStorageTest, setInternal_recoverableUpdateError) {
             "writing /test"));
 }
 
+TEST_F(ZooStorageTest, setMulti_basics) {
+    Buffer value;
+    zoo->set(ExternalStorage::Hint::CREATE, "/test/var1", "old");
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::Hint::UPDATE, "/test/var1", "value1");
+    writes.emplace_back(ExternalStorage::Hint::CREATE, "/test/var2", "value2");
+    zoo->setMulti(&writes);
+    EXPECT_TRUE(zoo->get("/test/var1", &value));
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_TRUE(zoo->get("/test/var2", &value));
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+    EXPECT_EQ("", TestLog::get());
+}
+TEST_F(ZooStorageTest, setMulti_hintsIncorrect) {
+    Buffer value;
+    zoo->set(ExternalStorage::Hint::CREATE, "/test/var1", "old");
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::Hint::CREATE, "/test/var1", "value1");
+    writes.emplace_back(ExternalStorage::Hint::UPDATE, "/test/a/var2",
+            "value2");
+    zoo->setMulti(&writes);
+    EXPECT_TRUE(zoo->get("/test/var1", &value));
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_TRUE(zoo->get("/test/a/var2", &value));
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+    EXPECT_EQ("setMulti: Incorrect CREATE hint for \"/test/var1\": "
+            "object already exists | "
+            "setMulti: Incorrect UPDATE hint for \"/test/a/var2\": "
+            "object doesn't exist",
+            TestLog::get());
+}
+TEST_F(ZooStorageTest, setMulti_split) {
+    // Each write is more than half the limit, so each needs its own
+    // multi operation.
+    Buffer value;
+    string big(ZooStorage::MAX_MULTI_BYTES / 2 + 1, 'x');
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::Hint::CREATE, "/test/var1",
+            big.c_str());
+    writes.emplace_back(ExternalStorage::Hint::CREATE, "/test/var2",
+            big.c_str());
+    writes.emplace_back(ExternalStorage::Hint::CREATE, "/test/var3", "small");
+    zoo->setMulti(&writes);
+    EXPECT_TRUE(zoo->get("/test/var1", &value));
+    EXPECT_EQ(big.size(), value.size());
+    EXPECT_TRUE(zoo->get("/test/var2", &value));
+    EXPECT_EQ(big.size(), value.size());
+    EXPECT_TRUE(zoo->get("/test/var3", &value));
+    EXPECT_EQ("small", TestUtil::toString(&value));
+    EXPECT_EQ("", TestLog::get());
+}
+TEST_F(ZooStorageTest, setMulti_lostLeadership) {
+    zoo->lostLeadership = true;
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::Hint::CREATE, "/test", "value1");
+    EXPECT_THROW(zoo->setMulti(&writes),
+                ExternalStorage::LostLeadershipException);
+}
+
 TEST_F(ZooStorageTest, checkLeader_objectDoesntExist) {
     Buffer value;
     zoo->leaderObject = "/test";